@@ -0,0 +1,130 @@
+#include "InflateReference.hpp"
+#include "api/Inflate.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace vd;
+
+// Inflate throughput of the current decoder against the reference one,
+// on the IDAT streams of the PNG files given on the command line, or
+// of the sample assets when there are none.
+// The outputs are compared once before timing.
+
+static constexpr u8 PngSignature[] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+static u32 ReadU32BE(const u8* src)
+{
+  return (toU32(src[0]) << 24) | (toU32(src[1]) << 16) |
+         (toU32(src[2]) << 8) | toU32(src[3]);
+}
+
+// Joins the IDAT chunks into a single zlib stream.
+static Arr<u8> ReadImageData(Span<u8 const> png)
+{
+  if(png.size() < sizeof(PngSignature) ||
+     memcmp(png.data(), PngSignature, sizeof(PngSignature)) != 0)
+    throw std::runtime_error("Not a PNG file");
+
+  Arr<u8> ret;
+
+  u64 offset = sizeof(PngSignature);
+  while(offset + 12u <= png.size()) {
+    u64 length = ReadU32BE(png.data() + offset);
+    if(offset + 12u + length > png.size())
+      throw std::runtime_error("Truncated PNG chunk");
+
+    const u8* type = png.data() + offset + 4u;
+    const u8* data = type + 4u;
+    if(memcmp(type, "IDAT", 4u) == 0)
+      ret.insert(ret.end(), data, data + length);
+    if(memcmp(type, "IEND", 4u) == 0) break;
+
+    offset += 12u + length;
+  }
+
+  return ret;
+}
+
+static Arr<u8> CurrentZLibInflate(Span<u8 const> src, u64 sizeHint)
+{
+  Arr<u8> ret;
+  ret.reserve(sizeHint);
+
+  Span<u8 const> chunks[] = {src};
+  ZLibInflate(
+    chunks,
+    [&ret](Span<u8 const> bytes) {
+      ret.insert(ret.end(), bytes.begin(), bytes.end());
+    },
+    false);
+
+  return ret;
+}
+
+// Best of the runs, in seconds.
+template<typename Fn>
+static f64 Measure(u32 runCount, const Fn& fn)
+{
+  f64 best = std::numeric_limits<f64>::max();
+  for(u32 run = 0u; run < runCount; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    best     = std::min(
+      best, std::chrono::duration<f64>(end - start).count());
+  }
+  return best;
+}
+
+int main(int argc, char** argv)
+{
+  Arr<fs::path> paths;
+  for(int idx = 1; idx < argc; ++idx) paths.emplace_back(argv[idx]);
+
+  if(paths.empty()) {
+    for(const auto& entry: fs::directory_iterator(VD_BENCH_ASSET_DIR)) {
+      if(entry.path().extension() == ".png")
+        paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+  }
+
+  constexpr u32 RunCount = 10u;
+
+  std::printf(
+    "%-40s %10s %12s %12s %8s\n", "file", "MB", "reference", "current",
+    "speedup");
+
+  for(const auto& path: paths) {
+    MappedFile file(path);
+    auto       imageData = ReadImageData(file.GetData());
+
+    auto expected = bench::ReferenceZLibInflate(imageData);
+    if(CurrentZLibInflate(imageData, expected.size()) != expected) {
+      std::fprintf(
+        stderr, "%s: inflated data doesn't match\n",
+        path.string().c_str());
+      return 1;
+    }
+
+    f64 referenceTime = Measure(RunCount, [&] {
+      auto out =
+        bench::ReferenceZLibInflate(imageData, expected.size());
+      if(out.size() != expected.size()) std::abort();
+    });
+    f64 currentTime = Measure(RunCount, [&] {
+      auto out = CurrentZLibInflate(imageData, expected.size());
+      if(out.size() != expected.size()) std::abort();
+    });
+
+    f64 megabytes = toF64(expected.size()) / (1024.0 * 1024.0);
+    std::printf(
+      "%-40s %10.2f %9.1fMB/s %9.1fMB/s %7.2fx\n",
+      path.filename().string().c_str(), megabytes,
+      megabytes / referenceTime, megabytes / currentTime,
+      referenceTime / currentTime);
+  }
+
+  return 0;
+}
@@ -0,0 +1,310 @@
+#include "InflateReference.hpp"
+
+using namespace vd;
+
+// Kept as it was, except for the stored block length check, which
+// rejected every valid block, and the thrown pointer on bad length
+// counts.
+
+static constexpr u8 DeflateHCLENMap[] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static constexpr u8 DeflateExtraLengthBits[] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+static constexpr u32 DeflateExtraLengthValue[] = {
+  3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+
+static constexpr u8 DeflateExtraDistanceBits[] = {
+  0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+  6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static constexpr u32 DeflateExtraDistanceValue[] = {
+  1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+  33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+  1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+
+class ReferenceBitIStream
+{
+public:
+  ReferenceBitIStream(Span<u8 const> bytes):
+    m_bytes{bytes},
+    m_cursor{bytes.begin()},
+    m_buffer{0u},
+    m_bufferSize{0u}
+  {}
+
+  [[nodiscard]] u32 Read(u32 count)
+  {
+    auto value = Peek(count);
+    m_bufferSize -= count;
+    m_buffer >>= count;
+    return value;
+  }
+
+  template<typename T>
+  T Read(u32 count)
+  {
+    return static_cast<T>(Read(count));
+  }
+
+  [[nodiscard]] u32 Peek(u32 count)
+  {
+    while(m_bufferSize < count) {
+      if(m_cursor == m_bytes.end())
+        throw std::runtime_error("Reached end of bit stream");
+
+      u32 byte = *m_cursor;
+      m_buffer |= byte << m_bufferSize;
+
+      m_cursor++;
+      m_bufferSize += 8u;
+    }
+
+    return m_buffer & ((1u << count) - 1u);
+  }
+
+  void Skip(u32 count) { [[maybe_unused]] auto v = Read(count); }
+
+  void SkipToNextByte() { Skip(m_bufferSize % 8u); }
+
+private:
+  Span<u8 const>           m_bytes;
+  Span<u8 const>::iterator m_cursor;
+
+  u32 m_buffer;
+  u32 m_bufferSize;
+};
+
+class ReferenceHuffmanTable
+{
+public:
+  ReferenceHuffmanTable(u32 maxLength):
+    m_entries{}, m_maxLength{maxLength}
+  {
+    if(maxLength >= MaxBits)
+      throw std::runtime_error("Huffman table: size is too big");
+
+    u64 entryCount = 1ull << maxLength;
+    m_entries.resize(entryCount);
+  }
+
+  ReferenceHuffmanTable(u32 maxLength, Span<u8 const> symbolLengths):
+    ReferenceHuffmanTable(maxLength)
+  {
+    Initialize(symbolLengths);
+  }
+
+  void Initialize(Span<u8 const> symbolLengths)
+  {
+    u32 lengthCounts[MaxBits] = {};
+    for(u32 symbolIdx = 0u; symbolIdx < std::size(symbolLengths);
+        ++symbolIdx) {
+      if(symbolLengths[symbolIdx] >= std::size(lengthCounts))
+        throw std::runtime_error(
+          "Huffman table: invalid symbol lengths");
+      ++lengthCounts[symbolLengths[symbolIdx]];
+    }
+    lengthCounts[0] = 0u;
+
+    u32 nextCode[MaxBits] = {};
+    for(u32 idx = 1u; idx < MaxBits; ++idx) {
+      nextCode[idx] = (nextCode[idx - 1u] + lengthCounts[idx - 1u])
+                      << 1;
+    }
+
+    for(u32 symbolIdx = 0u; symbolIdx < std::size(symbolLengths);
+        ++symbolIdx) {
+      auto length = symbolLengths[symbolIdx];
+      if(length == 0u) continue;
+
+      auto code = nextCode[length];
+      ++nextCode[length];
+
+      u32 padBits  = m_maxLength - length;
+      u32 padCount = 1u << padBits;
+      for(u32 pad = 0u; pad < padCount; ++pad) {
+        u32 reverseIdx = (code << padBits) | pad;
+        u32 entryIdx   = bitReverse(reverseIdx, m_maxLength);
+
+        m_entries[entryIdx].symbol = static_cast<u16>(symbolIdx);
+        m_entries[entryIdx].bits   = length;
+      }
+    }
+  }
+
+  u32 Decode(ReferenceBitIStream& src)
+  {
+    auto idx = src.Peek(m_maxLength);
+    if(idx >= m_entries.size())
+      throw std::runtime_error("Huffman table: symbol out of range");
+
+    const auto& entry = m_entries[idx];
+
+    if(entry.bits == 0u)
+      throw std::runtime_error("Huffman table: symbol has zero length");
+
+    src.Skip(entry.bits);
+    return entry.symbol;
+  }
+
+  template<typename T>
+  T Decode(ReferenceBitIStream& src)
+  {
+    return static_cast<T>(Decode(src));
+  }
+
+private:
+  static constexpr u32 MaxBits = 16u;
+
+  struct HuffmanEntry {
+    u16 symbol;
+    u8  bits;
+  };
+
+private:
+  std::vector<HuffmanEntry> m_entries;
+  u32                       m_maxLength;
+};
+
+Arr<u8>
+vd::bench::ReferenceZLibInflate(Span<u8 const> inData, u64 sizeHint)
+{
+  ByteIStream inBytes(inData);
+
+  u8 CMF = inBytes.Read<u8>();
+  u8 FLG = inBytes.Read<u8>();
+
+  u8 compressionMethod = CMF & 0xf;
+  u8 presetDictionary  = (FLG >> 5) & 0x1;
+
+  if(compressionMethod != 8u || presetDictionary != 0u)
+    throw std::runtime_error("Deflate: unsopported settings");
+
+  ReferenceBitIStream inBits(inBytes.ReadAllBytes());
+  ByteOStream         outBytes(sizeHint);
+
+  for(;;) {
+    u32 BFINAL = inBits.Read(1);
+    u32 BTYPE  = inBits.Read(2);
+
+    ReferenceHuffmanTable literalLengthTable(15u);
+    ReferenceHuffmanTable distanceTable(15u);
+
+    if(BTYPE == 0u) // Literal
+    {
+      inBits.SkipToNextByte();
+      u32 LEN  = inBits.Read(16);
+      u32 NLEN = inBits.Read(16);
+
+      if((LEN ^ NLEN) != 0xffffu)
+        throw std::runtime_error("Deflate: bad block length");
+
+      for(u32 idx = 0u; idx < LEN; ++idx)
+        outBytes.Write(static_cast<u8>(inBits.Read(8u)));
+    } else {
+      std::array<u8, 512u> huffmanBuffer = {};
+      std::span<u8>        lengthData;
+      std::span<u8>        distanceData;
+
+      if(BTYPE == 1u) { // Default table
+        for(u32 idx = 0u; idx < 144u; ++idx) huffmanBuffer[idx] = 8u;
+        for(u32 idx = 144u; idx < 256u; ++idx) huffmanBuffer[idx] = 9u;
+        for(u32 idx = 256u; idx < 280u; ++idx) huffmanBuffer[idx] = 7u;
+        for(u32 idx = 280u; idx < 288u; ++idx) huffmanBuffer[idx] = 8u;
+        for(u32 idx = 288u; idx < 318u; ++idx) huffmanBuffer[idx] = 5u;
+
+        lengthData   = {huffmanBuffer.data(), 288u};
+        distanceData = {huffmanBuffer.data() + 288u, 32u};
+      } else if(BTYPE == 2u) { // Dynamic table
+        u32 HLIT  = inBits.Read(5) + 257u;
+        u32 HDIST = inBits.Read(5) + 1u;
+        u32 HCLEN = inBits.Read(4) + 4u;
+
+        u8 HCLEN_table[std::size(DeflateHCLENMap)] = {};
+        for(u32 idx = 0u; idx < HCLEN; ++idx)
+          HCLEN_table[DeflateHCLENMap[idx]] =
+            static_cast<u8>(inBits.Read(3u));
+
+        ReferenceHuffmanTable lengthTable(7u, HCLEN_table);
+
+        u32 lengthIdx   = 0u;
+        u32 lengthCount = HLIT + HDIST;
+
+        while(lengthIdx < lengthCount) {
+          u8 lengthRepeat  = 1u;
+          u8 lengthValue   = 0u;
+          u8 encodedLength = lengthTable.Decode<u8>(inBits);
+
+          if(encodedLength <= 15u) {
+            lengthValue = encodedLength;
+          } else if(encodedLength == 16u) {
+            lengthRepeat = 3u + inBits.Read<u8>(2);
+            if(lengthIdx == 0u)
+              throw std::runtime_error("Deflate: bad encoded length");
+            lengthValue = huffmanBuffer[lengthIdx - 1u];
+          } else if(encodedLength == 17u) {
+            lengthRepeat = 3u + inBits.Read<u8>(3);
+          } else if(encodedLength == 18u) {
+            lengthRepeat = 11u + inBits.Read<u8>(7);
+          } else {
+            throw std::runtime_error("Deflate: bad encoded length");
+          }
+
+          for(u32 idx = 0u; idx < lengthRepeat; ++idx) {
+            huffmanBuffer[lengthIdx] = lengthValue;
+            ++lengthIdx;
+          }
+        }
+
+        if(lengthIdx != lengthCount)
+          throw std::runtime_error("Deflate: bad literal length count");
+
+        lengthData   = {huffmanBuffer.data(), HLIT};
+        distanceData = {huffmanBuffer.data() + HLIT, HDIST};
+      } else {
+        throw std::runtime_error("Deflate: bad block type");
+      }
+
+      literalLengthTable.Initialize(lengthData);
+      distanceTable.Initialize(distanceData);
+
+      for(;;) {
+        u32 literalLength = literalLengthTable.Decode(inBits);
+
+        if(literalLength == 256u) break;
+
+        if(literalLength < 256u) {
+          outBytes.Write(literalLength & 0xff);
+        } else {
+          auto literalIdx = literalLength - 257u;
+          auto length     = DeflateExtraLengthValue[literalIdx];
+
+          auto lengthExtraBits = DeflateExtraLengthBits[literalIdx];
+          if(lengthExtraBits > 0u)
+            length += inBits.Read(lengthExtraBits);
+
+          auto distanceIdx = distanceTable.Decode(inBits);
+          auto distance    = DeflateExtraDistanceValue[distanceIdx];
+
+          auto distanceExtraBits =
+            DeflateExtraDistanceBits[distanceIdx];
+          if(distanceExtraBits > 0u)
+            distance += inBits.Read(distanceExtraBits);
+
+          if(outBytes.size() < distance)
+            throw std::runtime_error(
+              "Deflate: out of bounds lookback distance");
+
+          auto rangeStart = outBytes.size() - distance;
+          for(u32 idx = 0u; idx < length; ++idx)
+            outBytes.Write(outBytes[rangeStart + idx]);
+        }
+      }
+    }
+    if(BFINAL) break;
+  }
+
+  return std::move(outBytes.data());
+}
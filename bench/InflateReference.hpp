@@ -0,0 +1,12 @@
+#pragma once
+
+#include "vuldir/core/Core.hpp"
+
+namespace vd::bench {
+
+// The inflate path from before the table-driven decoder: a 32-bit bit
+// buffer refilled a byte at a time, a full 2^15 entry table per block
+// and byte-wise match copies into a growing vector.
+Arr<u8> ReferenceZLibInflate(Span<u8 const> inData, u64 sizeHint = 0u);
+
+} // namespace vd::bench
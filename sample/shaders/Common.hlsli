@@ -26,6 +26,11 @@ struct Scene {
   float3 directionalLightColor;
   int _pad4;
   float directionalLightIntensity;
+
+  int iblIrradianceIdx;
+  int iblSpecularIdx;
+  int iblBrdfIdx;
+  float iblSpecularMips;
 };
 
 struct Prim {
@@ -45,6 +50,8 @@ struct Material {
 
   float metallic;
   float roughness;
+
+  int nrmXY; // The normal map only stores X and Y
 };
 
 inline Scene GetScene() { return srvBuf[pc.data.x].Load<Scene>(0); }
@@ -55,6 +62,7 @@ inline Material GetMaterial() {
 
 inline bool HasColorTex() { return GetMaterial().colIdx >= 0; }
 inline bool HasNormalTex() { return GetMaterial().nrmIdx >= 0; }
+inline bool HasNormalXY() { return GetMaterial().nrmXY != 0; }
 inline bool HasMetallicRoughnessText() { return GetMaterial().mrIdx >= 0; }
 
 #define ColorTex srvTex2D[GetMaterial().colIdx]
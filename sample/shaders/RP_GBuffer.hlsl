@@ -43,12 +43,18 @@ PSOut MainPS(VSOut input)
   float3 normal = input.nrm;
 
   if(HasNormalTex()) {
-    float3   sNormal = NormalTex.Sample(smpLinearWrap, input.uv0).xyz;
+    float3 sNormal =
+      NormalTex.Sample(smpLinearWrap, input.uv0).xyz * 2 - 1;
+
+    // Z is rebuilt from X and Y, BC5 normal maps only store those.
+    if(HasNormalXY())
+      sNormal.z = sqrt(saturate(1 - dot(sNormal.xy, sNormal.xy)));
+
     float3   N       = normalize(input.nrm);
     float3   T       = normalize(input.tan);
     float3   B       = cross(N, T);
     float3x3 TBN     = float3x3(T, B, N);
-    normal           = mul(normalize(sNormal * 2 - 1), TBN);
+    normal           = mul(normalize(sNormal), TBN);
   }
 
   float roughness = 0;
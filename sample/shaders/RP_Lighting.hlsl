@@ -44,6 +44,33 @@ float GeometrySmith(float3 N, float3 V, float3 L, float roughness)
   return ggx1 * ggx2;
 }
 
+// Split-sum image based lighting. The irradiance is already divided by
+// pi, the specular mips go from smooth to rough.
+float3 EnvironmentLighting(
+  Scene scene, float3 N, float3 V, float3 F0, float3 albedo,
+  float metallic, float roughness)
+{
+  float  NdotV = max(dot(N, V), 0.0);
+  float3 R     = reflect(-V, N);
+
+  float3 kS = FresnelSchlick(NdotV, F0);
+  float3 kD = (1.0 - kS) * (1.0 - metallic);
+
+  float3 irradiance = srvTexCB[scene.iblIrradianceIdx]
+                        .SampleLevel(smpLinearClamp, N, 0)
+                        .rgb;
+  float3 prefiltered =
+    srvTexCB[scene.iblSpecularIdx]
+      .SampleLevel(
+        smpLinearClamp, R, roughness * (scene.iblSpecularMips - 1.0))
+      .rgb;
+  float2 brdf = srvTex2D[scene.iblBrdfIdx]
+                  .SampleLevel(smpLinearClamp, float2(NdotV, roughness), 0)
+                  .rg;
+
+  return kD * albedo * irradiance + prefiltered * (F0 * brdf.x + brdf.y);
+}
+
 float4 MainPS(VSOut input): SV_TARGET
 {
   // Sample GBuffer
@@ -65,8 +92,13 @@ float4 MainPS(VSOut input): SV_TARGET
   // Material base reflectivity
   float3 F0 = lerp(0.04, albedo, metallic);
 
-  // Initialize lighting with ambient only
+  // Initialize lighting with the environment, or a flat ambient
+  // without one
   float3 color = GetScene().ambientColor * albedo;
+  [branch] if (GetScene().iblSpecularIdx >= 0) {
+    color = EnvironmentLighting(
+      GetScene(), N, V, F0, albedo, metallic, roughness);
+  }
 
   // ----- Directional light calculation -----
   {
@@ -47,7 +47,11 @@ UPtr<Image> LoadImage(Device& device, const char* path)
 
 namespace vd {
 
-Scene::Scene(Device& dev, u32 frameCount)
+Scene::Scene(Device& dev, u32 frameCount):
+  assetCache{std::make_unique<AssetCache>(AssetCache::Desc{})},
+  imageCache{std::make_shared<DiskCache>(
+    DiskCache::Desc{.directory = "Cache/Images"})},
+  registry{std::make_unique<ResourceRegistry>(dev)}
 {
   // Initialize frame resources
   frames.resize(frameCount);
@@ -233,6 +237,10 @@ void Scene::prepare(RenderContext&)
       .directionalLightDirection = mt::Norm(Float3{1.0f, -1.0f, 0.5f}),
       .directionalLightColor     = {1.0f, 1.0f, 1.0f},
       .directionalLightIntensity = 1.0f,
+      .iblIrradianceIdx          = -1,
+      .iblSpecularIdx            = -1,
+      .iblBrdfIdx                = -1,
+      .iblSpecularMips           = 0.0f,
     };
     frame.scene->Update();
   }
@@ -242,8 +250,15 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
 {
   auto& dev = ctx.GetDevice();
 
-  auto reader = DataReader(DataReader::Desc{});
-  auto data   = reader.ReadModel(file, {});
+  // Assets already decoded for a previous model are taken from the
+  // cache instead of being read again, images decoded in a previous run
+  // from the disk cache.
+  auto reader = DataReader(DataReader::Desc{
+    .uriFilterByKind = assetCache->GetUriFilter(),
+    .imageCache      = imageCache});
+  auto data = reader.ReadModel(
+    file, {.generateMips = true, .compressImages = true});
+  assetCache->Resolve(data);
 
   f32 scale = 40.0;
 
@@ -252,17 +267,34 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
 
   // Load textures
   for(const auto& image: data.images) {
-    auto tex = std::make_unique<Image>(
-      dev, Image::Desc{
-             .name        = image.uri ? *image.uri : "gltf texture",
-             .usage       = ResourceUsage::ShaderResource,
-             .format      = image.format,
-             .dimension   = Dimension::e2D,
-             .extent      = {image.size[0], image.size[1], 1u},
-             .defaultView = ViewType::SRV});
-
-    ctx.Write(*tex, image.texels);
-    model.textures.push_back(std::move(tex));
+    // Images left undecoded go straight into the staging memory, only
+    // their first level.
+    const bool isDecoded = !image.texels.empty() || !image.uri;
+
+    const u32 layers = image.layers;
+
+    const Image::Desc desc{
+      .name        = image.uri ? *image.uri : "gltf texture",
+      .usage       = ResourceUsage::ShaderResource,
+      .format      = image.format,
+      .dimension   = Dimension::e2D,
+      .extent      = {image.size[0], image.size[1], layers},
+      .defaultView = ViewType::SRV,
+      .mips        = isDecoded ? image.mips : 1u};
+
+    // Identical textures, shared between models or within one, end up
+    // as a single image.
+    if(!isDecoded) {
+      const fs::path path = *image.uri;
+      model.textures.push_back(&registry->GetImage(
+        ctx, desc, *image.uri, [&](Span<u8> dst, u64 rowPitch) {
+          reader.ReadImageInto(
+            path, {}, DataReader::ImageTarget{dst, rowPitch});
+        }));
+    } else {
+      model.textures.push_back(
+        &registry->GetImage(ctx, desc, image.texels));
+    }
   }
 
   // Create materials upfront
@@ -284,12 +316,18 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
       material->data.nrmIdx    = -1;
       material->data.colIdx    = -1;
       material->data.mrIdx     = -1;
+      material->data.nrmXY     = 0;
 
       if(mat.normalTexture) {
         const auto idx = mat.normalTexture->textureIndex;
         if(idx < model.textures.size()) {
+          const auto& texture = *model.textures[idx];
           material->data.nrmIdx =
-            model.textures[idx]->GetView(ViewType::SRV)->binding.index;
+            texture.GetView(ViewType::SRV)->binding.index;
+          // Normal maps block compressed at import are BC5, images
+          // that were not compressed still have Z.
+          material->data.nrmXY =
+            texture.GetDesc().format == Format::BC5_UNORM;
         }
       }
 
@@ -366,15 +404,14 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
 
           if(vertices.empty()) continue;
 
-          primitive.vbPos = std::make_unique<Buffer>(
-            dev, Buffer::Desc{
-                   .name        = "Mesh vertices",
-                   .usage       = ResourceUsage::ShaderResource,
-                   .size        = vertices.size() * sizeof(Float4),
-                   .defaultView = ViewType::SRV,
-                   .memoryType  = MemoryType::Main});
-
-          ctx.Write(*primitive.vbPos, vertices);
+          primitive.vbPos = &registry->GetBuffer(
+            ctx,
+            Buffer::Desc{
+              .name        = "Mesh vertices",
+              .usage       = ResourceUsage::ShaderResource,
+              .defaultView = ViewType::SRV,
+              .memoryType  = MemoryType::Main},
+            vertices);
           primitive.param->data.vbPosIdx = static_cast<i32>(
             primitive.vbPos->GetView(ViewType::SRV)->binding.index);
 
@@ -393,14 +430,13 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
               indices.push_back(indexData[i]);
             }
 
-            primitive.indices = std::make_unique<Buffer>(
-              dev, Buffer::Desc{
-                     .name       = "Model indices",
-                     .usage      = ResourceUsage::IndexBuffer,
-                     .size       = indices.size() * sizeof(u16),
-                     .memoryType = MemoryType::Main});
-
-            ctx.Write(*primitive.indices, indices);
+            primitive.indices = &registry->GetBuffer(
+              ctx,
+              Buffer::Desc{
+                .name       = "Model indices",
+                .usage      = ResourceUsage::IndexBuffer,
+                .memoryType = MemoryType::Main},
+              indices);
             primitive.count = indices.size();
           } else {
             primitive.count = vertices.size();
@@ -408,9 +444,6 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
         }
 
         if(attr.type == VertexAttribute::TexCoord) {
-          Arr<u32>
-            uv0; // Changed from Float2 to u32 since we'll pack two half floats into one u32
-
           const auto& acc    = data.accessors[attr.accessorIndex];
           const auto& view   = data.bufferViews[acc.bufferViewIndex];
           const auto& buffer = data.buffers[view.bufferIndex];
@@ -419,29 +452,20 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
           const f32* texCoords = reinterpret_cast<const f32*>(
             buffer.data.data() + view.offset + acc.offset);
 
-          for(u32 i = 0; i < acc.count; i++) {
-            f32 u = texCoords[i * 2];
-            f32 v = texCoords[i * 2 + 1];
+          // Pack each coordinate as two half floats in a single u32
+          Arr<u32> uv0(acc.count);
+          convertFloat32ToFloat16(
+            {reinterpret_cast<u16*>(uv0.data()), uv0.size() * 2u},
+            {texCoords, uv0.size() * 2u});
 
-            // Pack two f32s into half floats in a single u32
-            u16 uHalf  = mt::Float32ToFloat16(u);
-            u16 vHalf  = mt::Float32ToFloat16(v);
-            u32 packed = (u32)uHalf | ((u32)vHalf << 16);
-
-            uv0.push_back(packed);
-          }
-
-          primitive.vbUV0 = std::make_unique<Buffer>(
-            dev,
+          primitive.vbUV0 = &registry->GetBuffer(
+            ctx,
             Buffer::Desc{
-              .name  = "Mesh texture coordinates",
-              .usage = ResourceUsage::ShaderResource,
-              .size  = uv0.size() *
-                      sizeof(u32), // Size is now u32 instead of Float2
+              .name        = "Mesh texture coordinates",
+              .usage       = ResourceUsage::ShaderResource,
               .defaultView = ViewType::SRV,
-              .memoryType  = MemoryType::Main});
-
-          ctx.Write(*primitive.vbUV0, uv0);
+              .memoryType  = MemoryType::Main},
+            uv0);
           primitive.param->data.vbUV0Idx = static_cast<i32>(
             primitive.vbUV0->GetView(ViewType::SRV)->binding.index);
         }
@@ -471,15 +495,14 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
             normals.push_back(packed);
           }
 
-          primitive.vbNrm = std::make_unique<Buffer>(
-            dev, Buffer::Desc{
-                   .name        = "Mesh normals",
-                   .usage       = ResourceUsage::ShaderResource,
-                   .size        = normals.size() * sizeof(u32),
-                   .defaultView = ViewType::SRV,
-                   .memoryType  = MemoryType::Main});
-
-          ctx.Write(*primitive.vbNrm, normals);
+          primitive.vbNrm = &registry->GetBuffer(
+            ctx,
+            Buffer::Desc{
+              .name        = "Mesh normals",
+              .usage       = ResourceUsage::ShaderResource,
+              .defaultView = ViewType::SRV,
+              .memoryType  = MemoryType::Main},
+            normals);
           primitive.param->data.vbNrmIdx = static_cast<i32>(
             primitive.vbNrm->GetView(ViewType::SRV)->binding.index);
         }
@@ -509,15 +532,14 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
             tangents.push_back(packed);
           }
 
-          primitive.vbTan = std::make_unique<Buffer>(
-            dev, Buffer::Desc{
-                   .name        = "Mesh tangents",
-                   .usage       = ResourceUsage::ShaderResource,
-                   .size        = tangents.size() * sizeof(u32),
-                   .defaultView = ViewType::SRV,
-                   .memoryType  = MemoryType::Main});
-
-          ctx.Write(*primitive.vbTan, tangents);
+          primitive.vbTan = &registry->GetBuffer(
+            ctx,
+            Buffer::Desc{
+              .name        = "Mesh tangents",
+              .usage       = ResourceUsage::ShaderResource,
+              .defaultView = ViewType::SRV,
+              .memoryType  = MemoryType::Main},
+            tangents);
           primitive.param->data.vbTanIdx = static_cast<i32>(
             primitive.vbTan->GetView(ViewType::SRV)->binding.index);
         }
@@ -531,6 +553,11 @@ void Scene::loadGltfModel(RenderContext& ctx, const Str& file)
   }
 
   models.push_back(std::move(model));
+
+  const auto& stats = registry->GetStats();
+  VDLogI(
+    "Shared resources: %llu images, %llu buffers, %llu bytes saved",
+    stats.imageHits, stats.bufferHits, stats.bytesSaved);
 }
 
 void Scene::loadCubeModel(RenderContext& ctx)
@@ -556,6 +583,7 @@ void Scene::loadCubeModel(RenderContext& ctx)
     .mrIdx     = -1,
     .metallic  = 0.f,
     .roughness = 0.f,
+    .nrmXY     = 0,
   };
   material->Update();
   model.materials.push_back(std::move(material));
@@ -586,15 +614,14 @@ void Scene::loadCubeModel(RenderContext& ctx)
     {1.0f, -1.0f, 1.0f, .0f},   {1.0f, 1.0f, 1.0f, .0f},
   };
 
-  primitive.vbPos = std::make_unique<Buffer>(
-    dev, Buffer::Desc{
-           .name        = "Cube vertices",
-           .usage       = ResourceUsage::ShaderResource,
-           .size        = sizeof(vertices),
-           .defaultView = ViewType::SRV,
-           .memoryType  = MemoryType::Main});
-
-  ctx.Write(*primitive.vbPos, vertices);
+  primitive.vbPos = &registry->GetBuffer(
+    ctx,
+    Buffer::Desc{
+      .name        = "Cube vertices",
+      .usage       = ResourceUsage::ShaderResource,
+      .defaultView = ViewType::SRV,
+      .memoryType  = MemoryType::Main},
+    vertices);
 
   primitive.param = std::make_unique<UniformBuffer<PrimParam>>(
     dev, Buffer::Desc{
@@ -622,6 +649,49 @@ void Scene::loadCubeModel(RenderContext& ctx)
   models.push_back(std::move(model));
 }
 
+void Scene::loadEnvironment(RenderContext& ctx, const Str& file)
+{
+  // Baking takes a while, later runs read the cooked results.
+  IblBaker   baker;
+  const auto ibl = baker.Bake(file, file + ".ibl", {});
+
+  using Entry = std::tuple<const data::Image*, const char*, Dimension>;
+
+  const Entry images[] = {
+    {&ibl.irradiance, "Irradiance", Dimension::eCube},
+    {&ibl.specular, "Specular", Dimension::eCube},
+    {&ibl.brdf, "BRDF", Dimension::e2D}};
+
+  environment.clear();
+  for(const auto& [image, name, dimension]: images) {
+    environment.push_back(&registry->GetImage(
+      ctx,
+      Image::Desc{
+        .name        = formatString("%s %s", name, file.c_str()),
+        .usage       = ResourceUsage::ShaderResource,
+        .format      = image->format,
+        .dimension   = dimension,
+        .extent      = {image->size[0], image->size[1], image->layers},
+        .defaultView = ViewType::SRV,
+        .mips        = image->mips},
+      image->texels));
+  }
+
+  const auto getIndex = [&](u32 idx) {
+    return static_cast<i32>(
+      environment[idx]->GetView(ViewType::SRV)->binding.index);
+  };
+
+  for(auto& frame: frames) {
+    frame.scene->data.iblIrradianceIdx = getIndex(0u);
+    frame.scene->data.iblSpecularIdx   = getIndex(1u);
+    frame.scene->data.iblBrdfIdx       = getIndex(2u);
+    frame.scene->data.iblSpecularMips =
+      static_cast<f32>(ibl.specular.mips);
+    frame.scene->Update();
+  }
+}
+
 void Scene::render(
   RenderContext& ctx, const Viewport& viewport, const Rect& renderArea)
 {
@@ -663,6 +733,8 @@ void Scene::render(
   }
   cmd.AddBarrier(*frame.depthStencil, ResourceState::DepthStencilRW);
   cmd.AddBarrier(backbuffer, ResourceState::RenderTarget);
+  for(auto* image: environment)
+    cmd.AddBarrier(*image, ResourceState::ShaderResourceGraphics);
 
   cmd.FlushBarriers();
 
@@ -51,6 +51,12 @@ struct SceneParam {
   Float3 directionalLightColor;
   i32    _pad4;
   float  directionalLightIntensity;
+
+  // Image based lighting, -1 until an environment is loaded
+  i32 iblIrradianceIdx;
+  i32 iblSpecularIdx;
+  i32 iblBrdfIdx;
+  f32 iblSpecularMips;
 };
 
 // Per-object parameters
@@ -72,16 +78,18 @@ struct MaterialParam {
 
   f32 metallic;
   f32 roughness;
+
+  i32 nrmXY; // The normal map only stores X and Y
 };
 
 struct Prim {
   u32 count; // Vertex or index count
 
-  UPtr<Buffer> indices;
-  UPtr<Buffer> vbPos;
-  UPtr<Buffer> vbNrm;
-  UPtr<Buffer> vbTan;
-  UPtr<Buffer> vbUV0;
+  Buffer* indices = nullptr;
+  Buffer* vbPos   = nullptr;
+  Buffer* vbNrm   = nullptr;
+  Buffer* vbTan   = nullptr;
+  Buffer* vbUV0   = nullptr;
 
   UPtr<UniformBuffer<PrimParam>> param;
 };
@@ -92,7 +100,7 @@ struct Mesh {
 
 struct Model {
   Arr<Mesh>                               meshes;
-  Arr<UPtr<Image>>                        textures;
+  Arr<Image*>                             textures;
   Arr<UPtr<UniformBuffer<MaterialParam>>> materials;
 };
 
@@ -136,6 +144,10 @@ class Scene
   void loadGltfModel(RenderContext& ctx, const Str& file);
   void loadCubeModel(RenderContext& ctx);
 
+  // Environment loading, HDR maps are prefiltered for image based
+  // lighting and the results are cooked next to the file.
+  void loadEnvironment(RenderContext& ctx, const Str& file);
+
   // Rendering
   void render(
     RenderContext& ctx, const Viewport& viewport,
@@ -146,9 +158,13 @@ class Scene
 
 protected:
   // Scene resources
-  Arr<UPtr<Pipeline>> pipelines;
-  Arr<Model>          models; // Changed from meshes to models
-  Arr<FrameResources> frames;
+  UPtr<AssetCache>       assetCache;
+  SPtr<DiskCache>        imageCache;
+  UPtr<ResourceRegistry> registry;
+  Arr<UPtr<Pipeline>>    pipelines;
+  Arr<Model>             models; // Changed from meshes to models
+  Arr<Image*>            environment;
+  Arr<FrameResources>    frames;
 };
 
 } // namespace vd
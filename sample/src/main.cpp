@@ -56,7 +56,7 @@ int main()
       renderArea.extent = sc.GetExtent();
     };
 
-    // glTF loading.
+    // glTF and environment loading.
     window.OnFileDrop = [&](const Arr<Str>& files) {
       for(const auto& file: files) {
         if(file.ends_with(".gltf")) {
@@ -64,6 +64,11 @@ int main()
           scene.loadGltfModel(ctx, file);
           break;
         }
+        if(file.ends_with(".hdr")) {
+          dev.WaitIdle();
+          scene.loadEnvironment(ctx, file);
+          break;
+        }
       }
     };
 
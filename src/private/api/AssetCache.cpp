@@ -0,0 +1,219 @@
+#include "vuldir/AssetCache.hpp"
+
+using namespace vd;
+
+// Embedded assets are part of the model, there is nothing to share.
+static bool IsCacheable(Strv uri) { return !uri.starts_with("data:"); }
+
+static bool IsCacheable(const Opt<Str>& uri)
+{
+  return uri && IsCacheable(Strv(*uri));
+}
+
+AssetCache::AssetCache(const Desc& desc):
+  m_mutex{},
+  m_budget{desc.budget},
+  m_stats{},
+  m_entries{},
+  m_index{},
+  m_pending{}
+{}
+
+DataReader::UriFilterByKind AssetCache::GetUriFilter()
+{
+  return [this](Strv uri, AssetKind kind) {
+    if(!IsCacheable(uri)) return true;
+
+    std::scoped_lock lock{m_mutex};
+
+    auto* entry = find(kind, uri);
+    if(!entry) {
+      m_stats.misses += 1u;
+      return true;
+    }
+
+    m_stats.hits += 1u;
+    getPending(kind).insert_or_assign(Str(uri), *entry);
+    return false;
+  };
+}
+
+void AssetCache::Resolve(data::Model& model)
+{
+  std::scoped_lock lock{m_mutex};
+
+  auto lookup = [&](AssetKind kind, const Str& uri) -> Entry* {
+    auto& pending = getPending(kind);
+    if(auto it = pending.find(uri); it != pending.end())
+      return &it->second;
+    return find(kind, uri);
+  };
+
+  for(auto& image: model.images) {
+    if(!IsCacheable(image.uri)) continue;
+
+    if(image.texels.empty()) {
+      auto* entry = lookup(AssetKind::Image, *image.uri);
+      if(entry && entry->image) image = *entry->image;
+    } else {
+      insert(
+        {.kind   = AssetKind::Image,
+         .uri    = *image.uri,
+         .image  = std::make_shared<const data::Image>(image),
+         .buffer = nullptr,
+         .size   = image.texels.size()});
+    }
+  }
+
+  for(auto& buffer: model.buffers) {
+    if(!IsCacheable(buffer.uri)) continue;
+
+    if(buffer.data.empty()) {
+      auto* entry = lookup(AssetKind::Buffer, *buffer.uri);
+      if(entry && entry->buffer) buffer = *entry->buffer;
+    } else {
+      insert(
+        {.kind   = AssetKind::Buffer,
+         .uri    = *buffer.uri,
+         .image  = nullptr,
+         .buffer = std::make_shared<const data::Buffer>(buffer),
+         .size   = buffer.data.size()});
+    }
+  }
+
+  for(auto& pending: m_pending) pending.clear();
+  evict(m_budget);
+}
+
+SPtr<const data::Image> AssetCache::FindImage(Strv uri)
+{
+  std::scoped_lock lock{m_mutex};
+
+  auto* entry = find(AssetKind::Image, uri);
+  if(!entry) {
+    m_stats.misses += 1u;
+    return nullptr;
+  }
+
+  m_stats.hits += 1u;
+  return entry->image;
+}
+
+SPtr<const data::Buffer> AssetCache::FindBuffer(Strv uri)
+{
+  std::scoped_lock lock{m_mutex};
+
+  auto* entry = find(AssetKind::Buffer, uri);
+  if(!entry) {
+    m_stats.misses += 1u;
+    return nullptr;
+  }
+
+  m_stats.hits += 1u;
+  return entry->buffer;
+}
+
+SPtr<const data::Image> AssetCache::AddImage(data::Image image)
+{
+  std::scoped_lock lock{m_mutex};
+
+  const u64 size = image.texels.size();
+  auto asset = std::make_shared<const data::Image>(std::move(image));
+  if(!IsCacheable(asset->uri)) return asset;
+
+  insert(
+    {.kind   = AssetKind::Image,
+     .uri    = *asset->uri,
+     .image  = asset,
+     .buffer = nullptr,
+     .size   = size});
+  evict(m_budget);
+  return asset;
+}
+
+SPtr<const data::Buffer> AssetCache::AddBuffer(data::Buffer buffer)
+{
+  std::scoped_lock lock{m_mutex};
+
+  const u64 size = buffer.data.size();
+  auto asset = std::make_shared<const data::Buffer>(std::move(buffer));
+  if(!IsCacheable(asset->uri)) return asset;
+
+  insert(
+    {.kind   = AssetKind::Buffer,
+     .uri    = *asset->uri,
+     .image  = nullptr,
+     .buffer = asset,
+     .size   = size});
+  evict(m_budget);
+  return asset;
+}
+
+void AssetCache::SetBudget(u64 budget)
+{
+  std::scoped_lock lock{m_mutex};
+
+  m_budget = budget;
+  evict(m_budget);
+}
+
+AssetCache::Stats AssetCache::GetStats() const
+{
+  std::scoped_lock lock{m_mutex};
+
+  auto stats    = m_stats;
+  stats.entries = m_entries.size();
+  return stats;
+}
+
+void AssetCache::Clear()
+{
+  std::scoped_lock lock{m_mutex};
+  evict(0u);
+}
+
+AssetCache::Entry* AssetCache::find(AssetKind kind, Strv uri)
+{
+  auto& index = getIndex(kind);
+
+  auto it = index.find(Str(uri));
+  if(it == index.end()) return nullptr;
+
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  return &m_entries.front();
+}
+
+AssetCache::Entry& AssetCache::insert(Entry&& entry)
+{
+  auto& index = getIndex(entry.kind);
+
+  if(auto it = index.find(entry.uri); it != index.end()) {
+    m_stats.size -= it->second->size;
+    m_entries.erase(it->second);
+    index.erase(it);
+  }
+
+  m_stats.size += entry.size;
+  m_entries.push_front(std::move(entry));
+  index.emplace(m_entries.front().uri, m_entries.begin());
+  return m_entries.front();
+}
+
+void AssetCache::evict(u64 budget)
+{
+  auto it = m_entries.end();
+  while(m_stats.size > budget && it != m_entries.begin()) {
+    --it;
+
+    // Still used by the caller or waiting for Resolve.
+    const bool isReferenced =
+      (it->image && it->image.use_count() > 1) ||
+      (it->buffer && it->buffer.use_count() > 1);
+    if(isReferenced) continue;
+
+    m_stats.size      -= it->size;
+    m_stats.evictions += 1u;
+    getIndex(it->kind).erase(it->uri);
+    it = m_entries.erase(it);
+  }
+}
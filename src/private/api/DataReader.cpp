@@ -1,9 +1,17 @@
 #include "vuldir/DataReader.hpp"
 
+#include "vuldir/DiskCache.hpp"
+
 using namespace vd;
 
-DataReader::DataReader(const Desc& desc)
+DataReader::DataReader(const Desc& desc):
+  m_uriFilter{desc.uriFilterByKind}, m_imageCache{desc.imageCache}
 {
+  if(!m_uriFilter && desc.uriFilter)
+    m_uriFilter = [filter = desc.uriFilter](Strv uri, AssetKind) {
+      return filter(uri);
+    };
+
   if(desc.fileReader) m_fileReader = desc.fileReader;
   else
     m_fileReader = [](const fs::path& path, const fs::path* basePath) {
@@ -13,12 +21,272 @@ DataReader::DataReader(const Desc& desc)
     };
 }
 
+// Largest mips of a file chain that go over the maximum dimension.
+static u32 GetSkippedMips(const data::Image& image, u32 maxDimension)
+{
+  if(maxDimension == 0u) return 0u;
+
+  u32 skip = 0u;
+  while(
+    skip + 1u < image.mips &&
+    std::max(
+      getMipExtent(image.size[0], skip),
+      getMipExtent(image.size[1], skip)) > maxDimension)
+    ++skip;
+  return skip;
+}
+
+// The size fitting the maximum dimension, keeping the aspect ratio.
+static UInt2 GetFittedSize(UInt2 size, u32 maxDimension)
+{
+  const u32 largest = std::max(size[0], size[1]);
+  if(maxDimension == 0u || largest <= maxDimension) return size;
+
+  const auto fit = [&](u32 extent) {
+    return std::max(
+      toU32(
+        (toU64(extent) * maxDimension + largest / 2u) / toU64(largest)),
+      1u);
+  };
+  return {fit(size[0]), fit(size[1])};
+}
+
+// Plain texels of a single level are resampled, file chains lose their
+// largest mips.
+static bool CanResize(const data::Image& image)
+{
+  return image.mips == 1u && !isBlockFormat(image.format);
+}
+
+// Cached images start with a header, the texels follow it. The
+// version goes up whenever decoding changes its results.
+struct ImageCacheHeader {
+  u32 magic;
+  u32 version;
+  u32 format;
+  u32 size[2];
+  u32 mips;
+  u32 layers;
+  u32 reserved;
+  u64 texelSize;
+};
+
+static constexpr u32 ImageCacheMagic   = fourCC("VDIC");
+static constexpr u32 ImageCacheVersion = 2u;
+
+// The source bytes and the options that change the texels, the uri
+// and the threads used don't. Verified reads get their own entries, so
+// that a corrupt source is reported instead of served decoded.
+static Hash128 GetImageCacheKey(
+  Span<u8 const> src, const DataReader::ImageOptions& options)
+{
+  const auto hash = xxh128(src);
+
+  const u32 values[] = {
+    ImageCacheVersion,
+    options.alphaPadding,
+    options.maxDimension,
+    options.generateMips,
+    options.srgb,
+    static_cast<u32>(options.blockFormat),
+    options.verifyChecksums};
+
+  ByteOStream key;
+  key.Write(getBytes(hash.lo));
+  key.Write(getBytes(hash.hi));
+  key.Write(getBytes(values));
+  return xxh128(key.data());
+}
+
+// ReadImageInto leaves the texels as decoded, so it shares the entries
+// of ReadImage without resizing, mips or compression.
+static DataReader::ImageOptions
+GetDecodeOptions(const DataReader::ImageOptions& options)
+{
+  auto ret         = options;
+  ret.maxDimension = 0u;
+  ret.generateMips = false;
+  ret.srgb         = false;
+  ret.blockFormat  = Format::UNDEFINED;
+  return ret;
+}
+
+// The image without texels, empty when the entry is not valid. The
+// texels follow the header.
+static Opt<data::Image> ReadCachedImage(Span<u8 const> src)
+{
+  ImageCacheHeader header;
+  if(src.size() < sizeof(header)) return std::nullopt;
+  memcpy(&header, src.data(), sizeof(header));
+
+  data::Image image;
+  image.format = static_cast<Format>(header.format);
+  image.size   = {header.size[0], header.size[1]};
+  image.mips   = header.mips;
+  image.layers = header.layers;
+
+  const bool isValid =
+    header.magic == ImageCacheMagic &&
+    header.version == ImageCacheVersion && header.mips > 0u &&
+    header.layers > 0u &&
+    header.texelSize == src.size() - sizeof(header) &&
+    header.texelSize == getImageSize(image);
+  if(!isValid) return std::nullopt;
+
+  return image;
+}
+
+static void WriteCachedImage(
+  std::ostream& dst, const data::Image& image, Span<u8 const> texels)
+{
+  const ImageCacheHeader header{
+    .magic     = ImageCacheMagic,
+    .version   = ImageCacheVersion,
+    .format    = static_cast<u32>(image.format),
+    .size      = {image.size[0], image.size[1]},
+    .mips      = image.mips,
+    .layers    = image.layers,
+    .reserved  = 0u,
+    .texelSize = texels.size()};
+
+  dst.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  dst.write(
+    reinterpret_cast<const char*>(texels.data()),
+    static_cast<std::streamsize>(texels.size()));
+}
+
+static std::ifstream OpenImageFile(const fs::path& path)
+{
+  std::ifstream src(path, std::ios::binary);
+  if(!src)
+    throw makeError<std::runtime_error>(
+      "DataReader: cannot access file %s", path.u8string().c_str());
+  return src;
+}
+
 data::Image
 DataReader::ReadImage(std::istream& src, const ImageOptions& options)
 {
-  if(isPng(src)) return readPng(src, options);
+  if(!m_imageCache) return decodeImage(src, options);
 
-  throw std::runtime_error("DataReader: Unsupported image format");
+  // The whole file is needed for the key, it is then decoded from
+  // memory on a miss.
+  const auto bytes = streamReadBytes(src);
+  const auto key   = GetImageCacheKey(bytes, options);
+
+  {
+    // The image owns its texels, so a hit still copies them out of
+    // the mapping. Only the decoding is saved.
+    const auto file = m_imageCache->Find(key);
+    if(auto image = ReadCachedImage(file.GetData())) {
+      image->uri = options.uri;
+      image->texels.assign(
+        file.GetData().begin() + sizeof(ImageCacheHeader),
+        file.GetData().end());
+      return std::move(*image);
+    }
+  }
+
+  IMemoryStream stream(bytes);
+  auto          image = decodeImage(stream, options);
+
+  m_imageCache->Add(key, [&](std::ostream& dst) {
+    WriteCachedImage(dst, image, image.texels);
+  });
+
+  return image;
+}
+
+data::Image
+DataReader::decodeImage(std::istream& src, const ImageOptions& options)
+{
+  Arr<u8> texels;
+
+  // Mips are generated for a single level of plain texels.
+  const auto canGenerateMips = [&options](const data::Image& image) {
+    return options.generateMips && image.mips == 1u &&
+           !isBlockFormat(image.format);
+  };
+
+  UInt2 fittedSize = {};
+  u32   skipMips   = 0u;
+  bool  isResized  = false;
+
+  // The whole chain is allocated upfront, level 0 is decoded in place.
+  // Images scaled down are decoded whole first.
+  auto image = decodeImageInto(
+    src, options, [&](const data::Image& info) {
+      auto chain = info;
+
+      skipMips   = GetSkippedMips(info, options.maxDimension);
+      fittedSize = GetFittedSize(info.size, options.maxDimension);
+      isResized  = CanResize(info) && (fittedSize[0] != info.size[0] ||
+                                      fittedSize[1] != info.size[1]);
+
+      if(skipMips > 0u) {
+        chain.size = {
+          getMipExtent(info.size[0], skipMips),
+          getMipExtent(info.size[1], skipMips)};
+        chain.mips -= skipMips;
+
+        texels.resize(getImageSize(chain));
+        return ImageTarget{
+          .texels = texels, .rowPitch = 0u, .skipMips = skipMips};
+      }
+
+      if(canGenerateMips(info) && !isResized)
+        chain.mips = getMipCount(info.size[0], info.size[1]);
+
+      texels.resize(getImageSize(chain));
+      return ImageTarget{
+        .texels   = Span<u8>(texels.data(), getImageSize(info)),
+        .rowPitch = 0u};
+    });
+
+  image.texels = std::move(texels);
+
+  if(skipMips > 0u) {
+    image.size = {
+      getMipExtent(image.size[0], skipMips),
+      getMipExtent(image.size[1], skipMips)};
+    image.mips -= skipMips;
+  }
+
+  if(isResized) resizeImage(image, fittedSize, options.srgb);
+  if(canGenerateMips(image)) generateMips(image, options.srgb);
+  if(options.blockFormat != Format::UNDEFINED)
+    compressImage(
+      image, options.blockFormat, options.srgb, options.threadCount);
+
+  return image;
+}
+
+u64 DataReader::GetImportSize(
+  const data::Image& header, const ImageOptions& options)
+{
+  auto image = header;
+
+  if(const u32 skip = GetSkippedMips(header, options.maxDimension)) {
+    image.size = {
+      getMipExtent(header.size[0], skip),
+      getMipExtent(header.size[1], skip)};
+    image.mips -= skip;
+  } else if(CanResize(header)) {
+    image.size = GetFittedSize(header.size, options.maxDimension);
+  }
+
+  const bool isPlain = !isBlockFormat(image.format);
+  if(options.generateMips && image.mips == 1u && isPlain)
+    image.mips = getMipCount(image.size[0], image.size[1]);
+
+  // Single channel images always go to BC4, see compressImage.
+  if(options.blockFormat != Format::UNDEFINED && isPlain) {
+    const bool isSingle = image.format == Format::R8_UNORM ||
+                          image.format == Format::R16_UNORM;
+    image.format = isSingle ? Format::BC4_UNORM : options.blockFormat;
+  }
+
+  return getImageSize(image);
 }
 
 data::Image
@@ -27,11 +295,7 @@ DataReader::ReadImage(const fs::path& path, const ImageOptions& options)
   auto fsOpt = options;
   if(fsOpt.uri.empty()) fsOpt.uri = pathToStr(path);
 
-  std::ifstream src(path, std::ios::binary);
-  if(!src)
-    throw makeError<std::runtime_error>(
-      "DataReader: cannot access file %s", path.u8string().c_str());
-
+  auto src = OpenImageFile(path);
   return ReadImage(src, fsOpt);
 }
 
@@ -42,6 +306,192 @@ DataReader::ReadImage(Span<u8 const> src, const ImageOptions& options)
   return ReadImage(stream, options);
 }
 
+data::Image DataReader::ReadImageInto(
+  std::istream& src, const ImageOptions& options,
+  const ImageTargetQuery& query)
+{
+  if(!m_imageCache) return decodeImageInto(src, options, query);
+
+  const auto bytes = streamReadBytes(src);
+  const auto key   = GetImageCacheKey(bytes, GetDecodeOptions(options));
+
+  {
+    const auto file = m_imageCache->Find(key);
+    if(auto image = ReadCachedImage(file.GetData())) {
+      image->uri = options.uri;
+
+      const auto target = query(*image);
+      if(!std::empty(target.texels))
+        copyToTarget(
+          *image, file.GetData().subspan(sizeof(ImageCacheHeader)),
+          target);
+      return std::move(*image);
+    }
+  }
+
+  // Decoded to the caller memory as usual. Only a whole image, tightly
+  // packed, can be cached from there.
+  ImageTarget   target;
+  IMemoryStream stream(bytes);
+  auto          image = decodeImageInto(
+    stream, options, [&](const data::Image& info) {
+      target = query(info);
+      return target;
+    });
+
+  const u64  size     = getImageSize(image);
+  const u64  rowSize  = getFormatRowSize(image.format, image.size[0]);
+  const bool isPacked =
+    target.rowPitch == 0u || target.rowPitch == rowSize;
+  const bool isWhole = target.skipMips == 0u && isPacked &&
+                       std::size(target.texels) >= size;
+  if(isWhole)
+    m_imageCache->Add(key, [&](std::ostream& dst) {
+      WriteCachedImage(dst, image, target.texels.first(size));
+    });
+
+  return image;
+}
+
+data::Image DataReader::ReadImageInto(
+  Span<u8 const> src, const ImageOptions& options,
+  const ImageTargetQuery& query)
+{
+  IMemoryStream stream(src);
+  return ReadImageInto(stream, options, query);
+}
+
+data::Image DataReader::ReadImageInto(
+  const fs::path& path, const ImageOptions& options,
+  const ImageTargetQuery& query)
+{
+  auto fsOpt = options;
+  if(fsOpt.uri.empty()) fsOpt.uri = pathToStr(path);
+
+  auto src = OpenImageFile(path);
+  return ReadImageInto(src, fsOpt, query);
+}
+
+// Reading the header alone doesn't go through the cache, it would
+// have to hash the whole file.
+data::Image DataReader::ReadImageInto(
+  std::istream& src, const ImageOptions& options,
+  const ImageTarget& target)
+{
+  const auto query = [&target](const data::Image&) { return target; };
+  if(std::empty(target.texels))
+    return decodeImageInto(src, options, query);
+  return ReadImageInto(src, options, query);
+}
+
+data::Image DataReader::ReadImageInto(
+  Span<u8 const> src, const ImageOptions& options,
+  const ImageTarget& target)
+{
+  IMemoryStream stream(src);
+  return ReadImageInto(stream, options, target);
+}
+
+data::Image DataReader::ReadImageInto(
+  const fs::path& path, const ImageOptions& options,
+  const ImageTarget& target)
+{
+  auto fsOpt = options;
+  if(fsOpt.uri.empty()) fsOpt.uri = pathToStr(path);
+
+  auto src = OpenImageFile(path);
+  return ReadImageInto(src, fsOpt, target);
+}
+
+data::Image DataReader::decodeImageInto(
+  std::istream& src, const ImageOptions& options,
+  const ImageTargetQuery& query)
+{
+  if(isPng(src)) return readPng(src, options, query);
+  if(isJpeg(src)) return readJpeg(src, options, query);
+  if(isDds(src)) return readDds(src, options, query);
+  if(isKtx2(src)) return readKtx2(src, options, query);
+  if(isHdr(src)) return readHdr(src, options, query);
+
+  throw std::runtime_error("DataReader: Unsupported image format");
+}
+
+void DataReader::copyToTarget(
+  const data::Image& image, Span<u8 const> texels,
+  const ImageTarget& target)
+{
+  const auto levels = getLevelTargets(image, target);
+
+  for(u32 layer = 0u; layer < image.layers; ++layer) {
+    for(u32 mip = 0u; mip < image.mips; ++mip) {
+      const auto& level = levels[layer * image.mips + mip];
+      if(std::empty(level.texels)) continue;
+
+      const u32 width    = getMipExtent(image.size[0], mip);
+      const u32 height   = getMipExtent(image.size[1], mip);
+      const u64 rowSize  = getFormatRowSize(image.format, width);
+      const u32 rowCount = getFormatRowCount(image.format, height);
+      const u64 rowPitch = level.rowPitch ? level.rowPitch : rowSize;
+
+      const u8* src = texels.data() + getMipOffset(image, mip, layer);
+      for(u32 row = 0u; row < rowCount; ++row)
+        memcpy(
+          level.texels.data() + row * rowPitch, src + row * rowSize,
+          rowSize);
+    }
+  }
+}
+
+Arr<DataReader::ImageTarget> DataReader::getLevelTargets(
+  const data::Image& image, const ImageTarget& target)
+{
+  Arr<ImageTarget> ret(toU64(image.layers) * image.mips);
+
+  // The chain left once the largest mips are skipped.
+  if(target.skipMips > 0u) {
+    auto rest = image;
+    rest.size = {
+      getMipExtent(image.size[0], target.skipMips),
+      getMipExtent(image.size[1], target.skipMips)};
+    rest.mips = image.mips - target.skipMips;
+
+    if(target.skipMips >= image.mips || target.rowPitch != 0u)
+      throw std::runtime_error("DataReader: bad mips to skip");
+    if(std::size(target.texels) < getImageSize(rest))
+      throw std::runtime_error(
+        "DataReader: target memory is too small");
+
+    for(u32 layer = 0u; layer < image.layers; ++layer)
+      for(u32 mip = 0u; mip < rest.mips; ++mip)
+        ret[layer * image.mips + target.skipMips + mip].texels =
+          target.texels.subspan(
+            getMipOffset(rest, mip, layer), getMipSize(rest, mip));
+    return ret;
+  }
+
+  const u64 rowSize  = getFormatRowSize(image.format, image.size[0]);
+  const u32 rowCount = getFormatRowCount(image.format, image.size[1]);
+
+  if(
+    std::size(target.texels) >= getImageSize(image) &&
+    (target.rowPitch == 0u || target.rowPitch == rowSize)) {
+    for(u32 layer = 0u; layer < image.layers; ++layer)
+      for(u32 mip = 0u; mip < image.mips; ++mip)
+        ret[layer * image.mips + mip].texels = target.texels.subspan(
+          getMipOffset(image, mip, layer), getMipSize(image, mip));
+    return ret;
+  }
+
+  const u64 rowPitch = target.rowPitch ? target.rowPitch : rowSize;
+  if(
+    rowPitch < rowSize ||
+    std::size(target.texels) < rowPitch * (rowCount - 1u) + rowSize)
+    throw std::runtime_error("DataReader: target memory is too small");
+
+  ret[0] = {.texels = target.texels, .rowPitch = rowPitch};
+  return ret;
+}
+
 data::Model
 DataReader::ReadModel(std::istream& src, const ModelOptions& options)
 {
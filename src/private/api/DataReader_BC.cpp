@@ -0,0 +1,674 @@
+#include "vuldir/DataReader.hpp"
+
+using namespace vd;
+
+// Block compression of decoded images. Every 4x4 block is fitted along
+// the principal axis of its texels, then the endpoints are refined once
+// with a least squares fit of the picked indices. Blocks on the border
+// of images that are not a multiple of 4 repeat the last texels.
+
+struct BcBlock {
+  // One array per channel, in RGBA order.
+  alignas(16) f32 texels[4][16];
+};
+
+// Picks the closest palette entry for the texels of a block, looking at
+// the first channelCount channels. Returns the summed squared error.
+using BcSearchFn = f32 (*)(
+  u8* indices, const BcBlock& block, const BcBlock& palette,
+  u32 channelCount, u32 paletteSize);
+
+static f32 BcSearch(
+  u8* indices, const BcBlock& block, const BcBlock& palette,
+  u32 channelCount, u32 paletteSize)
+{
+  f32 error = 0.0f;
+
+  for(u32 texel = 0u; texel < 16u; ++texel) {
+    f32 best = std::numeric_limits<f32>::max();
+    for(u32 entry = 0u; entry < paletteSize; ++entry) {
+      f32 dist = 0.0f;
+      for(u32 channel = 0u; channel < channelCount; ++channel) {
+        f32 delta = block.texels[channel][texel] -
+                    palette.texels[channel][entry];
+        dist += delta * delta;
+      }
+      if(dist < best) {
+        best           = dist;
+        indices[texel] = toU8(entry);
+      }
+    }
+    error += best;
+  }
+
+  return error;
+}
+
+#ifdef VD_ARCH_X64
+
+// Four texels at a time.
+static f32 BcSearchSSE2(
+  u8* indices, const BcBlock& block, const BcBlock& palette,
+  u32 channelCount, u32 paletteSize)
+{
+  auto errors = _mm_setzero_ps();
+
+  for(u32 texel = 0u; texel < 16u; texel += 4u) {
+    __m128 values[4];
+    for(u32 channel = 0u; channel < channelCount; ++channel)
+      values[channel] = _mm_load_ps(&block.texels[channel][texel]);
+
+    auto best = _mm_set1_ps(std::numeric_limits<f32>::max());
+    auto picked = _mm_setzero_si128();
+
+    for(u32 entry = 0u; entry < paletteSize; ++entry) {
+      auto dist = _mm_setzero_ps();
+      for(u32 channel = 0u; channel < channelCount; ++channel) {
+        auto delta = _mm_sub_ps(
+          values[channel], _mm_set1_ps(palette.texels[channel][entry]));
+        dist = _mm_add_ps(dist, _mm_mul_ps(delta, delta));
+      }
+
+      auto closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+      best        = _mm_min_ps(dist, best);
+      picked      = _mm_or_si128(
+        _mm_and_si128(closer, _mm_set1_epi32(toI32(entry))),
+        _mm_andnot_si128(closer, picked));
+    }
+
+    alignas(16) i32 lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), picked);
+    for(u32 lane = 0u; lane < 4u; ++lane)
+      indices[texel + lane] = toU8(lanes[lane]);
+
+    errors = _mm_add_ps(errors, best);
+  }
+
+  alignas(16) f32 sums[4];
+  _mm_store_ps(sums, errors);
+  return ((sums[0] + sums[1]) + sums[2]) + sums[3];
+}
+
+#endif
+
+static BcSearchFn GetBcSearch()
+{
+#ifdef VD_ARCH_X64
+  if(getCpuFeatures().sse2) return &BcSearchSSE2;
+#endif
+  return &BcSearch;
+}
+
+// Principal axis of the texels through their mean, by power iteration
+// on the covariance. Texels with a zero weight are ignored.
+static void BcFitAxis(
+  const BcBlock& block, const f32* weights, u32 channelCount,
+  f32* mean, f32* axis)
+{
+  f32 total = 0.0f;
+  for(u32 channel = 0u; channel < channelCount; ++channel)
+    mean[channel] = 0.0f;
+
+  for(u32 texel = 0u; texel < 16u; ++texel) {
+    total += weights[texel];
+    for(u32 channel = 0u; channel < channelCount; ++channel)
+      mean[channel] += weights[texel] * block.texels[channel][texel];
+  }
+
+  for(u32 channel = 0u; channel < channelCount; ++channel)
+    mean[channel] /= std::max(total, 1.0f);
+
+  f32 cov[4][4] = {};
+  for(u32 texel = 0u; texel < 16u; ++texel) {
+    f32 delta[4];
+    for(u32 channel = 0u; channel < channelCount; ++channel)
+      delta[channel] = block.texels[channel][texel] - mean[channel];
+
+    for(u32 row = 0u; row < channelCount; ++row)
+      for(u32 col = 0u; col < channelCount; ++col)
+        cov[row][col] += weights[texel] * delta[row] * delta[col];
+  }
+
+  for(u32 channel = 0u; channel < channelCount; ++channel)
+    axis[channel] = 1.0f;
+
+  for(u32 iteration = 0u; iteration < 8u; ++iteration) {
+    f32 next[4] = {};
+    f32 length  = 0.0f;
+    for(u32 row = 0u; row < channelCount; ++row) {
+      for(u32 col = 0u; col < channelCount; ++col)
+        next[row] += cov[row][col] * axis[col];
+      length = std::max(length, std::abs(next[row]));
+    }
+
+    if(length == 0.0f) break;
+    for(u32 channel = 0u; channel < channelCount; ++channel)
+      axis[channel] = next[channel] / length;
+  }
+}
+
+// Endpoints at the extreme projections of the texels on the axis.
+static void BcFitEndpoints(
+  const BcBlock& block, const f32* weights, u32 channelCount,
+  f32* low, f32* high)
+{
+  f32 mean[4];
+  f32 axis[4];
+  BcFitAxis(block, weights, channelCount, mean, axis);
+
+  f32 length = 0.0f;
+  for(u32 channel = 0u; channel < channelCount; ++channel)
+    length += axis[channel] * axis[channel];
+
+  f32 minDot = 0.0f;
+  f32 maxDot = 0.0f;
+  for(u32 texel = 0u; texel < 16u; ++texel) {
+    if(weights[texel] == 0.0f) continue;
+
+    f32 dot = 0.0f;
+    for(u32 channel = 0u; channel < channelCount; ++channel)
+      dot +=
+        (block.texels[channel][texel] - mean[channel]) * axis[channel];
+
+    minDot = std::min(minDot, dot);
+    maxDot = std::max(maxDot, dot);
+  }
+
+  if(length > 0.0f) {
+    minDot /= length;
+    maxDot /= length;
+  }
+
+  for(u32 channel = 0u; channel < channelCount; ++channel) {
+    low[channel] =
+      std::clamp(mean[channel] + axis[channel] * minDot, 0.0f, 255.0f);
+    high[channel] =
+      std::clamp(mean[channel] + axis[channel] * maxDot, 0.0f, 255.0f);
+  }
+}
+
+// Endpoints that best reproduce the texels with the given palette
+// weights, where a weight of 1 means the first endpoint.
+static bool BcRefineEndpoints(
+  const BcBlock& block, const u8* indices, const f32* paletteWeights,
+  const f32* weights, u32 channelCount, f32* first, f32* second)
+{
+  f32 aa = 0.0f, bb = 0.0f, ab = 0.0f;
+  f32 ax[4] = {}, bx[4] = {};
+
+  for(u32 texel = 0u; texel < 16u; ++texel) {
+    f32 a = paletteWeights[indices[texel]] * weights[texel];
+    f32 b = (1.0f - paletteWeights[indices[texel]]) * weights[texel];
+
+    aa += a * a;
+    bb += b * b;
+    ab += a * b;
+    for(u32 channel = 0u; channel < channelCount; ++channel) {
+      ax[channel] += a * block.texels[channel][texel];
+      bx[channel] += b * block.texels[channel][texel];
+    }
+  }
+
+  f32 det = aa * bb - ab * ab;
+  if(std::abs(det) < 1e-6f) return false;
+
+  for(u32 channel = 0u; channel < channelCount; ++channel) {
+    first[channel] = std::clamp(
+      (bb * ax[channel] - ab * bx[channel]) / det, 0.0f, 255.0f);
+    second[channel] = std::clamp(
+      (aa * bx[channel] - ab * ax[channel]) / det, 0.0f, 255.0f);
+  }
+
+  return true;
+}
+
+static void BcWriteLE(u8* dst, u64 value, u32 size)
+{
+  for(u32 idx = 0u; idx < size; ++idx)
+    dst[idx] = toU8(value >> (8u * idx));
+}
+
+// BC4, one channel in 8 bytes. The first endpoint is the largest, for
+// the mode with 6 interpolated values.
+static void BcEncodeChannel(
+  u8* dst, const BcBlock& src, u32 channel, BcSearchFn search)
+{
+  BcBlock block;
+  std::copy_n(src.texels[channel], 16u, block.texels[0]);
+
+  f32 low  = *std::min_element(block.texels[0], block.texels[0] + 16);
+  f32 high = *std::max_element(block.texels[0], block.texels[0] + 16);
+
+  u8 indices[16] = {};
+  u8 first       = toU8(high);
+  u8 second      = toU8(low);
+
+  if(first > second) {
+    BcBlock palette;
+    palette.texels[0][0] = first;
+    palette.texels[0][1] = second;
+    for(u32 entry = 2u; entry < 8u; ++entry)
+      palette.texels[0][entry] =
+        (toF32(8u - entry) * first + toF32(entry - 1u) * second) / 7.0f;
+
+    search(indices, block, palette, 1u, 8u);
+  }
+
+  u64 bits = 0u;
+  for(u32 texel = 0u; texel < 16u; ++texel)
+    bits |= toU64(indices[texel]) << (3u * texel);
+
+  dst[0] = first;
+  dst[1] = second;
+  BcWriteLE(dst + 2, bits, 6u);
+}
+
+static u16 BcPack565(const f32* color)
+{
+  u32 r = toU32(std::lround(color[0] * 31.0f / 255.0f));
+  u32 g = toU32(std::lround(color[1] * 63.0f / 255.0f));
+  u32 b = toU32(std::lround(color[2] * 31.0f / 255.0f));
+  return toU16((r << 11) | (g << 5) | b);
+}
+
+static void BcUnpack565(u16 packed, f32* color)
+{
+  u32 r = (packed >> 11) & 31u;
+  u32 g = (packed >> 5) & 63u;
+  u32 b = packed & 31u;
+
+  color[0] = toF32((r << 3) | (r >> 2));
+  color[1] = toF32((g << 2) | (g >> 4));
+  color[2] = toF32((b << 3) | (b >> 2));
+}
+
+// Palette weights of the first endpoint, by index.
+static constexpr f32 Bc1Weights4[4] = {1.0f, 0.0f, 2.0f / 3, 1.0f / 3};
+static constexpr f32 Bc1Weights3[4] = {1.0f, 0.0f, 0.5f, 0.0f};
+
+static constexpr u32 Bc1TransparentIdx = 3u;
+
+struct Bc1Candidate {
+  u16 colors[2];
+  u8  indices[16];
+  f32 error;
+};
+
+// Quantizes the endpoints and picks the indices. With transparent
+// texels the block uses the mode with 3 colors, where the first color
+// is not larger than the second.
+static Bc1Candidate BcFitColors(
+  const BcBlock& block, const f32* first, const f32* second,
+  bool transparent, const f32* weights, BcSearchFn search)
+{
+  Bc1Candidate ret;
+  ret.colors[0] = BcPack565(first);
+  ret.colors[1] = BcPack565(second);
+
+  bool swap = transparent ? ret.colors[0] > ret.colors[1]
+                          : ret.colors[0] < ret.colors[1];
+  if(swap) std::swap(ret.colors[0], ret.colors[1]);
+
+  f32 ends[2][3];
+  BcUnpack565(ret.colors[0], ends[0]);
+  BcUnpack565(ret.colors[1], ends[1]);
+
+  const f32* paletteWeights = transparent ? Bc1Weights3 : Bc1Weights4;
+  u32        paletteSize    = transparent ? 3u : 4u;
+
+  // Equal colors in the 4 color mode decode as the 3 color mode, where
+  // index 0 still is the first color.
+  if(!transparent && ret.colors[0] == ret.colors[1]) paletteSize = 1u;
+
+  BcBlock palette;
+  for(u32 entry = 0u; entry < paletteSize; ++entry)
+    for(u32 channel = 0u; channel < 3u; ++channel)
+      palette.texels[channel][entry] =
+        paletteWeights[entry] * ends[0][channel] +
+        (1.0f - paletteWeights[entry]) * ends[1][channel];
+
+  ret.error = search(ret.indices, block, palette, 3u, paletteSize);
+
+  if(transparent) {
+    ret.error = 0.0f;
+    for(u32 texel = 0u; texel < 16u; ++texel) {
+      if(weights[texel] == 0.0f) {
+        ret.indices[texel] = Bc1TransparentIdx;
+        continue;
+      }
+
+      for(u32 channel = 0u; channel < 3u; ++channel) {
+        f32 delta = block.texels[channel][texel] -
+                    palette.texels[channel][ret.indices[texel]];
+        ret.error += delta * delta;
+      }
+    }
+  }
+
+  return ret;
+}
+
+// BC1 color block, 8 bytes. With punch through alpha, texels with an
+// alpha below half are stored as transparent.
+static void BcEncodeColor(
+  u8* dst, const BcBlock& block, bool punchThrough, BcSearchFn search)
+{
+  f32  weights[16];
+  bool transparent = false;
+  for(u32 texel = 0u; texel < 16u; ++texel) {
+    bool hidden    = punchThrough && block.texels[3][texel] < 128.0f;
+    weights[texel] = hidden ? 0.0f : 1.0f;
+    transparent |= hidden;
+  }
+
+  bool allHidden = std::all_of(
+    weights, weights + 16, [](f32 w) { return w == 0.0f; });
+
+  Bc1Candidate best;
+  if(allHidden) {
+    best.colors[0] = 0u;
+    best.colors[1] = 0u;
+    std::fill_n(best.indices, 16u, toU8(Bc1TransparentIdx));
+  } else {
+    f32 low[3], high[3];
+    BcFitEndpoints(block, weights, 3u, low, high);
+    best = BcFitColors(block, high, low, transparent, weights, search);
+
+    const f32* paletteWeights = transparent ? Bc1Weights3 : Bc1Weights4;
+
+    f32 first[3], second[3];
+    if(BcRefineEndpoints(
+         block, best.indices, paletteWeights, weights, 3u, first,
+         second)) {
+      auto refined =
+        BcFitColors(block, first, second, transparent, weights, search);
+      if(refined.error < best.error) best = refined;
+    }
+  }
+
+  u32 bits = 0u;
+  for(u32 texel = 0u; texel < 16u; ++texel)
+    bits |= toU32(best.indices[texel]) << (2u * texel);
+
+  BcWriteLE(dst + 0, best.colors[0], 2u);
+  BcWriteLE(dst + 2, best.colors[1], 2u);
+  BcWriteLE(dst + 4, bits, 4u);
+}
+
+// BC7 interpolation weights for 4-bit indices, out of 64.
+static constexpr u32 Bc7Weights4[16] = {
+  0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct Bc7Candidate {
+  u8  ends[2][4];
+  u8  pbits[2];
+  u8  indices[16];
+  f32 error;
+};
+
+// Endpoints are 7 bits per channel plus a shared low bit, the one
+// closest to the wanted color is kept.
+static void Bc7Quantize(const f32* color, u8* ends, u8& pbit)
+{
+  f32 bestError = std::numeric_limits<f32>::max();
+
+  for(u32 bit = 0u; bit < 2u; ++bit) {
+    u8  quantized[4];
+    f32 error = 0.0f;
+    for(u32 channel = 0u; channel < 4u; ++channel) {
+      i32 value = toI32(std::lround((color[channel] - toF32(bit)) / 2));
+      quantized[channel] = toU8(std::clamp(value, 0, 127));
+
+      f32 delta =
+        toF32((quantized[channel] << 1) | bit) - color[channel];
+      error += delta * delta;
+    }
+
+    if(error < bestError) {
+      bestError = error;
+      pbit      = toU8(bit);
+      std::copy_n(quantized, 4u, ends);
+    }
+  }
+}
+
+static Bc7Candidate Bc7FitColors(
+  const BcBlock& block, const f32* first, const f32* second,
+  BcSearchFn search)
+{
+  Bc7Candidate ret;
+  Bc7Quantize(first, ret.ends[0], ret.pbits[0]);
+  Bc7Quantize(second, ret.ends[1], ret.pbits[1]);
+
+  BcBlock palette;
+  for(u32 channel = 0u; channel < 4u; ++channel) {
+    u32 e0 = toU32(ret.ends[0][channel] << 1) | ret.pbits[0];
+    u32 e1 = toU32(ret.ends[1][channel] << 1) | ret.pbits[1];
+    for(u32 entry = 0u; entry < 16u; ++entry)
+      palette.texels[channel][entry] = toF32(
+        ((64u - Bc7Weights4[entry]) * e0 + Bc7Weights4[entry] * e1 +
+         32u) >>
+        6);
+  }
+
+  ret.error = search(ret.indices, block, palette, 4u, 16u);
+  return ret;
+}
+
+// Writes bits from the least significant one up.
+class BcBitWriter
+{
+public:
+  BcBitWriter(u8* dst): m_dst{dst} { std::fill_n(dst, 16u, u8{0u}); }
+
+  void Write(u32 value, u32 count)
+  {
+    for(u32 bit = 0u; bit < count; ++bit, ++m_offset) {
+      u32 shift = m_offset % 8u;
+      m_dst[m_offset / 8u] |= toU8(((value >> bit) & 1u) << shift);
+    }
+  }
+
+private:
+  u8* m_dst;
+  u32 m_offset = 0u;
+};
+
+// BC7 in mode 6, a single RGBA subset with 4-bit indices. The other
+// modes are not searched.
+static void
+BcEncodeBC7(u8* dst, const BcBlock& block, BcSearchFn search)
+{
+  f32 weights[16];
+  std::fill_n(weights, 16u, 1.0f);
+
+  f32 low[4], high[4];
+  BcFitEndpoints(block, weights, 4u, low, high);
+  auto best = Bc7FitColors(block, low, high, search);
+
+  f32 paletteWeights[16];
+  for(u32 entry = 0u; entry < 16u; ++entry)
+    paletteWeights[entry] = toF32(64u - Bc7Weights4[entry]) / 64.0f;
+
+  f32 first[4], second[4];
+  if(BcRefineEndpoints(
+       block, best.indices, paletteWeights, weights, 4u, first,
+       second)) {
+    auto refined = Bc7FitColors(block, first, second, search);
+    if(refined.error < best.error) best = refined;
+  }
+
+  // The most significant bit of the first index is implied zero.
+  if(best.indices[0] >= 8u) {
+    std::swap(best.ends[0], best.ends[1]);
+    std::swap(best.pbits[0], best.pbits[1]);
+    for(auto& index: best.indices) index = toU8(15u - index);
+  }
+
+  BcBitWriter out(dst);
+  out.Write(1u << 6, 7u);
+  for(u32 channel = 0u; channel < 4u; ++channel) {
+    out.Write(best.ends[0][channel], 7u);
+    out.Write(best.ends[1][channel], 7u);
+  }
+  out.Write(best.pbits[0], 1u);
+  out.Write(best.pbits[1], 1u);
+
+  out.Write(best.indices[0], 3u);
+  for(u32 texel = 1u; texel < 16u; ++texel)
+    out.Write(best.indices[texel], 4u);
+}
+
+// Reads a texel of the source image as RGBA8.
+using BcLoadFn = void (*)(f32* rgba, const u8* src);
+
+template<u32 Channels, bool Bgr, u32 ChannelSize>
+static void BcLoadTexel(f32* rgba, const u8* src)
+{
+  f32 values[4] = {0.0f, 0.0f, 0.0f, 255.0f};
+  for(u32 channel = 0u; channel < Channels; ++channel) {
+    if constexpr(ChannelSize == 1u) {
+      values[channel] = src[channel];
+    } else {
+      u16 value;
+      memcpy(&value, src + channel * 2u, sizeof(value));
+      values[channel] = toF32((toU32(value) * 255u + 32767u) / 65535u);
+    }
+  }
+
+  // Single channel images are gray.
+  if constexpr(Channels == 1u) values[1] = values[2] = values[0];
+  if constexpr(Bgr) std::swap(values[0], values[2]);
+
+  std::copy_n(values, 4u, rgba);
+}
+
+static BcLoadFn GetBcLoad(Format format)
+{
+  switch(format) {
+    case Format::R8_UNORM:
+      return &BcLoadTexel<1u, false, 1u>;
+    case Format::R16_UNORM:
+      return &BcLoadTexel<1u, false, 2u>;
+    case Format::R8G8B8A8_UNORM:
+    case Format::R8G8B8A8_SRGB:
+      return &BcLoadTexel<4u, false, 1u>;
+    case Format::B8G8R8A8_UNORM:
+    case Format::B8G8R8A8_SRGB:
+      return &BcLoadTexel<4u, true, 1u>;
+    case Format::R16G16B16A16_UNORM:
+      return &BcLoadTexel<4u, false, 2u>;
+    default:
+      throw std::runtime_error(
+        "DataReader: cannot block compress the image format");
+  }
+}
+
+static void BcEncodeBlock(
+  u8* dst, const BcBlock& block, Format format, BcSearchFn search)
+{
+  switch(format) {
+    case Format::BC1_RGBA_UNORM:
+    case Format::BC1_RGBA_SRGB:
+      BcEncodeColor(dst, block, true, search);
+      break;
+    case Format::BC3_UNORM:
+    case Format::BC3_SRGB:
+      BcEncodeChannel(dst, block, 3u, search);
+      BcEncodeColor(dst + 8, block, false, search);
+      break;
+    case Format::BC4_UNORM:
+      BcEncodeChannel(dst, block, 0u, search);
+      break;
+    case Format::BC5_UNORM:
+      BcEncodeChannel(dst, block, 0u, search);
+      BcEncodeChannel(dst + 8, block, 1u, search);
+      break;
+    case Format::BC7_UNORM:
+    case Format::BC7_SRGB:
+      BcEncodeBC7(dst, block, search);
+      break;
+    default:
+      throw std::runtime_error("DataReader: unsupported block format");
+  }
+}
+
+void DataReader::compressImage(
+  data::Image& image, Format format, bool srgb, u32 threadCount)
+{
+  if(isBlockFormat(image.format)) return;
+
+  // Nothing else is worth storing for a single channel.
+  if(
+    image.format == Format::R8_UNORM ||
+    image.format == Format::R16_UNORM)
+    format = Format::BC4_UNORM;
+
+  if(!isBlockFormat(format))
+    throw std::runtime_error("DataReader: unsupported block format");
+
+  // The texels stay sRGB encoded, so must the blocks.
+  if(srgb || isSrgbFormat(image.format)) format = getSrgbFormat(format);
+
+  const auto load      = GetBcLoad(image.format);
+  const auto search    = GetBcSearch();
+  const u32  texelSize = getFormatSize(image.format);
+
+  data::Image out;
+  out.uri    = image.uri;
+  out.format = format;
+  out.size   = image.size;
+  out.mips   = image.mips;
+  out.layers = image.layers;
+  out.texels.resize(getImageSize(out));
+
+  // One job per row of blocks, of any mip and layer.
+  struct Job {
+    u32 layer;
+    u32 mip;
+    u32 row;
+  };
+
+  Arr<Job> jobs;
+  for(u32 layer = 0u; layer < image.layers; ++layer) {
+    for(u32 mip = 0u; mip < image.mips; ++mip) {
+      u32 rowCount =
+        getFormatRowCount(format, getMipExtent(image.size[1], mip));
+      for(u32 row = 0u; row < rowCount; ++row)
+        jobs.push_back({layer, mip, row});
+    }
+  }
+
+  const auto encodeRow = [&](const Job& job) {
+    const u32 width  = getMipExtent(image.size[0], job.mip);
+    const u32 height = getMipExtent(image.size[1], job.mip);
+
+    const u8* src =
+      image.texels.data() + getMipOffset(image, job.mip, job.layer);
+    u8* dst = out.texels.data() +
+              getMipOffset(out, job.mip, job.layer) +
+              job.row * getFormatRowSize(format, width);
+
+    BcBlock block;
+    for(u32 x = 0u; x < width; x += 4u) {
+      for(u32 texel = 0u; texel < 16u; ++texel) {
+        u32 tx = std::min(x + texel % 4u, width - 1u);
+        u32 ty = std::min(job.row * 4u + texel / 4u, height - 1u);
+
+        f32 rgba[4];
+        load(rgba, src + (toU64(ty) * width + tx) * texelSize);
+        for(u32 channel = 0u; channel < 4u; ++channel)
+          block.texels[channel][texel] = rgba[channel];
+      }
+
+      BcEncodeBlock(dst, block, format, search);
+      dst += getFormatSize(format);
+    }
+  };
+
+  runJobs(jobs.size(), threadCount, [&](u64 idx) {
+    encodeRow(jobs[idx]);
+  });
+
+  image = std::move(out);
+}
@@ -0,0 +1,412 @@
+#include "vuldir/DataReader.hpp"
+#include "vuldir/PixelConverter.hpp"
+
+using namespace vd;
+
+// DirectDraw Surface, as written by texconv and most texture tools. The
+// texels are stored layer by layer, each with its mip chain, the same
+// layout as data::Image, so they are read straight into the target.
+
+static constexpr u8  DdsMagic[]    = {'D', 'D', 'S', ' '};
+static constexpr u64 DdsHeaderSize = 124u;
+static constexpr u64 DdsDX10Size   = 20u;
+
+// Header flags and capabilities.
+static constexpr u32 DdsFlagMipCount   = 0x20000u;
+static constexpr u32 DdsPixelAlpha     = 0x1u;
+static constexpr u32 DdsPixelFourCC    = 0x4u;
+static constexpr u32 DdsPixelRgb       = 0x40u;
+static constexpr u32 DdsPixelLuminance = 0x20000u;
+static constexpr u32 DdsCaps2Cubemap   = 0x200u;
+static constexpr u32 DdsCaps2AllFaces  = 0xfc00u;
+static constexpr u32 DdsCaps2Volume    = 0x200000u;
+
+// DX10 header resource dimension and flags.
+static constexpr u32 DdsDimension3D = 4u;
+static constexpr u32 DdsMiscCube    = 0x4u;
+
+static Format GetDdsDxgiFormat(u32 format)
+{
+  // DXGI_FORMAT values, the typeless formats read as UNORM.
+  switch(format) {
+    case 2u:
+      return Format::R32G32B32A32_SFLOAT;
+    case 3u:
+      return Format::R32G32B32A32_UINT;
+    case 4u:
+      return Format::R32G32B32A32_SINT;
+    case 6u:
+      return Format::R32G32B32_SFLOAT;
+    case 7u:
+      return Format::R32G32B32_UINT;
+    case 8u:
+      return Format::R32G32B32_SINT;
+    case 10u:
+      return Format::R16G16B16A16_SFLOAT;
+    case 11u:
+      return Format::R16G16B16A16_UNORM;
+    case 12u:
+      return Format::R16G16B16A16_UINT;
+    case 13u:
+      return Format::R16G16B16A16_SNORM;
+    case 14u:
+      return Format::R16G16B16A16_SINT;
+    case 16u:
+      return Format::R32G32_SFLOAT;
+    case 28u:
+      return Format::R8G8B8A8_UNORM;
+    case 29u:
+      return Format::R8G8B8A8_SRGB;
+    case 30u:
+      return Format::R8G8B8A8_UINT;
+    case 31u:
+      return Format::R8G8B8A8_SNORM;
+    case 32u:
+      return Format::R8G8B8A8_SINT;
+    case 34u:
+      return Format::R16G16_SFLOAT;
+    case 54u:
+      return Format::R16_SFLOAT;
+    case 56u:
+      return Format::R16_UNORM;
+    case 57u:
+      return Format::R16_UINT;
+    case 58u:
+      return Format::R16_SNORM;
+    case 59u:
+      return Format::R16_SINT;
+    case 61u:
+      return Format::R8_UNORM;
+    case 62u:
+      return Format::R8_UINT;
+    case 63u:
+      return Format::R8_SNORM;
+    case 64u:
+      return Format::R8_SINT;
+    case 70u:
+    case 71u:
+      return Format::BC1_RGBA_UNORM;
+    case 72u:
+      return Format::BC1_RGBA_SRGB;
+    case 73u:
+    case 74u:
+      return Format::BC2_UNORM;
+    case 75u:
+      return Format::BC2_SRGB;
+    case 76u:
+    case 77u:
+      return Format::BC3_UNORM;
+    case 78u:
+      return Format::BC3_SRGB;
+    case 79u:
+    case 80u:
+      return Format::BC4_UNORM;
+    case 81u:
+      return Format::BC4_SNORM;
+    case 82u:
+    case 83u:
+      return Format::BC5_UNORM;
+    case 84u:
+      return Format::BC5_SNORM;
+    case 87u:
+      return Format::B8G8R8A8_UNORM;
+    case 91u:
+      return Format::B8G8R8A8_SRGB;
+    case 94u:
+    case 95u:
+      return Format::BC6H_UFLOAT;
+    case 96u:
+      return Format::BC6H_SFLOAT;
+    case 97u:
+    case 98u:
+      return Format::BC7_UNORM;
+    case 99u:
+      return Format::BC7_SRGB;
+    default:
+      throw makeError<std::runtime_error>(
+        "DDS: unsupported DXGI format %u", format);
+  }
+}
+
+// Files without the DX10 header describe the format with a four
+// character code, a D3DFORMAT value or channel masks.
+static Format GetDdsLegacyFormat(
+  u32 flags, u32 fourCode, u32 bitCount, const u32 (&masks)[4])
+{
+  if(flags & DdsPixelFourCC) {
+    switch(fourCode) {
+      case fourCC("DXT1"):
+        return Format::BC1_RGBA_UNORM;
+      case fourCC("DXT2"):
+      case fourCC("DXT3"):
+        return Format::BC2_UNORM;
+      case fourCC("DXT4"):
+      case fourCC("DXT5"):
+        return Format::BC3_UNORM;
+      case fourCC("ATI1"):
+      case fourCC("BC4U"):
+        return Format::BC4_UNORM;
+      case fourCC("BC4S"):
+        return Format::BC4_SNORM;
+      case fourCC("ATI2"):
+      case fourCC("BC5U"):
+        return Format::BC5_UNORM;
+      case fourCC("BC5S"):
+        return Format::BC5_SNORM;
+      default:
+        break;
+    }
+
+    // The code is stored little endian, D3DFORMAT values are small.
+    switch(byteSwap(fourCode)) {
+      case 36u:
+        return Format::R16G16B16A16_UNORM;
+      case 110u:
+        return Format::R16G16B16A16_SNORM;
+      case 111u:
+        return Format::R16_SFLOAT;
+      case 113u:
+        return Format::R16G16B16A16_SFLOAT;
+      case 115u:
+        return Format::R32G32_SFLOAT;
+      case 116u:
+        return Format::R32G32B32A32_SFLOAT;
+      default:
+        throw std::runtime_error(
+          "DDS: unsupported four character code");
+    }
+  }
+
+  const bool hasAlpha = flags & DdsPixelAlpha;
+
+  if((flags & DdsPixelRgb) && bitCount == 32u) {
+    if(
+      masks[0] == 0xffu && masks[1] == 0xff00u &&
+      masks[2] == 0xff0000u && (!hasAlpha || masks[3] == 0xff000000u))
+      return Format::R8G8B8A8_UNORM;
+    if(
+      masks[0] == 0xff0000u && masks[1] == 0xff00u &&
+      masks[2] == 0xffu && (!hasAlpha || masks[3] == 0xff000000u))
+      return Format::B8G8R8A8_UNORM;
+  }
+
+  if((flags & DdsPixelLuminance) && !hasAlpha) {
+    if(bitCount == 8u && masks[0] == 0xffu) return Format::R8_UNORM;
+    if(bitCount == 16u && masks[0] == 0xffffu) return Format::R16_UNORM;
+  }
+
+  throw std::runtime_error("DDS: unsupported pixel format");
+}
+
+// 24-bit files have no matching format, they are expanded to RGBA as
+// they are read.
+static PixelFormat GetDdsPackedFormat(
+  u32 flags, u32 bitCount, const u32 (&masks)[4])
+{
+  if(!(flags & DdsPixelRgb) || bitCount != 24u)
+    return PixelFormat::UNDEFINED;
+
+  if(masks[0] == 0xffu && masks[1] == 0xff00u && masks[2] == 0xff0000u)
+    return PixelFormat::R8G8B8_UNORM;
+  if(masks[0] == 0xff0000u && masks[1] == 0xff00u && masks[2] == 0xffu)
+    return PixelFormat::B8G8R8_UNORM;
+
+  return PixelFormat::UNDEFINED;
+}
+
+// Whether the texels described by the header fit in the bytes after
+// it. Checked a level at a time, huge sizes would overflow.
+static bool DdsFitsInFile(
+  const data::Image& image, PixelFormat packedFormat, u64 available)
+{
+  u64 layerSize = 0u;
+  for(u32 mip = 0u; mip < image.mips; ++mip) {
+    const u32 width = getMipExtent(image.size[0], mip);
+    const u64 rowSize =
+      packedFormat != PixelFormat::UNDEFINED
+        ? toU64(width) * getPixelSize(packedFormat)
+        : getFormatRowSize(image.format, width);
+    const u64 rowCount = getFormatRowCount(
+      image.format, getMipExtent(image.size[1], mip));
+
+    if(rowSize == 0u || rowCount > available / rowSize) return false;
+    layerSize += rowSize * rowCount;
+    if(layerSize > available) return false;
+  }
+
+  return layerSize > 0u && image.layers <= available / layerSize;
+}
+
+bool DataReader::isDds(std::istream& src)
+{
+  auto pos  = src.tellg();
+  auto size = streamSize(src);
+
+  if(size < sizeof(DdsMagic) + DdsHeaderSize) return false;
+
+  std::array<char, sizeof(DdsMagic)> magic;
+  src.read(magic.data(), magic.size());
+  src.seekg(pos);
+
+  return memcmp(std::data(magic), DdsMagic, sizeof(DdsMagic)) == 0u;
+}
+
+data::Image DataReader::readDds(
+  std::istream& src, const ImageOptions& options,
+  const ImageTargetQuery& query)
+{
+  if(!isDds(src)) throw std::runtime_error("DDS: bad signature");
+
+  const u64 fileSize = streamSize(src);
+
+  // Both headers are read at once, the texels follow them.
+  Arr<u8> header(sizeof(DdsMagic) + DdsHeaderSize + DdsDX10Size);
+  src.seekg(0);
+  src.read(
+    reinterpret_cast<char*>(header.data()),
+    static_cast<std::streamsize>(
+      std::min<u64>(header.size(), fileSize)));
+  src.clear();
+
+  ByteIStream stream({header.data(), header.size()});
+  stream.SkipBytes(sizeof(DdsMagic));
+
+  if(stream.Read<u32>() != DdsHeaderSize)
+    throw std::runtime_error("DDS: bad header size");
+
+  data::Image out;
+  out.uri = options.uri;
+
+  const u32 flags = stream.Read<u32>();
+  out.size[1]     = stream.Read<u32>();
+  out.size[0]     = stream.Read<u32>();
+  stream.SkipBytes(8u); // Pitch and depth.
+
+  const u32 mipCount = stream.Read<u32>();
+  stream.SkipBytes(44u);
+
+  stream.SkipBytes(4u); // Pixel format size.
+  const u32 pixelFlags = stream.Read<u32>();
+  const u32 fourCode   = stream.ReadSwap<u32>();
+  const u32 bitCount   = stream.Read<u32>();
+
+  u32 masks[4];
+  for(auto& mask: masks) mask = stream.Read<u32>();
+
+  stream.SkipBytes(4u); // Caps.
+  const u32 caps2 = stream.Read<u32>();
+  stream.SkipBytes(12u);
+
+  if(out.size[0] == 0u || out.size[1] == 0u)
+    throw std::runtime_error("DDS: bad image size");
+
+  out.mips = (flags & DdsFlagMipCount) ? std::max(mipCount, 1u) : 1u;
+  if(out.mips > getMipCount(out.size[0], out.size[1]))
+    throw std::runtime_error("DDS: bad mip count");
+
+  u64 dataOffset = sizeof(DdsMagic) + DdsHeaderSize;
+
+  auto packedFormat = PixelFormat::UNDEFINED;
+
+  if((pixelFlags & DdsPixelFourCC) && fourCode == fourCC("DX10")) {
+    if(fileSize < dataOffset + DdsDX10Size)
+      throw std::runtime_error("DDS: missing DX10 header");
+
+    out.format           = GetDdsDxgiFormat(stream.Read<u32>());
+    const u32 dimension  = stream.Read<u32>();
+    const u32 miscFlags  = stream.Read<u32>();
+    const u32 arraySize  = stream.Read<u32>();
+    const u32 faceCount  = (miscFlags & DdsMiscCube) ? 6u : 1u;
+    dataOffset          += DdsDX10Size;
+
+    if(dimension == DdsDimension3D)
+      throw std::runtime_error(
+        "DDS: volume textures are not supported");
+
+    out.layers = std::max(arraySize, 1u) * faceCount;
+  } else {
+    packedFormat = GetDdsPackedFormat(pixelFlags, bitCount, masks);
+    out.format =
+      packedFormat != PixelFormat::UNDEFINED
+        ? Format::R8G8B8A8_UNORM
+        : GetDdsLegacyFormat(pixelFlags, fourCode, bitCount, masks);
+
+    if(caps2 & DdsCaps2Volume)
+      throw std::runtime_error(
+        "DDS: volume textures are not supported");
+
+    if(caps2 & DdsCaps2Cubemap) {
+      if((caps2 & DdsCaps2AllFaces) != DdsCaps2AllFaces)
+        throw std::runtime_error(
+          "DDS: partial cubemaps are not supported");
+      out.layers = 6u;
+    }
+  }
+
+  // The target is sized from the header alone, which must not ask for
+  // more than the file holds.
+  if(
+    fileSize < dataOffset ||
+    !DdsFitsInFile(out, packedFormat, fileSize - dataOffset))
+    throw std::runtime_error("DDS: file too small for its header");
+
+  auto target = query(out);
+  if(target.texels.empty()) return out;
+
+  const auto levels = getLevelTargets(out, target);
+
+  src.seekg(static_cast<std::streamoff>(dataOffset));
+
+  Opt<PixelConverter> converter;
+  Arr<u8>             packed;
+  if(packedFormat != PixelFormat::UNDEFINED)
+    converter.emplace(packedFormat, PixelFormat::R8G8B8A8_UNORM);
+
+  for(u32 layer = 0u; layer < out.layers; ++layer) {
+    for(u32 mip = 0u; mip < out.mips; ++mip) {
+      const auto& level = levels[layer * out.mips + mip];
+      const u32   width = getMipExtent(out.size[0], mip);
+      const u64   size  = getMipSize(out, mip);
+
+      const u64 rowSize  = getFormatRowSize(out.format, width);
+      const u64 rowCount = size / rowSize;
+
+      const u64 srcRowSize =
+        converter ? toU64(width) * getPixelSize(packedFormat) : rowSize;
+
+      if(level.texels.empty()) {
+        src.seekg(
+          static_cast<std::streamoff>(srcRowSize * rowCount),
+          std::ios::cur);
+        continue;
+      }
+
+      if(converter) {
+        packed.resize(srcRowSize * rowCount);
+        src.read(
+          reinterpret_cast<char*>(packed.data()),
+          static_cast<std::streamsize>(packed.size()));
+
+        const u64 rowPitch = level.rowPitch ? level.rowPitch : rowSize;
+        for(u64 row = 0u; row < rowCount; ++row)
+          converter->ConvertRow(
+            level.texels.data() + row * rowPitch,
+            packed.data() + row * srcRowSize, width);
+      } else if(level.rowPitch == 0u || level.rowPitch == rowSize) {
+        src.read(
+          reinterpret_cast<char*>(level.texels.data()),
+          static_cast<std::streamsize>(size));
+      } else {
+        for(u64 row = 0u; row < rowCount; ++row)
+          src.read(
+            reinterpret_cast<char*>(
+              level.texels.data() + row * level.rowPitch),
+            static_cast<std::streamsize>(rowSize));
+      }
+
+      if(!src) throw std::runtime_error("DDS: missing image data");
+    }
+  }
+
+  return out;
+}
@@ -0,0 +1,270 @@
+#include "vuldir/DataReader.hpp"
+
+using namespace vd;
+
+// Radiance RGBE, the usual format of HDR environment maps. The header
+// is text, the texels share an exponent byte and rows are stored flat
+// or run-length encoded channel by channel. They are expanded to float
+// RGBA, linear like the file.
+
+static constexpr Strv HdrMagics[]      = {"#?RADIANCE", "#?RGBE"};
+static constexpr u64  HdrMaxHeaderSize = 64u << 10;
+
+// Scanlines with a new-style run-length header, each channel is
+// encoded on its own. Only widths that fit the header use it.
+static constexpr u32 HdrMinRleWidth = 8u;
+static constexpr u32 HdrMaxRleWidth = 0x7fffu;
+
+// Mantissas are scaled by 2^(exponent - 136), in two steps so that
+// neither power of two leaves the normal range. Zero exponents are
+// black.
+static void HdrDecodeTexel(f32* dst, const u8* src)
+{
+  if(src[3] == 0u) {
+    dst[0] = dst[1] = dst[2] = 0.0f;
+  } else {
+    const i32 exp = toI32(src[3]) - 136;
+    for(u32 channel = 0u; channel < 3u; ++channel)
+      dst[channel] = std::ldexp(toF32(src[channel]), exp);
+  }
+  dst[3] = 1.0f;
+}
+
+using HdrRowFn = void (*)(f32* dst, const u8* src, u32 width);
+
+static void HdrDecodeRow(f32* dst, const u8* src, u32 width)
+{
+  for(u32 x = 0u; x < width; ++x)
+    HdrDecodeTexel(dst + x * 4u, src + x * 4u);
+}
+
+#ifdef VD_ARCH_X64
+
+// Four texels per load, one texel per register once widened. The
+// scale is built from exponent bits, matching ldexp exactly.
+static void HdrDecodeRowSSE2(f32* dst, const u8* src, u32 width)
+{
+  const auto zero  = _mm_setzero_si128();
+  const auto bias  = _mm_set1_epi32(136);
+  const auto ebias = _mm_set1_epi32(127);
+  const auto alpha = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+  const auto one   = _mm_set1_ps(1.0f);
+
+  const auto scale = [&](__m128i exp) {
+    return _mm_castsi128_ps(
+      _mm_slli_epi32(_mm_add_epi32(exp, ebias), 23));
+  };
+
+  u32 x = 0u;
+  for(; x + 4u <= width; x += 4u) {
+    const auto bytes =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4u));
+    const auto lo = _mm_unpacklo_epi8(bytes, zero);
+    const auto hi = _mm_unpackhi_epi8(bytes, zero);
+
+    const __m128i texels[] = {
+      _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+      _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)};
+
+    for(u32 idx = 0u; idx < 4u; ++idx) {
+      const auto e    = _mm_shuffle_epi32(texels[idx], 0xff);
+      const auto exp  = _mm_sub_epi32(e, bias);
+      const auto exp0 = _mm_srai_epi32(exp, 1);
+      const auto exp1 = _mm_sub_epi32(exp, exp0);
+
+      auto color = _mm_mul_ps(
+        _mm_mul_ps(_mm_cvtepi32_ps(texels[idx]), scale(exp0)),
+        scale(exp1));
+      color = _mm_andnot_ps(
+        _mm_castsi128_ps(_mm_cmpeq_epi32(e, zero)), color);
+      color = _mm_or_ps(
+        _mm_andnot_ps(alpha, color), _mm_and_ps(alpha, one));
+
+      _mm_storeu_ps(dst + (x + idx) * 4u, color);
+    }
+  }
+
+  for(; x < width; ++x) HdrDecodeTexel(dst + x * 4u, src + x * 4u);
+}
+
+#endif
+
+static HdrRowFn GetHdrRowFn()
+{
+#ifdef VD_ARCH_X64
+  if(getCpuFeatures().sse2) return &HdrDecodeRowSSE2;
+#endif
+  return &HdrDecodeRow;
+}
+
+// Expands a scanline to RGBE texels, returns where the next one
+// starts.
+static const u8*
+HdrReadScanline(u8* dst, u32 width, const u8* src, const u8* end)
+{
+  const auto need = [&](u64 size) {
+    if(toU64(end - src) < size)
+      throw std::runtime_error("HDR: missing image data");
+  };
+
+  need(4u);
+  const bool isRle = width >= HdrMinRleWidth &&
+                     width <= HdrMaxRleWidth && src[0] == 2u &&
+                     src[1] == 2u && (src[2] & 0x80u) == 0u;
+
+  if(isRle) {
+    if(((toU32(src[2]) << 8) | src[3]) != width)
+      throw std::runtime_error("HDR: bad scanline width");
+    src += 4u;
+
+    // Runs above 128 repeat a byte, the others are literals.
+    for(u32 channel = 0u; channel < 4u; ++channel) {
+      for(u32 x = 0u; x < width;) {
+        need(1u);
+        u32 count = *src++;
+
+        if(count > 128u) {
+          count -= 128u;
+          if(count > width - x)
+            throw std::runtime_error("HDR: bad scanline run");
+
+          need(1u);
+          const u8 value = *src++;
+          for(; count > 0u; --count)
+            dst[(x++) * 4u + channel] = value;
+        } else {
+          if(count == 0u || count > width - x)
+            throw std::runtime_error("HDR: bad scanline run");
+
+          need(count);
+          for(; count > 0u; --count)
+            dst[(x++) * 4u + channel] = *src++;
+        }
+      }
+    }
+
+    return src;
+  }
+
+  // Flat texels. Older files repeat the previous texel with a 1, 1, 1
+  // marker, consecutive markers make up a longer count.
+  u32 shift = 0u;
+  for(u32 x = 0u; x < width; src += 4u) {
+    need(4u);
+
+    if(src[0] == 1u && src[1] == 1u && src[2] == 1u) {
+      if(x == 0u || shift > 24u)
+        throw std::runtime_error("HDR: bad scanline run");
+
+      const u64 count = toU64(src[3]) << shift;
+      if(count > width - x)
+        throw std::runtime_error("HDR: bad scanline run");
+
+      for(u64 idx = 0u; idx < count; ++idx, ++x)
+        memcpy(dst + x * 4u, dst + (x - 1u) * 4u, 4u);
+      shift += 8u;
+    } else {
+      memcpy(dst + x * 4u, src, 4u);
+      ++x;
+      shift = 0u;
+    }
+  }
+
+  return src;
+}
+
+bool DataReader::isHdr(std::istream& src)
+{
+  auto pos  = src.tellg();
+  auto size = streamSize(src);
+
+  std::array<char, 10u> magic = {};
+  const u64 count = std::min<u64>(size, magic.size());
+  src.read(magic.data(), static_cast<std::streamsize>(count));
+  src.clear();
+  src.seekg(pos);
+
+  const Strv text{magic.data(), count};
+  return std::any_of(
+    std::begin(HdrMagics), std::end(HdrMagics),
+    [&](Strv value) { return text.starts_with(value); });
+}
+
+data::Image DataReader::readHdr(
+  std::istream& src, const ImageOptions& options,
+  const ImageTargetQuery& query)
+{
+  if(!isHdr(src)) throw std::runtime_error("HDR: bad signature");
+  src.seekg(0);
+
+  const auto  bytes  = streamReadBytes(src);
+  const auto* cursor = bytes.data();
+  const auto* end    = bytes.data() + bytes.size();
+
+  const auto readLine = [&]() {
+    const auto* next = std::find(cursor, end, u8('\n'));
+    if(next == end || toU64(next - bytes.data()) > HdrMaxHeaderSize)
+      throw std::runtime_error("HDR: bad header");
+
+    Str line(
+      reinterpret_cast<const char*>(cursor), toU64(next - cursor));
+    if(!line.empty() && line.back() == '\r') line.pop_back();
+    cursor = next + 1u;
+    return line;
+  };
+
+  readLine(); // Magic.
+
+  // Variables up to an empty line, exposure and color corrections are
+  // left to the caller.
+  for(Str line = readLine(); !line.empty(); line = readLine()) {
+    if(
+      line.starts_with("FORMAT=") &&
+      line != "FORMAT=32-bit_rle_rgbe")
+      throw makeError<std::runtime_error>(
+        "HDR: unsupported format %s", line.c_str() + 7u);
+  }
+
+  // Rows go top to bottom with -Y, bottom to top with +Y. Rotated
+  // images are not supported.
+  Str yAxis, xAxis;
+  i64 height = 0, width = 0;
+
+  std::istringstream resolution(readLine());
+  resolution >> yAxis >> height >> xAxis >> width;
+
+  if(!resolution || (yAxis != "-Y" && yAxis != "+Y") || xAxis != "+X")
+    throw std::runtime_error("HDR: unsupported image orientation");
+  if(width <= 0 || height <= 0 || width > 0xffff || height > 0xffff)
+    throw std::runtime_error("HDR: bad image size");
+
+  const bool isFlipped = yAxis == "+Y";
+
+  data::Image out;
+  out.uri    = options.uri;
+  out.format = Format::R32G32B32A32_SFLOAT;
+  out.size   = {toU32(width), toU32(height)};
+
+  auto target = query(out);
+  if(target.texels.empty()) return out;
+  target = getLevelTargets(out, target)[0];
+
+  const u64 rowSize  = getFormatRowSize(out.format, out.size[0]);
+  const u64 rowPitch = target.rowPitch ? target.rowPitch : rowSize;
+
+  static const HdrRowFn decodeRow = GetHdrRowFn();
+
+  Arr<u8>  scanline(toU64(out.size[0]) * 4u);
+  Arr<f32> row(toU64(out.size[0]) * 4u);
+
+  for(u32 y = 0u; y < out.size[1]; ++y) {
+    cursor = HdrReadScanline(scanline.data(), out.size[0], cursor, end);
+    decodeRow(row.data(), scanline.data(), out.size[0]);
+
+    const u32 dstRow = isFlipped ? out.size[1] - 1u - y : y;
+    memcpy(
+      target.texels.data() + dstRow * rowPitch, row.data(), rowSize);
+  }
+
+  return out;
+}
@@ -0,0 +1,1585 @@
+#include "vuldir/DataReader.hpp"
+
+using namespace vd;
+
+// Baseline and progressive JPEG with Huffman coding and 8-bit samples.
+// Scans are split at their restart markers and the intervals decoded
+// in parallel, then the components are upsampled and converted to RGBA
+// a row at a time. The IDCT, upsampling and color conversion give the
+// same results as libjpeg's defaults.
+
+static constexpr u8 JpegSOI   = 0xd8u;
+static constexpr u8 JpegEOI   = 0xd9u;
+static constexpr u8 JpegSOF0  = 0xc0u;
+static constexpr u8 JpegSOF1  = 0xc1u;
+static constexpr u8 JpegSOF2  = 0xc2u;
+static constexpr u8 JpegDHT   = 0xc4u;
+static constexpr u8 JpegDAC   = 0xccu;
+static constexpr u8 JpegRST0  = 0xd0u;
+static constexpr u8 JpegRST7  = 0xd7u;
+static constexpr u8 JpegSOS   = 0xdau;
+static constexpr u8 JpegDQT   = 0xdbu;
+static constexpr u8 JpegDRI   = 0xddu;
+static constexpr u8 JpegAPP0  = 0xe0u;
+static constexpr u8 JpegAPP14 = 0xeeu;
+
+// Natural order index of each zigzag position.
+static constexpr u8 JpegZigZag[64] = {
+  0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+static inline i16 JpegClampCoef(i32 value)
+{
+  return toI16(std::clamp(value, -32768, 32767));
+}
+
+static inline u8 JpegClampSample(i32 value)
+{
+  return toU8(std::clamp(value, 0, 255));
+}
+
+// Entropy-coded data of a restart interval, read most significant bit
+// first. The zero bytes stuffed after 0xff are dropped, the data ends
+// at the first marker and reads as zeros from there, like libjpeg.
+class JpegBitReader
+{
+public:
+  JpegBitReader(Span<u8 const> data):
+    m_cursor{data.data()},
+    m_end{data.data() + data.size()},
+    m_buffer{0u},
+    m_bufferSize{0u}
+  {}
+
+  // Between 1 and 16 bits.
+  [[nodiscard]] u32 Peek(u32 count)
+  {
+    if(m_bufferSize < count) Refill();
+    return toU32(m_buffer >> (64u - count));
+  }
+
+  void Skip(u32 count)
+  {
+    m_buffer <<= count;
+    m_bufferSize -= count;
+  }
+
+  [[nodiscard]] u32 Read(u32 count)
+  {
+    auto value = Peek(count);
+    Skip(count);
+    return value;
+  }
+
+  // Reads a coefficient stored as count bits, the lower half of the
+  // range is negative.
+  [[nodiscard]] i32 ReadSigned(u32 count)
+  {
+    const i32 value = toI32(Read(count));
+    return value < (1 << (count - 1u)) ? value - (1 << count) + 1
+                                       : value;
+  }
+
+  // Tops up the bit buffer to at least 57 bits. Eight bytes without a
+  // 0xff are loaded at once, the bits past the buffer size are loaded
+  // again by the next refill, so it is fine to leave them set.
+  void Refill()
+  {
+    if(m_end - m_cursor >= 8) {
+      u64 word;
+      memcpy(&word, m_cursor, sizeof(word));
+      if constexpr(std::endian::native == std::endian::little)
+        word = byteSwap(word);
+
+      // Some byte of ~word is zero.
+      constexpr u64 ones = 0x0101010101010101ull;
+      if(((~word - ones) & word & (ones << 7u)) == 0u) {
+        m_buffer |= word >> m_bufferSize;
+        const u32 bytes = (63u - m_bufferSize) >> 3u;
+        m_cursor += bytes;
+        m_bufferSize += bytes * 8u;
+        return;
+      }
+    }
+
+    while(m_bufferSize <= 56u) {
+      u64 byte = 0u;
+      if(m_cursor != m_end) {
+        byte = *m_cursor++;
+        if(byte == 0xffu) {
+          if(m_cursor != m_end && *m_cursor == 0u) {
+            ++m_cursor;
+          } else {
+            byte     = 0u;
+            m_cursor = m_end;
+          }
+        }
+      }
+
+      m_buffer |= byte << (56u - m_bufferSize);
+      m_bufferSize += 8u;
+    }
+  }
+
+private:
+  const u8* m_cursor;
+  const u8* m_end;
+  u64       m_buffer;
+  u32       m_bufferSize;
+};
+
+static constexpr u32 JpegFastBits = 9u;
+
+// Canonical Huffman table. Codes up to JpegFastBits long are resolved
+// with a single lookup, longer ones by comparing against the end of
+// each code length. AC tables also decode the run, size and value of
+// short coefficients with a single lookup.
+struct JpegHuffmanTable {
+  // Code length above the symbol, zero for longer codes.
+  SArr<u16, 1u << JpegFastBits> fast;
+  // Value, run and total length of the coefficient in 8, 4 and 4
+  // bits, zero when it doesn't fit.
+  SArr<i16, 1u << JpegFastBits> fastAc;
+  // End of the codes of each length, left aligned to 16 bits.
+  SArr<u32, 18> maxCode;
+  // Added to a code to get the index of its symbol.
+  SArr<i32, 17> delta;
+  SArr<u8, 256> symbols;
+  bool          isDefined = false;
+
+  u32 Decode(JpegBitReader& bits) const
+  {
+    const u32 code = bits.Peek(16u);
+
+    const u16 entry = fast[code >> (16u - JpegFastBits)];
+    if(entry != 0u) {
+      bits.Skip(entry >> 8);
+      return entry & 0xffu;
+    }
+
+    u32 length = JpegFastBits + 1u;
+    while(code >= maxCode[length]) ++length;
+    if(length > 16u)
+      throw std::runtime_error("JPEG: bad Huffman code");
+
+    bits.Skip(length);
+    const i32 index = toI32(code >> (16u - length)) + delta[length];
+    return symbols[toU32(index)];
+  }
+};
+
+static void JpegReadHuffman(
+  Span<u8 const> segment, SArr<JpegHuffmanTable, 4>& dcTables,
+  SArr<JpegHuffmanTable, 4>& acTables)
+{
+  u64 offset = 0u;
+  while(offset < segment.size()) {
+    if(segment.size() - offset < 17u)
+      throw std::runtime_error("JPEG: bad Huffman table");
+
+    const u32 type  = segment[offset] >> 4;
+    const u32 index = segment[offset] & 0xfu;
+    if(type > 1u || index > 3u)
+      throw std::runtime_error("JPEG: bad Huffman table");
+
+    const u8* counts = segment.data() + offset + 1u;
+    offset += 17u;
+
+    u32 symbolCount = 0u;
+    for(u32 length = 0u; length < 16u; ++length)
+      symbolCount += counts[length];
+    if(symbolCount > 256u || segment.size() - offset < symbolCount)
+      throw std::runtime_error("JPEG: bad Huffman table");
+
+    auto& table = type == 0u ? dcTables[index] : acTables[index];
+    table.fast.fill(0u);
+    table.fastAc.fill(0);
+    std::copy_n(
+      segment.data() + offset, symbolCount, table.symbols.begin());
+    offset += symbolCount;
+
+    u32 code   = 0u;
+    u32 symbol = 0u;
+    for(u32 length = 1u; length <= 16u; ++length) {
+      table.delta[length] = toI32(symbol) - toI32(code);
+
+      for(u32 idx = 0u; idx < counts[length - 1u]; ++idx) {
+        if(code >= (1u << length))
+          throw std::runtime_error(
+            "JPEG: over-subscribed Huffman code");
+
+        if(length <= JpegFastBits) {
+          const u32 shift = JpegFastBits - length;
+          std::fill_n(
+            table.fast.begin() + (code << shift), 1u << shift,
+            toU16((length << 8) | table.symbols[symbol]));
+        }
+        ++code;
+        ++symbol;
+      }
+
+      table.maxCode[length] = code << (16u - length);
+      code <<= 1;
+    }
+    table.maxCode[17] = MaxU32;
+
+    // The coefficient bits follow the code in the same lookup.
+    for(u32 idx = 0u; type == 1u && idx < table.fast.size(); ++idx) {
+      const u32 entry = table.fast[idx];
+      const u32 size  = entry & 0xfu;
+      const u32 total = (entry >> 8) + size;
+      if(entry == 0u || size == 0u || total > JpegFastBits) continue;
+
+      i32 value = toI32((idx << (entry >> 8)) & 0x1ffu) >>
+                  (JpegFastBits - size);
+      if(value < (1 << (size - 1u))) value -= (1 << size) - 1;
+      if(value < -128 || value > 127) continue;
+
+      const u32 run = (entry >> 4) & 0xfu;
+      table.fastAc[idx] = toI16(value * 256 + toI32(run * 16u + total));
+    }
+
+    table.isDefined = true;
+  }
+}
+
+static void
+JpegReadQuant(Span<u8 const> segment, SArr<SArr<u16, 64>, 4>& tables)
+{
+  u64 offset = 0u;
+  while(offset < segment.size()) {
+    const u32 precision = segment[offset] >> 4;
+    const u32 index     = segment[offset] & 0xfu;
+    const u64 size      = precision == 0u ? 64u : 128u;
+    ++offset;
+
+    if(precision > 1u || index > 3u || segment.size() - offset < size)
+      throw std::runtime_error("JPEG: bad quantization table");
+
+    // Kept in zigzag order, like the coefficients are stored.
+    for(u32 idx = 0u; idx < 64u; ++idx) {
+      tables[index][idx] =
+        precision == 0u
+          ? segment[offset + idx]
+          : toU16(
+              (segment[offset + idx * 2u] << 8) |
+              segment[offset + idx * 2u + 1u]);
+    }
+    offset += size;
+  }
+}
+
+// The two passes of libjpeg's accurate integer IDCT (jidctint.c), with
+// 13 bit factors. The first pass keeps 2 extra bits and its results
+// are clamped to 16 bits, which keeps every sum within 32 bits.
+using JpegIdctFn =
+  void (*)(const i16* coefs, u8* dst, u64 stride, u32 count);
+
+static constexpr i32 JpegFix0298 = 2446;
+static constexpr i32 JpegFix0390 = 3196;
+static constexpr i32 JpegFix0541 = 4433;
+static constexpr i32 JpegFix0765 = 6270;
+static constexpr i32 JpegFix0899 = 7373;
+static constexpr i32 JpegFix1175 = 9633;
+static constexpr i32 JpegFix1501 = 12299;
+static constexpr i32 JpegFix1847 = 15137;
+static constexpr i32 JpegFix1961 = 16069;
+static constexpr i32 JpegFix2053 = 16819;
+static constexpr i32 JpegFix2562 = 20995;
+static constexpr i32 JpegFix3072 = 25172;
+
+// The outputs are scaled by 2^13.
+static inline void JpegIdct1D(const i32* in, i32* out)
+{
+  const i32 z1   = (in[2] + in[6]) * JpegFix0541;
+  const i32 tmp2 = z1 - in[6] * JpegFix1847;
+  const i32 tmp3 = z1 + in[2] * JpegFix0765;
+  const i32 tmp0 = (in[0] + in[4]) * 8192;
+  const i32 tmp1 = (in[0] - in[4]) * 8192;
+
+  const i32 tmp10 = tmp0 + tmp3;
+  const i32 tmp13 = tmp0 - tmp3;
+  const i32 tmp11 = tmp1 + tmp2;
+  const i32 tmp12 = tmp1 - tmp2;
+
+  const i32 z5 = (in[7] + in[5] + in[3] + in[1]) * JpegFix1175;
+  const i32 za = (in[7] + in[1]) * -JpegFix0899;
+  const i32 zb = (in[5] + in[3]) * -JpegFix2562;
+  const i32 zc = (in[7] + in[3]) * -JpegFix1961 + z5;
+  const i32 zd = (in[5] + in[1]) * -JpegFix0390 + z5;
+
+  const i32 odd0 = in[7] * JpegFix0298 + za + zc;
+  const i32 odd1 = in[5] * JpegFix2053 + zb + zd;
+  const i32 odd2 = in[3] * JpegFix3072 + zb + zc;
+  const i32 odd3 = in[1] * JpegFix1501 + za + zd;
+
+  out[0] = tmp10 + odd3;
+  out[7] = tmp10 - odd3;
+  out[1] = tmp11 + odd2;
+  out[6] = tmp11 - odd2;
+  out[2] = tmp12 + odd1;
+  out[5] = tmp12 - odd1;
+  out[3] = tmp13 + odd0;
+  out[4] = tmp13 - odd0;
+}
+
+// Blocks are next to each other, the coefficients in natural order.
+static void JpegIdct(const i16* coefs, u8* dst, u64 stride, u32 count)
+{
+  for(u32 block = 0u; block < count; ++block) {
+    i32 work[64];
+    i32 in[8];
+    i32 out[8];
+
+    for(u32 col = 0u; col < 8u; ++col) {
+      for(u32 row = 0u; row < 8u; ++row)
+        in[row] = coefs[row * 8u + col];
+      JpegIdct1D(in, out);
+      for(u32 row = 0u; row < 8u; ++row)
+        work[row * 8u + col] = JpegClampCoef((out[row] + 1024) >> 11);
+    }
+
+    for(u32 row = 0u; row < 8u; ++row) {
+      JpegIdct1D(work + row * 8u, out);
+      for(u32 col = 0u; col < 8u; ++col)
+        dst[row * stride + col] =
+          JpegClampSample(((out[col] + (1 << 17)) >> 18) + 128);
+    }
+
+    coefs += 64u;
+    dst += 8u;
+  }
+}
+
+// The IDCT of a block with only the DC coefficient.
+static void JpegFillBlock(i16 dc, u8* dst, u64 stride)
+{
+  const u8 value = JpegClampSample(((dc + 4) >> 3) + 128);
+  for(u32 row = 0u; row < 8u; ++row)
+    memset(dst + row * stride, value, 8u);
+}
+
+#ifdef VD_ARCH_X64
+
+// Each register holds a row, so the passes work on all the columns at
+// once. The factors are combined with pmaddwd on pairs of rows, the
+// products of each output add up to the same value as the scalar code.
+static inline __m128i JpegPairSSE2(i16 a, i16 b)
+{
+  return _mm_setr_epi16(a, b, a, b, a, b, a, b);
+}
+
+static inline void JpegIdctHalfSSE2(
+  __m128i p04, __m128i p26, __m128i p75, __m128i p31, __m128i (&out)[8])
+{
+  const auto tmp0 = _mm_madd_epi16(p04, JpegPairSSE2(8192, 8192));
+  const auto tmp1 = _mm_madd_epi16(p04, JpegPairSSE2(8192, -8192));
+  const auto tmp2 = _mm_madd_epi16(p26, JpegPairSSE2(4433, -10704));
+  const auto tmp3 = _mm_madd_epi16(p26, JpegPairSSE2(10703, 4433));
+
+  const auto tmp10 = _mm_add_epi32(tmp0, tmp3);
+  const auto tmp13 = _mm_sub_epi32(tmp0, tmp3);
+  const auto tmp11 = _mm_add_epi32(tmp1, tmp2);
+  const auto tmp12 = _mm_sub_epi32(tmp1, tmp2);
+
+  const auto odd0 = _mm_add_epi32(
+    _mm_madd_epi16(p75, JpegPairSSE2(-11363, 9633)),
+    _mm_madd_epi16(p31, JpegPairSSE2(-6436, 2260)));
+  const auto odd1 = _mm_add_epi32(
+    _mm_madd_epi16(p75, JpegPairSSE2(9633, 2261)),
+    _mm_madd_epi16(p31, JpegPairSSE2(-11362, 6437)));
+  const auto odd2 = _mm_add_epi32(
+    _mm_madd_epi16(p75, JpegPairSSE2(-6436, -11362)),
+    _mm_madd_epi16(p31, JpegPairSSE2(-2259, 9633)));
+  const auto odd3 = _mm_add_epi32(
+    _mm_madd_epi16(p75, JpegPairSSE2(2260, 6437)),
+    _mm_madd_epi16(p31, JpegPairSSE2(9633, 11363)));
+
+  out[0] = _mm_add_epi32(tmp10, odd3);
+  out[7] = _mm_sub_epi32(tmp10, odd3);
+  out[1] = _mm_add_epi32(tmp11, odd2);
+  out[6] = _mm_sub_epi32(tmp11, odd2);
+  out[2] = _mm_add_epi32(tmp12, odd1);
+  out[5] = _mm_sub_epi32(tmp12, odd1);
+  out[3] = _mm_add_epi32(tmp13, odd0);
+  out[4] = _mm_sub_epi32(tmp13, odd0);
+}
+
+template<i32 Shift>
+static inline void JpegIdctPassSSE2(__m128i (&rows)[8])
+{
+  __m128i lo[8];
+  __m128i hi[8];
+
+  JpegIdctHalfSSE2(
+    _mm_unpacklo_epi16(rows[0], rows[4]),
+    _mm_unpacklo_epi16(rows[2], rows[6]),
+    _mm_unpacklo_epi16(rows[7], rows[5]),
+    _mm_unpacklo_epi16(rows[3], rows[1]), lo);
+  JpegIdctHalfSSE2(
+    _mm_unpackhi_epi16(rows[0], rows[4]),
+    _mm_unpackhi_epi16(rows[2], rows[6]),
+    _mm_unpackhi_epi16(rows[7], rows[5]),
+    _mm_unpackhi_epi16(rows[3], rows[1]), hi);
+
+  const auto round = _mm_set1_epi32(1 << (Shift - 1));
+  for(u32 idx = 0u; idx < 8u; ++idx)
+    rows[idx] = _mm_packs_epi32(
+      _mm_srai_epi32(_mm_add_epi32(lo[idx], round), Shift),
+      _mm_srai_epi32(_mm_add_epi32(hi[idx], round), Shift));
+}
+
+static inline void JpegTransposeSSE2(__m128i (&rows)[8])
+{
+  __m128i a[8];
+  __m128i b[8];
+  for(u32 idx = 0u; idx < 4u; ++idx) {
+    a[idx * 2u] =
+      _mm_unpacklo_epi16(rows[idx * 2u], rows[idx * 2u + 1u]);
+    a[idx * 2u + 1u] =
+      _mm_unpackhi_epi16(rows[idx * 2u], rows[idx * 2u + 1u]);
+  }
+  for(u32 idx = 0u; idx < 2u; ++idx) {
+    b[idx * 4u + 0u] =
+      _mm_unpacklo_epi32(a[idx * 4u], a[idx * 4u + 2u]);
+    b[idx * 4u + 1u] =
+      _mm_unpackhi_epi32(a[idx * 4u], a[idx * 4u + 2u]);
+    b[idx * 4u + 2u] =
+      _mm_unpacklo_epi32(a[idx * 4u + 1u], a[idx * 4u + 3u]);
+    b[idx * 4u + 3u] =
+      _mm_unpackhi_epi32(a[idx * 4u + 1u], a[idx * 4u + 3u]);
+  }
+  for(u32 idx = 0u; idx < 4u; ++idx) {
+    rows[idx * 2u]      = _mm_unpacklo_epi64(b[idx], b[idx + 4u]);
+    rows[idx * 2u + 1u] = _mm_unpackhi_epi64(b[idx], b[idx + 4u]);
+  }
+}
+
+static void
+JpegIdctSSE2(const i16* coefs, u8* dst, u64 stride, u32 count)
+{
+  for(u32 block = 0u; block < count; ++block) {
+    __m128i rows[8];
+    for(u32 row = 0u; row < 8u; ++row)
+      rows[row] = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(coefs + row * 8u));
+
+    JpegIdctPassSSE2<11>(rows);
+    JpegTransposeSSE2(rows);
+    JpegIdctPassSSE2<18>(rows);
+    JpegTransposeSSE2(rows);
+
+    const auto center = _mm_set1_epi16(128);
+    for(u32 row = 0u; row < 8u; row += 2u) {
+      const auto samples = _mm_packus_epi16(
+        _mm_adds_epi16(rows[row], center),
+        _mm_adds_epi16(rows[row + 1u], center));
+      _mm_storel_epi64(
+        reinterpret_cast<__m128i*>(dst + row * stride), samples);
+      _mm_storel_epi64(
+        reinterpret_cast<__m128i*>(dst + (row + 1u) * stride),
+        _mm_unpackhi_epi64(samples, samples));
+    }
+
+    coefs += 64u;
+    dst += 8u;
+  }
+}
+
+// Same as the SSE2 version, with a block in each 128-bit lane.
+VD_TARGET("avx2")
+static inline __m256i JpegPairAVX2(i16 a, i16 b)
+{
+  return _mm256_setr_epi16(
+    a, b, a, b, a, b, a, b, a, b, a, b, a, b, a, b);
+}
+
+VD_TARGET("avx2")
+static inline void JpegIdctHalfAVX2(
+  __m256i p04, __m256i p26, __m256i p75, __m256i p31, __m256i (&out)[8])
+{
+  const auto tmp0 = _mm256_madd_epi16(p04, JpegPairAVX2(8192, 8192));
+  const auto tmp1 = _mm256_madd_epi16(p04, JpegPairAVX2(8192, -8192));
+  const auto tmp2 = _mm256_madd_epi16(p26, JpegPairAVX2(4433, -10704));
+  const auto tmp3 = _mm256_madd_epi16(p26, JpegPairAVX2(10703, 4433));
+
+  const auto tmp10 = _mm256_add_epi32(tmp0, tmp3);
+  const auto tmp13 = _mm256_sub_epi32(tmp0, tmp3);
+  const auto tmp11 = _mm256_add_epi32(tmp1, tmp2);
+  const auto tmp12 = _mm256_sub_epi32(tmp1, tmp2);
+
+  const auto odd0 = _mm256_add_epi32(
+    _mm256_madd_epi16(p75, JpegPairAVX2(-11363, 9633)),
+    _mm256_madd_epi16(p31, JpegPairAVX2(-6436, 2260)));
+  const auto odd1 = _mm256_add_epi32(
+    _mm256_madd_epi16(p75, JpegPairAVX2(9633, 2261)),
+    _mm256_madd_epi16(p31, JpegPairAVX2(-11362, 6437)));
+  const auto odd2 = _mm256_add_epi32(
+    _mm256_madd_epi16(p75, JpegPairAVX2(-6436, -11362)),
+    _mm256_madd_epi16(p31, JpegPairAVX2(-2259, 9633)));
+  const auto odd3 = _mm256_add_epi32(
+    _mm256_madd_epi16(p75, JpegPairAVX2(2260, 6437)),
+    _mm256_madd_epi16(p31, JpegPairAVX2(9633, 11363)));
+
+  out[0] = _mm256_add_epi32(tmp10, odd3);
+  out[7] = _mm256_sub_epi32(tmp10, odd3);
+  out[1] = _mm256_add_epi32(tmp11, odd2);
+  out[6] = _mm256_sub_epi32(tmp11, odd2);
+  out[2] = _mm256_add_epi32(tmp12, odd1);
+  out[5] = _mm256_sub_epi32(tmp12, odd1);
+  out[3] = _mm256_add_epi32(tmp13, odd0);
+  out[4] = _mm256_sub_epi32(tmp13, odd0);
+}
+
+template<i32 Shift>
+VD_TARGET("avx2")
+static inline void JpegIdctPassAVX2(__m256i (&rows)[8])
+{
+  __m256i lo[8];
+  __m256i hi[8];
+
+  JpegIdctHalfAVX2(
+    _mm256_unpacklo_epi16(rows[0], rows[4]),
+    _mm256_unpacklo_epi16(rows[2], rows[6]),
+    _mm256_unpacklo_epi16(rows[7], rows[5]),
+    _mm256_unpacklo_epi16(rows[3], rows[1]), lo);
+  JpegIdctHalfAVX2(
+    _mm256_unpackhi_epi16(rows[0], rows[4]),
+    _mm256_unpackhi_epi16(rows[2], rows[6]),
+    _mm256_unpackhi_epi16(rows[7], rows[5]),
+    _mm256_unpackhi_epi16(rows[3], rows[1]), hi);
+
+  const auto round = _mm256_set1_epi32(1 << (Shift - 1));
+  for(u32 idx = 0u; idx < 8u; ++idx)
+    rows[idx] = _mm256_packs_epi32(
+      _mm256_srai_epi32(_mm256_add_epi32(lo[idx], round), Shift),
+      _mm256_srai_epi32(_mm256_add_epi32(hi[idx], round), Shift));
+}
+
+VD_TARGET("avx2")
+static inline void JpegTransposeAVX2(__m256i (&rows)[8])
+{
+  __m256i a[8];
+  __m256i b[8];
+  for(u32 idx = 0u; idx < 4u; ++idx) {
+    a[idx * 2u] =
+      _mm256_unpacklo_epi16(rows[idx * 2u], rows[idx * 2u + 1u]);
+    a[idx * 2u + 1u] =
+      _mm256_unpackhi_epi16(rows[idx * 2u], rows[idx * 2u + 1u]);
+  }
+  for(u32 idx = 0u; idx < 2u; ++idx) {
+    b[idx * 4u + 0u] =
+      _mm256_unpacklo_epi32(a[idx * 4u], a[idx * 4u + 2u]);
+    b[idx * 4u + 1u] =
+      _mm256_unpackhi_epi32(a[idx * 4u], a[idx * 4u + 2u]);
+    b[idx * 4u + 2u] =
+      _mm256_unpacklo_epi32(a[idx * 4u + 1u], a[idx * 4u + 3u]);
+    b[idx * 4u + 3u] =
+      _mm256_unpackhi_epi32(a[idx * 4u + 1u], a[idx * 4u + 3u]);
+  }
+  for(u32 idx = 0u; idx < 4u; ++idx) {
+    rows[idx * 2u]      = _mm256_unpacklo_epi64(b[idx], b[idx + 4u]);
+    rows[idx * 2u + 1u] = _mm256_unpackhi_epi64(b[idx], b[idx + 4u]);
+  }
+}
+
+VD_TARGET("avx2")
+static void
+JpegIdctAVX2(const i16* coefs, u8* dst, u64 stride, u32 count)
+{
+  u32 block = 0u;
+  for(; block + 2u <= count; block += 2u) {
+    __m256i rows[8];
+    for(u32 row = 0u; row < 8u; ++row)
+      rows[row] = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(coefs + row * 8u))),
+        _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(coefs + 64u + row * 8u)),
+        1);
+
+    JpegIdctPassAVX2<11>(rows);
+    JpegTransposeAVX2(rows);
+    JpegIdctPassAVX2<18>(rows);
+    JpegTransposeAVX2(rows);
+
+    // Rows of the two blocks are side by side in the destination.
+    const auto center = _mm256_set1_epi16(128);
+    for(u32 row = 0u; row < 8u; row += 2u) {
+      const auto samples = _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(
+          _mm256_adds_epi16(rows[row], center),
+          _mm256_adds_epi16(rows[row + 1u], center)),
+        0xd8);
+      _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst + row * stride),
+        _mm256_castsi256_si128(samples));
+      _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst + (row + 1u) * stride),
+        _mm256_extracti128_si256(samples, 1));
+    }
+
+    coefs += 128u;
+    dst += 16u;
+  }
+
+  if(block < count) JpegIdctSSE2(coefs, dst, stride, 1u);
+}
+
+#endif
+
+static JpegIdctFn GetJpegIdct()
+{
+#ifdef VD_ARCH_X64
+  const auto& cpu = getCpuFeatures();
+  if(cpu.avx2) return &JpegIdctAVX2;
+  if(cpu.sse2) return &JpegIdctSSE2;
+#endif
+  return &JpegIdct;
+}
+
+// libjpeg's fixed point YCbCr to RGB conversion, with 16 fractional
+// bits: R = Y + 1.402 Cr, G = Y - 0.34414 Cb - 0.71414 Cr and
+// B = Y + 1.772 Cb.
+using JpegConvertFn = void (*)(
+  const u8* y, const u8* cb, const u8* cr, u8* dst, u32 width,
+  u8 alpha);
+
+static void JpegConvertYCbCr(
+  const u8* y, const u8* cb, const u8* cr, u8* dst, u32 width,
+  u8 alpha)
+{
+  for(u32 x = 0u; x < width; ++x) {
+    const i32 luma = y[x];
+    const i32 blue = cb[x] - 128;
+    const i32 red  = cr[x] - 128;
+
+    dst[x * 4u + 0u] =
+      JpegClampSample(luma + ((91881 * red + 32768) >> 16));
+    dst[x * 4u + 1u] = JpegClampSample(
+      luma + ((-22554 * blue - 46802 * red + 32768) >> 16));
+    dst[x * 4u + 2u] =
+      JpegClampSample(luma + ((116130 * blue + 32768) >> 16));
+    dst[x * 4u + 3u] = alpha;
+  }
+}
+
+#ifdef VD_ARCH_X64
+
+// The factors above 1 are split into a whole part and a fraction that
+// fits pmaddwd, paired with a constant 2 for the rounding term:
+// 1.402 = 1 + 26345 / 2^16, -0.71414 = -1 + 18734 / 2^16 and
+// 1.772 = 2 - 14942 / 2^16.
+static void JpegConvertYCbCrSSE2(
+  const u8* y, const u8* cb, const u8* cr, u8* dst, u32 width,
+  u8 alpha)
+{
+  const auto zero   = _mm_setzero_si128();
+  const auto center = _mm_set1_epi16(128);
+  const auto two    = _mm_set1_epi16(2);
+  const auto half   = _mm_set1_epi32(32768);
+  const auto opaque = _mm_set1_epi8(static_cast<char>(alpha));
+
+  const auto redFactor   = _mm_setr_epi16(
+    26345, 16384, 26345, 16384, 26345, 16384, 26345, 16384);
+  const auto greenFactor = _mm_setr_epi16(
+    -22554, 18734, -22554, 18734, -22554, 18734, -22554, 18734);
+  const auto blueFactor  = _mm_setr_epi16(
+    -14942, 16384, -14942, 16384, -14942, 16384, -14942, 16384);
+
+  const auto scale = [](__m128i lo, __m128i hi) {
+    return _mm_packs_epi32(
+      _mm_srai_epi32(lo, 16), _mm_srai_epi32(hi, 16));
+  };
+
+  u32 x = 0u;
+  for(; x + 8u <= width; x += 8u) {
+    const auto luma = _mm_unpacklo_epi8(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), zero);
+    const auto blue = _mm_sub_epi16(
+      _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + x)),
+        zero),
+      center);
+    const auto red = _mm_sub_epi16(
+      _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + x)),
+        zero),
+      center);
+
+    const auto red2  = _mm_unpacklo_epi16(red, two);
+    const auto red2h = _mm_unpackhi_epi16(red, two);
+    const auto r     = _mm_add_epi16(
+      _mm_add_epi16(luma, red),
+      scale(
+        _mm_madd_epi16(red2, redFactor),
+        _mm_madd_epi16(red2h, redFactor)));
+
+    const auto chroma  = _mm_unpacklo_epi16(blue, red);
+    const auto chromah = _mm_unpackhi_epi16(blue, red);
+    const auto g       = _mm_add_epi16(
+      _mm_sub_epi16(luma, red),
+      scale(
+        _mm_add_epi32(_mm_madd_epi16(chroma, greenFactor), half),
+        _mm_add_epi32(_mm_madd_epi16(chromah, greenFactor), half)));
+
+    const auto blue2  = _mm_unpacklo_epi16(blue, two);
+    const auto blue2h = _mm_unpackhi_epi16(blue, two);
+    const auto b      = _mm_add_epi16(
+      _mm_add_epi16(luma, _mm_add_epi16(blue, blue)),
+      scale(
+        _mm_madd_epi16(blue2, blueFactor),
+        _mm_madd_epi16(blue2h, blueFactor)));
+
+    const auto rg = _mm_unpacklo_epi8(
+      _mm_packus_epi16(r, r), _mm_packus_epi16(g, g));
+    const auto ba = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), opaque);
+
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(dst + x * 4u),
+      _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(dst + x * 4u + 16u),
+      _mm_unpackhi_epi16(rg, ba));
+  }
+
+  JpegConvertYCbCr(
+    y + x, cb + x, cr + x, dst + x * 4u, width - x, alpha);
+}
+
+#endif
+
+static JpegConvertFn GetJpegConvert()
+{
+#ifdef VD_ARCH_X64
+  if(getCpuFeatures().sse2) return &JpegConvertYCbCrSSE2;
+#endif
+  return &JpegConvertYCbCr;
+}
+
+// Inverted CMYK, as written by Adobe, multiplied back to RGB.
+static inline u8 JpegMultiply(u32 a, u32 b)
+{
+  const u32 value = a * b + 128u;
+  return toU8((value + (value >> 8)) >> 8);
+}
+
+enum class JpegColor { Gray, YCbCr, Rgb, Cmyk, Ycck };
+
+struct JpegComponent {
+  u32 id      = 0u;
+  u32 h       = 1u;
+  u32 v       = 1u;
+  u32 quant   = 0u;
+  u32 dcTable = 0u;
+  u32 acTable = 0u;
+
+  // Samples in the image and blocks in the plane, padded to whole
+  // MCUs.
+  u32 width   = 0u;
+  u32 height  = 0u;
+  u32 blocksX = 0u;
+  u32 blocksY = 0u;
+
+  Arr<u8> plane;
+  // All the blocks of progressive images, refined by each scan.
+  Arr<i16> coefs;
+
+  u64 GetStride() const { return toU64(blocksX) * 8u; }
+};
+
+struct JpegFrame {
+  u32  width       = 0u;
+  u32  height      = 0u;
+  bool progressive = false;
+  u32  hmax        = 1u;
+  u32  vmax        = 1u;
+  u32  mcusX       = 0u;
+  u32  mcusY       = 0u;
+
+  Arr<JpegComponent> components;
+
+  SArr<SArr<u16, 64>, 4>    quantTables = {};
+  SArr<JpegHuffmanTable, 4> dcTables    = {};
+  SArr<JpegHuffmanTable, 4> acTables    = {};
+
+  u32  restartInterval = 0u;
+  bool hasJfif         = false;
+  i32  adobeTransform  = -1;
+};
+
+static void JpegReadFrame(Span<u8 const> segment, JpegFrame& frame)
+{
+  if(segment.size() < 6u)
+    throw std::runtime_error("JPEG: bad frame header");
+
+  if(segment[0] != 8u)
+    throw std::runtime_error("JPEG: only 8-bit samples are supported");
+
+  frame.height = toU32((segment[1] << 8) | segment[2]);
+  frame.width  = toU32((segment[3] << 8) | segment[4]);
+  if(frame.width == 0u || frame.height == 0u)
+    throw std::runtime_error("JPEG: bad image size");
+
+  const u32 count = segment[5];
+  if(count != 1u && count != 3u && count != 4u)
+    throw std::runtime_error("JPEG: unsupported component count");
+  if(segment.size() < 6u + count * 3u)
+    throw std::runtime_error("JPEG: bad frame header");
+
+  frame.components.resize(count);
+  for(u32 idx = 0u; idx < count; ++idx) {
+    auto&     comp  = frame.components[idx];
+    const u8* entry = segment.data() + 6u + idx * 3u;
+
+    comp.id    = entry[0];
+    comp.h     = entry[1] >> 4;
+    comp.v     = entry[1] & 0xfu;
+    comp.quant = entry[2];
+
+    if(comp.h == 0u || comp.h > 4u || comp.v == 0u || comp.v > 4u)
+      throw std::runtime_error("JPEG: bad sampling factors");
+    if(comp.quant > 3u)
+      throw std::runtime_error("JPEG: bad quantization table");
+
+    frame.hmax = std::max(frame.hmax, comp.h);
+    frame.vmax = std::max(frame.vmax, comp.v);
+  }
+
+  frame.mcusX = divideRoundingUp(frame.width, frame.hmax * 8u);
+  frame.mcusY = divideRoundingUp(frame.height, frame.vmax * 8u);
+
+  for(auto& comp: frame.components) {
+    comp.width =
+      divideRoundingUp(frame.width * comp.h, frame.hmax);
+    comp.height =
+      divideRoundingUp(frame.height * comp.v, frame.vmax);
+    comp.blocksX = frame.mcusX * comp.h;
+    comp.blocksY = frame.mcusY * comp.v;
+  }
+}
+
+static JpegColor GetJpegColor(const JpegFrame& frame)
+{
+  const auto& comps = frame.components;
+  if(comps.size() == 1u) return JpegColor::Gray;
+
+  if(comps.size() == 3u) {
+    if(frame.hasJfif) return JpegColor::YCbCr;
+    if(frame.adobeTransform >= 0)
+      return frame.adobeTransform == 0 ? JpegColor::Rgb
+                                       : JpegColor::YCbCr;
+    if(comps[0].id == 'R' && comps[1].id == 'G' && comps[2].id == 'B')
+      return JpegColor::Rgb;
+    return JpegColor::YCbCr;
+  }
+
+  return frame.adobeTransform == 2 ? JpegColor::Ycck : JpegColor::Cmyk;
+}
+
+struct JpegScan {
+  u32 count = 0u;
+  u32 components[4] = {};
+  // Spectral selection and successive approximation.
+  u32 ss = 0u;
+  u32 se = 0u;
+  u32 ah = 0u;
+  u32 al = 0u;
+};
+
+static JpegScan JpegReadScan(Span<u8 const> segment, JpegFrame& frame)
+{
+  JpegScan scan;
+
+  if(segment.empty())
+    throw std::runtime_error("JPEG: bad scan header");
+
+  scan.count = segment[0];
+  if(
+    scan.count == 0u || scan.count > 4u ||
+    segment.size() != 4u + scan.count * 2u)
+    throw std::runtime_error("JPEG: bad scan header");
+
+  u32 blockCount = 0u;
+  for(u32 idx = 0u; idx < scan.count; ++idx) {
+    const u8* entry = segment.data() + 1u + idx * 2u;
+
+    auto it = std::find_if(
+      frame.components.begin(), frame.components.end(),
+      [&](const JpegComponent& comp) { return comp.id == entry[0]; });
+    if(it == frame.components.end())
+      throw std::runtime_error("JPEG: bad scan component");
+
+    it->dcTable = entry[1] >> 4;
+    it->acTable = entry[1] & 0xfu;
+    if(it->dcTable > 3u || it->acTable > 3u)
+      throw std::runtime_error("JPEG: bad Huffman table");
+
+    scan.components[idx] = toU32(it - frame.components.begin());
+    blockCount += it->h * it->v;
+  }
+
+  const u8* params = segment.data() + 1u + scan.count * 2u;
+  scan.ss          = params[0];
+  scan.se          = params[1];
+  scan.ah          = params[2] >> 4;
+  scan.al          = params[2] & 0xfu;
+
+  if(scan.count > 1u && blockCount > 10u)
+    throw std::runtime_error("JPEG: too many blocks in a MCU");
+
+  if(!frame.progressive) {
+    scan.ss = 0u;
+    scan.se = 63u;
+    scan.ah = 0u;
+    scan.al = 0u;
+  } else if(
+    scan.se > 63u || scan.ss > scan.se || scan.al > 13u ||
+    (scan.ss == 0u && scan.se != 0u) ||
+    (scan.ss != 0u && scan.count != 1u))
+    throw std::runtime_error("JPEG: bad progressive scan");
+
+  // Only the DC refinement has no Huffman coded data.
+  for(u32 idx = 0u; idx < scan.count; ++idx) {
+    const auto& comp = frame.components[scan.components[idx]];
+    if(scan.ss == 0u && scan.ah == 0u) {
+      if(!frame.dcTables[comp.dcTable].isDefined)
+        throw std::runtime_error("JPEG: missing Huffman table");
+    }
+    if(scan.se != 0u) {
+      if(!frame.acTables[comp.acTable].isDefined)
+        throw std::runtime_error("JPEG: missing Huffman table");
+    }
+  }
+
+  return scan;
+}
+
+// Splits the entropy-coded data starting at offset at its restart
+// markers. Returns the offset of the marker that ends the scan.
+static u64 JpegSplitScan(
+  Span<u8 const> bytes, u64 offset, Arr<Span<u8 const>>& intervals)
+{
+  u64 start = offset;
+  u64 pos   = offset;
+
+  for(;;) {
+    const auto* marker = static_cast<const u8*>(
+      memchr(bytes.data() + pos, 0xff, bytes.size() - pos));
+    if(!marker) {
+      intervals.push_back(bytes.subspan(start));
+      return bytes.size();
+    }
+
+    // Markers can be preceded by any number of 0xff.
+    pos      = toU64(marker - bytes.data());
+    u64 next = pos + 1u;
+    while(next < bytes.size() && bytes[next] == 0xffu) ++next;
+
+    if(next < bytes.size() && bytes[next] == 0u) {
+      pos = next + 1u;
+      continue;
+    }
+
+    intervals.push_back(bytes.subspan(start, pos - start));
+
+    if(
+      next == bytes.size() || bytes[next] < JpegRST0 ||
+      bytes[next] > JpegRST7)
+      return pos;
+
+    start = pos = next + 1u;
+  }
+}
+
+// Returns whether any AC coefficient is set.
+static bool JpegDecodeBlock(
+  JpegBitReader& bits, const JpegHuffmanTable& dc,
+  const JpegHuffmanTable& ac, const u16* quant, i32& dcPred, i16* block)
+{
+  const u32 size = dc.Decode(bits);
+  if(size > 15u) throw std::runtime_error("JPEG: bad DC coefficient");
+
+  dcPred = JpegClampCoef(dcPred + (size ? bits.ReadSigned(size) : 0));
+  block[0] = JpegClampCoef(dcPred * quant[0]);
+
+  bool hasAc = false;
+  for(u32 k = 1u; k < 64u;) {
+    const i16 fast = ac.fastAc[bits.Peek(JpegFastBits)];
+    if(fast != 0) {
+      k += toU32((fast >> 4) & 0xf);
+      bits.Skip(toU32(fast & 0xf));
+      if(k > 63u) throw std::runtime_error("JPEG: bad AC coefficient");
+
+      block[JpegZigZag[k]] = JpegClampCoef((fast >> 8) * quant[k]);
+      hasAc                = true;
+      ++k;
+      continue;
+    }
+
+    const u32 symbol = ac.Decode(bits);
+    const u32 run    = symbol >> 4;
+    const u32 bitCount = symbol & 0xfu;
+
+    if(bitCount == 0u) {
+      if(run != 15u) break;
+      k += 16u;
+      continue;
+    }
+
+    k += run;
+    if(k > 63u) throw std::runtime_error("JPEG: bad AC coefficient");
+
+    block[JpegZigZag[k]] =
+      JpegClampCoef(bits.ReadSigned(bitCount) * quant[k]);
+    hasAc = true;
+    ++k;
+  }
+
+  return hasAc;
+}
+
+// Progressive scans, the coefficients are kept quantized until all the
+// scans are done.
+static void JpegDecodeDCFirst(
+  JpegBitReader& bits, const JpegHuffmanTable& dc, u32 al, i32& dcPred,
+  i16* block)
+{
+  const u32 size = dc.Decode(bits);
+  if(size > 15u) throw std::runtime_error("JPEG: bad DC coefficient");
+
+  dcPred   = JpegClampCoef(dcPred + (size ? bits.ReadSigned(size) : 0));
+  block[0] = JpegClampCoef(dcPred * (1 << al));
+}
+
+static void JpegDecodeDCRefine(JpegBitReader& bits, u32 al, i16* block)
+{
+  if(bits.Read(1u)) block[0] = toI16(block[0] | (1 << al));
+}
+
+static void JpegDecodeACFirst(
+  JpegBitReader& bits, const JpegHuffmanTable& ac, const JpegScan& scan,
+  u32& eobRun, i16* block)
+{
+  if(eobRun > 0u) {
+    --eobRun;
+    return;
+  }
+
+  for(u32 k = scan.ss; k <= scan.se;) {
+    const u32 symbol   = ac.Decode(bits);
+    const u32 run      = symbol >> 4;
+    const u32 bitCount = symbol & 0xfu;
+
+    if(bitCount == 0u) {
+      if(run < 15u) {
+        // This block is the first of the run.
+        eobRun = (1u << run) - 1u;
+        if(run > 0u) eobRun += bits.Read(run);
+        break;
+      }
+      k += 16u;
+      continue;
+    }
+
+    k += run;
+    if(k > scan.se)
+      throw std::runtime_error("JPEG: bad AC coefficient");
+
+    block[JpegZigZag[k]] =
+      JpegClampCoef(bits.ReadSigned(bitCount) * (1 << scan.al));
+    ++k;
+  }
+}
+
+// Adds a bit to a coefficient that is already set, away from zero.
+static inline void
+JpegRefineCoef(JpegBitReader& bits, i16& coef, i32 bit)
+{
+  if(bits.Read(1u) && (coef & bit) == 0)
+    coef = JpegClampCoef(coef >= 0 ? coef + bit : coef - bit);
+}
+
+static void JpegDecodeACRefine(
+  JpegBitReader& bits, const JpegHuffmanTable& ac, const JpegScan& scan,
+  u32& eobRun, i16* block)
+{
+  const i32 bit = 1 << scan.al;
+
+  u32 k = scan.ss;
+  if(eobRun == 0u) {
+    for(; k <= scan.se; ++k) {
+      const u32 symbol = ac.Decode(bits);
+      i32       run    = toI32(symbol >> 4);
+      i32       value  = 0;
+
+      if((symbol & 0xfu) != 0u) {
+        if((symbol & 0xfu) != 1u)
+          throw std::runtime_error("JPEG: bad AC refinement");
+        value = bits.Read(1u) ? bit : -bit;
+      } else if(run != 15) {
+        eobRun = 1u << run;
+        if(run > 0) eobRun += bits.Read(toU32(run));
+        break;
+      }
+
+      // Skips the zero coefficients of the run, the ones already set
+      // get their next bit.
+      for(; k <= scan.se; ++k) {
+        auto& coef = block[JpegZigZag[k]];
+        if(coef != 0) JpegRefineCoef(bits, coef, bit);
+        else if(run-- == 0)
+          break;
+      }
+
+      if(value != 0) {
+        if(k > scan.se)
+          throw std::runtime_error("JPEG: bad AC refinement");
+        block[JpegZigZag[k]] = toI16(value);
+      }
+    }
+  }
+
+  if(eobRun > 0u) {
+    for(; k <= scan.se; ++k) {
+      auto& coef = block[JpegZigZag[k]];
+      if(coef != 0) JpegRefineCoef(bits, coef, bit);
+    }
+    --eobRun;
+  }
+}
+
+// Decodes the MCUs of a restart interval. Sequential scans are written
+// to the component planes right away.
+static void JpegDecodeInterval(
+  JpegFrame& frame, const JpegScan& scan, Span<u8 const> data,
+  u64 firstMcu, u64 mcuCount, JpegIdctFn idct)
+{
+  JpegBitReader bits(data);
+
+  i32 dcPreds[4] = {};
+  u32 eobRun     = 0u;
+
+  // Scans of a single component have a block per MCU and no padding.
+  const bool isSingle = scan.count == 1u;
+  const u32  mcusX =
+    isSingle ? divideRoundingUp(
+                 frame.components[scan.components[0]].width, 8u)
+             : frame.mcusX;
+
+  alignas(32) i16 coefs[4 * 64];
+
+  for(u64 mcu = firstMcu; mcu < firstMcu + mcuCount; ++mcu) {
+    const u32 mcuX = toU32(mcu % mcusX);
+    const u32 mcuY = toU32(mcu / mcusX);
+
+    for(u32 idx = 0u; idx < scan.count; ++idx) {
+      auto&       comp = frame.components[scan.components[idx]];
+      const auto& dc   = frame.dcTables[comp.dcTable];
+      const auto& ac   = frame.acTables[comp.acTable];
+      const u32   h    = isSingle ? 1u : comp.h;
+      const u32   v    = isSingle ? 1u : comp.v;
+
+      for(u32 by = 0u; by < v; ++by) {
+        const u32 blockX = mcuX * h;
+        const u32 blockY = mcuY * v + by;
+
+        if(frame.progressive) {
+          i16* block = comp.coefs.data() +
+                       (toU64(blockY) * comp.blocksX + blockX) * 64u;
+
+          for(u32 bx = 0u; bx < h; ++bx, block += 64) {
+            if(scan.ss == 0u) {
+              if(scan.ah == 0u)
+                JpegDecodeDCFirst(
+                  bits, dc, scan.al, dcPreds[idx], block);
+              else
+                JpegDecodeDCRefine(bits, scan.al, block);
+            } else {
+              if(scan.ah == 0u)
+                JpegDecodeACFirst(bits, ac, scan, eobRun, block);
+              else
+                JpegDecodeACRefine(bits, ac, scan, eobRun, block);
+            }
+          }
+          continue;
+        }
+
+        const u16* quant = frame.quantTables[comp.quant].data();
+
+        bool hasAc = false;
+        memset(coefs, 0, h * 64u * sizeof(i16));
+        for(u32 bx = 0u; bx < h; ++bx) {
+          if(JpegDecodeBlock(
+               bits, dc, ac, quant, dcPreds[idx], coefs + bx * 64u))
+            hasAc = true;
+        }
+
+        const u64 stride = comp.GetStride();
+        u8* dst = comp.plane.data() + toU64(blockY) * 8u * stride +
+                  toU64(blockX) * 8u;
+
+        if(hasAc) {
+          idct(coefs, dst, stride, h);
+        } else {
+          for(u32 bx = 0u; bx < h; ++bx)
+            JpegFillBlock(coefs[bx * 64u], dst + bx * 8u, stride);
+        }
+      }
+    }
+  }
+}
+
+// Each restart interval starts from scratch, so they are decoded in
+// parallel. Missing intervals read as zeros.
+static void JpegDecodeScan(
+  JpegFrame& frame, const JpegScan& scan,
+  const Arr<Span<u8 const>>& intervals, u32 threadCount)
+{
+  static const JpegIdctFn idct = GetJpegIdct();
+
+  u64 mcuCount = toU64(frame.mcusX) * frame.mcusY;
+  if(scan.count == 1u) {
+    const auto& comp = frame.components[scan.components[0]];
+    mcuCount         = toU64(divideRoundingUp(comp.width, 8u)) *
+               divideRoundingUp(comp.height, 8u);
+  }
+
+  const u64 intervalSize =
+    frame.restartInterval ? frame.restartInterval : mcuCount;
+  const u64 intervalCount = divideRoundingUp(mcuCount, intervalSize);
+
+  runJobs(intervalCount, threadCount, [&](u64 idx) {
+    const u64 firstMcu = idx * intervalSize;
+    JpegDecodeInterval(
+      frame, scan,
+      idx < intervals.size() ? intervals[idx] : Span<u8 const>{},
+      firstMcu, std::min(intervalSize, mcuCount - firstMcu), idct);
+  });
+}
+
+// Dequantizes and transforms the coefficients of progressive images,
+// a row of blocks at a time.
+static void JpegFinishProgressive(JpegFrame& frame, u32 threadCount)
+{
+  static const JpegIdctFn idct = GetJpegIdct();
+
+  struct Job {
+    u32 component;
+    u32 row;
+  };
+
+  Arr<Job> jobs;
+  for(u32 idx = 0u; idx < frame.components.size(); ++idx)
+    for(u32 row = 0u; row < frame.components[idx].blocksY; ++row)
+      jobs.push_back({idx, row});
+
+  runJobs(jobs.size(), threadCount, [&](u64 jobIdx) {
+    auto&      comp  = frame.components[jobs[jobIdx].component];
+    const u32  row   = jobs[jobIdx].row;
+    const u16* quant = frame.quantTables[comp.quant].data();
+
+    Arr<i16> coefs(toU64(comp.blocksX) * 64u);
+    const i16* src =
+      comp.coefs.data() + toU64(row) * comp.blocksX * 64u;
+    for(u64 block = 0u; block < comp.blocksX; ++block) {
+      for(u32 k = 0u; k < 64u; ++k) {
+        const u32 idx = JpegZigZag[k];
+        coefs[block * 64u + idx] =
+          JpegClampCoef(src[block * 64u + idx] * quant[k]);
+      }
+    }
+
+    const u64 stride = comp.GetStride();
+    idct(
+      coefs.data(), comp.plane.data() + toU64(row) * 8u * stride,
+      stride, comp.blocksX);
+  });
+}
+
+// Row y of a component at the image resolution. The 2:1 ratios use
+// libjpeg's triangle filters, the others repeat the samples.
+static const u8* JpegUpsampleRow(
+  const JpegFrame& frame, const JpegComponent& comp, u32 y, u8* dst)
+{
+  const u64 stride = comp.GetStride();
+  const u8* plane  = comp.plane.data();
+
+  if(comp.h == frame.hmax && comp.v == frame.vmax)
+    return plane + toU64(y) * stride;
+
+  // Like libjpeg, narrow components are not filtered horizontally.
+  const bool isHalfX = comp.h * 2u == frame.hmax && comp.width > 2u;
+  const bool isFullX = comp.h == frame.hmax;
+  const bool isHalfY = comp.v * 2u == frame.vmax;
+  const bool isFullY = comp.v == frame.vmax;
+
+  const u32 width = comp.width;
+
+  if(isHalfY && (isHalfX || isFullX)) {
+    // The nearest row and the one on the other side of the output row.
+    const u32 row = y / 2u;
+    const u32 far =
+      (y & 1u) ? std::min(row + 1u, comp.height - 1u)
+               : (row > 0u ? row - 1u : 0u);
+    const u8* nearRow = plane + toU64(row) * stride;
+    const u8* farRow  = plane + toU64(far) * stride;
+
+    if(isFullX) {
+      const u32 bias = (y & 1u) + 1u;
+      for(u32 x = 0u; x < width; ++x)
+        dst[x] = toU8((nearRow[x] * 3u + farRow[x] + bias) >> 2);
+      return dst;
+    }
+
+    u32 last = nearRow[0] * 3u + farRow[0];
+    u32 cur  = last;
+    for(u32 x = 0u; x < width; ++x) {
+      const u32 nextX = std::min(x + 1u, width - 1u);
+      const u32 next  = nearRow[nextX] * 3u + farRow[nextX];
+      dst[x * 2u]      = toU8((cur * 3u + last + 8u) >> 4);
+      dst[x * 2u + 1u] = toU8((cur * 3u + next + 7u) >> 4);
+      last             = cur;
+      cur              = next;
+    }
+    return dst;
+  }
+
+  if(isHalfX && isFullY) {
+    const u8* src = plane + toU64(y) * stride;
+    for(u32 x = 0u; x < width; ++x) {
+      const u32 cur = src[x] * 3u;
+      const u32 prev = src[x > 0u ? x - 1u : 0u];
+      dst[x * 2u]    = toU8((cur + prev + 1u) >> 2);
+      dst[x * 2u + 1u] =
+        toU8((cur + src[std::min(x + 1u, width - 1u)] + 2u) >> 2);
+    }
+    return dst;
+  }
+
+  const u8* src = plane + toU64(y * comp.v / frame.vmax) * stride;
+  for(u32 x = 0u; x < frame.width; ++x)
+    dst[x] = src[x * comp.h / frame.hmax];
+  return dst;
+}
+
+// Upsamples and converts the components to RGBA, a band of rows at a
+// time, so the upsampled rows stay in the cache.
+static void JpegConvert(
+  const JpegFrame& frame, u8* dst, u64 rowPitch, u8 alpha,
+  u32 threadCount)
+{
+  static const JpegConvertFn convertYCbCr = GetJpegConvert();
+
+  constexpr u32 BandSize = 16u;
+
+  const JpegColor color = GetJpegColor(frame);
+  const u32       width = frame.width;
+
+  runJobs(
+    divideRoundingUp(frame.height, BandSize), threadCount,
+    [&](u64 band) {
+      const u64 rowSize = toU64(frame.mcusX) * frame.hmax * 8u;
+
+      Arr<u8>   scratch(rowSize * frame.components.size());
+      const u8* rows[4] = {};
+
+      const u32 firstRow = toU32(band) * BandSize;
+      const u32 lastRow  = std::min(firstRow + BandSize, frame.height);
+
+      for(u32 y = firstRow; y < lastRow; ++y) {
+        for(u32 idx = 0u; idx < frame.components.size(); ++idx)
+          rows[idx] = JpegUpsampleRow(
+            frame, frame.components[idx], y,
+            scratch.data() + idx * rowSize);
+
+        u8* out = dst + y * rowPitch;
+
+        switch(color) {
+          case JpegColor::Gray:
+            for(u32 x = 0u; x < width; ++x) {
+              memset(out + x * 4u, rows[0][x], 3u);
+              out[x * 4u + 3u] = alpha;
+            }
+            break;
+          case JpegColor::YCbCr:
+            convertYCbCr(rows[0], rows[1], rows[2], out, width, alpha);
+            break;
+          case JpegColor::Rgb:
+            for(u32 x = 0u; x < width; ++x) {
+              for(u32 channel = 0u; channel < 3u; ++channel)
+                out[x * 4u + channel] = rows[channel][x];
+              out[x * 4u + 3u] = alpha;
+            }
+            break;
+          case JpegColor::Cmyk:
+            for(u32 x = 0u; x < width; ++x) {
+              for(u32 channel = 0u; channel < 3u; ++channel)
+                out[x * 4u + channel] =
+                  JpegMultiply(rows[channel][x], rows[3][x]);
+              out[x * 4u + 3u] = alpha;
+            }
+            break;
+          case JpegColor::Ycck:
+            // YCbCr gives the inverted CMY.
+            convertYCbCr(rows[0], rows[1], rows[2], out, width, alpha);
+            for(u32 x = 0u; x < width; ++x) {
+              for(u32 channel = 0u; channel < 3u; ++channel)
+                out[x * 4u + channel] = JpegMultiply(
+                  255u - out[x * 4u + channel], rows[3][x]);
+            }
+            break;
+        }
+      }
+    });
+}
+
+bool DataReader::isJpeg(std::istream& src)
+{
+  auto pos  = src.tellg();
+  auto size = streamSize(src);
+
+  if(size < 4u) return false;
+
+  std::array<u8, 3> marker;
+  src.read(reinterpret_cast<char*>(marker.data()), marker.size());
+  src.seekg(pos);
+
+  return marker[0] == 0xffu && marker[1] == JpegSOI &&
+         marker[2] == 0xffu;
+}
+
+data::Image DataReader::readJpeg(
+  std::istream& src, const ImageOptions& options,
+  const ImageTargetQuery& query)
+{
+  if(!isJpeg(src)) throw std::runtime_error("JPEG: bad signature");
+
+  src.seekg(0);
+  auto bytes = streamReadBytes(src);
+
+  data::Image out;
+  out.uri    = options.uri;
+  out.format = Format::R8G8B8A8_UNORM;
+
+  u32 threadCount = options.threadCount;
+  if(threadCount == 0u)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  JpegFrame   frame;
+  ImageTarget target;
+  bool        hasFrame = false;
+  bool        hasScan  = false;
+
+  Arr<Span<u8 const>> intervals;
+
+  u64 pos = 2u;
+  while(pos < bytes.size()) {
+    if(bytes[pos] != 0xffu)
+      throw std::runtime_error("JPEG: bad marker");
+    while(pos < bytes.size() && bytes[pos] == 0xffu) ++pos;
+    if(pos == bytes.size()) break;
+
+    const u8 marker = bytes[pos++];
+    if(marker == JpegEOI) break;
+    if(marker == JpegSOI || (marker >= JpegRST0 && marker <= JpegRST7))
+      continue;
+
+    if(bytes.size() - pos < 2u)
+      throw std::runtime_error("JPEG: bad segment size");
+    const u64 length = toU64((bytes[pos] << 8) | bytes[pos + 1u]);
+    if(length < 2u || bytes.size() - pos < length)
+      throw std::runtime_error("JPEG: bad segment size");
+
+    const Span<u8 const> segment(bytes.data() + pos + 2u, length - 2u);
+    pos += length;
+
+    switch(marker) {
+      case JpegSOF0:
+      case JpegSOF1:
+      case JpegSOF2: {
+        if(hasFrame) throw std::runtime_error("JPEG: multiple frames");
+
+        frame.progressive = marker == JpegSOF2;
+        JpegReadFrame(segment, frame);
+        hasFrame = true;
+
+        out.size = {frame.width, frame.height};
+
+        target = query(out);
+        if(target.texels.empty()) return out;
+        target = getLevelTargets(out, target)[0];
+
+        for(auto& comp: frame.components) {
+          const u64 blockCount = toU64(comp.blocksX) * comp.blocksY;
+          comp.plane.resize(blockCount * 64u);
+          if(frame.progressive) comp.coefs.resize(blockCount * 64u);
+        }
+      } break;
+
+      case JpegDHT:
+        JpegReadHuffman(segment, frame.dcTables, frame.acTables);
+        break;
+
+      case JpegDQT:
+        JpegReadQuant(segment, frame.quantTables);
+        break;
+
+      case JpegDRI:
+        if(segment.size() != 2u)
+          throw std::runtime_error("JPEG: bad restart interval");
+        frame.restartInterval = toU32((segment[0] << 8) | segment[1]);
+        break;
+
+      case JpegSOS: {
+        if(!hasFrame) throw std::runtime_error("JPEG: missing frame");
+
+        const auto scan = JpegReadScan(segment, frame);
+
+        intervals.clear();
+        pos = JpegSplitScan(bytes, pos, intervals);
+
+        JpegDecodeScan(frame, scan, intervals, threadCount);
+        hasScan = true;
+      } break;
+
+      case JpegAPP0:
+        if(
+          segment.size() >= 5u &&
+          memcmp(segment.data(), "JFIF", 5u) == 0)
+          frame.hasJfif = true;
+        break;
+
+      case JpegAPP14:
+        if(
+          segment.size() >= 12u &&
+          memcmp(segment.data(), "Adobe", 5u) == 0)
+          frame.adobeTransform = segment[11];
+        break;
+
+      default:
+        // Lossless, hierarchical and arithmetic coded frames.
+        if(
+          (marker > JpegSOF2 && marker <= 0xcfu && marker != JpegDHT) ||
+          marker == JpegDAC)
+          throw std::runtime_error(
+            "JPEG: only baseline and progressive Huffman coding is "
+            "supported");
+        break;
+    }
+  }
+
+  if(!hasScan) throw std::runtime_error("JPEG: missing image data");
+
+  if(frame.progressive) JpegFinishProgressive(frame, threadCount);
+
+  const u64 rowPitch =
+    target.rowPitch ? target.rowPitch : toU64(frame.width) * 4u;
+  JpegConvert(
+    frame, target.texels.data(), rowPitch, options.alphaPadding,
+    threadCount);
+
+  return out;
+}
@@ -0,0 +1,1186 @@
+#include "vuldir/DataReader.hpp"
+
+using namespace vd;
+
+// Zstandard decoder (RFC 8878) for the supercompressed KTX2 levels.
+// Each level is decoded whole to memory of known size, so matches can
+// reach anywhere in the output. Dictionaries are not supported.
+
+static constexpr u32 ZstdMagic          = 0xfd2fb528u;
+static constexpr u32 ZstdSkippableMagic = 0x184d2a50u;
+static constexpr u64 ZstdMaxBlockSize   = 128_KiB;
+
+static constexpr u32 ZstdMaxLiteralLengthCode = 35u;
+static constexpr u32 ZstdMaxMatchLengthCode   = 52u;
+static constexpr u32 ZstdMaxOffsetCode        = 31u;
+
+static constexpr u32 ZstdLiteralLengthBase[] = {
+  0,     1,     2,     3,     4,     5,     6,     7,     8,
+  9,     10,    11,    12,    13,    14,    15,    16,    18,
+  20,    22,    24,    28,    32,    40,    48,    64,    128,
+  256,   512,   1024,  2048,  4096,  8192,  16384, 32768, 65536};
+static constexpr u8 ZstdLiteralLengthBits[] = {
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  1,  1,  1,  1,  2,  2,  3,  3,
+  4,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 16};
+
+static constexpr u32 ZstdMatchLengthBase[] = {
+  3,     4,     5,     6,     7,     8,     9,     10,    11,
+  12,    13,    14,    15,    16,    17,    18,    19,    20,
+  21,    22,    23,    24,    25,    26,    27,    28,    29,
+  30,    31,    32,    33,    34,    35,    37,    39,    41,
+  43,    47,    51,    59,    67,    83,    99,    131,   259,
+  515,   1027,  2051,  4099,  8195,  16387, 32771, 65539};
+static constexpr u8 ZstdMatchLengthBits[] = {
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,
+  2,  2,  3,  3,  4,  4,  5,  7,  8,  9,  10, 11,
+  12, 13, 14, 15, 16};
+
+// Default distributions, used by the predefined compression mode.
+static constexpr i16 ZstdLiteralLengthDefault[] = {
+  4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 2, 2,
+  2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1, -1, -1, -1, -1};
+static constexpr i16 ZstdMatchLengthDefault[] = {
+  1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1, -1, -1};
+static constexpr i16 ZstdOffsetDefault[] = {
+  1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1};
+
+// Bitstreams are written forward and read backward, starting from the
+// highest set bit of the last byte. The 64 bits before the cursor are
+// kept in a container, read from the top down. Bits past the start of
+// the stream read as zeros, so decoders can tell when they run out.
+class ZstdBackwardBits
+{
+public:
+  ZstdBackwardBits(Span<u8 const> src):
+    m_start{src.data()},
+    m_cursor{src.data()},
+    m_container{0u},
+    m_consumed{0u}
+  {
+    if(src.empty() || src.back() == 0u)
+      throw std::runtime_error("Zstd: bad bitstream end mark");
+
+    if(src.size() >= 8u) {
+      m_cursor    = src.data() + src.size() - 8u;
+      m_container = load(m_cursor);
+    } else {
+      // Short streams start with the missing bytes already consumed.
+      for(u64 idx = 0u; idx < src.size(); ++idx)
+        m_container |= toU64(src[idx]) << (idx * 8u);
+      m_consumed = toU32(8u - src.size()) * 8u;
+    }
+
+    m_consumed += 9u - toU32(std::bit_width(src.back()));
+  }
+
+  // Up to 56 bits.
+  [[nodiscard]] u64 Peek(u32 count)
+  {
+    if(m_consumed + count > 64u) Refill();
+    if(count == 0u || m_consumed >= 64u) return 0u;
+    return ((m_container << m_consumed) >> 1) >> (63u - count);
+  }
+
+  void Skip(u32 count) { m_consumed += count; }
+
+  [[nodiscard]] u64 Read(u32 count)
+  {
+    auto value = Peek(count);
+    Skip(count);
+    return value;
+  }
+
+  // Moves the container back over the consumed bytes.
+  void Refill()
+  {
+    if(m_consumed > 64u) return;
+
+    // Short streams never move, their container was filled by hand.
+    const u64 bytes =
+      std::min<u64>(m_consumed / 8u, toU64(m_cursor - m_start));
+    if(bytes == 0u) return;
+
+    m_cursor -= bytes;
+    m_consumed -= toU32(bytes) * 8u;
+    m_container = load(m_cursor);
+  }
+
+  // Negative once more bits are read than the stream has.
+  i64 GetBitsLeft() const
+  {
+    return toI64(m_cursor - m_start) * 8 + 64 - toI64(m_consumed);
+  }
+
+private:
+  static u64 load(const u8* src)
+  {
+    u64 word;
+    memcpy(&word, src, sizeof(word));
+    if constexpr(std::endian::native == std::endian::big)
+      word = byteSwap(word);
+    return word;
+  }
+
+private:
+  const u8* m_start;
+  const u8* m_cursor;
+  u64       m_container;
+  u32       m_consumed;
+};
+
+// Finite state entropy decoding table, the state is the index of the
+// current entry.
+struct ZstdFseEntry {
+  u8  symbol;
+  u8  bits;
+  u16 base;
+};
+
+struct ZstdFseTable {
+  u32                    accuracyLog = 0u;
+  SArr<ZstdFseEntry, 512> entries;
+
+  u32 Init(ZstdBackwardBits& bits) const
+  {
+    return toU32(bits.Read(accuracyLog));
+  }
+
+  u8 Next(u32& state, ZstdBackwardBits& bits) const
+  {
+    const auto& entry = entries[state];
+    state             = entry.base + toU32(bits.Read(entry.bits));
+    return entry.symbol;
+  }
+};
+
+// Spreads the symbols over the table by their normalized count, a count
+// of -1 is a probability below 1 and gets a single cell at the end.
+static void ZstdBuildFse(
+  ZstdFseTable& table, Span<i16 const> counts, u32 accuracyLog)
+{
+  const u32 size = 1u << accuracyLog;
+
+  SArr<u16, 256> next;
+  u32            high = size - 1u;
+
+  table.accuracyLog = accuracyLog;
+
+  for(u32 symbol = 0u; symbol < counts.size(); ++symbol) {
+    if(counts[symbol] == -1) {
+      table.entries[high--].symbol = toU8(symbol);
+      next[symbol]                 = 1u;
+    } else {
+      next[symbol] = toU16(counts[symbol]);
+    }
+  }
+
+  const u32 step = (size >> 1) + (size >> 3) + 3u;
+  const u32 mask = size - 1u;
+
+  u32 position = 0u;
+  for(u32 symbol = 0u; symbol < counts.size(); ++symbol) {
+    for(i32 idx = 0; idx < counts[symbol]; ++idx) {
+      table.entries[position].symbol = toU8(symbol);
+      do {
+        position = (position + step) & mask;
+      } while(position > high);
+    }
+  }
+
+  if(position != 0u)
+    throw std::runtime_error("Zstd: bad FSE distribution");
+
+  for(u32 idx = 0u; idx < size; ++idx) {
+    auto&     entry = table.entries[idx];
+    const u32 state = next[entry.symbol]++;
+    const u32 bits  = accuracyLog + 1u - toU32(std::bit_width(state));
+
+    entry.bits = toU8(bits);
+    entry.base = toU16((state << bits) - size);
+  }
+}
+
+// Table with a single symbol, no bits are read.
+static void ZstdBuildFseRle(ZstdFseTable& table, u8 symbol)
+{
+  table.accuracyLog = 0u;
+  table.entries[0]  = {.symbol = symbol, .bits = 0u, .base = 0u};
+}
+
+// Reads a table description, returns the bytes it takes.
+static u64 ZstdReadFse(
+  ZstdFseTable& table, Span<u8 const> src, u32 maxSymbol,
+  u32 maxAccuracyLog)
+{
+  BitIStream bits(src);
+  u64        bitCount = 0u;
+
+  const auto read = [&](u32 count) {
+    bitCount += count;
+    return bits.Read(count);
+  };
+
+  const u32 accuracyLog = read(4u) + 5u;
+  if(accuracyLog > maxAccuracyLog)
+    throw std::runtime_error("Zstd: FSE accuracy log is too large");
+
+  SArr<i16, 256> counts    = {};
+  u32            symbol    = 0u;
+  i32            remaining = (1 << accuracyLog) + 1;
+  i32            threshold = 1 << accuracyLog;
+  u32            bitsUsed  = accuracyLog + 1u;
+
+  while(remaining > 1) {
+    if(symbol > maxSymbol)
+      throw std::runtime_error("Zstd: bad FSE distribution");
+
+    // Small values take one bit less.
+    const i32 max   = 2 * threshold - 1 - remaining;
+    const i32 value = toI32(bits.Peek(bitsUsed));
+
+    i32 count = 0;
+    if((value & (threshold - 1)) < max) {
+      count = value & (threshold - 1);
+      read(bitsUsed - 1u);
+    } else {
+      count = value & (2 * threshold - 1);
+      if(count >= threshold) count -= max;
+      read(bitsUsed);
+    }
+
+    --count;
+    remaining -= count < 0 ? -count : count;
+    counts[symbol++] = toI16(count);
+
+    // A zero is followed by the count of the zeros after it.
+    if(count == 0) {
+      for(u32 repeat = 3u; repeat == 3u;) {
+        repeat = read(2u);
+        if(symbol + repeat > maxSymbol + 1u)
+          throw std::runtime_error("Zstd: bad FSE distribution");
+        symbol += repeat;
+      }
+    }
+
+    while(remaining < threshold) {
+      --bitsUsed;
+      threshold >>= 1;
+    }
+  }
+
+  if(remaining != 1)
+    throw std::runtime_error("Zstd: bad FSE distribution");
+
+  ZstdBuildFse(table, {counts.data(), symbol}, accuracyLog);
+
+  return (bitCount + 7u) / 8u;
+}
+
+// Literal decoding table indexed by the next maxBits bits, each entry
+// has the symbol in the low byte and its code length above.
+struct ZstdHuffmanTable {
+  u32             maxBits = 0u;
+  SArr<u16, 2048> entries;
+};
+
+// Reads the code lengths, as weights, and builds the table. Returns
+// the bytes the description takes.
+static u64 ZstdReadHuffman(ZstdHuffmanTable& table, Span<u8 const> src)
+{
+  if(src.empty())
+    throw std::runtime_error("Zstd: missing Huffman tree");
+
+  SArr<u8, 256> weights = {};
+  u32           count   = 0u;
+  u64           size    = 0u;
+
+  const u32 header = src[0];
+  if(header >= 128u) {
+    // Two weights per byte.
+    count = header - 127u;
+    size  = 1u + (count + 1u) / 2u;
+    if(src.size() < size)
+      throw std::runtime_error("Zstd: bad Huffman tree size");
+
+    for(u32 idx = 0u; idx < count; ++idx) {
+      u8 pair      = src[1u + idx / 2u];
+      weights[idx] = toU8(idx % 2u == 0u ? pair >> 4 : pair & 0xfu);
+    }
+  } else {
+    // Weights compressed with two interleaved FSE states.
+    size = 1u + header;
+    if(header == 0u || src.size() < size)
+      throw std::runtime_error("Zstd: bad Huffman tree size");
+
+    const auto data = src.subspan(1u, header);
+
+    ZstdFseTable fse;
+    const u64    fseSize = ZstdReadFse(fse, data, 15u, 6u);
+
+    ZstdBackwardBits bits(data.subspan(fseSize));
+    u32              state1 = fse.Init(bits);
+    u32              state2 = fse.Init(bits);
+
+    // The last weight comes from the state that did not overflow.
+    for(;;) {
+      if(count + 2u > 255u)
+        throw std::runtime_error("Zstd: too many Huffman weights");
+
+      weights[count++] = fse.Next(state1, bits);
+      if(bits.GetBitsLeft() < 0) {
+        weights[count++] = fse.entries[state2].symbol;
+        break;
+      }
+
+      weights[count++] = fse.Next(state2, bits);
+      if(bits.GetBitsLeft() < 0) {
+        weights[count++] = fse.entries[state1].symbol;
+        break;
+      }
+    }
+  }
+
+  // The weight of the last symbol completes the next power of two.
+  u32 total = 0u;
+  for(u32 idx = 0u; idx < count; ++idx) {
+    if(weights[idx] > 11u)
+      throw std::runtime_error("Zstd: bad Huffman weight");
+    if(weights[idx] > 0u) total += 1u << (weights[idx] - 1u);
+  }
+
+  if(total == 0u) throw std::runtime_error("Zstd: bad Huffman tree");
+
+  const u32 maxBits = toU32(std::bit_width(total));
+  const u32 left    = (1u << maxBits) - total;
+  if(maxBits > 11u || !std::has_single_bit(left))
+    throw std::runtime_error("Zstd: bad Huffman tree");
+
+  weights[count++] = toU8(std::bit_width(left));
+
+  // Codes are assigned from the lowest weight up, so each weight takes
+  // a contiguous range of the table.
+  SArr<u32, 13> start = {};
+  for(u32 idx = 0u; idx < count; ++idx)
+    if(weights[idx] > 0u)
+      start[weights[idx]] += 1u << (weights[idx] - 1u);
+
+  u32 position = 0u;
+  for(u32 weight = 1u; weight <= maxBits; ++weight) {
+    const u32 rangeSize = start[weight];
+    start[weight]       = position;
+    position += rangeSize;
+  }
+
+  table.maxBits = maxBits;
+  for(u32 symbol = 0u; symbol < count; ++symbol) {
+    const u32 weight = weights[symbol];
+    if(weight == 0u) continue;
+
+    const u16 entry = toU16(symbol | ((maxBits + 1u - weight) << 8));
+    const u32 range = 1u << (weight - 1u);
+    std::fill_n(table.entries.data() + start[weight], range, entry);
+    start[weight] += range;
+  }
+
+  return size;
+}
+
+static void ZstdDecodeHuffmanStream(
+  const ZstdHuffmanTable& table, Span<u8 const> src, u8* dst, u64 count)
+{
+  ZstdBackwardBits bits(src);
+
+  for(u64 idx = 0u; idx < count; ++idx) {
+    const u16 entry = table.entries[bits.Peek(table.maxBits)];
+    dst[idx]        = toU8(entry);
+    bits.Skip(entry >> 8);
+  }
+
+  if(bits.GetBitsLeft() != 0)
+    throw std::runtime_error("Zstd: bad literals stream");
+}
+
+// State that carries over from one block to the next of a frame.
+struct ZstdFrameState {
+  ZstdHuffmanTable huffman;
+  bool             hasHuffman = false;
+
+  ZstdFseTable literalLengths;
+  ZstdFseTable offsets;
+  ZstdFseTable matchLengths;
+
+  const ZstdFseTable* literalLengthTable = nullptr;
+  const ZstdFseTable* offsetTable        = nullptr;
+  const ZstdFseTable* matchLengthTable   = nullptr;
+
+  SArr<u64, 3> repeatOffsets = {1u, 4u, 8u};
+
+  Arr<u8> literalBuffer;
+};
+
+static u32 ZstdReadLE(Span<u8 const> src, u64 offset, u32 size)
+{
+  if(offset + size > src.size())
+    throw std::runtime_error("Zstd: unexpected end of data");
+
+  u32 value = 0u;
+  for(u32 idx = 0u; idx < size; ++idx)
+    value |= toU32(src[offset + idx]) << (idx * 8u);
+  return value;
+}
+
+// Decodes the literals section, returns the bytes it takes.
+static u64 ZstdReadLiterals(
+  ZstdFrameState& state, Span<u8 const> src, Span<u8 const>& literals)
+{
+  if(src.empty()) throw std::runtime_error("Zstd: missing literals");
+
+  const u32 type       = src[0] & 3u;
+  const u32 sizeFormat = (src[0] >> 2) & 3u;
+
+  // Raw and RLE literals.
+  if(type < 2u) {
+    u64 headerSize  = 1u;
+    u64 literalSize = src[0] >> 3;
+    if(sizeFormat == 1u) {
+      headerSize  = 2u;
+      literalSize = ZstdReadLE(src, 0u, 2u) >> 4;
+    } else if(sizeFormat == 3u) {
+      headerSize  = 3u;
+      literalSize = ZstdReadLE(src, 0u, 3u) >> 4;
+    }
+
+    if(literalSize > ZstdMaxBlockSize)
+      throw std::runtime_error("Zstd: too many literals");
+
+    if(type == 0u) {
+      if(src.size() < headerSize + literalSize)
+        throw std::runtime_error("Zstd: unexpected end of data");
+
+      literals = src.subspan(headerSize, literalSize);
+      return headerSize + literalSize;
+    }
+
+    if(src.size() < headerSize + 1u)
+      throw std::runtime_error("Zstd: unexpected end of data");
+
+    state.literalBuffer.assign(literalSize, src[headerSize]);
+    literals = state.literalBuffer;
+    return headerSize + 1u;
+  }
+
+  // Huffman coded literals, in one or four streams.
+  u64  headerSize   = 0u;
+  u64  literalSize  = 0u;
+  u64  streamsSize  = 0u;
+  bool singleStream = sizeFormat == 0u;
+
+  if(sizeFormat < 2u) {
+    const u32 header = ZstdReadLE(src, 0u, 3u);
+    headerSize       = 3u;
+    literalSize      = (header >> 4) & 0x3ffu;
+    streamsSize      = header >> 14;
+  } else if(sizeFormat == 2u) {
+    const u32 header = ZstdReadLE(src, 0u, 4u);
+    headerSize       = 4u;
+    literalSize      = (header >> 4) & 0x3fffu;
+    streamsSize      = header >> 18;
+  } else {
+    const u64 header =
+      ZstdReadLE(src, 0u, 4u) | (toU64(ZstdReadLE(src, 4u, 1u)) << 32);
+    headerSize  = 5u;
+    literalSize = (header >> 4) & 0x3ffffu;
+    streamsSize = header >> 22;
+  }
+
+  if(literalSize > ZstdMaxBlockSize)
+    throw std::runtime_error("Zstd: too many literals");
+  if(src.size() < headerSize + streamsSize)
+    throw std::runtime_error("Zstd: unexpected end of data");
+
+  auto streams = src.subspan(headerSize, streamsSize);
+
+  if(type == 2u) {
+    const u64 treeSize = ZstdReadHuffman(state.huffman, streams);
+    streams            = streams.subspan(treeSize);
+    state.hasHuffman   = true;
+  } else if(!state.hasHuffman) {
+    throw std::runtime_error("Zstd: missing Huffman tree");
+  }
+
+  state.literalBuffer.resize(literalSize);
+  u8* dst = state.literalBuffer.data();
+
+  if(singleStream) {
+    ZstdDecodeHuffmanStream(state.huffman, streams, dst, literalSize);
+  } else {
+    const u64 segmentSize = (literalSize + 3u) / 4u;
+    if(streams.size() < 6u || 3u * segmentSize > literalSize)
+      throw std::runtime_error("Zstd: bad literals streams");
+
+    u64 sizes[4];
+    for(u32 idx = 0u; idx < 3u; ++idx)
+      sizes[idx] = ZstdReadLE(streams, idx * 2u, 2u);
+    if(sizes[0] + sizes[1] + sizes[2] + 6u > streams.size())
+      throw std::runtime_error("Zstd: bad literals streams");
+    sizes[3] = streams.size() - 6u - sizes[0] - sizes[1] - sizes[2];
+
+    u64 offset = 6u;
+    for(u32 idx = 0u; idx < 4u; ++idx) {
+      const u64 count =
+        idx < 3u ? segmentSize : literalSize - 3u * segmentSize;
+      ZstdDecodeHuffmanStream(
+        state.huffman, streams.subspan(offset, sizes[idx]),
+        dst + idx * segmentSize, count);
+      offset += sizes[idx];
+    }
+  }
+
+  literals = state.literalBuffer;
+  return headerSize + streamsSize;
+}
+
+static const ZstdFseTable& GetZstdDefaultTable(u32 idx)
+{
+  static const auto tables = [] {
+    SArr<ZstdFseTable, 3> ret;
+    ZstdBuildFse(ret[0], ZstdLiteralLengthDefault, 6u);
+    ZstdBuildFse(ret[1], ZstdOffsetDefault, 5u);
+    ZstdBuildFse(ret[2], ZstdMatchLengthDefault, 6u);
+    return ret;
+  }();
+
+  return tables[idx];
+}
+
+// Picks the table of one sequence field from its compression mode.
+// Returns the bytes of the table description.
+static u64 ZstdReadSequenceTable(
+  const ZstdFseTable*& table, ZstdFseTable& storage, u32 mode,
+  u32 defaultIdx, Span<u8 const> src, u32 maxSymbol,
+  u32 maxAccuracyLog)
+{
+  switch(mode) {
+    case 0u:
+      table = &GetZstdDefaultTable(defaultIdx);
+      return 0u;
+    case 1u:
+      if(src.empty() || src[0] > maxSymbol)
+        throw std::runtime_error("Zstd: bad RLE sequence symbol");
+      ZstdBuildFseRle(storage, src[0]);
+      table = &storage;
+      return 1u;
+    case 2u: {
+      const u64 size =
+        ZstdReadFse(storage, src, maxSymbol, maxAccuracyLog);
+      table = &storage;
+      return size;
+    }
+    default:
+      if(!table)
+        throw std::runtime_error("Zstd: missing sequence table");
+      return 0u;
+  }
+}
+
+class ZstdOutput
+{
+public:
+  ZstdOutput(Span<u8> dst): m_dst{dst}, m_size{0u} {}
+
+  void Write(const u8* src, u64 size)
+  {
+    if(size == 0u) return;
+    reserve(size);
+    memcpy(m_dst.data() + m_size, src, size);
+    m_size += size;
+  }
+
+  // Like Write, reading and writing whole chunks when both sides have
+  // room for the overshoot.
+  void WriteShort(Span<u8 const> src, u64 size)
+  {
+    if(src.size() < size + 16u || m_dst.size() - m_size < size + 16u)
+      return Write(src.data(), size);
+
+    u8* dst = m_dst.data() + m_size;
+    for(u64 idx = 0u; idx < size; idx += 16u)
+      memcpy(dst + idx, src.data() + idx, 16u);
+    m_size += size;
+  }
+
+  void Fill(u8 value, u64 size)
+  {
+    reserve(size);
+    memset(m_dst.data() + m_size, value, size);
+    m_size += size;
+  }
+
+  // The match may overlap the bytes it writes.
+  void Copy(u64 offset, u64 length)
+  {
+    if(offset == 0u || offset > m_size)
+      throw std::runtime_error("Zstd: bad match offset");
+    reserve(length);
+
+    u8*       dst = m_dst.data() + m_size;
+    const u8* src = dst - offset;
+    if(offset >= 16u && m_dst.size() - m_size >= length + 16u) {
+      // Chunks no longer than the offset never read what they write,
+      // the bytes written past the match are overwritten later.
+      for(u64 idx = 0u; idx < length; idx += 16u)
+        memcpy(dst + idx, src + idx, 16u);
+    } else if(offset >= length) {
+      memcpy(dst, src, length);
+    } else {
+      for(u64 idx = 0u; idx < length; ++idx) dst[idx] = src[idx];
+    }
+
+    m_size += length;
+  }
+
+  const u8* data() const { return m_dst.data(); }
+  u64       size() const { return m_size; }
+
+private:
+  void reserve(u64 size)
+  {
+    if(m_dst.size() - m_size < size)
+      throw std::runtime_error("Zstd: output is larger than expected");
+  }
+
+private:
+  Span<u8> m_dst;
+  u64      m_size;
+};
+
+static void ZstdDecodeBlock(
+  ZstdFrameState& state, Span<u8 const> src, ZstdOutput& out)
+{
+  Span<u8 const> literals;
+  u64            offset = ZstdReadLiterals(state, src, literals);
+
+  if(offset >= src.size())
+    throw std::runtime_error("Zstd: missing sequences");
+
+  const u32 countByte     = src[offset];
+  u64       sequenceCount = countByte;
+  if(countByte == 255u) {
+    sequenceCount = ZstdReadLE(src, offset + 1u, 2u) + 0x7f00u;
+    offset += 3u;
+  } else if(countByte >= 128u) {
+    sequenceCount =
+      ((countByte - 128u) << 8) + ZstdReadLE(src, offset + 1u, 1u);
+    offset += 2u;
+  } else {
+    offset += 1u;
+  }
+
+  if(sequenceCount == 0u) {
+    out.Write(literals.data(), literals.size());
+    return;
+  }
+
+  if(offset >= src.size())
+    throw std::runtime_error("Zstd: missing sequence modes");
+
+  const u32 modes = src[offset++];
+  if(modes & 3u)
+    throw std::runtime_error("Zstd: bad sequence compression modes");
+
+  offset += ZstdReadSequenceTable(
+    state.literalLengthTable, state.literalLengths, modes >> 6, 0u,
+    src.subspan(offset), ZstdMaxLiteralLengthCode, 9u);
+  offset += ZstdReadSequenceTable(
+    state.offsetTable, state.offsets, (modes >> 4) & 3u, 1u,
+    src.subspan(offset), ZstdMaxOffsetCode, 8u);
+  offset += ZstdReadSequenceTable(
+    state.matchLengthTable, state.matchLengths, (modes >> 2) & 3u, 2u,
+    src.subspan(offset), ZstdMaxMatchLengthCode, 9u);
+
+  if(offset > src.size())
+    throw std::runtime_error("Zstd: unexpected end of data");
+
+  const auto& llTable = *state.literalLengthTable;
+  const auto& ofTable = *state.offsetTable;
+  const auto& mlTable = *state.matchLengthTable;
+
+  ZstdBackwardBits bits(src.subspan(offset));
+
+  u32 llState = llTable.Init(bits);
+  u32 ofState = ofTable.Init(bits);
+  u32 mlState = mlTable.Init(bits);
+
+  auto& repeat = state.repeatOffsets;
+
+  u64 literalOffset = 0u;
+  for(u64 idx = 0u; idx < sequenceCount; ++idx) {
+    const u32 ofCode = ofTable.entries[ofState].symbol;
+    const u32 mlCode = mlTable.entries[mlState].symbol;
+    const u32 llCode = llTable.entries[llState].symbol;
+
+    if(ofCode > ZstdMaxOffsetCode)
+      throw std::runtime_error("Zstd: bad offset code");
+
+    const u64 offsetValue = (1ull << ofCode) + bits.Read(ofCode);
+    const u64 matchLength = ZstdMatchLengthBase[mlCode] +
+                            bits.Read(ZstdMatchLengthBits[mlCode]);
+    const u64 literalLength = ZstdLiteralLengthBase[llCode] +
+                              bits.Read(ZstdLiteralLengthBits[llCode]);
+
+    // Values up to 3 select a recent offset, shifted by one when the
+    // sequence has no literals.
+    u64 matchOffset = 0u;
+    if(offsetValue > 3u) {
+      matchOffset = offsetValue - 3u;
+      repeat      = {matchOffset, repeat[0], repeat[1]};
+    } else {
+      const u64 recent = offsetValue - 1u + (literalLength == 0u);
+      if(recent == 0u) {
+        matchOffset = repeat[0];
+      } else {
+        matchOffset = recent == 3u ? repeat[0] - 1u : repeat[recent];
+        if(recent > 1u) repeat[2] = repeat[1];
+        repeat[1] = repeat[0];
+        repeat[0] = matchOffset;
+      }
+    }
+
+    if(literalLength > literals.size() - literalOffset)
+      throw std::runtime_error("Zstd: not enough literals");
+
+    out.WriteShort(literals.subspan(literalOffset), literalLength);
+    literalOffset += literalLength;
+    out.Copy(matchOffset, matchLength);
+
+    if(idx + 1u < sequenceCount) {
+      llTable.Next(llState, bits);
+      mlTable.Next(mlState, bits);
+      ofTable.Next(ofState, bits);
+    }
+  }
+
+  if(bits.GetBitsLeft() != 0)
+    throw std::runtime_error("Zstd: bad sequences bitstream");
+
+  out.Write(
+    literals.data() + literalOffset, literals.size() - literalOffset);
+}
+
+// Decodes a frame to the output, returns the bytes it takes.
+static u64 ZstdDecodeFrame(
+  Span<u8 const> src, ZstdOutput& out, bool verifyChecksum)
+{
+  const u32 descriptor = ZstdReadLE(src, 4u, 1u);
+  const u32 sizeFlag   = descriptor >> 6;
+  const bool singleSegment = (descriptor >> 5) & 1u;
+  const bool hasChecksum   = (descriptor >> 2) & 1u;
+  const u32 dictionaryFlag = descriptor & 3u;
+
+  if(descriptor & 0x8u)
+    throw std::runtime_error("Zstd: bad frame header");
+
+  u64 offset = 5u;
+  if(!singleSegment) ++offset; // Window size, the output is whole.
+
+  constexpr u32 DictionarySizes[] = {0u, 1u, 2u, 4u};
+  if(
+    dictionaryFlag != 0u &&
+    ZstdReadLE(src, offset, DictionarySizes[dictionaryFlag]) != 0u)
+    throw std::runtime_error("Zstd: dictionaries are not supported");
+  offset += DictionarySizes[dictionaryFlag];
+
+  Opt<u64> contentSize;
+  switch(sizeFlag) {
+    case 0u:
+      if(singleSegment) contentSize = ZstdReadLE(src, offset++, 1u);
+      break;
+    case 1u:
+      contentSize = ZstdReadLE(src, offset, 2u) + 256u;
+      offset += 2u;
+      break;
+    case 2u:
+      contentSize = ZstdReadLE(src, offset, 4u);
+      offset += 4u;
+      break;
+    default:
+      contentSize = ZstdReadLE(src, offset, 4u) |
+                    (toU64(ZstdReadLE(src, offset + 4u, 4u)) << 32);
+      offset += 8u;
+      break;
+  }
+
+  const u64 start = out.size();
+
+  ZstdFrameState state;
+  for(bool last = false; !last;) {
+    const u32 header = ZstdReadLE(src, offset, 3u);
+    const u32 type   = (header >> 1) & 3u;
+    const u64 size   = header >> 3;
+    last             = header & 1u;
+    offset += 3u;
+
+    const u64 dataSize = type == 1u ? 1u : size;
+    if(size > ZstdMaxBlockSize || src.size() - offset < dataSize)
+      throw std::runtime_error("Zstd: bad block size");
+
+    switch(type) {
+      case 0u:
+        out.Write(src.data() + offset, size);
+        break;
+      case 1u:
+        out.Fill(src[offset], size);
+        break;
+      case 2u:
+        ZstdDecodeBlock(state, src.subspan(offset, size), out);
+        break;
+      default:
+        throw std::runtime_error("Zstd: bad block type");
+    }
+
+    offset += dataSize;
+  }
+
+  const u64 size = out.size() - start;
+  if(contentSize && *contentSize != size)
+    throw std::runtime_error("Zstd: bad frame content size");
+
+  if(hasChecksum) {
+    const u32 checksum = ZstdReadLE(src, offset, 4u);
+    offset += 4u;
+
+    if(verifyChecksum) {
+      // The output memory is still in the caller's hands, read it back.
+      const auto* data = out.data() + start;
+      if(toU32(xxh64({data, size})) != checksum)
+        throw std::runtime_error("Zstd: bad frame checksum");
+    }
+  }
+
+  return offset;
+}
+
+// Decodes every frame of the source, the output must be their exact
+// size.
+static void
+ZstdDecompress(Span<u8 const> src, Span<u8> dst, bool verifyChecksums)
+{
+  ZstdOutput out(dst);
+
+  while(!src.empty()) {
+    const u32 magic = ZstdReadLE(src, 0u, 4u);
+
+    u64 size = 0u;
+    if((magic & 0xfffffff0u) == ZstdSkippableMagic)
+      size = 8u + ZstdReadLE(src, 4u, 4u);
+    else if(magic == ZstdMagic)
+      size = ZstdDecodeFrame(src, out, verifyChecksums);
+    else
+      throw std::runtime_error("Zstd: bad frame magic");
+
+    if(size > src.size())
+      throw std::runtime_error("Zstd: unexpected end of data");
+    src = src.subspan(size);
+  }
+
+  if(out.size() != dst.size())
+    throw std::runtime_error("Zstd: output is smaller than expected");
+}
+
+// KTX 2.0. Each level holds all its layers and faces, they are moved
+// to the layer by layer layout of data::Image. Basis Universal payloads
+// need a transcoder and are rejected.
+
+static constexpr u8 Ktx2Identifier[] = {
+  0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+
+// Identifier, header and index, the level index follows.
+static constexpr u64 Ktx2HeaderSize     = 80u;
+static constexpr u64 Ktx2LevelIndexSize = 24u;
+
+static constexpr u32 Ktx2SupercompressionNone = 0u;
+static constexpr u32 Ktx2SupercompressionZstd = 2u;
+
+static Format GetKtx2Format(u32 format)
+{
+  // VkFormat values. BC1 without alpha reads as BC1 with alpha, the
+  // blocks are the same.
+  switch(format) {
+    case 9u:
+      return Format::R8_UNORM;
+    case 10u:
+      return Format::R8_SNORM;
+    case 13u:
+      return Format::R8_UINT;
+    case 14u:
+      return Format::R8_SINT;
+    case 37u:
+      return Format::R8G8B8A8_UNORM;
+    case 38u:
+      return Format::R8G8B8A8_SNORM;
+    case 41u:
+      return Format::R8G8B8A8_UINT;
+    case 42u:
+      return Format::R8G8B8A8_SINT;
+    case 43u:
+      return Format::R8G8B8A8_SRGB;
+    case 44u:
+      return Format::B8G8R8A8_UNORM;
+    case 50u:
+      return Format::B8G8R8A8_SRGB;
+    case 70u:
+      return Format::R16_UNORM;
+    case 71u:
+      return Format::R16_SNORM;
+    case 74u:
+      return Format::R16_UINT;
+    case 75u:
+      return Format::R16_SINT;
+    case 76u:
+      return Format::R16_SFLOAT;
+    case 83u:
+      return Format::R16G16_SFLOAT;
+    case 91u:
+      return Format::R16G16B16A16_UNORM;
+    case 92u:
+      return Format::R16G16B16A16_SNORM;
+    case 95u:
+      return Format::R16G16B16A16_UINT;
+    case 96u:
+      return Format::R16G16B16A16_SINT;
+    case 97u:
+      return Format::R16G16B16A16_SFLOAT;
+    case 103u:
+      return Format::R32G32_SFLOAT;
+    case 104u:
+      return Format::R32G32B32_UINT;
+    case 105u:
+      return Format::R32G32B32_SINT;
+    case 106u:
+      return Format::R32G32B32_SFLOAT;
+    case 107u:
+      return Format::R32G32B32A32_UINT;
+    case 108u:
+      return Format::R32G32B32A32_SINT;
+    case 109u:
+      return Format::R32G32B32A32_SFLOAT;
+    case 131u:
+    case 133u:
+      return Format::BC1_RGBA_UNORM;
+    case 132u:
+    case 134u:
+      return Format::BC1_RGBA_SRGB;
+    case 135u:
+      return Format::BC2_UNORM;
+    case 136u:
+      return Format::BC2_SRGB;
+    case 137u:
+      return Format::BC3_UNORM;
+    case 138u:
+      return Format::BC3_SRGB;
+    case 139u:
+      return Format::BC4_UNORM;
+    case 140u:
+      return Format::BC4_SNORM;
+    case 141u:
+      return Format::BC5_UNORM;
+    case 142u:
+      return Format::BC5_SNORM;
+    case 143u:
+      return Format::BC6H_UFLOAT;
+    case 144u:
+      return Format::BC6H_SFLOAT;
+    case 145u:
+      return Format::BC7_UNORM;
+    case 146u:
+      return Format::BC7_SRGB;
+    case 0u:
+      throw std::runtime_error(
+        "KTX2: Basis Universal textures must be transcoded first");
+    default:
+      throw makeError<std::runtime_error>(
+        "KTX2: unsupported Vulkan format %u", format);
+  }
+}
+
+bool DataReader::isKtx2(std::istream& src)
+{
+  auto pos  = src.tellg();
+  auto size = streamSize(src);
+
+  if(size < Ktx2HeaderSize) return false;
+
+  std::array<char, sizeof(Ktx2Identifier)> identifier;
+  src.read(identifier.data(), identifier.size());
+  src.seekg(pos);
+
+  return memcmp(
+           std::data(identifier), Ktx2Identifier,
+           sizeof(Ktx2Identifier)) == 0u;
+}
+
+data::Image DataReader::readKtx2(
+  std::istream& src, const ImageOptions& options,
+  const ImageTargetQuery& query)
+{
+  if(!isKtx2(src)) throw std::runtime_error("KTX2: bad identifier");
+
+  const u64 fileSize = streamSize(src);
+
+  src.seekg(0);
+  auto header = streamReadBytes(src, Ktx2HeaderSize);
+
+  ByteIStream stream({header.data(), header.size()});
+  stream.SkipBytes(sizeof(Ktx2Identifier));
+
+  data::Image out;
+  out.uri = options.uri;
+
+  const u32 vkFormat = stream.Read<u32>();
+  stream.SkipBytes(4u); // Type size.
+  out.size[0]            = stream.Read<u32>();
+  out.size[1]            = std::max(stream.Read<u32>(), 1u);
+  const u32 depth        = stream.Read<u32>();
+  const u32 layerCount   = std::max(stream.Read<u32>(), 1u);
+  const u32 faceCount    = stream.Read<u32>();
+  const u32 levelCount   = std::max(stream.Read<u32>(), 1u);
+  const u32 compression  = stream.Read<u32>();
+
+  if(
+    compression != Ktx2SupercompressionNone &&
+    compression != Ktx2SupercompressionZstd)
+    throw makeError<std::runtime_error>(
+      "KTX2: unsupported supercompression scheme %u", compression);
+
+  out.format = GetKtx2Format(vkFormat);
+
+  if(out.size[0] == 0u)
+    throw std::runtime_error("KTX2: bad image size");
+  if(depth > 1u)
+    throw std::runtime_error("KTX2: volume textures are not supported");
+  if(faceCount != 1u && faceCount != 6u)
+    throw std::runtime_error("KTX2: bad face count");
+  if(levelCount > getMipCount(out.size[0], out.size[1]))
+    throw std::runtime_error("KTX2: bad level count");
+
+  out.mips   = levelCount;
+  out.layers = layerCount * faceCount;
+
+  struct Level {
+    u64 offset;
+    u64 size;
+    u64 uncompressedSize;
+  };
+
+  if(fileSize < Ktx2HeaderSize + levelCount * Ktx2LevelIndexSize)
+    throw std::runtime_error("KTX2: missing level index");
+
+  auto index = streamReadBytes(src, levelCount * Ktx2LevelIndexSize);
+  ByteIStream indexStream({index.data(), index.size()});
+
+  Arr<Level> levels(levelCount);
+  for(u32 mip = 0u; mip < levelCount; ++mip) {
+    auto& level            = levels[mip];
+    level.offset           = indexStream.Read<u64>();
+    level.size             = indexStream.Read<u64>();
+    level.uncompressedSize = indexStream.Read<u64>();
+
+    const u64 levelSize = getMipSize(out, mip) * out.layers;
+    if(
+      level.offset > fileSize || level.size > fileSize - level.offset ||
+      (compression == Ktx2SupercompressionNone &&
+       level.size != levelSize) ||
+      (compression == Ktx2SupercompressionZstd &&
+       level.uncompressedSize != levelSize))
+      throw std::runtime_error("KTX2: bad level size");
+  }
+
+  auto target = query(out);
+  if(target.texels.empty()) return out;
+
+  const auto targets = getLevelTargets(out, target);
+
+  // Where each layer of a level goes.
+  const auto getTarget = [&](u32 mip, u32 layer) -> const ImageTarget& {
+    return targets[layer * out.mips + mip];
+  };
+
+  Arr<u8> compressed;
+  Arr<u8> decompressed;
+
+  for(u32 mip = 0u; mip < out.mips; ++mip) {
+    const u64 size    = getMipSize(out, mip);
+    const u64 rowSize = getFormatRowSize(
+      out.format, getMipExtent(out.size[0], mip));
+    const u64 rowCount = size / rowSize;
+
+    bool needed = false;
+    for(u32 layer = 0u; layer < out.layers; ++layer)
+      needed |= !getTarget(mip, layer).texels.empty();
+    if(!needed) continue;
+
+    if(compression == Ktx2SupercompressionNone) {
+      for(u32 layer = 0u; layer < out.layers; ++layer) {
+        const auto& dst = getTarget(mip, layer);
+        if(dst.texels.empty()) continue;
+
+        const u64 offset = levels[mip].offset + layer * size;
+        src.seekg(static_cast<std::streamoff>(offset));
+
+        if(dst.rowPitch == 0u || dst.rowPitch == rowSize) {
+          src.read(
+            reinterpret_cast<char*>(dst.texels.data()),
+            static_cast<std::streamsize>(size));
+        } else {
+          for(u64 row = 0u; row < rowCount; ++row)
+            src.read(
+              reinterpret_cast<char*>(
+                dst.texels.data() + row * dst.rowPitch),
+              static_cast<std::streamsize>(rowSize));
+        }
+
+        if(!src) throw std::runtime_error("KTX2: missing image data");
+      }
+      continue;
+    }
+
+    src.seekg(static_cast<std::streamoff>(levels[mip].offset));
+    compressed.resize(levels[mip].size);
+    src.read(
+      reinterpret_cast<char*>(compressed.data()),
+      static_cast<std::streamsize>(compressed.size()));
+    if(!src) throw std::runtime_error("KTX2: missing image data");
+
+    // A single packed layer is decoded in place.
+    const auto& first = getTarget(mip, 0u);
+    if(
+      out.layers == 1u &&
+      (first.rowPitch == 0u || first.rowPitch == rowSize)) {
+      ZstdDecompress(
+        compressed, first.texels.first(size), options.verifyChecksums);
+      continue;
+    }
+
+    decompressed.resize(size * out.layers);
+    ZstdDecompress(compressed, decompressed, options.verifyChecksums);
+
+    for(u32 layer = 0u; layer < out.layers; ++layer) {
+      const auto& dst = getTarget(mip, layer);
+      if(dst.texels.empty()) continue;
+
+      const u64 pitch = dst.rowPitch ? dst.rowPitch : rowSize;
+      for(u64 row = 0u; row < rowCount; ++row)
+        memcpy(
+          dst.texels.data() + row * pitch,
+          decompressed.data() + layer * size + row * rowSize, rowSize);
+    }
+  }
+
+  return out;
+}
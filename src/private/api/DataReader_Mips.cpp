@@ -0,0 +1,698 @@
+#include "vuldir/DataReader.hpp"
+
+using namespace vd;
+
+// Each level is a box filter of the previous one. When a side is odd
+// the last texel of the smaller level covers three texels instead of
+// two, so no row or column of the source is dropped.
+
+static f32 SrgbToLinear(f32 v)
+{
+  return v <= 0.04045f ? v / 12.92f
+                       : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+static f32 LinearToSrgb(f32 v)
+{
+  return v <= 0.0031308f ? v * 12.92f
+                         : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+}
+
+// 8-bit sRGB values are averaged as 16-bit linear values, fine enough
+// to round trip every code. 16-bit values are averaged as floats.
+struct MipSrgbTables {
+  SArr<u16, 256u> toLinear;
+  Arr<u8>         fromLinear;
+  Arr<f32>        toLinear16;
+};
+
+static const MipSrgbTables& GetMipSrgbTables()
+{
+  static const MipSrgbTables tables = [] {
+    MipSrgbTables ret;
+
+    for(u32 idx = 0u; idx < 256u; ++idx)
+      ret.toLinear[idx] = toU16(
+        std::lround(SrgbToLinear(toF32(idx) / 255.0f) * 65535.0f));
+
+    ret.fromLinear.resize(65536u);
+    for(u32 idx = 0u; idx < 65536u; ++idx)
+      ret.fromLinear[idx] = toU8(
+        std::lround(LinearToSrgb(toF32(idx) / 65535.0f) * 255.0f));
+
+    ret.toLinear16.resize(65536u);
+    for(u32 idx = 0u; idx < 65536u; ++idx)
+      ret.toLinear16[idx] = SrgbToLinear(toF32(idx) / 65535.0f);
+
+    return ret;
+  }();
+
+  return tables;
+}
+
+// How the samples of a channel are summed and averaged.
+template<typename T, bool Srgb>
+struct MipChannel {
+  using Acc = u32;
+
+  static Acc Load(T v) { return v; }
+  static T   Store(Acc sum, u32 count)
+  {
+    return static_cast<T>((sum + count / 2u) / count);
+  }
+};
+
+template<>
+struct MipChannel<u8, true> {
+  using Acc = u32;
+
+  static Acc Load(u8 v) { return GetMipSrgbTables().toLinear[v]; }
+  static u8  Store(Acc sum, u32 count)
+  {
+    return GetMipSrgbTables().fromLinear[(sum + count / 2u) / count];
+  }
+};
+
+template<>
+struct MipChannel<u16, true> {
+  using Acc = f32;
+
+  static Acc Load(u16 v) { return GetMipSrgbTables().toLinear16[v]; }
+  static u16 Store(Acc sum, u32 count)
+  {
+    f32 v = LinearToSrgb(sum / toF32(count));
+    return toU16(std::lround(std::clamp(v, 0.0f, 1.0f) * 65535.0f));
+  }
+};
+
+// Float texels are linear HDR values.
+template<bool Srgb>
+struct MipChannel<f32, Srgb> {
+  using Acc = f32;
+
+  static Acc Load(f32 v) { return v; }
+  static f32 Store(Acc sum, u32 count) { return sum / toF32(count); }
+};
+
+// Filters the texels of a destination row from first onwards. The
+// source rows are the two or three rows the destination row covers.
+using MipRowFn = void (*)(
+  u8* dst, const u8* const* rows, u32 rowCount, u32 srcWidth,
+  u32 dstWidth, u32 first);
+
+template<typename T, u32 Channels, bool Srgb>
+static void MipFilterRow(
+  u8* dst, const u8* const* rows, u32 rowCount, u32 srcWidth,
+  u32 dstWidth, u32 first)
+{
+  using Color = MipChannel<T, Srgb>;
+  using Alpha = MipChannel<T, false>;
+
+  const auto load = [](const u8* src, u32 idx) {
+    T v;
+    memcpy(&v, src + idx * sizeof(T), sizeof(T));
+    return v;
+  };
+
+  for(u32 x = first; x < dstWidth; ++x) {
+    u32 colCount = x + 1u == dstWidth ? srcWidth - 2u * x : 2u;
+    u32 count    = colCount * rowCount;
+
+    for(u32 channel = 0u; channel < Channels; ++channel) {
+      bool isAlpha = Channels == 4u && channel == 3u;
+
+      typename Color::Acc color = {};
+      typename Alpha::Acc alpha = {};
+
+      for(u32 row = 0u; row < rowCount; ++row) {
+        for(u32 col = 0u; col < colCount; ++col) {
+          T v = load(rows[row], (2u * x + col) * Channels + channel);
+          if(isAlpha) alpha += Alpha::Load(v);
+          else
+            color += Color::Load(v);
+        }
+      }
+
+      T v = isAlpha ? Alpha::Store(alpha, count)
+                    : Color::Store(color, count);
+      memcpy(dst + (x * Channels + channel) * sizeof(T), &v, sizeof(T));
+    }
+  }
+}
+
+// Filters the first count texels of a destination row, all of them
+// 2x2 blocks of linear values. Returns the texels written.
+using MipBoxFn =
+  u32 (*)(u8* dst, const u8* row0, const u8* row1, u32 count);
+
+// The table lookups don't vectorize, but the fixed taps still beat the
+// generic row.
+template<u32 Channels>
+static u32
+MipBoxRowSrgb(u8* dst, const u8* row0, const u8* row1, u32 count)
+{
+  const auto& tables = GetMipSrgbTables();
+
+  for(u32 x = 0u; x < count; ++x) {
+    const u8* a = row0 + x * 2u * Channels;
+    const u8* b = row1 + x * 2u * Channels;
+
+    for(u32 channel = 0u; channel < Channels; ++channel) {
+      const u32 next = channel + Channels;
+      if(Channels == 4u && channel == 3u) {
+        dst[channel] =
+          toU8((a[channel] + a[next] + b[channel] + b[next] + 2u) >> 2);
+      } else {
+        const auto& lin = tables.toLinear;
+
+        u32 sum = lin[a[channel]] + lin[a[next]] + lin[b[channel]] +
+                  lin[b[next]];
+        dst[channel] = tables.fromLinear[(sum + 2u) >> 2];
+      }
+    }
+
+    dst += Channels;
+  }
+
+  return count;
+}
+
+#ifdef VD_ARCH_X64
+
+// Reads 16 bytes from each row and writes 8 bytes.
+template<typename T, u32 Channels>
+static u32
+MipBoxRowSSE2(u8* dst, const u8* row0, const u8* row1, u32 count)
+{
+  constexpr u32 Step = 8u / (sizeof(T) * Channels);
+
+  const auto zero = _mm_setzero_si128();
+  const auto load = [](const u8* src) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  };
+
+  u32 x = 0u;
+  for(; x + Step <= count; x += Step) {
+    auto a = load(row0 + x * 16u / Step);
+    auto b = load(row1 + x * 16u / Step);
+    auto v = zero;
+
+    if constexpr(sizeof(T) == 1u) {
+      auto lo = _mm_add_epi16(
+        _mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+      auto hi = _mm_add_epi16(
+        _mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+      // Neighbor texels are adjacent 16-bit lanes or 64-bit halves.
+      auto sum = zero;
+      if constexpr(Channels == 1u) {
+        const auto ones = _mm_set1_epi16(1);
+        sum             = _mm_packs_epi32(
+          _mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+      } else {
+        sum = _mm_add_epi16(
+          _mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+      }
+
+      sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+      v   = _mm_packus_epi16(sum, sum);
+    } else {
+      auto lo = _mm_add_epi32(
+        _mm_unpacklo_epi16(a, zero), _mm_unpacklo_epi16(b, zero));
+      auto hi = _mm_add_epi32(
+        _mm_unpackhi_epi16(a, zero), _mm_unpackhi_epi16(b, zero));
+
+      auto sum = zero;
+      if constexpr(Channels == 1u) {
+        auto even = _mm_castps_si128(_mm_shuffle_ps(
+          _mm_castsi128_ps(lo), _mm_castsi128_ps(hi),
+          _MM_SHUFFLE(2, 0, 2, 0)));
+        auto odd = _mm_castps_si128(_mm_shuffle_ps(
+          _mm_castsi128_ps(lo), _mm_castsi128_ps(hi),
+          _MM_SHUFFLE(3, 1, 3, 1)));
+        sum = _mm_add_epi32(even, odd);
+      } else {
+        sum = _mm_add_epi32(lo, hi);
+      }
+
+      sum = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(2)), 2);
+
+      // No unsigned 32 to 16-bit pack in SSE2, bias to signed range.
+      const auto bias = _mm_set1_epi32(0x8000);
+      sum             = _mm_sub_epi32(sum, bias);
+      v               = _mm_xor_si128(
+        _mm_packs_epi32(sum, sum), _mm_set1_epi16(-0x8000));
+    }
+
+    _mm_storel_epi64(
+      reinterpret_cast<__m128i*>(dst + x * 8u / Step), v);
+  }
+
+  return x;
+}
+
+#endif
+
+struct MipFilter {
+  MipRowFn row = nullptr;
+  MipBoxFn box = nullptr;
+};
+
+template<typename T, u32 Channels>
+static MipFilter GetMipFilter(bool srgb)
+{
+  MipFilter ret;
+
+  if(srgb) {
+    ret.row = &MipFilterRow<T, Channels, true>;
+    if constexpr(sizeof(T) == 1u) ret.box = &MipBoxRowSrgb<Channels>;
+    return ret;
+  }
+
+  ret.row = &MipFilterRow<T, Channels, false>;
+
+#ifdef VD_ARCH_X64
+  if constexpr(std::is_integral_v<T>)
+    if(getCpuFeatures().sse2) ret.box = &MipBoxRowSSE2<T, Channels>;
+#endif
+
+  return ret;
+}
+
+static MipFilter GetMipFilter(Format format, bool srgb)
+{
+  switch(format) {
+    case Format::R8_UNORM:
+      return GetMipFilter<u8, 1u>(srgb);
+    case Format::R16_UNORM:
+      return GetMipFilter<u16, 1u>(srgb);
+    case Format::R8G8B8A8_UNORM:
+    case Format::B8G8R8A8_UNORM:
+      return GetMipFilter<u8, 4u>(srgb);
+    case Format::R8G8B8A8_SRGB:
+    case Format::B8G8R8A8_SRGB:
+      return GetMipFilter<u8, 4u>(true);
+    case Format::R16G16B16A16_UNORM:
+      return GetMipFilter<u16, 4u>(srgb);
+    case Format::R32G32B32A32_SFLOAT:
+      return GetMipFilter<f32, 4u>(false);
+    default:
+      throw std::runtime_error(
+        "DataReader: cannot generate mips for the image format");
+  }
+}
+
+static void MipDownsample(
+  const MipFilter& filter, u8* dst, UInt2 dstSize, const u8* src,
+  UInt2 srcSize, u32 texelSize)
+{
+  const u64 srcPitch = toU64(srcSize[0]) * texelSize;
+  const u64 dstPitch = toU64(dstSize[0]) * texelSize;
+
+  // Texels of a row that are plain 2x2 blocks.
+  const u32 boxCount =
+    srcSize[0] % 2u == 0u ? dstSize[0] : dstSize[0] - 1u;
+
+  for(u32 y = 0u; y < dstSize[1]; ++y) {
+    u32 rowCount = y + 1u == dstSize[1] ? srcSize[1] - 2u * y : 2u;
+
+    const u8* rows[3];
+    for(u32 row = 0u; row < rowCount; ++row)
+      rows[row] = src + (2u * toU64(y) + row) * srcPitch;
+
+    u8* dstRow = dst + y * dstPitch;
+
+    u32 first = 0u;
+    if(filter.box && rowCount == 2u)
+      first = filter.box(dstRow, rows[0], rows[1], boxCount);
+
+    filter.row(dstRow, rows, rowCount, srcSize[0], dstSize[0], first);
+  }
+}
+
+void DataReader::generateMips(data::Image& image, bool srgb)
+{
+  const auto filter    = GetMipFilter(image.format, srgb);
+  const u32  texelSize = getFormatSize(image.format);
+
+  // The first level of each layer is packed at the start, move them
+  // to their place in the chain, last layer first.
+  const u64 levelSize = getMipSize(image, 0u);
+
+  image.mips = getMipCount(image.size[0], image.size[1]);
+  image.texels.resize(getImageSize(image));
+
+  for(u32 layer = image.layers; layer-- > 1u;)
+    std::memmove(
+      image.texels.data() + getMipOffset(image, 0u, layer),
+      image.texels.data() + layer * levelSize, levelSize);
+
+  for(u32 layer = 0u; layer < image.layers; ++layer) {
+    for(u32 mip = 1u; mip < image.mips; ++mip) {
+      const UInt2 srcSize = {
+        getMipExtent(image.size[0], mip - 1u),
+        getMipExtent(image.size[1], mip - 1u)};
+      const UInt2 dstSize = {
+        getMipExtent(image.size[0], mip),
+        getMipExtent(image.size[1], mip)};
+
+      MipDownsample(
+        filter, image.texels.data() + getMipOffset(image, mip, layer),
+        dstSize,
+        image.texels.data() + getMipOffset(image, mip - 1u, layer),
+        srcSize, texelSize);
+    }
+  }
+}
+
+// Images larger than the import limit are resampled with a tent filter
+// as wide as the scale factor, separably: along the rows first, into
+// floats, then down the columns. sRGB colors are filtered linear.
+
+// How a channel converts to and from the filtered floats.
+template<typename T, bool Srgb>
+struct ResizeChannel {
+  static f32 Load(T v)
+  {
+    return toF32(v) / toF32(std::numeric_limits<T>::max());
+  }
+  static T Store(f32 v)
+  {
+    const f32 max = toF32(std::numeric_limits<T>::max());
+    return static_cast<T>(std::lround(std::clamp(v, 0.0f, 1.0f) * max));
+  }
+};
+
+template<>
+struct ResizeChannel<u8, true> {
+  static f32 Load(u8 v)
+  {
+    return toF32(GetMipSrgbTables().toLinear[v]) / 65535.0f;
+  }
+  static u8 Store(f32 v)
+  {
+    return GetMipSrgbTables().fromLinear[toU64(
+      std::lround(std::clamp(v, 0.0f, 1.0f) * 65535.0f))];
+  }
+};
+
+template<>
+struct ResizeChannel<u16, true> {
+  static f32 Load(u16 v) { return GetMipSrgbTables().toLinear16[v]; }
+  static u16 Store(f32 v)
+  {
+    f32 srgb = LinearToSrgb(std::clamp(v, 0.0f, 1.0f));
+    return toU16(std::lround(srgb * 65535.0f));
+  }
+};
+
+template<bool Srgb>
+struct ResizeChannel<f32, Srgb> {
+  static f32 Load(f32 v) { return v; }
+  static f32 Store(f32 v) { return v; }
+};
+
+// Source texels and weights of each destination texel along an axis,
+// count taps each. Taps past the edges weigh on the edge texels.
+struct ResizeTaps {
+  u32      count = 0u;
+  Arr<u32> first;
+  Arr<f32> weights;
+};
+
+static ResizeTaps GetResizeTaps(u32 srcSize, u32 dstSize)
+{
+  const f32 scale  = toF32(srcSize) / toF32(dstSize);
+  const f32 radius = std::max(scale, 1.0f);
+  const u32 span   = 2u * toU32(std::ceil(radius)) + 1u;
+
+  ResizeTaps ret;
+  ret.count = std::min(span, srcSize);
+  ret.first.resize(dstSize);
+  ret.weights.assign(toU64(dstSize) * ret.count, 0.0f);
+
+  for(u32 x = 0u; x < dstSize; ++x) {
+    const f32 center = (toF32(x) + 0.5f) * scale - 0.5f;
+    const i64 low    = toI64(std::floor(center - radius)) + 1;
+    const i64 first =
+      std::clamp<i64>(low, 0, toI64(srcSize) - toI64(ret.count));
+
+    f32* weights = ret.weights.data() + toU64(x) * ret.count;
+    f32  sum     = 0.0f;
+
+    for(i64 idx = low; idx < low + toI64(span); ++idx) {
+      const f32 w = 1.0f - std::abs(toF32(idx) - center) / radius;
+      if(w <= 0.0f) continue;
+
+      const i64 src = std::clamp<i64>(idx, 0, toI64(srcSize) - 1);
+      weights[src - first] += w;
+      sum                  += w;
+    }
+
+    for(u32 tap = 0u; tap < ret.count; ++tap) weights[tap] /= sum;
+    ret.first[x] = toU32(first);
+  }
+
+  return ret;
+}
+
+// Filters a row of floats along x.
+using ResizeRowFn =
+  void (*)(f32* dst, const f32* src, const ResizeTaps& taps);
+
+template<u32 Channels>
+static void ResizeRow(f32* dst, const f32* src, const ResizeTaps& taps)
+{
+  const u64 width = taps.first.size();
+  for(u64 x = 0u; x < width; ++x) {
+    const f32* texel   = src + toU64(taps.first[x]) * Channels;
+    const f32* weights = taps.weights.data() + x * taps.count;
+
+    for(u32 channel = 0u; channel < Channels; ++channel) {
+      f32 acc = 0.0f;
+      for(u32 tap = 0u; tap < taps.count; ++tap)
+        acc += weights[tap] * texel[tap * Channels + channel];
+      dst[x * Channels + channel] = acc;
+    }
+  }
+}
+
+// Weighted sum of count rows of size floats.
+using ResizeColumnFn = void (*)(
+  f32* dst, const f32* const* rows, const f32* weights, u32 count,
+  u64 size);
+
+// Sums the floats from first onwards.
+static void ResizeColumnTail(
+  f32* dst, const f32* const* rows, const f32* weights, u32 count,
+  u64 first, u64 size)
+{
+  for(u64 idx = first; idx < size; ++idx) {
+    f32 acc = 0.0f;
+    for(u32 tap = 0u; tap < count; ++tap)
+      acc += weights[tap] * rows[tap][idx];
+    dst[idx] = acc;
+  }
+}
+
+static void ResizeColumn(
+  f32* dst, const f32* const* rows, const f32* weights, u32 count,
+  u64 size)
+{
+  ResizeColumnTail(dst, rows, weights, count, 0u, size);
+}
+
+#ifdef VD_ARCH_X64
+
+// A texel of four channels fits a register.
+static void
+ResizeRowSSE2(f32* dst, const f32* src, const ResizeTaps& taps)
+{
+  const u64 width = taps.first.size();
+  for(u64 x = 0u; x < width; ++x) {
+    const f32* texel   = src + toU64(taps.first[x]) * 4u;
+    const f32* weights = taps.weights.data() + x * taps.count;
+
+    auto acc = _mm_setzero_ps();
+    for(u32 tap = 0u; tap < taps.count; ++tap) {
+      auto w = _mm_set1_ps(weights[tap]);
+      auto v = _mm_loadu_ps(texel + tap * 4u);
+      acc    = _mm_add_ps(acc, _mm_mul_ps(w, v));
+    }
+    _mm_storeu_ps(dst + x * 4u, acc);
+  }
+}
+
+static void ResizeColumnSSE2(
+  f32* dst, const f32* const* rows, const f32* weights, u32 count,
+  u64 size)
+{
+  u64 idx = 0u;
+  for(; idx + 4u <= size; idx += 4u) {
+    auto acc = _mm_setzero_ps();
+    for(u32 tap = 0u; tap < count; ++tap) {
+      auto w = _mm_set1_ps(weights[tap]);
+      auto v = _mm_loadu_ps(rows[tap] + idx);
+      acc    = _mm_add_ps(acc, _mm_mul_ps(w, v));
+    }
+    _mm_storeu_ps(dst + idx, acc);
+  }
+
+  ResizeColumnTail(dst, rows, weights, count, idx, size);
+}
+
+VD_TARGET("avx2")
+static void ResizeColumnAVX2(
+  f32* dst, const f32* const* rows, const f32* weights, u32 count,
+  u64 size)
+{
+  u64 idx = 0u;
+  for(; idx + 8u <= size; idx += 8u) {
+    auto acc = _mm256_setzero_ps();
+    for(u32 tap = 0u; tap < count; ++tap) {
+      auto w = _mm256_set1_ps(weights[tap]);
+      auto v = _mm256_loadu_ps(rows[tap] + idx);
+      acc    = _mm256_add_ps(acc, _mm256_mul_ps(w, v));
+    }
+    _mm256_storeu_ps(dst + idx, acc);
+  }
+
+  ResizeColumnTail(dst, rows, weights, count, idx, size);
+}
+
+#endif
+
+// Converts a row of texels to floats and back.
+using ResizeLoadFn  = void (*)(f32* dst, const u8* src, u32 width);
+using ResizeStoreFn = void (*)(u8* dst, const f32* src, u32 width);
+
+template<typename T, u32 Channels, bool Srgb>
+static void ResizeLoad(f32* dst, const u8* src, u32 width)
+{
+  for(u64 idx = 0u; idx < toU64(width) * Channels; ++idx) {
+    T v;
+    memcpy(&v, src + idx * sizeof(T), sizeof(T));
+    dst[idx] = Channels == 4u && idx % 4u == 3u
+                 ? ResizeChannel<T, false>::Load(v)
+                 : ResizeChannel<T, Srgb>::Load(v);
+  }
+}
+
+template<typename T, u32 Channels, bool Srgb>
+static void ResizeStore(u8* dst, const f32* src, u32 width)
+{
+  for(u64 idx = 0u; idx < toU64(width) * Channels; ++idx) {
+    T v = Channels == 4u && idx % 4u == 3u
+            ? ResizeChannel<T, false>::Store(src[idx])
+            : ResizeChannel<T, Srgb>::Store(src[idx]);
+    memcpy(dst + idx * sizeof(T), &v, sizeof(T));
+  }
+}
+
+struct ResizeFilter {
+  u32            channels = 0u;
+  ResizeLoadFn   load     = nullptr;
+  ResizeStoreFn  store    = nullptr;
+  ResizeRowFn    row      = nullptr;
+  ResizeColumnFn column   = &ResizeColumn;
+};
+
+template<typename T, u32 Channels>
+static ResizeFilter GetResizeFilter(bool srgb)
+{
+  ResizeFilter ret;
+  ret.channels = Channels;
+  ret.load     = srgb ? &ResizeLoad<T, Channels, true>
+                      : &ResizeLoad<T, Channels, false>;
+  ret.store    = srgb ? &ResizeStore<T, Channels, true>
+                      : &ResizeStore<T, Channels, false>;
+  ret.row      = &ResizeRow<Channels>;
+
+#ifdef VD_ARCH_X64
+  const auto& cpu = getCpuFeatures();
+  if(cpu.sse2) {
+    if constexpr(Channels == 4u) ret.row = &ResizeRowSSE2;
+    ret.column = &ResizeColumnSSE2;
+  }
+  if(cpu.avx2) ret.column = &ResizeColumnAVX2;
+#endif
+
+  return ret;
+}
+
+static ResizeFilter GetResizeFilter(Format format, bool srgb)
+{
+  switch(format) {
+    case Format::R8_UNORM:
+      return GetResizeFilter<u8, 1u>(srgb);
+    case Format::R16_UNORM:
+      return GetResizeFilter<u16, 1u>(srgb);
+    case Format::R8G8B8A8_UNORM:
+    case Format::B8G8R8A8_UNORM:
+      return GetResizeFilter<u8, 4u>(srgb);
+    case Format::R8G8B8A8_SRGB:
+    case Format::B8G8R8A8_SRGB:
+      return GetResizeFilter<u8, 4u>(true);
+    case Format::R16G16B16A16_UNORM:
+      return GetResizeFilter<u16, 4u>(srgb);
+    case Format::R32G32B32A32_SFLOAT:
+      return GetResizeFilter<f32, 4u>(false);
+    default:
+      throw std::runtime_error(
+        "DataReader: cannot resize the image format");
+  }
+}
+
+void DataReader::resizeImage(data::Image& image, UInt2 size, bool srgb)
+{
+  if(image.mips != 1u)
+    throw std::runtime_error("DataReader: cannot resize mipped images");
+
+  const auto filter    = GetResizeFilter(image.format, srgb);
+  const u32  texelSize = getFormatSize(image.format);
+  const auto taps      = GetResizeTaps(image.size[0], size[0]);
+  const auto columns   = GetResizeTaps(image.size[1], size[1]);
+
+  data::Image out;
+  out.uri    = image.uri;
+  out.format = image.format;
+  out.size   = size;
+  out.layers = image.layers;
+  out.texels.resize(getImageSize(out));
+
+  const u64 srcPitch = toU64(image.size[0]) * texelSize;
+  const u64 dstPitch = toU64(size[0]) * texelSize;
+  const u64 rowSize  = toU64(size[0]) * filter.channels;
+
+  // Every source row filtered along x, then each destination row sums
+  // the rows under its taps.
+  Arr<f32> line(toU64(image.size[0]) * filter.channels);
+  Arr<f32> rows(rowSize * image.size[1]);
+  Arr<f32> result(rowSize);
+
+  Arr<const f32*> sources(columns.count);
+
+  for(u32 layer = 0u; layer < image.layers; ++layer) {
+    const u8* src = image.texels.data() + layer * getMipSize(image, 0u);
+    u8*       dst = out.texels.data() + layer * getMipSize(out, 0u);
+
+    for(u32 y = 0u; y < image.size[1]; ++y) {
+      filter.load(line.data(), src + y * srcPitch, image.size[0]);
+      filter.row(rows.data() + y * rowSize, line.data(), taps);
+    }
+
+    for(u32 y = 0u; y < size[1]; ++y) {
+      for(u32 tap = 0u; tap < columns.count; ++tap)
+        sources[tap] =
+          rows.data() + toU64(columns.first[y] + tap) * rowSize;
+
+      filter.column(
+        result.data(), sources.data(),
+        columns.weights.data() + toU64(y) * columns.count,
+        columns.count, rowSize);
+      filter.store(dst + y * dstPitch, result.data(), size[0]);
+    }
+  }
+
+  image = std::move(out);
+}
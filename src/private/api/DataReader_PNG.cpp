@@ -1,360 +1,671 @@
+#include "api/Inflate.hpp"
+#include "api/PngUnfilter.hpp"
 #include "vuldir/DataReader.hpp"
+#include "vuldir/PixelConverter.hpp"
 
 using namespace vd;
 
 static constexpr u8 PngSignature[] = {137, 80, 78, 71, 13, 10, 26, 10};
 
-static constexpr u8 DeflateHCLENMap[] = {
-  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+// Texel expansion, fused into a single pass per scanline. The output
+// is R8 or R16 for grayscale, RGBA for everything else. 16-bit samples
+// are stored big-endian and are swapped to the host order.
+struct PngConvertParams {
+  const u8*             palette; // RGBA entries
+  u8                    alphaPadding;
+  const PixelConverter* rgb;      // 8-bit color to RGBA
+  SArr<u16, 3>          colorKey; // Transparent sample values
+};
 
-static constexpr u8 DeflateExtraLengthBits[] = {
-  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
-  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+using PngConvertFn = void (*)(
+  u8* dst, const u8* src, u32 width, const PngConvertParams& params);
 
-static constexpr u32 DeflateExtraLengthValue[] = {
-  3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
-  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static constexpr u32 GetPngChannelCount(u32 colorType)
+{
+  switch(colorType) {
+    case 2u: return 3u; // Color
+    case 4u: return 2u; // Grayscale with alpha
+    case 6u: return 4u; // Color with alpha
+    default: return 1u; // Grayscale or indexed color
+  }
+}
 
-static constexpr u8 DeflateExtraDistanceBits[] = {
-  0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
-  6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
-static constexpr u32 DeflateExtraDistanceValue[] = {
-  1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
-  33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
-  1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static inline u16 PngLoadU16(const u8* src)
+{
+  return toU16((src[0] << 8) | src[1]);
+}
 
-class HuffmanTable
+static inline void PngStoreU16(u8* dst, u16 value)
 {
-public:
-  HuffmanTable(u32 maxLength): m_entries{}, m_maxLength{maxLength}
-  {
-    if(maxLength >= MaxBits)
-      throw std::runtime_error("Huffman table: size is too big");
+  memcpy(dst, &value, sizeof(value));
+}
 
-    u64 entryCount = 1ull << maxLength;
-    m_entries.resize(entryCount);
+// Expands every possible byte of low bit depth samples at once.
+// Grayscale samples are scaled to the full range by bit replication.
+template<u32 BitDepth, bool Scale>
+static constexpr auto PngExpandTable = [] {
+  constexpr u32 PerByte = 8u / BitDepth;
+  constexpr u32 Mask    = (1u << BitDepth) - 1u;
+
+  SArr<SArr<u8, PerByte>, 256> ret{};
+  for(u32 byte = 0u; byte < 256u; ++byte) {
+    for(u32 idx = 0u; idx < PerByte; ++idx) {
+      u32 value = (byte >> (8u - BitDepth * (idx + 1u))) & Mask;
+      ret[byte][idx] = toU8(Scale ? value * (0xffu / Mask) : value);
+    }
   }
+  return ret;
+}();
 
-  HuffmanTable(u32 maxLength, Span<u8 const> symbolLengths):
-    HuffmanTable(maxLength)
-  {
-    Initialize(symbolLengths);
+template<u32 ColorType, u32 BitDepth>
+static void PngConvertRow(
+  u8* dst, const u8* src, u32 width, const PngConvertParams& params)
+{
+  if constexpr(BitDepth < 8u) {
+    // Grayscale or indexed color.
+    constexpr u32  PerByte = 8u / BitDepth;
+    constexpr bool Scale   = ColorType == 0u;
+    const auto&    table   = PngExpandTable<BitDepth, Scale>;
+
+    u32 idx = 0u;
+    for(; idx + PerByte <= width; idx += PerByte) {
+      const auto& values = table[*src++];
+      if constexpr(ColorType == 0u) {
+        memcpy(dst + idx, values.data(), PerByte);
+      } else {
+        for(u32 sub = 0u; sub < PerByte; ++sub)
+          memcpy(
+            dst + (idx + sub) * 4u, params.palette + values[sub] * 4u,
+            4u);
+      }
+    }
+
+    if(idx < width) {
+      const auto& values = table[*src];
+      for(u32 sub = 0u; idx < width; ++idx, ++sub) {
+        if constexpr(ColorType == 0u) dst[idx] = values[sub];
+        else
+          memcpy(dst + idx * 4u, params.palette + values[sub] * 4u, 4u);
+      }
+    }
+  } else if constexpr(ColorType == 3u) {
+    for(u32 idx = 0u; idx < width; ++idx)
+      memcpy(dst + idx * 4u, params.palette + src[idx] * 4u, 4u);
+  } else if constexpr(BitDepth == 8u) {
+    if constexpr(ColorType == 2u) {
+      params.rgb->ConvertRow(dst, src, width);
+    } else if constexpr(ColorType == 4u) {
+      for(u32 idx = 0u; idx < width; ++idx, src += 2u, dst += 4u) {
+        memset(dst, src[0], 3u);
+        dst[3] = src[1];
+      }
+    } else {
+      constexpr u32 ChannelCount = GetPngChannelCount(ColorType);
+      memcpy(dst, src, toU64(width) * ChannelCount);
+    }
+  } else {
+    if constexpr(ColorType == 2u) {
+      const u16 alpha = toU16(params.alphaPadding * 0x101u);
+      for(u32 idx = 0u; idx < width; ++idx, src += 6u, dst += 8u) {
+        PngStoreU16(dst + 0u, PngLoadU16(src + 0u));
+        PngStoreU16(dst + 2u, PngLoadU16(src + 2u));
+        PngStoreU16(dst + 4u, PngLoadU16(src + 4u));
+        PngStoreU16(dst + 6u, alpha);
+      }
+    } else if constexpr(ColorType == 4u) {
+      for(u32 idx = 0u; idx < width; ++idx, src += 4u, dst += 8u) {
+        u16 gray = PngLoadU16(src);
+        PngStoreU16(dst + 0u, gray);
+        PngStoreU16(dst + 2u, gray);
+        PngStoreU16(dst + 4u, gray);
+        PngStoreU16(dst + 6u, PngLoadU16(src + 2u));
+      }
+    } else {
+      constexpr u32 ChannelCount = GetPngChannelCount(ColorType);
+      for(u32 idx = 0u; idx < width * ChannelCount; ++idx)
+        PngStoreU16(dst + idx * 2u, PngLoadU16(src + idx * 2u));
+    }
   }
+}
 
-  void Initialize(Span<u8 const> symbolLengths)
-  {
-    u32 lengthCounts[MaxBits] = {};
-    for(u32 symbolIdx = 0u; symbolIdx < std::size(symbolLengths);
-        ++symbolIdx) {
-      if(symbolLengths[symbolIdx] >= std::size(lengthCounts))
-        throw std::runtime_error(
-          "Huffman table: invalid symbol lengths");
-      ++lengthCounts[symbolLengths[symbolIdx]];
+// Grayscale and color images with a transparent color key from the
+// tRNS chunk are expanded to RGBA. Samples are compared to the key
+// before they are scaled.
+template<u32 ColorType, u32 BitDepth>
+static void PngConvertRowKeyed(
+  u8* dst, const u8* src, u32 width, const PngConvertParams& params)
+{
+  constexpr u32 ChannelCount = GetPngChannelCount(ColorType);
+  constexpr u32 Mask         = (1u << BitDepth) - 1u;
+  constexpr u32 Scale        = BitDepth < 8u ? 0xffu / Mask : 1u;
+
+  const u16 alpha = toU16(params.alphaPadding * 0x101u);
+
+  for(u32 idx = 0u; idx < width; ++idx) {
+    u32  values[3] = {};
+    bool isKey     = true;
+    for(u32 ch = 0u; ch < ChannelCount; ++ch) {
+      const u64 bit = (toU64(idx) * ChannelCount + ch) * BitDepth;
+      if constexpr(BitDepth == 16u)
+        values[ch] = PngLoadU16(src + bit / 8u);
+      else
+        values[ch] =
+          (src[bit / 8u] >> (8u - BitDepth - bit % 8u)) & Mask;
+      isKey = isKey && values[ch] == params.colorKey[ch];
     }
-    lengthCounts[0] = 0u;
+    if constexpr(ColorType == 0u) values[1] = values[2] = values[0];
 
-    u32 nextCode[MaxBits] = {};
-    for(u32 idx = 1u; idx < MaxBits; ++idx) {
-      nextCode[idx] = (nextCode[idx - 1u] + lengthCounts[idx - 1u])
-                      << 1;
+    if constexpr(BitDepth == 16u) {
+      for(u32 ch = 0u; ch < 3u; ++ch)
+        PngStoreU16(dst + ch * 2u, toU16(values[ch]));
+      PngStoreU16(dst + 6u, isKey ? u16{0u} : alpha);
+      dst += 8u;
+    } else {
+      for(u32 ch = 0u; ch < 3u; ++ch)
+        dst[ch] = toU8(values[ch] * Scale);
+      dst[3] = isKey ? u8{0u} : params.alphaPadding;
+      dst += 4u;
     }
+  }
+}
 
-    for(u32 symbolIdx = 0u; symbolIdx < std::size(symbolLengths);
-        ++symbolIdx) {
-      auto length = symbolLengths[symbolIdx];
-      if(length == 0u) continue;
+#ifdef VD_ARCH_X64
 
-      if(length >= MaxBits)
-        throw std::runtime_error(
-          "Huffman table: invalid symbol lengths");
+// A shuffle expands a group of pixels into a full register. Output
+// bytes marked with -1 are filled with the alpha padding.
+struct PngShuffle {
+  u32          pixels;
+  u32          loadSize;
+  SArr<i8, 16> mask;
+};
 
-      auto code = nextCode[length];
-      ++nextCode[length];
+template<u32 ColorType, u32 BitDepth>
+static constexpr PngShuffle GetPngShuffle()
+{
+  constexpr SArr<i8, 16> swap16 = {1, 0, 3, 2,  5,  4,  7,  6,
+                                   9, 8, 11, 10, 13, 12, 15, 14};
+
+  if constexpr(ColorType == 0u && BitDepth == 16u)
+    return {8u, 16u, swap16};
+  if constexpr(ColorType == 2u && BitDepth == 16u)
+    return {
+      2u, 16u, {1, 0, 3, 2, 5, 4, -1, -1, 7, 6, 9, 8, 11, 10, -1, -1}};
+  if constexpr(ColorType == 4u && BitDepth == 8u)
+    return {4u, 8u, {0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7}};
+  if constexpr(ColorType == 4u && BitDepth == 16u)
+    return {2u, 8u, {1, 0, 1, 0, 1, 0, 3, 2, 5, 4, 5, 4, 5, 4, 7, 6}};
+  if constexpr(ColorType == 6u && BitDepth == 16u)
+    return {2u, 16u, swap16};
+
+  return {};
+}
 
-      u32 padBits  = m_maxLength - length;
-      u32 padCount = 1u << padBits;
-      for(u32 pad = 0u; pad < padCount; ++pad) {
-        u32 reverseIdx = (code << padBits) | pad;
-        u32 entryIdx   = bitReverse(reverseIdx, m_maxLength);
+// Loads never cross the end of the scanline, the last pixels go
+// through the scalar code.
+template<u32 ColorType, u32 BitDepth>
+VD_TARGET("ssse3")
+static void PngConvertRowSSSE3(
+  u8* dst, const u8* src, u32 width, const PngConvertParams& params)
+{
+  static constexpr auto shuffle = GetPngShuffle<ColorType, BitDepth>();
 
-        m_entries[entryIdx].symbol = static_cast<u16>(symbolIdx);
-        m_entries[entryIdx].bits   = length;
-      }
-    }
+  constexpr u32 SrcSize = GetPngChannelCount(ColorType) * BitDepth / 8u;
+  constexpr u32 DstSize = 16u / shuffle.pixels;
+
+  const auto mask =
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(&shuffle.mask));
+  const auto fill = _mm_and_si128(
+    _mm_cmpeq_epi8(mask, _mm_set1_epi8(-1)),
+    _mm_set1_epi8(static_cast<char>(params.alphaPadding)));
+
+  u32 idx = 0u;
+  for(; (idx * SrcSize) + shuffle.loadSize <= width * SrcSize;
+      idx += shuffle.pixels) {
+    const auto* in =
+      reinterpret_cast<const __m128i*>(src + idx * SrcSize);
+
+    __m128i pixels;
+    if constexpr(shuffle.loadSize == 16u) pixels = _mm_loadu_si128(in);
+    else
+      pixels = _mm_loadl_epi64(in);
+
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(dst + idx * DstSize),
+      _mm_or_si128(_mm_shuffle_epi8(pixels, mask), fill));
   }
 
-  u32 Decode(BitIStream& src)
-  {
-    auto idx = src.Peek(m_maxLength);
-    if(idx >= m_entries.size())
-      throw std::runtime_error("Huffman table: symbol out of range");
+  PngConvertRow<ColorType, BitDepth>(
+    dst + idx * DstSize, src + idx * SrcSize, width - idx, params);
+}
 
-    const auto& entry = m_entries[idx];
+#endif
 
-    if(entry.bits == 0u)
-      throw std::runtime_error("Huffman table: symbol has zero length");
+struct PngPixelLayout {
+  u32          channelCount;
+  Format       format;
+  PngConvertFn convert;
+  // With a color key, null for types that can't have one.
+  Format       keyedFormat;
+  PngConvertFn convertKeyed;
+};
 
-    src.Skip(entry.bits);
-    return entry.symbol;
+// Pixel layout and conversion kernel for each valid color type and bit
+// depth combination, picked once for the CPU.
+class PngConverterTable
+{
+public:
+  PngConverterTable()
+  {
+    initialize<0u, 1u>();
+    initialize<0u, 2u>();
+    initialize<0u, 4u>();
+    initialize<0u, 8u>();
+    initialize<0u, 16u>();
+    initialize<2u, 8u>();
+    initialize<2u, 16u>();
+    initialize<3u, 1u>();
+    initialize<3u, 2u>();
+    initialize<3u, 4u>();
+    initialize<3u, 8u>();
+    initialize<4u, 8u>();
+    initialize<4u, 16u>();
+    initialize<6u, 8u>();
+    initialize<6u, 16u>();
   }
 
-  template<typename T>
-  T Decode(BitIStream& src)
+  // Returns null for combinations that are not allowed.
+  const PngPixelLayout* Get(u32 colorType, u32 bitDepth) const
   {
-    return static_cast<T>(Decode(src));
+    if(
+      colorType > 6u || bitDepth > 16u ||
+      !std::has_single_bit(bitDepth))
+      return nullptr;
+
+    const auto& layout =
+      m_layouts[colorType][std::countr_zero(bitDepth)];
+    return layout.convert ? &layout : nullptr;
   }
 
 private:
-  static constexpr u32 MaxBits = 16u;
+  template<u32 ColorType, u32 BitDepth>
+  void initialize()
+  {
+    auto& layout = m_layouts[ColorType][std::countr_zero(BitDepth)];
 
-  struct HuffmanEntry {
-    u16 symbol;
-    u8  bits;
-  };
+    layout.channelCount = GetPngChannelCount(ColorType);
+
+    if constexpr(ColorType == 0u)
+      layout.format =
+        BitDepth == 16u ? Format::R16_UNORM : Format::R8_UNORM;
+    else
+      layout.format = BitDepth == 16u ? Format::R16G16B16A16_UNORM
+                                      : Format::R8G8B8A8_UNORM;
+
+    layout.convert = &PngConvertRow<ColorType, BitDepth>;
+
+    if constexpr(ColorType == 0u || ColorType == 2u) {
+      layout.keyedFormat  = BitDepth == 16u ? Format::R16G16B16A16_UNORM
+                                            : Format::R8G8B8A8_UNORM;
+      layout.convertKeyed = &PngConvertRowKeyed<ColorType, BitDepth>;
+    }
+
+#ifdef VD_ARCH_X64
+    if constexpr(GetPngShuffle<ColorType, BitDepth>().pixels != 0u) {
+      if(getCpuFeatures().ssse3)
+        layout.convert = &PngConvertRowSSSE3<ColorType, BitDepth>;
+    }
+#endif
+  }
 
 private:
-  std::vector<HuffmanEntry> m_entries;
-  u32                       m_maxLength;
+  PngPixelLayout m_layouts[7][5] = {};
 };
 
-static Arr<u8> ZLibDeflate(Span<u8 const> inData, u64 sizeHint = 0u)
+// Unfilters the inflated image data as it arrives, one scanline at a
+// time, and writes the converted rows to the destination.
+// Only the last two scanlines are kept, the destination is never read.
+// Adam7 passes are reduced images, their rows are converted first and
+// then scattered to the destination pixels.
+class PngScanlineDecoder
 {
-  ByteIStream inBytes(inData);
+public:
+  struct Desc {
+    UInt2            size;
+    u32              bitsPerPixel;
+    bool             interlaced;
+    u8*              dst;
+    u64              rowPitch;
+    u32              bytesPerTexel;
+    PngConvertFn     convert;
+    PngConvertParams params;
+  };
 
-  u8 CMF = inBytes.Read<u8>();
-  u8 FLG = inBytes.Read<u8>();
+public:
+  PngScanlineDecoder(const Desc& desc):
+    m_bitsPerPixel{desc.bitsPerPixel},
+    m_bytesPerPixel{std::max(1u, desc.bitsPerPixel / 8u)},
+    m_bytesPerTexel{desc.bytesPerTexel},
+    m_dst{desc.dst},
+    m_rowPitch{desc.rowPitch},
+    m_convert{desc.convert},
+    m_params{desc.params},
+    m_passes{},
+    m_passIdx{0u},
+    m_rowIdx{0u},
+    m_scanlineSize{0u},
+    m_rows{},
+    m_filtered{},
+    m_filteredSize{0u},
+    m_converted{}
+  {
+    // Origin and spacing of the pixels in each pass.
+    static constexpr u32 Adam7[7][4] = {
+      {0u, 0u, 8u, 8u}, {4u, 0u, 8u, 8u}, {0u, 4u, 4u, 8u},
+      {2u, 0u, 4u, 4u}, {0u, 2u, 2u, 4u}, {1u, 0u, 2u, 2u},
+      {0u, 1u, 1u, 2u}};
+
+    const auto size = desc.size;
+
+    if(desc.interlaced) {
+      for(const auto& [x0, y0, dx, dy]: Adam7) {
+        // Empty passes have no scanlines at all.
+        if(size[0] <= x0 || size[1] <= y0) continue;
+        m_passes.push_back(
+          {x0, y0, dx, dy, (size[0] - x0 + dx - 1u) / dx,
+           (size[1] - y0 + dy - 1u) / dy});
+      }
+      m_converted.resize(
+        toU64((size[0] + 1u) / 2u) * m_bytesPerTexel);
+    } else if(size[0] > 0u && size[1] > 0u) {
+      m_passes.push_back({0u, 0u, 1u, 1u, size[0], size[1]});
+    }
 
-  u8 compressionMethod = CMF & 0xf;
-  // u8 compressionInfo   = CMF >> 4;
-  // u8 checkBits         = FLG & 0x1f;
-  u8 presetDictionary = (FLG >> 5) & 0x1;
-  // u8 compressionLevel  = FLG >> 6;
+    u64 maxScanlineSize = getScanlineSize(size[0]);
+    m_rows.resize(2u * maxScanlineSize);
+    m_filtered.resize(maxScanlineSize + 1u);
 
-  if(compressionMethod != 8u || presetDictionary != 0u)
-    throw std::runtime_error("Deflate: unsopported settings");
+    if(!m_passes.empty())
+      m_scanlineSize = getScanlineSize(m_passes[0].width);
+  }
 
-  BitIStream  inBits(inBytes.ReadAllBytes());
-  ByteOStream outBytes(sizeHint);
+  void Write(Span<u8 const> bytes)
+  {
+    while(!bytes.empty() && m_passIdx < m_passes.size()) {
+      const u64 filteredSize = m_scanlineSize + 1u;
+
+      // Whole scanlines are decoded in place.
+      if(m_filteredSize == 0u && bytes.size() >= filteredSize) {
+        decodeRow(bytes.data());
+        bytes = bytes.subspan(filteredSize);
+        continue;
+      }
 
-  // Deflate
-  for(;;) {
-    u32 BFINAL = inBits.Read(1);
-    u32 BTYPE  = inBits.Read(2);
+      auto count =
+        std::min(bytes.size(), filteredSize - m_filteredSize);
+      memcpy(m_filtered.data() + m_filteredSize, bytes.data(), count);
+      m_filteredSize += count;
+      bytes = bytes.subspan(count);
 
-    HuffmanTable literalLengthTable(15u);
-    HuffmanTable distanceTable(15u);
+      if(m_filteredSize == filteredSize) {
+        decodeRow(m_filtered.data());
+        m_filteredSize = 0u;
+      }
+    }
+  }
 
-    if(BTYPE == 0u) // Literal
-    {
-      inBits.SkipToNextByte();
-      u32 LEN  = inBits.Read(16);
-      u32 NLEN = inBits.Read(16);
+  void Finish() const
+  {
+    if(m_passIdx != m_passes.size())
+      throw std::runtime_error("PNG: not enough image data");
+  }
 
-      if(LEN != ~NLEN)
-        throw std::runtime_error("Deflate: bad block length");
+  // Decoding can start in the middle of an image that is not
+  // interlaced. The first row is then unfiltered against the last row
+  // of the part above, as returned by GetLastRow.
+  void SetPreviousRow(Span<u8 const> row)
+  {
+    memcpy(m_rows.data() + m_scanlineSize, row.data(), m_scanlineSize);
+  }
 
-      for(u32 idx = 0u; idx < LEN; ++idx)
-        outBytes.Write(static_cast<u8>(inBits.Read(8u)));
-    } else {
-      std::array<u8, 512u> huffmanBuffer = {};
-      std::span<u8>        lengthData;
-      std::span<u8>        distanceData;
-
-      if(BTYPE == 1u) { // Default table
-        for(u32 idx = 0u; idx < 144u; ++idx) huffmanBuffer[idx] = 8u;
-        for(u32 idx = 144u; idx < 256u; ++idx) huffmanBuffer[idx] = 9u;
-        for(u32 idx = 256u; idx < 280u; ++idx) huffmanBuffer[idx] = 7u;
-        for(u32 idx = 280u; idx < 288u; ++idx) huffmanBuffer[idx] = 8u;
-        for(u32 idx = 288u; idx < 318u; ++idx) huffmanBuffer[idx] = 5u;
-
-        lengthData   = {huffmanBuffer.data(), 288u};
-        distanceData = {huffmanBuffer.data() + 288u, 32u};
-      } else if(BTYPE == 2u) { // Dynamic table
-        u32 HLIT  = inBits.Read(5) + 257u;
-        u32 HDIST = inBits.Read(5) + 1u;
-        u32 HCLEN = inBits.Read(4) + 4u;
-
-        u8 HCLEN_table[std::size(DeflateHCLENMap)] = {};
-        for(u32 idx = 0u; idx < HCLEN; ++idx)
-          HCLEN_table[DeflateHCLENMap[idx]] =
-            static_cast<u8>(inBits.Read(3u));
-
-        HuffmanTable lengthTable(7u, HCLEN_table);
-
-        u32 lengthIdx   = 0u;
-        u32 lengthCount = HLIT + HDIST;
-
-        while(lengthIdx < lengthCount) {
-          u8 lengthRepeat  = 1u;
-          u8 lengthValue   = 0u;
-          u8 encodedLength = lengthTable.Decode<u8>(inBits);
-
-          if(encodedLength <= 15u) {
-            lengthValue = encodedLength;
-          } else if(encodedLength == 16u) {
-            lengthRepeat = 3u + inBits.Read<u8>(2);
-            if(lengthIdx == 0u)
-              throw std::runtime_error("Deflate: bad encoded length");
-            lengthValue = huffmanBuffer[lengthIdx - 1u];
-          } else if(encodedLength == 17u) {
-            lengthRepeat = 3u + inBits.Read<u8>(3);
-          } else if(encodedLength == 18u) {
-            lengthRepeat = 11u + inBits.Read<u8>(7);
-          } else {
-            throw std::runtime_error("Deflate: bad encoded length");
-          }
-
-          for(u32 idx = 0u; idx < lengthRepeat; ++idx) {
-            huffmanBuffer[lengthIdx] = lengthValue;
-            ++lengthIdx;
-          }
-
-          lengthData   = {huffmanBuffer.data(), HLIT};
-          distanceData = {huffmanBuffer.data() + HLIT, HDIST};
-        }
+  Span<u8 const> GetLastRow() const
+  {
+    // The last row is the one before the reset of the row index.
+    u32 rowIdx = m_passes.empty() ? 0u : m_passes.back().height - 1u;
+    return {m_rows.data() + (rowIdx & 1u) * m_scanlineSize,
+            m_scanlineSize};
+  }
 
-        if(lengthIdx != lengthCount)
-          throw new std::runtime_error(
-            "Deflate: bad literal length count");
+private:
+  struct Pass {
+    u32 x0;
+    u32 y0;
+    u32 dx;
+    u32 dy;
+    u32 width;
+    u32 height;
+  };
 
-      } else {
-        throw std::runtime_error("Deflate: bad block type");
-      }
+private:
+  u32 getScanlineSize(u32 width) const
+  {
+    return toU32((toU64(width) * m_bitsPerPixel + 7u) / 8u);
+  }
 
-      literalLengthTable.Initialize(lengthData);
-      distanceTable.Initialize(distanceData);
+  void decodeRow(const u8* src)
+  {
+    const auto& pass = m_passes[m_passIdx];
 
-      for(;;) {
-        u32 literalLength = literalLengthTable.Decode(inBits);
+    // The two scanline buffers alternate, the first row of each pass
+    // reads the zeroed one as its previous row.
+    u8*       cur  = m_rows.data() + (m_rowIdx & 1u) * m_scanlineSize;
+    const u8* prev = m_rows.data() + (~m_rowIdx & 1u) * m_scanlineSize;
 
-        if(literalLength == 256u) break;
+    PngUnfilter(
+      src[0], cur, src + 1u, prev, m_scanlineSize, m_bytesPerPixel);
 
-        if(literalLength < 256u) {
-          outBytes.Write(literalLength & 0xff);
-        } else {
-          auto literalIdx = literalLength - 257u;
-          auto length     = DeflateExtraLengthValue[literalIdx];
+    u8* dst =
+      m_dst + toU64(pass.y0 + m_rowIdx * pass.dy) * m_rowPitch;
 
-          auto lengthExtraBits = DeflateExtraLengthBits[literalIdx];
-          if(lengthExtraBits > 0u)
-            length += inBits.Read(lengthExtraBits);
+    if(pass.dx == 1u) {
+      m_convert(dst, cur, pass.width, m_params);
+    } else {
+      m_convert(m_converted.data(), cur, pass.width, m_params);
+      for(u32 idx = 0u; idx < pass.width; ++idx)
+        memcpy(
+          dst + toU64(pass.x0 + idx * pass.dx) * m_bytesPerTexel,
+          m_converted.data() + toU64(idx) * m_bytesPerTexel,
+          m_bytesPerTexel);
+    }
 
-          auto distanceIdx = distanceTable.Decode(inBits);
-          auto distance    = DeflateExtraDistanceValue[distanceIdx];
+    if(++m_rowIdx == pass.height) nextPass();
+  }
 
-          auto distanceExtraBits =
-            DeflateExtraDistanceBits[distanceIdx];
-          if(distanceExtraBits > 0u)
-            distance += inBits.Read(distanceExtraBits);
+  void nextPass()
+  {
+    m_rowIdx = 0u;
+    if(++m_passIdx == m_passes.size()) return;
 
-          if(outBytes.size() < distance)
-            throw std::runtime_error(
-              "Deflate: out of bounds lookback distance");
+    m_scanlineSize = getScanlineSize(m_passes[m_passIdx].width);
+    std::fill(m_rows.begin(), m_rows.end(), u8{0u});
+  }
 
-          auto rangeStart = outBytes.size() - distance;
-          for(u32 idx = 0u; idx < length; ++idx)
-            outBytes.Write(outBytes[rangeStart + idx]);
-        }
-      }
+private:
+  u32              m_bitsPerPixel;
+  u32              m_bytesPerPixel;
+  u32              m_bytesPerTexel;
+  u8*              m_dst;
+  u64              m_rowPitch;
+  PngConvertFn     m_convert;
+  PngConvertParams m_params;
+  Arr<Pass>        m_passes;
+  u64              m_passIdx;
+  u32              m_rowIdx;
+  u32              m_scanlineSize;
+  Arr<u8>          m_rows;
+  Arr<u8>          m_filtered;
+  u64              m_filteredSize;
+  Arr<u8>          m_converted;
+};
+
+// Part of the image data that starts after a full flush, so it can be
+// inflated on its own.
+struct PngSegment {
+  u32                 firstRow;
+  u32                 rowCount;
+  Arr<Span<u8 const>> data;
+};
+
+// Matches the iDOT split points to the IDAT chunks. Returns nothing if
+// they don't describe the image data.
+static Arr<PngSegment> GetPngSegments(
+  u32 height, const Arr<Span<u8 const>>& imageData,
+  const Arr<u64>& imageDataOffsets, const Arr<u32>& segmentRows,
+  const Arr<u64>& segmentOffsets)
+{
+  Arr<PngSegment> ret;
+
+  u64 firstRow = 0u;
+  u64 firstIdx = 0u;
+  for(u64 idx = 0u; idx < segmentRows.size(); ++idx) {
+    u64 lastIdx = imageData.size();
+    if(idx < segmentOffsets.size()) {
+      auto it = std::find(
+        imageDataOffsets.begin() + toI64(firstIdx) + 1,
+        imageDataOffsets.end(), segmentOffsets[idx]);
+      if(it == imageDataOffsets.end()) return {};
+      lastIdx = toU64(it - imageDataOffsets.begin());
     }
-    if(BFINAL) break;
+
+    if(segmentRows[idx] == 0u) return {};
+
+    auto& segment    = ret.emplace_back();
+    segment.firstRow = toU32(firstRow);
+    segment.rowCount = segmentRows[idx];
+    segment.data.assign(
+      imageData.begin() + toI64(firstIdx),
+      imageData.begin() + toI64(lastIdx));
+
+    firstRow += segmentRows[idx];
+    firstIdx = lastIdx;
   }
 
-  return outBytes.data();
+  if(firstRow != height) return {};
+  return ret;
 }
 
-static Arr<u8> PngReconstruct(
-  Span<u8 const> data, UInt2 size, u32 channelCount, u32 bitsPerChannel)
+// Decodes the segments on separate threads, each one writing its own
+// rows. A segment starting with a row filtered against the row above
+// buffers its data until the previous segment is done. When verifying,
+// the checksums of the segments are combined and false is returned if
+// they don't match the stream.
+static bool PngDecodeSegments(
+  const Arr<PngSegment>& segments, u32 threadCount,
+  const PngScanlineDecoder::Desc& desc, bool verifyChecksum)
 {
-  // Calculate packed scanline size in bytes.
-  u32 scanlineSize =
-    (size[0] * bitsPerChannel * channelCount + 7u) / 8u;
-  // For filtering operations, need at least 1 byte per pixel.
-  u32 bytesPerPixel =
-    std::max(1u, (bitsPerChannel * channelCount + 7u) / 8u);
-  u32 outputSize = size[1] * scanlineSize;
-
-  ByteIStream inData(data);
-  ByteOStream outData(outputSize);
-
-  const auto paeth = [](u8 a, u8 b, u8 c) {
-    auto p  = a + b - c;
-    auto pa = std::abs(p - a);
-    auto pb = std::abs(p - b);
-    auto pc = std::abs(p - c);
-    if(pa <= pb && pa <= pc) return a;
-    else if(pb <= pc)
-      return b;
-    else
-      return c;
-  };
+  std::mutex              mutex;
+  std::condition_variable segmentDone;
 
-  Span<u8 const> previousScanline;
-  for(u32 rowIdx = 0u; rowIdx < size[1]; ++rowIdx) {
-    u64 scanlineStart = outData.size();
+  // Per segment: 0 while decoding, 1 when done and 2 on failure.
+  Arr<u8>      states(segments.size(), 0u);
+  Arr<Arr<u8>> lastRows(segments.size());
+  Arr<u32>     checksums(segments.size(), 1u);
+  Arr<u64>     inflatedSizes(segments.size(), 0u);
+  u32          expectedChecksum = 0u;
 
-    u32  filter   = inData.Read<u8>();
-    auto scanline = inData.ReadBytes(scanlineSize);
+  const u64 scanlineSize =
+    (toU64(desc.size[0]) * desc.bitsPerPixel + 7u) / 8u;
 
-    switch(filter) {
-      case 0u:
-        outData.Write(scanline);
-        break;
-      case 1u: {
-        for(u32 byteIdx = 0u; byteIdx < bytesPerPixel; ++byteIdx)
-          outData.Write(scanline[byteIdx]);
-        for(u32 byteIdx = bytesPerPixel; byteIdx < scanline.size();
-            ++byteIdx) {
-          u8 cur  = scanline[byteIdx];
-          u8 left = outData[outData.size() - bytesPerPixel];
-          outData.Write(cur + left);
-        }
-      } break;
-      case 2u:
-        for(u32 byteIdx = 0u; byteIdx < scanline.size(); ++byteIdx) {
-          u8 cur = scanline[byteIdx];
-          u8 top = previousScanline[byteIdx];
-          outData.Write(cur + top);
-        }
-        break;
-      case 3u:
-        for(u32 byteIdx = 0u; byteIdx < bytesPerPixel; ++byteIdx) {
-          u8 cur  = scanline[byteIdx];
-          u8 left = 0u;
-          u8 top  = previousScanline[byteIdx];
-          outData.Write(cur + (left + top) / 2u);
-        }
-        for(u32 byteIdx = bytesPerPixel; byteIdx < scanline.size();
-            ++byteIdx) {
-          u8 cur  = scanline[byteIdx];
-          u8 left = outData[outData.size() - bytesPerPixel];
-          u8 top  = previousScanline[byteIdx];
-          outData.Write(cur + (left + top) / 2u);
-        }
-        break;
-      case 4u:
-        for(u32 byteIdx = 0u; byteIdx < bytesPerPixel; ++byteIdx) {
-          u8 cur     = scanline[byteIdx];
-          u8 left    = 0u;
-          u8 top     = previousScanline[byteIdx];
-          u8 topLeft = 0;
-          outData.Write(cur + paeth(left, top, topLeft));
-        }
-        for(u32 byteIdx = bytesPerPixel; byteIdx < scanline.size();
-            ++byteIdx) {
-          u8 cur     = scanline[byteIdx];
-          u8 left    = outData[outData.size() - bytesPerPixel];
-          u8 top     = previousScanline[byteIdx];
-          u8 topLeft = previousScanline[byteIdx - bytesPerPixel];
-          outData.Write(cur + paeth(left, top, topLeft));
+  const auto decodeSegment = [&](u64 idx) {
+    const auto& segment = segments[idx];
+
+    auto segmentDesc    = desc;
+    segmentDesc.size[1] = segment.rowCount;
+    segmentDesc.dst     = desc.dst + segment.firstRow * desc.rowPitch;
+
+    PngScanlineDecoder decoder(segmentDesc);
+
+    bool    started = false;
+    Arr<u8> pending;
+    u64     inflatedSize = 0u;
+    u32     checksum     = 1u;
+
+    const auto start = [&](bool wait) {
+      // Up, Average and Paeth read the row above.
+      if(idx > 0u && pending[0] >= 2u) {
+        std::unique_lock lock(mutex);
+        if(!wait && states[idx - 1u] == 0u) return;
+
+        segmentDone.wait(lock, [&] { return states[idx - 1u] != 0u; });
+        if(states[idx - 1u] != 1u)
+          throw std::runtime_error("PNG: previous segment failed");
+
+        decoder.SetPreviousRow(lastRows[idx - 1u]);
+      }
+
+      started = true;
+      decoder.Write(pending);
+      pending = {};
+    };
+
+    BitIStream inBits(segment.data);
+    if(idx == 0u) ZLibReadHeader(inBits);
+
+    Inflate(
+      inBits,
+      [&](Span<u8 const> bytes) {
+        inflatedSize += bytes.size();
+        if(verifyChecksum) checksum = adler32(bytes, checksum);
+        if(started) {
+          decoder.Write(bytes);
+        } else {
+          pending.insert(pending.end(), bytes.begin(), bytes.end());
+          start(false);
         }
-        break;
-      default:
-        throw std::runtime_error("PNG: bad scanline filter");
+      },
+      true);
+
+    if(inflatedSize != segment.rowCount * (scanlineSize + 1u))
+      throw std::runtime_error("PNG: bad segment size");
+
+    // Only the last segment has the final block and the checksum.
+    if(verifyChecksum && idx + 1u == segments.size())
+      expectedChecksum = ZLibReadChecksum(inBits);
+
+    if(!started) start(true);
+    decoder.Finish();
+
+    auto lastRow = decoder.GetLastRow();
+
+    std::lock_guard lock(mutex);
+    lastRows[idx].assign(lastRow.begin(), lastRow.end());
+    checksums[idx]     = checksum;
+    inflatedSizes[idx] = inflatedSize;
+    states[idx]        = 1u;
+    segmentDone.notify_all();
+  };
+
+  // Segments are picked in order, so the one a segment waits for is
+  // always being decoded already. A failed segment releases the one
+  // waiting for it.
+  runJobs(segments.size(), threadCount, [&](u64 idx) {
+    try {
+      decodeSegment(idx);
+    } catch(...) {
+      std::lock_guard lock(mutex);
+      states[idx] = 2u;
+      segmentDone.notify_all();
+      throw;
     }
-    previousScanline = {&outData[scanlineStart], scanlineSize};
-  }
-  return outData.data();
+  });
+
+  if(!verifyChecksum) return true;
+
+  u32 checksum = checksums[0];
+  for(u64 idx = 1u; idx < segments.size(); ++idx)
+    checksum =
+      adler32Combine(checksum, checksums[idx], inflatedSizes[idx]);
+
+  return checksum == expectedChecksum;
 }
 
 bool DataReader::isPng(std::istream& src)
@@ -373,8 +684,9 @@ bool DataReader::isPng(std::istream& src)
          0u;
 }
 
-data::Image
-DataReader::readPng(std::istream& src, const ImageOptions& options)
+data::Image DataReader::readPng(
+  std::istream& src, const ImageOptions& options,
+  const ImageTargetQuery& query)
 {
   if(!isPng(src)) throw std::runtime_error("PNG: bad signature");
   src.seekg(sizeof(PngSignature));
@@ -392,23 +704,42 @@ DataReader::readPng(std::istream& src, const ImageOptions& options)
   u8 interlace   = 0u;
 
   u32 bitsPerChannel = 0u;
-  u32 channelCount   = 0u;
 
-  Arr<u8> compressedImageBytes;
-  compressedImageBytes.reserve(bytes.size());
+  const PngPixelLayout* layout = nullptr;
 
-  Arr<u8> palette;
+  // The image data is inflated straight from the file bytes.
+  Arr<Span<u8 const>> imageData;
+  Arr<u64>            imageDataOffsets;
+
+  // Split points for parallel decoding, from the iDOT chunk.
+  Arr<u32> segmentRows;
+  Arr<u64> segmentOffsets;
+
+  // Palette entries are expanded to RGBA.
+  SArr<u8, 1024> palette    = {};
+  bool           hasPalette = false;
+
+  // Transparent sample values of grayscale and color images.
+  Opt<SArr<u16, 3>> colorKey;
+
+  Opt<ImageTarget> target;
 
   for(;;) {
     bool hasMoreChunks = true;
 
-    auto dataSize  = stream.ReadSwap<u32>();
+    auto chunkOffset = stream.GetOffset();
+    auto dataSize    = stream.ReadSwap<u32>();
     auto chunkType = stream.ReadSwap<u32>();
 
+    if(toU64(dataSize) + 4u > stream.GetSizeLeft())
+      throw std::runtime_error("PNG: bad chunk size");
+
     switch(chunkType) {
       case fourCC("IHDR"): {
         out.size[0] = stream.ReadSwap<u32>();
         out.size[1] = stream.ReadSwap<u32>();
+        if(out.size[0] == 0u || out.size[1] == 0u)
+          throw std::runtime_error("PNG: bad image size");
 
         bitsPerChannel = stream.Read<u8>();
 
@@ -421,64 +752,90 @@ DataReader::readPng(std::istream& src, const ImageOptions& options)
           throw std::runtime_error("PNG: unsopported compression");
         if(filter != 0)
           throw std::runtime_error("PNG: unsopported filter");
-        if(interlace != 0)
+        if(interlace > 1)
           throw std::runtime_error("PNG: unsopported interlace");
 
-        switch(colorType) {
-          case 0u: // Grayscale
-            channelCount = 1u;
-            out.format   = (bitsPerChannel <= 8u) ? Format::R8_UNORM
-                                                  : Format::R16_UNORM;
-            break;
-          case 2u: // Color
-            channelCount = 3u;
-            out.format   = (bitsPerChannel == 8u)
-                             ? Format::R8G8B8A8_UNORM
-                             : Format::R16G16B16A16_UNORM;
-            break;
-          case 3u: // Indexed color
-            channelCount = 1u;
-            out.format   = Format::R8G8B8A8_UNORM;
-            break;
-          case 4u: // Grayscale with alpha
-            // channelCount = 2u;
-            throw std::runtime_error(
-              "PNG: grayscale with alpha not supported");
-          case 6u: // Color with alpha
-            channelCount = 4u;
-            out.format   = (bitsPerChannel == 8u)
-                             ? Format::R8G8B8A8_UNORM
-                             : Format::R16G16B16A16_UNORM;
-            break;
-        }
+        if(colorType == 1u || colorType == 5u || colorType > 6u)
+          throw std::runtime_error("PNG: bad color type");
+
+        static const PngConverterTable converters;
+        layout = converters.Get(colorType, bitsPerChannel);
+        if(!layout) throw std::runtime_error("PNG: bad bit depth");
+
+        out.format = layout->format;
       } break;
 
       case fourCC("IDAT"): {
-        auto chunkData = stream.ReadBytes(dataSize);
-        compressedImageBytes.insert(
-          compressedImageBytes.end(), chunkData.begin(),
-          chunkData.end());
+        // Everything that affects the output format comes before the
+        // image data.
+        if(!target) {
+          if(!layout) throw std::runtime_error("PNG: missing header");
+          if(colorType == 3u && !hasPalette)
+            throw std::runtime_error("PNG: missing palette");
+
+          target = query(out);
+          if(target->texels.empty()) return out;
+        }
+
+        imageData.push_back(stream.ReadBytes(dataSize));
+        imageDataOffsets.push_back(chunkOffset);
       } break;
 
       case fourCC("PLTE"): {
-        palette.reserve(dataSize / 3u);
+        if(dataSize % 3u != 0u || dataSize > 3u * 256u)
+          throw std::runtime_error("PNG: bad palette size");
+
         for(u32 idx = 0u; idx < dataSize / 3u; ++idx) {
-          palette.push_back(stream.Read<u8>());
-          palette.push_back(stream.Read<u8>());
-          palette.push_back(stream.Read<u8>());
-          palette.push_back(255);
+          palette[idx * 4u + 0u] = stream.Read<u8>();
+          palette[idx * 4u + 1u] = stream.Read<u8>();
+          palette[idx * 4u + 2u] = stream.Read<u8>();
+          palette[idx * 4u + 3u] = options.alphaPadding;
         }
+        hasPalette = true;
       } break;
 
       case fourCC("tRNS"): {
-        if(colorType != 3u)
-          throw std::runtime_error(
-            "PNG: transparency chunk supported only for indexed color "
-            "images");
-
-        out.format = Format::R8G8B8A8_UNORM;
-        for(u64 idx = 0u; idx < dataSize; ++idx)
-          palette[idx * 4u + 3u] = stream.Read<u8>();
+        if(!layout) throw std::runtime_error("PNG: missing header");
+
+        if(colorType == 3u) {
+          if(dataSize > 256u)
+            throw std::runtime_error("PNG: bad transparency size");
+
+          out.format = Format::R8G8B8A8_UNORM;
+          for(u64 idx = 0u; idx < dataSize; ++idx)
+            palette[idx * 4u + 3u] = stream.Read<u8>();
+        } else if(layout->convertKeyed) {
+          if(dataSize != 2u * layout->channelCount)
+            throw std::runtime_error("PNG: bad transparency size");
+
+          // Only the bits of the sample depth are used.
+          const u32 mask = (1u << bitsPerChannel) - 1u;
+          colorKey.emplace();
+          for(u32 idx = 0u; idx < layout->channelCount; ++idx)
+            (*colorKey)[idx] = toU16(stream.ReadSwap<u16>() & mask);
+          out.format = layout->keyedFormat;
+        } else {
+          // Not allowed with an alpha channel, which is used instead.
+          stream.SkipBytes(dataSize);
+        }
+      } break;
+
+      case fourCC("iDOT"): {
+        // Apple layout: segment count, three unused values, the height
+        // of each segment and the offset from this chunk to the IDAT
+        // chunk each segment after the first starts at.
+        u64 count = dataSize >= 4u ? stream.PeekSwap<u32>() : 0u;
+        if(count == 0u || dataSize != 8u * count + 12u) {
+          stream.SkipBytes(dataSize);
+          break;
+        }
+
+        stream.SkipBytes(16u);
+        segmentRows.resize(count);
+        for(auto& rows: segmentRows) rows = stream.ReadSwap<u32>();
+        segmentOffsets.resize(count - 1u);
+        for(auto& offset: segmentOffsets)
+          offset = chunkOffset + stream.ReadSwap<u32>();
       } break;
 
       case fourCC("IEND"):
@@ -490,8 +847,15 @@ DataReader::readPng(std::istream& src, const ImageOptions& options)
         break;
     }
 
-    // Skip CRC
-    [[maybe_unused]] u32 crc = stream.ReadSwap<u32>();
+    // The CRC covers the chunk type and data.
+    u32 crc = stream.ReadSwap<u32>();
+    if(options.verifyChecksums) {
+      const u8* typeData = bytes.data() + chunkOffset + 4u;
+      if(crc32({typeData, toU64(dataSize) + 4u}) != crc)
+        throw makeError<std::runtime_error>(
+          "PNG: bad CRC in %.4s chunk",
+          reinterpret_cast<const char*>(typeData));
+    }
 
     if(!hasMoreChunks) break;
 
@@ -499,80 +863,68 @@ DataReader::readPng(std::istream& src, const ImageOptions& options)
       throw std::runtime_error("PNG: missing end chunk");
   }
 
-  u64 pixelCount =
-    static_cast<u64>(out.size[0]) * static_cast<u64>(out.size[1]);
-  u64 bitsPerPixel = (channelCount * bitsPerChannel) / 8u;
-  u64 sizeHint     = pixelCount * bitsPerPixel +
-                 out.size[1]; // Extra byte for each scanline's filter.
-
-  auto expandedData = ZLibDeflate(compressedImageBytes, sizeHint);
-  auto imageData    = PngReconstruct(
-    expandedData, out.size, channelCount, bitsPerChannel);
-
-  // Apply palette if present.
-  if(!palette.empty()) {
-    // Update channel count from 1 (indexed) to the final one.
-    channelCount   = 3u;
-    bitsPerChannel = 8u;
-
-    Arr<u8> buffer;
-    buffer.reserve(imageData.size() * channelCount);
-
-    if(channelCount == 3u) {
-      for(u64 idx: imageData) {
-        buffer.push_back(palette[idx * 4u + 0u]);
-        buffer.push_back(palette[idx * 4u + 1u]);
-        buffer.push_back(palette[idx * 4u + 2u]);
+  if(!target) throw std::runtime_error("PNG: missing image data");
+
+  u64 bytesPerTexel = getFormatSize(out.format);
+  u64 packedPitch   = out.size[0] * bytesPerTexel;
+  u64 rowPitch      = target->rowPitch ? target->rowPitch : packedPitch;
+
+  u64 targetSize = rowPitch * (out.size[1] - 1u) + packedPitch;
+  if(rowPitch < packedPitch || target->texels.size() < targetSize)
+    throw std::runtime_error("PNG: target memory is too small");
+
+  const PixelConverter rgb{
+    PixelFormat::R8G8B8_UNORM, PixelFormat::R8G8B8A8_UNORM,
+    options.alphaPadding / 255.0f};
+
+  const PngScanlineDecoder::Desc desc{
+    .size          = out.size,
+    .bitsPerPixel  = layout->channelCount * bitsPerChannel,
+    .interlaced    = interlace == 1u,
+    .dst           = target->texels.data(),
+    .rowPitch      = rowPitch,
+    .bytesPerTexel = toU32(bytesPerTexel),
+    .convert       = colorKey ? layout->convertKeyed : layout->convert,
+    .params        = {
+      palette.data(), options.alphaPadding, &rgb,
+      colorKey.value_or(SArr<u16, 3>{})}};
+
+  u32 threadCount = options.threadCount;
+  if(threadCount == 0u)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  if(threadCount > 1u && interlace == 0u && !segmentRows.empty()) {
+    auto segments = GetPngSegments(
+      out.size[1], imageData, imageDataOffsets, segmentRows,
+      segmentOffsets);
+
+    if(segments.size() > 1u) {
+      bool decoded       = false;
+      bool checksumMatch = false;
+      try {
+        checksumMatch = PngDecodeSegments(
+          segments, threadCount, desc, options.verifyChecksums);
+        decoded = true;
+      } catch(const std::exception& e) {
+        // The split points can't be trusted, decode everything again.
+        VDLogW("PNG: parallel decoding failed: %s", e.what());
       }
-    } else {
-      for(u64 idx: imageData) {
-        buffer.push_back(palette[idx * 4u + 0u]);
-        buffer.push_back(palette[idx * 4u + 1u]);
-        buffer.push_back(palette[idx * 4u + 2u]);
-        buffer.push_back(palette[idx * 4u + 3u]);
-      }
-    }
 
-    imageData = std::move(buffer);
-  }
-
-  if(channelCount == 3u) {
-    u64 bytesPerChannel  = bitsPerChannel / 8u;
-    u64 oldBytesPerPixel = 3u * bytesPerChannel;
-
-    channelCount = 4u;
-    u64 newSize  = pixelCount * channelCount * bitsPerChannel / 8u;
-
-    Arr<u8> buffer;
-    buffer.reserve(newSize);
-
-    for(u64 idx = 0u; idx < imageData.size(); idx += oldBytesPerPixel) {
-      for(u64 byteIdx = 0u; byteIdx < oldBytesPerPixel; ++byteIdx)
-        buffer.push_back(imageData[idx + byteIdx]);
-      for(u64 padIdx = 0u; padIdx < bytesPerChannel; ++padIdx)
-        buffer.push_back(options.alphaPadding);
+      if(decoded) {
+        if(!checksumMatch)
+          throw std::runtime_error("Deflate: bad Adler-32 checksum");
+        return out;
+      }
     }
-
-    imageData = std::move(buffer);
   }
 
-  // If there are less than 8 bits per channel (grayscale), scale them
-  // up to 8.
-  if(bitsPerChannel < 8u) {
-    Arr<u8> buffer;
-    buffer.reserve(pixelCount * channelCount);
-
-    u32 scaling = 8u - bitsPerChannel;
+  PngScanlineDecoder decoder(desc);
 
-    BitIStream s(imageData);
-    while(s.HasMoreData())
-      buffer.push_back(
-        static_cast<u8>(s.Read(bitsPerChannel) << scaling));
-
-    imageData = std::move(buffer);
-    // bitsPerChannel = 8u;
-  }
+  ZLibInflate(
+    imageData,
+    [&decoder](Span<u8 const> bytes) { decoder.Write(bytes); },
+    options.verifyChecksums);
+  decoder.Finish();
 
-  out.texels = std::move(imageData);
   return out;
 }
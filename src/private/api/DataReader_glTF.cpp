@@ -40,401 +40,1349 @@ data::Model DataReader::readBinaryGLTF(
   return model;
 }
 
-static Arr<data::Buffer> readBuffers(
-  const Json::Array& src, DataReader::UriFilter& uriFilter,
-  DataReader::FileReader&         fileReader,
-  const DataReader::ModelOptions& options)
+// Members of the glTF objects that are read, the others are skipped.
+enum class GltfKey : u8 {
+  Unknown,
+  Buffers,
+  BufferViews,
+  Accessors,
+  Meshes,
+  Samplers,
+  Textures,
+  Materials,
+  Images,
+  ByteLength,
+  Uri,
+  Buffer,
+  ByteOffset,
+  ByteStride,
+  Target,
+  BufferView,
+  Count,
+  Offset,
+  Min,
+  Max,
+  ComponentType,
+  Type,
+  Name,
+  Primitives,
+  Indices,
+  Material,
+  Attributes,
+  MagFilter,
+  MinFilter,
+  WrapS,
+  WrapT,
+  Source,
+  Sampler,
+  Extensions,
+  TextureBasisu,
+  TextureDds,
+  PbrMetallicRoughness,
+  BaseColorFactor,
+  BaseColorTexture,
+  MetallicFactor,
+  RoughnessFactor,
+  MetallicRoughnessTexture,
+  PbrSpecularGlossiness,
+  DiffuseFactor,
+  DiffuseTexture,
+  SpecularFactor,
+  GlossinessFactor,
+  SpecularGlossinessTexture,
+  NormalTexture,
+  OcclusionTexture,
+  EmissiveTexture,
+  EmissiveFactor,
+  AlphaMode,
+  DoubleSided,
+  Index,
+  Scale,
+  Strength,
+  TexCoord
+};
+
+// Same order as GltfKey.
+static constexpr Strv GltfKeyNames[] = {
+  "",
+  "buffers",
+  "bufferViews",
+  "accessors",
+  "meshes",
+  "samplers",
+  "textures",
+  "materials",
+  "images",
+  "byteLength",
+  "uri",
+  "buffer",
+  "byteOffset",
+  "byteStride",
+  "target",
+  "bufferView",
+  "count",
+  "offset",
+  "min",
+  "max",
+  "componentType",
+  "type",
+  "name",
+  "primitives",
+  "indices",
+  "material",
+  "attributes",
+  "magFilter",
+  "minFilter",
+  "wrapS",
+  "wrapT",
+  "source",
+  "sampler",
+  "extensions",
+  "KHR_texture_basisu",
+  "MSFT_texture_dds",
+  "pbrMetallicRoughness",
+  "baseColorFactor",
+  "baseColorTexture",
+  "metallicFactor",
+  "roughnessFactor",
+  "metallicRoughnessTexture",
+  "KHR_materials_pbrSpecularGlossiness",
+  "diffuseFactor",
+  "diffuseTexture",
+  "specularFactor",
+  "glossinessFactor",
+  "specularGlossinessTexture",
+  "normalTexture",
+  "occlusionTexture",
+  "emissiveTexture",
+  "emissiveFactor",
+  "alphaMode",
+  "doubleSided",
+  "index",
+  "scale",
+  "strength",
+  "texCoord"};
+
+static_assert(
+  std::size(GltfKeyNames) == static_cast<u64>(GltfKey::TexCoord) + 1u);
+
+// Multiplicative hash of the length and four of the characters. The
+// multiplier was searched offline so that every key gets its own slot
+// of the table, which makes the lookup a single compare.
+static constexpr u64 hashGltfKey(Strv key)
 {
-  Arr<data::Buffer> ret;
+  if(key.size() < 2u) return 0u;
 
-  for(const auto& info: src) {
-    auto& buffer = ret.emplace_back();
+  const u64 bits = key.size() | u64(u8(key[0])) << 8 |
+                   u64(u8(key[1])) << 16 |
+                   u64(u8(key[key.size() / 2u])) << 24 |
+                   u64(u8(key.back())) << 32;
+  return (bits * 0x86e203d800608015ull) >> 56;
+}
 
-    auto size = info["byteLength"].AsNumber<u64>();
-    if(info["uri"].IsString()) {
-      auto uri   = info["uri"].AsString();
-      buffer.uri = uri;
+static constexpr auto GltfKeyTable = [] {
+  SArr<GltfKey, 256> ret = {};
+  for(u64 idx = 1u; idx < std::size(GltfKeyNames); ++idx)
+    ret[hashGltfKey(GltfKeyNames[idx])] = static_cast<GltfKey>(idx);
+  return ret;
+}();
+
+static_assert(
+  [] {
+    for(u64 idx = 1u; idx < std::size(GltfKeyNames); ++idx)
+      if(
+        GltfKeyTable[hashGltfKey(GltfKeyNames[idx])] !=
+        static_cast<GltfKey>(idx))
+        return false;
+    return true;
+  }(),
+  "glTF: the key hash has collisions");
+
+static GltfKey findGltfKey(Strv key)
+{
+  const GltfKey ret = GltfKeyTable[hashGltfKey(key)];
+  return GltfKeyNames[static_cast<u64>(ret)] == key ? ret
+                                                    : GltfKey::Unknown;
+}
 
-      if(uriFilter && !uriFilter(uri)) {
-        ret.emplace_back();
-        continue;
-      }
+// Members as they are read, checked and converted once their object
+// ends. Later duplicates replace the earlier ones, values of the wrong
+// type count as missing and numbers that don't fit throw.
+struct GltfBufferInfo {
+  Opt<u64> byteLength;
+  Opt<Str> uri;
+};
+
+struct GltfBufferViewInfo {
+  Opt<u32> buffer;
+  Opt<u32> byteLength;
+  Opt<u32> byteOffset;
+  Opt<u32> byteStride;
+  Opt<u32> target;
+};
+
+struct GltfAccessorInfo {
+  Opt<u32>    bufferView;
+  Opt<u32>    count;
+  Opt<u32>    offset;
+  Opt<u32>    componentType;
+  Opt<Str>    type;
+  Opt<Float4> min;
+  Opt<Float4> max;
+};
+
+struct GltfPrimitiveInfo {
+  Opt<u32>                                 indices;
+  Opt<u32>                                 material;
+  Opt<Arr<data::MeshPrimitive::Attribute>> attributes;
+};
+
+struct GltfMeshInfo {
+  Opt<Str>                    name;
+  Opt<Arr<GltfPrimitiveInfo>> primitives;
+};
+
+struct GltfSamplerInfo {
+  Opt<Str> name;
+  Opt<u32> magFilter;
+  Opt<u32> minFilter;
+  Opt<u32> wrapS;
+  Opt<u32> wrapT;
+};
+
+struct GltfTextureInfo {
+  Opt<Str> name;
+  Opt<u32> source;
+  Opt<u32> sampler;
+  Opt<u32> basisuSource;
+  Opt<u32> ddsSource;
+};
+
+struct GltfTextureRefInfo {
+  Opt<u32> index;
+  Opt<u32> texCoord;
+  Opt<f32> scale;
+  Opt<f32> strength;
+};
+
+struct GltfMaterialInfo {
+  struct MetallicRoughness {
+    Opt<Float4>             baseColorFactor;
+    Opt<GltfTextureRefInfo> baseColorTexture;
+    Opt<f32>                metallicFactor;
+    Opt<f32>                roughnessFactor;
+    Opt<GltfTextureRefInfo> metallicRoughnessTexture;
+  };
+
+  struct SpecularGlossiness {
+    Opt<Float4>             diffuseFactor;
+    Opt<GltfTextureRefInfo> diffuseTexture;
+    Opt<Float3>             specularFactor;
+    Opt<f32>                glossinessFactor;
+    Opt<GltfTextureRefInfo> specularGlossinessTexture;
+  };
+
+  Opt<Str>                name;
+  Opt<MetallicRoughness>  metallicRoughness;
+  Opt<SpecularGlossiness> specularGlossiness;
+  Opt<GltfTextureRefInfo> normalTexture;
+  Opt<GltfTextureRefInfo> occlusionTexture;
+  Opt<GltfTextureRefInfo> emissiveTexture;
+  Opt<Float3>             emissiveFactor;
+  Opt<Str>                alphaMode;
+  Opt<bool>               doubleSided;
+};
+
+struct GltfImageInfo {
+  Opt<Str> uri;
+};
+
+template<typename T>
+static const T& require(const Opt<T>& value, const char* name)
+{
+  if(!value)
+    throw makeError<std::runtime_error>("glTF: missing %s", name);
+  return *value;
+}
 
-      if(IsDataURI(uri)) {
-        buffer.data = DecodeDataURI(uri);
-        if(size != buffer.data.size())
-          throw makeError<std::runtime_error>(
-            "glTF: Invalid length for embedded buffer");
-      } else {
-        if(!fileReader)
-          throw makeError<std::runtime_error>(
-            "glTF: FileReader must be set if the asset has external "
-            "URIs");
+static data::BufferView makeBufferView(const GltfBufferViewInfo& info)
+{
+  data::BufferView ret;
+  ret.bufferIndex = require(info.buffer, "bufferView.buffer");
+  ret.length      = require(info.byteLength, "bufferView.byteLength");
+  ret.offset      = info.byteOffset.value_or(0u);
+  ret.stride      = info.byteStride.value_or(0u);
+  ret.target      = info.target;
+  return ret;
+}
 
-        buffer.data = fileReader(
-          uri, options.basePath ? &*options.basePath : nullptr);
-        if(size != buffer.data.size())
-          throw makeError<std::runtime_error>(
-            "glTF: Invalid length for buffer %s", Str(uri).c_str());
-      }
-    } else {
-      // TODO
-      throw makeError<std::runtime_error>(
-        "glTF: Binary format not implemented yet.");
-    }
+static data::Accessor makeAccessor(const GltfAccessorInfo& info)
+{
+  data::Accessor ret;
+
+  ret.bufferViewIndex = require(info.bufferView, "accessor.bufferView");
+  ret.count           = require(info.count, "accessor.count");
+  ret.offset          = info.offset.value_or(0u);
+
+  ret.min = info.min;
+  ret.max = info.max;
+
+  switch(require(info.componentType, "accessor.componentType")) {
+    case 5120u:
+      ret.componentType = data::ComponentType::Byte;
+      break;
+    case 5121u:
+      ret.componentType = data::ComponentType::UnsignedByte;
+      break;
+    case 5122u:
+      ret.componentType = data::ComponentType::Short;
+      break;
+    case 5123u:
+      ret.componentType = data::ComponentType::UnsignedShort;
+      break;
+    case 5125u:
+      ret.componentType = data::ComponentType::UnsignedInt;
+      break;
+    case 5126u:
+      ret.componentType = data::ComponentType::Float;
+      break;
+    default:
+      throw std::runtime_error(
+        "glTF: invalid accessor component type.");
+  }
+
+  const auto& type = require(info.type, "accessor.type");
+  if(type == "SCALAR") {
+    ret.type = data::AccessorType::Scalar;
+  } else if(type == "VEC2") {
+    ret.type = data::AccessorType::Vector2;
+  } else if(type == "VEC3") {
+    ret.type = data::AccessorType::Vector3;
+  } else if(type == "VEC4") {
+    ret.type = data::AccessorType::Vector4;
+  } else if(type == "MAT2") {
+    ret.type = data::AccessorType::Matrix22;
+  } else if(type == "MAT3") {
+    ret.type = data::AccessorType::Matrix33;
+  } else if(type == "MAT4") {
+    ret.type = data::AccessorType::Matrix44;
+  } else {
+    throw std::runtime_error("glTF: invalid accessor type.");
   }
 
   return ret;
 }
 
-static Arr<data::BufferView> readBufferViews(const Json::Array& src)
+static data::MeshPrimitive::Attribute
+makeAttribute(Strv key, u32 accessorIndex)
 {
-  Arr<data::BufferView> ret;
+  data::MeshPrimitive::Attribute ret = {};
+
+  ret.accessorIndex = accessorIndex;
+
+  if(key == "POSITION") ret.type = VertexAttribute::Position;
+  else if(key == "NORMAL")
+    ret.type = VertexAttribute::Normal;
+  else if(key == "TANGENT")
+    ret.type = VertexAttribute::Tangent;
+  else if(key.starts_with("TEXCOORD_")) {
+    ret.type = VertexAttribute::TexCoord;
+    std::from_chars(
+      key.data() + strlen("TEXCOORD_"), key.data() + key.size(),
+      ret.typeIndex);
+  } else if(key.starts_with("COLOR_")) {
+    ret.type = VertexAttribute::Color;
+    std::from_chars(
+      key.data() + strlen("COLOR_"), key.data() + key.size(),
+      ret.typeIndex);
+  } else if(key.starts_with("JOINTS")) {
+    // TODO
+  } else if(key.starts_with("WEIGHTS")) {
+    // TODO
+  }
 
-  for(const auto& info: src) {
-    auto& view       = ret.emplace_back();
-    view.bufferIndex = info["buffer"].AsNumber<u32>();
-    view.length      = info["byteLength"].AsNumber<u32>();
-    view.offset      = info["byteOffset"].AsNumberOpt<u32>(0u);
-    view.stride      = info["byteStride"].AsNumberOpt<u32>(0u);
-    view.target      = info["target"].AsNumberOpt<u32>();
+  return ret;
+}
+
+static data::Mesh makeMesh(const GltfMeshInfo& info)
+{
+  data::Mesh ret;
+  ret.name = info.name;
+
+  const auto& primitives = require(info.primitives, "mesh.primitives");
+  for(const auto& primInfo: primitives) {
+    auto& prim                = ret.primitives.emplace_back();
+    prim.indicesAccessorIndex = primInfo.indices;
+    prim.material             = primInfo.material;
+    prim.attributes =
+      require(primInfo.attributes, "primitive.attributes");
   }
 
   return ret;
 }
 
-static Arr<data::Mesh> readMeshes(const Json::Array& src)
+static data::Sampler makeSampler(const GltfSamplerInfo& info)
 {
-  Arr<data::Mesh> ret;
-
-  for(const auto& meshInfo: src) {
-    auto& mesh = ret.emplace_back();
-
-    mesh.name = meshInfo["name"].AsStringOpt();
-
-    for(const auto& primInfo: meshInfo["primitives"].AsArray()) {
-      auto& prim = mesh.primitives.emplace_back();
-
-      prim.indicesAccessorIndex =
-        primInfo["indices"].AsNumberOpt<u32>();
-      prim.material = primInfo["material"].AsNumberOpt<u32>();
-
-      for(const auto& attrInfo: primInfo["attributes"].AsObject()) {
-        auto& attr         = prim.attributes.emplace_back();
-        attr.accessorIndex = attrInfo.second.AsNumber<u32>();
-
-        if(attrInfo.first == "POSITION")
-          attr.type = VertexAttribute::Position;
-        else if(attrInfo.first == "NORMAL")
-          attr.type = VertexAttribute::Normal;
-        else if(attrInfo.first == "TANGENT")
-          attr.type = VertexAttribute::Tangent;
-        else if(attrInfo.first.starts_with("TEXCOORD_")) {
-          attr.type = VertexAttribute::TexCoord;
-          std::from_chars(
-            attrInfo.first.data() + strlen("TEXCOORD_"),
-            attrInfo.first.data() + attrInfo.first.size(),
-            attr.typeIndex);
-        } else if(attrInfo.first.starts_with("COLOR_")) {
-          attr.type = VertexAttribute::Color;
-          std::from_chars(
-            attrInfo.first.data() + strlen("COLOR_"),
-            attrInfo.first.data() + attrInfo.first.size(),
-            attr.typeIndex);
-        } else if(attrInfo.first.starts_with("JOINTS")) {
-          // TODO
-        } else if(attrInfo.first.starts_with("WEIGHTS")) {
-          // TODO
-        }
-      }
-    }
+  data::Sampler ret;
+
+  ret.name = info.name;
+
+  switch(info.magFilter.value_or(0u)) {
+    case 9728u:
+      ret.magFilter = SamplerFilter::Nearest;
+      break;
+    case 9729u:
+      ret.magFilter = SamplerFilter::Linear;
+      break;
+    default:
+      ret.magFilter = SamplerFilter::Nearest;
+      break;
+  }
+
+  switch(info.minFilter.value_or(0u)) {
+    case 9728u:
+      ret.magFilter  = SamplerFilter::Nearest;
+      ret.mipFilter  = SamplerFilter::Nearest;
+      ret.useMipmaps = false;
+      break;
+    case 9729u:
+      ret.magFilter  = SamplerFilter::Linear;
+      ret.mipFilter  = SamplerFilter::Nearest;
+      ret.useMipmaps = false;
+      break;
+    case 9984u:
+      ret.magFilter  = SamplerFilter::Nearest;
+      ret.mipFilter  = SamplerFilter::Nearest;
+      ret.useMipmaps = true;
+      break;
+    case 9985u:
+      ret.magFilter  = SamplerFilter::Linear;
+      ret.mipFilter  = SamplerFilter::Nearest;
+      ret.useMipmaps = true;
+      break;
+    case 9986u:
+      ret.magFilter  = SamplerFilter::Nearest;
+      ret.mipFilter  = SamplerFilter::Linear;
+      ret.useMipmaps = true;
+      break;
+    case 9987u:
+      ret.magFilter  = SamplerFilter::Linear;
+      ret.mipFilter  = SamplerFilter::Linear;
+      ret.useMipmaps = true;
+      break;
+    default:
+      ret.magFilter  = SamplerFilter::Nearest;
+      ret.mipFilter  = SamplerFilter::Nearest;
+      ret.useMipmaps = false;
+      break;
+  }
+
+  switch(info.wrapS.value_or(0u)) {
+    case 33071u:
+      ret.wrapU = SamplerAddressMode::Clamp;
+      break;
+    case 33648u:
+      ret.wrapU = SamplerAddressMode::Mirror;
+      break;
+    case 10497:
+      ret.wrapU = SamplerAddressMode::Repeat;
+      break;
+    default:
+      ret.wrapU = SamplerAddressMode::Repeat;
+      break;
+  }
+
+  switch(info.wrapT.value_or(0u)) {
+    case 33071u:
+      ret.wrapV = SamplerAddressMode::Clamp;
+      break;
+    case 33648u:
+      ret.wrapV = SamplerAddressMode::Mirror;
+      break;
+    case 10497:
+      ret.wrapV = SamplerAddressMode::Repeat;
+      break;
+    default:
+      ret.wrapV = SamplerAddressMode::Repeat;
+      break;
   }
 
   return ret;
 }
 
-static Arr<data::Accessor> readAccessors(const Json::Array& src)
+static data::Texture makeTexture(const GltfTextureInfo& info)
 {
-  Arr<data::Accessor> ret;
+  data::Texture ret;
 
-  for(const auto& info: src) {
-    auto& acc = ret.emplace_back();
+  ret.name         = info.name;
+  ret.imageIndex   = info.source;
+  ret.samplerIndex = info.sampler;
 
-    acc.bufferViewIndex = info["bufferView"].AsNumber<u32>();
-    acc.count           = info["count"].AsNumber<u32>();
-    acc.offset          = info["offset"].AsNumberOpt<u32>(0u);
+  // Precompressed images take the place of the fallback source, the
+  // readers detect KTX2 and DDS files from their contents.
+  if(info.basisuSource) ret.imageIndex = info.basisuSource;
+  else if(info.ddsSource)
+    ret.imageIndex = info.ddsSource;
 
-    acc.max = info["max"].AsVectorOpt<Float4>();
-    acc.min = info["max"].AsVectorOpt<Float4>();
+  return ret;
+}
 
-    const auto& componentType = info["componentType"].AsNumber<u32>();
-    switch(componentType) {
-      case 5120u:
-        acc.componentType = data::ComponentType::Byte;
-        break;
-      case 5121u:
-        acc.componentType = data::ComponentType::UnsignedByte;
-        break;
-      case 5122u:
-        acc.componentType = data::ComponentType::Short;
-        break;
-      case 5123u:
-        acc.componentType = data::ComponentType::UnsignedShort;
-        break;
-      case 5125u:
-        acc.componentType = data::ComponentType::UnsignedInt;
-        break;
-      case 5126u:
-        acc.componentType = data::ComponentType::Float;
-        break;
-      default:
-        throw std::runtime_error(
-          "glTF: invalid accessor component type.");
-    }
+static Opt<data::TextureRef>
+makeTextureRef(const Opt<GltfTextureRefInfo>& info)
+{
+  if(!info) return std::nullopt;
 
-    const auto& type = info["type"].AsString();
-    if(type == "SCALAR") {
-      acc.type = data::AccessorType::Scalar;
-    } else if(type == "VEC2") {
-      acc.type = data::AccessorType::Vector2;
-    } else if(type == "VEC3") {
-      acc.type = data::AccessorType::Vector3;
-    } else if(type == "VEC4") {
-      acc.type = data::AccessorType::Vector4;
-    } else if(type == "MAT2") {
-      acc.type = data::AccessorType::Matrix22;
-    } else if(type == "MAT3") {
-      acc.type = data::AccessorType::Matrix33;
-    } else if(type == "MAT4") {
-      acc.type = data::AccessorType::Matrix44;
-    } else {
-      throw std::runtime_error("glTF: invalid accessor type.");
-    }
-  }
+  data::TextureRef ret;
+  ret.textureIndex = require(info->index, "textureInfo.index");
+
+  if(info->scale) ret.scale = info->scale;
+  else if(info->strength)
+    ret.scale = info->strength;
+
+  ret.texCoord = info->texCoord.value_or(0u);
 
   return ret;
 }
 
-static Arr<data::Image> readImages(
-  const Json::Array& src, DataReader& reader,
-  DataReader::UriFilter&          uriFilter,
-  const DataReader::ModelOptions& options)
+static data::Material makeMaterial(const GltfMaterialInfo& info)
 {
-  Arr<data::Image> ret;
+  data::Material ret;
 
-  for(const auto& info: src) {
-    if(info["uri"].IsString()) {
-      auto uri = info["uri"].AsString();
+  ret.name = info.name;
 
-      if(IsDataURI(uri)) {
-        auto data = DecodeDataURI(uri);
-        ret.emplace_back(reader.ReadImage(data, {}));
-      } else {
-        fs::path path;
-        if(options.basePath) path = *options.basePath / uri;
-        else
-          path = uri;
+  if(const auto& pbrInfo = info.metallicRoughness) {
+    data::PbrMetallicRoughness param;
+    param.baseColorFactor =
+      pbrInfo->baseColorFactor.value_or(Float4{1, 1, 1, 1});
+    param.baseColorTexture = makeTextureRef(pbrInfo->baseColorTexture);
+    param.metallicFactor   = pbrInfo->metallicFactor.value_or(1.0f);
+    param.roughnessFactor  = pbrInfo->roughnessFactor.value_or(1.0f);
+    param.metallicRoughnessTexture =
+      makeTextureRef(pbrInfo->metallicRoughnessTexture);
 
-        auto pathStr = pathToStr(path);
+    ret.model = param;
+  }
 
-        if(uriFilter && !uriFilter(pathStr)) ret.emplace_back();
-        else
-          ret.emplace_back(reader.ReadImage(path, {}));
-      }
-    }
+  if(const auto& pbrInfo = info.specularGlossiness) {
+    data::PbrSpecularGlossiness param;
+    param.diffuseFactor =
+      pbrInfo->diffuseFactor.value_or(Float4{1, 1, 1, 1});
+    param.diffuseTexture = makeTextureRef(pbrInfo->diffuseTexture);
+    param.specularFactor =
+      pbrInfo->specularFactor.value_or(Float3{1, 1, 1});
+    param.glossinessFactor = pbrInfo->glossinessFactor.value_or(1.0f);
+    param.specularGlossinessTexture =
+      makeTextureRef(pbrInfo->specularGlossinessTexture);
+
+    ret.model = param;
   }
 
+  ret.normalTexture    = makeTextureRef(info.normalTexture);
+  ret.occlusionTexture = makeTextureRef(info.occlusionTexture);
+  ret.emissiveTexture  = makeTextureRef(info.emissiveTexture);
+  ret.emissiveFactor   = info.emissiveFactor.value_or(Float3{});
+
+  ret.alphaMode = AlphaMode::Opaque;
+  if(info.alphaMode == "MASK") ret.alphaMode = AlphaMode::Mask;
+  if(info.alphaMode == "BLEND") ret.alphaMode = AlphaMode::Blend;
+
+  ret.doubleSided = info.doubleSided.value_or(false);
+
   return ret;
 }
 
-static Arr<data::Sampler> readSamplers(const Json::Array& src)
+// Where the handler is in the document, each open container has one.
+enum class GltfScope : u8 {
+  Skip,
+  Document,
+  Root,
+  Buffers,
+  Buffer,
+  BufferViews,
+  BufferView,
+  Accessors,
+  Accessor,
+  Meshes,
+  Mesh,
+  Primitives,
+  Primitive,
+  Attributes,
+  Samplers,
+  Sampler,
+  Textures,
+  Texture,
+  TextureExtensions,
+  TextureSource,
+  Materials,
+  Material,
+  MetallicRoughness,
+  MaterialExtensions,
+  SpecularGlossiness,
+  TextureRef,
+  Images,
+  Image,
+  Vector
+};
+
+// Handler of the Json::parse events that fills the model as the
+// document streams by, without building a DOM. Only the members of
+// the current object of each section are kept, the sections that are
+// not read are skipped. The same events can be replayed from a
+// LazyDocument, which leaves the skipped values unparsed.
+class GltfHandler
 {
-  Arr<data::Sampler> ret;
+public:
+  GltfHandler(data::Model& model): m_model{model} {}
 
-  for(const auto& info: src) {
-    auto& sampler = ret.emplace_back();
+  // Read after the document, they need file access.
+  Arr<GltfBufferInfo> buffers;
+  Arr<GltfImageInfo>  images;
 
-    sampler.name = info["name"].AsStringOpt();
+public:
+  void OnNull() { onValue({}); }
+  void OnBool(bool value) { onValue({Kind::Bool, 0.0, value, {}, {}}); }
 
-    switch(info["magFilter"].AsNumberOpt<u32>(0u)) {
-      case 9728u:
-        sampler.magFilter = SamplerFilter::Nearest;
-        break;
-      case 9729u:
-        sampler.magFilter = SamplerFilter::Linear;
-        break;
-      default:
-        sampler.magFilter = SamplerFilter::Nearest;
-        break;
-    }
+  void OnNumber(f64 value)
+  {
+    onValue({Kind::Number, value, false, {}, {}});
+  }
 
-    switch(info["minFilter"].AsNumberOpt<u32>(0u)) {
-      case 9728u:
-        sampler.magFilter  = SamplerFilter::Nearest;
-        sampler.mipFilter  = SamplerFilter::Nearest;
-        sampler.useMipmaps = false;
-        break;
-      case 9729u:
-        sampler.magFilter  = SamplerFilter::Linear;
-        sampler.mipFilter  = SamplerFilter::Nearest;
-        sampler.useMipmaps = false;
+  void OnInteger(i64 value)
+  {
+    onValue({Kind::Number, toF64(value), false, {}, value});
+  }
+
+  void OnString(Strv value)
+  {
+    onValue({Kind::String, 0.0, false, value, {}});
+  }
+
+  void OnKey(Strv key)
+  {
+    m_key = findGltfKey(key);
+    // Attribute names are open ended.
+    if(m_scopes.back() == GltfScope::Attributes) m_attribute = key;
+  }
+
+  void OnObjectBegin()
+  {
+    m_scopes.push_back(onValue({Kind::Object, 0.0, false, {}, {}}));
+  }
+
+  void OnArrayBegin()
+  {
+    m_scopes.push_back(onValue({Kind::Array, 0.0, false, {}, {}}));
+  }
+
+  void OnObjectEnd(u64) { close(); }
+  void OnArrayEnd(u64) { close(); }
+
+  // Calls the handler for the value and what it holds, in document
+  // order. The containers it skips are not walked.
+  void Read(const Json::LazyValue& value);
+
+private:
+  enum class Kind : u8 { Null, Bool, Number, String, Array, Object };
+
+  // Integers are also kept exact.
+  struct Value {
+    Kind     kind    = Kind::Null;
+    f64      number  = 0.0;
+    bool     boolean = false;
+    Strv     string;
+    Opt<i64> integer;
+  };
+
+  // Throws when the number doesn't fit T.
+  template<typename T>
+  static T getNumber(const Value& value)
+  {
+    if(value.integer) return Json::toNumber<T>(*value.integer);
+    return Json::toNumber<T>(value.number);
+  }
+
+  template<typename T>
+  static void set(Opt<T>& dst, const Value& value)
+  {
+    if(value.kind == Kind::Number) dst = getNumber<T>(value);
+    else
+      dst.reset();
+  }
+
+  static void set(Opt<Str>& dst, const Value& value)
+  {
+    if(value.kind == Kind::String) dst = Str(value.string);
+    else
+      dst.reset();
+  }
+
+  static void set(Opt<bool>& dst, const Value& value)
+  {
+    if(value.kind == Kind::Bool) dst = value.boolean;
+    else
+      dst.reset();
+  }
+
+  // Starts the member or item, which is read in scope if it is a
+  // container of the given kind.
+  template<typename T>
+  static GltfScope
+  open(Opt<T>& dst, const Value& value, Kind kind, GltfScope scope)
+  {
+    dst.reset();
+    if(value.kind != kind) return GltfScope::Skip;
+
+    dst.emplace();
+    return scope;
+  }
+
+  // Sections are replaced by later duplicates too.
+  template<typename T>
+  static GltfScope
+  openSection(Arr<T>& dst, const Value& value, GltfScope scope)
+  {
+    dst.clear();
+    return value.kind == Kind::Array ? scope : GltfScope::Skip;
+  }
+
+  // Items that are not objects have all their members missing.
+  template<typename T>
+  GltfScope openItem(T& dst, const Value& value, GltfScope scope)
+  {
+    dst = {};
+    if(value.kind == Kind::Object) return scope;
+
+    finish(scope);
+    return GltfScope::Skip;
+  }
+
+  template<u64 S>
+  GltfScope openVector(Opt<Vector<f32, S>>& dst, const Value& value)
+  {
+    const auto ret = open(dst, value, Kind::Array, GltfScope::Vector);
+    if(dst) m_vector = dst->v;
+    m_vectorSize = 0u;
+    return ret;
+  }
+
+  GltfScope
+  openTextureRef(Opt<GltfTextureRefInfo>& dst, const Value& value)
+  {
+    const auto ret =
+      open(dst, value, Kind::Object, GltfScope::TextureRef);
+    if(dst) m_textureRef = &*dst;
+    return ret;
+  }
+
+  GltfScope openSource(Opt<u32>& dst, const Value& value)
+  {
+    dst.reset();
+    m_source = &dst;
+    return value.kind == Kind::Object ? GltfScope::TextureSource
+                                      : GltfScope::Skip;
+  }
+
+  GltfScope onValue(const Value& value);
+  GltfScope onRoot(const Value& value);
+  GltfScope onPrimitive(const Value& value);
+  GltfScope onTexture(const Value& value);
+  GltfScope onMaterial(const Value& value);
+  GltfScope onMetallicRoughness(const Value& value);
+  GltfScope onSpecularGlossiness(const Value& value);
+
+  void close()
+  {
+    const GltfScope scope = m_scopes.back();
+    m_scopes.pop_back();
+    finish(scope);
+  }
+
+  // Converts the item that just ended.
+  void finish(GltfScope scope)
+  {
+    switch(scope) {
+      case GltfScope::Buffer: buffers.push_back(m_buffer); break;
+      case GltfScope::BufferView:
+        m_model.bufferViews.push_back(makeBufferView(m_bufferView));
         break;
-      case 9984u:
-        sampler.magFilter  = SamplerFilter::Nearest;
-        sampler.mipFilter  = SamplerFilter::Nearest;
-        sampler.useMipmaps = true;
+      case GltfScope::Accessor:
+        m_model.accessors.push_back(makeAccessor(m_accessor));
         break;
-      case 9985u:
-        sampler.magFilter  = SamplerFilter::Linear;
-        sampler.mipFilter  = SamplerFilter::Nearest;
-        sampler.useMipmaps = true;
+      case GltfScope::Mesh:
+        m_model.meshes.push_back(makeMesh(m_mesh));
         break;
-      case 9986u:
-        sampler.magFilter  = SamplerFilter::Nearest;
-        sampler.mipFilter  = SamplerFilter::Linear;
-        sampler.useMipmaps = true;
+      case GltfScope::Sampler:
+        m_model.samplers.push_back(makeSampler(m_sampler));
         break;
-      case 9987u:
-        sampler.magFilter  = SamplerFilter::Linear;
-        sampler.mipFilter  = SamplerFilter::Linear;
-        sampler.useMipmaps = true;
+      case GltfScope::Texture:
+        m_model.textures.push_back(makeTexture(m_texture));
         break;
-      default:
-        sampler.magFilter  = SamplerFilter::Nearest;
-        sampler.mipFilter  = SamplerFilter::Nearest;
-        sampler.useMipmaps = false;
+      case GltfScope::Material:
+        m_model.materials.push_back(makeMaterial(m_material));
         break;
+      case GltfScope::Image: images.push_back(m_image); break;
+      default: break;
     }
+  }
 
-    switch(info["wrapS"].AsNumberOpt<u32>(0u)) {
-      case 33071u:
-        sampler.wrapU = SamplerAddressMode::Clamp;
-        break;
-      case 33648u:
-        sampler.wrapU = SamplerAddressMode::Mirror;
-        break;
-      case 10497:
-        sampler.wrapU = SamplerAddressMode::Repeat;
-        break;
-      default:
-        sampler.wrapU = SamplerAddressMode::Repeat;
-        break;
+private:
+  data::Model&   m_model;
+  Arr<GltfScope> m_scopes = {GltfScope::Document};
+  GltfKey        m_key    = GltfKey::Unknown;
+  Str            m_attribute;
+
+  GltfBufferInfo     m_buffer;
+  GltfBufferViewInfo m_bufferView;
+  GltfAccessorInfo   m_accessor;
+  GltfMeshInfo       m_mesh;
+  GltfSamplerInfo    m_sampler;
+  GltfTextureInfo    m_texture;
+  GltfMaterialInfo   m_material;
+  GltfImageInfo      m_image;
+
+  // Targets of the innermost vector, texture reference and texture
+  // extension, they can't nest.
+  Span<f32>           m_vector;
+  u64                 m_vectorSize = 0u;
+  GltfTextureRefInfo* m_textureRef = nullptr;
+  Opt<u32>*           m_source     = nullptr;
+};
+
+void GltfHandler::Read(const Json::LazyValue& value)
+{
+  if(value.IsObject()) {
+    OnObjectBegin();
+    if(m_scopes.back() != GltfScope::Skip) {
+      for(const auto& member: value.AsObject()) {
+        OnKey(member.key);
+        Read(member.value);
+      }
     }
+    close();
+  } else if(value.IsArray()) {
+    OnArrayBegin();
+    if(m_scopes.back() != GltfScope::Skip)
+      for(const auto& item: value.AsArray()) Read(item);
+    close();
+  } else if(value.IsString())
+    OnString(value.AsString());
+  else if(value.IsBool())
+    OnBool(value.AsBool());
+  else if(value.IsNumber()) {
+    Opt<i64>  integer;
+    const f64 number = value.AsNumber(integer);
+    onValue({Kind::Number, number, false, {}, integer});
+  } else
+    OnNull();
+}
 
-    switch(info["wrapT"].AsNumberOpt<u32>(0u)) {
-      case 33071u:
-        sampler.wrapV = SamplerAddressMode::Clamp;
-        break;
-      case 33648u:
-        sampler.wrapV = SamplerAddressMode::Mirror;
-        break;
-      case 10497:
-        sampler.wrapV = SamplerAddressMode::Repeat;
-        break;
-      default:
-        sampler.wrapV = SamplerAddressMode::Repeat;
-        break;
-    }
+GltfScope GltfHandler::onValue(const Value& value)
+{
+  switch(m_scopes.back()) {
+    case GltfScope::Document:
+      return value.kind == Kind::Object ? GltfScope::Root
+                                        : GltfScope::Skip;
+    case GltfScope::Root: return onRoot(value);
+
+    case GltfScope::Buffers:
+      return openItem(m_buffer, value, GltfScope::Buffer);
+    case GltfScope::Buffer:
+      if(m_key == GltfKey::ByteLength) set(m_buffer.byteLength, value);
+      if(m_key == GltfKey::Uri) set(m_buffer.uri, value);
+      break;
+
+    case GltfScope::BufferViews:
+      return openItem(m_bufferView, value, GltfScope::BufferView);
+    case GltfScope::BufferView:
+      switch(m_key) {
+        case GltfKey::Buffer: set(m_bufferView.buffer, value); break;
+        case GltfKey::ByteLength:
+          set(m_bufferView.byteLength, value);
+          break;
+        case GltfKey::ByteOffset:
+          set(m_bufferView.byteOffset, value);
+          break;
+        case GltfKey::ByteStride:
+          set(m_bufferView.byteStride, value);
+          break;
+        case GltfKey::Target: set(m_bufferView.target, value); break;
+        default: break;
+      }
+      break;
+
+    case GltfScope::Accessors:
+      return openItem(m_accessor, value, GltfScope::Accessor);
+    case GltfScope::Accessor:
+      switch(m_key) {
+        case GltfKey::BufferView:
+          set(m_accessor.bufferView, value);
+          break;
+        case GltfKey::Count: set(m_accessor.count, value); break;
+        case GltfKey::Offset: set(m_accessor.offset, value); break;
+        case GltfKey::ComponentType:
+          set(m_accessor.componentType, value);
+          break;
+        case GltfKey::Type: set(m_accessor.type, value); break;
+        case GltfKey::Min: return openVector(m_accessor.min, value);
+        case GltfKey::Max: return openVector(m_accessor.max, value);
+        default: break;
+      }
+      break;
+
+    case GltfScope::Meshes:
+      return openItem(m_mesh, value, GltfScope::Mesh);
+    case GltfScope::Mesh:
+      if(m_key == GltfKey::Name) set(m_mesh.name, value);
+      if(m_key == GltfKey::Primitives)
+        return open(
+          m_mesh.primitives, value, Kind::Array, GltfScope::Primitives);
+      break;
+    case GltfScope::Primitives:
+      m_mesh.primitives->emplace_back();
+      return value.kind == Kind::Object ? GltfScope::Primitive
+                                        : GltfScope::Skip;
+    case GltfScope::Primitive: return onPrimitive(value);
+    case GltfScope::Attributes:
+      if(value.kind != Kind::Number)
+        throw std::runtime_error("glTF: invalid attribute accessor.");
+      m_mesh.primitives->back().attributes->push_back(
+        makeAttribute(m_attribute, getNumber<u32>(value)));
+      break;
+
+    case GltfScope::Samplers:
+      return openItem(m_sampler, value, GltfScope::Sampler);
+    case GltfScope::Sampler:
+      switch(m_key) {
+        case GltfKey::Name: set(m_sampler.name, value); break;
+        case GltfKey::MagFilter: set(m_sampler.magFilter, value); break;
+        case GltfKey::MinFilter: set(m_sampler.minFilter, value); break;
+        case GltfKey::WrapS: set(m_sampler.wrapS, value); break;
+        case GltfKey::WrapT: set(m_sampler.wrapT, value); break;
+        default: break;
+      }
+      break;
+
+    case GltfScope::Textures:
+      return openItem(m_texture, value, GltfScope::Texture);
+    case GltfScope::Texture: return onTexture(value);
+    case GltfScope::TextureExtensions:
+      if(m_key == GltfKey::TextureBasisu)
+        return openSource(m_texture.basisuSource, value);
+      if(m_key == GltfKey::TextureDds)
+        return openSource(m_texture.ddsSource, value);
+      break;
+    case GltfScope::TextureSource:
+      if(m_key == GltfKey::Source) set(*m_source, value);
+      break;
+
+    case GltfScope::Materials:
+      return openItem(m_material, value, GltfScope::Material);
+    case GltfScope::Material: return onMaterial(value);
+    case GltfScope::MetallicRoughness:
+      return onMetallicRoughness(value);
+    case GltfScope::MaterialExtensions:
+      if(m_key == GltfKey::PbrSpecularGlossiness)
+        return open(
+          m_material.specularGlossiness, value, Kind::Object,
+          GltfScope::SpecularGlossiness);
+      break;
+    case GltfScope::SpecularGlossiness:
+      return onSpecularGlossiness(value);
+    case GltfScope::TextureRef:
+      switch(m_key) {
+        case GltfKey::Index: set(m_textureRef->index, value); break;
+        case GltfKey::TexCoord:
+          set(m_textureRef->texCoord, value);
+          break;
+        case GltfKey::Scale: set(m_textureRef->scale, value); break;
+        case GltfKey::Strength:
+          set(m_textureRef->strength, value);
+          break;
+        default: break;
+      }
+      break;
+
+    case GltfScope::Images:
+      return openItem(m_image, value, GltfScope::Image);
+    case GltfScope::Image:
+      if(m_key == GltfKey::Uri) set(m_image.uri, value);
+      break;
+
+    case GltfScope::Vector:
+      // Extra items are ignored.
+      if(m_vectorSize == m_vector.size()) break;
+      if(value.kind != Kind::Number)
+        throw std::runtime_error("glTF: expected a number.");
+      m_vector[m_vectorSize++] = getNumber<f32>(value);
+      break;
+
+    case GltfScope::Skip: break;
   }
 
-  return ret;
+  return GltfScope::Skip;
 }
 
-static Arr<data::Texture> readTextures(const Json::Array& src)
+GltfScope GltfHandler::onRoot(const Value& value)
 {
-  Arr<data::Texture> ret;
+  switch(m_key) {
+    case GltfKey::Buffers:
+      return openSection(buffers, value, GltfScope::Buffers);
+    case GltfKey::BufferViews:
+      return openSection(
+        m_model.bufferViews, value, GltfScope::BufferViews);
+    case GltfKey::Accessors:
+      return openSection(
+        m_model.accessors, value, GltfScope::Accessors);
+    case GltfKey::Meshes:
+      return openSection(m_model.meshes, value, GltfScope::Meshes);
+    case GltfKey::Samplers:
+      return openSection(m_model.samplers, value, GltfScope::Samplers);
+    case GltfKey::Textures:
+      return openSection(m_model.textures, value, GltfScope::Textures);
+    case GltfKey::Materials:
+      return openSection(
+        m_model.materials, value, GltfScope::Materials);
+    case GltfKey::Images:
+      return openSection(images, value, GltfScope::Images);
+    default: return GltfScope::Skip;
+  }
+}
+
+GltfScope GltfHandler::onPrimitive(const Value& value)
+{
+  auto& prim = m_mesh.primitives->back();
+  switch(m_key) {
+    case GltfKey::Indices: set(prim.indices, value); break;
+    case GltfKey::Material: set(prim.material, value); break;
+    case GltfKey::Attributes:
+      return open(
+        prim.attributes, value, Kind::Object, GltfScope::Attributes);
+    default: break;
+  }
+  return GltfScope::Skip;
+}
+
+GltfScope GltfHandler::onTexture(const Value& value)
+{
+  switch(m_key) {
+    case GltfKey::Name: set(m_texture.name, value); break;
+    case GltfKey::Source: set(m_texture.source, value); break;
+    case GltfKey::Sampler: set(m_texture.sampler, value); break;
+    case GltfKey::Extensions:
+      m_texture.basisuSource.reset();
+      m_texture.ddsSource.reset();
+      return value.kind == Kind::Object ? GltfScope::TextureExtensions
+                                        : GltfScope::Skip;
+    default: break;
+  }
+  return GltfScope::Skip;
+}
+
+GltfScope GltfHandler::onMaterial(const Value& value)
+{
+  auto& info = m_material;
+  switch(m_key) {
+    case GltfKey::Name: set(info.name, value); break;
+    case GltfKey::PbrMetallicRoughness:
+      return open(
+        info.metallicRoughness, value, Kind::Object,
+        GltfScope::MetallicRoughness);
+    case GltfKey::Extensions:
+      info.specularGlossiness.reset();
+      return value.kind == Kind::Object ? GltfScope::MaterialExtensions
+                                        : GltfScope::Skip;
+    case GltfKey::NormalTexture:
+      return openTextureRef(info.normalTexture, value);
+    case GltfKey::OcclusionTexture:
+      return openTextureRef(info.occlusionTexture, value);
+    case GltfKey::EmissiveTexture:
+      return openTextureRef(info.emissiveTexture, value);
+    case GltfKey::EmissiveFactor:
+      return openVector(info.emissiveFactor, value);
+    case GltfKey::AlphaMode: set(info.alphaMode, value); break;
+    case GltfKey::DoubleSided: set(info.doubleSided, value); break;
+    default: break;
+  }
+  return GltfScope::Skip;
+}
+
+GltfScope GltfHandler::onMetallicRoughness(const Value& value)
+{
+  auto& info = *m_material.metallicRoughness;
+  switch(m_key) {
+    case GltfKey::BaseColorFactor:
+      return openVector(info.baseColorFactor, value);
+    case GltfKey::BaseColorTexture:
+      return openTextureRef(info.baseColorTexture, value);
+    case GltfKey::MetallicFactor:
+      set(info.metallicFactor, value);
+      break;
+    case GltfKey::RoughnessFactor:
+      set(info.roughnessFactor, value);
+      break;
+    case GltfKey::MetallicRoughnessTexture:
+      return openTextureRef(info.metallicRoughnessTexture, value);
+    default: break;
+  }
+  return GltfScope::Skip;
+}
+
+GltfScope GltfHandler::onSpecularGlossiness(const Value& value)
+{
+  auto& info = *m_material.specularGlossiness;
+  switch(m_key) {
+    case GltfKey::DiffuseFactor:
+      return openVector(info.diffuseFactor, value);
+    case GltfKey::DiffuseTexture:
+      return openTextureRef(info.diffuseTexture, value);
+    case GltfKey::SpecularFactor:
+      return openVector(info.specularFactor, value);
+    case GltfKey::GlossinessFactor:
+      set(info.glossinessFactor, value);
+      break;
+    case GltfKey::SpecularGlossinessTexture:
+      return openTextureRef(info.specularGlossinessTexture, value);
+    default: break;
+  }
+  return GltfScope::Skip;
+}
+
+static Arr<data::Buffer> readBuffers(
+  const Arr<GltfBufferInfo>&      src,
+  DataReader::UriFilterByKind&    uriFilter,
+  DataReader::FileReader&         fileReader,
+  const DataReader::ModelOptions& options)
+{
+  Arr<data::Buffer> ret;
 
   for(const auto& info: src) {
-    auto& texture = ret.emplace_back();
+    auto& buffer = ret.emplace_back();
+
+    auto size = require(info.byteLength, "buffer.byteLength");
+    if(info.uri) {
+      const Strv uri        = *info.uri;
+      const bool isEmbedded = IsDataURI(uri);
+
+      // External buffers go by their full path, like the images, so
+      // equal relative uris of different folders stay apart.
+      if(isEmbedded) buffer.uri = uri;
+      else if(options.basePath)
+        buffer.uri = pathToStr(*options.basePath / uri);
+      else
+        buffer.uri = pathToStr(uri);
+
+      if(!options.readAssets) continue;
+      if(
+        uriFilter &&
+        !uriFilter(*buffer.uri, DataReader::AssetKind::Buffer))
+        continue;
+
+      if(isEmbedded) {
+        buffer.data = DecodeDataURI(uri);
+        if(size != buffer.data.size())
+          throw makeError<std::runtime_error>(
+            "glTF: Invalid length for embedded buffer");
+      } else {
+        if(!fileReader)
+          throw makeError<std::runtime_error>(
+            "glTF: FileReader must be set if the asset has external "
+            "URIs");
 
-    texture.name         = info["name"].AsStringOpt();
-    texture.imageIndex   = info["source"].AsNumberOpt<u32>();
-    texture.samplerIndex = info["sampler"].AsNumberOpt<u32>();
+        buffer.data = fileReader(
+          uri, options.basePath ? &*options.basePath : nullptr);
+        if(size != buffer.data.size())
+          throw makeError<std::runtime_error>(
+            "glTF: Invalid length for buffer %s", Str(uri).c_str());
+      }
+    } else if(options.readAssets) {
+      // TODO
+      throw makeError<std::runtime_error>(
+        "glTF: Binary format not implemented yet.");
+    }
   }
 
   return ret;
 }
 
-static Opt<data::TextureRef> readTextureRef(const Json::Value& info)
+// What the materials use an image for. Colors are sRGB encoded, the
+// other images hold linear data.
+enum class ImageUsage { Data, Color, Normal };
+
+static Arr<ImageUsage> getImageUsages(
+  u64 imageCount, const Arr<data::Texture>& textures,
+  const Arr<data::Material>& materials)
 {
-  if(!info.IsObject()) return std::nullopt;
+  Arr<ImageUsage> ret(imageCount, ImageUsage::Data);
+
+  const auto mark = [&](const Opt<data::TextureRef>& ref,
+                        ImageUsage                   usage) {
+    if(!ref || ref->textureIndex >= textures.size()) return;
+    const auto& image = textures[ref->textureIndex].imageIndex;
+    if(image && *image < imageCount) ret[*image] = usage;
+  };
+
+  for(const auto& material: materials) {
+    if(
+      const auto* pbr =
+        std::get_if<data::PbrMetallicRoughness>(&material.model))
+      mark(pbr->baseColorTexture, ImageUsage::Color);
+    if(
+      const auto* pbr =
+        std::get_if<data::PbrSpecularGlossiness>(&material.model))
+      mark(pbr->diffuseTexture, ImageUsage::Color);
+
+    mark(material.emissiveTexture, ImageUsage::Color);
+    mark(material.normalTexture, ImageUsage::Normal);
+  }
 
-  data::TextureRef ret;
-  ret.textureIndex = info["index"].AsNumber<u32>();
+  return ret;
+}
 
-  if(info["scale"].IsNumber())
-    ret.scale = info["scale"].AsNumberOpt<f32>(1.0f);
-  else if(info["strength"].IsNumber())
-    ret.scale = info["strength"].AsNumberOpt<f32>(1.0f);
+// Largest side allowed to the images so that they fit the budget
+// together, halved from the largest image until they do.
+static u32 getBudgetDimension(
+  DataReader& reader, const Arr<data::Image>& headers,
+  const Arr<DataReader::ImageOptions>& options, u64 budget)
+{
+  u32 maxDimension = 1u;
+  for(const auto& header: headers)
+    maxDimension =
+      std::max({maxDimension, header.size[0], header.size[1]});
+
+  for(u32 idx = 0u; idx < headers.size(); ++idx)
+    if(options[idx].maxDimension > 0u)
+      maxDimension = std::min(maxDimension, options[idx].maxDimension);
+
+  for(; maxDimension > 1u; maxDimension /= 2u) {
+    u64 size = 0u;
+    for(u32 idx = 0u; idx < headers.size(); ++idx) {
+      auto imageOptions         = options[idx];
+      imageOptions.maxDimension = maxDimension;
+      size += reader.GetImportSize(headers[idx], imageOptions);
+    }
 
-  ret.texCoord = info["texCoord"].AsNumberOpt<u32>(0u);
+    if(size <= budget) break;
+  }
 
-  return ret;
+  return maxDimension;
 }
 
-static Arr<data::Material> readMaterials(const Json::Array& src)
+// The images with their uri only, embedded ones have none.
+static Arr<data::Image> listImages(
+  const Arr<GltfImageInfo>&       src,
+  const DataReader::ModelOptions& options)
 {
-  Arr<data::Material> ret;
+  Arr<data::Image> ret;
+
+  for(const auto& info: src) {
+    if(!info.uri) continue;
 
-  for(const auto& matInfo: src) {
-    auto& material = ret.emplace_back();
+    auto& image = ret.emplace_back();
+    if(IsDataURI(*info.uri)) continue;
 
-    material.name = matInfo["name"].AsStringOpt();
+    if(options.basePath)
+      image.uri = pathToStr(*options.basePath / *info.uri);
+    else
+      image.uri = pathToStr(*info.uri);
+  }
 
-    if(matInfo["pbrMetallicRoughness"].IsObject()) {
-      const auto& pbrInfo = matInfo["pbrMetallicRoughness"];
+  return ret;
+}
+
+static Arr<data::Image> readImages(
+  const Arr<GltfImageInfo>& src, DataReader& reader,
+  DataReader::UriFilterByKind&    uriFilter,
+  const DataReader::ModelOptions& options,
+  const Arr<ImageUsage>&          usages)
+{
+  // Where the images are read from, embedded data or a file path.
+  struct Source {
+    DataReader::ImageOptions options;
+    Arr<u8>                  data;
+    fs::path                 path;
+    bool                     isFiltered = false;
+  };
 
-      data::PbrMetallicRoughness param;
-      param.baseColorFactor =
-        pbrInfo["baseColorFactor"].AsVectorOpt<Float4>({1, 1, 1, 1});
-      param.baseColorTexture =
-        readTextureRef(pbrInfo["baseColorTexture"]);
-      param.metallicFactor =
-        pbrInfo["metallicFactor"].AsNumberOpt<f32>(1.0f);
-      param.roughnessFactor =
-        pbrInfo["roughnessFactor"].AsNumberOpt<f32>(1.0f);
-      param.metallicRoughnessTexture =
-        readTextureRef(pbrInfo["metallicRoughnessTexture"]);
+  Arr<Source> sources;
 
-      material.model = param;
+  u64 idx = 0u;
+  for(const auto& info: src) {
+    const ImageUsage usage = usages[idx++];
+    if(!info.uri) continue;
+
+    auto& source = sources.emplace_back();
+
+    auto& imageOptions        = source.options;
+    imageOptions.maxDimension = options.maxImageDimension;
+    imageOptions.generateMips = options.generateMips;
+    imageOptions.srgb         = usage == ImageUsage::Color;
+
+    if(options.compressImages) {
+      if(usage == ImageUsage::Normal)
+        imageOptions.blockFormat = Format::BC5_UNORM;
+      else if(usage == ImageUsage::Color && options.preferBC1)
+        imageOptions.blockFormat = Format::BC1_RGBA_SRGB;
+      else if(usage == ImageUsage::Color)
+        imageOptions.blockFormat = Format::BC7_SRGB;
+      else
+        imageOptions.blockFormat = Format::BC7_UNORM;
     }
 
-    if(matInfo["extensions"]["KHR_materials_pbrSpecularGlossiness"]
-         .IsObject()) {
-      const auto& pbrInfo =
-        matInfo["extensions"]["KHR_materials_pbrSpecularGlossiness"];
-
-      data::PbrSpecularGlossiness param;
-      param.diffuseFactor =
-        pbrInfo["diffuseFactor"].AsVectorOpt<Float4>({1, 1, 1, 1});
-      param.diffuseTexture = readTextureRef(pbrInfo["diffuseTexture"]);
-      param.specularFactor =
-        pbrInfo["specularFactor"].AsVectorOpt<Float3>({1, 1, 1});
-      param.glossinessFactor =
-        pbrInfo["glossinessFactor"].AsNumberOpt<f32>(1.0f);
-      param.specularGlossinessTexture =
-        readTextureRef(pbrInfo["specularGlossinessTexture"]);
-
-      material.model = param;
+    const Strv uri = *info.uri;
+
+    if(IsDataURI(uri)) {
+      source.data = DecodeDataURI(uri);
+    } else {
+      if(options.basePath) source.path = *options.basePath / uri;
+      else
+        source.path = uri;
+
+      const Str path    = pathToStr(source.path);
+      source.isFiltered =
+        uriFilter && !uriFilter(path, DataReader::AssetKind::Image);
     }
+  }
 
-    material.normalTexture = readTextureRef(matInfo["normalTexture"]);
-    material.occlusionTexture =
-      readTextureRef(matInfo["occlusionTexture"]);
-    material.emissiveTexture =
-      readTextureRef(matInfo["emissiveTexture"]);
-    material.emissiveFactor =
-      matInfo["emissiveFactor"].AsVector<Float3>();
-
-    material.alphaMode = AlphaMode::Opaque;
-    if(matInfo["alphaMode"].IsString()) {
-      if(matInfo["alphaMode"].AsString() == "MASK")
-        material.alphaMode = AlphaMode::Mask;
-      if(matInfo["alphaMode"].AsString() == "BLEND")
-        material.alphaMode = AlphaMode::Blend;
+  const auto isDecoded = [&options](const Source& source) {
+    return !source.isFiltered &&
+           (options.decodeImages || !source.data.empty());
+  };
+
+  // Only the headers are read to find the size that fits the budget.
+  if(options.imageBudget > 0u) {
+    Arr<data::Image>              headers;
+    Arr<DataReader::ImageOptions> headerOptions;
+
+    for(const auto& source: sources) {
+      if(!isDecoded(source)) continue;
+
+      headerOptions.push_back(source.options);
+      if(source.data.empty())
+        headers.push_back(reader.ReadImageInto(
+          source.path, {}, DataReader::ImageTarget{}));
+      else
+        headers.push_back(reader.ReadImageInto(
+          source.data, {}, DataReader::ImageTarget{}));
     }
 
-    material.doubleSided = matInfo["doubleSided"].AsBoolOpt(false);
+    const u32 maxDimension = getBudgetDimension(
+      reader, headers, headerOptions, options.imageBudget);
+    for(auto& source: sources)
+      source.options.maxDimension = maxDimension;
+  }
+
+  Arr<data::Image> ret;
+
+  for(const auto& source: sources) {
+    if(!source.data.empty())
+      ret.emplace_back(reader.ReadImage(source.data, source.options));
+    else if(source.isFiltered)
+      ret.emplace_back().uri = pathToStr(source.path);
+    else if(!options.decodeImages)
+      ret.emplace_back(reader.ReadImageInto(
+        source.path, {}, DataReader::ImageTarget{}));
+    else
+      ret.emplace_back(reader.ReadImage(source.path, source.options));
   }
 
   return ret;
@@ -445,34 +1393,33 @@ DataReader::readGLTF(std::istream& src, const ModelOptions& options)
 {
   data::Model out;
 
-  Json::Value json;
-  json.Read(src);
-
-  if(json["buffers"].IsArray())
-    out.buffers = readBuffers(
-      json["buffers"].AsArray(), m_uriFilter, m_fileReader, options);
-
-  if(json["bufferViews"].IsArray())
-    out.bufferViews = readBufferViews(json["bufferViews"].AsArray());
+  const auto bytes = streamReadBytes(src);
 
-  if(json["meshes"].IsArray())
-    out.meshes = readMeshes(json["meshes"].AsArray());
+  // The model is filled while parsing, buffers and images are loaded
+  // once the whole document is read. Probes only walk the sections
+  // they list, the rest of the document is skipped unparsed.
+  const Span<char const> json(
+    reinterpret_cast<const char*>(bytes.data()), bytes.size());
 
-  if(json["accessors"].IsArray())
-    out.accessors = readAccessors(json["accessors"].AsArray());
-
-  if(json["images"].IsArray())
-    out.images =
-      readImages(json["images"].AsArray(), *this, m_uriFilter, options);
+  GltfHandler handler{out};
+  if(options.readAssets) Json::parse(json, handler);
+  else {
+    const Json::LazyDocument document(json);
+    handler.Read(document.GetRoot());
+  }
 
-  if(json["samplers"].IsArray())
-    out.samplers = readSamplers(json["samplers"].AsArray());
+  out.buffers =
+    readBuffers(handler.buffers, m_uriFilter, m_fileReader, options);
 
-  if(json["textures"].IsArray())
-    out.textures = readTextures(json["textures"].AsArray());
+  if(!options.readAssets) {
+    out.images = listImages(handler.images, options);
+    return out;
+  }
 
-  if(json["materials"].IsArray())
-    out.materials = readMaterials(json["materials"].AsArray());
+  // Images last, the materials tell what they are used for.
+  out.images = readImages(
+    handler.images, *this, m_uriFilter, options,
+    getImageUsages(handler.images.size(), out.textures, out.materials));
 
   return out;
 }
@@ -0,0 +1,62 @@
+#include "vuldir/DataWriter.hpp"
+
+using namespace vd;
+
+static DataWriter::ImageSource GetImageSource(const data::Image& image)
+{
+  return {
+    .format   = image.format,
+    .size     = image.size,
+    .texels   = image.texels,
+    .rowPitch = 0u};
+}
+
+Arr<u8> DataWriter::WriteImage(
+  const ImageSource& src, const ImageOptions& options)
+{
+  return writePng(src, options);
+}
+
+void DataWriter::WriteImage(
+  std::ostream& dst, const ImageSource& src,
+  const ImageOptions& options)
+{
+  auto bytes = WriteImage(src, options);
+  dst.write(
+    reinterpret_cast<const char*>(bytes.data()),
+    static_cast<std::streamsize>(bytes.size()));
+
+  if(!dst) throw std::runtime_error("DataWriter: cannot write image");
+}
+
+void DataWriter::WriteImage(
+  const fs::path& path, const ImageSource& src,
+  const ImageOptions& options)
+{
+  std::ofstream dst(path, std::ios::binary);
+  if(!dst)
+    throw makeError<std::runtime_error>(
+      "DataWriter: cannot access file %s", path.u8string().c_str());
+
+  WriteImage(dst, src, options);
+}
+
+Arr<u8> DataWriter::WriteImage(
+  const data::Image& image, const ImageOptions& options)
+{
+  return WriteImage(GetImageSource(image), options);
+}
+
+void DataWriter::WriteImage(
+  std::ostream& dst, const data::Image& image,
+  const ImageOptions& options)
+{
+  WriteImage(dst, GetImageSource(image), options);
+}
+
+void DataWriter::WriteImage(
+  const fs::path& path, const data::Image& image,
+  const ImageOptions& options)
+{
+  WriteImage(path, GetImageSource(image), options);
+}
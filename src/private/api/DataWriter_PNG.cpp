@@ -0,0 +1,988 @@
+#include "vuldir/DataWriter.hpp"
+#include "vuldir/PixelConverter.hpp"
+
+using namespace vd;
+
+static constexpr u8 PngSignature[] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+// Large images are split in IDAT chunks of this size.
+static constexpr u64 PngMaxChunkSize = 1_MiB;
+
+static constexpr u8 DeflateHCLENMap[] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static constexpr u8 DeflateExtraLengthBits[] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+static constexpr u32 DeflateExtraLengthValue[] = {
+  3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+
+static constexpr u8 DeflateExtraDistanceBits[] = {
+  0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+  6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static constexpr u32 DeflateExtraDistanceValue[] = {
+  1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+  33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+  1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+
+static constexpr u32 DeflateLiteralLengthCount = 286u;
+static constexpr u32 DeflateDistanceCount      = 30u;
+static constexpr u32 DeflateCodeLengthCount    = 19u;
+static constexpr u32 DeflateEndOfBlock         = 256u;
+
+static constexpr u32 DeflateMinMatch      = 3u;
+static constexpr u32 DeflateMaxMatch      = 258u;
+static constexpr u64 DeflateWindowSize    = 32_KiB;
+static constexpr u64 DeflateMaxStoredSize = 65535u;
+
+// Length 3 matches are only worth it when the distance is short.
+static constexpr u32 DeflateFarMatch = 4096u;
+
+// Symbols are collected and coded one block at a time.
+static constexpr u64 DeflateBlockTokens = 32768u;
+
+// Match search hash of the next 4 bytes.
+static constexpr u32 DeflateHashBits = 15u;
+
+// Length to symbol, minus the first length code.
+static constexpr auto DeflateLengthSymbols = [] {
+  SArr<u8, DeflateMaxMatch + 1u> ret = {};
+  for(u32 idx = 0u; idx < std::size(DeflateExtraLengthValue); ++idx) {
+    u32 first = DeflateExtraLengthValue[idx];
+    u32 count = 1u << DeflateExtraLengthBits[idx];
+    for(u32 length = first;
+        length < first + count && length <= DeflateMaxMatch; ++length)
+      ret[length] = toU8(idx);
+  }
+  // 258 has its own code rather than 227 + 31.
+  ret[DeflateMaxMatch] = toU8(std::size(DeflateExtraLengthValue) - 1u);
+  return ret;
+}();
+
+// Distance - 1 to symbol. Past 256 the distances share a symbol in
+// groups of 128, so they are looked up by (distance - 1) >> 7.
+static constexpr auto DeflateDistanceSymbols = [] {
+  SArr<u8, 512> ret = {};
+  for(u32 idx = 0u; idx < std::size(DeflateExtraDistanceValue); ++idx) {
+    u32 first = DeflateExtraDistanceValue[idx] - 1u;
+    u32 count = 1u << DeflateExtraDistanceBits[idx];
+    for(u32 value = first; value < first + count; ++value) {
+      if(value < 256u) ret[value] = toU8(idx);
+      else
+        ret[256u + (value >> 7)] = toU8(idx);
+    }
+  }
+  return ret;
+}();
+
+static inline u32 GetDeflateDistanceSymbol(u32 distance)
+{
+  u32 value = distance - 1u;
+  return value < 256u ? DeflateDistanceSymbols[value]
+                      : DeflateDistanceSymbols[256u + (value >> 7)];
+}
+
+// Compression level settings. Levels from 5 check whether the match at
+// the next position is longer before taking one.
+struct DeflateLevel {
+  u32  maxChain;
+  u32  niceLength;
+  bool lazy;
+};
+
+static constexpr DeflateLevel DeflateLevels[] = {
+  {0u, 0u, false},      // Stored
+  {0u, 0u, false},      // Runs only
+  {4u, 16u, false},   {8u, 32u, false},     {16u, 64u, false},
+  {32u, 128u, true},  {64u, 258u, true},    {128u, 258u, true},
+  {512u, 258u, true}, {4096u, 258u, true}};
+
+// Length limited code lengths. The frequencies are flattened until the
+// tree fits, which is rare and costs little compression.
+static void DeflateBuildLengths(
+  Span<const u32> freqs, u32 maxLength, Span<u8> lengths)
+{
+  const u32 count = toU32(freqs.size());
+
+  Arr<u64> weights(freqs.begin(), freqs.end());
+
+  // Two codes at least, so every used symbol gets one bit.
+  u32 used = toU32(std::count_if(
+    weights.begin(), weights.end(), [](u64 w) { return w > 0u; }));
+  for(u32 idx = 0u; used < 2u && idx < count; ++idx) {
+    if(weights[idx] == 0u) {
+      weights[idx] = 1u;
+      ++used;
+    }
+  }
+
+  // Leaves first, then the internal nodes in the order they are made.
+  Arr<u32> parents(2u * count);
+  Arr<u32> depths(2u * count);
+
+  using Node = std::pair<u64, u32>;
+  Arr<Node> heap;
+  heap.reserve(count);
+
+  for(;;) {
+    heap.clear();
+    for(u32 idx = 0u; idx < count; ++idx)
+      if(weights[idx] > 0u) heap.emplace_back(weights[idx], idx);
+    std::make_heap(heap.begin(), heap.end(), std::greater<>{});
+
+    u32 nextNode = count;
+    while(heap.size() > 1u) {
+      std::pop_heap(heap.begin(), heap.end(), std::greater<>{});
+      Node a = heap.back();
+      heap.pop_back();
+      std::pop_heap(heap.begin(), heap.end(), std::greater<>{});
+      Node b = heap.back();
+      heap.pop_back();
+
+      parents[a.second] = nextNode;
+      parents[b.second] = nextNode;
+      heap.emplace_back(a.first + b.first, nextNode++);
+      std::push_heap(heap.begin(), heap.end(), std::greater<>{});
+    }
+
+    // Parents are made after their children.
+    u32 root     = nextNode - 1u;
+    depths[root] = 0u;
+    for(u32 node = root; node-- > count;)
+      depths[node] = depths[parents[node]] + 1u;
+
+    u32 longest = 0u;
+    for(u32 idx = 0u; idx < count; ++idx) {
+      lengths[idx] =
+        weights[idx] > 0u ? toU8(depths[parents[idx]] + 1u) : 0u;
+      longest = std::max<u32>(longest, lengths[idx]);
+    }
+
+    if(longest <= maxLength) return;
+
+    for(auto& weight: weights)
+      if(weight > 0u) weight = (weight + 1u) / 2u;
+  }
+}
+
+// Canonical codes, bit reversed since deflate sends them from the most
+// significant bit.
+static void
+DeflateBuildCodes(Span<const u8> lengths, Span<u16> codes)
+{
+  u32 lengthCounts[16] = {};
+  for(auto length: lengths) ++lengthCounts[length];
+  lengthCounts[0] = 0u;
+
+  u32 nextCodes[16] = {};
+  for(u32 bits = 1u; bits < 16u; ++bits)
+    nextCodes[bits] = (nextCodes[bits - 1u] + lengthCounts[bits - 1u])
+                      << 1;
+
+  for(u64 idx = 0u; idx < lengths.size(); ++idx) {
+    u32 length = lengths[idx];
+    codes[idx] =
+      length > 0u ? toU16(bitReverse(nextCodes[length]++, length)) : 0u;
+  }
+}
+
+struct DeflateCodes {
+  SArr<u8, 288>  literalLengths;
+  SArr<u16, 288> literalCodes;
+  SArr<u8, 32>   distanceLengths;
+  SArr<u16, 32>  distanceCodes;
+};
+
+static const DeflateCodes& GetFixedDeflateCodes()
+{
+  static const DeflateCodes codes = [] {
+    DeflateCodes ret = {};
+    for(u32 idx = 0u; idx < 288u; ++idx)
+      ret.literalLengths[idx] = idx < 144u   ? 8u
+                                : idx < 256u ? 9u
+                                : idx < 280u ? 7u
+                                             : 8u;
+    ret.distanceLengths.fill(5u);
+
+    DeflateBuildCodes(ret.literalLengths, ret.literalCodes);
+    DeflateBuildCodes(ret.distanceLengths, ret.distanceCodes);
+    return ret;
+  }();
+  return codes;
+}
+
+// LZ77 with hash chains, or runs only at level 1. Tokens are literals
+// below 256, or the distance in the high bits and the length in the
+// low 9 bits. Each block is stored or coded with the fixed or dynamic
+// tables, whichever is smaller.
+class DeflateEncoder
+{
+public:
+  DeflateEncoder(u32 level, BitOStream& out):
+    m_level{level},
+    m_settings{DeflateLevels[level]},
+    m_out{out}
+  {
+    m_tokens.reserve(DeflateBlockTokens);
+    if(m_settings.maxChain > 0u) {
+      m_head.resize(1u << DeflateHashBits);
+      m_prev.resize(DeflateWindowSize);
+    }
+  }
+
+  void Encode(Span<u8 const> src)
+  {
+    if(m_level == 0u) writeStored(src, true);
+    else if(m_settings.maxChain == 0u)
+      encodeRuns(src);
+    else
+      encodeMatches(src);
+  }
+
+private:
+  static inline u32 hash(const u8* src)
+  {
+    u32 value;
+    memcpy(&value, src, sizeof(value));
+    return (value * 0x9e3779b1u) >> (32u - DeflateHashBits);
+  }
+
+  // Length of the common prefix, 8 bytes at a time.
+  static inline u32
+  matchLength(const u8* a, const u8* b, u32 maxLength)
+  {
+    u32 length = 0u;
+    for(; length + 8u <= maxLength; length += 8u) {
+      u64 va, vb;
+      memcpy(&va, a + length, sizeof(va));
+      memcpy(&vb, b + length, sizeof(vb));
+      if(u64 diff = va ^ vb; diff != 0u) {
+        if constexpr(std::endian::native == std::endian::little)
+          return length + toU32(std::countr_zero(diff)) / 8u;
+        else
+          return length + toU32(std::countl_zero(diff)) / 8u;
+      }
+    }
+    while(length < maxLength && a[length] == b[length]) ++length;
+    return length;
+  }
+
+  void literal(u8 value)
+  {
+    m_tokens.push_back(value);
+    ++m_literalFreqs[value];
+  }
+
+  void match(u32 length, u32 distance)
+  {
+    m_tokens.push_back((distance << 9) | length);
+    ++m_literalFreqs[257u + DeflateLengthSymbols[length]];
+    ++m_distanceFreqs[GetDeflateDistanceSymbol(distance)];
+  }
+
+  void encodeRuns(Span<u8 const> src)
+  {
+    const u8* data = src.data();
+    const u64 size = src.size();
+
+    u64 blockStart = 0u;
+    for(u64 pos = 0u; pos < size;) {
+      if(m_tokens.size() >= DeflateBlockTokens) {
+        writeBlock(src.subspan(blockStart, pos - blockStart), false);
+        blockStart = pos;
+      }
+
+      u32 length = 0u;
+      if(pos > 0u && data[pos] == data[pos - 1u]) {
+        u32 maxLength =
+          toU32(std::min<u64>(DeflateMaxMatch, size - pos));
+        length = matchLength(data + pos - 1u, data + pos, maxLength);
+      }
+
+      if(length >= DeflateMinMatch) {
+        match(length, 1u);
+        pos += length;
+      } else {
+        literal(data[pos]);
+        ++pos;
+      }
+    }
+
+    writeBlock(src.subspan(blockStart), true);
+  }
+
+  // Positions are stored plus one, zero ends the chain.
+  void insert(const u8* data, u64 pos)
+  {
+    u32 bucket                          = hash(data + pos);
+    m_prev[pos & (DeflateWindowSize - 1u)] = m_head[bucket];
+    m_head[bucket]                      = toU32(pos + 1u);
+  }
+
+  u32 findMatch(const u8* data, u64 size, u64 pos, u32& distance) const
+  {
+    u32 maxLength  = toU32(std::min<u64>(DeflateMaxMatch, size - pos));
+    u32 niceLength = std::min(m_settings.niceLength, maxLength);
+    u32 best       = DeflateMinMatch - 1u;
+
+    u32 candidate = m_head[hash(data + pos)];
+    for(u32 chain = m_settings.maxChain; candidate > 0u && chain > 0u;
+        --chain) {
+      u64 other = candidate - 1u;
+      if(pos - other > DeflateWindowSize) break;
+
+      // Cheap check of the byte that would make the match longer.
+      if(data[other + best] == data[pos + best]) {
+        u32 length = matchLength(data + other, data + pos, maxLength);
+        if(length > best) {
+          best     = length;
+          distance = toU32(pos - other);
+          if(length >= niceLength) break;
+        }
+      }
+
+      candidate = m_prev[other & (DeflateWindowSize - 1u)];
+    }
+
+    if(best < DeflateMinMatch) return 0u;
+    if(best == DeflateMinMatch && distance > DeflateFarMatch) return 0u;
+    return best;
+  }
+
+  void encodeMatches(Span<u8 const> src)
+  {
+    const u8* data = src.data();
+    const u64 size = src.size();
+
+    // A match found while looking ahead, for the next position.
+    bool nextFound    = false;
+    u32  nextLength   = 0u;
+    u32  nextDistance = 0u;
+
+    u64 blockStart = 0u;
+    for(u64 pos = 0u; pos < size;) {
+      if(m_tokens.size() >= DeflateBlockTokens) {
+        writeBlock(src.subspan(blockStart, pos - blockStart), false);
+        blockStart = pos;
+      }
+
+      bool canHash = pos + 4u <= size;
+
+      u32 length   = 0u;
+      u32 distance = 0u;
+      if(nextFound) {
+        length    = nextLength;
+        distance  = nextDistance;
+        nextFound = false;
+      } else if(canHash) {
+        length = findMatch(data, size, pos, distance);
+      }
+
+      if(canHash) insert(data, pos);
+
+      if(
+        m_settings.lazy && length > 0u &&
+        length < m_settings.niceLength && pos + 5u <= size) {
+        nextLength = findMatch(data, size, pos + 1u, nextDistance);
+        if(nextLength > length) {
+          nextFound = true;
+          literal(data[pos]);
+          ++pos;
+          continue;
+        }
+      }
+
+      if(length == 0u) {
+        literal(data[pos]);
+        ++pos;
+        continue;
+      }
+
+      match(length, distance);
+      for(u64 end = pos + length; ++pos < end;)
+        if(pos + 4u <= size) insert(data, pos);
+    }
+
+    writeBlock(src.subspan(blockStart), true);
+  }
+
+  void writeStored(Span<u8 const> src, bool final)
+  {
+    do {
+      u64 size = std::min(src.size(), DeflateMaxStoredSize);
+
+      m_out.Write(final && size == src.size() ? 1u : 0u, 1u);
+      m_out.Write(0u, 2u);
+      m_out.AlignToByte();
+      m_out.Write(toU32(size), 16u);
+      m_out.Write(~toU32(size), 16u);
+      m_out.WriteBytes(src.first(size));
+
+      src = src.subspan(size);
+    } while(!src.empty());
+  }
+
+  // Bits of the symbols and their extra bits with the given lengths.
+  u64 getTokenBits(
+    Span<const u8> literalLengths, Span<const u8> distanceLengths) const
+  {
+    u64 ret = 0u;
+    for(u32 idx = 0u; idx < DeflateLiteralLengthCount; ++idx)
+      ret += toU64(m_literalFreqs[idx]) * literalLengths[idx];
+    for(u32 idx = 0u; idx < DeflateDistanceCount; ++idx)
+      ret += toU64(m_distanceFreqs[idx]) * distanceLengths[idx];
+    return ret;
+  }
+
+  u64 getExtraBits() const
+  {
+    u64 ret = 0u;
+    for(u32 idx = 0u; idx < std::size(DeflateExtraLengthBits); ++idx)
+      ret += toU64(m_literalFreqs[257u + idx]) *
+             DeflateExtraLengthBits[idx];
+    for(u32 idx = 0u; idx < DeflateDistanceCount; ++idx)
+      ret += toU64(m_distanceFreqs[idx]) *
+             DeflateExtraDistanceBits[idx];
+    return ret;
+  }
+
+  void writeTokens(const DeflateCodes& codes)
+  {
+    for(u32 token: m_tokens) {
+      if(token < 256u) {
+        m_out.Write(
+          codes.literalCodes[token], codes.literalLengths[token]);
+        continue;
+      }
+
+      u32 length   = token & 0x1ffu;
+      u32 distance = token >> 9;
+
+      u32 lengthIdx    = DeflateLengthSymbols[length];
+      u32 lengthSymbol = 257u + lengthIdx;
+      u32 lengthBits   = codes.literalLengths[lengthSymbol];
+      m_out.Write(
+        codes.literalCodes[lengthSymbol] |
+          ((length - DeflateExtraLengthValue[lengthIdx]) << lengthBits),
+        lengthBits + DeflateExtraLengthBits[lengthIdx]);
+
+      u32 distanceSymbol = GetDeflateDistanceSymbol(distance);
+      u32 distanceBits   = codes.distanceLengths[distanceSymbol];
+      m_out.Write(
+        codes.distanceCodes[distanceSymbol] |
+          ((distance - DeflateExtraDistanceValue[distanceSymbol])
+           << distanceBits),
+        distanceBits + DeflateExtraDistanceBits[distanceSymbol]);
+    }
+
+    m_out.Write(
+      codes.literalCodes[DeflateEndOfBlock],
+      codes.literalLengths[DeflateEndOfBlock]);
+  }
+
+  void writeBlock(Span<u8 const> src, bool final)
+  {
+    m_literalFreqs[DeflateEndOfBlock] = 1u;
+
+    DeflateCodes dynamic = {};
+    DeflateBuildLengths(
+      {m_literalFreqs.data(), DeflateLiteralLengthCount}, 15u,
+      dynamic.literalLengths);
+    DeflateBuildLengths(
+      {m_distanceFreqs.data(), DeflateDistanceCount}, 15u,
+      dynamic.distanceLengths);
+    DeflateBuildCodes(dynamic.literalLengths, dynamic.literalCodes);
+    DeflateBuildCodes(dynamic.distanceLengths, dynamic.distanceCodes);
+
+    u32 literalCount = DeflateLiteralLengthCount;
+    while(literalCount > 257u &&
+          dynamic.literalLengths[literalCount - 1u] == 0u)
+      --literalCount;
+    u32 distanceCount = DeflateDistanceCount;
+    while(distanceCount > 1u &&
+          dynamic.distanceLengths[distanceCount - 1u] == 0u)
+      --distanceCount;
+
+    // Both tables are sent as a single run length coded sequence.
+    SArr<u8, DeflateLiteralLengthCount + DeflateDistanceCount> lengths;
+    std::copy_n(
+      dynamic.literalLengths.begin(), literalCount, lengths.begin());
+    std::copy_n(
+      dynamic.distanceLengths.begin(), distanceCount,
+      lengths.begin() + literalCount);
+
+    Arr<u16> lengthTokens; // Symbol and repeat count << 5
+    SArr<u32, DeflateCodeLengthCount> lengthFreqs = {};
+
+    const auto addLength = [&](u32 symbol, u32 extra) {
+      lengthTokens.push_back(toU16(symbol | (extra << 5)));
+      ++lengthFreqs[symbol];
+    };
+
+    u32 totalCount = literalCount + distanceCount;
+    for(u32 idx = 0u; idx < totalCount;) {
+      u32 value = lengths[idx];
+      u32 run   = 1u;
+      while(idx + run < totalCount && lengths[idx + run] == value)
+        ++run;
+      idx += run;
+
+      if(value == 0u) {
+        for(; run >= 11u; run -= std::min(run, 138u))
+          addLength(18u, std::min(run, 138u) - 11u);
+        if(run >= 3u) {
+          addLength(17u, run - 3u);
+          run = 0u;
+        }
+      } else {
+        addLength(value, 0u);
+        --run;
+        for(; run >= 3u; run -= std::min(run, 6u))
+          addLength(16u, std::min(run, 6u) - 3u);
+      }
+
+      for(; run > 0u; --run) addLength(value, 0u);
+    }
+
+    SArr<u8, DeflateCodeLengthCount>  lengthLengths = {};
+    SArr<u16, DeflateCodeLengthCount> lengthCodes   = {};
+    DeflateBuildLengths(lengthFreqs, 7u, lengthLengths);
+    DeflateBuildCodes(lengthLengths, lengthCodes);
+
+    u32 lengthCount = DeflateCodeLengthCount;
+    while(lengthCount > 4u &&
+          lengthLengths[DeflateHCLENMap[lengthCount - 1u]] == 0u)
+      --lengthCount;
+
+    // Block sizes in bits, without the 3 header bits they all have.
+    u64 extraBits   = getExtraBits();
+    u64 dynamicBits =
+      14u + 3u * lengthCount + extraBits +
+      getTokenBits(dynamic.literalLengths, dynamic.distanceLengths);
+    for(u32 idx = 0u; idx < DeflateCodeLengthCount; ++idx)
+      dynamicBits += toU64(lengthFreqs[idx]) * lengthLengths[idx];
+    dynamicBits += toU64(lengthFreqs[16]) * 2u +
+                   toU64(lengthFreqs[17]) * 3u +
+                   toU64(lengthFreqs[18]) * 7u;
+
+    const auto& fixed     = GetFixedDeflateCodes();
+    u64         fixedBits = extraBits + getTokenBits(
+                                          fixed.literalLengths,
+                                          fixed.distanceLengths);
+
+    u64 storedBlocks = std::max<u64>(
+      1u, divideRoundingUp<u64>(src.size(), DeflateMaxStoredSize));
+    u64 storedBits = (src.size() + 5u * storedBlocks) * 8u;
+
+    if(storedBits <= std::min(dynamicBits, fixedBits)) {
+      writeStored(src, final);
+    } else if(fixedBits <= dynamicBits) {
+      m_out.Write(final ? 1u : 0u, 1u);
+      m_out.Write(1u, 2u);
+      writeTokens(fixed);
+    } else {
+      m_out.Write(final ? 1u : 0u, 1u);
+      m_out.Write(2u, 2u);
+      m_out.Write(literalCount - 257u, 5u);
+      m_out.Write(distanceCount - 1u, 5u);
+      m_out.Write(lengthCount - 4u, 4u);
+      for(u32 idx = 0u; idx < lengthCount; ++idx)
+        m_out.Write(lengthLengths[DeflateHCLENMap[idx]], 3u);
+
+      for(u16 token: lengthTokens) {
+        u32 symbol = token & 0x1fu;
+        u32 extra  = token >> 5;
+        m_out.Write(lengthCodes[symbol], lengthLengths[symbol]);
+        if(symbol == 16u) m_out.Write(extra, 2u);
+        else if(symbol == 17u)
+          m_out.Write(extra, 3u);
+        else if(symbol == 18u)
+          m_out.Write(extra, 7u);
+      }
+
+      writeTokens(dynamic);
+    }
+
+    m_tokens.clear();
+    m_literalFreqs  = {};
+    m_distanceFreqs = {};
+  }
+
+private:
+  u32          m_level;
+  DeflateLevel m_settings;
+  BitOStream&  m_out;
+
+  Arr<u32>                              m_tokens;
+  SArr<u32, DeflateLiteralLengthCount>  m_literalFreqs  = {};
+  SArr<u32, DeflateDistanceCount>       m_distanceFreqs = {};
+
+  Arr<u32> m_head;
+  Arr<u32> m_prev;
+};
+
+// The Adler-32 of the data is passed in, it is summed while filtering.
+static void ZLibCompress(
+  Span<u8 const> src, u32 level, u32 adler, BitOStream& out)
+{
+  constexpr u32 CMF = 0x78u; // Deflate with a 32KiB window
+
+  u32 compressionLevel = level < 2u    ? 0u
+                         : level < 6u  ? 1u
+                         : level == 6u ? 2u
+                                       : 3u;
+
+  u32 FLG = compressionLevel << 6;
+  FLG += 31u - (CMF * 256u + FLG) % 31u;
+
+  out.Write(CMF, 8u);
+  out.Write(FLG, 8u);
+
+  DeflateEncoder encoder(level, out);
+  encoder.Encode(src);
+
+  out.AlignToByte();
+  out.Write(byteSwap(adler), 32u);
+}
+
+// Scanline filter kernels, dst[i] = cur[i] - predictor. The rows have
+// zeros before them, so the pixel on the left can be read everywhere.
+// Returns the sum of the filtered bytes as signed values, the usual
+// heuristic to pick the filter of each row.
+using PngFilterFn = u64 (*)(
+  u8* dst, const u8* cur, const u8* prev, u32 size, u32 bytesPerPixel);
+
+static constexpr u32 PngRowPadding = 16u;
+
+static inline u8 PngPaeth(u8 a, u8 b, u8 c)
+{
+  i32 pa = std::abs(toI32(b) - c);
+  i32 pb = std::abs(toI32(a) - c);
+  i32 pc = std::abs(toI32(a) + b - 2 * c);
+
+  if(pa <= pb && pa <= pc) return a;
+  if(pb <= pc) return b;
+  return c;
+}
+
+template<u32 Filter>
+static u64 PngFilterRow(
+  u8* dst, const u8* cur, const u8* prev, u32 size, u32 bytesPerPixel)
+{
+  const u8* left    = cur - bytesPerPixel;
+  const u8* topLeft = prev - bytesPerPixel;
+
+  u64 cost = 0u;
+  for(u32 idx = 0u; idx < size; ++idx) {
+    u8 pred = 0u;
+    if constexpr(Filter == 1u) pred = left[idx];
+    if constexpr(Filter == 2u) pred = prev[idx];
+    if constexpr(Filter == 3u)
+      pred = toU8((left[idx] + prev[idx]) / 2u);
+    if constexpr(Filter == 4u)
+      pred = PngPaeth(left[idx], prev[idx], topLeft[idx]);
+
+    u8 value = toU8(cur[idx] - pred);
+    dst[idx] = value;
+    cost += value < 128u ? value : 256u - value;
+  }
+  return cost;
+}
+
+#ifdef VD_ARCH_X64
+
+// Unlike unfiltering every byte only depends on the input, so all the
+// filters work on full registers.
+template<u32 Filter>
+static u64 PngFilterRowSSE2(
+  u8* dst, const u8* cur, const u8* prev, u32 size, u32 bytesPerPixel)
+{
+  const u8* left    = cur - bytesPerPixel;
+  const u8* topLeft = prev - bytesPerPixel;
+
+  const auto zero = _mm_setzero_si128();
+  const auto one  = _mm_set1_epi8(1);
+
+  const auto load = [](const u8* src) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  };
+  const auto abs16 = [zero](__m128i v) {
+    return _mm_max_epi16(v, _mm_sub_epi16(zero, v));
+  };
+  const auto paeth16 = [abs16](__m128i a, __m128i b, __m128i c) {
+    auto pa = abs16(_mm_sub_epi16(b, c));
+    auto pb = abs16(_mm_sub_epi16(a, c));
+    auto pc = abs16(
+      _mm_sub_epi16(_mm_add_epi16(a, b), _mm_add_epi16(c, c)));
+
+    auto smallest = _mm_min_epi16(pa, _mm_min_epi16(pb, pc));
+    auto useA     = _mm_cmpeq_epi16(pa, smallest);
+    auto useB     = _mm_cmpeq_epi16(pb, smallest);
+
+    auto pred =
+      _mm_or_si128(_mm_and_si128(useB, b), _mm_andnot_si128(useB, c));
+    return _mm_or_si128(
+      _mm_and_si128(useA, a), _mm_andnot_si128(useA, pred));
+  };
+
+  auto costs = zero;
+
+  u32 idx = 0u;
+  for(; idx + 16u <= size; idx += 16u) {
+    auto pred = zero;
+    if constexpr(Filter == 1u) pred = load(left + idx);
+    if constexpr(Filter == 2u) pred = load(prev + idx);
+    if constexpr(Filter == 3u) {
+      auto a = load(left + idx);
+      auto b = load(prev + idx);
+      // pavgb rounds up, remove the carried bit to get (a + b) / 2.
+      pred = _mm_sub_epi8(
+        _mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+    }
+    if constexpr(Filter == 4u) {
+      auto a = load(left + idx);
+      auto b = load(prev + idx);
+      auto c = load(topLeft + idx);
+
+      auto lo = paeth16(
+        _mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero),
+        _mm_unpacklo_epi8(c, zero));
+      auto hi = paeth16(
+        _mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero),
+        _mm_unpackhi_epi8(c, zero));
+      pred = _mm_packus_epi16(lo, hi);
+    }
+
+    auto value = _mm_sub_epi8(load(cur + idx), pred);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + idx), value);
+
+    // |value| as a signed byte is min(value, -value) unsigned.
+    auto magnitude = _mm_min_epu8(value, _mm_sub_epi8(zero, value));
+    costs = _mm_add_epi64(costs, _mm_sad_epu8(magnitude, zero));
+  }
+
+  u64 cost = toU64(_mm_cvtsi128_si64(costs)) +
+             toU64(_mm_cvtsi128_si64(_mm_unpackhi_epi64(costs, costs)));
+
+  return cost + PngFilterRow<Filter>(
+                  dst + idx, cur + idx, prev + idx, size - idx,
+                  bytesPerPixel);
+}
+
+#endif
+
+// Kernels for each filter, picked once for the CPU.
+class PngFilterTable
+{
+public:
+  PngFilterTable()
+  {
+    m_kernels[0] = &PngFilterRow<0u>;
+    m_kernels[1] = &PngFilterRow<1u>;
+    m_kernels[2] = &PngFilterRow<2u>;
+    m_kernels[3] = &PngFilterRow<3u>;
+    m_kernels[4] = &PngFilterRow<4u>;
+
+#ifdef VD_ARCH_X64
+    if(getCpuFeatures().sse2) {
+      m_kernels[0] = &PngFilterRowSSE2<0u>;
+      m_kernels[1] = &PngFilterRowSSE2<1u>;
+      m_kernels[2] = &PngFilterRowSSE2<2u>;
+      m_kernels[3] = &PngFilterRowSSE2<3u>;
+      m_kernels[4] = &PngFilterRowSSE2<4u>;
+    }
+#endif
+  }
+
+  PngFilterFn Get(u32 filter) const { return m_kernels[filter]; }
+
+private:
+  PngFilterFn m_kernels[5];
+};
+
+// 8-bit samples are converted to the PNG layout, 16-bit samples are
+// stored big-endian and the alpha is dropped when not written.
+using PngPackFn = void (*)(u8* dst, const u8* src, u32 width);
+
+template<u32 SrcChannels, u32 DstChannels>
+static void PngPackRow16(u8* dst, const u8* src, u32 width)
+{
+  for(u32 x = 0u; x < width; ++x) {
+    for(u32 channel = 0u; channel < DstChannels; ++channel) {
+      u16 value;
+      memcpy(&value, src + channel * 2u, sizeof(value));
+      dst[channel * 2u + 0u] = toU8(value >> 8);
+      dst[channel * 2u + 1u] = toU8(value);
+    }
+
+    src += SrcChannels * 2u;
+    dst += DstChannels * 2u;
+  }
+}
+
+struct PngPackLayout {
+  u8          colorType;
+  u8          bitDepth;
+  u32         bytesPerPixel;
+  PixelFormat format; // 8-bit
+  PngPackFn   pack;   // 16-bit
+};
+
+// Float images are linear and are encoded to 8-bit sRGB.
+static PngPackLayout GetPngPackLayout(Format format, bool ignoreAlpha)
+{
+  const bool isSrgb = format == Format::R8G8B8A8_SRGB ||
+                      format == Format::B8G8R8A8_SRGB ||
+                      format == Format::R16G16B16A16_SFLOAT ||
+                      format == Format::R32G32B32A32_SFLOAT;
+
+  switch(format) {
+    case Format::R8_UNORM:
+      return {0u, 8u, 1u, PixelFormat::R8_UNORM, nullptr};
+    case Format::R16_UNORM:
+      return {0u, 16u, 2u, PixelFormat::UNDEFINED, &PngPackRow16<1, 1>};
+
+    case Format::R8G8B8A8_UNORM:
+    case Format::R8G8B8A8_SRGB:
+    case Format::B8G8R8A8_UNORM:
+    case Format::B8G8R8A8_SRGB:
+    case Format::R16G16B16A16_SFLOAT:
+    case Format::R32G32B32A32_SFLOAT:
+      if(ignoreAlpha)
+        return {
+          2u, 8u, 3u,
+          isSrgb ? PixelFormat::R8G8B8_SRGB : PixelFormat::R8G8B8_UNORM,
+          nullptr};
+      return {
+        6u, 8u, 4u,
+        isSrgb ? PixelFormat::R8G8B8A8_SRGB
+               : PixelFormat::R8G8B8A8_UNORM,
+        nullptr};
+
+    case Format::R16G16B16A16_UNORM:
+      if(ignoreAlpha)
+        return {
+          2u, 16u, 6u, PixelFormat::UNDEFINED, &PngPackRow16<4, 3>};
+      return {
+        6u, 16u, 8u, PixelFormat::UNDEFINED, &PngPackRow16<4, 4>};
+
+    default: throw std::runtime_error("PNG: unsupported format");
+  }
+}
+
+static void
+PngWriteChunk(ByteOStream& out, u32 chunkType, Span<u8 const> data)
+{
+  out.WriteSwap(toU32(data.size()));
+
+  u64 typeOffset = out.size();
+  out.WriteSwap(chunkType);
+  out.Write(data);
+
+  // The CRC covers the chunk type and data.
+  out.WriteSwap(crc32({out.raw_data() + typeOffset, data.size() + 4u}));
+}
+
+Arr<u8> DataWriter::writePng(
+  const ImageSource& src, const ImageOptions& options)
+{
+  if(options.level >= std::size(DeflateLevels))
+    throw std::runtime_error("PNG: bad compression level");
+  if(src.size[0] == 0u || src.size[1] == 0u)
+    throw std::runtime_error("PNG: empty image");
+
+  auto layout = GetPngPackLayout(src.format, options.ignoreAlpha);
+
+  Opt<PixelConverter> converter;
+  if(!layout.pack)
+    converter.emplace(getPixelFormat(src.format), layout.format);
+
+  u64 packedPitch = toU64(src.size[0]) * getFormatSize(src.format);
+  u64 rowPitch    = src.rowPitch ? src.rowPitch : packedPitch;
+
+  u64 sourceSize = rowPitch * (src.size[1] - 1u) + packedPitch;
+  if(rowPitch < packedPitch || src.texels.size() < sourceSize)
+    throw std::runtime_error("PNG: source memory is too small");
+
+  // Each row starts with its filter type.
+  u64 rowSize      = toU64(src.size[0]) * layout.bytesPerPixel;
+  u64 filteredSize = (rowSize + 1u) * src.size[1];
+  if(filteredSize > std::numeric_limits<u32>::max())
+    throw std::runtime_error("PNG: image is too large");
+
+  Arr<u8> filtered(filteredSize);
+
+  // Current and previous rows, then a candidate row for each filter.
+  u64     stride     = PngRowPadding + rowSize;
+  Arr<u8> rows(stride * 7u, 0u);
+  u8*     cur        = rows.data() + PngRowPadding;
+  u8*     prev       = cur + stride;
+  u8*     candidates = prev + stride;
+
+  static const PngFilterTable filters;
+
+  u32 adler = 1u;
+  for(u32 y = 0u; y < src.size[1]; ++y) {
+    const u8* row = src.texels.data() + y * rowPitch;
+    if(converter) converter->ConvertRow(cur, row, src.size[0]);
+    else
+      layout.pack(cur, row, src.size[0]);
+
+    u8* dst = filtered.data() + y * (rowSize + 1u);
+
+    if(options.level == 0u) {
+      dst[0] = 0u;
+      memcpy(dst + 1u, cur, rowSize);
+    } else {
+      u32 bestFilter = 0u;
+      u64 bestCost   = std::numeric_limits<u64>::max();
+      for(u32 filter = 0u; filter < 5u; ++filter) {
+        u8* candidate = candidates + filter * stride;
+        u64 cost      = filters.Get(filter)(
+          candidate, cur, prev, toU32(rowSize), layout.bytesPerPixel);
+        if(cost < bestCost) {
+          bestCost   = cost;
+          bestFilter = filter;
+        }
+      }
+
+      dst[0] = toU8(bestFilter);
+      memcpy(dst + 1u, candidates + bestFilter * stride, rowSize);
+    }
+
+    // Summed while the row is still in cache.
+    adler = adler32({dst, rowSize + 1u}, adler);
+    std::swap(cur, prev);
+  }
+
+  BitOStream zlib(filteredSize / 2u);
+  ZLibCompress(filtered, options.level, adler, zlib);
+
+  const auto& zlibData = zlib.data();
+
+  ByteOStream out(zlibData.size() + 1_KiB);
+  out.Write(PngSignature);
+
+  ByteOStream header(13u);
+  header.WriteSwap(src.size[0]);
+  header.WriteSwap(src.size[1]);
+  header.Write(layout.bitDepth);
+  header.Write(layout.colorType);
+  header.Write(u8{0u}); // Compression
+  header.Write(u8{0u}); // Filter
+  header.Write(u8{0u}); // Interlace
+  PngWriteChunk(out, fourCC("IHDR"), header.data());
+
+  for(u64 offset = 0u; offset < zlibData.size();
+      offset += PngMaxChunkSize)
+    PngWriteChunk(
+      out, fourCC("IDAT"),
+      {zlibData.data() + offset,
+       std::min(PngMaxChunkSize, zlibData.size() - offset)});
+
+  PngWriteChunk(out, fourCC("IEND"), {});
+
+  return std::move(out.data());
+}
@@ -0,0 +1,198 @@
+#include "vuldir/DiskCache.hpp"
+
+#include <random>
+
+using namespace vd;
+
+static constexpr Strv DiskCacheExtension     = ".vdc";
+static constexpr Strv DiskCacheTempExtension = ".tmp";
+
+// Temporary files older than this were left by a writer that crashed,
+// younger ones may still be written.
+static constexpr auto DiskCacheTempLifetime = std::chrono::minutes(1);
+
+DiskCache::DiskCache(const Desc& desc):
+  m_mutex{},
+  m_directory{desc.directory},
+  m_budget{desc.budget},
+  m_stats{},
+  m_tempId{std::random_device{}()},
+  m_tempCount{0u}
+{
+  std::error_code error;
+  fs::create_directories(m_directory, error);
+  if(error)
+    throw makeError<std::runtime_error>(
+      "DiskCache: cannot create directory %s",
+      m_directory.u8string().c_str());
+
+  std::scoped_lock lock{m_mutex};
+  evict(m_budget);
+}
+
+MappedFile DiskCache::Find(const Hash128& key)
+{
+  const auto path = getPath(key);
+
+  MappedFile file(path);
+
+  std::scoped_lock lock{m_mutex};
+
+  if(file.GetData().empty()) {
+    m_stats.misses += 1u;
+    return file;
+  }
+
+  // The write time orders the entries for eviction.
+  std::error_code error;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+
+  m_stats.hits += 1u;
+  return file;
+}
+
+void DiskCache::Add(const Hash128& key, const Writer& writer)
+{
+  const auto path = getPath(key);
+
+  fs::path temp;
+  {
+    std::scoped_lock lock{m_mutex};
+    temp = path;
+    temp += formatString(
+      ".%016llx.%llu%s", m_tempId, m_tempCount++,
+      DiskCacheTempExtension.data());
+  }
+
+  std::error_code error;
+  try {
+    std::ofstream dst(temp, std::ios::binary | std::ios::trunc);
+    if(dst) writer(dst);
+    if(!dst || !dst.flush()) {
+      VDLogW(
+        "DiskCache: cannot write file %s", temp.u8string().c_str());
+      dst.close();
+      fs::remove(temp, error);
+      return;
+    }
+  } catch(...) {
+    fs::remove(temp, error);
+    throw;
+  }
+
+  const u64 size = fs::file_size(temp, error);
+  if(error) {
+    VDLogW(
+      "DiskCache: cannot read the size of file %s",
+      temp.u8string().c_str());
+    fs::remove(temp, error);
+    return;
+  }
+
+  // Size of the entry this one replaces, if any.
+  std::error_code replacedError;
+  const u64       replacedSize = fs::file_size(path, replacedError);
+  const bool      isReplaced   = !replacedError;
+
+  // An entry being read elsewhere may not be replaceable, it is as
+  // good as the new one.
+  fs::rename(temp, path, error);
+  if(error) {
+    VDLogW(
+      "DiskCache: cannot rename file %s", temp.u8string().c_str());
+    fs::remove(temp, error);
+    return;
+  }
+
+  std::scoped_lock lock{m_mutex};
+
+  if(!isReplaced) m_stats.entries += 1u;
+  m_stats.size = m_stats.size + size - (isReplaced ? replacedSize : 0u);
+  if(m_stats.size > m_budget) evict(m_budget);
+}
+
+void DiskCache::SetBudget(u64 budget)
+{
+  std::scoped_lock lock{m_mutex};
+
+  m_budget = budget;
+  evict(m_budget);
+}
+
+DiskCache::Stats DiskCache::GetStats() const
+{
+  std::scoped_lock lock{m_mutex};
+  return m_stats;
+}
+
+void DiskCache::Clear()
+{
+  std::scoped_lock lock{m_mutex};
+  evict(0u);
+}
+
+fs::path DiskCache::getPath(const Hash128& key) const
+{
+  return m_directory / formatString(
+                         "%016llx%016llx%s", key.hi, key.lo,
+                         DiskCacheExtension.data());
+}
+
+void DiskCache::evict(u64 budget)
+{
+  struct Entry {
+    fs::path            path;
+    u64                 size;
+    fs::file_time_type time;
+  };
+
+  Arr<Entry> entries;
+  u64        size = 0u;
+
+  const auto staleTime =
+    fs::file_time_type::clock::now() - DiskCacheTempLifetime;
+
+  std::error_code error;
+  for(
+    fs::directory_iterator it(m_directory, error), end;
+    !error && it != end; it.increment(error)) {
+    const auto extension = it->path().extension();
+    if(
+      extension != DiskCacheExtension &&
+      extension != DiskCacheTempExtension)
+      continue;
+
+    std::error_code entryError;
+    const u64       entrySize = it->file_size(entryError);
+    const auto      entryTime = it->last_write_time(entryError);
+    if(entryError) continue;
+
+    if(extension == DiskCacheTempExtension) {
+      if(entryTime < staleTime) fs::remove(it->path(), entryError);
+      continue;
+    }
+
+    entries.push_back({it->path(), entrySize, entryTime});
+    size += entrySize;
+  }
+
+  // Oldest first.
+  std::sort(
+    entries.begin(), entries.end(),
+    [](const Entry& a, const Entry& b) { return a.time < b.time; });
+
+  u64 count = entries.size();
+  for(const auto& entry: entries) {
+    if(size <= budget) break;
+
+    // Entries mapped elsewhere can be locked, they stay.
+    if(!fs::remove(entry.path, error) || error) continue;
+
+    size              -= entry.size;
+    count             -= 1u;
+    m_stats.evictions += 1u;
+  }
+
+  m_stats.entries = count;
+  m_stats.size    = size;
+}
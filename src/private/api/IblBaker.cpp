@@ -0,0 +1,1122 @@
+#include "vuldir/IblBaker.hpp"
+
+#include "vuldir/DataReader.hpp"
+#include "vuldir/PixelConverter.hpp"
+
+#include <numbers>
+
+using namespace vd;
+
+// The environment is resampled to a float cube with a power of two
+// size and box filtered mips. Specular texels average GGX samples
+// around their normal, each read from the source mip matching the
+// solid angle it stands for (filtered importance sampling), so a few
+// dozen samples are enough. The irradiance is projected to order 2
+// spherical harmonics. Jobs are rows of the outputs, taken by the
+// threads as they go.
+
+static constexpr f32 IblPi = std::numbers::pi_v<f32>;
+
+// Larger environments are sampled down to this face size.
+static constexpr u32 IblMaxSourceSize = 1024u;
+
+// The harmonics are projected from the first source mip this small.
+static constexpr u32 IblShSourceSize = 64u;
+
+static constexpr u32 IblBrdfSampleCount = 1024u;
+
+static constexpr u32 IblCookedMagic   = fourCC("VDIB");
+static constexpr u32 IblCookedVersion = 1u;
+
+// Float RGBA faces, every face of a mip before the next mip.
+struct IblCube {
+  u32      size = 0u;
+  u32      mips = 0u;
+  Arr<u64> offsets;
+  Arr<f32> texels;
+
+  u32 GetSize(u32 mip) const { return std::max(size >> mip, 1u); }
+
+  f32* GetFace(u32 mip, u32 face)
+  {
+    const u64 extent = GetSize(mip);
+    return texels.data() + offsets[mip] + face * extent * extent * 4u;
+  }
+
+  const f32* GetFace(u32 mip, u32 face) const
+  {
+    const u64 extent = GetSize(mip);
+    return texels.data() + offsets[mip] + face * extent * extent * 4u;
+  }
+};
+
+static IblCube MakeIblCube(u32 size, u32 mips)
+{
+  IblCube cube;
+  cube.size = size;
+  cube.mips = mips;
+
+  u64 count = 0u;
+  for(u32 mip = 0u; mip < mips; ++mip) {
+    cube.offsets.push_back(count);
+    count += toU64(cube.GetSize(mip)) * cube.GetSize(mip) * 6u * 4u;
+  }
+  cube.texels.resize(count);
+
+  return cube;
+}
+
+// One row of a face of an output mip.
+struct IblJob {
+  u32 mip;
+  u32 face;
+  u32 row;
+};
+
+static Arr<IblJob> GetIblJobs(u32 size, u32 mips)
+{
+  Arr<IblJob> jobs;
+  for(u32 mip = 0u; mip < mips; ++mip)
+    for(u32 face = 0u; face < 6u; ++face)
+      for(u32 row = 0u; row < std::max(size >> mip, 1u); ++row)
+        jobs.push_back({mip, face, row});
+  return jobs;
+}
+
+// Direction through a point of a cube face, u and v in [-1, 1] going
+// right and down the face.
+static Float3 IblFaceDirection(u32 face, f32 u, f32 v)
+{
+  switch(face) {
+    case 0u:
+      return {1.0f, -v, -u};
+    case 1u:
+      return {-1.0f, -v, u};
+    case 2u:
+      return {u, 1.0f, v};
+    case 3u:
+      return {u, -1.0f, -v};
+    case 4u:
+      return {u, -v, 1.0f};
+    default:
+      return {-u, -v, -1.0f};
+  }
+}
+
+static Float3 IblTexelDirection(u32 face, u32 x, u32 y, u32 size)
+{
+  const f32 u = (toF32(x) + 0.5f) / toF32(size) * 2.0f - 1.0f;
+  const f32 v = (toF32(y) + 0.5f) / toF32(size) * 2.0f - 1.0f;
+  return mt::Norm(IblFaceDirection(face, u, v));
+}
+
+// The face a direction points to and where it lands, u and v in
+// [0, 1]. The AVX2 version follows the same steps.
+static void
+IblProject(f32 x, f32 y, f32 z, u32& face, f32& u, f32& v)
+{
+  const f32 ax = std::abs(x);
+  const f32 ay = std::abs(y);
+  const f32 az = std::abs(z);
+
+  f32 ma = 0.0f, sc = 0.0f, tc = 0.0f;
+  if(ax >= ay && ax >= az) {
+    face = x < 0.0f ? 1u : 0u;
+    ma   = ax;
+    sc   = x < 0.0f ? z : -z;
+    tc   = -y;
+  } else if(ay >= az) {
+    face = y < 0.0f ? 3u : 2u;
+    ma   = ay;
+    sc   = x;
+    tc   = y < 0.0f ? -z : z;
+  } else {
+    face = z < 0.0f ? 5u : 4u;
+    ma   = az;
+    sc   = z < 0.0f ? -x : x;
+    tc   = -y;
+  }
+
+  u = sc / ma * 0.5f + 0.5f;
+  v = tc / ma * 0.5f + 0.5f;
+}
+
+// The four texels around a point of a face and their weights, clamped
+// to the face edges.
+struct IblTaps {
+  const f32* texels[4];
+  f32        weights[4];
+};
+
+static IblTaps IblGetTaps(
+  const IblCube& cube, u32 mip, u32 face, f32 u, f32 v, f32 weight)
+{
+  const u32 size = cube.GetSize(mip);
+  const f32 fx   = u * toF32(size) - 0.5f;
+  const f32 fy   = v * toF32(size) - 0.5f;
+  const f32 x0   = std::floor(fx);
+  const f32 y0   = std::floor(fy);
+  const f32 tx   = fx - x0;
+  const f32 ty   = fy - y0;
+
+  const i32  last = toI32(size) - 1;
+  const auto clampTo = [&](f32 value, i32 offset) {
+    return toU64(std::clamp(toI32(value) + offset, 0, last));
+  };
+
+  const u64 xs[] = {clampTo(x0, 0), clampTo(x0, 1)};
+  const u64 ys[] = {clampTo(y0, 0), clampTo(y0, 1)};
+
+  const f32* texels = cube.GetFace(mip, face);
+
+  IblTaps taps;
+  for(u32 idx = 0u; idx < 4u; ++idx)
+    taps.texels[idx] =
+      texels + (ys[idx / 2u] * size + xs[idx % 2u]) * 4u;
+
+  taps.weights[0] = (1.0f - tx) * (1.0f - ty) * weight;
+  taps.weights[1] = tx * (1.0f - ty) * weight;
+  taps.weights[2] = (1.0f - tx) * ty * weight;
+  taps.weights[3] = tx * ty * weight;
+  return taps;
+}
+
+static void IblAddTaps(f32* acc, const IblTaps& taps)
+{
+  for(u32 channel = 0u; channel < 4u; ++channel)
+    acc[channel] += taps.texels[0][channel] * taps.weights[0] +
+                    taps.texels[1][channel] * taps.weights[1] +
+                    taps.texels[2][channel] * taps.weights[2] +
+                    taps.texels[3][channel] * taps.weights[3];
+}
+
+// GGX samples around +Z, shared by every texel of an output mip, each
+// with the source mip it reads. Samples below the horizon are dropped.
+struct IblSamples {
+  // Directions, weighted by their cosine z.
+  Arr<f32> x, y, z;
+  Arr<u32> mip;
+  Arr<f32> frac;
+
+  // Inverse of the weight sum.
+  f32 norm = 0.0f;
+
+  u32 GetCount() const { return size32(x); }
+};
+
+static void IblPushSample(IblSamples& samples, Float3 dir, f32 lod)
+{
+  samples.x.push_back(dir[0]);
+  samples.y.push_back(dir[1]);
+  samples.z.push_back(dir[2]);
+  samples.mip.push_back(toU32(std::floor(lod)));
+  samples.frac.push_back(lod - std::floor(lod));
+}
+
+static Float2 IblHammersley(u32 idx, u32 count)
+{
+  return {
+    toF32(idx) / toF32(count),
+    toF32(bitReverse(idx, 32u)) * 2.3283064365386963e-10f};
+}
+
+// Half vector of a GGX sample around +Z.
+static Float3 IblSampleGgx(Float2 xi, f32 alpha)
+{
+  const f32 a2   = alpha * alpha;
+  const f32 phi  = 2.0f * IblPi * xi[0];
+  const f32 cosT =
+    std::sqrt((1.0f - xi[1]) / (1.0f + (a2 - 1.0f) * xi[1]));
+  const f32 sinT = std::sqrt(std::max(1.0f - cosT * cosT, 0.0f));
+  return {sinT * std::cos(phi), sinT * std::sin(phi), cosT};
+}
+
+// The source lod is at least the one matching the output texels, so a
+// mirror reflection is a plain resample of the source.
+static IblSamples MakeIblSamples(
+  f32 roughness, u32 sampleCount, f32 baseLod, const IblCube& source)
+{
+  IblSamples ret;
+
+  const f32 maxLod = toF32(source.mips - 1u);
+
+  if(roughness <= 0.0f) {
+    IblPushSample(
+      ret, {0.0f, 0.0f, 1.0f}, std::clamp(baseLod, 0.0f, maxLod));
+    ret.norm = 1.0f;
+    return ret;
+  }
+
+  const f32 alpha = roughness * roughness;
+  const f32 a2    = alpha * alpha;
+
+  const f32 texelAngle =
+    4.0f * IblPi / (6.0f * toF32(source.size) * toF32(source.size));
+
+  f32 weightSum = 0.0f;
+  for(u32 idx = 0u; idx < sampleCount; ++idx) {
+    const auto h = IblSampleGgx(IblHammersley(idx, sampleCount), alpha);
+
+    // With the view along the normal, L is H reflected around +Z.
+    const Float3 l = {
+      2.0f * h[2] * h[0], 2.0f * h[2] * h[1],
+      2.0f * h[2] * h[2] - 1.0f};
+    if(l[2] <= 0.0f) continue;
+
+    // The pdf of L is D(H) / 4 when N, V and H line up that way.
+    const f32 d   = (a2 - 1.0f) * h[2] * h[2] + 1.0f;
+    const f32 pdf = a2 / (IblPi * d * d) / 4.0f;
+
+    const f32 sampleAngle = 1.0f / (toF32(sampleCount) * pdf);
+    const f32 lod = 0.5f * std::log2(sampleAngle / texelAngle) + 1.0f;
+
+    IblPushSample(
+      ret, l, std::clamp(std::max(lod, baseLod), 0.0f, maxLod));
+    weightSum += l[2];
+  }
+
+  ret.norm = 1.0f / weightSum;
+  return ret;
+}
+
+// Tangent frame around a normal.
+struct IblFrame {
+  Float3 t, b, n;
+};
+
+static IblFrame MakeIblFrame(const Float3& n)
+{
+  const Float3 up =
+    std::abs(n[2]) < 0.999f ? Float3{0.0f, 0.0f, 1.0f}
+                            : Float3{1.0f, 0.0f, 0.0f};
+  const auto t = mt::Norm(mt::Cross(up, n));
+  return {t, mt::Cross(n, t), n};
+}
+
+// Filters the source around the normal of a frame with the samples of
+// a mip.
+using IblFilterFn = void (*)(
+  f32* dst, const IblCube& source, const IblSamples& samples,
+  const IblFrame& frame);
+
+static void IblAddSample(
+  f32* acc, const IblCube& source, const IblSamples& samples, u32 idx,
+  u32 face, f32 u, f32 v)
+{
+  const u32 mip = samples.mip[idx];
+  const f32 w   = samples.z[idx];
+  const f32 t   = samples.frac[idx];
+
+  if(t == 0.0f) {
+    IblAddTaps(acc, IblGetTaps(source, mip, face, u, v, w));
+  } else {
+    IblAddTaps(
+      acc, IblGetTaps(source, mip, face, u, v, w * (1.0f - t)));
+    IblAddTaps(acc, IblGetTaps(source, mip + 1u, face, u, v, w * t));
+  }
+}
+
+static void IblFilter(
+  f32* dst, const IblCube& source, const IblSamples& samples,
+  const IblFrame& frame)
+{
+  f32 acc[4] = {};
+  for(u32 idx = 0u; idx < samples.GetCount(); ++idx) {
+    const f32 lx = samples.x[idx];
+    const f32 ly = samples.y[idx];
+    const f32 lz = samples.z[idx];
+
+    u32 face = 0u;
+    f32 u = 0.0f, v = 0.0f;
+    IblProject(
+      frame.t[0] * lx + frame.b[0] * ly + frame.n[0] * lz,
+      frame.t[1] * lx + frame.b[1] * ly + frame.n[1] * lz,
+      frame.t[2] * lx + frame.b[2] * ly + frame.n[2] * lz, face, u, v);
+
+    IblAddSample(acc, source, samples, idx, face, u, v);
+  }
+
+  for(u32 channel = 0u; channel < 4u; ++channel)
+    dst[channel] = acc[channel] * samples.norm;
+}
+
+#ifdef VD_ARCH_X64
+
+// Bilinear taps of eight samples on one level, as texel offsets within
+// their faces and weights.
+struct IblTapLanes {
+  alignas(32) i32 offsets[4][8];
+  alignas(32) f32 weights[4][8];
+};
+
+VD_TARGET("avx2")
+static __m256i IblClampAVX2(__m256 value, i32 offset, __m256i last)
+{
+  return _mm256_min_epi32(
+    _mm256_max_epi32(
+      _mm256_add_epi32(
+        _mm256_cvttps_epi32(value), _mm256_set1_epi32(offset)),
+      _mm256_setzero_si256()),
+    last);
+}
+
+VD_TARGET("avx2")
+static void IblGetTapsAVX2(
+  IblTapLanes& taps, __m256i mip, u32 sourceSize, __m256 u, __m256 v,
+  __m256 weight)
+{
+  const auto size = _mm256_max_epi32(
+    _mm256_srlv_epi32(_mm256_set1_epi32(toI32(sourceSize)), mip),
+    _mm256_set1_epi32(1));
+  const auto last = _mm256_sub_epi32(size, _mm256_set1_epi32(1));
+  const auto one  = _mm256_set1_ps(1.0f);
+  const auto half = _mm256_set1_ps(0.5f);
+
+  const auto sizeF = _mm256_cvtepi32_ps(size);
+  const auto fx    = _mm256_sub_ps(_mm256_mul_ps(u, sizeF), half);
+  const auto fy    = _mm256_sub_ps(_mm256_mul_ps(v, sizeF), half);
+  const auto x0    = _mm256_floor_ps(fx);
+  const auto y0    = _mm256_floor_ps(fy);
+  const auto tx    = _mm256_sub_ps(fx, x0);
+  const auto ty    = _mm256_sub_ps(fy, y0);
+
+  const __m256i xs[] = {
+    IblClampAVX2(x0, 0, last), IblClampAVX2(x0, 1, last)};
+  const __m256i ys[] = {
+    _mm256_mullo_epi32(IblClampAVX2(y0, 0, last), size),
+    _mm256_mullo_epi32(IblClampAVX2(y0, 1, last), size)};
+
+  for(u32 idx = 0u; idx < 4u; ++idx)
+    _mm256_store_si256(
+      reinterpret_cast<__m256i*>(taps.offsets[idx]),
+      _mm256_slli_epi32(
+        _mm256_add_epi32(ys[idx / 2u], xs[idx % 2u]), 2));
+
+  const auto rx = _mm256_sub_ps(one, tx);
+  const auto ry = _mm256_sub_ps(one, ty);
+
+  const __m256 weights[] = {
+    _mm256_mul_ps(_mm256_mul_ps(rx, ry), weight),
+    _mm256_mul_ps(_mm256_mul_ps(tx, ry), weight),
+    _mm256_mul_ps(_mm256_mul_ps(rx, ty), weight),
+    _mm256_mul_ps(_mm256_mul_ps(tx, ty), weight)};
+
+  for(u32 idx = 0u; idx < 4u; ++idx)
+    _mm256_store_ps(taps.weights[idx], weights[idx]);
+}
+
+VD_TARGET("avx2")
+static void IblAddTapsAVX2(
+  __m128& acc, const f32* texels, const IblTapLanes& taps, u32 lane)
+{
+  __m128 sum = _mm_mul_ps(
+    _mm_loadu_ps(texels + taps.offsets[0][lane]),
+    _mm_set1_ps(taps.weights[0][lane]));
+  for(u32 idx = 1u; idx < 4u; ++idx)
+    sum = _mm_add_ps(
+      sum, _mm_mul_ps(
+             _mm_loadu_ps(texels + taps.offsets[idx][lane]),
+             _mm_set1_ps(taps.weights[idx][lane])));
+  acc = _mm_add_ps(acc, sum);
+}
+
+VD_TARGET("avx2")
+static __m256 IblRotateAVX2(
+  const IblFrame& frame, u32 axis, __m256 lx, __m256 ly, __m256 lz)
+{
+  return _mm256_add_ps(
+    _mm256_add_ps(
+      _mm256_mul_ps(_mm256_set1_ps(frame.t[axis]), lx),
+      _mm256_mul_ps(_mm256_set1_ps(frame.b[axis]), ly)),
+    _mm256_mul_ps(_mm256_set1_ps(frame.n[axis]), lz));
+}
+
+// Eight samples at a time are rotated to the frame, projected to the
+// faces and turned into taps, only the fetches go lane by lane. The
+// arithmetic follows the scalar path step by step, results match.
+VD_TARGET("avx2")
+static void IblFilterAVX2(
+  f32* dst, const IblCube& source, const IblSamples& samples,
+  const IblFrame& frame)
+{
+  const u32 count = samples.GetCount();
+
+  const auto sign = _mm256_set1_ps(-0.0f);
+  const auto zero = _mm256_setzero_ps();
+  const auto one  = _mm256_set1_ps(1.0f);
+  const auto half = _mm256_set1_ps(0.5f);
+
+  __m128      acc = _mm_setzero_ps();
+  IblTapLanes lo, hi;
+
+  u32 idx = 0u;
+  for(; idx + 8u <= count; idx += 8u) {
+    const auto lx = _mm256_loadu_ps(samples.x.data() + idx);
+    const auto ly = _mm256_loadu_ps(samples.y.data() + idx);
+    const auto lz = _mm256_loadu_ps(samples.z.data() + idx);
+
+    const auto x = IblRotateAVX2(frame, 0u, lx, ly, lz);
+    const auto y = IblRotateAVX2(frame, 1u, lx, ly, lz);
+    const auto z = IblRotateAVX2(frame, 2u, lx, ly, lz);
+
+    const auto ax = _mm256_andnot_ps(sign, x);
+    const auto ay = _mm256_andnot_ps(sign, y);
+    const auto az = _mm256_andnot_ps(sign, z);
+
+    const auto isX = _mm256_and_ps(
+      _mm256_cmp_ps(ax, ay, _CMP_GE_OQ),
+      _mm256_cmp_ps(ax, az, _CMP_GE_OQ));
+    const auto isY =
+      _mm256_andnot_ps(isX, _mm256_cmp_ps(ay, az, _CMP_GE_OQ));
+
+    const auto negX = _mm256_cmp_ps(x, zero, _CMP_LT_OQ);
+    const auto negY = _mm256_cmp_ps(y, zero, _CMP_LT_OQ);
+    const auto negZ = _mm256_cmp_ps(z, zero, _CMP_LT_OQ);
+
+    // Negated by flipping the sign bit, like the scalar minus.
+    const auto nx = _mm256_xor_ps(x, sign);
+    const auto ny = _mm256_xor_ps(y, sign);
+    const auto nz = _mm256_xor_ps(z, sign);
+
+    // Z first, then Y and X over it, like the scalar branches.
+    auto ma   = az;
+    auto sc   = _mm256_blendv_ps(x, nx, negZ);
+    auto tc   = ny;
+    auto neg  = negZ;
+    auto base = _mm256_set1_ps(4.0f);
+
+    ma   = _mm256_blendv_ps(ma, ay, isY);
+    sc   = _mm256_blendv_ps(sc, x, isY);
+    tc   = _mm256_blendv_ps(tc, _mm256_blendv_ps(z, nz, negY), isY);
+    neg  = _mm256_blendv_ps(neg, negY, isY);
+    base = _mm256_blendv_ps(base, _mm256_set1_ps(2.0f), isY);
+
+    ma   = _mm256_blendv_ps(ma, ax, isX);
+    sc   = _mm256_blendv_ps(sc, _mm256_blendv_ps(nz, z, negX), isX);
+    tc   = _mm256_blendv_ps(tc, ny, isX);
+    neg  = _mm256_blendv_ps(neg, negX, isX);
+    base = _mm256_blendv_ps(base, zero, isX);
+
+    const auto faces = _mm256_cvttps_epi32(
+      _mm256_add_ps(base, _mm256_and_ps(neg, one)));
+    const auto u =
+      _mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(sc, ma), half), half);
+    const auto v =
+      _mm256_add_ps(_mm256_mul_ps(_mm256_div_ps(tc, ma), half), half);
+
+    // Trilinear, the second level only counts with a fraction.
+    const auto mip = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i*>(samples.mip.data() + idx));
+    const auto t = _mm256_loadu_ps(samples.frac.data() + idx);
+
+    IblGetTapsAVX2(
+      lo, mip, source.size, u, v,
+      _mm256_mul_ps(lz, _mm256_sub_ps(one, t)));
+    IblGetTapsAVX2(
+      hi, _mm256_add_epi32(mip, _mm256_set1_epi32(1)), source.size, u,
+      v, _mm256_mul_ps(lz, t));
+
+    alignas(32) u32 faceLanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(faceLanes), faces);
+
+    for(u32 lane = 0u; lane < 8u; ++lane) {
+      const u32 sample = idx + lane;
+      const u32 level  = samples.mip[sample];
+      const u32 face   = faceLanes[lane];
+
+      IblAddTapsAVX2(acc, source.GetFace(level, face), lo, lane);
+      if(samples.frac[sample] != 0.0f)
+        IblAddTapsAVX2(
+          acc, source.GetFace(level + 1u, face), hi, lane);
+    }
+  }
+
+  f32 rest[4];
+  _mm_storeu_ps(rest, acc);
+
+  // Back to plain SSE code for the remaining samples.
+  _mm256_zeroupper();
+
+  for(; idx < count; ++idx) {
+    const f32 lx = samples.x[idx];
+    const f32 ly = samples.y[idx];
+    const f32 lz = samples.z[idx];
+
+    u32 face = 0u;
+    f32 u = 0.0f, v = 0.0f;
+    IblProject(
+      frame.t[0] * lx + frame.b[0] * ly + frame.n[0] * lz,
+      frame.t[1] * lx + frame.b[1] * ly + frame.n[1] * lz,
+      frame.t[2] * lx + frame.b[2] * ly + frame.n[2] * lz, face, u, v);
+
+    IblAddSample(rest, source, samples, idx, face, u, v);
+  }
+
+  for(u32 channel = 0u; channel < 4u; ++channel)
+    dst[channel] = rest[channel] * samples.norm;
+}
+
+#endif
+
+static IblFilterFn GetIblFilterFn()
+{
+#ifdef VD_ARCH_X64
+  if(getCpuFeatures().avx2) return &IblFilterAVX2;
+#endif
+  return &IblFilter;
+}
+
+// Level 0 of every layer as float RGBA.
+static Arr<Arr<f32>> GetIblLayers(const data::Image& image)
+{
+  const auto dstFormat = PixelFormat::R32G32B32A32_SFLOAT;
+  const auto srcFormat = getPixelFormat(image.format);
+  if(srcFormat == PixelFormat::UNDEFINED)
+    throw std::runtime_error("IBL: unsupported environment format");
+
+  const PixelConverter converter{srcFormat, dstFormat};
+  const u64 texelCount = toU64(image.size[0]) * image.size[1];
+
+  Arr<Arr<f32>> ret;
+  for(u32 layer = 0u; layer < image.layers; ++layer) {
+    Arr<f32>   texels(texelCount * 4u);
+    const auto src = Span<u8 const>{image.texels}.subspan(
+      getMipOffset(image, 0u, layer), getMipSize(image, 0u));
+
+    converter.Convert(
+      {reinterpret_cast<u8*>(texels.data()), texelCount * 16u}, 0u, src,
+      0u, image.size);
+
+    // Environments are opaque, whatever alpha the file carries.
+    for(u64 idx = 0u; idx < texelCount; ++idx)
+      texels[idx * 4u + 3u] = 1.0f;
+
+    ret.push_back(std::move(texels));
+  }
+
+  return ret;
+}
+
+// Bilinear sample of a panorama, wrapping around horizontally.
+static void IblSamplePanorama(
+  f32* dst, const Arr<f32>& texels, UInt2 size, const Float3& dir)
+{
+  const f32 u =
+    0.5f + std::atan2(dir[0], -dir[2]) / (2.0f * IblPi);
+  const f32 v = std::acos(std::clamp(dir[1], -1.0f, 1.0f)) / IblPi;
+
+  const f32 fx = u * toF32(size[0]) - 0.5f;
+  const f32 fy = v * toF32(size[1]) - 0.5f;
+  const f32 x0 = std::floor(fx);
+  const f32 y0 = std::floor(fy);
+  const f32 tx = fx - x0;
+  const f32 ty = fy - y0;
+
+  const i64  width  = size[0];
+  const auto wrap   = [&](i64 x) {
+    return toU64((x % width + width) % width);
+  };
+  const auto clampY = [&](i64 y) {
+    return toU64(std::clamp<i64>(y, 0, toI64(size[1]) - 1));
+  };
+
+  const u64 xs[] = {wrap(toI64(x0)), wrap(toI64(x0) + 1)};
+  const u64 ys[] = {clampY(toI64(y0)), clampY(toI64(y0) + 1)};
+
+  const f32 weights[] = {
+    (1.0f - tx) * (1.0f - ty), tx * (1.0f - ty), (1.0f - tx) * ty,
+    tx * ty};
+
+  for(u32 channel = 0u; channel < 4u; ++channel) {
+    f32 sum = 0.0f;
+    for(u32 idx = 0u; idx < 4u; ++idx)
+      sum += texels[(ys[idx / 2u] * size[0] + xs[idx % 2u]) * 4u +
+                    channel] *
+             weights[idx];
+    dst[channel] = sum;
+  }
+}
+
+// The environment as a cube with the whole mip chain.
+static IblCube MakeIblSource(const data::Image& image, u32 threadCount)
+{
+  const bool isCube =
+    image.layers == 6u && image.size[0] == image.size[1];
+  if(!isCube && image.layers != 1u)
+    throw std::runtime_error("IBL: unsupported environment layout");
+
+  auto layers = GetIblLayers(image);
+
+  const u32 faceSize = isCube ? image.size[0] : image.size[0] / 4u;
+  const u32 size =
+    std::bit_floor(std::clamp(faceSize, 1u, IblMaxSourceSize));
+
+  auto cube = MakeIblCube(size, getMipCount(size, size));
+
+  if(isCube && size == image.size[0]) {
+    for(u32 face = 0u; face < 6u; ++face)
+      std::copy(
+        layers[face].begin(), layers[face].end(),
+        cube.GetFace(0u, face));
+  } else {
+    IblCube faces;
+    if(isCube) {
+      faces = MakeIblCube(image.size[0], 1u);
+      for(u32 face = 0u; face < 6u; ++face)
+        std::copy(
+          layers[face].begin(), layers[face].end(),
+          faces.GetFace(0u, face));
+    }
+
+    const auto jobs = GetIblJobs(size, 1u);
+    runJobs(jobs.size(), threadCount, [&](u64 idx) {
+      const auto& job = jobs[idx];
+      f32* dst =
+        cube.GetFace(0u, job.face) + toU64(job.row) * size * 4u;
+
+      for(u32 x = 0u; x < size; ++x, dst += 4u) {
+        const auto dir = IblTexelDirection(job.face, x, job.row, size);
+        if(!isCube) {
+          IblSamplePanorama(dst, layers[0], image.size, dir);
+          continue;
+        }
+
+        u32 face = 0u;
+        f32 u = 0.0f, v = 0.0f;
+        IblProject(dir[0], dir[1], dir[2], face, u, v);
+
+        std::fill_n(dst, 4u, 0.0f);
+        IblAddTaps(dst, IblGetTaps(faces, 0u, face, u, v, 1.0f));
+      }
+    });
+  }
+
+  // Box filtered chain, faces are powers of two.
+  for(u32 mip = 1u; mip < cube.mips; ++mip) {
+    const u32 dstSize = cube.GetSize(mip);
+    const u32 srcSize = cube.GetSize(mip - 1u);
+
+    for(u32 face = 0u; face < 6u; ++face) {
+      const f32* src = cube.GetFace(mip - 1u, face);
+      f32*       dst = cube.GetFace(mip, face);
+
+      for(u32 y = 0u; y < dstSize; ++y) {
+        for(u32 x = 0u; x < dstSize; ++x) {
+          const f32* row0 =
+            src + (toU64(2u * y) * srcSize + 2u * x) * 4u;
+          const f32* row1 = row0 + toU64(srcSize) * 4u;
+
+          for(u32 channel = 0u; channel < 4u; ++channel)
+            dst[(toU64(y) * dstSize + x) * 4u + channel] =
+              (row0[channel] + row0[channel + 4u] + row1[channel] +
+               row1[channel + 4u]) *
+              0.25f;
+        }
+      }
+    }
+  }
+
+  return cube;
+}
+
+// Real spherical harmonics up to order 2.
+static void IblShBasis(const Float3& d, f32* sh)
+{
+  sh[0] = 0.282095f;
+  sh[1] = 0.488603f * d[1];
+  sh[2] = 0.488603f * d[2];
+  sh[3] = 0.488603f * d[0];
+  sh[4] = 1.092548f * d[0] * d[1];
+  sh[5] = 1.092548f * d[1] * d[2];
+  sh[6] = 0.315392f * (3.0f * d[2] * d[2] - 1.0f);
+  sh[7] = 1.092548f * d[0] * d[2];
+  sh[8] = 0.546274f * (d[0] * d[0] - d[1] * d[1]);
+}
+
+using IblSh = SArr<f32, 27>;
+
+// Radiance harmonics, each texel weighted by the solid angle it covers.
+static IblSh IblProjectSh(const IblCube& source, u32 threadCount)
+{
+  u32 mip = 0u;
+  while(source.GetSize(mip) > IblShSourceSize) ++mip;
+  const u32 size = source.GetSize(mip);
+
+  // Partial sums for each face, added in order.
+  SArr<IblSh, 6> faceSh     = {};
+  SArr<f32, 6>   faceWeight = {};
+
+  runJobs(6u, threadCount, [&](u64 face) {
+    const f32* texels = source.GetFace(mip, toU32(face));
+
+    for(u32 y = 0u; y < size; ++y) {
+      for(u32 x = 0u; x < size; ++x, texels += 4u) {
+        const f32 u = (toF32(x) + 0.5f) / toF32(size) * 2.0f - 1.0f;
+        const f32 v = (toF32(y) + 0.5f) / toF32(size) * 2.0f - 1.0f;
+
+        const f32 r2     = 1.0f + u * u + v * v;
+        const f32 weight = 1.0f / (r2 * std::sqrt(r2));
+
+        f32 sh[9];
+        IblShBasis(mt::Norm(IblFaceDirection(toU32(face), u, v)), sh);
+
+        for(u32 idx = 0u; idx < 9u; ++idx)
+          for(u32 channel = 0u; channel < 3u; ++channel)
+            faceSh[face][idx * 3u + channel] +=
+              texels[channel] * sh[idx] * weight;
+        faceWeight[face] += weight;
+      }
+    }
+  });
+
+  IblSh ret       = {};
+  f32   weightSum = 0.0f;
+  for(u32 face = 0u; face < 6u; ++face) {
+    for(u32 idx = 0u; idx < ret.size(); ++idx)
+      ret[idx] += faceSh[face][idx];
+    weightSum += faceWeight[face];
+  }
+
+  for(auto& value: ret) value *= 4.0f * IblPi / weightSum;
+  return ret;
+}
+
+// Irradiance from the harmonics, convolved with the clamped cosine.
+static void IblEvaluateSh(f32* dst, const IblSh& sh, const Float3& n)
+{
+  static constexpr f32 Band[] = {
+    IblPi, 2.0f * IblPi / 3.0f, 2.0f * IblPi / 3.0f,
+    2.0f * IblPi / 3.0f, IblPi / 4.0f, IblPi / 4.0f,
+    IblPi / 4.0f, IblPi / 4.0f, IblPi / 4.0f};
+
+  f32 basis[9];
+  IblShBasis(n, basis);
+
+  for(u32 channel = 0u; channel < 3u; ++channel) {
+    f32 sum = 0.0f;
+    for(u32 idx = 0u; idx < 9u; ++idx)
+      sum += Band[idx] * sh[idx * 3u + channel] * basis[idx];
+    dst[channel] = std::max(sum / IblPi, 0.0f);
+  }
+  dst[3] = 1.0f;
+}
+
+// Split-sum scale and bias of F0 for a view angle and roughness, with
+// the Smith visibility using k = alpha / 2.
+static Float2 IblIntegrateBrdf(f32 nDotV, f32 roughness)
+{
+  const Float3 view = {std::sqrt(1.0f - nDotV * nDotV), 0.0f, nDotV};
+
+  const f32 alpha = roughness * roughness;
+  const f32 k     = alpha / 2.0f;
+
+  const auto g1 = [&](f32 v) { return v / (v * (1.0f - k) + k); };
+
+  f32 scale = 0.0f, bias = 0.0f;
+  for(u32 idx = 0u; idx < IblBrdfSampleCount; ++idx) {
+    const auto h =
+      IblSampleGgx(IblHammersley(idx, IblBrdfSampleCount), alpha);
+
+    const f32 vDotH = mt::Dot(view, h);
+    const f32 nDotL = 2.0f * vDotH * h[2] - view[2];
+    if(nDotL <= 0.0f) continue;
+
+    const f32 nDotH = std::max(h[2], 0.0f);
+    const f32 vis   = g1(nDotV) * g1(nDotL) * std::max(vDotH, 0.0f) /
+                    (nDotH * nDotV);
+    const f32 fc = std::pow(1.0f - std::max(vDotH, 0.0f), 5.0f);
+
+    scale += (1.0f - fc) * vis;
+    bias  += fc * vis;
+  }
+
+  const f32 count = toF32(IblBrdfSampleCount);
+  return {scale / count, bias / count};
+}
+
+static data::Image
+MakeIblImage(Format format, u32 size, u32 mips, u32 layers)
+{
+  data::Image image;
+  image.format = format;
+  image.size   = {size, size};
+  image.mips   = mips;
+  image.layers = layers;
+  image.texels.resize(getImageSize(image));
+  return image;
+}
+
+static void
+IblStoreRow(data::Image& image, const IblJob& job, const Arr<f32>& row)
+{
+  const u32 width = getMipExtent(image.size[0], job.mip);
+  const u64 offset =
+    getMipOffset(image, job.mip, job.face) +
+    job.row * getFormatRowSize(image.format, width);
+
+  convertFloat32ToFloat16(
+    {reinterpret_cast<u16*>(image.texels.data() + offset), row.size()},
+    row);
+}
+
+IblBaker::Result
+IblBaker::Bake(const data::Image& environment, const Options& options)
+{
+  if(isBlockFormat(environment.format))
+    throw std::runtime_error("IBL: unsupported environment format");
+  if(
+    options.irradianceSize == 0u || options.specularSize == 0u ||
+    options.brdfSize == 0u || options.sampleCount == 0u)
+    throw std::runtime_error("IBL: bad options");
+
+  const u32 threadCount =
+    options.threadCount
+      ? options.threadCount
+      : std::max(1u, std::thread::hardware_concurrency());
+
+  const auto source = MakeIblSource(environment, threadCount);
+
+  Result ret;
+
+  // Specular, every mip of every face in one go so the threads stay
+  // busy down to the smallest levels.
+  {
+    const u32 size = options.specularSize;
+    const u32 mips = std::clamp(
+      options.specularMips, 1u, getMipCount(size, size));
+
+    ret.specular =
+      MakeIblImage(Format::R16G16B16A16_SFLOAT, size, mips, 6u);
+
+    Arr<IblSamples> samples;
+    for(u32 mip = 0u; mip < mips; ++mip) {
+      const f32 roughness =
+        mips > 1u ? toF32(mip) / toF32(mips - 1u) : 0.0f;
+      const f32 baseLod = std::log2(
+        toF32(source.size) / toF32(getMipExtent(size, mip)));
+      samples.push_back(MakeIblSamples(
+        roughness, options.sampleCount, baseLod, source));
+    }
+
+    static const IblFilterFn filter = GetIblFilterFn();
+
+    const auto jobs = GetIblJobs(size, mips);
+    runJobs(jobs.size(), threadCount, [&](u64 idx) {
+      const auto& job   = jobs[idx];
+      const u32   width = getMipExtent(size, job.mip);
+
+      Arr<f32> row(toU64(width) * 4u);
+      for(u32 x = 0u; x < width; ++x)
+        filter(
+          row.data() + x * 4u, source, samples[job.mip],
+          MakeIblFrame(IblTexelDirection(job.face, x, job.row, width)));
+
+      IblStoreRow(ret.specular, job, row);
+    });
+  }
+
+  // Irradiance.
+  {
+    const u32  size = options.irradianceSize;
+    const auto sh   = IblProjectSh(source, threadCount);
+
+    ret.irradiance =
+      MakeIblImage(Format::R16G16B16A16_SFLOAT, size, 1u, 6u);
+
+    const auto jobs = GetIblJobs(size, 1u);
+    runJobs(jobs.size(), threadCount, [&](u64 idx) {
+      const auto& job = jobs[idx];
+
+      Arr<f32> row(toU64(size) * 4u);
+      for(u32 x = 0u; x < size; ++x)
+        IblEvaluateSh(
+          row.data() + x * 4u, sh,
+          IblTexelDirection(job.face, x, job.row, size));
+
+      IblStoreRow(ret.irradiance, job, row);
+    });
+  }
+
+  // BRDF lookup table.
+  {
+    const u32 size = options.brdfSize;
+
+    ret.brdf = MakeIblImage(Format::R16G16_SFLOAT, size, 1u, 1u);
+
+    runJobs(size, threadCount, [&](u64 y) {
+      const f32 roughness = (toF32(y) + 0.5f) / toF32(size);
+
+      Arr<f32> row(toU64(size) * 2u);
+      for(u32 x = 0u; x < size; ++x) {
+        const f32 nDotV = (toF32(x) + 0.5f) / toF32(size);
+        const auto brdf = IblIntegrateBrdf(nDotV, roughness);
+        row[x * 2u]      = brdf[0];
+        row[x * 2u + 1u] = brdf[1];
+      }
+
+      IblStoreRow(ret.brdf, {0u, 0u, toU32(y)}, row);
+    });
+  }
+
+  return ret;
+}
+
+// Cooked files start with the magic, the version, the hash of the
+// environment file and the options, then the three images. A hash of
+// everything before it closes the file.
+
+template<typename T>
+static void IblWrite(ByteOStream& dst, T value)
+{
+  u8 bytes[sizeof(T)];
+  memcpy(bytes, &value, sizeof(T));
+  dst.Write(bytes);
+}
+
+template<typename T>
+static bool IblRead(ByteIStream& src, T& value)
+{
+  if(src.GetSizeLeft() < sizeof(T)) return false;
+  memcpy(&value, src.ReadBytes(sizeof(T)).data(), sizeof(T));
+  return true;
+}
+
+static SArr<u32, 5>
+GetIblCookedOptions(const IblBaker::Options& options)
+{
+  return {
+    options.irradianceSize, options.specularSize, options.specularMips,
+    options.sampleCount, options.brdfSize};
+}
+
+static Arr<u8> WriteIblCooked(
+  const IblBaker::Result& result, const Hash128& source,
+  const IblBaker::Options& options)
+{
+  ByteOStream dst(
+    result.irradiance.texels.size() + result.specular.texels.size() +
+    result.brdf.texels.size() + 256u);
+
+  IblWrite(dst, IblCookedMagic);
+  IblWrite(dst, IblCookedVersion);
+  IblWrite(dst, source.lo);
+  IblWrite(dst, source.hi);
+  for(u32 value: GetIblCookedOptions(options)) IblWrite(dst, value);
+
+  for(const auto* image:
+      {&result.irradiance, &result.specular, &result.brdf}) {
+    IblWrite(dst, toU32(enumValue(image->format)));
+    IblWrite(dst, image->size[0]);
+    IblWrite(dst, image->size[1]);
+    IblWrite(dst, image->mips);
+    IblWrite(dst, image->layers);
+    IblWrite(dst, toU64(image->texels.size()));
+    dst.Write(image->texels);
+  }
+
+  const auto hash = xxh128(dst.data());
+  IblWrite(dst, hash.lo);
+  IblWrite(dst, hash.hi);
+
+  return std::move(dst.data());
+}
+
+// Empty when the file is damaged or was baked from something else.
+static Opt<IblBaker::Result> ReadIblCooked(
+  Span<u8 const> src, const Hash128& source,
+  const IblBaker::Options& options)
+{
+  if(src.size() < sizeof(Hash128)) return {};
+
+  const auto body = src.first(src.size() - sizeof(Hash128));
+
+  Hash128 hash;
+  ByteIStream footer(src.last(sizeof(Hash128)));
+  if(!IblRead(footer, hash.lo) || !IblRead(footer, hash.hi)) return {};
+  if(!(xxh128(body) == hash)) return {};
+
+  ByteIStream stream(body);
+
+  u32     magic = 0u, version = 0u;
+  Hash128 cookedSource;
+  if(
+    !IblRead(stream, magic) || !IblRead(stream, version) ||
+    !IblRead(stream, cookedSource.lo) ||
+    !IblRead(stream, cookedSource.hi))
+    return {};
+  if(
+    magic != IblCookedMagic || version != IblCookedVersion ||
+    !(cookedSource == source))
+    return {};
+
+  for(u32 expected: GetIblCookedOptions(options)) {
+    u32 value = 0u;
+    if(!IblRead(stream, value) || value != expected) return {};
+  }
+
+  IblBaker::Result ret;
+  for(auto* image: {&ret.irradiance, &ret.specular, &ret.brdf}) {
+    u32 format = 0u;
+    u64 size   = 0u;
+    if(
+      !IblRead(stream, format) || !IblRead(stream, image->size[0]) ||
+      !IblRead(stream, image->size[1]) ||
+      !IblRead(stream, image->mips) ||
+      !IblRead(stream, image->layers) ||
+      !IblRead(stream, size))
+      return {};
+
+    image->format = static_cast<Format>(format);
+    if(size != getImageSize(*image) || stream.GetSizeLeft() < size)
+      return {};
+
+    const auto texels = stream.ReadBytes(size);
+    image->texels.assign(texels.begin(), texels.end());
+  }
+
+  return ret;
+}
+
+IblBaker::Result IblBaker::Bake(
+  const fs::path& environment, const fs::path& cooked,
+  const Options& options)
+{
+  const auto bytes = getBytes(environment);
+  if(bytes.empty())
+    throw makeError<std::runtime_error>(
+      "IBL: cannot access file %s", environment.u8string().c_str());
+
+  const auto source = xxh128(bytes);
+
+  if(auto result = ReadIblCooked(getBytes(cooked), source, options))
+    return std::move(*result);
+
+  DataReader reader;
+  const auto image = reader.ReadImage(
+    Span<u8 const>{bytes},
+    {.uri         = pathToStr(environment),
+     .threadCount = options.threadCount});
+
+  auto result = Bake(image, options);
+
+  // Written aside and renamed over the cooked file, so a crash never
+  // leaves a partial one. Failing to write only costs another bake.
+  const auto data = WriteIblCooked(result, source, options);
+  auto       temp = cooked;
+  temp += ".tmp";
+
+  std::ofstream dst(temp, std::ios::binary);
+  dst.write(
+    reinterpret_cast<const char*>(data.data()),
+    static_cast<std::streamsize>(data.size()));
+  dst.close();
+
+  std::error_code error;
+  if(dst) fs::rename(temp, cooked, error);
+  if(!dst || error) {
+    fs::remove(temp, error);
+    VDLogW("IBL: cannot write %s", cooked.u8string().c_str());
+  }
+
+  return result;
+}
@@ -0,0 +1,592 @@
+#include "api/Inflate.hpp"
+
+using namespace vd;
+
+static constexpr u8 DeflateHCLENMap[] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static constexpr u8 DeflateExtraLengthBits[] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+static constexpr u32 DeflateExtraLengthValue[] = {
+  3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+
+static constexpr u8 DeflateExtraDistanceBits[] = {
+  0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+  6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static constexpr u32 DeflateExtraDistanceValue[] = {
+  1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+  33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+  1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+
+// Huffman decode table entry layout:
+//   [ 0.. 7] bits consumed by the entry (code length + extra bits)
+//   [ 8..11] code length, the extra bits follow the code
+//   [12..15] flags
+//   [16..31] literal, length/distance base or subtable offset
+static constexpr u32 HuffmanLiteral    = 1u << 12;
+static constexpr u32 HuffmanEndOfBlock = 1u << 13;
+static constexpr u32 HuffmanSubtable   = 1u << 14;
+static constexpr u32 HuffmanInvalid    = 1u << 15;
+
+static constexpr auto DeflateLiteralLengthEntries = [] {
+  SArr<u32, 288> ret{};
+  for(u32 symbol = 0u; symbol < 256u; ++symbol)
+    ret[symbol] = HuffmanLiteral | (symbol << 16);
+  ret[256] = HuffmanEndOfBlock;
+  for(u32 idx = 0u; idx < std::size(DeflateExtraLengthValue); ++idx)
+    ret[257u + idx] = (DeflateExtraLengthValue[idx] << 16) |
+                      DeflateExtraLengthBits[idx];
+  ret[286] = HuffmanInvalid;
+  ret[287] = HuffmanInvalid;
+  return ret;
+}();
+
+static constexpr auto DeflateDistanceEntries = [] {
+  SArr<u32, 32> ret{};
+  for(u32 idx = 0u; idx < std::size(DeflateExtraDistanceValue); ++idx)
+    ret[idx] = (DeflateExtraDistanceValue[idx] << 16) |
+               DeflateExtraDistanceBits[idx];
+  ret[30] = HuffmanInvalid;
+  ret[31] = HuffmanInvalid;
+  return ret;
+}();
+
+static constexpr auto DeflateCodeLengthEntries = [] {
+  SArr<u32, std::size(DeflateHCLENMap)> ret{};
+  for(u32 symbol = 0u; symbol < std::size(ret); ++symbol)
+    ret[symbol] = symbol << 16;
+  return ret;
+}();
+
+// Two-level canonical Huffman table. Codes up to tableBits long are
+// resolved with a single lookup, longer ones through a subtable.
+// Length and distance entries also carry their base value and extra
+// bit count, so a symbol is fully decoded with one lookup.
+class HuffmanTable
+{
+public:
+  HuffmanTable(u32 tableBits, u32 capacity):
+    m_entries(capacity), m_tableBits{tableBits}
+  {
+    if(tableBits >= MaxBits || (1u << tableBits) > capacity)
+      throw std::runtime_error("Huffman table: size is too big");
+  }
+
+  HuffmanTable(
+    u32 tableBits, u32 capacity, Span<u8 const> symbolLengths,
+    Span<u32 const> symbolEntries):
+    HuffmanTable(tableBits, capacity)
+  {
+    Initialize(symbolLengths, symbolEntries);
+  }
+
+  void Initialize(
+    Span<u8 const> symbolLengths, Span<u32 const> symbolEntries)
+  {
+    if(symbolLengths.size() > symbolEntries.size())
+      throw std::runtime_error("Huffman table: too many symbols");
+
+    u32 lengthCounts[MaxBits] = {};
+    for(auto length: symbolLengths) {
+      if(length >= MaxBits)
+        throw std::runtime_error(
+          "Huffman table: invalid symbol lengths");
+      ++lengthCounts[length];
+    }
+    lengthCounts[0] = 0u;
+
+    // Incomplete codes are allowed, over-subscribed ones are not.
+    i32 codesLeft = 1;
+    for(u32 length = 1u; length < MaxBits; ++length) {
+      codesLeft = (codesLeft << 1) - toI32(lengthCounts[length]);
+      if(codesLeft < 0)
+        throw std::runtime_error("Huffman table: over-subscribed code");
+    }
+
+    // Sort the symbols by code length, keeping the symbol order.
+    u32 offsets[MaxBits]  = {};
+    u32 nextCode[MaxBits] = {};
+    for(u32 length = 1u; length + 1u < MaxBits; ++length) {
+      offsets[length + 1u] = offsets[length] + lengthCounts[length];
+      nextCode[length + 1u] =
+        (nextCode[length] + lengthCounts[length]) << 1;
+    }
+
+    u32 symbolCount =
+      offsets[MaxBits - 1u] + lengthCounts[MaxBits - 1u];
+    u16 sortedSymbols[288] = {};
+    for(u32 symbol = 0u; symbol < symbolLengths.size(); ++symbol) {
+      if(symbolLengths[symbol] > 0u)
+        sortedSymbols[offsets[symbolLengths[symbol]]++] = toU16(symbol);
+    }
+
+    const u32 primarySize = 1u << m_tableBits;
+    std::fill_n(m_entries.begin(), primarySize, HuffmanInvalid);
+
+    u32 tableEnd     = primarySize;
+    u32 subtableIdx  = MaxU32;
+    u32 subtableBits = 0u;
+
+    for(u32 sortedIdx = 0u; sortedIdx < symbolCount; ++sortedIdx) {
+      auto symbol = sortedSymbols[sortedIdx];
+      auto length = symbolLengths[symbol];
+      auto code   = nextCode[length]++;
+      auto entry  = symbolEntries[symbol] + length + (length << 8);
+
+      if(length <= m_tableBits) {
+        for(u32 idx = bitReverse(code, length); idx < primarySize;
+            idx += 1u << length)
+          m_entries[idx] = entry;
+        continue;
+      }
+
+      u32 subLength = length - m_tableBits;
+      u32 prefix    = bitReverse(code >> subLength, m_tableBits);
+
+      if(prefix != subtableIdx) {
+        // Grow the subtable until it can hold all the remaining codes
+        // sharing this prefix.
+        subtableIdx  = prefix;
+        subtableBits = subLength;
+
+        i32 left = 1 << subtableBits;
+        for(u32 len = length; len + 1u < MaxBits; ++len) {
+          left -= toI32(lengthCounts[len]);
+          if(left <= 0) break;
+          ++subtableBits;
+          left <<= 1;
+        }
+
+        if(tableEnd + (1u << subtableBits) > m_entries.size())
+          throw std::runtime_error("Huffman table: out of space");
+
+        m_entries[prefix] =
+          HuffmanSubtable | (subtableBits << 8) | (tableEnd << 16);
+        std::fill_n(
+          m_entries.begin() + tableEnd, 1u << subtableBits,
+          HuffmanInvalid);
+        tableEnd += 1u << subtableBits;
+      }
+
+      u32 subtableStart = m_entries[prefix] >> 16;
+      u32 subCode       = code & ((1u << subLength) - 1u);
+      for(u32 idx = bitReverse(subCode, subLength);
+          idx < (1u << subtableBits); idx += 1u << subLength)
+        m_entries[subtableStart + idx] = entry;
+
+      --lengthCounts[length];
+    }
+  }
+
+  // Returns the entry for the code at the start of bits.
+  u32 Lookup(u64 bits) const
+  {
+    auto entry = m_entries[bits & ((1u << m_tableBits) - 1u)];
+    if(entry & HuffmanSubtable) {
+      auto subtableBits = (entry >> 8) & 0xfu;
+      auto subIdx =
+        (bits >> m_tableBits) & ((1u << subtableBits) - 1u);
+      entry = m_entries[(entry >> 16) + subIdx];
+    }
+    return entry;
+  }
+
+  u32 Decode(BitIStream& src) const
+  {
+    auto entry = Lookup(src.Peek(MaxBits - 1u));
+    if(entry & HuffmanInvalid)
+      throw std::runtime_error("Huffman table: invalid code");
+
+    src.Skip(entry & 0xffu);
+    return entry >> 16;
+  }
+
+  template<typename T>
+  T Decode(BitIStream& src) const
+  {
+    return static_cast<T>(Decode(src));
+  }
+
+  static u32 GetCodeLength(u32 entry) { return (entry >> 8) & 0xfu; }
+
+  static u32 GetExtraBits(u64 bits, u32 entry)
+  {
+    auto codeLength = GetCodeLength(entry);
+    auto extraCount = (entry & 0xffu) - codeLength;
+    return toU32((bits >> codeLength) & ((1ull << extraCount) - 1u));
+  }
+
+private:
+  static constexpr u32 MaxBits = 16u;
+
+private:
+  std::vector<u32> m_entries;
+  u32              m_tableBits;
+};
+
+static constexpr u32 DeflateLiteralLengthTableBits = 10u;
+static constexpr u32 DeflateLiteralLengthTableSize = 2048u;
+static constexpr u32 DeflateDistanceTableBits      = 8u;
+static constexpr u32 DeflateDistanceTableSize      = 512u;
+
+static constexpr u32 DeflateMaxMatchLength = 258u;
+static constexpr u32 DeflateCopySlack      = 32u;
+static constexpr u64 DeflateWindowSize     = 32_KiB;
+static constexpr u64 InflateBufferSize     = 256_KiB;
+
+// Inflate output buffer. Only the last 32KB of data are kept for
+// back-references, everything before is passed to the sink when the
+// buffer is full. Memory use doesn't depend on the size of the data.
+// Match copies may write up to DeflateCopySlack bytes past the end of
+// the match, the buffer always keeps that much room.
+class InflateOutput
+{
+public:
+  InflateOutput(const InflateSink& sink):
+    m_data(InflateBufferSize), m_size{0u}, m_flushed{0u}, m_sink{sink}
+  {}
+
+  // Returns the write cursor, with room for at least count bytes.
+  u8* Reserve(u64 count)
+  {
+    if(m_size + count + DeflateCopySlack > m_data.size()) slide();
+    return m_data.data() + m_size;
+  }
+
+  void Advance(u64 count) { m_size += count; }
+
+  void Write(Span<u8 const> bytes)
+  {
+    while(!bytes.empty()) {
+      auto count = std::min<u64>(bytes.size(), DeflateWindowSize);
+      memcpy(Reserve(count), bytes.data(), count);
+      Advance(count);
+      bytes = bytes.subspan(count);
+    }
+  }
+
+  // Bytes available for back-references.
+  u64 GetSize() const { return m_size; }
+
+  void Flush()
+  {
+    if(m_size > m_flushed)
+      m_sink({m_data.data() + m_flushed, m_size - m_flushed});
+    m_flushed = m_size;
+  }
+
+private:
+  void slide()
+  {
+    Flush();
+
+    auto keep = std::min(m_size, DeflateWindowSize);
+    memmove(m_data.data(), m_data.data() + m_size - keep, keep);
+    m_size    = keep;
+    m_flushed = keep;
+  }
+
+private:
+  Arr<u8>            m_data;
+  u64                m_size;
+  u64                m_flushed;
+  const InflateSink& m_sink;
+};
+
+// Copies a back-reference in wide chunks, writing past the end of the
+// match. Chunks never read bytes they are writing, so distances shorter
+// than a chunk repeat an 8-byte pattern instead.
+static inline void InflateCopyMatch(u8* dst, u32 distance, u32 length)
+{
+  const u8* src = dst - distance;
+  const u8* end = dst + length;
+
+  if(distance >= 32u) {
+    do {
+      memcpy(dst, src, 32u);
+      dst += 32u;
+      src += 32u;
+    } while(dst < end);
+  } else if(distance >= 16u) {
+    do {
+      memcpy(dst, src, 16u);
+      dst += 16u;
+      src += 16u;
+    } while(dst < end);
+  } else if(distance >= 8u) {
+    do {
+      memcpy(dst, src, 8u);
+      dst += 8u;
+      src += 8u;
+    } while(dst < end);
+  } else {
+    // The step is a multiple of the distance, so the pattern stays in
+    // phase. Distance 1 runs are a plain byte broadcast.
+    u8 pattern[8];
+    for(u32 idx = 0u; idx < 8u; ++idx)
+      pattern[idx] = src[idx % distance];
+
+    u32 step = 8u - 8u % distance;
+    do {
+      memcpy(dst, pattern, 8u);
+      dst += step;
+    } while(dst < end);
+  }
+}
+
+// Decodes one symbol, returns false at the end of the block.
+// The bit buffer must hold at least 48 bits, enough for the longest
+// length and distance pair. Unguarded decoding skips the end of data
+// checks, so it must only be used when the input is not about to end.
+template<bool Guarded>
+static inline bool InflateSymbol(
+  BitIStream& inBits, const HuffmanTable& literalLengthTable,
+  const HuffmanTable& distanceTable, InflateOutput& output)
+{
+  const auto consume = [&](u32 count) {
+    if constexpr(Guarded) inBits.Skip(count);
+    else
+      inBits.Consume(count);
+  };
+
+  u8* dst = output.Reserve(DeflateMaxMatchLength);
+
+  u64 bits  = inBits.PeekBuffer();
+  u32 entry = literalLengthTable.Lookup(bits);
+
+  if(entry & HuffmanLiteral) {
+    consume(entry & 0xffu);
+    *dst = toU8(entry >> 16);
+    output.Advance(1u);
+    return true;
+  }
+
+  if(entry & (HuffmanEndOfBlock | HuffmanInvalid)) {
+    if(entry & HuffmanInvalid)
+      throw std::runtime_error("Deflate: invalid literal/length code");
+    consume(entry & 0xffu);
+    return false;
+  }
+
+  u32 length = (entry >> 16) + HuffmanTable::GetExtraBits(bits, entry);
+  consume(entry & 0xffu);
+
+  bits  = inBits.PeekBuffer();
+  entry = distanceTable.Lookup(bits);
+  if(entry & HuffmanInvalid)
+    throw std::runtime_error("Deflate: invalid distance code");
+
+  u32 distance =
+    (entry >> 16) + HuffmanTable::GetExtraBits(bits, entry);
+  consume(entry & 0xffu);
+
+  if(output.GetSize() < distance)
+    throw std::runtime_error(
+      "Deflate: out of bounds lookback distance");
+
+  InflateCopyMatch(dst, distance, length);
+  output.Advance(length);
+
+  return true;
+}
+
+static void InflateBlock(
+  BitIStream& inBits, const HuffmanTable& literalLengthTable,
+  const HuffmanTable& distanceTable, InflateOutput& output)
+{
+  for(;;) {
+    // Fast loop, the input can't run out while 8 bytes are left.
+    while(inBits.GetBytesLeft() >= 8u) {
+      inBits.RefillFast();
+      if(!InflateSymbol<false>(
+           inBits, literalLengthTable, distanceTable, output))
+        return;
+    }
+
+    // Near the end of a chunk, until the next one is reached.
+    inBits.Refill();
+    if(!InflateSymbol<true>(
+         inBits, literalLengthTable, distanceTable, output))
+      return;
+  }
+}
+
+static const HuffmanTable& GetFixedLiteralLengthTable()
+{
+  static const HuffmanTable table = [] {
+    SArr<u8, 288> lengths = {};
+    std::fill(lengths.begin(), lengths.begin() + 144, toU8(8u));
+    std::fill(lengths.begin() + 144, lengths.begin() + 256, toU8(9u));
+    std::fill(lengths.begin() + 256, lengths.begin() + 280, toU8(7u));
+    std::fill(lengths.begin() + 280, lengths.end(), toU8(8u));
+
+    return HuffmanTable(
+      DeflateLiteralLengthTableBits, DeflateLiteralLengthTableSize,
+      lengths, DeflateLiteralLengthEntries);
+  }();
+  return table;
+}
+
+static const HuffmanTable& GetFixedDistanceTable()
+{
+  static const HuffmanTable table = [] {
+    SArr<u8, 32> lengths = {};
+    std::fill(lengths.begin(), lengths.end(), toU8(5u));
+
+    return HuffmanTable(
+      DeflateDistanceTableBits, DeflateDistanceTableSize, lengths,
+      DeflateDistanceEntries);
+  }();
+  return table;
+}
+
+void vd::ZLibReadHeader(BitIStream& inBits)
+{
+  u8 CMF = inBits.Read<u8>(8u);
+  u8 FLG = inBits.Read<u8>(8u);
+
+  u8 compressionMethod = CMF & 0xf;
+  // u8 compressionInfo   = CMF >> 4;
+  // u8 checkBits         = FLG & 0x1f;
+  u8 presetDictionary = (FLG >> 5) & 0x1;
+  // u8 compressionLevel  = FLG >> 6;
+
+  if(compressionMethod != 8u || presetDictionary != 0u)
+    throw std::runtime_error("Deflate: unsopported settings");
+}
+
+void vd::Inflate(
+  BitIStream& inBits, const InflateSink& sink, bool isSegment)
+{
+  InflateOutput output(sink);
+
+  HuffmanTable literalLengthTable(
+    DeflateLiteralLengthTableBits, DeflateLiteralLengthTableSize);
+  HuffmanTable distanceTable(
+    DeflateDistanceTableBits, DeflateDistanceTableSize);
+  HuffmanTable lengthTable(7u, 1u << 7u);
+
+  // Deflate
+  for(;;) {
+    u32 BFINAL = inBits.Read(1);
+    u32 BTYPE  = inBits.Read(2);
+
+    if(BTYPE == 0u) // Literal
+    {
+      inBits.SkipToNextByte();
+      u32 LEN  = inBits.Read(16);
+      u32 NLEN = inBits.Read(16);
+
+      if((LEN ^ NLEN) != 0xffffu)
+        throw std::runtime_error("Deflate: bad block length");
+
+      inBits.ReadBytes(LEN, [&output](Span<u8 const> bytes) {
+        output.Write(bytes);
+      });
+    } else if(BTYPE == 1u) { // Default table
+      InflateBlock(
+        inBits, GetFixedLiteralLengthTable(), GetFixedDistanceTable(),
+        output);
+    } else if(BTYPE == 2u) { // Dynamic table
+      u32 HLIT  = inBits.Read(5) + 257u;
+      u32 HDIST = inBits.Read(5) + 1u;
+      u32 HCLEN = inBits.Read(4) + 4u;
+
+      u8 HCLEN_table[std::size(DeflateHCLENMap)] = {};
+      for(u32 idx = 0u; idx < HCLEN; ++idx)
+        HCLEN_table[DeflateHCLENMap[idx]] =
+          static_cast<u8>(inBits.Read(3u));
+
+      lengthTable.Initialize(HCLEN_table, DeflateCodeLengthEntries);
+
+      std::array<u8, 320u> huffmanBuffer = {};
+
+      u32 lengthIdx   = 0u;
+      u32 lengthCount = HLIT + HDIST;
+
+      while(lengthIdx < lengthCount) {
+        u8 lengthRepeat  = 1u;
+        u8 lengthValue   = 0u;
+        u8 encodedLength = lengthTable.Decode<u8>(inBits);
+
+        if(encodedLength <= 15u) {
+          lengthValue = encodedLength;
+        } else if(encodedLength == 16u) {
+          lengthRepeat = 3u + inBits.Read<u8>(2);
+          if(lengthIdx == 0u)
+            throw std::runtime_error("Deflate: bad encoded length");
+          lengthValue = huffmanBuffer[lengthIdx - 1u];
+        } else if(encodedLength == 17u) {
+          lengthRepeat = 3u + inBits.Read<u8>(3);
+        } else if(encodedLength == 18u) {
+          lengthRepeat = 11u + inBits.Read<u8>(7);
+        } else {
+          throw std::runtime_error("Deflate: bad encoded length");
+        }
+
+        if(lengthIdx + lengthRepeat > lengthCount)
+          throw std::runtime_error("Deflate: bad literal length count");
+
+        for(u32 idx = 0u; idx < lengthRepeat; ++idx) {
+          huffmanBuffer[lengthIdx] = lengthValue;
+          ++lengthIdx;
+        }
+      }
+
+      if(huffmanBuffer[256] == 0u)
+        throw std::runtime_error("Deflate: missing end of block code");
+
+      literalLengthTable.Initialize(
+        {huffmanBuffer.data(), HLIT}, DeflateLiteralLengthEntries);
+      distanceTable.Initialize(
+        {huffmanBuffer.data() + HLIT, HDIST}, DeflateDistanceEntries);
+
+      InflateBlock(inBits, literalLengthTable, distanceTable, output);
+    } else {
+      throw std::runtime_error("Deflate: bad block type");
+    }
+
+    if(BFINAL || (isSegment && !inBits.HasMoreData())) break;
+  }
+
+  output.Flush();
+}
+
+u32 vd::ZLibReadChecksum(BitIStream& inBits)
+{
+  inBits.SkipToNextByte();
+
+  u32 ret = 0u;
+  for(u32 idx = 0u; idx < 4u; ++idx) ret = (ret << 8) | inBits.Read(8u);
+  return ret;
+}
+
+// The checksum is updated as each window is flushed, while it is still
+// in cache.
+void vd::ZLibInflate(
+  Span<const Span<u8 const>> inChunks, const InflateSink& sink,
+  bool verifyChecksum)
+{
+  BitIStream inBits(inChunks);
+  ZLibReadHeader(inBits);
+
+  if(!verifyChecksum) {
+    Inflate(inBits, sink, false);
+    return;
+  }
+
+  u32 adler = 1u;
+  Inflate(
+    inBits,
+    [&](Span<u8 const> bytes) {
+      adler = adler32(bytes, adler);
+      sink(bytes);
+    },
+    false);
+
+  if(ZLibReadChecksum(inBits) != adler)
+    throw std::runtime_error("Deflate: bad Adler-32 checksum");
+}
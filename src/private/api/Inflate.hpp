@@ -0,0 +1,27 @@
+#pragma once
+
+#include "vuldir/core/Core.hpp"
+
+namespace vd {
+
+// Receives the inflated data in order, in pieces of arbitrary size.
+using InflateSink = std::function<void(Span<u8 const>)>;
+
+// Checks the two byte zlib header, only deflate without a preset
+// dictionary is supported.
+void ZLibReadHeader(BitIStream& inBits);
+
+// Inflates raw deflate data. A segment of a stream split by full
+// flushes may also end after any block, with no final block.
+void Inflate(
+  BitIStream& inBits, const InflateSink& sink, bool isSegment);
+
+// Big endian Adler-32 of the inflated data, after the final block.
+u32 ZLibReadChecksum(BitIStream& inBits);
+
+// Inflates a zlib stream split in any number of chunks.
+void ZLibInflate(
+  Span<const Span<u8 const>> inChunks, const InflateSink& sink,
+  bool verifyChecksum);
+
+} // namespace vd
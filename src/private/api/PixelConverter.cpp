@@ -0,0 +1,858 @@
+#include "vuldir/PixelConverter.hpp"
+
+using namespace vd;
+
+// Texels converted per pass, small enough for the intermediate runs to
+// stay in the L1 cache.
+static constexpr u32 PixelChunkSize = 64u;
+
+// How the channel values are stored. Conversions between types go
+// through RGBA floats.
+enum class PixelType : u8 { Unorm8, Srgb8, Unorm16, Float16, Float32 };
+
+static constexpr u32 PixelTypeCount = 5u;
+
+struct PixelInfo {
+  u32       channelCount;
+  u32       channelSize;
+  bool      bgr;
+  PixelType type;
+};
+
+static PixelInfo GetPixelInfo(PixelFormat format)
+{
+  switch(format) {
+    case PixelFormat::R8_UNORM:
+      return {1u, 1u, false, PixelType::Unorm8};
+    case PixelFormat::R8G8B8_UNORM:
+      return {3u, 1u, false, PixelType::Unorm8};
+    case PixelFormat::R8G8B8_SRGB:
+      return {3u, 1u, false, PixelType::Srgb8};
+    case PixelFormat::B8G8R8_UNORM:
+      return {3u, 1u, true, PixelType::Unorm8};
+    case PixelFormat::B8G8R8_SRGB:
+      return {3u, 1u, true, PixelType::Srgb8};
+    case PixelFormat::R8G8B8A8_UNORM:
+      return {4u, 1u, false, PixelType::Unorm8};
+    case PixelFormat::R8G8B8A8_SRGB:
+      return {4u, 1u, false, PixelType::Srgb8};
+    case PixelFormat::B8G8R8A8_UNORM:
+      return {4u, 1u, true, PixelType::Unorm8};
+    case PixelFormat::B8G8R8A8_SRGB:
+      return {4u, 1u, true, PixelType::Srgb8};
+    case PixelFormat::R16_UNORM:
+      return {1u, 2u, false, PixelType::Unorm16};
+    case PixelFormat::R16G16B16A16_UNORM:
+      return {4u, 2u, false, PixelType::Unorm16};
+    case PixelFormat::R16G16B16A16_SFLOAT:
+      return {4u, 2u, false, PixelType::Float16};
+    case PixelFormat::R32G32B32A32_SFLOAT:
+      return {4u, 4u, false, PixelType::Float32};
+    default:
+      throw std::runtime_error("PixelConverter: unsupported format");
+  }
+}
+
+// The RGBA layout each type is converted to and from floats in.
+static PixelFormat GetRgbaFormat(PixelType type)
+{
+  switch(type) {
+    case PixelType::Unorm8: return PixelFormat::R8G8B8A8_UNORM;
+    case PixelType::Srgb8: return PixelFormat::R8G8B8A8_SRGB;
+    case PixelType::Unorm16: return PixelFormat::R16G16B16A16_UNORM;
+    case PixelType::Float16: return PixelFormat::R16G16B16A16_SFLOAT;
+    default: return PixelFormat::R32G32B32A32_SFLOAT;
+  }
+}
+
+PixelFormat vd::getPixelFormat(Format format)
+{
+  switch(format) {
+    case Format::R8_UNORM: return PixelFormat::R8_UNORM;
+    case Format::R8G8B8A8_UNORM: return PixelFormat::R8G8B8A8_UNORM;
+    case Format::R8G8B8A8_SRGB: return PixelFormat::R8G8B8A8_SRGB;
+    case Format::B8G8R8A8_UNORM: return PixelFormat::B8G8R8A8_UNORM;
+    case Format::B8G8R8A8_SRGB: return PixelFormat::B8G8R8A8_SRGB;
+    case Format::R16_UNORM: return PixelFormat::R16_UNORM;
+    case Format::R16G16B16A16_UNORM:
+      return PixelFormat::R16G16B16A16_UNORM;
+    case Format::R16G16B16A16_SFLOAT:
+      return PixelFormat::R16G16B16A16_SFLOAT;
+    case Format::R32G32B32A32_SFLOAT:
+      return PixelFormat::R32G32B32A32_SFLOAT;
+    default: return PixelFormat::UNDEFINED;
+  }
+}
+
+u32 vd::getPixelSize(PixelFormat format)
+{
+  const auto info = GetPixelInfo(format);
+  return info.channelCount * info.channelSize;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Half floats
+
+// Bit exact with F16C, NaNs keep their sign and payload and are quiet.
+static u16 Float32ToFloat16(f32 value)
+{
+  u32 bits = std::bit_cast<u32>(value);
+  u32 sign = (bits >> 16) & 0x8000u;
+  bits &= 0x7fffffffu;
+
+  if(bits >= 0x47800000u) {
+    if(bits <= 0x7f800000u) return toU16(sign | 0x7c00u);
+    return toU16(sign | 0x7e00u | ((bits >> 13) & 0x3ffu));
+  }
+
+  // Small values are rounded by the float addition.
+  if(bits < 0x38800000u) {
+    f32 sum = std::bit_cast<f32>(bits) + 0.5f;
+    return toU16(sign | (std::bit_cast<u32>(sum) - 0x3f000000u));
+  }
+
+  const u32 odd = (bits >> 13) & 1u;
+  bits += 0xc8000fffu + odd;
+  return toU16(sign | (bits >> 13));
+}
+
+static f32 Float16ToFloat32(u16 value)
+{
+  u32 bits     = toU32(value & 0x7fffu) << 13;
+  u32 exponent = bits & 0x0f800000u;
+  bits += 0x38000000u;
+
+  if(exponent == 0x0f800000u) {
+    bits += 0x38000000u;
+    if(bits & 0x7fffffu) bits |= 0x400000u;
+  } else if(exponent == 0u) {
+    // Subnormals are normalized by the float subtraction.
+    bits += 0x800000u;
+    bits = std::bit_cast<u32>(
+      std::bit_cast<f32>(bits) - std::bit_cast<f32>(0x38800000u));
+  }
+
+  return std::bit_cast<f32>(bits | (toU32(value & 0x8000u) << 16));
+}
+
+using HalfFn = void (*)(u8* dst, const u8* src, u64 count);
+
+static void HalfFromFloat(u8* dst, const u8* src, u64 count)
+{
+  for(u64 idx = 0u; idx < count; ++idx) {
+    f32 value;
+    memcpy(&value, src + idx * 4u, sizeof(value));
+    u16 half = Float32ToFloat16(value);
+    memcpy(dst + idx * 2u, &half, sizeof(half));
+  }
+}
+
+static void HalfToFloat(u8* dst, const u8* src, u64 count)
+{
+  for(u64 idx = 0u; idx < count; ++idx) {
+    u16 half;
+    memcpy(&half, src + idx * 2u, sizeof(half));
+    f32 value = Float16ToFloat32(half);
+    memcpy(dst + idx * 4u, &value, sizeof(value));
+  }
+}
+
+#ifdef VD_ARCH_X64
+
+VD_TARGET("avx,f16c")
+static void HalfFromFloatF16C(u8* dst, const u8* src, u64 count)
+{
+  u64 idx = 0u;
+  for(; idx + 8u <= count; idx += 8u) {
+    auto value = _mm256_loadu_ps(reinterpret_cast<const f32*>(src));
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(dst),
+      _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+    src += 32u;
+    dst += 16u;
+  }
+
+  HalfFromFloat(dst, src, count - idx);
+}
+
+VD_TARGET("avx,f16c")
+static void HalfToFloatF16C(u8* dst, const u8* src, u64 count)
+{
+  u64 idx = 0u;
+  for(; idx + 8u <= count; idx += 8u) {
+    auto half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    _mm256_storeu_ps(
+      reinterpret_cast<f32*>(dst), _mm256_cvtph_ps(half));
+    src += 16u;
+    dst += 32u;
+  }
+
+  HalfToFloat(dst, src, count - idx);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Value passes, between RGBA texels of a type and RGBA floats.
+
+static f32 SrgbToLinear(f32 v)
+{
+  return v <= 0.04045f ? v / 12.92f
+                       : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+static f32 LinearToSrgb(f32 v)
+{
+  return v <= 0.0031308f ? v * 12.92f
+                         : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+}
+
+// Encoding looks up the linear value quantized to 16 bits, which is
+// fine enough to round trip every code. The encoding table is padded
+// so it can be gathered 4 bytes at a time.
+struct PixelSrgbTables {
+  alignas(32) SArr<f32, 256u> toLinear;
+  Arr<u8> fromLinear;
+};
+
+static const PixelSrgbTables& GetPixelSrgbTables()
+{
+  static const PixelSrgbTables tables = [] {
+    PixelSrgbTables ret;
+
+    for(u32 idx = 0u; idx < 256u; ++idx)
+      ret.toLinear[idx] = SrgbToLinear(toF32(idx) / 255.0f);
+
+    ret.fromLinear.resize(65536u + 3u);
+    for(u32 idx = 0u; idx < 65536u; ++idx)
+      ret.fromLinear[idx] = toU8(
+        std::lround(LinearToSrgb(toF32(idx) / 65535.0f) * 255.0f));
+
+    return ret;
+  }();
+
+  return tables;
+}
+
+// Clamped and rounded to nearest even, NaN gives 0. Matches the
+// vector code, which runs with the default rounding mode.
+static inline u32 QuantizeUnorm(f32 v, f32 scale)
+{
+  v *= scale;
+  v = v > 0.0f ? (v < scale ? v : scale) : 0.0f;
+  return toU32(std::nearbyint(v));
+}
+
+template<typename T>
+static inline void StoreValue(u8* dst, T value)
+{
+  memcpy(dst, &value, sizeof(value));
+}
+
+template<typename T>
+static inline T LoadValue(const u8* src)
+{
+  T value;
+  memcpy(&value, src, sizeof(value));
+  return value;
+}
+
+using Shuffle = PixelConverter::Shuffle;
+
+template<PixelType Type>
+static void PixelToFloat(
+  u8* dst, const u8* src, u32 count, const Shuffle&)
+{
+  if constexpr(Type == PixelType::Float16) {
+    HalfToFloat(dst, src, toU64(count) * 4u);
+  } else {
+    const auto& tables = GetPixelSrgbTables();
+
+    for(u32 idx = 0u; idx < count * 4u; ++idx) {
+      f32 value;
+      if constexpr(Type == PixelType::Unorm16)
+        value = LoadValue<u16>(src + idx * 2u) * (1.0f / 65535.0f);
+      else if constexpr(Type == PixelType::Srgb8)
+        value = (idx & 3u) == 3u ? src[idx] * (1.0f / 255.0f)
+                                 : tables.toLinear[src[idx]];
+      else
+        value = src[idx] * (1.0f / 255.0f);
+      StoreValue(dst + idx * 4u, value);
+    }
+  }
+}
+
+template<PixelType Type>
+static void PixelFromFloat(
+  u8* dst, const u8* src, u32 count, const Shuffle&)
+{
+  if constexpr(Type == PixelType::Float16) {
+    HalfFromFloat(dst, src, toU64(count) * 4u);
+  } else {
+    const auto& tables = GetPixelSrgbTables();
+
+    for(u32 idx = 0u; idx < count * 4u; ++idx) {
+      f32 value = LoadValue<f32>(src + idx * 4u);
+      if constexpr(Type == PixelType::Unorm16)
+        StoreValue(
+          dst + idx * 2u, toU16(QuantizeUnorm(value, 65535.0f)));
+      else if constexpr(Type == PixelType::Srgb8)
+        dst[idx] =
+          (idx & 3u) == 3u
+            ? toU8(QuantizeUnorm(value, 255.0f))
+            : tables.fromLinear[QuantizeUnorm(value, 65535.0f)];
+      else
+        dst[idx] = toU8(QuantizeUnorm(value, 255.0f));
+    }
+  }
+}
+
+static void PixelShuffle(
+  u8* dst, const u8* src, u32 count, const Shuffle& shuffle)
+{
+  for(u32 idx = 0u; idx < count; ++idx) {
+    for(u32 byte = 0u; byte < shuffle.dstSize; ++byte) {
+      const i8 from = shuffle.mask[byte];
+      dst[byte]     = from < 0 ? shuffle.fill[byte] : src[from];
+    }
+    src += shuffle.srcSize;
+    dst += shuffle.dstSize;
+  }
+}
+
+#ifdef VD_ARCH_X64
+
+template<PixelType Type>
+VD_TARGET("sse4.1")
+static void PixelToFloatSSE41(
+  u8* dst, const u8* src, u32 count, const Shuffle& shuffle)
+{
+  constexpr f32 Scale =
+    Type == PixelType::Unorm16 ? 1.0f / 65535.0f : 1.0f / 255.0f;
+  constexpr u32 SrcSize = Type == PixelType::Unorm16 ? 8u : 4u;
+
+  const auto scale = _mm_set1_ps(Scale);
+
+  u32 idx = 0u;
+  for(; idx < count; ++idx) {
+    __m128i value;
+    if constexpr(Type == PixelType::Unorm16)
+      value = _mm_cvtepu16_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+    else
+      value = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(LoadValue<i32>(src)));
+
+    _mm_storeu_ps(
+      reinterpret_cast<f32*>(dst),
+      _mm_mul_ps(_mm_cvtepi32_ps(value), scale));
+    src += SrcSize;
+    dst += 16u;
+  }
+
+  PixelToFloat<Type>(dst, src, count - idx, shuffle);
+}
+
+VD_TARGET("sse4.1")
+static inline __m128i QuantizeUnormSSE41(const u8* src, __m128 scale)
+{
+  auto value = _mm_mul_ps(
+    _mm_loadu_ps(reinterpret_cast<const f32*>(src)), scale);
+  value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), scale);
+  return _mm_cvtps_epi32(value);
+}
+
+template<PixelType Type>
+VD_TARGET("sse4.1")
+static void PixelFromFloatSSE41(
+  u8* dst, const u8* src, u32 count, const Shuffle& shuffle)
+{
+  u32 idx = 0u;
+  if constexpr(Type == PixelType::Unorm16) {
+    const auto scale = _mm_set1_ps(65535.0f);
+    for(; idx + 2u <= count; idx += 2u) {
+      auto lo = QuantizeUnormSSE41(src, scale);
+      auto hi = QuantizeUnormSSE41(src + 16u, scale);
+      _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst), _mm_packus_epi32(lo, hi));
+      src += 32u;
+      dst += 16u;
+    }
+  } else {
+    const auto scale = _mm_set1_ps(255.0f);
+    for(; idx + 4u <= count; idx += 4u) {
+      auto t0 = QuantizeUnormSSE41(src, scale);
+      auto t1 = QuantizeUnormSSE41(src + 16u, scale);
+      auto t2 = QuantizeUnormSSE41(src + 32u, scale);
+      auto t3 = QuantizeUnormSSE41(src + 48u, scale);
+      _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst),
+        _mm_packus_epi16(
+          _mm_packus_epi32(t0, t1), _mm_packus_epi32(t2, t3)));
+      src += 64u;
+      dst += 16u;
+    }
+  }
+
+  PixelFromFloat<Type>(dst, src, count - idx, shuffle);
+}
+
+// Two texels per register. sRGB colors are gathered from the tables,
+// alpha is always linear.
+template<PixelType Type>
+VD_TARGET("avx2")
+static void PixelToFloatAVX2(
+  u8* dst, const u8* src, u32 count, const Shuffle& shuffle)
+{
+  constexpr f32 Scale =
+    Type == PixelType::Unorm16 ? 1.0f / 65535.0f : 1.0f / 255.0f;
+  constexpr u32 SrcSize = Type == PixelType::Unorm16 ? 16u : 8u;
+
+  const auto  scale  = _mm256_set1_ps(Scale);
+  const auto& tables = GetPixelSrgbTables();
+
+  u32 idx = 0u;
+  for(; idx + 2u <= count; idx += 2u) {
+    __m256i value;
+    if constexpr(Type == PixelType::Unorm16)
+      value = _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    else
+      value = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+
+    auto linear = _mm256_mul_ps(_mm256_cvtepi32_ps(value), scale);
+    if constexpr(Type == PixelType::Srgb8)
+      linear = _mm256_blend_ps(
+        _mm256_i32gather_ps(tables.toLinear.data(), value, 4), linear,
+        0x88);
+
+    _mm256_storeu_ps(reinterpret_cast<f32*>(dst), linear);
+    src += SrcSize;
+    dst += 32u;
+  }
+
+  PixelToFloat<Type>(dst, src, count - idx, shuffle);
+}
+
+VD_TARGET("avx2")
+static inline __m256i QuantizeUnormAVX2(const u8* src, __m256 scale)
+{
+  auto value = _mm256_mul_ps(
+    _mm256_loadu_ps(reinterpret_cast<const f32*>(src)), scale);
+  value =
+    _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), scale);
+  return _mm256_cvtps_epi32(value);
+}
+
+// Colors are quantized to 16 bits and gathered from the encoding
+// table, alpha is quantized to 8 bits.
+VD_TARGET("avx2")
+static inline __m256i QuantizeSrgbAVX2(const u8* src)
+{
+  const auto& tables = GetPixelSrgbTables();
+
+  auto color = _mm256_and_si256(
+    _mm256_i32gather_epi32(
+      reinterpret_cast<const int*>(tables.fromLinear.data()),
+      QuantizeUnormAVX2(src, _mm256_set1_ps(65535.0f)), 1),
+    _mm256_set1_epi32(0xff));
+  auto alpha = QuantizeUnormAVX2(src, _mm256_set1_ps(255.0f));
+  return _mm256_blend_epi32(color, alpha, 0x88);
+}
+
+template<PixelType Type>
+VD_TARGET("avx2")
+static inline __m256i QuantizeTexelsAVX2(const u8* src)
+{
+  if constexpr(Type == PixelType::Srgb8) return QuantizeSrgbAVX2(src);
+  else
+    return QuantizeUnormAVX2(src, _mm256_set1_ps(255.0f));
+}
+
+template<PixelType Type>
+VD_TARGET("avx2")
+static void PixelFromFloatAVX2(
+  u8* dst, const u8* src, u32 count, const Shuffle& shuffle)
+{
+  u32 idx = 0u;
+  if constexpr(Type == PixelType::Unorm16) {
+    const auto scale = _mm256_set1_ps(65535.0f);
+    for(; idx + 4u <= count; idx += 4u) {
+      auto lo = QuantizeUnormAVX2(src, scale);
+      auto hi = QuantizeUnormAVX2(src + 32u, scale);
+
+      // Packing works within lanes, texels come out as 0 2 1 3.
+      auto packed = _mm256_permute4x64_epi64(
+        _mm256_packus_epi32(lo, hi), 0xd8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), packed);
+      src += 64u;
+      dst += 32u;
+    }
+  } else {
+    for(; idx + 8u <= count; idx += 8u) {
+      auto t01 = QuantizeTexelsAVX2<Type>(src);
+      auto t23 = QuantizeTexelsAVX2<Type>(src + 32u);
+      auto t45 = QuantizeTexelsAVX2<Type>(src + 64u);
+      auto t67 = QuantizeTexelsAVX2<Type>(src + 96u);
+
+      // Texels come out as 0 2 4 6 1 3 5 7.
+      auto packed = _mm256_packus_epi16(
+        _mm256_packus_epi32(t01, t23), _mm256_packus_epi32(t45, t67));
+      packed = _mm256_permutevar8x32_epi32(
+        packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), packed);
+      src += 128u;
+      dst += 32u;
+    }
+  }
+
+  PixelFromFloat<Type>(dst, src, count - idx, shuffle);
+}
+
+VD_TARGET("avx,f16c")
+static void PixelToFloatF16C(
+  u8* dst, const u8* src, u32 count, const Shuffle&)
+{
+  HalfToFloatF16C(dst, src, toU64(count) * 4u);
+}
+
+VD_TARGET("avx,f16c")
+static void PixelFromFloatF16C(
+  u8* dst, const u8* src, u32 count, const Shuffle&)
+{
+  HalfFromFloatF16C(dst, src, toU64(count) * 4u);
+}
+
+// Loads and stores never cross the end of the run, the last texels go
+// through the scalar code.
+VD_TARGET("ssse3")
+static void PixelShuffleSSSE3(
+  u8* dst, const u8* src, u32 count, const Shuffle& shuffle)
+{
+  const auto mask =
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(&shuffle.mask));
+  const auto fill =
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(&shuffle.fill));
+
+  const u64 srcEnd = toU64(count) * shuffle.srcSize;
+  const u64 dstEnd = toU64(count) * shuffle.dstSize;
+
+  u32 idx = 0u;
+  for(; toU64(idx) * shuffle.srcSize + 16u <= srcEnd &&
+        toU64(idx) * shuffle.dstSize + 16u <= dstEnd;
+      idx += shuffle.groupSize) {
+    auto texels = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(src + idx * shuffle.srcSize));
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(dst + idx * shuffle.dstSize),
+      _mm_or_si128(_mm_shuffle_epi8(texels, mask), fill));
+  }
+
+  PixelShuffle(
+    dst + idx * shuffle.dstSize, src + idx * shuffle.srcSize,
+    count - idx, shuffle);
+}
+
+// Two groups per register, for the shuffles that fill a whole lane
+// with each group.
+VD_TARGET("avx2")
+static void PixelShuffleAVX2(
+  u8* dst, const u8* src, u32 count, const Shuffle& shuffle)
+{
+  const auto mask = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(&shuffle.mask)));
+  const auto fill = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(&shuffle.fill)));
+
+  const u32 groupSrcSize = shuffle.groupSize * shuffle.srcSize;
+  const u64 srcEnd       = toU64(count) * shuffle.srcSize;
+
+  u32 idx = 0u;
+  for(; toU64(idx) * shuffle.srcSize + groupSrcSize + 16u <= srcEnd;
+      idx += shuffle.groupSize * 2u) {
+    const u8* in = src + idx * shuffle.srcSize;
+
+    auto texels = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+      _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(in + groupSrcSize)),
+      1);
+    _mm256_storeu_si256(
+      reinterpret_cast<__m256i*>(dst + idx * shuffle.dstSize),
+      _mm256_or_si256(_mm256_shuffle_epi8(texels, mask), fill));
+  }
+
+  PixelShuffleSSSE3(
+    dst + idx * shuffle.dstSize, src + idx * shuffle.srcSize,
+    count - idx, shuffle);
+}
+
+#endif
+
+// Kernels for each pass, picked once for the CPU.
+class PixelKernelTable
+{
+public:
+  PixelKernelTable()
+  {
+    initialize<PixelType::Unorm8>();
+    initialize<PixelType::Srgb8>();
+    initialize<PixelType::Unorm16>();
+    initialize<PixelType::Float16>();
+
+    shuffle       = &PixelShuffle;
+    shuffleWide   = &PixelShuffle;
+    halfFromFloat = &HalfFromFloat;
+    halfToFloat   = &HalfToFloat;
+
+#ifdef VD_ARCH_X64
+    const auto& cpu = getCpuFeatures();
+    if(cpu.ssse3) {
+      shuffle     = &PixelShuffleSSSE3;
+      shuffleWide = &PixelShuffleSSSE3;
+    }
+    if(cpu.avx2) shuffleWide = &PixelShuffleAVX2;
+    if(cpu.f16c) {
+      halfFromFloat = &HalfFromFloatF16C;
+      halfToFloat   = &HalfToFloatF16C;
+    }
+#endif
+  }
+
+  PixelConverter::PassFn toFloat[PixelTypeCount]   = {};
+  PixelConverter::PassFn fromFloat[PixelTypeCount] = {};
+
+  // The wide shuffle is for groups that fill 16 bytes.
+  PixelConverter::PassFn shuffle;
+  PixelConverter::PassFn shuffleWide;
+
+  HalfFn halfFromFloat;
+  HalfFn halfToFloat;
+
+private:
+  template<PixelType Type>
+  void initialize()
+  {
+    auto& to   = toFloat[enumValue(Type)];
+    auto& from = fromFloat[enumValue(Type)];
+
+    to   = &PixelToFloat<Type>;
+    from = &PixelFromFloat<Type>;
+
+#ifdef VD_ARCH_X64
+    const auto& cpu = getCpuFeatures();
+    if constexpr(Type == PixelType::Float16) {
+      if(cpu.f16c) {
+        to   = &PixelToFloatF16C;
+        from = &PixelFromFloatF16C;
+      }
+    } else {
+      // sRGB needs the tables, which SSE can't gather.
+      if constexpr(Type != PixelType::Srgb8) {
+        if(cpu.sse41) {
+          to   = &PixelToFloatSSE41<Type>;
+          from = &PixelFromFloatSSE41<Type>;
+        }
+      }
+      if(cpu.avx2) {
+        to   = &PixelToFloatAVX2<Type>;
+        from = &PixelFromFloatAVX2<Type>;
+      }
+    }
+#endif
+  }
+};
+
+static const PixelKernelTable& GetPixelKernels()
+{
+  static const PixelKernelTable kernels;
+  return kernels;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Converter
+
+PixelConverter::PixelConverter(
+  PixelFormat src, PixelFormat dst, f32 alpha):
+  m_src{src},
+  m_dst{dst},
+  m_srcSize{getPixelSize(src)},
+  m_shuffles{},
+  m_shuffleCount{0u},
+  m_passes{},
+  m_passCount{0u}
+{
+  const auto& kernels = GetPixelKernels();
+
+  const auto srcType = GetPixelInfo(src).type;
+  const auto dstType = GetPixelInfo(dst).type;
+
+  if(src == dst) return;
+
+  if(srcType == dstType) {
+    addShuffle(src, dst, alpha);
+    return;
+  }
+
+  const auto srcRgba = GetRgbaFormat(srcType);
+  const auto dstRgba = GetRgbaFormat(dstType);
+
+  if(src != srcRgba) addShuffle(src, srcRgba, alpha);
+  if(srcType != PixelType::Float32)
+    addPass(kernels.toFloat[enumValue(srcType)], 16u);
+  if(dstType != PixelType::Float32)
+    addPass(
+      kernels.fromFloat[enumValue(dstType)], getPixelSize(dstRgba));
+  if(dst != dstRgba) addShuffle(dstRgba, dst, alpha);
+}
+
+PixelConverter::PixelConverter(Format src, Format dst, f32 alpha):
+  PixelConverter{getPixelFormat(src), getPixelFormat(dst), alpha}
+{}
+
+bool PixelConverter::IsSupported(Format src, Format dst)
+{
+  return getPixelFormat(src) != PixelFormat::UNDEFINED &&
+         getPixelFormat(dst) != PixelFormat::UNDEFINED;
+}
+
+void PixelConverter::ConvertRow(u8* dst, const u8* src, u32 width) const
+{
+  if(m_passCount == 0u) {
+    memcpy(dst, src, toU64(width) * m_srcSize);
+    return;
+  }
+
+  if(m_passCount == 1u) {
+    const auto& pass = m_passes[0];
+    pass.fn(dst, src, width, m_shuffles[pass.shuffle]);
+    return;
+  }
+
+  alignas(32) u8 buffers[2][PixelChunkSize * 16u];
+
+  for(u32 idx = 0u; idx < width; idx += PixelChunkSize) {
+    const u32 count = std::min(PixelChunkSize, width - idx);
+
+    const u8* in = src + toU64(idx) * m_srcSize;
+    for(u32 passIdx = 0u; passIdx < m_passCount; ++passIdx) {
+      const auto& pass = m_passes[passIdx];
+
+      u8* out = passIdx + 1u == m_passCount
+                  ? dst + toU64(idx) * pass.dstSize
+                  : buffers[passIdx & 1u];
+      pass.fn(out, in, count, m_shuffles[pass.shuffle]);
+      in = out;
+    }
+  }
+}
+
+void PixelConverter::Convert(
+  Span<u8> dst, u64 dstPitch, Span<u8 const> src, u64 srcPitch,
+  UInt2 size) const
+{
+  if(size[0] == 0u || size[1] == 0u) return;
+
+  const u64 srcRowSize = toU64(size[0]) * m_srcSize;
+  const u64 dstRowSize = toU64(size[0]) * getPixelSize(m_dst);
+
+  if(srcPitch == 0u) srcPitch = srcRowSize;
+  if(dstPitch == 0u) dstPitch = dstRowSize;
+
+  if(
+    srcPitch < srcRowSize ||
+    src.size() < srcPitch * (size[1] - 1u) + srcRowSize)
+    throw std::runtime_error("PixelConverter: source is too small");
+  if(
+    dstPitch < dstRowSize ||
+    dst.size() < dstPitch * (size[1] - 1u) + dstRowSize)
+    throw std::runtime_error(
+      "PixelConverter: destination is too small");
+
+  for(u32 y = 0u; y < size[1]; ++y)
+    ConvertRow(
+      dst.data() + y * dstPitch, src.data() + y * srcPitch, size[0]);
+}
+
+// Source byte of each destination channel, -1 when it is missing.
+// Gray is replicated to the color channels.
+static i32 GetShuffleChannel(const PixelInfo& src, u32 channel)
+{
+  if(channel == 3u) return src.channelCount == 4u ? 3 : -1;
+  if(src.channelCount == 1u) return 0;
+  return toI32(src.bgr ? 2u - channel : channel);
+}
+
+void PixelConverter::addShuffle(
+  PixelFormat src, PixelFormat dst, f32 alpha)
+{
+  const auto srcInfo = GetPixelInfo(src);
+  const auto dstInfo = GetPixelInfo(dst);
+  const u32  size    = srcInfo.channelSize;
+
+  auto& shuffle     = m_shuffles[m_shuffleCount];
+  shuffle.srcSize   = srcInfo.channelCount * size;
+  shuffle.dstSize   = dstInfo.channelCount * size;
+  shuffle.groupSize = 16u / std::max(shuffle.srcSize, shuffle.dstSize);
+  shuffle.mask.fill(-1);
+  shuffle.fill.fill(0u);
+
+  const u32 alphaValue =
+    QuantizeUnorm(alpha, size == 2u ? 65535.0f : 255.0f);
+
+  for(u32 texel = 0u; texel < shuffle.groupSize; ++texel) {
+    for(u32 pos = 0u; pos < dstInfo.channelCount; ++pos) {
+      const u32 channel = pos < 3u && dstInfo.bgr ? 2u - pos : pos;
+      const i32 from = GetShuffleChannel(srcInfo, channel);
+
+      for(u32 byte = 0u; byte < size; ++byte) {
+        const u32 idx = texel * shuffle.dstSize + pos * size + byte;
+        if(from < 0) {
+          shuffle.fill[idx] = toU8(alphaValue >> (byte * 8u));
+        } else {
+          shuffle.mask[idx] = toI8(
+            texel * shuffle.srcSize + toU32(from) * size + byte);
+        }
+      }
+    }
+  }
+
+  const auto& kernels = GetPixelKernels();
+  addPass(
+    shuffle.groupSize * shuffle.dstSize == 16u ? kernels.shuffleWide
+                                               : kernels.shuffle,
+    shuffle.dstSize, m_shuffleCount);
+  m_shuffleCount += 1u;
+}
+
+void PixelConverter::addPass(PassFn fn, u32 dstSize, u32 shuffle)
+{
+  m_passes[m_passCount] = {fn, dstSize, shuffle};
+  m_passCount += 1u;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Half float arrays
+
+void vd::convertFloat32ToFloat16(Span<u16> dst, Span<f32 const> src)
+{
+  if(dst.size() < src.size())
+    throw std::runtime_error(
+      "PixelConverter: destination is too small");
+
+  GetPixelKernels().halfFromFloat(
+    reinterpret_cast<u8*>(dst.data()),
+    reinterpret_cast<const u8*>(src.data()), src.size());
+}
+
+void vd::convertFloat16ToFloat32(Span<f32> dst, Span<u16 const> src)
+{
+  if(dst.size() < src.size())
+    throw std::runtime_error(
+      "PixelConverter: destination is too small");
+
+  GetPixelKernels().halfToFloat(
+    reinterpret_cast<u8*>(dst.data()),
+    reinterpret_cast<const u8*>(src.data()), src.size());
+}
@@ -0,0 +1,302 @@
+#include "api/PngUnfilter.hpp"
+
+using namespace vd;
+
+static inline u8 PngPaeth(u8 a, u8 b, u8 c)
+{
+  i32 pa = std::abs(toI32(b) - toI32(c));
+  i32 pb = std::abs(toI32(a) - toI32(c));
+  i32 pc = std::abs(toI32(a) + toI32(b) - 2 * toI32(c));
+  if(pa <= pb && pa <= pc) return a;
+  return pb <= pc ? b : c;
+}
+
+template<u32 Bpp>
+static void PngUnfilterSub(u8* dst, const u8* src, const u8*, u32 size)
+{
+  for(u32 idx = 0u; idx < Bpp; ++idx) dst[idx] = src[idx];
+  for(u32 idx = Bpp; idx < size; ++idx)
+    dst[idx] = toU8(src[idx] + dst[idx - Bpp]);
+}
+
+static void
+PngUnfilterUp(u8* dst, const u8* src, const u8* prev, u32 size)
+{
+  for(u32 idx = 0u; idx < size; ++idx)
+    dst[idx] = toU8(src[idx] + prev[idx]);
+}
+
+template<u32 Bpp>
+static void
+PngUnfilterAverage(u8* dst, const u8* src, const u8* prev, u32 size)
+{
+  for(u32 idx = 0u; idx < Bpp; ++idx)
+    dst[idx] = toU8(src[idx] + prev[idx] / 2u);
+  for(u32 idx = Bpp; idx < size; ++idx)
+    dst[idx] = toU8(src[idx] + (dst[idx - Bpp] + prev[idx]) / 2u);
+}
+
+template<u32 Bpp>
+static void
+PngUnfilterPaeth(u8* dst, const u8* src, const u8* prev, u32 size)
+{
+  for(u32 idx = 0u; idx < Bpp; ++idx)
+    dst[idx] = toU8(src[idx] + prev[idx]);
+  for(u32 idx = Bpp; idx < size; ++idx)
+    dst[idx] = toU8(
+      src[idx] + PngPaeth(dst[idx - Bpp], prev[idx], prev[idx - Bpp]));
+}
+
+#ifdef VD_ARCH_X64
+
+// Sub, Average and Paeth depend on the pixel on the left, so the SIMD
+// versions work on a whole pixel at a time. Only Up and Sub can use
+// full registers.
+
+// Pixels are moved with 4 or 8-byte accesses, so 3 and 6-byte pixels
+// touch the next pixel too. Kernels stop 8 bytes before the end of the
+// scanline and finish with the scalar code.
+template<u32 Bpp>
+static inline __m128i PngLoadPixel(const u8* src)
+{
+  if constexpr(Bpp <= 4u) {
+    i32 value;
+    memcpy(&value, src, sizeof(value));
+    return _mm_cvtsi32_si128(value);
+  } else {
+    return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+  }
+}
+
+template<u32 Bpp>
+static inline void PngStorePixel(u8* dst, __m128i pixel)
+{
+  if constexpr(Bpp <= 4u) {
+    i32 value = _mm_cvtsi128_si32(pixel);
+    memcpy(dst, &value, sizeof(value));
+  } else {
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), pixel);
+  }
+}
+
+static void
+PngUnfilterUpSSE2(u8* dst, const u8* src, const u8* prev, u32 size)
+{
+  u32 idx = 0u;
+  for(; idx + 16u <= size; idx += 16u) {
+    auto cur =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + idx));
+    auto top =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + idx));
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(dst + idx), _mm_add_epi8(cur, top));
+  }
+  PngUnfilterUp(dst + idx, src + idx, prev + idx, size - idx);
+}
+
+VD_TARGET("avx2")
+static void
+PngUnfilterUpAVX2(u8* dst, const u8* src, const u8* prev, u32 size)
+{
+  u32 idx = 0u;
+  for(; idx + 32u <= size; idx += 32u) {
+    auto cur =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + idx));
+    auto top =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + idx));
+    _mm256_storeu_si256(
+      reinterpret_cast<__m256i*>(dst + idx), _mm256_add_epi8(cur, top));
+  }
+  PngUnfilterUpSSE2(dst + idx, src + idx, prev + idx, size - idx);
+}
+
+// Prefix sum over the whole pixels of a register, then the last pixel
+// of the previous block is added to all of them.
+template<u32 Bpp>
+VD_TARGET("ssse3")
+static void
+PngUnfilterSubSSSE3(u8* dst, const u8* src, const u8*, u32 size)
+{
+  constexpr u32 BlockSize = 16u / Bpp * Bpp;
+
+  alignas(16) u8 lastPixelMask[16];
+  for(u32 idx = 0u; idx < 16u; ++idx)
+    lastPixelMask[idx] = toU8(BlockSize - Bpp + idx % Bpp);
+  auto lastPixel =
+    _mm_load_si128(reinterpret_cast<const __m128i*>(lastPixelMask));
+
+  auto carry = _mm_setzero_si128();
+
+  u32 idx = 0u;
+  for(; idx + 16u <= size; idx += BlockSize) {
+    auto cur =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + idx));
+    cur = _mm_add_epi8(cur, _mm_slli_si128(cur, Bpp));
+    if constexpr(2u * Bpp < BlockSize)
+      cur = _mm_add_epi8(cur, _mm_slli_si128(cur, 2u * Bpp));
+    if constexpr(4u * Bpp < BlockSize)
+      cur = _mm_add_epi8(cur, _mm_slli_si128(cur, 4u * Bpp));
+    if constexpr(8u * Bpp < BlockSize)
+      cur = _mm_add_epi8(cur, _mm_slli_si128(cur, 8u * Bpp));
+    cur = _mm_add_epi8(cur, carry);
+
+    // Bytes past the block are rewritten by the next one.
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + idx), cur);
+    carry = _mm_shuffle_epi8(cur, lastPixel);
+  }
+
+  if(idx == 0u) {
+    PngUnfilterSub<Bpp>(dst, src, nullptr, size);
+    return;
+  }
+
+  for(; idx < size; ++idx) dst[idx] = toU8(src[idx] + dst[idx - Bpp]);
+}
+
+template<u32 Bpp>
+static void
+PngUnfilterAverageSSE2(u8* dst, const u8* src, const u8* prev, u32 size)
+{
+  const auto one = _mm_set1_epi8(1);
+
+  auto left = _mm_setzero_si128();
+
+  u32 idx = 0u;
+  for(; idx + 8u <= size; idx += Bpp) {
+    auto cur = PngLoadPixel<Bpp>(src + idx);
+    auto top = PngLoadPixel<Bpp>(prev + idx);
+
+    // pavgb rounds up, remove the carried bit to get (a + b) / 2.
+    auto avg = _mm_sub_epi8(
+      _mm_avg_epu8(left, top),
+      _mm_and_si128(_mm_xor_si128(left, top), one));
+
+    left = _mm_add_epi8(cur, avg);
+    PngStorePixel<Bpp>(dst + idx, left);
+  }
+
+  if(idx == 0u) {
+    PngUnfilterAverage<Bpp>(dst, src, prev, size);
+    return;
+  }
+
+  for(; idx < size; ++idx)
+    dst[idx] = toU8(src[idx] + (dst[idx - Bpp] + prev[idx]) / 2u);
+}
+
+template<u32 Bpp>
+VD_TARGET("ssse3")
+static void
+PngUnfilterPaethSSSE3(u8* dst, const u8* src, const u8* prev, u32 size)
+{
+  const auto zero = _mm_setzero_si128();
+
+  auto left    = zero;
+  auto topLeft = zero;
+
+  u32 idx = 0u;
+  for(; idx + 8u <= size; idx += Bpp) {
+    auto top = _mm_unpacklo_epi8(PngLoadPixel<Bpp>(prev + idx), zero);
+
+    // p = a + b - c, so |p - a| = |b - c|, |p - b| = |a - c| and
+    // |p - c| = |a + b - 2c|.
+    auto pa = _mm_abs_epi16(_mm_sub_epi16(top, topLeft));
+    auto pb = _mm_abs_epi16(_mm_sub_epi16(left, topLeft));
+    auto pc = _mm_abs_epi16(_mm_sub_epi16(
+      _mm_add_epi16(left, top), _mm_add_epi16(topLeft, topLeft)));
+
+    auto smallest = _mm_min_epi16(pa, _mm_min_epi16(pb, pc));
+    auto useA     = _mm_cmpeq_epi16(pa, smallest);
+    auto useB     = _mm_cmpeq_epi16(pb, smallest);
+
+    auto pred = _mm_or_si128(
+      _mm_and_si128(useB, top), _mm_andnot_si128(useB, topLeft));
+    pred = _mm_or_si128(
+      _mm_and_si128(useA, left), _mm_andnot_si128(useA, pred));
+
+    auto cur = PngLoadPixel<Bpp>(src + idx);
+    auto out = _mm_add_epi8(cur, _mm_packus_epi16(pred, pred));
+    PngStorePixel<Bpp>(dst + idx, out);
+
+    left    = _mm_unpacklo_epi8(out, zero);
+    topLeft = top;
+  }
+
+  if(idx == 0u) {
+    PngUnfilterPaeth<Bpp>(dst, src, prev, size);
+    return;
+  }
+
+  for(; idx < size; ++idx)
+    dst[idx] = toU8(
+      src[idx] + PngPaeth(dst[idx - Bpp], prev[idx], prev[idx - Bpp]));
+}
+
+#endif
+
+PngUnfilterTable::PngUnfilterTable(const CpuFeatures& cpu)
+{
+  initialize<1u>(0u, cpu);
+  initialize<2u>(1u, cpu);
+  initialize<3u>(2u, cpu);
+  initialize<4u>(3u, cpu);
+  initialize<6u>(4u, cpu);
+  initialize<8u>(5u, cpu);
+}
+
+PngUnfilterFn PngUnfilterTable::Get(u32 filter, u32 bytesPerPixel) const
+{
+  if(filter == 0u || filter > 4u)
+    throw std::runtime_error("PNG: bad scanline filter");
+
+  u32 bppIdx = 0u;
+  switch(bytesPerPixel) {
+    case 1u: bppIdx = 0u; break;
+    case 2u: bppIdx = 1u; break;
+    case 3u: bppIdx = 2u; break;
+    case 4u: bppIdx = 3u; break;
+    case 6u: bppIdx = 4u; break;
+    case 8u: bppIdx = 5u; break;
+    default: throw std::runtime_error("PNG: bad pixel size");
+  }
+
+  return m_kernels[filter - 1u][bppIdx];
+}
+
+template<u32 Bpp>
+void PngUnfilterTable::initialize(
+  u32 bppIdx, [[maybe_unused]] const CpuFeatures& cpu)
+{
+  m_kernels[0][bppIdx] = &PngUnfilterSub<Bpp>;
+  m_kernels[1][bppIdx] = &PngUnfilterUp;
+  m_kernels[2][bppIdx] = &PngUnfilterAverage<Bpp>;
+  m_kernels[3][bppIdx] = &PngUnfilterPaeth<Bpp>;
+
+#ifdef VD_ARCH_X64
+  // Single byte pixels are faster with the scalar code.
+  if(cpu.sse2) {
+    m_kernels[1][bppIdx] = &PngUnfilterUpSSE2;
+    if constexpr(Bpp >= 3u)
+      m_kernels[2][bppIdx] = &PngUnfilterAverageSSE2<Bpp>;
+  }
+  if(cpu.ssse3) {
+    m_kernels[0][bppIdx] = &PngUnfilterSubSSSE3<Bpp>;
+    if constexpr(Bpp >= 3u)
+      m_kernels[3][bppIdx] = &PngUnfilterPaethSSSE3<Bpp>;
+  }
+  if(cpu.avx2) m_kernels[1][bppIdx] = &PngUnfilterUpAVX2;
+#endif
+}
+
+void vd::PngUnfilter(
+  u32 filter, u8* dst, const u8* src, const u8* prev, u32 size,
+  u32 bytesPerPixel)
+{
+  if(filter == 0u) {
+    memcpy(dst, src, size);
+    return;
+  }
+
+  static const PngUnfilterTable table;
+  table.Get(filter, bytesPerPixel)(dst, src, prev, size);
+}
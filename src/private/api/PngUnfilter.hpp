@@ -0,0 +1,34 @@
+#pragma once
+
+#include "vuldir/core/Core.hpp"
+
+namespace vd {
+
+// Scanline unfilter kernels, dst[i] = src[i] + predictor. The previous
+// scanline is all zeros for the first row.
+using PngUnfilterFn =
+  void (*)(u8* dst, const u8* src, const u8* prev, u32 size);
+
+// Kernels for each filter and bytes per pixel, picked for the CPU
+// features. With all the features off only the scalar code is used.
+class PngUnfilterTable
+{
+public:
+  PngUnfilterTable(const CpuFeatures& cpu = getCpuFeatures());
+
+  PngUnfilterFn Get(u32 filter, u32 bytesPerPixel) const;
+
+private:
+  template<u32 Bpp>
+  void initialize(u32 bppIdx, const CpuFeatures& cpu);
+
+private:
+  PngUnfilterFn m_kernels[4][6];
+};
+
+// Unfilters a scanline with the kernels picked once for this CPU.
+void PngUnfilter(
+  u32 filter, u8* dst, const u8* src, const u8* prev, u32 size,
+  u32 bytesPerPixel);
+
+} // namespace vd
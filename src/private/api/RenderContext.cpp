@@ -126,17 +126,100 @@ bool RenderContext::Write(Buffer& buffer, Span<u8 const> data)
 
 bool RenderContext::Write(Image& image, Span<u8 const> data)
 {
-  const auto size = std::size(data);
-
-  VDLogI(
-    "Writing %zu bytes to image %s", size,
-    image.GetDesc().name.c_str());
+  if(image.GetMemoryType() != MemoryType::Main) {
+    VDLogI(
+      "Writing %zu bytes to image %s", std::size(data),
+      image.GetDesc().name.c_str());
 
-  if(image.GetMemoryType() != MemoryType::Main)
     return image.Write(data);
+  }
+
+  const auto& desc = image.GetDesc();
+
+  const u32 layerCount = image.GetLayerCount();
+
+  // Upload every layer with its whole chain when the data has them.
+  auto regions   = getStagingLayout(image, desc.mips, layerCount);
+  u64  imageSize = 0u;
+  for(const auto& region: regions)
+    imageSize += region.rowSize * region.rowCount;
+
+  const bool isWhole = std::size(data) >= imageSize;
+  if(!isWhole) regions.resize(1u);
+
+  if(std::size(data) < regions[0].rowSize * regions[0].rowCount) {
+    VDLogE(
+      "Not enough data to write image %s: %zu bytes", desc.name.c_str(),
+      std::size(data));
+    return false;
+  }
+
+  return writeStaging(
+    image, isWhole ? desc.mips : 1u, isWhole ? layerCount : 1u,
+    [&](Span<u8> dst, const Arr<StagingRegion>& layout) {
+      const u8* src = data.data();
+
+      for(const auto& region: layout) {
+        const u64 size = region.rowSize * region.rowCount;
+        if(region.rowPitch == region.rowSize) {
+          std::memcpy(dst.data() + region.offset, src, size);
+        } else {
+          for(u64 row = 0u; row < region.rowCount; ++row)
+            std::memcpy(
+              dst.data() + region.offset + row * region.rowPitch,
+              src + row * region.rowSize, region.rowSize);
+        }
+        src += size;
+      }
+    });
+}
+
+bool RenderContext::WriteMapped(Image& image, const ImageWriter& writer)
+{
+  // Memory that is not mapped through a staging buffer is written
+  // tightly packed.
+  if(image.GetMemoryType() != MemoryType::Main) {
+    const auto& desc = image.GetDesc();
+    const u64   rowCount =
+      toU64(getFormatRowCount(desc.format, desc.extent[1])) *
+      desc.extent[2];
+    const u64 rowSize = getFormatRowSize(desc.format, desc.extent[0]);
+
+    Arr<u8> texels(rowSize * rowCount);
+    writer(texels, rowSize);
+    return Write(image, texels);
+  }
+
+  return writeStaging(
+    image, 1u, 1u,
+    [&](Span<u8> dst, const Arr<StagingRegion>& regions) {
+      writer(dst, regions[0].rowPitch);
+    });
+}
+
+bool RenderContext::writeStaging(
+  Image& image, u32 mipCount, u32 layerCount,
+  const StagingWriter& writer)
+{
+  const auto& desc    = image.GetDesc();
+  const auto  regions = getStagingLayout(image, mipCount, layerCount);
+  const auto& last    = regions.back();
+  const u64   size    = last.offset + last.rowPitch * last.rowCount;
+
+  VDLogI("Writing %llu bytes to image %s", size, desc.name.c_str());
 
   auto& stagingBuffer = getStagingBuffer(size);
-  if(!stagingBuffer.Write(data)) {
+
+  bool written = false;
+  try {
+    written = stagingBuffer.Write(
+      size, [&](Span<u8> dst) { writer(dst, regions); });
+  } catch(...) {
+    m_freeStagingBuffers.push_back(&stagingBuffer);
+    throw;
+  }
+
+  if(!written) {
     m_freeStagingBuffers.push_back(&stagingBuffer);
     return false;
   }
@@ -157,7 +240,9 @@ bool RenderContext::Write(Image& image, Span<u8 const> data)
   transferCmd.AddBarrier(stagingBuffer, ResourceState::CopySrc);
   transferCmd.AddBarrier(image, ResourceState::CopyDst);
   transferCmd.FlushBarriers();
-  transferCmd.Copy(stagingBuffer, image);
+  for(const auto& region: regions)
+    transferCmd.Copy(
+      stagingBuffer, image, region.offset, region.mip, region.layer);
 
 #ifdef VD_API_VK
   // If the transfer queue family is different from the graphics queue family
@@ -225,6 +310,53 @@ void vd::RenderContext::WaitInFlightOperations()
   m_inFlightFenceCount = 0u;
 }
 
+Arr<RenderContext::StagingRegion> RenderContext::getStagingLayout(
+  const Image& image, u32 mipCount, u32 layerCount) const
+{
+  const auto& desc = image.GetDesc();
+
+  Arr<StagingRegion> ret;
+  ret.reserve(toU64(mipCount) * layerCount);
+
+  u64 offset = 0u;
+  for(u32 layer = 0u; layer < layerCount; ++layer) {
+    for(u32 mip = 0u; mip < mipCount; ++mip) {
+      auto& dst = ret.emplace_back();
+      dst.mip   = mip;
+      dst.layer = layer;
+
+      const u32 depth = desc.dimension == Dimension::e3D
+                          ? getMipExtent(desc.extent[2], mip)
+                          : 1u;
+
+      const u32 width  = getMipExtent(desc.extent[0], mip);
+      const u32 height = getMipExtent(desc.extent[1], mip);
+
+      dst.rowSize  = getFormatRowSize(desc.format, width);
+      dst.rowCount =
+        toU64(getFormatRowCount(desc.format, height)) * depth;
+
+#ifdef VD_API_DX
+      // Must match the footprint used by CommandBuffer::Copy.
+      offset =
+        alignUp(offset, toU64(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT));
+      dst.rowPitch =
+        alignUp(dst.rowSize, toU64(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT));
+#else
+      // Copy queues need offsets that are also a multiple of 4.
+      const u64 alignment = 4u * getFormatSize(desc.format);
+      offset       = divideRoundingUp(offset, alignment) * alignment;
+      dst.rowPitch = dst.rowSize;
+#endif
+
+      dst.offset = offset;
+      offset += dst.rowPitch * dst.rowCount;
+    }
+  }
+
+  return ret;
+}
+
 Buffer& RenderContext::getStagingBuffer(u64 size)
 {
   for(auto bufIt = std::begin(m_freeStagingBuffers);
@@ -0,0 +1,106 @@
+#include "vuldir/api/ResourceRegistry.hpp"
+
+#include "vuldir/api/Device.hpp"
+
+using namespace vd;
+
+ResourceRegistry::ResourceRegistry(Device& device):
+  m_device{device}, m_stats{}, m_images{}, m_buffers{}
+{}
+
+ResourceRegistry::~ResourceRegistry() = default;
+
+ResourceRegistry::Key ResourceRegistry::getImageKey(
+  const Image::Desc& desc, const Hash128& hash) const
+{
+  Key key{};
+  key.hash       = hash;
+  key.usage      = toU64(desc.usage.GetMask());
+  key.format      = enumValue(desc.format);
+  key.dimension   = toU32(enumValue(desc.dimension));
+  key.extent[0]   = desc.extent[0];
+  key.extent[1]   = desc.extent[1];
+  key.extent[2]   = desc.extent[2];
+  key.samples     = desc.samples;
+  key.mips        = desc.mips;
+  key.memoryType  = toU32(enumValue(desc.memoryType));
+  key.defaultView = desc.defaultView;
+  return key;
+}
+
+Image& ResourceRegistry::GetImage(
+  RenderContext& ctx, const Image::Desc& desc, Span<u8 const> texels)
+{
+  auto key = getImageKey(desc, xxh128(texels));
+  key.size = std::size(texels);
+
+  if(auto it = m_images.find(key); it != m_images.end()) {
+    m_stats.imageHits  += 1u;
+    m_stats.bytesSaved += key.size;
+    return *it->second;
+  }
+
+  auto image = std::make_unique<Image>(m_device, desc);
+  if(!ctx.Write(*image, texels))
+    throw makeError<std::runtime_error>(
+      "ResourceRegistry: cannot write image %s", desc.name.c_str());
+
+  m_stats.imageCount += 1u;
+  return *m_images.emplace(key, std::move(image)).first->second;
+}
+
+Image& ResourceRegistry::GetImage(
+  RenderContext& ctx, const Image::Desc& desc, const Str& uri,
+  const RenderContext::ImageWriter& writer)
+{
+  auto key = getImageKey(
+    desc, xxh128(Span<u8 const>{
+            reinterpret_cast<const u8*>(uri.data()), uri.size()}));
+  key.isUri = true;
+
+  if(auto it = m_images.find(key); it != m_images.end()) {
+    // Only the first level of the first layer is written.
+    m_stats.imageHits += 1u;
+    m_stats.bytesSaved +=
+      getFormatRowSize(desc.format, desc.extent[0]) *
+      getFormatRowCount(desc.format, desc.extent[1]);
+    return *it->second;
+  }
+
+  auto image = std::make_unique<Image>(m_device, desc);
+  if(!ctx.WriteMapped(*image, writer))
+    throw makeError<std::runtime_error>(
+      "ResourceRegistry: cannot write image %s", uri.c_str());
+
+  m_stats.imageCount += 1u;
+  return *m_images.emplace(key, std::move(image)).first->second;
+}
+
+Buffer& ResourceRegistry::GetBuffer(
+  RenderContext& ctx, const Buffer::Desc& desc, Span<u8 const> data)
+{
+  Key key{};
+  key.hash       = xxh128(data);
+  key.size       = std::size(data);
+  key.usage       = toU64(desc.usage.GetMask());
+  key.memoryType  = toU32(enumValue(desc.memoryType));
+  key.defaultView = desc.defaultView;
+  key.isStaging   = desc.isStaging;
+
+  if(auto it = m_buffers.find(key); it != m_buffers.end()) {
+    m_stats.bufferHits += 1u;
+    m_stats.bytesSaved += key.size;
+    return *it->second;
+  }
+
+  auto bufferDesc = desc;
+  bufferDesc.size = key.size;
+
+  auto buffer = std::make_unique<Buffer>(m_device, bufferDesc);
+  if(!ctx.Write(*buffer, data))
+    throw makeError<std::runtime_error>(
+      "ResourceRegistry: cannot write buffer %s", desc.name.c_str());
+
+  m_stats.bufferCount += 1u;
+  return *m_buffers.emplace(key, std::move(buffer)).first->second;
+}
@@ -172,6 +172,13 @@ const Buffer::View* Buffer::GetView(ViewType type, u32 index) const
 }
 
 bool Buffer::Write(Span<u8 const> data)
+{
+  return Write(data.size_bytes(), [&data](Span<u8> dst) {
+    memcpy(dst.data(), data.data(), data.size_bytes());
+  });
+}
+
+bool Buffer::Write(u64 size, const MemoryPool::Writer& writer)
 {
   // TODO: Persistent mapping for stuff updated every frame.
 
@@ -185,7 +192,7 @@ bool Buffer::Write(Span<u8 const> data)
     return false;
   }
 
-  if(data.size_bytes() > m_allocation.size) {
+  if(size > m_allocation.size) {
     VDLogE(
       "Not enough space to allocate memory for buffer '%s'.",
       m_desc.name.c_str());
@@ -203,7 +210,12 @@ bool Buffer::Write(Span<u8 const> data)
     return false;
   }
 
-  memcpy(dst, data.data(), data.size_bytes());
+  try {
+    writer(Span<u8>(static_cast<u8*>(dst), size));
+  } catch(...) {
+    m_handle->Unmap(0, &range);
+    throw;
+  }
   m_handle->Unmap(0, &range);
 
   return true;
@@ -331,15 +331,22 @@ void CommandBuffer::Copy(
 void CommandBuffer::Copy(
   const Buffer& src, Image& dst, u64 offset, u32 mip, u32 layer)
 {
-  const auto width  = dst.GetDesc().extent[0] >> mip;
-  const auto height = dst.GetDesc().extent[1] >> mip;
-  const auto depth  = dst.GetDesc().extent[2];
+  const auto width  = getMipExtent(dst.GetDesc().extent[0], mip);
+  const auto height = getMipExtent(dst.GetDesc().extent[1], mip);
   const auto format = dst.GetDesc().format;
 
+  const auto depth = dst.GetDesc().dimension == Dimension::e3D
+                       ? getMipExtent(dst.GetDesc().extent[2], mip)
+                       : 1u;
+
   // Calculate row pitch aligned to D3D12 requirements (256 bytes)
-  const auto formatSize = getFormatSize(format);
-  const auto rowPitch   = alignUp(
-    width * formatSize, (u32)D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+  const auto rowPitch = alignUp(
+    toU32(getFormatRowSize(format, width)),
+    (u32)D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+
+  // Footprints of block formats cover whole blocks, even for the mips
+  // smaller than a block.
+  const auto blockExtent = getFormatBlockExtent(format);
 
   D3D12_TEXTURE_COPY_LOCATION srcLoc{
     .pResource       = src.GetHandle(),
@@ -348,8 +355,8 @@ void CommandBuffer::Copy(
       .Offset    = offset,
       .Footprint = {
         .Format   = convert(format),
-        .Width    = width,
-        .Height   = height,
+        .Width    = alignUp(width, blockExtent),
+        .Height   = alignUp(height, blockExtent),
         .Depth    = depth,
         .RowPitch = rowPitch,
       }}};
@@ -87,12 +87,13 @@ makeSrvDesc(const ViewRange& range, Format format, Dimension dimension)
       srv.Texture3D.MipLevels       = range.mipCount;
       break;
     case Dimension::eCube:
-      if(range.layerCount > 1u) {
+      // Six layers per cube.
+      if(range.layerCount > 6u) {
         srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
-        srv.Texture2DArray.MostDetailedMip = range.mipOffset;
-        srv.Texture2DArray.MipLevels       = range.mipCount;
-        srv.Texture2DArray.FirstArraySlice = range.layerOffset;
-        srv.Texture2DArray.ArraySize       = range.layerCount;
+        srv.TextureCubeArray.MostDetailedMip  = range.mipOffset;
+        srv.TextureCubeArray.MipLevels        = range.mipCount;
+        srv.TextureCubeArray.First2DArrayFace = range.layerOffset;
+        srv.TextureCubeArray.NumCubes         = range.layerCount / 6u;
       } else {
         srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
         srv.TextureCube.MostDetailedMip = range.mipOffset;
@@ -233,10 +234,8 @@ Image::Image(Device& device, const Desc& desc):
   m_memoryDesc{},
   m_handle{}
 {
-  if(m_desc.mips == 0u) {
-    auto largest = std::max(m_desc.extent[0], m_desc.extent[1]);
-    m_desc.mips  = toU32(std::log2(largest));
-  }
+  if(m_desc.mips == 0u)
+    m_desc.mips = getMipCount(m_desc.extent[0], m_desc.extent[1]);
 
   if(m_desc.handle) {
     m_handle = m_desc.handle;
@@ -132,3 +132,8 @@ bool Buffer::Write(Span<u8 const> data)
 {
   return m_allocation.pool->Write(m_allocation, data);
 }
+
+bool Buffer::Write(u64 size, const MemoryPool::Writer& writer)
+{
+  return m_allocation.pool->Write(m_allocation, size, writer);
+}
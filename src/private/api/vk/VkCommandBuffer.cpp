@@ -362,12 +362,11 @@ void CommandBuffer::Copy(
 {
   const auto& desc = dst.GetDesc();
 
-  auto extent = desc.extent;
-  for(u32 idx = 0u; idx < mip; ++idx) {
-    if(extent[0] > 1u) extent[0] /= 2u;
-    if(extent[1] > 1u) extent[1] /= 2u;
-    if(extent[2] > 1u) extent[2] /= 2u;
-  }
+  const UInt3 extent = {
+    getMipExtent(desc.extent[0], mip),
+    getMipExtent(desc.extent[1], mip),
+    desc.dimension == Dimension::e3D ? getMipExtent(desc.extent[2], mip)
+                                     : 1u};
 
   VkImageSubresourceLayers subresource{
     .aspectMask     = getVkFormatAspect(desc.format),
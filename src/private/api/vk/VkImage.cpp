@@ -18,10 +18,8 @@ Image::Image(Device& device, const Desc& desc):
   if(m_desc.handle) { // Non owned image, wrap only.
     m_handle = m_desc.handle;
   } else { // Owned image, create.
-    if(m_desc.mips == 0u) {
-      auto largest = std::max(m_desc.extent[0], m_desc.extent[1]);
-      m_desc.mips  = toU32(std::log2(largest));
-    }
+    if(m_desc.mips == 0u)
+      m_desc.mips = getMipCount(m_desc.extent[0], m_desc.extent[1]);
 
     VkImageCreateInfo ci{};
     ci.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -62,7 +60,8 @@ Image::Image(Device& device, const Desc& desc):
         ci.extent.depth = m_desc.extent[2];
         break;
       case Dimension::eCube:
-        ci.imageType = VK_IMAGE_TYPE_2D;
+        ci.imageType   = VK_IMAGE_TYPE_2D;
+        ci.arrayLayers = m_desc.extent[2];
         ci.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
         break;
       default:
@@ -139,9 +138,9 @@ u32 Image::AddView(ViewType type, const ViewRange& range)
       ci.viewType = VK_IMAGE_VIEW_TYPE_3D;
       break;
     case Dimension::eCube:
-      ci.viewType = m_desc.extent[2] > 1u
-                      ? VK_IMAGE_VIEW_TYPE_CUBE
-                      : VK_IMAGE_VIEW_TYPE_CUBE_ARRAY;
+      ci.viewType = m_desc.extent[2] > 6u
+                      ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY
+                      : VK_IMAGE_VIEW_TYPE_CUBE;
       break;
     default:
       throw std::runtime_error("Invalid image dimension");
@@ -92,8 +92,14 @@ MemoryPool::~MemoryPool()
 
 bool MemoryPool::Write(Allocation& alloc, Span<u8 const> data)
 {
-  const auto dataSize = data.size_bytes();
+  return Write(alloc, data.size_bytes(), [&data](Span<u8> dst) {
+    std::memcpy(dst.data(), data.data(), data.size_bytes());
+  });
+}
 
+bool MemoryPool::Write(
+  Allocation& alloc, u64 dataSize, const Writer& writer)
+{
   if(!vd::hasFlag(m_props, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
     VDLogE(
       "[MemoryPool %s]: Cannot map memory that is not HOST VISIBLE.",
@@ -118,7 +124,12 @@ bool MemoryPool::Write(Allocation& alloc, Span<u8 const> data)
     return false;
   }
 
-  std::memcpy(pDst, data.data(), dataSize);
+  try {
+    writer(Span<u8>(static_cast<u8*>(pDst), dataSize));
+  } catch(...) {
+    m_device.api().UnmapMemory(m_handle);
+    throw;
+  }
   m_device.api().UnmapMemory(m_handle);
 
   if(!vd::hasFlag(m_props, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
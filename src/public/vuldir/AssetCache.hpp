@@ -0,0 +1,111 @@
+#pragma once
+
+#include "vuldir/Data.hpp"
+#include "vuldir/DataReader.hpp"
+#include "vuldir/core/Core.hpp"
+
+#include <list>
+
+namespace vd {
+
+// Keeps decoded images and buffers by uri, so models sharing assets
+// don't read and decode them again. Plug the uri filter into the
+// DataReader to skip the cached assets, then resolve the model read
+// to fill them in and cache the new ones.
+//
+// Images and buffers are keyed by uri separately. The image options
+// are not part of the key, models read with different options should
+// use different caches.
+//
+// Resolve copies the cached assets into the model, which owns its
+// data, so the cache saves reading and decoding but not the copy.
+// Only the assets handed out by Find and Add count as referenced.
+class AssetCache
+{
+public:
+  struct Desc {
+    // Least recently used entries are evicted while the cached data is
+    // larger than the budget. Entries still referenced are kept.
+    u64 budget = 256ull << 20;
+  };
+
+  struct Stats {
+    u64 hits      = 0u;
+    u64 misses    = 0u;
+    u64 evictions = 0u;
+    u64 entries   = 0u;
+    u64 size      = 0u;
+  };
+
+public:
+  VD_NONMOVABLE(AssetCache);
+
+  AssetCache(const Desc& desc);
+
+  // Rejects the cached uris, keeping them alive until Resolve.
+  DataReader::UriFilterByKind GetUriFilter();
+
+  // Fills the assets skipped by the uri filter with a copy of the
+  // cached ones and caches the external assets the reader decoded.
+  void Resolve(data::Model& model);
+
+  SPtr<const data::Image>  FindImage(Strv uri);
+  SPtr<const data::Buffer> FindBuffer(Strv uri);
+
+  // Keyed on the uri of the asset, replacing any entry with the same
+  // uri. Assets without an uri are not cached.
+  SPtr<const data::Image>  AddImage(data::Image image);
+  SPtr<const data::Buffer> AddBuffer(data::Buffer buffer);
+
+  void  SetBudget(u64 budget);
+  Stats GetStats() const;
+
+  // Drops the entries that are not referenced.
+  void Clear();
+
+private:
+  using AssetKind = DataReader::AssetKind;
+
+  struct Entry {
+    AssetKind                kind = AssetKind::Buffer;
+    Str                      uri;
+    SPtr<const data::Image>  image;
+    SPtr<const data::Buffer> buffer;
+    u64                      size = 0u;
+  };
+
+  using EntryList  = std::list<Entry>;
+  using EntryMap   = Map<Str, EntryList::iterator>;
+  using PendingMap = Map<Str, Entry>;
+
+  static constexpr u32 AssetKindCount = 2u;
+
+  // Moves the entry to the front, returns nullptr when missing.
+  Entry* find(AssetKind kind, Strv uri);
+  Entry& insert(Entry&& entry);
+  void   evict(u64 budget);
+
+  EntryMap& getIndex(AssetKind kind)
+  {
+    return m_index[static_cast<u32>(kind)];
+  }
+  PendingMap& getPending(AssetKind kind)
+  {
+    return m_pending[static_cast<u32>(kind)];
+  }
+
+private:
+  mutable std::mutex m_mutex;
+
+  u64   m_budget;
+  Stats m_stats;
+
+  // Most recently used first, indexed by uri for each kind.
+  EntryList                      m_entries;
+  SArr<EntryMap, AssetKindCount> m_index;
+
+  // Entries rejected by the uri filter, waiting for Resolve.
+  SArr<PendingMap, AssetKindCount> m_pending;
+};
+
+} // namespace vd
@@ -9,9 +9,41 @@ struct Image {
   Opt<Str> uri;
   Format   format;
   UInt2    size;
-  Arr<u8>  texels;
+
+  // Mip levels are stored one after the other in the texels, largest
+  // first and tightly packed. Array layers, or cube faces, follow each
+  // other with their whole chain.
+  u32     mips   = 1u;
+  u32     layers = 1u;
+  Arr<u8> texels;
 };
 
+inline u64 getMipSize(const Image& image, u32 mip)
+{
+  return getFormatRowSize(
+           image.format, getMipExtent(image.size[0], mip)) *
+         getFormatRowCount(
+           image.format, getMipExtent(image.size[1], mip));
+}
+
+inline u64 getMipOffset(const Image& image, u32 mip, u32 layer = 0u)
+{
+  u64 chainSize = 0u;
+  for(u32 level = 0u; level < image.mips; ++level)
+    chainSize += getMipSize(image, level);
+
+  u64 offset = layer * chainSize;
+  for(u32 level = 0u; level < mip; ++level)
+    offset += getMipSize(image, level);
+  return offset;
+}
+
+// Bytes of every mip of every layer.
+inline u64 getImageSize(const Image& image)
+{
+  return getMipOffset(image, 0u, image.layers);
+}
+
 enum class ComponentType {
   Byte,
   UnsignedByte,
@@ -6,25 +6,43 @@
 
 namespace vd {
 
+class DiskCache;
+
 class DataReader
 {
 public:
-  using UriFilter  = std::function<bool(Strv)>;
-  using FileReader = std::function<Arr<u8>(
+  enum class AssetKind { Buffer, Image };
+
+  using UriFilter       = std::function<bool(Strv uri)>;
+  using UriFilterByKind = std::function<bool(Strv uri, AssetKind kind)>;
+  using FileReader      = std::function<Arr<u8>(
     const fs::path& path, const fs::path* basePath)>;
 
   struct Desc {
     // If you have an asset cache you can filter out assets that you
     // already have loaded. In that case data load for that buffer will
     // be skipped. You can then later use the uri to manually assign the
-    // buffer from your cache.
+    // buffer from your cache. External buffers and images are passed
+    // their path joined to the base path, embedded buffers their data
+    // uri.
     UriFilter uriFilter;
 
+    // Same, also given whether the uri is a buffer or an image. Used
+    // instead of uriFilter when set.
+    UriFilterByKind uriFilterByKind;
+
     // Leave empty to use the default filesystem reader.
     // Can be set to read from custom data sources like archives and
     // data packages. Since the uri can be relative, the second argument
     // is an optional base path. Can also be used for raw data caching.
     FileReader fileReader;
+
+    // Images read with ReadImage and ReadImageInto are kept here once
+    // decoded, keyed on the file bytes and the options that change the
+    // texels, and are mapped back instead of being decoded again. The
+    // texels are still copied out of the mapping, to the image or to
+    // the target. Readers can share the cache.
+    SPtr<DiskCache> imageCache;
   };
 
   struct ImageOptions {
@@ -34,11 +52,93 @@ class DataReader
     Str uri;
 
     u8 alphaPadding = 0xff;
+
+    // Threads used to decode images split in independent segments,
+    // zero uses all the hardware threads.
+    u32 threadCount = 0u;
+
+    // Checks the chunk CRCs, the zlib Adler-32 and the Zstandard frame
+    // checksums while decoding, corrupt data throws.
+    bool verifyChecksums = false;
+
+    // Images larger than this on either side are scaled down to fit,
+    // keeping their aspect ratio. Files with mips drop their largest
+    // levels instead, without reading them. Zero keeps the full size.
+    // Only used by ReadImage.
+    u32 maxDimension = 0u;
+
+    // Fills the texels with the full mip chain, down to 1x1, when the
+    // file has a single level of plain texels. Only used by ReadImage.
+    bool generateMips = false;
+
+    // The color channels are sRGB encoded, so mips are averaged in
+    // linear space. Always the case for the sRGB formats.
+    bool srgb = false;
+
+    // Block compresses every mip to BC1, BC3, BC4, BC5 or BC7 on
+    // threadCount threads, single channel images always use BC4.
+    // sRGB images get the sRGB variant of the format.
+    // UNDEFINED keeps the texels uncompressed, images that are already
+    // block compressed are left as they are.
+    Format blockFormat = Format::UNDEFINED;
+  };
+
+  // Memory the texels are decoded to, rows are rowPitch bytes apart.
+  // A row pitch of zero means tightly packed rows.
+  // An empty target stops after reading the image header.
+  // DDS and KTX2 files fill every mip of every layer, tightly packed,
+  // when the target has room for them, otherwise only the first level.
+  struct ImageTarget {
+    Span<u8> texels;
+    u64      rowPitch = 0u;
+
+    // Leaves out the largest mips of every layer, the texels hold the
+    // rest of the chain tightly packed.
+    u32 skipMips = 0u;
   };
 
+  // Called once the image format and size are known, the image has no
+  // texels yet.
+  using ImageTargetQuery =
+    std::function<ImageTarget(const data::Image& image)>;
+
   struct ModelOptions {
     Opt<Str>      uri;
     Opt<fs::path> basePath;
+
+    // When false, only the document is read. Buffers and images get
+    // their uri but no data and no header, so the meshes, materials
+    // and textures can be listed without reading any other file.
+    // The document is read on demand, the values of the sections that
+    // are not listed, like animations and extras, are skipped without
+    // being parsed or checked.
+    bool readAssets = true;
+
+    // When false, images stored in external files are not decoded.
+    // Only their header is read and the uri is set to the file path,
+    // so they can be decoded later with ReadImageInto.
+    bool decodeImages = true;
+
+    // Generates the mip chain of the decoded images. Images used as
+    // base color or emissive textures are filtered as sRGB.
+    bool generateMips = false;
+
+    // Block compresses the decoded images by how the materials use
+    // them: sRGB BC7 for colors, BC5 for normal maps, BC4 for single
+    // channel images and BC7 for the rest.
+    bool compressImages = false;
+
+    // Colors use BC1 instead of BC7, half the size but with a lower
+    // quality and only 1-bit alpha.
+    bool preferBC1 = false;
+
+    // Largest side of the decoded images, see ImageOptions.
+    u32 maxImageDimension = 0u;
+
+    // Bytes the decoded images can take together, mips included. Over
+    // budget, the largest side allowed is halved until they fit, which
+    // is decided from the image headers alone. Zero means no budget.
+    u64 imageBudget = 0u;
   };
 
 public:
@@ -51,6 +151,33 @@ class DataReader
   data::Image
   ReadImage(const fs::path& path, const ImageOptions& options);
 
+  // Decodes the texels straight to caller memory, like a mapped
+  // staging buffer. The returned image has no texels.
+  data::Image ReadImageInto(
+    std::istream& src, const ImageOptions& options,
+    const ImageTargetQuery& query);
+  data::Image ReadImageInto(
+    Span<u8 const> src, const ImageOptions& options,
+    const ImageTargetQuery& query);
+  data::Image ReadImageInto(
+    const fs::path& path, const ImageOptions& options,
+    const ImageTargetQuery& query);
+
+  data::Image ReadImageInto(
+    std::istream& src, const ImageOptions& options,
+    const ImageTarget& target);
+  data::Image ReadImageInto(
+    Span<u8 const> src, const ImageOptions& options,
+    const ImageTarget& target);
+  data::Image ReadImageInto(
+    const fs::path& path, const ImageOptions& options,
+    const ImageTarget& target);
+
+  // Bytes of the texels ReadImage returns with these options, from the
+  // image header alone.
+  u64
+  GetImportSize(const data::Image& header, const ImageOptions& options);
+
   data::Model ReadModel(std::istream& src, const ModelOptions& options);
   data::Model
   ReadModel(Span<u8 const> src, const ModelOptions& options);
@@ -58,20 +185,64 @@ class DataReader
   ReadModel(const fs::path& path, const ModelOptions& options);
 
 private:
+  data::Image
+  decodeImage(std::istream& src, const ImageOptions& options);
+  data::Image decodeImageInto(
+    std::istream& src, const ImageOptions& options,
+    const ImageTargetQuery& query);
+
   bool        isPng(std::istream& str);
-  data::Image readPng(std::istream& str, const ImageOptions& options);
+  data::Image readPng(
+    std::istream& str, const ImageOptions& options,
+    const ImageTargetQuery& query);
+
+  bool        isJpeg(std::istream& str);
+  data::Image readJpeg(
+    std::istream& str, const ImageOptions& options,
+    const ImageTargetQuery& query);
+
+  bool        isDds(std::istream& str);
+  data::Image readDds(
+    std::istream& str, const ImageOptions& options,
+    const ImageTargetQuery& query);
+
+  bool        isKtx2(std::istream& str);
+  data::Image readKtx2(
+    std::istream& str, const ImageOptions& options,
+    const ImageTargetQuery& query);
+
+  bool        isHdr(std::istream& str);
+  data::Image readHdr(
+    std::istream& str, const ImageOptions& options,
+    const ImageTargetQuery& query);
+
+  // Where each mip of each layer goes in the target, layer by layer.
+  // The levels that don't fit get an empty target.
+  Arr<ImageTarget>
+  getLevelTargets(const data::Image& image, const ImageTarget& target);
+
+  // Copies tightly packed texels, every mip of every layer, to the
+  // levels of the target.
+  void copyToTarget(
+    const data::Image& image, Span<u8 const> texels,
+    const ImageTarget& target);
+
+  void generateMips(data::Image& image, bool srgb);
+  void resizeImage(data::Image& image, UInt2 size, bool srgb);
+  void compressImage(
+    data::Image& image, Format format, bool srgb, u32 threadCount);
 
   bool isGLTF(std::istream& src);
   bool isBinaryGLTF(std::istream& src);
 
+  data::Model readGLTF(std::istream& src, const ModelOptions& options);
   data::Model
-  readGLTF(std::istream& src, const ModelOptions& options = {});
-  data::Model
-  readBinaryGLTF(std::istream& src, const ModelOptions& options = {});
+  readBinaryGLTF(std::istream& src, const ModelOptions& options);
 
 private:
-  UriFilter  m_uriFilter;
-  FileReader m_fileReader;
+  UriFilterByKind m_uriFilter;
+  FileReader      m_fileReader;
+  SPtr<DiskCache> m_imageCache;
 };
 
 } // namespace vd
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "vuldir/Data.hpp"
+#include "vuldir/api/Api.hpp"
+#include "vuldir/core/Core.hpp"
+
+namespace vd {
+
+// Images are written as PNG.
+class DataWriter
+{
+public:
+  struct ImageOptions {
+    // 0 stores the data uncompressed, 1 only encodes runs of the same
+    // byte and 2 to 9 search longer and longer hash chains. The lower
+    // levels favor speed over size.
+    u32 level = 1u;
+
+    // Writes only the color channels, for captures where the alpha has
+    // no meaning.
+    bool ignoreAlpha = false;
+  };
+
+  // Texels to encode, rows are rowPitch bytes apart, like a mapped
+  // readback buffer. A row pitch of zero means tightly packed rows.
+  // Float formats hold linear colors, they are written as 8-bit sRGB.
+  struct ImageSource {
+    Format         format;
+    UInt2          size;
+    Span<u8 const> texels;
+    u64            rowPitch = 0u;
+  };
+
+public:
+  Arr<u8>
+  WriteImage(const ImageSource& src, const ImageOptions& options);
+  void WriteImage(
+    std::ostream& dst, const ImageSource& src,
+    const ImageOptions& options);
+  void WriteImage(
+    const fs::path& path, const ImageSource& src,
+    const ImageOptions& options);
+
+  Arr<u8>
+  WriteImage(const data::Image& image, const ImageOptions& options);
+  void WriteImage(
+    std::ostream& dst, const data::Image& image,
+    const ImageOptions& options);
+  void WriteImage(
+    const fs::path& path, const data::Image& image,
+    const ImageOptions& options);
+
+private:
+  Arr<u8> writePng(const ImageSource& src, const ImageOptions& options);
+};
+
+} // namespace vd
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "vuldir/core/Core.hpp"
+
+namespace vd {
+
+// Files kept in a directory under 128-bit keys, for data that takes a
+// while to produce again like decoded images. Entries are written to
+// a temporary file and renamed into place, so they are never seen half
+// written, and are mapped when found. The least recently used entries
+// are removed while the directory holds more than the budget.
+//
+// Several caches, in this process or others, can share a directory.
+// Failures to write or remove entries are logged, the cache is best
+// effort.
+class DiskCache
+{
+public:
+  struct Desc {
+    fs::path directory;
+    u64      budget = 1ull << 30;
+  };
+
+  // Entries and size are as of the last scan of the directory, plus
+  // the entries added since.
+  struct Stats {
+    u64 hits      = 0u;
+    u64 misses    = 0u;
+    u64 evictions = 0u;
+    u64 entries   = 0u;
+    u64 size      = 0u;
+  };
+
+  // Streams the contents of a new entry.
+  using Writer = std::function<void(std::ostream& dst)>;
+
+public:
+  VD_NONMOVABLE(DiskCache);
+
+  DiskCache(const Desc& desc);
+
+  // The mapping is empty when the entry is missing.
+  MappedFile Find(const Hash128& key);
+
+  // Replaces any entry with the same key. Errors thrown by the writer
+  // leave the cache as it was and are rethrown.
+  void Add(const Hash128& key, const Writer& writer);
+
+  void  SetBudget(u64 budget);
+  Stats GetStats() const;
+
+  // Removes every entry.
+  void Clear();
+
+private:
+  fs::path getPath(const Hash128& key) const;
+
+  // Rescans the directory, entries written by other caches included.
+  // Temporary files left by writers that crashed are removed.
+  void evict(u64 budget);
+
+private:
+  mutable std::mutex m_mutex;
+
+  fs::path m_directory;
+  u64      m_budget;
+  Stats    m_stats;
+
+  // Temporary files are named after the cache and a counter.
+  u64 m_tempId;
+  u64 m_tempCount;
+};
+
+} // namespace vd
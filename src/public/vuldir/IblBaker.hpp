@@ -0,0 +1,59 @@
+#pragma once
+
+#include "vuldir/Data.hpp"
+#include "vuldir/core/Core.hpp"
+
+namespace vd {
+
+// Prefilters an environment map for image based lighting, with the
+// split-sum approximation: a diffuse irradiance cube, a specular cube
+// whose mips hold rising roughness and the lookup table of the BRDF
+// scale and bias. Baking runs on the CPU across threads, it takes a
+// while for large maps so the results are meant to be cooked once.
+class IblBaker
+{
+public:
+  struct Options {
+    // Face size of the irradiance cube.
+    u32 irradianceSize = 32u;
+
+    // Face size and levels of the specular cube, the roughness goes
+    // from zero at the first mip to one at the last.
+    u32 specularSize = 256u;
+    u32 specularMips = 6u;
+
+    // GGX samples for each texel of the specular cube, the source is
+    // filtered by how much each sample covers.
+    u32 sampleCount = 64u;
+
+    // Side of the BRDF lookup table.
+    u32 brdfSize = 128u;
+
+    // Zero uses all the hardware threads.
+    u32 threadCount = 0u;
+  };
+
+  // Cubes are R16G16B16A16_SFLOAT with six layers, in +X, -X, +Y, -Y,
+  // +Z, -Z order. The irradiance is divided by pi, ready to multiply by
+  // the albedo. The lookup table is R16G16_SFLOAT, indexed by N.V along
+  // the rows and by roughness down the columns.
+  struct Result {
+    data::Image irradiance;
+    data::Image specular;
+    data::Image brdf;
+  };
+
+public:
+  // The environment is either a cube, six layers, or an
+  // equirectangular panorama with +Y up and -Z at its center. Only the
+  // first mip is used, plain formats are converted to linear floats.
+  Result Bake(const data::Image& environment, const Options& options);
+
+  // Loads the cooked file when it was baked from the same environment
+  // file with the same options, otherwise bakes and writes it.
+  Result Bake(
+    const fs::path& environment, const fs::path& cooked,
+    const Options& options);
+};
+
+} // namespace vd
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "vuldir/api/Types.hpp"
+#include "vuldir/core/Core.hpp"
+
+namespace vd {
+
+// Texel layouts the converter reads and writes. Packed RGB has no
+// matching Format, it only exists in files.
+enum class PixelFormat : u8 {
+  UNDEFINED,
+  R8_UNORM,
+  R8G8B8_UNORM,
+  R8G8B8_SRGB,
+  B8G8R8_UNORM,
+  B8G8R8_SRGB,
+  R8G8B8A8_UNORM,
+  R8G8B8A8_SRGB,
+  B8G8R8A8_UNORM,
+  B8G8R8A8_SRGB,
+  R16_UNORM,
+  R16G16B16A16_UNORM,
+  R16G16B16A16_SFLOAT,
+  R32G32B32A32_SFLOAT
+};
+
+// UNDEFINED for the formats the converter does not handle.
+PixelFormat getPixelFormat(Format format);
+u32         getPixelSize(PixelFormat format);
+
+// Converts rows of texels between pixel formats, keeping the color:
+// sRGB values are decoded to linear and encoded again, single channel
+// formats are gray and are replicated to RGB, while only red is kept
+// going the other way. Missing alpha is filled in.
+//
+// Conversions are split in passes over short runs of texels, each
+// picked once for the CPU. The converter has no mutable state, rows
+// can be converted from any thread as they arrive.
+class PixelConverter
+{
+public:
+  PixelConverter(PixelFormat src, PixelFormat dst, f32 alpha = 1.0f);
+  PixelConverter(Format src, Format dst, f32 alpha = 1.0f);
+
+  static bool IsSupported(Format src, Format dst);
+
+  // Rows must not overlap.
+  void ConvertRow(u8* dst, const u8* src, u32 width) const;
+
+  // A row pitch of zero means tightly packed rows.
+  void Convert(
+    Span<u8> dst, u64 dstPitch, Span<u8 const> src, u64 srcPitch,
+    UInt2 size) const;
+
+  PixelFormat GetSrcFormat() const { return m_src; }
+  PixelFormat GetDstFormat() const { return m_dst; }
+
+public:
+  // Byte moves within a group of texels. Bytes marked with -1 are
+  // taken from the fill pattern.
+  struct Shuffle {
+    u32          srcSize;
+    u32          dstSize;
+    u32          groupSize;
+    SArr<i8, 16> mask;
+    SArr<u8, 16> fill;
+  };
+
+  using PassFn = void (*)(
+    u8* dst, const u8* src, u32 count, const Shuffle& shuffle);
+
+private:
+  struct Pass {
+    PassFn fn;
+    u32    dstSize;
+    u32    shuffle;
+  };
+
+  void addShuffle(PixelFormat src, PixelFormat dst, f32 alpha);
+  void addPass(PassFn fn, u32 dstSize, u32 shuffle = 0u);
+
+private:
+  PixelFormat m_src;
+  PixelFormat m_dst;
+  u32         m_srcSize;
+
+  // At most one shuffle is needed on each side of the value passes.
+  SArr<Shuffle, 2> m_shuffles;
+  u32              m_shuffleCount;
+  SArr<Pass, 4>    m_passes;
+  u32              m_passCount;
+};
+
+// Half floats are rounded to nearest even, like the hardware does.
+void convertFloat32ToFloat16(Span<u16> dst, Span<f32 const> src);
+void convertFloat16ToFloat32(Span<f32> dst, Span<u16 const> src);
+
+} // namespace vd
@@ -6,5 +6,10 @@
 #include "vuldir/api/Api.hpp"
 
 // Vuldir high-level types
+#include "vuldir/AssetCache.hpp"
 #include "vuldir/Data.hpp"
 #include "vuldir/DataReader.hpp"
+#include "vuldir/DataWriter.hpp"
+#include "vuldir/DiskCache.hpp"
+#include "vuldir/IblBaker.hpp"
+#include "vuldir/PixelConverter.hpp"
@@ -8,6 +8,7 @@
 #include "vuldir/api/PhysicalDevice.hpp"
 #include "vuldir/api/Pipeline.hpp"
 #include "vuldir/api/RenderContext.hpp"
+#include "vuldir/api/ResourceRegistry.hpp"
 #include "vuldir/api/Sampler.hpp"
 #include "vuldir/api/Shader.hpp"
 #include "vuldir/api/Swapchain.hpp"
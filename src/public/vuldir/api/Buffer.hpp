@@ -63,6 +63,7 @@ class Buffer
   MemoryType GetMemoryType() const { return m_desc.memoryType; }
 
   bool Write(Span<u8 const> data);
+  bool Write(u64 size, const MemoryPool::Writer& writer);
   template<typename T>
   bool Write(const T& data)
   {
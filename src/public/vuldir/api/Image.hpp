@@ -20,7 +20,9 @@ class Image
     Flags<ResourceUsage> usage;
     Format               format;
     Dimension            dimension;
-    UInt3                extent;
+    // The third extent is the depth of 3D images and the array layers
+    // of the others.
+    UInt3 extent;
 
     Opt<ViewType> defaultView;
 
@@ -74,6 +76,13 @@ class Image
   ResourceState GetState() const { return m_state; }
   void          SetState(ResourceState state) { m_state = state; }
 
+  u32 GetLayerCount() const
+  {
+    return m_desc.dimension == Dimension::e3D
+             ? 1u
+             : std::max(m_desc.extent[2], 1u);
+  }
+
   u32         AddView(ViewType type, const ViewRange& range = {});
   const View* GetView(ViewType type, u32 index = 0u) const;
   const View* GetView() const;
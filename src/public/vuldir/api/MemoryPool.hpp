@@ -27,6 +27,11 @@ class MemoryPool
     void Invalidate() { pool = nullptr; }
   };
 
+  // Fills mapped memory in place, avoiding an intermediate copy.
+  // The writer may throw, e.g. when decoding corrupted data, the
+  // memory is unmapped and the exception passed on.
+  using Writer = std::function<void(Span<u8> dst)>;
+
 public:
   VD_NONMOVABLE(MemoryPool);
 
@@ -39,6 +44,7 @@ class MemoryPool
   void       Free(const Allocation& allocation);
 
   bool Write(Allocation& alloc, Span<u8 const> data);
+  bool Write(Allocation& alloc, u64 size, const Writer& writer);
 
   MemoryType GetType() const { return m_type; }
 
@@ -18,6 +18,11 @@ class RenderContext
 
   struct Transfer {};
 
+  // Fills the mapped upload memory of an image. Rows are rowPitch bytes
+  // apart, which can be larger than the texel data of a row depending
+  // on the API alignment requirements.
+  using ImageWriter = std::function<void(Span<u8> dst, u64 rowPitch)>;
+
 public:
   VD_NONMOVABLE(RenderContext);
 
@@ -40,6 +45,9 @@ class RenderContext
     return Write(buffer, getBytes(data));
   }
 
+  // The data can hold every mip level of every layer of the image,
+  // layer by layer and tightly packed like data::Image, otherwise only
+  // the first level of the first layer is written.
   bool Write(Image& image, Span<u8 const> data);
   template<typename T>
   bool Write(Image& image, const T& data)
@@ -47,6 +55,9 @@ class RenderContext
     return Write(image, getBytes(data));
   }
 
+  // Lets the caller decode straight into the staging memory.
+  bool WriteMapped(Image& image, const ImageWriter& writer);
+
   void Submit(
     Arr<CommandBuffer*> cmdbufs, Arr<Fence*> waits = {},
     Arr<Fence*>  signals      = {},
@@ -55,8 +66,28 @@ class RenderContext
   void WaitInFlightOperations();
 
 private:
-  Buffer& getStagingBuffer(u64 size);
-  Fence&  getInFlightFence();
+  // Where a mip level of a layer goes in the staging buffer.
+  struct StagingRegion {
+    u32 mip;
+    u32 layer;
+    u64 offset;
+    u64 rowPitch;
+    u64 rowSize;
+    u64 rowCount;
+  };
+
+  using StagingWriter = std::function<void(
+    Span<u8> dst, const Arr<StagingRegion>& regions)>;
+
+  // Regions are ordered layer by layer, then by mip.
+  bool writeStaging(
+    Image& image, u32 mipCount, u32 layerCount,
+    const StagingWriter& writer);
+
+  Buffer&            getStagingBuffer(u64 size);
+  Arr<StagingRegion> getStagingLayout(
+    const Image& image, u32 mipCount, u32 layerCount) const;
+  Fence& getInFlightFence();
 
 private:
   Device& m_device;
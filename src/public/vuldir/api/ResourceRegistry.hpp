@@ -0,0 +1,94 @@
+#pragma once
+
+#include "vuldir/api/Buffer.hpp"
+#include "vuldir/api/Common.hpp"
+#include "vuldir/api/Image.hpp"
+#include "vuldir/api/RenderContext.hpp"
+
+namespace vd {
+
+class Device;
+
+// Shares images and buffers with identical contents. Resources are
+// keyed on the XXH3-128 hash of their data and on their description,
+// so identical payloads map to a single resource and bindless index.
+// The registry owns the resources until it is destroyed. The Get
+// functions throw when the upload fails, and register nothing then.
+class ResourceRegistry
+{
+public:
+  struct Stats {
+    u64 imageCount  = 0u;
+    u64 bufferCount = 0u;
+    u64 imageHits   = 0u;
+    u64 bufferHits  = 0u;
+
+    // Bytes that did not need to be allocated and uploaded again.
+    u64 bytesSaved = 0u;
+  };
+
+public:
+  VD_NONMOVABLE(ResourceRegistry);
+
+  ResourceRegistry(Device& device);
+  ~ResourceRegistry();
+
+  // The texels are laid out as expected by RenderContext::Write.
+  Image& GetImage(
+    RenderContext& ctx, const Image::Desc& desc, Span<u8 const> texels);
+
+  // Images decoded straight into the staging memory are keyed on their
+  // uri, the writer is only called the first time.
+  Image& GetImage(
+    RenderContext& ctx, const Image::Desc& desc, const Str& uri,
+    const RenderContext::ImageWriter& writer);
+
+  // The size of the description is ignored, the data size is used.
+  Buffer& GetBuffer(
+    RenderContext& ctx, const Buffer::Desc& desc, Span<u8 const> data);
+  template<typename T>
+  Buffer& GetBuffer(
+    RenderContext& ctx, const Buffer::Desc& desc, const T& data)
+  {
+    return GetBuffer(ctx, desc, getBytes(data));
+  }
+
+  const Stats& GetStats() const { return m_stats; }
+
+private:
+  // Every field of the descriptions that changes what is created.
+  struct Key {
+    Hash128       hash;
+    u64           size;
+    u64           usage;
+    u32           format;
+    u32           dimension;
+    u32           extent[3];
+    u32           samples;
+    u32           mips;
+    u32           memoryType;
+    Opt<ViewType> defaultView;
+    bool          isStaging;
+    bool          isUri;
+
+    bool operator==(const Key&) const = default;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const
+    {
+      return static_cast<size_t>(key.hash.lo ^ key.size);
+    }
+  };
+
+  Key getImageKey(const Image::Desc& desc, const Hash128& hash) const;
+
+private:
+  Device& m_device;
+  Stats   m_stats;
+
+  std::unordered_map<Key, UPtr<Image>, KeyHash>  m_images;
+  std::unordered_map<Key, UPtr<Buffer>, KeyHash> m_buffers;
+};
+
+} // namespace vd
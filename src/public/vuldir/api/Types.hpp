@@ -226,6 +226,8 @@ enum class Format : u32 {
   // UV
   VD_API_VALUE(
     R32G32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, DXGI_FORMAT_R32G32_FLOAT),
+  VD_API_VALUE(
+    R16G16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, DXGI_FORMAT_R16G16_FLOAT),
 
   // Color: R8
   VD_API_VALUE(R8_UNORM, VK_FORMAT_R8_UNORM, DXGI_FORMAT_R8_UNORM),
@@ -301,6 +303,38 @@ enum class Format : u32 {
   VD_API_VALUE(
     R32G32B32A32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT,
     DXGI_FORMAT_R32G32B32A32_FLOAT),
+
+  // Block compressed, 4x4 texels per block
+  VD_API_VALUE(
+    BC1_RGBA_UNORM, VK_FORMAT_BC1_RGBA_UNORM_BLOCK,
+    DXGI_FORMAT_BC1_UNORM),
+  VD_API_VALUE(
+    BC1_RGBA_SRGB, VK_FORMAT_BC1_RGBA_SRGB_BLOCK,
+    DXGI_FORMAT_BC1_UNORM_SRGB),
+  VD_API_VALUE(
+    BC2_UNORM, VK_FORMAT_BC2_UNORM_BLOCK, DXGI_FORMAT_BC2_UNORM),
+  VD_API_VALUE(
+    BC2_SRGB, VK_FORMAT_BC2_SRGB_BLOCK, DXGI_FORMAT_BC2_UNORM_SRGB),
+  VD_API_VALUE(
+    BC3_UNORM, VK_FORMAT_BC3_UNORM_BLOCK, DXGI_FORMAT_BC3_UNORM),
+  VD_API_VALUE(
+    BC3_SRGB, VK_FORMAT_BC3_SRGB_BLOCK, DXGI_FORMAT_BC3_UNORM_SRGB),
+  VD_API_VALUE(
+    BC4_UNORM, VK_FORMAT_BC4_UNORM_BLOCK, DXGI_FORMAT_BC4_UNORM),
+  VD_API_VALUE(
+    BC4_SNORM, VK_FORMAT_BC4_SNORM_BLOCK, DXGI_FORMAT_BC4_SNORM),
+  VD_API_VALUE(
+    BC5_UNORM, VK_FORMAT_BC5_UNORM_BLOCK, DXGI_FORMAT_BC5_UNORM),
+  VD_API_VALUE(
+    BC5_SNORM, VK_FORMAT_BC5_SNORM_BLOCK, DXGI_FORMAT_BC5_SNORM),
+  VD_API_VALUE(
+    BC6H_UFLOAT, VK_FORMAT_BC6H_UFLOAT_BLOCK, DXGI_FORMAT_BC6H_UF16),
+  VD_API_VALUE(
+    BC6H_SFLOAT, VK_FORMAT_BC6H_SFLOAT_BLOCK, DXGI_FORMAT_BC6H_SF16),
+  VD_API_VALUE(
+    BC7_UNORM, VK_FORMAT_BC7_UNORM_BLOCK, DXGI_FORMAT_BC7_UNORM),
+  VD_API_VALUE(
+    BC7_SRGB, VK_FORMAT_BC7_SRGB_BLOCK, DXGI_FORMAT_BC7_UNORM_SRGB),
 };
 VD_API_VALUE_CONVERTER(Format, VkFormat, DXGI_FORMAT);
 
@@ -516,6 +550,7 @@ struct StencilOpState {
   u32       reference;
 };
 
+// Bytes per texel, or per block for the block compressed formats.
 inline u32 getFormatSize(Format fmt)
 {
   switch(fmt) {
@@ -536,6 +571,7 @@ inline u32 getFormatSize(Format fmt)
       return 2u;
     case vd::Format::D32_SFLOAT:
     case vd::Format::D24_UNORM_S8_UINT:
+    case vd::Format::R16G16_SFLOAT:
       return 4u;
     case vd::Format::R8G8B8A8_UNORM:
     case vd::Format::R8G8B8A8_SNORM:
@@ -564,11 +600,105 @@ inline u32 getFormatSize(Format fmt)
     case vd::Format::R32G32B32A32_SINT:
     case vd::Format::R32G32B32A32_SFLOAT:
       return 16u;
+    case vd::Format::BC1_RGBA_UNORM:
+    case vd::Format::BC1_RGBA_SRGB:
+    case vd::Format::BC4_UNORM:
+    case vd::Format::BC4_SNORM:
+      return 8u;
+    case vd::Format::BC2_UNORM:
+    case vd::Format::BC2_SRGB:
+    case vd::Format::BC3_UNORM:
+    case vd::Format::BC3_SRGB:
+    case vd::Format::BC5_UNORM:
+    case vd::Format::BC5_SNORM:
+    case vd::Format::BC6H_UFLOAT:
+    case vd::Format::BC6H_SFLOAT:
+    case vd::Format::BC7_UNORM:
+    case vd::Format::BC7_SRGB:
+      return 16u;
     default:
       throw std::runtime_error("Invalid format");
   }
 }
 
+inline constexpr bool isBlockFormat(Format fmt)
+{
+  switch(fmt) {
+    case Format::BC1_RGBA_UNORM:
+    case Format::BC1_RGBA_SRGB:
+    case Format::BC2_UNORM:
+    case Format::BC2_SRGB:
+    case Format::BC3_UNORM:
+    case Format::BC3_SRGB:
+    case Format::BC4_UNORM:
+    case Format::BC4_SNORM:
+    case Format::BC5_UNORM:
+    case Format::BC5_SNORM:
+    case Format::BC6H_UFLOAT:
+    case Format::BC6H_SFLOAT:
+    case Format::BC7_UNORM:
+    case Format::BC7_SRGB:
+      return true;
+    default:
+      return false;
+  }
+}
+
+inline constexpr bool isSrgbFormat(Format fmt)
+{
+  switch(fmt) {
+    case Format::R8G8B8A8_SRGB:
+    case Format::B8G8R8A8_SRGB:
+    case Format::BC1_RGBA_SRGB:
+    case Format::BC2_SRGB:
+    case Format::BC3_SRGB:
+    case Format::BC7_SRGB:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The sRGB variant of a format, the format itself when it has none.
+inline constexpr Format getSrgbFormat(Format fmt)
+{
+  switch(fmt) {
+    case Format::R8G8B8A8_UNORM:
+      return Format::R8G8B8A8_SRGB;
+    case Format::B8G8R8A8_UNORM:
+      return Format::B8G8R8A8_SRGB;
+    case Format::BC1_RGBA_UNORM:
+      return Format::BC1_RGBA_SRGB;
+    case Format::BC2_UNORM:
+      return Format::BC2_SRGB;
+    case Format::BC3_UNORM:
+      return Format::BC3_SRGB;
+    case Format::BC7_UNORM:
+      return Format::BC7_SRGB;
+    default:
+      return fmt;
+  }
+}
+
+// Width and height of a block, 1 for the formats with plain texels.
+inline constexpr u32 getFormatBlockExtent(Format fmt)
+{
+  return isBlockFormat(fmt) ? 4u : 1u;
+}
+
+// Bytes of a row of texels, or of a row of blocks.
+inline u64 getFormatRowSize(Format fmt, u32 width)
+{
+  return toU64(divideRoundingUp(width, getFormatBlockExtent(fmt))) *
+         getFormatSize(fmt);
+}
+
+// Rows of texels, or rows of blocks, for the given height.
+inline u32 getFormatRowCount(Format fmt, u32 height)
+{
+  return divideRoundingUp(height, getFormatBlockExtent(fmt));
+}
+
 inline constexpr bool isStencilFormat(Format v)
 {
   switch(v) {
@@ -594,6 +724,17 @@ inline constexpr ImageAspect getFormatAspect(Format fmt)
   }
 }
 
+// Levels of a full mip chain, down to 1x1.
+inline constexpr u32 getMipCount(u32 width, u32 height, u32 depth = 1u)
+{
+  return toU32(std::bit_width(std::max({width, height, depth, 1u})));
+}
+
+inline constexpr u32 getMipExtent(u32 extent, u32 mip)
+{
+  return std::max(extent >> mip, 1u);
+}
+
 struct DepthStencil {
   f32 depth;
   u32 stencil;
@@ -0,0 +1,666 @@
+#pragma once
+
+#include "vuldir/core/Cpu.hpp"
+#include "vuldir/core/STL.hpp"
+#include "vuldir/core/Types.hpp"
+#include "vuldir/core/Uti.hpp"
+
+namespace vd {
+
+// CRC-32 as used by PNG, zlib and gzip (reflected 0xedb88320). Both
+// checksums can be updated a piece at a time by passing the previous
+// value back in.
+
+// Slice by 8 tables, entry [k][b] is the CRC of b followed by k zeros.
+inline constexpr auto Crc32Tables = [] {
+  SArr<SArr<u32, 256>, 8> ret = {};
+  for(u32 idx = 0u; idx < 256u; ++idx) {
+    u32 crc = idx;
+    for(u32 bit = 0u; bit < 8u; ++bit)
+      crc = (crc >> 1) ^ ((crc & 1u) ? 0xedb88320u : 0u);
+    ret[0][idx] = crc;
+  }
+  for(u32 idx = 0u; idx < 256u; ++idx)
+    for(u32 k = 1u; k < 8u; ++k)
+      ret[k][idx] =
+        (ret[k - 1u][idx] >> 8) ^ ret[0][ret[k - 1u][idx] & 0xffu];
+  return ret;
+}();
+
+inline u32 crc32SliceBy8(const u8* data, u64 size, u32 crc)
+{
+  const auto& t = Crc32Tables;
+
+  for(; size >= 8u; data += 8, size -= 8u) {
+    u32 lo = crc ^ (toU32(data[0]) | toU32(data[1]) << 8 |
+                    toU32(data[2]) << 16 | toU32(data[3]) << 24);
+    u32 hi = toU32(data[4]) | toU32(data[5]) << 8 |
+             toU32(data[6]) << 16 | toU32(data[7]) << 24;
+
+    crc = t[7][lo & 0xffu] ^ t[6][(lo >> 8) & 0xffu] ^
+          t[5][(lo >> 16) & 0xffu] ^ t[4][lo >> 24] ^
+          t[3][hi & 0xffu] ^ t[2][(hi >> 8) & 0xffu] ^
+          t[1][(hi >> 16) & 0xffu] ^ t[0][hi >> 24];
+  }
+
+  for(; size > 0u; ++data, --size)
+    crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xffu];
+
+  return crc;
+}
+
+#ifdef VD_ARCH_X64
+VD_TARGET("pclmul")
+inline __m128i crc32FoldStep(__m128i x, __m128i k, __m128i next)
+{
+  __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+  __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+  return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+}
+
+// Carry-less multiplication folding from Intel's "Fast CRC Computation
+// Using PCLMULQDQ", with the bit reflected constants. Needs at least 64
+// bytes and a multiple of 16.
+VD_TARGET("pclmul,sse4.1")
+inline u32 crc32Fold(const u8* data, u64 size, u32 crc)
+{
+  const __m128i k1k2 = _mm_set_epi64x(0x1c6e41596, 0x154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+  const __m128i k5   = _mm_set_epi64x(0, 0x163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x1f7011641, 0x1db710641);
+  const __m128i mask = _mm_setr_epi32(-1, 0, -1, 0);
+
+  const auto load = [](const u8* src) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  };
+
+  __m128i x0 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(toI32(crc)));
+  __m128i x1 = load(data + 16);
+  __m128i x2 = load(data + 32);
+  __m128i x3 = load(data + 48);
+  data += 64;
+  size -= 64u;
+
+  // Four lanes, 64 bytes at a time.
+  for(; size >= 64u; data += 64, size -= 64u) {
+    x0 = crc32FoldStep(x0, k1k2, load(data));
+    x1 = crc32FoldStep(x1, k1k2, load(data + 16));
+    x2 = crc32FoldStep(x2, k1k2, load(data + 32));
+    x3 = crc32FoldStep(x3, k1k2, load(data + 48));
+  }
+
+  x0 = crc32FoldStep(x0, k3k4, x1);
+  x0 = crc32FoldStep(x0, k3k4, x2);
+  x0 = crc32FoldStep(x0, k3k4, x3);
+
+  for(; size >= 16u; data += 16, size -= 16u)
+    x0 = crc32FoldStep(x0, k3k4, load(data));
+
+  // 128 to 64 bits.
+  __m128i x = _mm_clmulepi64_si128(x0, k3k4, 0x10);
+  x0        = _mm_xor_si128(_mm_srli_si128(x0, 8), x);
+
+  // 64 to 32 bits.
+  x  = _mm_srli_si128(x0, 4);
+  x0 = _mm_clmulepi64_si128(_mm_and_si128(x0, mask), k5, 0x00);
+  x0 = _mm_xor_si128(x0, x);
+
+  // Barrett reduction.
+  x = _mm_clmulepi64_si128(_mm_and_si128(x0, mask), poly, 0x10);
+  x = _mm_clmulepi64_si128(_mm_and_si128(x, mask), poly, 0x00);
+  x0 = _mm_xor_si128(x0, x);
+
+  return static_cast<u32>(_mm_extract_epi32(x0, 1));
+}
+#endif
+
+inline u32 crc32(Span<u8 const> data, u32 crc = 0u)
+{
+  const u8* src  = data.data();
+  u64       size = data.size();
+
+  crc = ~crc;
+
+#ifdef VD_ARCH_X64
+  static const bool hasFold =
+    getCpuFeatures().pclmul && getCpuFeatures().sse41;
+
+  if(hasFold && size >= 64u) {
+    u64 foldSize = size & ~u64{15u};
+    crc          = crc32Fold(src, foldSize, crc);
+    src += foldSize;
+    size -= foldSize;
+  }
+#endif
+
+  return ~crc32SliceBy8(src, size, crc);
+}
+
+// Adler-32 as used by zlib.
+inline constexpr u32 Adler32Base = 65521u;
+
+// Bytes that can be summed before the sums may overflow 32 bits.
+inline constexpr u64 Adler32BlockSize = 5552u;
+
+inline u32 adler32Scalar(const u8* data, u64 size, u32 adler)
+{
+  u32 s1 = adler & 0xffffu;
+  u32 s2 = adler >> 16;
+
+  while(size > 0u) {
+    u64 count = std::min(size, Adler32BlockSize);
+    size -= count;
+
+    for(; count > 0u; ++data, --count) {
+      s1 += *data;
+      s2 += s1;
+    }
+
+    s1 %= Adler32Base;
+    s2 %= Adler32Base;
+  }
+
+  return s1 | (s2 << 16);
+}
+
+#ifdef VD_ARCH_X64
+// Sums 32 bytes at a time. The weighted sum for s2 uses a multiply-add
+// with the descending byte positions.
+VD_TARGET("ssse3")
+inline u32 adler32SSSE3(const u8* data, u64 size, u32 adler)
+{
+  const __m128i tap0 = _mm_setr_epi8(
+    32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+  const __m128i tap1 = _mm_setr_epi8(
+    16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+
+  const auto sum = [](__m128i v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return static_cast<u32>(_mm_cvtsi128_si32(v));
+  };
+
+  u32 s1 = adler & 0xffffu;
+  u32 s2 = adler >> 16;
+
+  u64 blocks = size / 32u;
+  size -= blocks * 32u;
+
+  while(blocks > 0u) {
+    u64 count = std::min(blocks, Adler32BlockSize / 32u);
+    blocks -= count;
+
+    // s1 before each block is added 32 times to s2.
+    __m128i prev = _mm_cvtsi32_si128(toI32(s1 * toU32(count)));
+    __m128i v1   = zero;
+    __m128i v2   = _mm_cvtsi32_si128(toI32(s2));
+
+    for(; count > 0u; data += 32, --count) {
+      __m128i b0 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+      __m128i b1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+
+      prev = _mm_add_epi32(prev, v1);
+
+      v1 = _mm_add_epi32(v1, _mm_sad_epu8(b0, zero));
+      v1 = _mm_add_epi32(v1, _mm_sad_epu8(b1, zero));
+
+      v2 = _mm_add_epi32(
+        v2, _mm_madd_epi16(_mm_maddubs_epi16(b0, tap0), ones));
+      v2 = _mm_add_epi32(
+        v2, _mm_madd_epi16(_mm_maddubs_epi16(b1, tap1), ones));
+    }
+
+    v2 = _mm_add_epi32(v2, _mm_slli_epi32(prev, 5));
+
+    s1 = (s1 + sum(v1)) % Adler32Base;
+    s2 = sum(v2) % Adler32Base;
+  }
+
+  return adler32Scalar(data, size, s1 | (s2 << 16));
+}
+#endif
+
+inline u32 adler32(Span<u8 const> data, u32 adler = 1u)
+{
+#ifdef VD_ARCH_X64
+  static const bool hasSSSE3 = getCpuFeatures().ssse3;
+  if(hasSSSE3) return adler32SSSE3(data.data(), data.size(), adler);
+#endif
+
+  return adler32Scalar(data.data(), data.size(), adler);
+}
+
+// Adler-32 of two consecutive pieces, from the checksum of each one and
+// the size of the second.
+inline u32 adler32Combine(u32 adler1, u32 adler2, u64 size2)
+{
+  u32 rem  = toU32(size2 % Adler32Base);
+  u32 sum1 = adler1 & 0xffffu;
+  u32 sum2 = toU32((toU64(rem) * sum1) % Adler32Base);
+
+  sum1 += (adler2 & 0xffffu) + Adler32Base - 1u;
+  sum2 += (adler1 >> 16) + (adler2 >> 16) + Adler32Base - rem;
+
+  if(sum1 >= Adler32Base) sum1 -= Adler32Base;
+  if(sum1 >= Adler32Base) sum1 -= Adler32Base;
+  if(sum2 >= 2u * Adler32Base) sum2 -= 2u * Adler32Base;
+  if(sum2 >= Adler32Base) sum2 -= Adler32Base;
+
+  return sum1 | (sum2 << 16);
+}
+
+// XXH64, the low 32 bits are the Zstandard frame checksum.
+inline constexpr u64 XXH64Prime1 = 0x9e3779b185ebca87ull;
+inline constexpr u64 XXH64Prime2 = 0xc2b2ae3d27d4eb4full;
+inline constexpr u64 XXH64Prime3 = 0x165667b19e3779f9ull;
+inline constexpr u64 XXH64Prime4 = 0x85ebca77c2b2ae63ull;
+inline constexpr u64 XXH64Prime5 = 0x27d4eb2f165667c5ull;
+
+inline u64 xxh64Avalanche(u64 hash)
+{
+  hash ^= hash >> 33;
+  hash *= XXH64Prime2;
+  hash ^= hash >> 29;
+  hash *= XXH64Prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+inline u64 xxh64(Span<u8 const> data, u64 seed = 0u)
+{
+  const auto load = [](const u8* src, auto value) {
+    memcpy(&value, src, sizeof(value));
+    if constexpr(std::endian::native == std::endian::big)
+      value = byteSwap(value);
+    return toU64(value);
+  };
+  const auto round = [](u64 acc, u64 lane) {
+    return std::rotl(acc + lane * XXH64Prime2, 31) * XXH64Prime1;
+  };
+  const auto merge = [&round](u64 acc, u64 value) {
+    return (acc ^ round(0u, value)) * XXH64Prime1 + XXH64Prime4;
+  };
+
+  const u8* src  = data.data();
+  const u8* end  = src + data.size();
+  u64       hash = seed + XXH64Prime5;
+
+  if(data.size() >= 32u) {
+    u64 v1 = seed + XXH64Prime1 + XXH64Prime2;
+    u64 v2 = seed + XXH64Prime2;
+    u64 v3 = seed;
+    u64 v4 = seed - XXH64Prime1;
+
+    for(; end - src >= 32; src += 32) {
+      v1 = round(v1, load(src, u64{}));
+      v2 = round(v2, load(src + 8, u64{}));
+      v3 = round(v3, load(src + 16, u64{}));
+      v4 = round(v4, load(src + 24, u64{}));
+    }
+
+    hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+           std::rotl(v4, 18);
+    hash = merge(merge(merge(merge(hash, v1), v2), v3), v4);
+  }
+
+  hash += data.size();
+
+  for(; end - src >= 8; src += 8)
+    hash = std::rotl(hash ^ round(0u, load(src, u64{})), 27) *
+             XXH64Prime1 +
+           XXH64Prime4;
+  if(end - src >= 4) {
+    hash ^= load(src, u32{}) * XXH64Prime1;
+    hash = std::rotl(hash, 23) * XXH64Prime2 + XXH64Prime3;
+    src += 4;
+  }
+  for(; src != end; ++src)
+    hash = std::rotl(hash ^ (*src * XXH64Prime5), 11) * XXH64Prime1;
+
+  return xxh64Avalanche(hash);
+}
+
+// XXH3 128-bit with the default secret, a fast hash for keying data by
+// its content. The stripe loop has SSE2 and AVX2 versions.
+struct Hash128 {
+  u64 lo = 0u;
+  u64 hi = 0u;
+
+  bool operator==(const Hash128& other) const = default;
+};
+
+inline constexpr u64 XXH32Prime1 = 0x9e3779b1u;
+inline constexpr u64 XXH32Prime2 = 0x85ebca77u;
+inline constexpr u64 XXH32Prime3 = 0xc2b2ae3du;
+
+inline constexpr u64 XXH3StripeSize = 64u;
+inline constexpr u64 XXH3SecretSize = 192u;
+
+inline constexpr u8 XXH3Secret[XXH3SecretSize] = {
+  0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81,
+  0x2c, 0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90,
+  0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb,
+  0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d,
+  0xcc, 0xff, 0x72, 0x21, 0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24,
+  0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28,
+  0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b,
+  0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e,
+  0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8, 0xa8, 0xfa, 0x76,
+  0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b,
+  0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8,
+  0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+  0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63,
+  0xeb, 0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16,
+  0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d,
+  0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+  0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb,
+  0xca, 0xbb, 0x4b, 0x40, 0x7e};
+
+inline u64 xxh3Load64(const u8* src)
+{
+  u64 value;
+  memcpy(&value, src, sizeof(value));
+  if constexpr(std::endian::native == std::endian::big)
+    value = byteSwap(value);
+  return value;
+}
+
+inline u32 xxh3Load32(const u8* src)
+{
+  u32 value;
+  memcpy(&value, src, sizeof(value));
+  if constexpr(std::endian::native == std::endian::big)
+    value = byteSwap(value);
+  return value;
+}
+
+// Full 128-bit product from 32-bit halves, MSVC has no 128-bit type.
+inline u64 xxh3Multiply(u64 a, u64 b, u64& hi)
+{
+  const u64 lolo  = (a & MaxU32) * (b & MaxU32);
+  const u64 hilo  = (a >> 32) * (b & MaxU32);
+  const u64 lohi  = (a & MaxU32) * (b >> 32);
+  const u64 hihi  = (a >> 32) * (b >> 32);
+  const u64 cross = (lolo >> 32) + (hilo & MaxU32) + lohi;
+
+  hi = (hilo >> 32) + (cross >> 32) + hihi;
+  return (cross << 32) | (lolo & MaxU32);
+}
+
+inline u64 xxh3Fold(u64 a, u64 b)
+{
+  u64 hi;
+  const u64 lo = xxh3Multiply(a, b, hi);
+  return lo ^ hi;
+}
+
+inline u64 xxh3Avalanche(u64 hash)
+{
+  hash ^= hash >> 37;
+  hash *= 0x165667919e3779f9ull;
+  return hash ^ (hash >> 32);
+}
+
+inline u64 xxh3Mix16(const u8* src, const u8* secret)
+{
+  return xxh3Fold(
+    xxh3Load64(src) ^ xxh3Load64(secret),
+    xxh3Load64(src + 8) ^ xxh3Load64(secret + 8));
+}
+
+inline void
+xxh3Mix32(Hash128& acc, const u8* a, const u8* b, const u8* secret)
+{
+  acc.lo += xxh3Mix16(a, secret);
+  acc.lo ^= xxh3Load64(b) + xxh3Load64(b + 8);
+  acc.hi += xxh3Mix16(b, secret + 16);
+  acc.hi ^= xxh3Load64(a) + xxh3Load64(a + 8);
+}
+
+inline Hash128 xxh3Finish(const Hash128& acc, u64 size)
+{
+  return {
+    xxh3Avalanche(acc.lo + acc.hi),
+    0u - xxh3Avalanche(
+           acc.lo * XXH64Prime1 + acc.hi * XXH64Prime4 +
+           size * XXH64Prime2)};
+}
+
+inline Hash128 xxh128Short(const u8* src, u64 size)
+{
+  const u8* secret = XXH3Secret;
+
+  if(size > 8u) {
+    const u64 flipLo =
+      xxh3Load64(secret + 32) ^ xxh3Load64(secret + 40);
+    const u64 flipHi =
+      xxh3Load64(secret + 48) ^ xxh3Load64(secret + 56);
+    const u64 inLo   = xxh3Load64(src);
+    const u64 inHi   = xxh3Load64(src + size - 8u);
+
+    u64 mulHi;
+    u64 mulLo = xxh3Multiply(inLo ^ inHi ^ flipLo, XXH64Prime1, mulHi);
+    mulLo += (size - 1u) << 54;
+
+    const u64 keyHi = inHi ^ flipHi;
+    mulHi += keyHi + (keyHi & MaxU32) * (XXH32Prime2 - 1u);
+    mulLo ^= byteSwap(mulHi);
+
+    u64 hi;
+    const u64 lo = xxh3Multiply(mulLo, XXH64Prime2, hi);
+    hi += mulHi * XXH64Prime2;
+    return {xxh3Avalanche(lo), xxh3Avalanche(hi)};
+  }
+
+  if(size >= 4u) {
+    const u64 input =
+      xxh3Load32(src) + (toU64(xxh3Load32(src + size - 4u)) << 32);
+    const u64 flip = xxh3Load64(secret + 16) ^ xxh3Load64(secret + 24);
+
+    u64 hi;
+    u64 lo = xxh3Multiply(input ^ flip, XXH64Prime1 + (size << 2), hi);
+    hi += lo << 1;
+    lo ^= hi >> 3;
+    lo ^= lo >> 35;
+    lo *= 0x9fb21c651e98df25ull;
+    lo ^= lo >> 28;
+    return {lo, xxh3Avalanche(hi)};
+  }
+
+  if(size > 0u) {
+    const u32 inLo = (toU32(src[0]) << 16) |
+                     (toU32(src[size >> 1]) << 24) |
+                     toU32(src[size - 1u]) | (toU32(size) << 8);
+    const u32 inHi = std::rotl(byteSwap(inLo), 13);
+    const u64 flipLo = xxh3Load32(secret) ^ xxh3Load32(secret + 4);
+    const u64 flipHi = xxh3Load32(secret + 8) ^ xxh3Load32(secret + 12);
+    return {
+      xxh64Avalanche(inLo ^ flipLo), xxh64Avalanche(inHi ^ flipHi)};
+  }
+
+  return {
+    xxh64Avalanche(xxh3Load64(secret + 64) ^ xxh3Load64(secret + 72)),
+    xxh64Avalanche(xxh3Load64(secret + 80) ^ xxh3Load64(secret + 88))};
+}
+
+inline Hash128 xxh128Medium(const u8* src, u64 size)
+{
+  const u8* secret = XXH3Secret;
+
+  Hash128 acc{size * XXH64Prime1, 0u};
+
+  if(size <= 128u) {
+    if(size > 32u) {
+      if(size > 64u) {
+        if(size > 96u)
+          xxh3Mix32(acc, src + 48, src + size - 64u, secret + 96);
+        xxh3Mix32(acc, src + 32, src + size - 48u, secret + 64);
+      }
+      xxh3Mix32(acc, src + 16, src + size - 32u, secret + 32);
+    }
+    xxh3Mix32(acc, src, src + size - 16u, secret);
+    return xxh3Finish(acc, size);
+  }
+
+  const u64 rounds = size / 32u;
+  for(u64 idx = 0u; idx < 4u; ++idx)
+    xxh3Mix32(
+      acc, src + idx * 32u, src + idx * 32u + 16u, secret + idx * 32u);
+
+  acc.lo = xxh3Avalanche(acc.lo);
+  acc.hi = xxh3Avalanche(acc.hi);
+
+  for(u64 idx = 4u; idx < rounds; ++idx)
+    xxh3Mix32(
+      acc, src + idx * 32u, src + idx * 32u + 16u,
+      secret + 3u + (idx - 4u) * 32u);
+
+  xxh3Mix32(acc, src + size - 16u, src + size - 32u, secret + 103);
+  return xxh3Finish(acc, size);
+}
+
+// Adds stripes of 64 bytes to the 8 accumulators, the secret moves by 8
+// bytes for each stripe.
+using Xxh3StripesFn =
+  void (*)(u64* acc, const u8* src, const u8* secret, u64 count);
+
+inline void
+xxh3StripesScalar(u64* acc, const u8* src, const u8* secret, u64 count)
+{
+  for(; count > 0u; --count, src += XXH3StripeSize, secret += 8) {
+    for(u32 idx = 0u; idx < 8u; ++idx) {
+      const u64 value = xxh3Load64(src + idx * 8u);
+      const u64 key   = value ^ xxh3Load64(secret + idx * 8u);
+      acc[idx ^ 1u] += value;
+      acc[idx] += (key & MaxU32) * (key >> 32);
+    }
+  }
+}
+
+#ifdef VD_ARCH_X64
+inline void
+xxh3StripesSSE2(u64* acc, const u8* src, const u8* secret, u64 count)
+{
+  const auto load = [](const u8* ptr) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+  };
+
+  __m128i lanes[4];
+  for(u32 idx = 0u; idx < 4u; ++idx)
+    lanes[idx] = load(reinterpret_cast<const u8*>(acc + idx * 2u));
+
+  for(; count > 0u; --count, src += XXH3StripeSize, secret += 8) {
+    for(u32 idx = 0u; idx < 4u; ++idx) {
+      const auto value = load(src + idx * 16u);
+      const auto key   = _mm_xor_si128(value, load(secret + idx * 16u));
+      const auto product =
+        _mm_mul_epu32(key, _mm_shuffle_epi32(key, 0x31));
+      lanes[idx] = _mm_add_epi64(
+        _mm_add_epi64(lanes[idx], _mm_shuffle_epi32(value, 0x4e)),
+        product);
+    }
+  }
+
+  for(u32 idx = 0u; idx < 4u; ++idx)
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(acc + idx * 2u), lanes[idx]);
+}
+
+VD_TARGET("avx2")
+inline void
+xxh3StripesAVX2(u64* acc, const u8* src, const u8* secret, u64 count)
+{
+  __m256i lanes[2];
+  for(u32 idx = 0u; idx < 2u; ++idx)
+    lanes[idx] = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i*>(acc + idx * 4u));
+
+  for(; count > 0u; --count, src += XXH3StripeSize, secret += 8) {
+    for(u32 idx = 0u; idx < 2u; ++idx) {
+      const auto value = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(src + idx * 32u));
+      const auto key = _mm256_xor_si256(
+        value, _mm256_loadu_si256(
+                 reinterpret_cast<const __m256i*>(secret + idx * 32u)));
+      const auto product =
+        _mm256_mul_epu32(key, _mm256_srli_epi64(key, 32));
+      lanes[idx] = _mm256_add_epi64(
+        _mm256_add_epi64(lanes[idx], _mm256_shuffle_epi32(value, 0x4e)),
+        product);
+    }
+  }
+
+  for(u32 idx = 0u; idx < 2u; ++idx)
+    _mm256_storeu_si256(
+      reinterpret_cast<__m256i*>(acc + idx * 4u), lanes[idx]);
+}
+#endif
+
+inline Xxh3StripesFn getXxh3Stripes()
+{
+#ifdef VD_ARCH_X64
+  const auto& cpu = getCpuFeatures();
+  if(cpu.avx2) return &xxh3StripesAVX2;
+  if(cpu.sse2) return &xxh3StripesSSE2;
+#endif
+  return &xxh3StripesScalar;
+}
+
+inline u64 xxh3Merge(const u64* acc, const u8* secret, u64 start)
+{
+  for(u32 idx = 0u; idx < 4u; ++idx)
+    start += xxh3Fold(
+      acc[idx * 2u] ^ xxh3Load64(secret + idx * 16u),
+      acc[idx * 2u + 1u] ^ xxh3Load64(secret + idx * 16u + 8u));
+  return xxh3Avalanche(start);
+}
+
+inline Hash128 xxh128Long(const u8* src, u64 size)
+{
+  static const Xxh3StripesFn stripes = getXxh3Stripes();
+
+  const u8* secret = XXH3Secret;
+
+  u64 acc[8] = {XXH32Prime3, XXH64Prime1, XXH64Prime2, XXH64Prime3,
+                XXH64Prime4, XXH32Prime2, XXH64Prime5, XXH32Prime1};
+
+  // Blocks of 16 stripes, then the accumulators are scrambled.
+  constexpr u64 blockStripes = (XXH3SecretSize - XXH3StripeSize) / 8u;
+  constexpr u64 blockSize    = blockStripes * XXH3StripeSize;
+
+  const u64 blockCount = (size - 1u) / blockSize;
+  for(u64 block = 0u; block < blockCount; ++block) {
+    stripes(acc, src + block * blockSize, secret, blockStripes);
+
+    const u8* key = secret + XXH3SecretSize - XXH3StripeSize;
+    for(u32 idx = 0u; idx < 8u; ++idx) {
+      const u64 value = acc[idx] ^ (acc[idx] >> 47);
+      acc[idx] = (value ^ xxh3Load64(key + idx * 8u)) * XXH32Prime1;
+    }
+  }
+
+  const u64 tail = blockCount * blockSize;
+  stripes(acc, src + tail, secret, (size - 1u - tail) / XXH3StripeSize);
+  stripes(
+    acc, src + size - XXH3StripeSize,
+    secret + XXH3SecretSize - XXH3StripeSize - 7u, 1u);
+
+  return {
+    xxh3Merge(acc, secret + 11, size * XXH64Prime1),
+    xxh3Merge(
+      acc, secret + XXH3SecretSize - sizeof(acc) - 11u,
+      ~(size * XXH64Prime2))};
+}
+
+inline Hash128 xxh128(Span<u8 const> data)
+{
+  if(data.size() <= 16u) return xxh128Short(data.data(), data.size());
+  if(data.size() <= 240u) return xxh128Medium(data.data(), data.size());
+  return xxh128Long(data.data(), data.size());
+}
+
+} // namespace vd
@@ -1,10 +1,17 @@
 #pragma once
 
+#include "vuldir/core/Checksum.hpp"
+#include "vuldir/core/Cpu.hpp"
 #include "vuldir/core/Definitions.hpp"
 #include "vuldir/core/Flags.hpp"
+#include "vuldir/core/Jobs.hpp"
 #include "vuldir/core/Json.hpp"
+#include "vuldir/core/JsonDocument.hpp"
+#include "vuldir/core/JsonLazy.hpp"
+#include "vuldir/core/JsonParser.hpp"
 #include "vuldir/core/Library.hpp"
 #include "vuldir/core/Logger.hpp"
+#include "vuldir/core/MappedFile.hpp"
 #include "vuldir/core/Math.hpp"
 #include "vuldir/core/Platform.hpp"
 #include "vuldir/core/STL.hpp"
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "vuldir/core/Definitions.hpp"
+#include "vuldir/core/Types.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define VD_ARCH_X64
+
+  #if defined(__clang__) || defined(__GNUC__)
+    #include <cpuid.h>
+  #else
+    #include <intrin.h>
+  #endif
+
+  #include <immintrin.h>
+#endif
+
+// Enables an instruction set for a single function, so SIMD kernels can
+// be selected at runtime without building everything for the newer
+// targets. MSVC allows any intrinsic without flags.
+#if defined(__clang__) || defined(__GNUC__)
+  #define VD_TARGET(X) __attribute__((target(X)))
+#else
+  #define VD_TARGET(X)
+#endif
+
+namespace vd {
+
+struct CpuFeatures {
+  bool sse2   = false;
+  bool ssse3  = false;
+  bool sse41  = false;
+  bool sse42  = false;
+  bool avx2   = false;
+  bool f16c   = false;
+  bool bmi2   = false;
+  bool pclmul = false;
+};
+
+#ifdef VD_ARCH_X64
+inline void cpuid(u32 leaf, u32 subleaf, u32 (&regs)[4])
+{
+  #if defined(__clang__) || defined(__GNUC__)
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+  #else
+  int ret[4];
+  __cpuidex(ret, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for(u32 idx = 0u; idx < 4u; ++idx)
+    regs[idx] = static_cast<u32>(ret[idx]);
+  #endif
+}
+
+inline u64 xgetbv(u32 idx)
+{
+  #if defined(__clang__) || defined(__GNUC__)
+  u32 lo, hi;
+  __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(idx));
+  return (toU64(hi) << 32) | lo;
+  #else
+  return _xgetbv(idx);
+  #endif
+}
+#endif
+
+inline CpuFeatures detectCpuFeatures()
+{
+  CpuFeatures ret;
+
+#ifdef VD_ARCH_X64
+  u32 regs[4];
+  cpuid(0u, 0u, regs);
+  u32 maxLeaf = regs[0];
+
+  cpuid(1u, 0u, regs);
+  ret.sse2   = (regs[3] & (1u << 26)) != 0u;
+  ret.ssse3  = (regs[2] & (1u << 9)) != 0u;
+  ret.sse41  = (regs[2] & (1u << 19)) != 0u;
+  ret.sse42  = (regs[2] & (1u << 20)) != 0u;
+  ret.pclmul = (regs[2] & (1u << 1)) != 0u;
+
+  // AVX state must be enabled by the OS as well.
+  bool osxsave = (regs[2] & (1u << 27)) != 0u;
+  bool avx     = (regs[2] & (1u << 28)) != 0u;
+  bool ymm     = osxsave && (xgetbv(0u) & 0x6u) == 0x6u;
+
+  ret.f16c = ymm && avx && (regs[2] & (1u << 29)) != 0u;
+
+  if(maxLeaf >= 7u) {
+    cpuid(7u, 0u, regs);
+    ret.avx2 = ymm && avx && (regs[1] & (1u << 5)) != 0u;
+    ret.bmi2 = (regs[1] & (1u << 8)) != 0u;
+  }
+#endif
+
+  return ret;
+}
+
+inline const CpuFeatures& getCpuFeatures()
+{
+  static const CpuFeatures features = detectCpuFeatures();
+  return features;
+}
+
+} // namespace vd
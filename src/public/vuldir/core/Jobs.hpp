@@ -0,0 +1,43 @@
+#pragma once
+
+#include "vuldir/core/STL.hpp"
+#include "vuldir/core/Types.hpp"
+
+namespace vd {
+
+// Runs job(0) to job(jobCount - 1) on up to threadCount threads, the
+// calling one included. Zero threads means one per hardware thread.
+// Jobs are picked in order, and the first error is rethrown once the
+// threads are done.
+inline void runJobs(
+  u64 jobCount, u32 threadCount, const std::function<void(u64)>& job)
+{
+  if(threadCount == 0u)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  std::atomic<u64>   nextJob = 0u;
+  std::exception_ptr error;
+  std::mutex         mutex;
+
+  const auto work = [&]() {
+    try {
+      for(u64 idx = nextJob++; idx < jobCount; idx = nextJob++)
+        job(idx);
+    } catch(...) {
+      std::lock_guard lock(mutex);
+      if(!error) error = std::current_exception();
+    }
+  };
+
+  Arr<std::thread> threads;
+  const u64 threadTotal = std::min<u64>(threadCount, jobCount);
+  for(u64 idx = 1u; idx < threadTotal; ++idx)
+    threads.emplace_back(work);
+
+  work();
+  for(auto& thread: threads) thread.join();
+
+  if(error) std::rethrow_exception(error);
+}
+
+} // namespace vd
@@ -6,7 +6,9 @@
 #endif
 
 #include "vuldir/core/Definitions.hpp"
+#include "vuldir/core/JsonParser.hpp"
 #include "vuldir/core/Logger.hpp"
+#include "vuldir/core/MappedFile.hpp"
 #include "vuldir/core/STL.hpp"
 #include "vuldir/core/Stream.hpp"
 #include "vuldir/core/Types.hpp"
@@ -15,14 +17,17 @@
 namespace vd::Json {
 class Value;
 
-using Null   = std::monostate;
-using Bool   = bool;
-using Number = f64;
-using String = Str;
-using Array  = Arr<Value>;
-using Object = std::map<String, Value>;
+using Null    = std::monostate;
+using Bool    = bool;
+using Number  = f64;
+using Integer = i64;
+using String  = Str;
+using Array   = Arr<Value>;
+using Object  = std::map<String, Value>;
 
-using Any = Var<Null, Bool, Number, String, Array, Object>;
+// Integers that fit an i64 are kept exact, the other numbers are
+// doubles. Both are numbers to the accessors.
+using Any = Var<Null, Bool, Number, Integer, String, Array, Object>;
 
 class Value : public Any
 {
@@ -72,7 +77,12 @@ class Value : public Any
 
   bool IsNumber() const
   {
-    return std::holds_alternative<Number>(*this);
+    return std::holds_alternative<Number>(*this) || IsInteger();
+  }
+
+  bool IsInteger() const
+  {
+    return std::holds_alternative<Integer>(*this);
   }
 
   bool IsString() const
@@ -103,26 +113,33 @@ class Value : public Any
       return defaultValue;
   }
 
-  Number AsNumber() const { return std::get<Number>(*this); }
+  Number AsNumber() const
+  {
+    if(IsInteger()) return toF64(std::get<Integer>(*this));
+    return std::get<Number>(*this);
+  }
 
   Opt<Number> AsNumberOpt() const
   {
-    if(IsNumber()) return std::get<Number>(*this);
+    if(IsNumber()) return AsNumber();
     else
       return std::nullopt;
   }
 
   Number AsNumberOpt(Number defaultValue) const
   {
-    if(IsNumber()) return std::get<Number>(*this);
+    if(IsNumber()) return AsNumber();
     else
       return defaultValue;
   }
 
+  // Throws when the number doesn't fit T, integer types only take
+  // whole numbers.
   template<typename T>
   T AsNumber() const
   {
-    return static_cast<T>(std::get<Number>(*this));
+    if(IsInteger()) return toNumber<T>(std::get<Integer>(*this));
+    return toNumber<T>(std::get<Number>(*this));
   }
 
   template<typename T>
@@ -162,13 +179,16 @@ class Value : public Any
   template<typename T>
   T AsVector() const
   {
+    using Traits = VectorTraits<T>;
+
     if(!IsArray()) return {};
 
-    T           ret = {};
-    const auto& src = AsArray();
-    for(u32 idx = 0u; idx < std::min(std::size(ret), src.size());
-        ++idx) {
-      ret[idx] = src[idx].AsNumber<typename T::value_type>();
+    T           ret   = {};
+    const auto& src   = AsArray();
+    const u64   count = std::min<u64>(Traits::Size, src.size());
+    for(u64 idx = 0u; idx < count; ++idx) {
+      Traits::Get(ret, idx) =
+        src[idx].AsNumber<typename Traits::Component>();
     }
     return ret;
   }
@@ -191,64 +211,52 @@ class Value : public Any
 
   const Object& AsObject() const { return std::get<Object>(*this); }
 
+  // Empty or malformed documents throw.
+  void Read(Span<char const> src) { *this = fromTape(Tape(src), 0u); }
+
   void Read(const fs::path& path)
   {
-    std::ifstream src(path);
-    Read(src);
+    const MappedFile file(path);
+    const auto       data = file.GetData();
+    Read(Span<char const>(
+      reinterpret_cast<const char*>(data.data()), data.size()));
   }
 
   void Read(std::istream& src)
   {
-    switch((src >> std::ws).peek()) {
-      case '"': {
-        String value;
-        src >> std::quoted(value);
-        *this = std::move(value);
-      } break;
-      case '[': {
+    const u64  pos   = toU64(src.tellg());
+    const auto bytes = streamReadBytes(src, streamSize(src) - pos);
+    Read(Span<char const>(
+      reinterpret_cast<const char*>(bytes.data()), bytes.size()));
+  }
+
+private:
+  static Value fromTape(const Tape& tape, u64 idx)
+  {
+    switch(tape.GetType(idx)) {
+      case Tape::Type::Null: return Null{};
+      case Tape::Type::True: return true;
+      case Tape::Type::False: return false;
+      case Tape::Type::Number: return tape.GetNumber(idx);
+      case Tape::Type::Integer: return tape.GetInteger(idx);
+      case Tape::Type::String: return String(tape.GetString(idx));
+      case Tape::Type::Array: {
         Array value;
-        for(src.ignore(1); (src >> std::ws).peek() != ']';) {
-          value.emplace_back().Read(src);
-          if((src >> std::ws).peek() == ',') src.ignore(1);
-        }
-        src.ignore(1);
-        *this = std::move(value);
-      } break;
-      case '{': {
+        value.reserve(tape.GetCount(idx));
+        for(idx = idx + 1u; tape.GetType(idx) != Tape::Type::ArrayEnd;
+            idx = tape.GetNext(idx))
+          value.push_back(fromTape(tape, idx));
+        return value;
+      }
+      case Tape::Type::Object: {
+        // Later duplicates replace earlier keys.
         Object value;
-        for(src.ignore(1); (src >> std::ws).peek() != '}';) {
-          std::stringbuf key;
-          src.ignore(std::numeric_limits<std::streamsize>::max(), '"')
-            .get(key, '"')
-            .ignore(std::numeric_limits<std::streamsize>::max(), ':');
-          value[key.str()].Read(src);
-          if((src >> std::ws).peek() == ',') src.ignore(1);
-        }
-        src.ignore(1);
-        *this = std::move(value);
-      } break;
-      default: {
-        if(
-          std::isdigit(src.peek()) || src.peek() == '.' ||
-          src.peek() == '-') {
-          Number value;
-          src >> value;
-          *this = value;
-        } else if(std::isalpha(src.peek())) {
-          String value;
-          for(; isalpha(src.peek()); src.ignore())
-            value.push_back(static_cast<char>(src.peek()));
-
-          if(value == "null") *this = {};
-          else if(value == "true")
-            *this = true;
-          else if(value == "false")
-            *this = false;
-          else
-            *this = value;
-        } else
-          *this = {};
-      } break;
+        for(idx = idx + 1u; tape.GetType(idx) != Tape::Type::ObjectEnd;
+            idx = tape.GetNext(idx + 1u))
+          value[String(tape.GetString(idx))] = fromTape(tape, idx + 1u);
+        return value;
+      }
+      default: return {};
     }
   }
 };
@@ -0,0 +1,388 @@
+#pragma once
+
+#include "vuldir/core/Definitions.hpp"
+#include "vuldir/core/JsonParser.hpp"
+#include "vuldir/core/MappedFile.hpp"
+#include "vuldir/core/STL.hpp"
+#include "vuldir/core/Types.hpp"
+#include "vuldir/core/Uti.hpp"
+
+namespace vd::Json {
+
+struct Member;
+
+// Value of a Document, 16 bytes. Containers point to their items or
+// members in the arena of the document. Lookups that miss and wrong
+// indices give a null node, the As functions throw on other types.
+// Integers that fit an i64 are kept exact, both kinds are numbers to
+// the accessors.
+class Node
+{
+public:
+  enum class Type : u8 {
+    Null,
+    Bool,
+    Number,
+    Integer,
+    String,
+    Array,
+    Object
+  };
+
+public:
+  Node() = default;
+
+  Type GetType() const { return m_type; }
+
+  bool HasValue() const { return m_type != Type::Null; }
+  bool IsBool() const { return m_type == Type::Bool; }
+  bool IsNumber() const
+  {
+    return m_type == Type::Number || m_type == Type::Integer;
+  }
+
+  bool IsInteger() const { return m_type == Type::Integer; }
+  bool IsString() const { return m_type == Type::String; }
+  bool IsArray() const { return m_type == Type::Array; }
+  bool IsObject() const { return m_type == Type::Object; }
+
+  // Items or members, zero for the other values.
+  u64 GetSize() const { return IsArray() || IsObject() ? m_size : 0u; }
+
+  // Binary search over the sorted members.
+  const Node& operator[](Strv key) const;
+
+  const Node& operator[](u64 idx) const
+  {
+    return IsArray() && idx < m_size ? m_items[idx] : getNull();
+  }
+
+  bool AsBool() const
+  {
+    expect(Type::Bool);
+    return m_bool;
+  }
+
+  Opt<bool> AsBoolOpt() const
+  {
+    if(IsBool()) return m_bool;
+    else
+      return std::nullopt;
+  }
+
+  bool AsBoolOpt(bool defaultValue) const
+  {
+    return IsBool() ? m_bool : defaultValue;
+  }
+
+  f64 AsNumber() const
+  {
+    if(IsInteger()) return toF64(m_integer);
+    expect(Type::Number);
+    return m_number;
+  }
+
+  Opt<f64> AsNumberOpt() const
+  {
+    if(IsNumber()) return AsNumber();
+    else
+      return std::nullopt;
+  }
+
+  f64 AsNumberOpt(f64 defaultValue) const
+  {
+    return IsNumber() ? AsNumber() : defaultValue;
+  }
+
+  // Throws when the number doesn't fit T, integer types only take
+  // whole numbers.
+  template<typename T>
+  T AsNumber() const
+  {
+    if(IsInteger()) return toNumber<T>(m_integer);
+    return toNumber<T>(AsNumber());
+  }
+
+  template<typename T>
+  Opt<T> AsNumberOpt() const
+  {
+    if(IsNumber()) return AsNumber<T>();
+    else
+      return std::nullopt;
+  }
+
+  template<typename T>
+  T AsNumberOpt(T defaultValue) const
+  {
+    return IsNumber() ? AsNumber<T>() : defaultValue;
+  }
+
+  Strv AsString() const
+  {
+    expect(Type::String);
+    return {m_string, m_size};
+  }
+
+  Opt<Strv> AsStringOpt() const
+  {
+    if(IsString()) return Strv(m_string, m_size);
+    else
+      return std::nullopt;
+  }
+
+  Strv AsStringOpt(Strv defaultValue) const
+  {
+    return IsString() ? Strv(m_string, m_size) : defaultValue;
+  }
+
+  Span<Node const> AsArray() const
+  {
+    expect(Type::Array);
+    return {m_items, m_size};
+  }
+
+  // Sorted by key, later duplicates replace the earlier ones.
+  Span<Member const> AsObject() const;
+
+  template<typename T>
+  T AsVector() const
+  {
+    using Traits = VectorTraits<T>;
+
+    T ret = {};
+    if(!IsArray()) return ret;
+
+    const u64 count = std::min<u64>(Traits::Size, m_size);
+    for(u32 idx = 0u; idx < count; ++idx)
+      Traits::Get(ret, idx) =
+        m_items[idx].AsNumber<typename Traits::Component>();
+    return ret;
+  }
+
+  template<typename T>
+  Opt<T> AsVectorOpt() const
+  {
+    if(IsArray()) return AsVector<T>();
+    else
+      return std::nullopt;
+  }
+
+  template<typename T>
+  T AsVectorOpt(T defaultValue) const
+  {
+    return IsArray() ? AsVector<T>() : defaultValue;
+  }
+
+private:
+  friend class Document;
+
+  static const Node& getNull()
+  {
+    static const Node null;
+    return null;
+  }
+
+  void expect(Type type) const
+  {
+    if(m_type != type)
+      throw std::runtime_error("Json: unexpected value type");
+  }
+
+private:
+  Type m_type = Type::Null;
+
+  // Bytes of strings, items of arrays and members of objects.
+  u32 m_size = 0u;
+
+  union {
+    u64           m_bits = 0u;
+    bool          m_bool;
+    f64           m_number;
+    i64           m_integer;
+    const char*   m_string;
+    const Node*   m_items;
+    const Member* m_members;
+  };
+};
+
+struct Member {
+  Strv key;
+  Node value;
+};
+
+inline const Node& Node::operator[](Strv key) const
+{
+  if(!IsObject()) return getNull();
+
+  const auto less = [](const Member& member, Strv value) {
+    return member.key < value;
+  };
+
+  const auto* end = m_members + m_size;
+  const auto* it  = std::lower_bound(m_members, end, key, less);
+  return it != end && it->key == key ? it->value : getNull();
+}
+
+inline Span<Member const> Node::AsObject() const
+{
+  expect(Type::Object);
+  return {m_members, m_size};
+}
+
+// Compact DOM, every node, key and unescaped string lives in one bump
+// arena and is released with the document. Strings without escapes
+// point into the source instead, which must outlive the document.
+class Document
+{
+public:
+  VD_NONMOVABLE(Document);
+
+  Document() = default;
+  Document(Span<char const> src) { Parse(src); }
+
+  void Parse(Span<char const> src)
+  {
+    m_root = {};
+    m_arena.release();
+    m_source = src;
+
+    Builder builder{*this, {}, {}};
+    parse(src, builder);
+    m_root = builder.values.back();
+  }
+
+  // The file stays mapped for the strings.
+  void Read(const fs::path& path)
+  {
+    m_file.emplace(path);
+    const auto data = m_file->GetData();
+    Parse(Span<char const>(
+      reinterpret_cast<const char*>(data.data()), data.size()));
+  }
+
+  const Node& GetRoot() const { return m_root; }
+
+  const Node& operator[](Strv key) const { return m_root[key]; }
+
+private:
+  // Values are kept on a stack until their container is closed, then
+  // moved to the arena in one piece.
+  struct Builder {
+    Document& document;
+    Arr<Node> values;
+    Arr<Strv> keys;
+
+    Node& push(Node::Type type)
+    {
+      auto& node  = values.emplace_back();
+      node.m_type = type;
+      return node;
+    }
+
+    void OnNull() { push(Node::Type::Null); }
+    void OnBool(bool value) { push(Node::Type::Bool).m_bool = value; }
+
+    void OnNumber(f64 value)
+    {
+      push(Node::Type::Number).m_number = value;
+    }
+
+    void OnInteger(i64 value)
+    {
+      push(Node::Type::Integer).m_integer = value;
+    }
+
+    void OnString(Strv value)
+    {
+      auto& node    = push(Node::Type::String);
+      node.m_string = document.store(value).data();
+      node.m_size   = toU32(value.size());
+    }
+
+    void OnKey(Strv key) { keys.push_back(document.store(key)); }
+
+    void OnObjectBegin() {}
+    void OnObjectEnd(u64 count);
+    void OnArrayBegin() {}
+    void OnArrayEnd(u64 count);
+  };
+
+  template<typename T>
+  T* allocate(u64 count)
+  {
+    if(count == 0u) return nullptr;
+    return static_cast<T*>(
+      m_arena.allocate(count * sizeof(T), alignof(T)));
+  }
+
+  // Unescaped strings only last for the parser call.
+  Strv store(Strv value)
+  {
+    const char* begin = m_source.data();
+    if(value.data() >= begin && value.data() < begin + m_source.size())
+      return value;
+
+    char* dst = allocate<char>(value.size());
+    if(dst) memcpy(dst, value.data(), value.size());
+    return {dst, value.size()};
+  }
+
+private:
+  std::pmr::monotonic_buffer_resource m_arena;
+  Opt<MappedFile>                     m_file;
+  Span<char const>                    m_source;
+  Node                                m_root;
+};
+
+inline void Document::Builder::OnArrayEnd(u64 count)
+{
+  Node* items = document.allocate<Node>(count);
+  std::copy(values.end() - toI64(count), values.end(), items);
+  values.resize(values.size() - count);
+
+  auto& node   = push(Node::Type::Array);
+  node.m_items = items;
+  node.m_size  = toU32(count);
+}
+
+inline void Document::Builder::OnObjectEnd(u64 count)
+{
+  Member*   members   = document.allocate<Member>(count);
+  const u64 firstKey  = keys.size() - count;
+  const u64 firstItem = values.size() - count;
+  for(u64 idx = 0u; idx < count; ++idx)
+    new(members + idx)
+      Member{keys[firstKey + idx], values[firstItem + idx]};
+
+  keys.resize(firstKey);
+  values.resize(firstItem);
+
+  // Stable, so that the last of equal keys stays last. Objects are
+  // small enough for insertion sort but for the odd dictionary.
+  const auto less = [](const Member& a, const Member& b) {
+    return a.key < b.key;
+  };
+  if(count > 32u) std::stable_sort(members, members + count, less);
+  else {
+    for(u64 idx = 1u; idx < count; ++idx) {
+      const Member member = members[idx];
+      u64          pos    = idx;
+      for(; pos > 0u && less(member, members[pos - 1u]); --pos)
+        members[pos] = members[pos - 1u];
+      members[pos] = member;
+    }
+  }
+
+  u64 size = 0u;
+  for(u64 idx = 0u; idx < count; ++idx) {
+    if(idx + 1u < count && members[idx].key == members[idx + 1u].key)
+      continue;
+    members[size++] = members[idx];
+  }
+
+  auto& node     = push(Node::Type::Object);
+  node.m_members = members;
+  node.m_size    = toU32(size);
+}
+
+} // namespace vd::Json
@@ -0,0 +1,498 @@
+#pragma once
+
+#include "vuldir/core/Definitions.hpp"
+#include "vuldir/core/JsonParser.hpp"
+#include "vuldir/core/MappedFile.hpp"
+#include "vuldir/core/STL.hpp"
+#include "vuldir/core/Types.hpp"
+#include "vuldir/core/Uti.hpp"
+
+namespace vd::Json {
+
+class LazyDocument;
+class LazyArray;
+class LazyObject;
+
+// Position of a value in the structural index of a LazyDocument.
+// Nothing is parsed until one of the As functions is called, lookups
+// walk the members or items in document order and skip the others by
+// counting brackets. Missing values are null and the As functions
+// throw on other types, like Node.
+class LazyValue
+{
+public:
+  LazyValue() = default;
+  LazyValue(const LazyDocument* document, u64 pos):
+    m_document{document}, m_pos{pos}
+  {}
+
+  bool HasValue() const { return m_document && peek() != 'n'; }
+  bool IsString() const { return m_document && peek() == '"'; }
+  bool IsArray() const { return m_document && peek() == '['; }
+  bool IsObject() const { return m_document && peek() == '{'; }
+
+  bool IsBool() const
+  {
+    return m_document && (peek() == 't' || peek() == 'f');
+  }
+
+  bool IsNumber() const
+  {
+    return m_document && (peek() == '-' || isDigit(peek()));
+  }
+
+  // Items or members, counted by walking them.
+  u64 GetSize() const;
+
+  LazyValue operator[](Strv key) const;
+  LazyValue operator[](u64 idx) const;
+
+  bool AsBool() const;
+
+  Opt<bool> AsBoolOpt() const
+  {
+    if(IsBool()) return AsBool();
+    else
+      return std::nullopt;
+  }
+
+  bool AsBoolOpt(bool defaultValue) const
+  {
+    return IsBool() ? AsBool() : defaultValue;
+  }
+
+  f64 AsNumber() const;
+
+  // Also gives the integer when the number is one that fits an i64.
+  f64 AsNumber(Opt<i64>& integer) const;
+
+  Opt<f64> AsNumberOpt() const
+  {
+    if(IsNumber()) return AsNumber();
+    else
+      return std::nullopt;
+  }
+
+  f64 AsNumberOpt(f64 defaultValue) const
+  {
+    return IsNumber() ? AsNumber() : defaultValue;
+  }
+
+  // Exact for integers that fit an i64, throws when the number
+  // doesn't fit T.
+  template<typename T>
+  T AsNumber() const;
+
+  template<typename T>
+  Opt<T> AsNumberOpt() const
+  {
+    if(IsNumber()) return AsNumber<T>();
+    else
+      return std::nullopt;
+  }
+
+  template<typename T>
+  T AsNumberOpt(T defaultValue) const
+  {
+    return IsNumber() ? AsNumber<T>() : defaultValue;
+  }
+
+  // Escaped strings are unescaped into the document once per call.
+  Strv AsString() const;
+
+  Opt<Strv> AsStringOpt() const
+  {
+    if(IsString()) return AsString();
+    else
+      return std::nullopt;
+  }
+
+  Strv AsStringOpt(Strv defaultValue) const
+  {
+    return IsString() ? AsString() : defaultValue;
+  }
+
+  LazyArray  AsArray() const;
+  LazyObject AsObject() const;
+
+  template<typename T>
+  T AsVector() const;
+
+  template<typename T>
+  Opt<T> AsVectorOpt() const
+  {
+    if(IsArray()) return AsVector<T>();
+    else
+      return std::nullopt;
+  }
+
+  template<typename T>
+  T AsVectorOpt(T defaultValue) const
+  {
+    return IsArray() ? AsVector<T>() : defaultValue;
+  }
+
+private:
+  char peek() const;
+  void expect(bool isType) const;
+
+private:
+  const LazyDocument* m_document = nullptr;
+  u64                 m_pos      = 0u;
+};
+
+struct LazyMember {
+  Strv      key;
+  LazyValue value;
+};
+
+// Only the structural index is built up front, like simdjson's
+// On-Demand API, values are parsed as they are read. Made for reading
+// a few fields out of large documents, the parts that are never read
+// only have their brackets counted. Strings without escapes
+// point into the source, which must outlive the document. Reading
+// escaped strings is not thread safe, they are kept in the document.
+class LazyDocument
+{
+public:
+  VD_NONMOVABLE(LazyDocument);
+
+  LazyDocument() = default;
+  LazyDocument(Span<char const> src) { Parse(src); }
+
+  void Parse(Span<char const> src)
+  {
+    m_strings.release();
+    m_source = src;
+    m_index  = indexStructurals(src);
+    if(m_index.empty())
+      throw std::runtime_error("Json: empty document");
+    if(skip(0u) != m_index.size())
+      throw std::runtime_error("Json: trailing characters");
+  }
+
+  // The file stays mapped for the strings.
+  void Read(const fs::path& path)
+  {
+    m_file.emplace(path);
+    const auto data = m_file->GetData();
+    Parse(Span<char const>(
+      reinterpret_cast<const char*>(data.data()), data.size()));
+  }
+
+  LazyValue GetRoot() const { return {this, 0u}; }
+
+  LazyValue operator[](Strv key) const { return GetRoot()[key]; }
+
+private:
+  friend class LazyValue;
+  friend class LazyArray;
+  friend class LazyObject;
+
+  const char* getChar(u64 pos) const
+  {
+    if(pos >= m_index.size())
+      throw std::runtime_error("Json: unexpected end of document");
+    return m_source.data() + m_index[pos];
+  }
+
+  const char* getEnd() const
+  {
+    return m_source.data() + m_source.size();
+  }
+
+  // Index position after the value at pos.
+  u64 skip(u64 pos) const
+  {
+    const char c = *getChar(pos);
+    if(c != '{' && c != '[') return pos + 1u;
+
+    for(u64 depth = 0u;; ++pos) {
+      switch(*getChar(pos)) {
+        case '{':
+        case '[': ++depth; break;
+        case '}':
+        case ']':
+          if(--depth == 0u) return pos + 1u;
+          break;
+        default: break;
+      }
+    }
+  }
+
+  Strv readString(u64 pos) const
+  {
+    const Strv value =
+      Json::readString(getChar(pos), getEnd(), m_buffer);
+    if(value.data() != m_buffer.data()) return value;
+
+    auto* dst =
+      static_cast<char*>(m_strings.allocate(value.size(), 1u));
+    memcpy(dst, value.data(), value.size());
+    return {dst, value.size()};
+  }
+
+private:
+  Span<char const> m_source;
+  Arr<u32>         m_index;
+  Opt<MappedFile>  m_file;
+
+  mutable std::pmr::monotonic_buffer_resource m_strings;
+  mutable Arr<char>                           m_buffer;
+};
+
+// Items in document order.
+class LazyArray
+{
+public:
+  class Iterator
+  {
+  public:
+    LazyValue operator*() const { return {m_document, m_pos}; }
+
+    Iterator& operator++()
+    {
+      const u64  next = m_document->skip(m_pos);
+      const char c    = *m_document->getChar(next);
+      if(c == ',') m_pos = next + 1u;
+      else if(c == ']')
+        m_pos = End;
+      else
+        throw std::runtime_error("Json: expected ',' or a bracket");
+      return *this;
+    }
+
+    bool operator==(const Iterator& other) const
+    {
+      return m_pos == other.m_pos;
+    }
+
+  private:
+    friend class LazyArray;
+
+    static constexpr u64 End = ~0ull;
+
+    Iterator(const LazyDocument* document, u64 pos):
+      m_document{document}, m_pos{pos}
+    {}
+
+    const LazyDocument* m_document;
+    u64                 m_pos;
+  };
+
+public:
+  // Pos is the opening bracket.
+  LazyArray(const LazyDocument* document, u64 pos):
+    m_document{document}, m_pos{pos}
+  {}
+
+  Iterator begin() const
+  {
+    const bool isEmpty = *m_document->getChar(m_pos + 1u) == ']';
+    return {m_document, isEmpty ? Iterator::End : m_pos + 1u};
+  }
+
+  Iterator end() const { return {m_document, Iterator::End}; }
+
+  u64 size() const
+  {
+    u64 ret = 0u;
+    for(auto it = begin(); it != end(); ++it) ++ret;
+    return ret;
+  }
+
+private:
+  const LazyDocument* m_document;
+  u64                 m_pos;
+};
+
+// Members in document order, duplicates included.
+class LazyObject
+{
+public:
+  class Iterator
+  {
+  public:
+    LazyMember operator*() const
+    {
+      return {m_document->readString(m_pos), {m_document, m_pos + 2u}};
+    }
+
+    Iterator& operator++()
+    {
+      const u64  next = m_document->skip(m_pos + 2u);
+      const char c    = *m_document->getChar(next);
+      if(c == ',') m_pos = check(next + 1u);
+      else if(c == '}')
+        m_pos = End;
+      else
+        throw std::runtime_error("Json: expected ',' or a bracket");
+      return *this;
+    }
+
+    bool operator==(const Iterator& other) const
+    {
+      return m_pos == other.m_pos;
+    }
+
+  private:
+    friend class LazyObject;
+
+    static constexpr u64 End = ~0ull;
+
+    Iterator(const LazyDocument* document, u64 pos):
+      m_document{document}, m_pos{pos}
+    {}
+
+    // Members start with a key and a colon.
+    u64 check(u64 pos) const
+    {
+      if(
+        *m_document->getChar(pos) != '"' ||
+        *m_document->getChar(pos + 1u) != ':')
+        throw std::runtime_error("Json: expected a key");
+      return pos;
+    }
+
+    const LazyDocument* m_document;
+    u64                 m_pos;
+  };
+
+public:
+  // Pos is the opening brace.
+  LazyObject(const LazyDocument* document, u64 pos):
+    m_document{document}, m_pos{pos}
+  {}
+
+  Iterator begin() const
+  {
+    Iterator ret{m_document, Iterator::End};
+    if(*m_document->getChar(m_pos + 1u) != '}')
+      ret.m_pos = ret.check(m_pos + 1u);
+    return ret;
+  }
+
+  Iterator end() const { return {m_document, Iterator::End}; }
+
+  u64 size() const
+  {
+    u64 ret = 0u;
+    for(auto it = begin(); it != end(); ++it) ++ret;
+    return ret;
+  }
+
+private:
+  const LazyDocument* m_document;
+  u64                 m_pos;
+};
+
+inline char LazyValue::peek() const
+{
+  return *m_document->getChar(m_pos);
+}
+
+inline void LazyValue::expect(bool isType) const
+{
+  if(!isType) throw std::runtime_error("Json: unexpected value type");
+}
+
+inline u64 LazyValue::GetSize() const
+{
+  if(IsArray()) return AsArray().size();
+  if(IsObject()) return AsObject().size();
+  return 0u;
+}
+
+// The last of equal keys wins, like in the other DOMs.
+inline LazyValue LazyValue::operator[](Strv key) const
+{
+  if(!IsObject()) return {};
+
+  LazyValue ret;
+  for(const auto& member: AsObject())
+    if(member.key == key) ret = member.value;
+  return ret;
+}
+
+inline LazyValue LazyValue::operator[](u64 idx) const
+{
+  if(!IsArray()) return {};
+
+  for(const auto& item: AsArray())
+    if(idx-- == 0u) return item;
+  return {};
+}
+
+inline bool LazyValue::AsBool() const
+{
+  expect(IsBool());
+  const char* src = m_document->getChar(m_pos);
+  checkLiteral(src, m_document->getEnd());
+  return *src == 't';
+}
+
+inline f64 LazyValue::AsNumber() const
+{
+  Opt<i64> integer;
+  return AsNumber(integer);
+}
+
+inline f64 LazyValue::AsNumber(Opt<i64>& integer) const
+{
+  expect(IsNumber());
+  return readNumber(
+    m_document->getChar(m_pos), m_document->getEnd(), integer);
+}
+
+inline Strv LazyValue::AsString() const
+{
+  expect(IsString());
+  return m_document->readString(m_pos);
+}
+
+inline LazyArray LazyValue::AsArray() const
+{
+  expect(IsArray());
+  return {m_document, m_pos};
+}
+
+inline LazyObject LazyValue::AsObject() const
+{
+  expect(IsObject());
+  return {m_document, m_pos};
+}
+
+template<typename T>
+T LazyValue::AsNumber() const
+{
+  Opt<i64>  integer;
+  const f64 value = AsNumber(integer);
+  return integer ? toNumber<T>(*integer) : toNumber<T>(value);
+}
+
+// Straight from the source, numbers take a single position of the
+// index, followed by a comma or the closing bracket.
+template<typename T>
+T LazyValue::AsVector() const
+{
+  using Traits = VectorTraits<T>;
+
+  T ret = {};
+  if(!IsArray()) return ret;
+
+  u64 pos = m_pos + 1u;
+  if(*m_document->getChar(pos) == ']') return ret;
+
+  for(u64 idx = 0u; idx < Traits::Size; ++idx, pos += 2u) {
+    const LazyValue item{m_document, pos};
+    Traits::Get(ret, idx) = item.AsNumber<typename Traits::Component>();
+
+    const char c = *m_document->getChar(pos + 1u);
+    if(c == ']') break;
+    if(c != ',')
+      throw std::runtime_error("Json: expected ',' or a bracket");
+  }
+  return ret;
+}
+
+} // namespace vd::Json
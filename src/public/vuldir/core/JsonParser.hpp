@@ -0,0 +1,1084 @@
+#pragma once
+
+#include "vuldir/core/Cpu.hpp"
+#include "vuldir/core/Math.hpp"
+#include "vuldir/core/STL.hpp"
+#include "vuldir/core/Types.hpp"
+#include "vuldir/core/Uti.hpp"
+
+namespace vd::Json {
+
+// Parser in two stages, after simdjson ("Parsing Gigabytes of JSON per
+// Second", Langdale and Lemire). The first stage classifies 64-byte
+// blocks with SIMD into bit masks, masks out escaped characters and
+// string contents with bit arithmetic and keeps the positions of the
+// structural characters and of the first byte of every other value.
+// It also rejects control characters within strings and invalid UTF-8
+// anywhere. The second stage walks those positions and writes a tape.
+
+inline constexpr u64 BlockSize = 64u;
+
+// Offsets are 32 bits and numbers take two tape words.
+inline constexpr u64 MaxDocumentSize = 1ull << 31;
+
+// One bit per byte of a block.
+struct BlockMasks {
+  u64 quote;
+  u64 backslash;
+  u64 space;
+  u64 op;
+  u64 control;
+};
+
+// Carried over from block to block by the UTF-8 check.
+struct Utf8State {
+  // Last bytes of the previous block, for the SIMD check.
+  SArr<u8, 32> prev = {};
+
+  // Continuation bytes still due and the range of the next one, for
+  // the scalar check.
+  u32 pending = 0u;
+  u8  lower   = 0x80u;
+  u8  upper   = 0xbfu;
+
+  // The block ends within a sequence.
+  bool isIncomplete = false;
+  bool isError      = false;
+};
+
+using ClassifyFn  = void (*)(const char* src, BlockMasks& masks);
+using PrefixXorFn = u64 (*)(u64 bits);
+using Utf8Fn      = void (*)(const char* src, Utf8State& state);
+
+inline bool isSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool isOp(char c)
+{
+  return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' ||
+         c == ',';
+}
+
+inline void classifyScalar(const char* src, BlockMasks& masks)
+{
+  masks = {};
+  for(u32 idx = 0u; idx < BlockSize; ++idx) {
+    const u64 bit = 1ull << idx;
+    if(src[idx] == '"') masks.quote |= bit;
+    if(src[idx] == '\\') masks.backslash |= bit;
+    if(isSpace(src[idx])) masks.space |= bit;
+    if(isOp(src[idx])) masks.op |= bit;
+    if(toU8(src[idx]) < 0x20u) masks.control |= bit;
+  }
+}
+
+#ifdef VD_ARCH_X64
+// Brackets and braces only differ by 0x20, one compare finds both
+// after setting that bit.
+inline void classifySSE2(const char* src, BlockMasks& masks)
+{
+  const auto set  = [](char c) { return _mm_set1_epi8(c); };
+  const auto bits = [](__m128i mask, u32 idx) {
+    return toU64(toU32(_mm_movemask_epi8(mask))) << (idx * 16u);
+  };
+
+  masks = {};
+  for(u32 idx = 0u; idx < 4u; ++idx) {
+    const auto v = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(src + idx * 16u));
+    const auto lower = _mm_or_si128(v, set(0x20));
+
+    const auto op = _mm_or_si128(
+      _mm_or_si128(
+        _mm_cmpeq_epi8(lower, set('{')),
+        _mm_cmpeq_epi8(lower, set('}'))),
+      _mm_or_si128(
+        _mm_cmpeq_epi8(v, set(':')), _mm_cmpeq_epi8(v, set(','))));
+    const auto space = _mm_or_si128(
+      _mm_or_si128(
+        _mm_cmpeq_epi8(v, set(' ')), _mm_cmpeq_epi8(v, set('\t'))),
+      _mm_or_si128(
+        _mm_cmpeq_epi8(v, set('\n')), _mm_cmpeq_epi8(v, set('\r'))));
+
+    masks.quote |= bits(_mm_cmpeq_epi8(v, set('"')), idx);
+    masks.backslash |= bits(_mm_cmpeq_epi8(v, set('\\')), idx);
+    masks.space |= bits(space, idx);
+    masks.op |= bits(op, idx);
+    masks.control |=
+      bits(_mm_cmpeq_epi8(_mm_min_epu8(v, set(0x1f)), v), idx);
+  }
+}
+
+VD_TARGET("avx2")
+inline u64 classifyMaskAVX2(__m256i lo, __m256i hi, char c)
+{
+  const auto value = _mm256_set1_epi8(c);
+  const u64  bitsLo =
+    toU32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, value)));
+  const u64 bitsHi =
+    toU32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, value)));
+  return bitsLo | (bitsHi << 32);
+}
+
+VD_TARGET("avx2")
+inline void classifyAVX2(const char* src, BlockMasks& masks)
+{
+  const auto lo =
+    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+  const auto hi =
+    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+  const auto bit     = _mm256_set1_epi8(0x20);
+  const auto lowerLo = _mm256_or_si256(lo, bit);
+  const auto lowerHi = _mm256_or_si256(hi, bit);
+
+  masks.quote     = classifyMaskAVX2(lo, hi, '"');
+  masks.backslash = classifyMaskAVX2(lo, hi, '\\');
+
+  masks.space = classifyMaskAVX2(lo, hi, ' ');
+  masks.space |= classifyMaskAVX2(lo, hi, '\t');
+  masks.space |= classifyMaskAVX2(lo, hi, '\n');
+  masks.space |= classifyMaskAVX2(lo, hi, '\r');
+
+  masks.op = classifyMaskAVX2(lowerLo, lowerHi, '{');
+  masks.op |= classifyMaskAVX2(lowerLo, lowerHi, '}');
+  masks.op |= classifyMaskAVX2(lo, hi, ':');
+  masks.op |= classifyMaskAVX2(lo, hi, ',');
+
+  // Unsigned bytes below 0x20 are their own minimum with 0x1f.
+  const auto control = _mm256_set1_epi8(0x1f);
+  const u64  controlLo = toU32(_mm256_movemask_epi8(
+    _mm256_cmpeq_epi8(_mm256_min_epu8(lo, control), lo)));
+  const u64 controlHi = toU32(_mm256_movemask_epi8(
+    _mm256_cmpeq_epi8(_mm256_min_epu8(hi, control), hi)));
+  masks.control = controlLo | (controlHi << 32);
+}
+
+// Multiplying by all ones without carries sets each bit to the xor of
+// the bits up to it.
+VD_TARGET("pclmul")
+inline u64 prefixXorClmul(u64 bits)
+{
+  const auto product = _mm_clmulepi64_si128(
+    _mm_set_epi64x(0, toI64(bits)), _mm_set1_epi8(-1), 0x00);
+  return toU64(_mm_cvtsi128_si64(product));
+}
+#endif
+
+inline u64 prefixXorScalar(u64 bits)
+{
+  for(u32 shift = 1u; shift < 64u; shift <<= 1u) bits ^= bits << shift;
+  return bits;
+}
+
+// Table 3-7 of the Unicode standard. Some leads narrow the range of
+// the byte after them, which rules out overlong forms, surrogates and
+// code points past U+10FFFF.
+inline void checkUtf8Scalar(const char* src, Utf8State& state)
+{
+  constexpr u64 HighBits = 0x8080808080808080ull;
+
+  if(state.pending == 0u) {
+    u64 bits = 0u;
+    for(u32 idx = 0u; idx < BlockSize; idx += 8u) {
+      u64 word;
+      memcpy(&word, src + idx, sizeof(word));
+      bits |= word;
+    }
+    if((bits & HighBits) == 0u) {
+      state.isIncomplete = false;
+      return;
+    }
+  }
+
+  for(u32 idx = 0u; idx < BlockSize; ++idx) {
+    const u8 byte = toU8(src[idx]);
+
+    if(state.pending > 0u) {
+      if(byte < state.lower || byte > state.upper) state.isError = true;
+      state.lower = 0x80u;
+      state.upper = 0xbfu;
+      --state.pending;
+      continue;
+    }
+
+    if(byte < 0x80u) continue;
+
+    if(byte >= 0xc2u && byte <= 0xdfu) state.pending = 1u;
+    else if(byte >= 0xe0u && byte <= 0xefu) {
+      state.pending = 2u;
+      if(byte == 0xe0u) state.lower = 0xa0u;
+      if(byte == 0xedu) state.upper = 0x9fu;
+    } else if(byte >= 0xf0u && byte <= 0xf4u) {
+      state.pending = 3u;
+      if(byte == 0xf0u) state.lower = 0x90u;
+      if(byte == 0xf4u) state.upper = 0x8fu;
+    } else
+      state.isError = true;
+  }
+
+  state.isIncomplete = state.pending > 0u;
+}
+
+#ifdef VD_ARCH_X64
+// UTF-8 check after Keiser and Lemire ("Validating UTF-8 In Less Than
+// One Instruction Per Byte"). The high and low nibbles of each byte and
+// the high nibble of the next one each look up the errors they allow,
+// and the pair is bad when all three agree. Third and fourth bytes of
+// a sequence are matched against the leads two and three bytes back.
+namespace utf8 {
+inline constexpr u8 TooShort  = 1u << 0;
+inline constexpr u8 TooLong   = 1u << 1;
+inline constexpr u8 Overlong3 = 1u << 2;
+inline constexpr u8 TooLarge  = 1u << 3;
+inline constexpr u8 Surrogate = 1u << 4;
+inline constexpr u8 Overlong2 = 1u << 5;
+inline constexpr u8 Overlong4 = 1u << 6;
+inline constexpr u8 TwoConts  = 1u << 7;
+
+// Shares its bit with Overlong4, they follow different leads.
+inline constexpr u8 TooLarge1000 = 1u << 6;
+
+inline constexpr u8 Carry = TooShort | TooLong | TwoConts;
+
+// By the high nibble of the first byte.
+alignas(16) inline constexpr u8 FirstHigh[16] = {
+  TooLong, TooLong, TooLong, TooLong,
+  TooLong, TooLong, TooLong, TooLong,
+  TwoConts, TwoConts, TwoConts, TwoConts,
+  TooShort | Overlong2,
+  TooShort,
+  TooShort | Overlong3 | Surrogate,
+  TooShort | TooLarge | TooLarge1000 | Overlong4};
+
+// By the low nibble of the first byte.
+alignas(16) inline constexpr u8 FirstLow[16] = {
+  Carry | Overlong3 | Overlong2 | Overlong4,
+  Carry | Overlong2,
+  Carry,
+  Carry,
+  Carry | TooLarge,
+  Carry | TooLarge | TooLarge1000,
+  Carry | TooLarge | TooLarge1000,
+  Carry | TooLarge | TooLarge1000,
+  Carry | TooLarge | TooLarge1000,
+  Carry | TooLarge | TooLarge1000,
+  Carry | TooLarge | TooLarge1000,
+  Carry | TooLarge | TooLarge1000,
+  Carry | TooLarge | TooLarge1000,
+  Carry | TooLarge | TooLarge1000 | Surrogate,
+  Carry | TooLarge | TooLarge1000,
+  Carry | TooLarge | TooLarge1000};
+
+// By the high nibble of the second byte.
+alignas(16) inline constexpr u8 SecondHigh[16] = {
+  TooShort, TooShort, TooShort, TooShort,
+  TooShort, TooShort, TooShort, TooShort,
+  TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4,
+  TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,
+  TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+  TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+  TooShort, TooShort, TooShort, TooShort};
+
+// Bytes above these in the last three positions start a sequence that
+// doesn't fit.
+alignas(32) inline constexpr u8 IncompleteMax[32] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf};
+} // namespace utf8
+
+VD_TARGET("avx2")
+inline __m256i loadUtf8TableAVX2(const u8* table)
+{
+  return _mm256_broadcastsi128_si256(
+    _mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+// The bytes N positions back, from the previous half at the start.
+template<int N>
+VD_TARGET("avx2")
+inline __m256i shiftUtf8AVX2(__m256i input, __m256i prev)
+{
+  return _mm256_alignr_epi8(
+    input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+}
+
+VD_TARGET("avx2")
+inline __m256i highNibbleAVX2(__m256i value)
+{
+  return _mm256_and_si256(
+    _mm256_srli_epi16(value, 4), _mm256_set1_epi8(0x0f));
+}
+
+VD_TARGET("avx2")
+inline __m256i checkUtf8HalfAVX2(__m256i input, __m256i prev)
+{
+  const auto prev1   = shiftUtf8AVX2<1>(input, prev);
+  const auto special = _mm256_and_si256(
+    _mm256_and_si256(
+      _mm256_shuffle_epi8(
+        loadUtf8TableAVX2(utf8::FirstHigh), highNibbleAVX2(prev1)),
+      _mm256_shuffle_epi8(
+        loadUtf8TableAVX2(utf8::FirstLow),
+        _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)))),
+    _mm256_shuffle_epi8(
+      loadUtf8TableAVX2(utf8::SecondHigh), highNibbleAVX2(input)));
+
+  // Only leads of three and four bytes keep their top bit.
+  const auto third = _mm256_subs_epu8(
+    shiftUtf8AVX2<2>(input, prev), _mm256_set1_epi8(0xe0 - 0x80));
+  const auto fourth = _mm256_subs_epu8(
+    shiftUtf8AVX2<3>(input, prev), _mm256_set1_epi8(0xf0 - 0x80));
+  const auto must23 = _mm256_and_si256(
+    _mm256_or_si256(third, fourth),
+    _mm256_set1_epi8(static_cast<char>(0x80)));
+
+  return _mm256_xor_si256(must23, special);
+}
+
+VD_TARGET("avx2")
+inline void checkUtf8AVX2(const char* src, Utf8State& state)
+{
+  const auto lo =
+    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+  const auto hi =
+    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+  auto* prev = reinterpret_cast<__m256i*>(state.prev.data());
+
+  if(_mm256_movemask_epi8(_mm256_or_si256(lo, hi)) == 0) {
+    if(state.isIncomplete) state.isError = true;
+    state.isIncomplete = false;
+    _mm256_storeu_si256(prev, hi);
+    return;
+  }
+
+  const auto error = _mm256_or_si256(
+    checkUtf8HalfAVX2(lo, _mm256_loadu_si256(prev)),
+    checkUtf8HalfAVX2(hi, lo));
+  if(!_mm256_testz_si256(error, error)) state.isError = true;
+
+  const auto incomplete = _mm256_subs_epu8(
+    hi,
+    _mm256_load_si256(
+      reinterpret_cast<const __m256i*>(utf8::IncompleteMax)));
+  state.isIncomplete = !_mm256_testz_si256(incomplete, incomplete);
+  _mm256_storeu_si256(prev, hi);
+}
+#endif
+
+inline ClassifyFn getClassifyFn()
+{
+#ifdef VD_ARCH_X64
+  if(getCpuFeatures().avx2) return &classifyAVX2;
+  if(getCpuFeatures().sse2) return &classifySSE2;
+#endif
+  return &classifyScalar;
+}
+
+inline PrefixXorFn getPrefixXorFn()
+{
+#ifdef VD_ARCH_X64
+  if(getCpuFeatures().pclmul) return &prefixXorClmul;
+#endif
+  return &prefixXorScalar;
+}
+
+inline Utf8Fn getUtf8Fn()
+{
+#ifdef VD_ARCH_X64
+  if(getCpuFeatures().avx2) return &checkUtf8AVX2;
+#endif
+  return &checkUtf8Scalar;
+}
+
+// Stage 1, the positions of the structural characters and of the first
+// byte of every string, number and literal, in document order.
+inline Arr<u32> indexStructurals(Span<char const> src)
+{
+  static const ClassifyFn  classify  = getClassifyFn();
+  static const PrefixXorFn prefixXor = getPrefixXorFn();
+  static const Utf8Fn      checkUtf8 = getUtf8Fn();
+
+  if(src.size() >= MaxDocumentSize)
+    throw std::runtime_error("Json: document too large");
+
+  constexpr u64 EvenBits = 0x5555555555555555ull;
+
+  Arr<u32> ret;
+  ret.reserve(src.size() / 8u + 16u);
+
+  // State carried over from the previous block.
+  u64 prevEscaped  = 0u;
+  u64 prevInString = 0u;
+  u64 prevScalar   = 0u;
+
+  SArr<char, BlockSize> tail;
+  BlockMasks            masks;
+  Utf8State             utf8;
+
+  for(u64 offset = 0u; offset < src.size(); offset += BlockSize) {
+    const char* block = src.data() + offset;
+    if(src.size() - offset < BlockSize) {
+      tail.fill(' ');
+      memcpy(tail.data(), block, src.size() - offset);
+      block = tail.data();
+    }
+
+    classify(block, masks);
+    checkUtf8(block, utf8);
+
+    // Backslash runs of odd length escape the next character. Runs
+    // are told apart by adding their odd starts to them, the carry
+    // out continues the last run in the next block.
+    const u64 backslash     = masks.backslash & ~prevEscaped;
+    const u64 followsEscape = (backslash << 1) | prevEscaped;
+    const u64 oddStarts     = backslash & ~EvenBits & ~followsEscape;
+    const u64 evenSequences = oddStarts + backslash;
+    prevEscaped             = evenSequences < oddStarts ? 1u : 0u;
+    const u64 escaped =
+      (EvenBits ^ (evenSequences << 1)) & followsEscape;
+
+    // Bits between an opening quote and the closing one, the opening
+    // quote included.
+    const u64 quote    = masks.quote & ~escaped;
+    const u64 inString = prefixXor(quote) ^ prevInString;
+    prevInString       = toU64(toI64(inString) >> 63);
+
+    // Spaces other than the blank are control characters too, they
+    // are only allowed between values.
+    if(masks.control & (inString | ~masks.space))
+      throw std::runtime_error("Json: control character");
+
+    // Scalars start after an operator, a space or a quote.
+    const u64 scalar   = ~(masks.op | masks.space);
+    const u64 nonQuote = scalar & ~quote;
+    const u64 follows  = (nonQuote << 1) | prevScalar;
+    prevScalar         = nonQuote >> 63;
+    const u64 stringTail = inString ^ quote;
+
+    // Everything within strings and their closing quotes is dropped.
+    u64 bits = (masks.op | (scalar & ~follows)) & ~stringTail;
+    while(bits) {
+      ret.push_back(toU32(offset + toU64(std::countr_zero(bits))));
+      bits &= bits - 1u;
+    }
+  }
+
+  if(prevInString)
+    throw std::runtime_error("Json: unterminated string");
+  if(utf8.isError || utf8.isIncomplete)
+    throw std::runtime_error("Json: invalid UTF-8");
+
+  return ret;
+}
+
+// Returns the first quote or backslash, or the end.
+inline const char* findStringStop(const char* src, const char* end)
+{
+#ifdef VD_ARCH_X64
+  const auto quote     = _mm_set1_epi8('"');
+  const auto backslash = _mm_set1_epi8('\\');
+  for(; end - src >= 16; src += 16) {
+    const auto v =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const u32 mask = toU32(_mm_movemask_epi8(_mm_or_si128(
+      _mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash))));
+    if(mask) return src + std::countr_zero(mask);
+  }
+#endif
+  while(src < end && *src != '"' && *src != '\\') ++src;
+  return src;
+}
+
+inline u32 readHex4(const char* src, const char* end)
+{
+  if(end - src < 4) throw std::runtime_error("Json: bad escape");
+
+  u32 ret = 0u;
+  for(u32 idx = 0u; idx < 4u; ++idx) {
+    const char c = src[idx];
+    u32        digit;
+    if(c >= '0' && c <= '9') digit = toU32(c - '0');
+    else if(c >= 'a' && c <= 'f')
+      digit = toU32(c - 'a' + 10);
+    else if(c >= 'A' && c <= 'F')
+      digit = toU32(c - 'A' + 10);
+    else
+      throw std::runtime_error("Json: bad escape");
+    ret = (ret << 4) | digit;
+  }
+  return ret;
+}
+
+inline void appendUtf8(Arr<char>& dst, u32 code)
+{
+  const auto put = [&](u32 byte) {
+    dst.push_back(static_cast<char>(byte));
+  };
+
+  if(code < 0x80u) put(code);
+  else if(code < 0x800u) {
+    put(0xc0u | (code >> 6));
+    put(0x80u | (code & 0x3fu));
+  } else if(code < 0x10000u) {
+    put(0xe0u | (code >> 12));
+    put(0x80u | ((code >> 6) & 0x3fu));
+    put(0x80u | (code & 0x3fu));
+  } else {
+    put(0xf0u | (code >> 18));
+    put(0x80u | ((code >> 12) & 0x3fu));
+    put(0x80u | ((code >> 6) & 0x3fu));
+    put(0x80u | (code & 0x3fu));
+  }
+}
+
+// Decodes the escape at src, returns where the string continues.
+// Surrogate pairs are joined, lone surrogates are errors.
+inline const char*
+decodeEscape(const char* src, const char* end, Arr<char>& dst)
+{
+  if(end - src < 2) throw std::runtime_error("Json: bad escape");
+
+  switch(src[1]) {
+    case '"':
+    case '\\':
+    case '/': dst.push_back(src[1]); return src + 2;
+    case 'b': dst.push_back('\b'); return src + 2;
+    case 'f': dst.push_back('\f'); return src + 2;
+    case 'n': dst.push_back('\n'); return src + 2;
+    case 'r': dst.push_back('\r'); return src + 2;
+    case 't': dst.push_back('\t'); return src + 2;
+    case 'u': break;
+    default: throw std::runtime_error("Json: bad escape");
+  }
+
+  u32 code = readHex4(src + 2, end);
+  src += 6;
+
+  if(code >= 0xd800u && code < 0xdc00u) {
+    if(end - src < 2 || src[0] != '\\' || src[1] != 'u')
+      throw std::runtime_error("Json: bad surrogate pair");
+
+    const u32 low = readHex4(src + 2, end);
+    if(low < 0xdc00u || low >= 0xe000u)
+      throw std::runtime_error("Json: bad surrogate pair");
+
+    code = 0x10000u + ((code - 0xd800u) << 10) + (low - 0xdc00u);
+    src += 6;
+  } else if(code >= 0xdc00u && code < 0xe000u)
+    throw std::runtime_error("Json: bad surrogate pair");
+
+  appendUtf8(dst, code);
+  return src;
+}
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Numbers beyond the range of doubles go to infinity or zero, which
+// only depends on where their first significant digit is.
+inline f64 parseOutOfRange(const char* src, const char* end)
+{
+  const bool isNegative = *src == '-';
+
+  i64  magnitude = 0;
+  bool isPoint   = false;
+  for(; src < end && *src != 'e' && *src != 'E'; ++src) {
+    if(*src == '.') isPoint = true;
+    else if(*src > '0')
+      break;
+    else if(*src == '0' && isPoint)
+      --magnitude;
+  }
+  for(; src < end && isDigit(*src); ++src)
+    if(!isPoint) ++magnitude;
+  while(src < end && *src != 'e' && *src != 'E') ++src;
+
+  if(src < end) {
+    const bool isNegativeExp = src + 1 < end && src[1] == '-';
+    i64        exponent      = 0;
+    for(++src; src < end; ++src)
+      if(isDigit(*src))
+        exponent = std::min<i64>(exponent * 10 + (*src - '0'), 1 << 20);
+    magnitude += isNegativeExp ? -exponent : exponent;
+  }
+
+  const f64 value =
+    magnitude > 0 ? std::numeric_limits<f64>::infinity() : 0.0;
+  return isNegative ? -value : value;
+}
+
+// Powers of ten that doubles hold exactly.
+inline constexpr f64 ExactPowersOf10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Checks the number grammar and converts it in the same pass, returns
+// the end of the number or null when it is malformed.
+//
+// Integers of up to 19 digits are converted exactly from their u64,
+// and so are the other numbers whose digits fit in the 53 bits of a
+// double and whose exponent is within 22 (Clinger's fast path), which
+// makes the single multiply or divide correctly rounded. The rest goes
+// to std::from_chars. Integers that fit an i64 are also returned as
+// such, -0 excepted.
+inline const char* parseNumber(
+  const char* src, const char* end, f64& value, Opt<i64>& integer)
+{
+  integer.reset();
+
+  const char* cursor     = src;
+  const bool  isNegative = cursor < end && *cursor == '-';
+  if(isNegative) ++cursor;
+
+  u64        mantissa   = 0u;
+  const auto readDigits = [&]() {
+    const char* start = cursor;
+    for(; cursor < end && isDigit(*cursor); ++cursor)
+      mantissa = mantissa * 10u + static_cast<u64>(*cursor - '0');
+    return toU64(cursor - start);
+  };
+
+  // No leading zeros.
+  const char* intStart = cursor;
+  u64         digits   = readDigits();
+  if(digits == 0u || (digits > 1u && *intStart == '0')) return nullptr;
+
+  bool isInteger = true;
+  i64  exponent  = 0;
+
+  if(cursor < end && *cursor == '.') {
+    ++cursor;
+    const u64 fraction = readDigits();
+    if(fraction == 0u) return nullptr;
+
+    digits += fraction;
+    exponent -= toI64(fraction);
+    isInteger = false;
+  }
+
+  if(cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+    ++cursor;
+    const bool isNegativeExp = cursor < end && *cursor == '-';
+    if(cursor < end && (*cursor == '+' || *cursor == '-')) ++cursor;
+
+    const char* expStart = cursor;
+    i64         expValue = 0;
+    for(; cursor < end && isDigit(*cursor); ++cursor)
+      expValue =
+        std::min<i64>(expValue * 10 + (*cursor - '0'), 1 << 20);
+    if(cursor == expStart) return nullptr;
+
+    exponent += isNegativeExp ? -expValue : expValue;
+    isInteger = false;
+  }
+
+  if(digits <= 19u) {
+    f64 ret = static_cast<f64>(mantissa);
+    if(isInteger) {
+      value = isNegative ? -ret : ret;
+
+      constexpr u64 MaxI64 = toU64(std::numeric_limits<i64>::max());
+      if(!isNegative && mantissa <= MaxI64)
+        integer = toI64(mantissa);
+      else if(isNegative && mantissa > 0u && mantissa <= MaxI64 + 1u)
+        integer = toI64(0u - mantissa);
+      return cursor;
+    }
+    if(mantissa <= 1ull << 53 && exponent >= -22 && exponent <= 22) {
+      if(exponent < 0) ret /= ExactPowersOf10[-exponent];
+      else
+        ret *= ExactPowersOf10[exponent];
+      value = isNegative ? -ret : ret;
+      return cursor;
+    }
+  }
+
+  const auto result = std::from_chars(src, cursor, value);
+  if(result.ec == std::errc::result_out_of_range)
+    value = parseOutOfRange(src, cursor);
+  else if(result.ec != std::errc{})
+    throw std::runtime_error("Json: bad number");
+
+  return cursor;
+}
+
+// Literals and numbers must be followed by a space, an operator or the
+// end of the document.
+inline bool isScalarEnd(const char* src, const char* end)
+{
+  return src == end || isSpace(*src) || isOp(*src);
+}
+
+// Checks the true, false or null literal at src.
+inline void checkLiteral(const char* src, const char* end)
+{
+  const Strv literal = *src == 't'   ? "true"
+                       : *src == 'f' ? "false"
+                                     : "null";
+  if(
+    toU64(end - src) < literal.size() ||
+    Strv(src, literal.size()) != literal ||
+    !isScalarEnd(src + literal.size(), end))
+    throw std::runtime_error("Json: bad literal");
+}
+
+// Parses the number at src, which must end there.
+inline f64
+readNumber(const char* src, const char* end, Opt<i64>& integer)
+{
+  f64         ret  = 0.0;
+  const char* stop = parseNumber(src, end, ret, integer);
+  if(!stop || !isScalarEnd(stop, end))
+    throw std::runtime_error("Json: unexpected character");
+  return ret;
+}
+
+// Converts an integer to T, throws when it doesn't fit.
+template<typename T>
+T toNumber(i64 value)
+{
+  if constexpr(std::is_integral_v<T>) {
+    if(!std::in_range<T>(value))
+      throw std::runtime_error("Json: number out of range");
+  }
+  return static_cast<T>(value);
+}
+
+// Converts a number to T, throws when it doesn't fit. Integer types
+// only take whole numbers.
+template<typename T>
+T toNumber(f64 value)
+{
+  if constexpr(std::is_integral_v<T>) {
+    // The bounds are powers of two, exact in doubles.
+    constexpr int Digits = std::numeric_limits<T>::digits;
+    const f64     max    = std::ldexp(1.0, Digits);
+    const f64     min    = std::is_signed_v<T> ? -max : 0.0;
+    if(!(value >= min && value < max) || std::trunc(value) != value)
+      throw std::runtime_error("Json: number out of range");
+  } else if(
+    std::isfinite(value) &&
+    std::abs(value) > std::numeric_limits<T>::max())
+    throw std::runtime_error("Json: number out of range");
+
+  return static_cast<T>(value);
+}
+
+// Vectors and matrices read by AsVector, matrices are filled column by
+// column like glTF stores them.
+template<typename T>
+struct VectorTraits;
+
+template<typename T, u64 S>
+struct VectorTraits<Vector<T, S>> {
+  using Component = T;
+
+  static constexpr u64 Size = S;
+
+  static T& Get(Vector<T, S>& value, u64 idx) { return value[idx]; }
+};
+
+template<typename T, u64 S>
+struct VectorTraits<Matrix<T, S>> {
+  using Component = T;
+
+  static constexpr u64 Size = S * S;
+
+  static T& Get(Matrix<T, S>& value, u64 idx)
+  {
+    return value[idx / S][idx % S];
+  }
+};
+
+// Reads the string whose opening quote is at src. Strings without
+// escapes are returned as views into the source, the others are
+// unescaped into the buffer.
+inline Strv
+readString(const char* src, const char* end, Arr<char>& buffer)
+{
+  ++src;
+  const char* stop = findStringStop(src, end);
+  if(stop == end) throw std::runtime_error("Json: unterminated string");
+  if(*stop == '"') return {src, toU64(stop - src)};
+
+  buffer.assign(src, stop);
+  for(;;) {
+    src  = decodeEscape(stop, end, buffer);
+    stop = findStringStop(src, end);
+    if(stop == end)
+      throw std::runtime_error("Json: unterminated string");
+
+    buffer.insert(buffer.end(), src, stop);
+    if(*stop == '"') return {buffer.data(), buffer.size()};
+  }
+}
+
+inline constexpr u32 MaxDepth = 1024u;
+
+// Stage 2 walks the structural index once, checks the grammar and
+// calls the handler for each value in document order:
+//
+//   OnNull(), OnBool(bool), OnString(Strv)
+//   OnInteger(i64), for integers that fit, exact
+//   OnNumber(f64), for the other numbers
+//   OnKey(Strv), before each member of an object
+//   OnObjectBegin(), OnObjectEnd(u64 memberCount)
+//   OnArrayBegin(), OnArrayEnd(u64 itemCount)
+//
+// Strings point into the source when they have no escapes, otherwise
+// they only last until the next call.
+template<typename Handler>
+void parse(Span<char const> src, Handler& handler)
+{
+  const auto index = indexStructurals(src);
+  if(index.empty()) throw std::runtime_error("Json: empty document");
+
+  const char* begin = src.data();
+  const char* end   = begin + src.size();
+
+  u64        at   = 0u;
+  const auto next = [&]() {
+    if(at == index.size())
+      throw std::runtime_error("Json: unexpected end of document");
+    return begin + index[at++];
+  };
+
+  // Open containers and their member count.
+  struct Scope {
+    u64  count;
+    bool isObject;
+  };
+  Arr<Scope> scopes;
+  Arr<char>  buffer;
+
+  enum class State { Value, Key, Next };
+  State state = State::Value;
+
+  for(;;) {
+    if(state == State::Key) {
+      const char* key = next();
+      if(*key != '"') throw std::runtime_error("Json: expected a key");
+      handler.OnKey(readString(key, end, buffer));
+
+      if(*next() != ':') throw std::runtime_error("Json: expected ':'");
+      state = State::Value;
+      continue;
+    }
+
+    if(state == State::Value) {
+      if(!scopes.empty()) ++scopes.back().count;
+
+      const char* value = next();
+      state             = State::Next;
+
+      switch(*value) {
+        case '{':
+        case '[': {
+          if(scopes.size() == MaxDepth)
+            throw std::runtime_error("Json: nesting too deep");
+
+          const bool isObject = *value == '{';
+          scopes.push_back({0u, isObject});
+          if(isObject) handler.OnObjectBegin();
+          else
+            handler.OnArrayBegin();
+
+          // Empty containers are closed right away.
+          const char close = isObject ? '}' : ']';
+          if(at == index.size() || begin[index[at]] != close)
+            state = isObject ? State::Key : State::Value;
+        } break;
+        case '"':
+          handler.OnString(readString(value, end, buffer));
+          break;
+        case 't':
+        case 'f':
+        case 'n': {
+          checkLiteral(value, end);
+          if(*value == 'n') handler.OnNull();
+          else
+            handler.OnBool(*value == 't');
+        } break;
+        default: {
+          Opt<i64>  integer;
+          const f64 number = readNumber(value, end, integer);
+          if(integer) handler.OnInteger(*integer);
+          else
+            handler.OnNumber(number);
+        } break;
+      }
+      continue;
+    }
+
+    if(scopes.empty()) {
+      if(at != index.size())
+        throw std::runtime_error("Json: trailing characters");
+      break;
+    }
+
+    const char  c     = *next();
+    const Scope scope = scopes.back();
+    if(c == ',') {
+      state = scope.isObject ? State::Key : State::Value;
+    } else if(c == (scope.isObject ? '}' : ']')) {
+      scopes.pop_back();
+      if(scope.isObject) handler.OnObjectEnd(scope.count);
+      else
+        handler.OnArrayEnd(scope.count);
+    } else
+      throw std::runtime_error("Json: expected ',' or a bracket");
+  }
+}
+
+// Values in a tape like simdjson's: a 64-bit word for each value with
+// the type in the top byte. Numbers and integers are followed by a word
+// with their bits. Containers are closed by an end word and point past
+// it, so they can be skipped, along with their member count. Strings
+// are copied into a separate buffer, after their length.
+class Tape
+{
+public:
+  enum class Type : u8 {
+    Null      = 'n',
+    True      = 't',
+    False     = 'f',
+    Number    = 'd',
+    Integer   = 'l',
+    String    = '"',
+    Array     = '[',
+    ArrayEnd  = ']',
+    Object    = '{',
+    ObjectEnd = '}'
+  };
+
+  // Counts of larger containers are clamped.
+  static constexpr u64 MaxCount = 0xffffffu;
+
+public:
+  Tape() = default;
+  Tape(Span<char const> src) { Parse(src); }
+
+  void Parse(Span<char const> src)
+  {
+    m_words.clear();
+    m_strings.clear();
+    m_open.clear();
+    parse(src, *this);
+  }
+
+  bool IsEmpty() const { return m_words.empty(); }
+
+  Type GetType(u64 idx) const
+  {
+    return static_cast<Type>(m_words[idx] >> 56);
+  }
+
+  // Index of the value after this one, containers are skipped whole.
+  u64 GetNext(u64 idx) const
+  {
+    switch(GetType(idx)) {
+      case Type::Array:
+      case Type::Object: return getPayload(idx) & 0xffffffffu;
+      case Type::Number:
+      case Type::Integer: return idx + 2u;
+      default: return idx + 1u;
+    }
+  }
+
+  u64 GetCount(u64 idx) const { return getPayload(idx) >> 32; }
+
+  // Integers are converted.
+  f64 GetNumber(u64 idx) const
+  {
+    if(GetType(idx) == Type::Integer)
+      return static_cast<f64>(GetInteger(idx));
+    return std::bit_cast<f64>(m_words[idx + 1u]);
+  }
+
+  i64 GetInteger(u64 idx) const
+  {
+    return std::bit_cast<i64>(m_words[idx + 1u]);
+  }
+
+  Strv GetString(u64 idx) const
+  {
+    const char* src = m_strings.data() + getPayload(idx);
+    u32         size;
+    memcpy(&size, src, sizeof(size));
+    return {src + sizeof(size), size};
+  }
+
+public:
+  // Parser handler.
+  void OnNull() { push(Type::Null); }
+  void OnBool(bool value) { push(value ? Type::True : Type::False); }
+
+  void OnNumber(f64 value)
+  {
+    push(Type::Number);
+    m_words.push_back(std::bit_cast<u64>(value));
+  }
+
+  void OnInteger(i64 value)
+  {
+    push(Type::Integer);
+    m_words.push_back(std::bit_cast<u64>(value));
+  }
+
+  void OnString(Strv value)
+  {
+    const u64 offset = m_strings.size();
+    const u32 size   = toU32(value.size());
+    push(Type::String, offset);
+
+    m_strings.resize(offset + sizeof(size));
+    memcpy(m_strings.data() + offset, &size, sizeof(size));
+    m_strings.insert(m_strings.end(), value.begin(), value.end());
+    m_strings.push_back('\0');
+  }
+
+  void OnKey(Strv key) { OnString(key); }
+
+  void OnObjectBegin() { open(); }
+  void OnObjectEnd(u64 count) { close(Type::Object, count); }
+  void OnArrayBegin() { open(); }
+  void OnArrayEnd(u64 count) { close(Type::Array, count); }
+
+private:
+  void push(Type type, u64 payload = 0u)
+  {
+    m_words.push_back((toU64(type) << 56) | payload);
+  }
+
+  u64 getPayload(u64 idx) const
+  {
+    return m_words[idx] & 0xffffffffffffffull;
+  }
+
+  // The word of a container is written once it is closed.
+  void open()
+  {
+    m_open.push_back(m_words.size());
+    m_words.push_back(0u);
+  }
+
+  void close(Type type, u64 count)
+  {
+    const u64 word = m_open.back();
+    m_open.pop_back();
+
+    push(type == Type::Object ? Type::ObjectEnd : Type::ArrayEnd, word);
+    m_words[word] = (toU64(type) << 56) | m_words.size() |
+                    (std::min(count, MaxCount) << 32);
+  }
+
+private:
+  Arr<u64>  m_words;
+  Arr<char> m_strings;
+  Arr<u64>  m_open;
+};
+
+} // namespace vd::Json
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "vuldir/core/Definitions.hpp"
+#include "vuldir/core/Platform.hpp"
+#include "vuldir/core/STL.hpp"
+#include "vuldir/core/Types.hpp"
+#include "vuldir/core/Uti.hpp"
+
+namespace vd {
+
+// Read-only view of a whole file. The data is empty when the file
+// cannot be opened or has no bytes. Other processes can still delete
+// or replace the file while it is mapped.
+class MappedFile
+{
+public:
+  VD_NONCOPYABLE(MappedFile);
+
+  MappedFile(const fs::path& path) { Map(path); }
+
+  MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+  MappedFile& operator=(MappedFile&& other) noexcept
+  {
+    Unmap();
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    return *this;
+  }
+
+  ~MappedFile() { Unmap(); }
+
+  Span<u8 const> GetData() const { return {m_data, m_size}; }
+
+#ifdef VD_OS_WINDOWS
+public:
+  void Map(const fs::path& path)
+  {
+    Unmap();
+
+    const HANDLE file = ::CreateFileW(
+      path.c_str(), GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size = {};
+    if(::GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+      const HANDLE mapping = ::CreateFileMappingW(
+        file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if(mapping) {
+        m_data = static_cast<const u8*>(
+          ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if(m_data) m_size = toU64(size.QuadPart);
+        ::CloseHandle(mapping);
+      }
+    }
+
+    ::CloseHandle(file);
+  }
+
+  void Unmap()
+  {
+    if(!m_data) return;
+
+    ::UnmapViewOfFile(m_data);
+    m_data = nullptr;
+    m_size = 0u;
+  }
+#endif
+
+#if defined(VD_OS_LINUX) || defined(VD_OS_ANDROID)
+public:
+  void Map(const fs::path& path)
+  {
+    Unmap();
+
+    const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(file < 0) return;
+
+    struct stat info = {};
+    if(::fstat(file, &info) == 0 && info.st_size > 0) {
+      void* data = ::mmap(
+        nullptr, toU64(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+      if(data != MAP_FAILED) {
+        m_data = static_cast<const u8*>(data);
+        m_size = toU64(info.st_size);
+      }
+    }
+
+    ::close(file);
+  }
+
+  void Unmap()
+  {
+    if(!m_data) return;
+
+    ::munmap(const_cast<u8*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0u;
+  }
+#endif
+
+private:
+  const u8* m_data = nullptr;
+  u64       m_size = 0u;
+};
+
+} // namespace vd
@@ -24,6 +24,10 @@
 
 #ifdef VD_OS_LINUX
   #include <dlfcn.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
   #include <xcb/xcb.h>
 #endif
 
@@ -5,9 +5,12 @@
 
 #include <algorithm>
 #include <atomic>
+#include <bit>
 #include <bitset>
+#include <charconv>
 #include <cmath>
 #include <cstdarg>
+#include <condition_variable>
 #include <cstring>
 #include <deque>
 #include <filesystem>
@@ -21,6 +24,7 @@
 #include <mutex>
 #include <optional>
 #include <sstream>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
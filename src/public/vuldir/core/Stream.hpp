@@ -12,29 +12,31 @@ class BitIStream
 {
 public:
   BitIStream(Span<u8 const> bytes):
-    m_bytes{bytes},
-    m_cursor{bytes.begin()},
+    m_cursor{bytes.data()},
+    m_end{bytes.data() + bytes.size()},
+    m_chunks{},
     m_buffer{0u},
-    m_bufferSize{0u}
+    m_bufferSize{0u},
+    m_paddingSize{0u}
   {}
 
-  [[nodiscard]] u32 Read(u32 count)
+  // Reads the chunks back to back, without joining them.
+  // The chunk list must outlive the stream.
+  BitIStream(Span<const Span<u8 const>> chunks):
+    m_cursor{nullptr},
+    m_end{nullptr},
+    m_chunks{chunks},
+    m_buffer{0u},
+    m_bufferSize{0u},
+    m_paddingSize{0u}
   {
-    while(m_bufferSize < count) {
-      if(m_cursor == m_bytes.end())
-        throw std::runtime_error("Reached end of bit stream");
-
-      u32 byte = *m_cursor;
-      m_buffer |= byte << m_bufferSize;
-
-      m_cursor++;
-      m_bufferSize += 8u;
-    }
-
-    m_bufferSize -= count;
-    u32 value = m_buffer & ((1u << count) - 1u);
-    m_buffer >>= count;
+    nextChunk();
+  }
 
+  [[nodiscard]] u32 Read(u32 count)
+  {
+    auto value = Peek(count);
+    Skip(count);
     return value;
   }
 
@@ -46,41 +48,148 @@ class BitIStream
 
   [[nodiscard]] u32 Peek(u32 count)
   {
-    while(m_bufferSize < count) {
-      if(m_cursor == m_bytes.end())
-        throw std::runtime_error("Reached end of bit stream");
+    if(m_bufferSize < count) Refill();
+    return toU32(m_buffer & ((1ull << count) - 1u));
+  }
 
-      u32 byte = *m_cursor;
-      m_buffer |= byte << m_bufferSize;
+  void Skip(u32 count)
+  {
+    if(m_bufferSize < count) Refill();
+    Consume(count);
 
-      m_cursor++;
-      m_bufferSize += 8u;
-    }
+    if(m_bufferSize < m_paddingSize)
+      throw std::runtime_error("Reached end of bit stream");
+  }
+
+  void SkipToNextByte() { Skip(m_bufferSize % 8u); }
 
-    return m_buffer & ((1u << count) - 1u);
+  // Tops up the bit buffer to at least 56 bits. Past the end of the
+  // data the buffer is padded with zeros, consuming them throws.
+  // Chunk boundaries are crossed a byte at a time.
+  void Refill()
+  {
+    if(GetBytesLeft() >= 8u) RefillFast();
+    else
+      refillSlow();
   }
 
-  void Skip(u32 count) { [[maybe_unused]] auto v = Read(count); }
+  // Branchless refill, needs at least 8 readable bytes in the current
+  // chunk.
+  // The bits above the buffer size are loaded again by the next refill,
+  // so it is fine to leave them set.
+  void RefillFast()
+  {
+    u64 word;
+    memcpy(&word, m_cursor, sizeof(word));
+    if constexpr(std::endian::native == std::endian::big)
+      word = byteSwap(word);
+
+    m_buffer |= word << m_bufferSize;
+    m_cursor += (63u - m_bufferSize) >> 3u;
+    m_bufferSize |= 56u;
+  }
 
-  void SkipToNextByte() { Skip(m_bufferSize % 8u); }
+  // Raw access to the bit buffer for decoders that refill manually.
+  // No bound checks, use Skip near the end of the data.
+  u64  PeekBuffer() const { return m_buffer; }
+  void Consume(u32 count)
+  {
+    m_buffer >>= count;
+    m_bufferSize -= count;
+  }
+
+  // Must be byte aligned. Passes the next bytes to the callback, in
+  // as many pieces as the chunks they span.
+  template<typename Callback>
+  void ReadBytes(u64 size, const Callback& callback)
+  {
+    // Whole bytes left in the bit buffer come first.
+    u8  buffered[8];
+    u64 bufferedCount = 0u;
+    while(size > 0u && m_bufferSize >= m_paddingSize + 8u) {
+      buffered[bufferedCount++] = toU8(m_buffer);
+      Consume(8u);
+      --size;
+    }
+    if(bufferedCount > 0u)
+      callback(Span<u8 const>{buffered, bufferedCount});
+
+    if(size == 0u) return;
+
+    // The buffer may still hold bits loaded ahead of the cursor.
+    m_buffer     = 0u;
+    m_bufferSize = 0u;
+
+    while(size > 0u) {
+      if(m_cursor == m_end && !nextChunk())
+        throw std::runtime_error("Reached end of bit stream");
+
+      auto count = std::min(size, GetBytesLeft());
+      callback(Span<u8 const>{m_cursor, count});
+      m_cursor += count;
+      size -= count;
+    }
+  }
+
+  // Bytes left in the current chunk.
+  u64 GetBytesLeft() const { return toU64(m_end - m_cursor); }
 
   bool HasMoreData() const
   {
-    return m_bufferSize > 0u || m_cursor != m_bytes.end();
+    return m_bufferSize > m_paddingSize || m_cursor != m_end ||
+           std::any_of(
+             m_chunks.begin(), m_chunks.end(),
+             [](const auto& chunk) { return !chunk.empty(); });
   }
 
 private:
-  Span<u8 const>           m_bytes;
-  Span<u8 const>::iterator m_cursor;
+  void refillSlow()
+  {
+    while(m_bufferSize <= 56u) {
+      u64 byte = 0u;
+      if(m_cursor != m_end || nextChunk()) byte = *m_cursor++;
+      else
+        m_paddingSize += 8u;
+
+      m_buffer |= byte << m_bufferSize;
+      m_bufferSize += 8u;
+    }
+  }
+
+  bool nextChunk()
+  {
+    while(!m_chunks.empty()) {
+      auto chunk = m_chunks.front();
+      m_chunks   = m_chunks.subspan(1u);
+
+      if(!chunk.empty()) {
+        m_cursor = chunk.data();
+        m_end    = chunk.data() + chunk.size();
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  const u8* m_cursor;
+  const u8* m_end;
 
-  u32 m_buffer;
+  // Chunks after the current one.
+  Span<const Span<u8 const>> m_chunks;
+
+  u64 m_buffer;
   u32 m_bufferSize;
+  u32 m_paddingSize;
 };
 
+// Bits are written least significant first, as deflate expects. They
+// are collected in a 64-bit buffer and moved out 32 at a time.
 class BitOStream
 {
 public:
-  BitOStream(u64 sizeHint = 0u): m_bytes{}, m_offset{0u}
+  BitOStream(u64 sizeHint = 0u):
+    m_bytes{}, m_buffer{0u}, m_bufferSize{0u}
   {
     if(sizeHint > 0u) m_bytes.reserve(sizeHint);
   }
@@ -99,53 +208,50 @@ class BitOStream
     }
   }
 
+  // Up to 32 bits, the ones above count are ignored.
   void Write(u32 v, u32 count)
   {
-    u32 bitsDone = 0u;
-    u32 bitsLeft = count;
-
-    if(m_offset == 0u) m_bytes.push_back(0u);
+    m_buffer |= (toU64(v) & ((1ull << count) - 1u)) << m_bufferSize;
+    m_bufferSize += count;
 
-    { // Write bits in the current byte.
-      u32 bitsToByteEnd = 8u - m_offset;
-      u32 writableBits  = std::min(count, bitsToByteEnd);
-
-      if(writableBits > 0u) {
-        u32 mask = (1 << writableBits) - 1;
-        m_bytes.back() |= (v & mask) << m_offset;
-        m_offset = (m_offset + writableBits) % 8u;
-      }
-
-      bitsDone += writableBits;
-      bitsLeft -= writableBits;
-    }
+    if(m_bufferSize >= 32u) {
+      u64 offset = m_bytes.size();
+      m_bytes.resize(offset + 4u);
+      for(u32 idx = 0u; idx < 4u; ++idx)
+        m_bytes[offset + idx] = toU8(m_buffer >> (idx * 8u));
 
-    // Whole bytes
-    while((bitsDone + 8u) <= count) {
-      u8 byte = toU8((v >> bitsDone) & 0xff);
-      m_bytes.push_back(byte);
-      bitsDone += 8u;
-      bitsLeft -= 8u;
+      m_buffer >>= 32u;
+      m_bufferSize -= 32u;
     }
+  }
 
-    // Remaining bits.
-    if(bitsDone < count) {
-      u32 mask = (1 << bitsDone) - 1;
-      u8  bits = toU8((v >> bitsDone) & mask);
-      m_bytes.push_back(bits);
-      m_offset = bitsLeft;
+  // Pads the last byte with zeros.
+  void AlignToByte()
+  {
+    while(m_bufferSize > 0u) {
+      m_bytes.push_back(toU8(m_buffer));
+      m_buffer >>= 8u;
+      m_bufferSize = m_bufferSize > 8u ? m_bufferSize - 8u : 0u;
     }
   }
 
-  u64 size() { return (m_bytes.size() * 8u) - (8u - m_offset); }
+  // Starts at the next byte.
+  void WriteBytes(Span<u8 const> v)
+  {
+    AlignToByte();
+    m_bytes.insert(m_bytes.end(), v.begin(), v.end());
+  }
 
-  Arr<u8>& data() { return m_bytes; }
+  u64 size() const { return m_bytes.size() * 8u + m_bufferSize; }
 
+  // Only the complete bytes, align first to get the last bits as well.
+  Arr<u8>&       data() { return m_bytes; }
   const Arr<u8>& data() const { return m_bytes; }
 
 private:
   Arr<u8> m_bytes;
-  u32     m_offset;
+  u64     m_buffer;
+  u32     m_bufferSize;
 };
 
 class ByteIStream
@@ -257,6 +363,16 @@ class ByteOStream
     m_data.insert(m_data.end(), v.begin(), v.end());
   }
 
+  template<typename T>
+  void WriteSwap(T v)
+  {
+    v = vd::byteSwap(v);
+
+    u8 bytes[sizeof(T)];
+    memcpy(bytes, &v, sizeof(T));
+    Write(bytes);
+  }
+
   u8& operator[](u64 idx) { return m_data[idx]; }
   u8  operator[](u64 idx) const { return m_data[idx]; }
 
@@ -0,0 +1,418 @@
+#include "vuldir/DataReader.hpp"
+#include "vuldir/DataWriter.hpp"
+
+#include <cstdio>
+#include <random>
+
+using namespace vd;
+
+// Block compresses images through DataReader and decodes the blocks
+// back with the decoders below, which follow the format specification.
+// Solid blocks must come back in their place in the image, exact but
+// for BC7, and other blocks close to the source.
+
+static u32 s_failures = 0u;
+static u32 s_checks   = 0u;
+
+static void check(bool condition, const char* what)
+{
+  ++s_checks;
+  if(!condition) {
+    ++s_failures;
+    std::printf("%s: failed\n", what);
+  }
+}
+
+static u64 readLE(const u8* src, u32 size)
+{
+  u64 ret = 0u;
+  for(u32 idx = 0u; idx < size; ++idx)
+    ret |= toU64(src[idx]) << (8u * idx);
+  return ret;
+}
+
+static void unpack565(u16 packed, u32* color)
+{
+  const u32 r = (packed >> 11) & 31u;
+  const u32 g = (packed >> 5) & 63u;
+  const u32 b = packed & 31u;
+
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1, 16 RGBA texels. Opaque blocks have the first color larger.
+static void decodeBC1(const u8* src, u8* rgba)
+{
+  const u16 c0   = toU16(readLE(src, 2u));
+  const u16 c1   = toU16(readLE(src + 2, 2u));
+  const u64 bits = readLE(src + 4, 4u);
+
+  u32 palette[4][4] = {};
+  unpack565(c0, palette[0]);
+  unpack565(c1, palette[1]);
+  palette[0][3] = palette[1][3] = palette[2][3] = 255u;
+
+  for(u32 channel = 0u; channel < 3u; ++channel) {
+    const u32 a = palette[0][channel];
+    const u32 b = palette[1][channel];
+    if(c0 > c1) {
+      palette[2][channel] = (2u * a + b + 1u) / 3u;
+      palette[3][channel] = (a + 2u * b + 1u) / 3u;
+    } else
+      palette[2][channel] = (a + b + 1u) / 2u;
+  }
+  if(c0 > c1) palette[3][3] = 255u;
+
+  for(u32 texel = 0u; texel < 16u; ++texel)
+    for(u32 channel = 0u; channel < 4u; ++channel)
+      rgba[texel * 4u + channel] =
+        toU8(palette[(bits >> (2u * texel)) & 3u][channel]);
+}
+
+// BC4, one channel of 16 texels, 4 bytes apart.
+static void decodeBC4(const u8* src, u8* dst)
+{
+  const u32 e0   = src[0];
+  const u32 e1   = src[1];
+  const u64 bits = readLE(src + 2, 6u);
+
+  u32 palette[8] = {e0, e1};
+  if(e0 > e1) {
+    for(u32 entry = 2u; entry < 8u; ++entry)
+      palette[entry] =
+        ((8u - entry) * e0 + (entry - 1u) * e1 + 3u) / 7u;
+  } else {
+    for(u32 entry = 2u; entry < 6u; ++entry)
+      palette[entry] =
+        ((6u - entry) * e0 + (entry - 1u) * e1 + 2u) / 5u;
+    palette[6] = 0u;
+    palette[7] = 255u;
+  }
+
+  for(u32 texel = 0u; texel < 16u; ++texel)
+    dst[texel * 4u] = toU8(palette[(bits >> (3u * texel)) & 7u]);
+}
+
+static constexpr u32 Bc7Weights4[16] = {
+  0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// BC7 in mode 6, the only one the encoder writes. Other modes decode
+// as magenta so they fail the comparisons.
+static void decodeBC7(const u8* src, u8* rgba)
+{
+  u32        offset = 0u;
+  const auto read   = [&](u32 count) {
+    u32 ret = 0u;
+    for(u32 bit = 0u; bit < count; ++bit, ++offset)
+      ret |= toU32((src[offset / 8u] >> (offset % 8u)) & 1u) << bit;
+    return ret;
+  };
+
+  if(read(7u) != 1u << 6) {
+    for(u32 texel = 0u; texel < 16u; ++texel) {
+      const u8 magenta[4] = {255u, 0u, 255u, 255u};
+      memcpy(rgba + texel * 4u, magenta, 4u);
+    }
+    return;
+  }
+
+  u32 ends[2][4];
+  for(u32 channel = 0u; channel < 4u; ++channel) {
+    ends[0][channel] = read(7u);
+    ends[1][channel] = read(7u);
+  }
+  const u32 pbits[2] = {read(1u), read(1u)};
+
+  for(u32 texel = 0u; texel < 16u; ++texel) {
+    const u32 weight = Bc7Weights4[read(texel == 0u ? 3u : 4u)];
+    for(u32 channel = 0u; channel < 4u; ++channel) {
+      const u32 e0 = (ends[0][channel] << 1) | pbits[0];
+      const u32 e1 = (ends[1][channel] << 1) | pbits[1];
+      rgba[texel * 4u + channel] =
+        toU8(((64u - weight) * e0 + weight * e1 + 32u) >> 6);
+    }
+  }
+}
+
+// Decodes a mip of the compressed image to RGBA8, missing channels are
+// zero and alpha is opaque.
+static Arr<u8> decodeMip(const data::Image& image, u32 mip)
+{
+  const u32 width  = getMipExtent(image.size[0], mip);
+  const u32 height = getMipExtent(image.size[1], mip);
+
+  Arr<u8>   ret(toU64(width) * height * 4u);
+  const u8* src = image.texels.data() + getMipOffset(image, mip);
+
+  for(u32 by = 0u; by < (height + 3u) / 4u; ++by) {
+    for(u32 bx = 0u; bx < (width + 3u) / 4u; ++bx) {
+      u8 block[64];
+      for(u32 texel = 0u; texel < 16u; ++texel) {
+        const u8 zero[4] = {0u, 0u, 0u, 255u};
+        memcpy(block + texel * 4u, zero, 4u);
+      }
+
+      switch(image.format) {
+        case Format::BC1_RGBA_UNORM:
+        case Format::BC1_RGBA_SRGB: decodeBC1(src, block); break;
+        case Format::BC3_UNORM:
+        case Format::BC3_SRGB:
+          decodeBC1(src + 8, block);
+          decodeBC4(src, block + 3);
+          break;
+        case Format::BC4_UNORM: decodeBC4(src, block); break;
+        case Format::BC5_UNORM:
+          decodeBC4(src, block);
+          decodeBC4(src + 8, block + 1);
+          break;
+        default: decodeBC7(src, block); break;
+      }
+      src += getFormatSize(image.format);
+
+      for(u32 texel = 0u; texel < 16u; ++texel) {
+        const u32 x = bx * 4u + texel % 4u;
+        const u32 y = by * 4u + texel / 4u;
+        if(x < width && y < height)
+          memcpy(
+            ret.data() + (toU64(y) * width + x) * 4u,
+            block + texel * 4u, 4u);
+      }
+    }
+  }
+  return ret;
+}
+
+static data::Image compress(
+  Format format, UInt2 size, const Arr<u8>& texels, Format blockFormat,
+  bool generateMips = false, bool srgb = false)
+{
+  DataWriter writer;
+  const DataWriter::ImageSource src{
+    format, size, {texels.data(), texels.size()}};
+  const auto png = writer.WriteImage(src, {});
+
+  DataReader::ImageOptions options;
+  options.blockFormat  = blockFormat;
+  options.generateMips = generateMips;
+  options.srgb         = srgb;
+
+  DataReader reader;
+  return reader.ReadImage({png.data(), png.size()}, options);
+}
+
+// Largest difference of the channels in the mask, and the mean one.
+static void compare(
+  const Arr<u8>& a, const Arr<u8>& b, u32 channelMask, u32& maxError,
+  f64& meanError)
+{
+  maxError  = 0u;
+  meanError = 0.0;
+  u64 count = 0u;
+  for(u64 idx = 0u; idx < a.size(); ++idx) {
+    if(!(channelMask & (1u << (idx % 4u)))) continue;
+    const u32 error = toU32(std::abs(toI32(a[idx]) - toI32(b[idx])));
+    maxError        = std::max(maxError, error);
+    meanError += error;
+    ++count;
+  }
+  meanError /= toF64(count);
+}
+
+struct Case {
+  const char* name;
+  Format      format;
+  u32         channelMask;
+  u64         blockSize;
+
+  // BC7 endpoints share their lowest bit across the channels, so not
+  // every color is exact.
+  u32 solidError;
+};
+
+static constexpr Case Cases[] = {
+  {"BC1", Format::BC1_RGBA_UNORM, 0b0111u, 8u, 0u},
+  {"BC3", Format::BC3_UNORM, 0b1111u, 16u, 0u},
+  {"BC4", Format::BC4_UNORM, 0b0001u, 8u, 0u},
+  {"BC5", Format::BC5_UNORM, 0b0011u, 16u, 0u},
+  {"BC7", Format::BC7_UNORM, 0b1111u, 16u, 1u},
+};
+
+// A solid color for each block. The colors are exact in 5:6:5 and the
+// alpha is above half, so BC1 blocks stay opaque.
+static Arr<u8> makeSolidBlocks(UInt2 size)
+{
+  Arr<u8> ret(toU64(size[0]) * size[1] * 4u);
+  for(u32 y = 0u; y < size[1]; ++y) {
+    for(u32 x = 0u; x < size[0]; ++x) {
+      const u32 block = (y / 4u) * 8u + x / 4u;
+      const u32 red   = (block * 7u) % 32u;
+      const u32 green = (block * 13u + 5u) % 64u;
+      const u32 blue  = (block * 3u + 9u) % 32u;
+
+      u8* texel = ret.data() + (toU64(y) * size[0] + x) * 4u;
+      texel[0]  = toU8((red << 3) | (red >> 2));
+      texel[1]  = toU8((green << 2) | (green >> 4));
+      texel[2]  = toU8((blue << 3) | (blue >> 2));
+      texel[3]  = toU8(255u - block * 2u);
+    }
+  }
+  return ret;
+}
+
+static void testLayout()
+{
+  // Partial blocks on the right and bottom edges.
+  const UInt2 size   = {30u, 22u};
+  const auto  source = makeSolidBlocks(size);
+
+  for(const auto& test: Cases) {
+    const auto image =
+      compress(Format::R8G8B8A8_UNORM, size, source, test.format);
+
+    check(
+      image.format == test.format && image.mips == 1u &&
+        image.size[0] == size[0] && image.size[1] == size[1],
+      test.name);
+    check(
+      image.texels.size() == 8u * 6u * test.blockSize &&
+        getFormatSize(image.format) == test.blockSize,
+      test.name);
+
+    u32 maxError;
+    f64 meanError;
+    compare(
+      decodeMip(image, 0u), source, test.channelMask, maxError,
+      meanError);
+
+    char what[64];
+    std::snprintf(what, sizeof(what), "%s solid blocks", test.name);
+    check(maxError <= test.solidError, what);
+  }
+
+  // The encoder only writes mode 6.
+  const auto bc7 =
+    compress(Format::R8G8B8A8_UNORM, size, source, Format::BC7_UNORM);
+  bool mode6 = true;
+  for(u64 offset = 0u; offset < bc7.texels.size(); offset += 16u)
+    mode6 &= (bc7.texels[offset] & 0x7fu) == 0x40u;
+  check(mode6, "BC7 mode 6");
+
+  // Opaque BC1 blocks have the first color larger, or both equal.
+  const auto bc1 = compress(
+    Format::R8G8B8A8_UNORM, size, source, Format::BC1_RGBA_UNORM);
+  bool opaque = true;
+  for(u64 offset = 0u; offset < bc1.texels.size(); offset += 8u)
+    opaque &= readLE(&bc1.texels[offset], 2u) >=
+              readLE(&bc1.texels[offset + 2u], 2u);
+  check(opaque, "BC1 opaque blocks");
+}
+
+static void testQuality()
+{
+  const UInt2 size = {64u, 48u};
+
+  // Smooth gradients with some noise.
+  std::mt19937 rng(1234u);
+  Arr<u8>      source(toU64(size[0]) * size[1] * 4u);
+  for(u32 y = 0u; y < size[1]; ++y) {
+    for(u32 x = 0u; x < size[0]; ++x) {
+      u8* texel = source.data() + (toU64(y) * size[0] + x) * 4u;
+      texel[0]  = toU8(x * 4u + rng() % 8u);
+      texel[1]  = toU8(y * 5u + rng() % 8u);
+      texel[2]  = toU8((x + y) * 2u);
+      texel[3]  = toU8(255u - x * 2u);
+    }
+  }
+
+  // Limits well above what the encoder gets, the mean error is what
+  // catches a bad fit.
+  const struct {
+    u32 maxError;
+    f64 meanError;
+  } limits[] = {
+    {32u, 6.0}, {32u, 5.0}, {32u, 2.0}, {32u, 2.0}, {32u, 5.0}};
+
+  for(u32 idx = 0u; idx < std::size(Cases); ++idx) {
+    const auto& test = Cases[idx];
+    const auto  image =
+      compress(Format::R8G8B8A8_UNORM, size, source, test.format);
+
+    u32 maxError;
+    f64 meanError;
+    compare(
+      decodeMip(image, 0u), source, test.channelMask, maxError,
+      meanError);
+    std::printf(
+      "%s: max error %u, mean error %.2f\n", test.name, maxError,
+      meanError);
+
+    char what[64];
+    std::snprintf(what, sizeof(what), "%s gradients", test.name);
+    check(
+      maxError <= limits[idx].maxError &&
+        meanError <= limits[idx].meanError,
+      what);
+  }
+}
+
+static void testOptions()
+{
+  const UInt2 size   = {10u, 6u};
+  const auto  source = makeSolidBlocks(size);
+
+  // Every mip down to 1x1, at least one block each.
+  const auto mips = compress(
+    Format::R8G8B8A8_UNORM, size, source, Format::BC7_UNORM, true);
+  u64 expected = 0u;
+  for(u32 mip = 0u; mip < 4u; ++mip)
+    expected += ((getMipExtent(size[0], mip) + 3u) / 4u) *
+                ((getMipExtent(size[1], mip) + 3u) / 4u) * 16u;
+  check(
+    mips.mips == 4u && mips.texels.size() == expected, "BC7 mip chain");
+
+  const auto srgb = compress(
+    Format::R8G8B8A8_UNORM, size, source, Format::BC1_RGBA_UNORM, false,
+    true);
+  check(srgb.format == Format::BC1_RGBA_SRGB, "sRGB variant");
+
+  // Single channel images always use BC4.
+  Arr<u8> gray(toU64(size[0]) * size[1]);
+  for(u64 idx = 0u; idx < gray.size(); ++idx)
+    gray[idx] = source[idx * 4u];
+  const auto bc4 =
+    compress(Format::R8_UNORM, size, gray, Format::BC7_UNORM);
+  check(bc4.format == Format::BC4_UNORM, "single channel to BC4");
+
+  // Texels with an alpha below half are transparent in BC1.
+  Arr<u8> cutout = source;
+  for(u64 idx = 0u; idx < cutout.size(); idx += 4u)
+    cutout[idx + 3u] = (idx / 4u) % 3u == 0u ? 0u : 255u;
+
+  const auto bc1 = compress(
+    Format::R8G8B8A8_UNORM, size, cutout, Format::BC1_RGBA_UNORM);
+  const auto decoded = decodeMip(bc1, 0u);
+
+  u32 maxError;
+  f64 meanError;
+  compare(decoded, cutout, 0b1000u, maxError, meanError);
+  check(maxError == 0u, "BC1 punch through alpha");
+
+  Arr<u8> visible = cutout;
+  for(u64 idx = 0u; idx < visible.size(); idx += 4u)
+    if(visible[idx + 3u] == 0u)
+      memcpy(&visible[idx], &decoded[idx], 3u);
+  compare(decoded, visible, 0b0111u, maxError, meanError);
+  check(maxError == 0u, "BC1 colors around transparent texels");
+}
+
+int main()
+{
+  testLayout();
+  testQuality();
+  testOptions();
+
+  std::printf("%u/%u checks pass\n", s_checks - s_failures, s_checks);
+  return s_failures == 0u ? 0 : 1;
+}
@@ -0,0 +1,460 @@
+#include "vuldir/DataReader.hpp"
+#include "vuldir/DataWriter.hpp"
+
+#include <cstdio>
+
+using namespace vd;
+
+// Reads small DDS and KTX2 files made here, then files with one field
+// of the header broken, and PNG files with a broken size. Those must throw, and before the target is
+// asked for, so the caller never sizes memory from a bad header.
+
+static u32 s_failures = 0u;
+static u32 s_checks   = 0u;
+
+static void check(bool condition, const char* what)
+{
+  ++s_checks;
+  if(!condition) {
+    ++s_failures;
+    std::printf("%s: failed\n", what);
+  }
+}
+
+template<typename T>
+static void append(Arr<u8>& dst, T value)
+{
+  const auto* bytes = reinterpret_cast<const u8*>(&value);
+  dst.insert(dst.end(), bytes, bytes + sizeof(value));
+}
+
+static void appendChars(Arr<u8>& dst, Strv chars)
+{
+  dst.insert(dst.end(), chars.begin(), chars.end());
+}
+
+// Texels that tell their offset apart.
+static void appendTexels(Arr<u8>& dst, u64 size)
+{
+  for(u64 idx = 0u; idx < size; ++idx)
+    dst.push_back(toU8(idx * 7u + idx / 251u));
+}
+
+static data::Image read(const Arr<u8>& file)
+{
+  DataReader reader;
+  return reader.ReadImage({file.data(), file.size()}, {});
+}
+
+// Whether the file throws, and throws before the target is asked for.
+static bool rejects(const Arr<u8>& file)
+{
+  bool queried = false;
+  try {
+    DataReader reader;
+    reader.ReadImageInto(
+      {file.data(), file.size()}, {},
+      [&](const data::Image&) -> DataReader::ImageTarget {
+        queried = true;
+        return {};
+      });
+  } catch(const std::exception&) {
+    return !queried;
+  }
+  return false;
+}
+
+struct DdsHeader {
+  u32  headerSize = 124u;
+  u32  flags      = 0u;
+  u32  width      = 4u;
+  u32  height     = 4u;
+  u32  mipCount   = 0u;
+  u32  pixelFlags = 0x41u; // RGB and alpha.
+  Strv fourCode   = Strv("\0\0\0\0", 4);
+  u32  bitCount   = 32u;
+  u32  masks[4]   = {0xffu, 0xff00u, 0xff0000u, 0xff000000u};
+  u32  caps2      = 0u;
+
+  bool dx10       = false;
+  u32  dxgiFormat = 28u; // R8G8B8A8_UNORM
+  u32  dimension  = 3u;  // 2D
+  u32  miscFlags  = 0u;
+  u32  arraySize  = 1u;
+};
+
+static constexpr u32 DdsMipCount   = 0x20000u;
+static constexpr u32 DdsFourCC     = 0x4u;
+static constexpr u32 DdsCubemap    = 0xfe00u;
+static constexpr u32 DdsFirstFaces = 0x0600u;
+static constexpr u32 DdsVolume     = 0x200000u;
+static constexpr u32 DdsLuminance  = 0x20000u;
+static constexpr u32 DdsRgb        = 0x40u;
+
+static Arr<u8> makeDds(const DdsHeader& header, u64 dataSize)
+{
+  Arr<u8> ret;
+  appendChars(ret, "DDS ");
+  append(ret, header.headerSize);
+  append(ret, header.flags);
+  append(ret, header.height);
+  append(ret, header.width);
+  append(ret, u32{0u}); // Pitch
+  append(ret, u32{0u}); // Depth
+  append(ret, header.mipCount);
+  for(u32 idx = 0u; idx < 11u; ++idx) append(ret, u32{0u});
+
+  append(ret, u32{32u});
+  append(ret, header.pixelFlags);
+  appendChars(ret, header.fourCode);
+  append(ret, header.bitCount);
+  for(const u32 mask: header.masks) append(ret, mask);
+
+  append(ret, u32{0x1000u}); // Caps
+  append(ret, header.caps2);
+  for(u32 idx = 0u; idx < 3u; ++idx) append(ret, u32{0u});
+
+  if(header.dx10) {
+    append(ret, header.dxgiFormat);
+    append(ret, header.dimension);
+    append(ret, header.miscFlags);
+    append(ret, header.arraySize);
+    append(ret, u32{0u});
+  }
+
+  appendTexels(ret, dataSize);
+  return ret;
+}
+
+static DdsHeader makeDx10Header(u32 dxgiFormat)
+{
+  DdsHeader ret;
+  ret.pixelFlags = DdsFourCC;
+  ret.fourCode   = "DX10";
+  ret.dx10       = true;
+  ret.dxgiFormat = dxgiFormat;
+  return ret;
+}
+
+static void testDds()
+{
+  // Plain texels, copied as they are.
+  const auto rgba  = makeDds({}, 64u);
+  const auto image = read(rgba);
+  check(
+    image.format == Format::R8G8B8A8_UNORM && image.size[0] == 4u &&
+      image.size[1] == 4u &&
+      std::equal(
+        image.texels.begin(), image.texels.end(), rgba.end() - 64),
+    "DDS RGBA");
+
+  // 24-bit BGR is expanded to RGBA.
+  DdsHeader bgr;
+  bgr.pixelFlags = DdsRgb;
+  bgr.bitCount   = 24u;
+  bgr.masks[0]   = 0xff0000u;
+  bgr.masks[2]   = 0xffu;
+  bgr.masks[3]   = 0u;
+  const auto packed   = makeDds(bgr, 48u);
+  const auto expanded = read(packed);
+
+  bool swizzled = expanded.texels.size() == 64u;
+  for(u32 texel = 0u; swizzled && texel < 16u; ++texel) {
+    const u8* src = &packed[packed.size() - 48u + texel * 3u];
+    const u8* dst = &expanded.texels[texel * 4u];
+    swizzled = dst[0] == src[2] && dst[1] == src[1] &&
+               dst[2] == src[0] && dst[3] == 0xffu;
+  }
+  check(swizzled, "DDS 24-bit BGR");
+
+  // Blocks of every mip of every layer.
+  auto bc1      = makeDx10Header(71u);
+  bc1.width     = 8u;
+  bc1.height    = 8u;
+  bc1.flags     = DdsMipCount;
+  bc1.mipCount  = 4u;
+  bc1.arraySize = 2u;
+
+  const u64  bc1Size = (4u + 1u + 1u + 1u) * 8u * 2u;
+  const auto blocks  = read(makeDds(bc1, bc1Size));
+  check(
+    blocks.format == Format::BC1_RGBA_UNORM && blocks.mips == 4u &&
+      blocks.layers == 2u && blocks.texels.size() == bc1Size,
+    "DDS BC1 array with mips");
+
+  DdsHeader cube;
+  cube.pixelFlags = DdsLuminance;
+  cube.bitCount   = 8u;
+  cube.masks[0]   = 0xffu;
+  cube.caps2      = DdsCubemap;
+  const auto faces = read(makeDds(cube, 16u * 6u));
+  check(
+    faces.format == Format::R8_UNORM && faces.layers == 6u,
+    "DDS cubemap");
+
+  DdsHeader dxt5;
+  dxt5.pixelFlags = DdsFourCC;
+  dxt5.fourCode   = "DXT5";
+  check(
+    read(makeDds(dxt5, 16u)).format == Format::BC3_UNORM, "DDS DXT5");
+
+  // One field broken at a time.
+  DdsHeader header;
+  header.headerSize = 123u;
+  check(rejects(makeDds(header, 64u)), "DDS bad header size");
+
+  header       = {};
+  header.width = 0u;
+  check(rejects(makeDds(header, 64u)), "DDS zero width");
+
+  header          = {};
+  header.flags    = DdsMipCount;
+  header.mipCount = 4u;
+  check(rejects(makeDds(header, 1024u)), "DDS too many mips");
+
+  header      = makeDx10Header(28u);
+  header.dx10 = false;
+  check(rejects(makeDds(header, 0u)), "DDS missing DX10 header");
+
+  check(
+    rejects(makeDds(makeDx10Header(0u), 64u)),
+    "DDS unknown DXGI format");
+
+  header           = makeDx10Header(28u);
+  header.dimension = 4u;
+  check(rejects(makeDds(header, 64u)), "DDS DX10 volume");
+
+  header       = {};
+  header.caps2 = DdsVolume;
+  check(rejects(makeDds(header, 64u)), "DDS volume");
+
+  header       = {};
+  header.caps2 = DdsFirstFaces;
+  check(rejects(makeDds(header, 64u * 6u)), "DDS partial cubemap");
+
+  header            = {};
+  header.pixelFlags = DdsFourCC;
+  header.fourCode   = "ABCD";
+  check(
+    rejects(makeDds(header, 64u)), "DDS unknown four character code");
+
+  header          = {};
+  header.bitCount = 16u;
+  header.masks[0] = 0xf800u;
+  check(rejects(makeDds(header, 32u)), "DDS unknown channel masks");
+
+  // Sizes the file can't hold, some overflow when multiplied.
+  check(rejects(makeDds({}, 63u)), "DDS texels cut short");
+  check(rejects(makeDds(bgr, 47u)), "DDS 24-bit texels cut short");
+  check(rejects(makeDds(bc1, bc1Size - 8u)), "DDS last mip missing");
+
+  header        = {};
+  header.width  = 0x7fffffffu;
+  header.height = 0x7fffffffu;
+  check(rejects(makeDds(header, 64u)), "DDS huge size");
+
+  header           = makeDx10Header(71u);
+  header.arraySize = 0xffffffffu;
+  check(rejects(makeDds(header, 8u)), "DDS huge array");
+
+  header           = makeDx10Header(71u);
+  header.arraySize = 0x40000000u;
+  header.miscFlags = 0x4u; // Cubemap
+  check(rejects(makeDds(header, 8u)), "DDS huge cubemap array");
+}
+
+struct Ktx2Header {
+  u32 vkFormat    = 37u; // VK_FORMAT_R8G8B8A8_UNORM
+  u32 width       = 4u;
+  u32 height      = 4u;
+  u32 depth       = 0u;
+  u32 layers      = 0u;
+  u32 faces       = 1u;
+  u32 levels      = 1u;
+  u32 compression = 0u;
+};
+
+struct Ktx2Level {
+  u64 offset;
+  u64 size;
+  u64 uncompressedSize;
+};
+
+static constexpr u64 Ktx2DataOffset = 80u;
+
+// Levels of RGBA8 texels, largest first, with all their layers.
+static Arr<Ktx2Level> makeKtx2Index(const Ktx2Header& header)
+{
+  Arr<Ktx2Level> ret;
+
+  u64 offset = Ktx2DataOffset + header.levels * 24u;
+  for(u32 mip = 0u; mip < header.levels; ++mip) {
+    const u64 size = toU64(getMipExtent(header.width, mip)) *
+                     getMipExtent(header.height, mip) * 4u *
+                     std::max(header.layers, 1u) * header.faces;
+    ret.push_back({offset, size, size});
+    offset += size;
+  }
+  return ret;
+}
+
+static Arr<u8> makeKtx2(
+  const Ktx2Header& header, const Arr<Ktx2Level>& index, u64 dataSize)
+{
+  const u8 identifier[] = {
+    0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+
+  Arr<u8> ret(identifier, identifier + sizeof(identifier));
+  append(ret, header.vkFormat);
+  append(ret, u32{1u}); // Type size
+  append(ret, header.width);
+  append(ret, header.height);
+  append(ret, header.depth);
+  append(ret, header.layers);
+  append(ret, header.faces);
+  append(ret, header.levels);
+  append(ret, header.compression);
+
+  // No data format descriptor, key/value or supercompression data.
+  for(u32 idx = 0u; idx < 4u; ++idx) append(ret, u32{0u});
+  for(u32 idx = 0u; idx < 2u; ++idx) append(ret, u64{0u});
+
+  for(const auto& level: index) {
+    append(ret, level.offset);
+    append(ret, level.size);
+    append(ret, level.uncompressedSize);
+  }
+
+  appendTexels(ret, dataSize);
+  return ret;
+}
+
+static Arr<u8> makeKtx2(const Ktx2Header& header)
+{
+  const auto index = makeKtx2Index(header);
+
+  u64 dataSize = 0u;
+  for(const auto& level: index) dataSize += level.size;
+  return makeKtx2(header, index, dataSize);
+}
+
+static void testKtx2()
+{
+  // Levels hold all their layers, the image holds the whole chain of
+  // each layer in turn.
+  Ktx2Header array;
+  array.layers = 2u;
+  array.levels = 3u;
+
+  const auto file   = makeKtx2(array);
+  const auto index  = makeKtx2Index(array);
+  const auto layers = read(file);
+
+  bool moved = layers.mips == 3u && layers.layers == 2u &&
+               layers.texels.size() == file.size() - index[0].offset;
+  for(u32 layer = 0u; moved && layer < 2u; ++layer) {
+    for(u32 mip = 0u; mip < 3u; ++mip) {
+      const u64 size = getMipSize(layers, mip);
+      const u8* dst =
+        layers.texels.data() + getMipOffset(layers, mip, layer);
+      const u8* src = file.data() + index[mip].offset + layer * size;
+      moved &= memcmp(dst, src, size) == 0;
+    }
+  }
+  check(moved, "KTX2 array with mips");
+
+  Ktx2Header cube;
+  cube.faces = 6u;
+  check(read(makeKtx2(cube)).layers == 6u, "KTX2 cubemap");
+
+  // One field broken at a time.
+  auto bad = makeKtx2({});
+  bad[1]   = 'k';
+  check(rejects(bad), "KTX2 bad identifier");
+
+  Ktx2Header header;
+  header.compression = 1u; // BasisLZ
+  check(rejects(makeKtx2(header)), "KTX2 BasisLZ");
+
+  header          = {};
+  header.vkFormat = 0u;
+  check(rejects(makeKtx2(header)), "KTX2 Basis Universal");
+
+  header          = {};
+  header.vkFormat = 1000u;
+  check(rejects(makeKtx2(header)), "KTX2 unknown format");
+
+  header       = {};
+  header.width = 0u;
+  check(rejects(makeKtx2(header, {}, 0u)), "KTX2 zero width");
+
+  header       = {};
+  header.depth = 2u;
+  check(rejects(makeKtx2(header)), "KTX2 volume");
+
+  header       = {};
+  header.faces = 3u;
+  check(rejects(makeKtx2(header)), "KTX2 three faces");
+
+  header        = {};
+  header.levels = 4u;
+  check(rejects(makeKtx2(header)), "KTX2 too many levels");
+
+  // The level index and the levels must be in the file.
+  header        = {};
+  header.levels = 3u;
+  auto levels   = makeKtx2Index(header);
+  levels.resize(1u);
+  check(rejects(makeKtx2(header, levels, 0u)), "KTX2 index cut short");
+
+  levels = makeKtx2Index({});
+  check(rejects(makeKtx2({}, levels, 63u)), "KTX2 texels cut short");
+
+  levels[0].offset = 1u << 20;
+  check(rejects(makeKtx2({}, levels, 64u)), "KTX2 offset past the end");
+
+  levels[0].offset = ~u64{0u};
+  check(rejects(makeKtx2({}, levels, 64u)), "KTX2 huge offset");
+
+  levels         = makeKtx2Index({});
+  levels[0].size = 60u;
+  check(rejects(makeKtx2({}, levels, 64u)), "KTX2 bad level size");
+
+  header             = {};
+  header.compression = 2u; // Zstandard
+  levels             = makeKtx2Index(header);
+  levels[0].size     = 16u;
+  levels[0].uncompressedSize = 60u;
+  check(
+    rejects(makeKtx2(header, levels, 16u)),
+    "KTX2 bad uncompressed size");
+}
+
+static void testPng()
+{
+  const u8 texels[16] = {};
+
+  DataWriter writer;
+  const auto png = writer.WriteImage(
+    {Format::R8G8B8A8_UNORM, {2u, 2u}, {texels, sizeof(texels)}}, {});
+  check(read(png).size[0] == 2u, "PNG");
+
+  // The size is right after the signature and the chunk header.
+  auto header = png;
+  header[19]  = 0u;
+  check(rejects(header), "PNG zero width");
+
+  header     = png;
+  header[23] = 0u;
+  check(rejects(header), "PNG zero height");
+}
+
+int main()
+{
+  testDds();
+  testKtx2();
+  testPng();
+
+  std::printf("%u/%u checks pass\n", s_checks - s_failures, s_checks);
+  return s_failures == 0u ? 0 : 1;
+}
@@ -0,0 +1,634 @@
+#include "vuldir/DataReader.hpp"
+
+#include <cstdio>
+
+using namespace vd;
+
+// Decodes JPEG files saved by Pillow 12.3.0 with libjpeg-turbo, and
+// compares the texels with the CRC-32 of what libjpeg-turbo decodes
+// from them with its defaults, the RGB or gray bytes. The decoder
+// claims the same results, so they must match exactly, with restart
+// intervals decoded on one thread or many. The images are gradients
+// with noise and hard edges.
+
+static u32 s_failures = 0u;
+static u32 s_checks   = 0u;
+
+static void check(bool condition, const char* what)
+{
+  ++s_checks;
+  if(!condition) {
+    ++s_failures;
+    std::printf("%s: failed\n", what);
+  }
+}
+
+// 23x13 RGB, quality 90, 4:4:4.
+static const u8 Baseline444[] = {
+  0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00,
+  0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb,
+  0x00, 0x43, 0x00, 0x03, 0x02, 0x02, 0x03, 0x02, 0x02, 0x03, 0x03,
+  0x03, 0x03, 0x04, 0x03, 0x03, 0x04, 0x05, 0x08, 0x05, 0x05, 0x04,
+  0x04, 0x05, 0x0a, 0x07, 0x07, 0x06, 0x08, 0x0c, 0x0a, 0x0c, 0x0c,
+  0x0b, 0x0a, 0x0b, 0x0b, 0x0d, 0x0e, 0x12, 0x10, 0x0d, 0x0e, 0x11,
+  0x0e, 0x0b, 0x0b, 0x10, 0x16, 0x10, 0x11, 0x13, 0x14, 0x15, 0x15,
+  0x15, 0x0c, 0x0f, 0x17, 0x18, 0x16, 0x14, 0x18, 0x12, 0x14, 0x15,
+  0x14, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x03, 0x04, 0x04, 0x05, 0x04,
+  0x05, 0x09, 0x05, 0x05, 0x09, 0x14, 0x0d, 0x0b, 0x0d, 0x14, 0x14,
+  0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+  0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+  0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+  0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+  0x14, 0x14, 0x14, 0x14, 0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x0d,
+  0x00, 0x17, 0x03, 0x01, 0x11, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+  0x01, 0xff, 0xc4, 0x00, 0x1f, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+  0x0b, 0xff, 0xc4, 0x00, 0xb5, 0x10, 0x00, 0x02, 0x01, 0x03, 0x03,
+  0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7d,
+  0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41,
+  0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91,
+  0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24,
+  0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a,
+  0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38,
+  0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53,
+  0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66,
+  0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+  0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93,
+  0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+  0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7,
+  0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9,
+  0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1,
+  0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2,
+  0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xff, 0xc4, 0x00,
+  0x1f, 0x01, 0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03,
+  0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xc4, 0x00,
+  0xb5, 0x11, 0x00, 0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07,
+  0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77, 0x00, 0x01, 0x02, 0x03,
+  0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61,
+  0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1,
+  0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a,
+  0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+  0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43,
+  0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56,
+  0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+  0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83,
+  0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95,
+  0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+  0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9,
+  0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2,
+  0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4,
+  0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6,
+  0xf7, 0xf8, 0xf9, 0xfa, 0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00,
+  0x02, 0x11, 0x03, 0x11, 0x00, 0x3f, 0x00, 0xf9, 0xdf, 0x40, 0xf8,
+  0x00, 0x3c, 0x30, 0x56, 0xeb, 0xca, 0xfb, 0x40, 0x6c, 0x47, 0xb7,
+  0x6e, 0xdf, 0x7c, 0xe7, 0x9f, 0x4a, 0xfd, 0xab, 0x13, 0x88, 0xff,
+  0x00, 0x88, 0x5d, 0xff, 0x00, 0x0b, 0x3e, 0xd7, 0xeb, 0x3e, 0xd3,
+  0xf7, 0x5c, 0xb6, 0xf6, 0x76, 0xe6, 0xf7, 0xf9, 0xaf, 0x79, 0xde,
+  0xdc, 0x96, 0xb5, 0xba, 0xde, 0xfa, 0x59, 0xfc, 0xbe, 0x4b, 0xc5,
+  0x7f, 0x5b, 0xb4, 0x2f, 0xca, 0x95, 0x9d, 0xef, 0x7d, 0xb4, 0xf2,
+  0xef, 0xe9, 0xd2, 0xc7, 0xa6, 0x68, 0x3f, 0x01, 0x3f, 0xb4, 0x15,
+  0x75, 0x53, 0x18, 0x4c, 0x1f, 0x37, 0xc9, 0x2a, 0x48, 0xf9, 0x3b,
+  0x6e, 0xff, 0x00, 0x80, 0xfa, 0x71, 0x5f, 0x29, 0x89, 0xaf, 0xfd,
+  0xb8, 0xff, 0x00, 0xd7, 0xef, 0x6b, 0xc9, 0xcb, 0xfb, 0xdf, 0x65,
+  0x6b, 0xff, 0x00, 0x03, 0x4e, 0x5f, 0x69, 0x75, 0xf1, 0x7b, 0x3d,
+  0xf9, 0x34, 0xbe, 0xce, 0xda, 0xfe, 0xff, 0x00, 0x93, 0x71, 0x6f,
+  0x22, 0x58, 0x27, 0x2f, 0x2b, 0xfa, 0xf9, 0x79, 0x5f, 0xbf, 0xfc,
+  0x06, 0x7c, 0x61, 0xf8, 0x15, 0x27, 0x8b, 0xbc, 0x0f, 0x6c, 0xc9,
+  0x6a, 0x6d, 0xd2, 0xd2, 0xf1, 0x1d, 0xc8, 0x42, 0xea, 0x15, 0x91,
+  0xd7, 0x24, 0xe0, 0x60, 0x67, 0x03, 0x27, 0xb9, 0x1f, 0x8d, 0x64,
+  0x9c, 0x42, 0xbc, 0x57, 0xc6, 0xc9, 0x39, 0x7d, 0x57, 0xea, 0xd1,
+  0x7f, 0xf4, 0xf3, 0x9f, 0xda, 0x34, 0xff, 0x00, 0xe9, 0xdd, 0xb9,
+  0x7d, 0x9d, 0xfa, 0xde, 0xfd, 0x2d, 0xae, 0x5e, 0x29, 0x71, 0x35,
+  0x4c, 0x2f, 0x0d, 0x52, 0x95, 0x37, 0xcc, 0x95, 0x58, 0xb7, 0xbd,
+  0xa2, 0x94, 0x67, 0x1b, 0xbb, 0x27, 0x65, 0x79, 0x25, 0x77, 0x6d,
+  0x5a, 0x5d, 0x4f, 0xa9, 0xb4, 0x0f, 0x85, 0xfa, 0x67, 0x87, 0x76,
+  0xdc, 0x93, 0xf6, 0x92, 0xc3, 0x66, 0xdd, 0x81, 0x7d, 0xfa, 0xf3,
+  0xe9, 0xfa, 0xd7, 0xe4, 0x38, 0x9a, 0x55, 0xbc, 0x2c, 0xff, 0x00,
+  0x85, 0x9f, 0x69, 0xf5, 0x9f, 0x69, 0xfb, 0xae, 0x5b, 0x7b, 0x3b,
+  0x73, 0x7b, 0xfc, 0xd7, 0xbc, 0xef, 0x6e, 0x4b, 0x5a, 0xca, 0xf7,
+  0xbd, 0xf4, 0xd7, 0xfc, 0xd4, 0xc9, 0x73, 0xca, 0xf9, 0x85, 0xa9,
+  0x35, 0x6b, 0x6b, 0x7d, 0xf6, 0xd2, 0xdb, 0x79, 0x9e, 0x93, 0xa0,
+  0xfc, 0x2f, 0xd2, 0xef, 0x23, 0x4d, 0x63, 0xee, 0x6c, 0x02, 0x5f,
+  0x27, 0x68, 0x39, 0xdb, 0xdb, 0x3f, 0x87, 0xa7, 0x7a, 0xf9, 0x6c,
+  0x45, 0x2a, 0xf9, 0xeb, 0x7c, 0x7b, 0xed, 0x39, 0x39, 0x7f, 0x7b,
+  0xec, 0xad, 0x7f, 0xe0, 0x69, 0xcb, 0xed, 0x2e, 0xbe, 0x2f, 0x67,
+  0xbf, 0x27, 0xbb, 0x7d, 0x9d, 0xb5, 0xfd, 0xef, 0x26, 0xcf, 0x2b,
+  0x51, 0x84, 0x70, 0xb6, 0xbe, 0xca, 0xf7, 0xef, 0xe5, 0x6e, 0x97,
+  0xf9, 0x92, 0x7c, 0x5c, 0xf8, 0x79, 0xa5, 0x78, 0x9b, 0xc1, 0x90,
+  0xef, 0x57, 0x81, 0xed, 0xef, 0x23, 0x08, 0xcb, 0x82, 0x32, 0xc8,
+  0xfc, 0x91, 0x8e, 0x98, 0x52, 0x31, 0xc7, 0x50, 0x7b, 0x60, 0xce,
+  0x4b, 0x99, 0xd7, 0xf1, 0x67, 0x16, 0xed, 0xfe, 0xca, 0xb0, 0xd1,
+  0x7f, 0xf4, 0xf3, 0x9b, 0xda, 0x35, 0xff, 0x00, 0x5e, 0xf9, 0x6d,
+  0xc9, 0xfd, 0xeb, 0xdf, 0xa1, 0xb7, 0x89, 0xb9, 0xd5, 0x5c, 0xbf,
+  0x87, 0x69, 0xf3, 0xa7, 0x29, 0x3a, 0xb1, 0x49, 0xa7, 0x6b, 0x3e,
+  0x59, 0xea, 0xd5, 0x9d, 0xd5, 0xae, 0xac, 0x9c, 0x75, 0x69, 0xde,
+  0xca, 0xcf, 0xff, 0xd9
+};
+
+// 33x17 RGB, quality 75, 4:2:0.
+static const u8 Baseline420[] = {
+  0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00,
+  0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb,
+  0x00, 0x43, 0x00, 0x08, 0x06, 0x06, 0x07, 0x06, 0x05, 0x08, 0x07,
+  0x07, 0x07, 0x09, 0x09, 0x08, 0x0a, 0x0c, 0x14, 0x0d, 0x0c, 0x0b,
+  0x0b, 0x0c, 0x19, 0x12, 0x13, 0x0f, 0x14, 0x1d, 0x1a, 0x1f, 0x1e,
+  0x1d, 0x1a, 0x1c, 0x1c, 0x20, 0x24, 0x2e, 0x27, 0x20, 0x22, 0x2c,
+  0x23, 0x1c, 0x1c, 0x28, 0x37, 0x29, 0x2c, 0x30, 0x31, 0x34, 0x34,
+  0x34, 0x1f, 0x27, 0x39, 0x3d, 0x38, 0x32, 0x3c, 0x2e, 0x33, 0x34,
+  0x32, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x09, 0x09, 0x09, 0x0c, 0x0b,
+  0x0c, 0x18, 0x0d, 0x0d, 0x18, 0x32, 0x21, 0x1c, 0x21, 0x32, 0x32,
+  0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+  0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+  0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+  0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+  0x32, 0x32, 0x32, 0x32, 0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x11,
+  0x00, 0x21, 0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+  0x01, 0xff, 0xc4, 0x00, 0x1f, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+  0x0b, 0xff, 0xc4, 0x00, 0xb5, 0x10, 0x00, 0x02, 0x01, 0x03, 0x03,
+  0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7d,
+  0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41,
+  0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91,
+  0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24,
+  0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a,
+  0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38,
+  0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53,
+  0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66,
+  0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+  0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93,
+  0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+  0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7,
+  0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9,
+  0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1,
+  0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2,
+  0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xff, 0xc4, 0x00,
+  0x1f, 0x01, 0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03,
+  0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xc4, 0x00,
+  0xb5, 0x11, 0x00, 0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07,
+  0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77, 0x00, 0x01, 0x02, 0x03,
+  0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61,
+  0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1,
+  0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a,
+  0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+  0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43,
+  0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56,
+  0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+  0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83,
+  0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95,
+  0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+  0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9,
+  0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2,
+  0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4,
+  0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6,
+  0xf7, 0xf8, 0xf9, 0xfa, 0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00,
+  0x02, 0x11, 0x03, 0x11, 0x00, 0x3f, 0x00, 0xf3, 0xd8, 0x3c, 0x3f,
+  0xf6, 0x3c, 0x4a, 0x01, 0x6c, 0xfc, 0xb8, 0x03, 0x1e, 0xf5, 0xa7,
+  0x6f, 0xe1, 0xff, 0x00, 0x33, 0x17, 0x58, 0xc0, 0xfb, 0xdb, 0x7e,
+  0x9e, 0xff, 0x00, 0x85, 0x77, 0x10, 0xf8, 0x7f, 0xec, 0x44, 0x49,
+  0xb7, 0x7e, 0x7e, 0x5c, 0x63, 0x15, 0xa7, 0x07, 0x87, 0xc4, 0x9f,
+  0xe9, 0x58, 0xc6, 0x3e, 0x6d, 0xb8, 0xcf, 0x4f, 0xff, 0x00, 0x55,
+  0x7a, 0x75, 0xb3, 0x1b, 0x7e, 0xe3, 0x92, 0xdc, 0xbe, 0xf7, 0xb3,
+  0xbf, 0xc3, 0xfd, 0xfe, 0x6e, 0xbf, 0xe1, 0xf3, 0x3c, 0x9c, 0xbb,
+  0x3c, 0xd9, 0xf3, 0x7c, 0xff, 0x00, 0x43, 0x87, 0x83, 0x43, 0xfb,
+  0x70, 0x1f, 0x26, 0xc0, 0x9c, 0xfa, 0xe7, 0x3f, 0xfe, 0xaa, 0x97,
+  0x50, 0xd1, 0x96, 0x6d, 0x35, 0xec, 0x8b, 0xfd, 0x9d, 0x8b, 0x2a,
+  0xac, 0xdc, 0x90, 0xac, 0xa4, 0x10, 0x4e, 0x3a, 0x0c, 0x8e, 0xbd,
+  0xb3, 0x5e, 0x8f, 0x06, 0x86, 0x2f, 0x71, 0xf2, 0x6c, 0xd9, 0xed,
+  0x9c, 0xe7, 0xff, 0x00, 0xd5, 0x4f, 0xd4, 0x74, 0x89, 0xbe, 0xc3,
+  0xe5, 0x40, 0x44, 0x3e, 0x53, 0x02, 0xef, 0xbb, 0x05, 0x95, 0x79,
+  0xc0, 0xe0, 0xf2, 0x48, 0x15, 0xc1, 0xfd, 0xaf, 0xcd, 0x35, 0x53,
+  0x9e, 0xfe, 0xd3, 0x4e, 0x6d, 0xbd, 0xaf, 0x4e, 0x4b, 0x7d, 0x8f,
+  0xe5, 0xe6, 0xf9, 0x9f, 0x5c, 0xb3, 0xc4, 0xb0, 0xb3, 0xbe, 0xc9,
+  0x3d, 0x3b, 0x79, 0xee, 0xaf, 0xf7, 0x9e, 0x07, 0xff, 0x00, 0x08,
+  0xa0, 0xfe, 0xf7, 0xfe, 0x39, 0x45, 0x7a, 0x9f, 0xfc, 0x23, 0xb1,
+  0x7f, 0xcf, 0x9c, 0x1f, 0xf7, 0xcc, 0x9f, 0xfc, 0x5d, 0x15, 0xea,
+  0xfb, 0x57, 0xff, 0x00, 0x40, 0x3f, 0xf9, 0x55, 0x7f, 0x99, 0xf9,
+  0xff, 0x00, 0xf6, 0xcc, 0x3f, 0xe7, 0xfa, 0xfb, 0x9f, 0xf9, 0x1d,
+  0x36, 0x95, 0xff, 0x00, 0x1f, 0x03, 0xfd, 0xd3, 0xfc, 0xeb, 0x51,
+  0x7f, 0xe4, 0x22, 0xbf, 0xef, 0x0f, 0xe4, 0x28, 0xa2, 0xbe, 0x16,
+  0x5f, 0xf2, 0x2b, 0xa3, 0xff, 0x00, 0x5f, 0x3f, 0xcc, 0xf0, 0x72,
+  0xff, 0x00, 0x8f, 0xfa, 0xf2, 0x35, 0xae, 0x7a, 0xc5, 0xf5, 0xad,
+  0x4f, 0xf9, 0x87, 0xc7, 0xfe, 0xe2, 0xff, 0x00, 0x4a, 0x28, 0xa5,
+  0x8a, 0xff, 0x00, 0x7b, 0xc6, 0xff, 0x00, 0x83, 0xff, 0x00, 0x6d,
+  0x3e, 0xd7, 0x01, 0xf0, 0xc7, 0xfa, 0xea, 0x79, 0x65, 0x14, 0x51,
+  0x5e, 0x39, 0xf9, 0x79, 0xff, 0xd9
+};
+
+// 29x18 RGB, quality 80, 4:2:2, restart every 3 MCUs.
+static const u8 Baseline422Restart[] = {
+  0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00,
+  0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb,
+  0x00, 0x43, 0x00, 0x06, 0x04, 0x05, 0x06, 0x05, 0x04, 0x06, 0x06,
+  0x05, 0x06, 0x07, 0x07, 0x06, 0x08, 0x0a, 0x10, 0x0a, 0x0a, 0x09,
+  0x09, 0x0a, 0x14, 0x0e, 0x0f, 0x0c, 0x10, 0x17, 0x14, 0x18, 0x18,
+  0x17, 0x14, 0x16, 0x16, 0x1a, 0x1d, 0x25, 0x1f, 0x1a, 0x1b, 0x23,
+  0x1c, 0x16, 0x16, 0x20, 0x2c, 0x20, 0x23, 0x26, 0x27, 0x29, 0x2a,
+  0x29, 0x19, 0x1f, 0x2d, 0x30, 0x2d, 0x28, 0x30, 0x25, 0x28, 0x29,
+  0x28, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x07, 0x07, 0x07, 0x0a, 0x08,
+  0x0a, 0x13, 0x0a, 0x0a, 0x13, 0x28, 0x1a, 0x16, 0x1a, 0x28, 0x28,
+  0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+  0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+  0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+  0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+  0x28, 0x28, 0x28, 0x28, 0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x12,
+  0x00, 0x1d, 0x03, 0x01, 0x21, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+  0x01, 0xff, 0xc4, 0x00, 0x1f, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+  0x0b, 0xff, 0xc4, 0x00, 0xb5, 0x10, 0x00, 0x02, 0x01, 0x03, 0x03,
+  0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7d,
+  0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41,
+  0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91,
+  0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24,
+  0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a,
+  0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38,
+  0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53,
+  0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66,
+  0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+  0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93,
+  0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+  0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7,
+  0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9,
+  0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1,
+  0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2,
+  0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xff, 0xc4, 0x00,
+  0x1f, 0x01, 0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03,
+  0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xc4, 0x00,
+  0xb5, 0x11, 0x00, 0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07,
+  0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77, 0x00, 0x01, 0x02, 0x03,
+  0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61,
+  0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1,
+  0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a,
+  0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+  0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43,
+  0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56,
+  0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+  0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83,
+  0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95,
+  0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+  0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9,
+  0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2,
+  0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4,
+  0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6,
+  0xf7, 0xf8, 0xf9, 0xfa, 0xff, 0xdd, 0x00, 0x04, 0x00, 0x03, 0xff,
+  0xda, 0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00,
+  0x3f, 0x00, 0xf2, 0x7b, 0x3f, 0x0d, 0xfd, 0x83, 0xf7, 0xb8, 0xf3,
+  0x33, 0xf2, 0xe3, 0x18, 0xf7, 0xcf, 0xe9, 0x5b, 0xb6, 0x7e, 0x19,
+  0xf3, 0x71, 0x76, 0x14, 0xae, 0x3e, 0x6d, 0xb8, 0xf4, 0xf7, 0xfc,
+  0x2b, 0xec, 0x31, 0x0b, 0xd9, 0xff, 0x00, 0xc2, 0x4f, 0x37, 0xf0,
+  0xbf, 0x7b, 0xcd, 0xde, 0xdf, 0x66, 0xd7, 0xd3, 0x7d, 0xee, 0xfd,
+  0x0e, 0x9c, 0x9f, 0x32, 0xbd, 0xa7, 0xdf, 0x43, 0x7a, 0xcf, 0xc3,
+  0xff, 0x00, 0xda, 0x1b, 0x7e, 0x4f, 0x2c, 0xc7, 0xe8, 0x33, 0xd7,
+  0xff, 0x00, 0xd5, 0x5c, 0xbf, 0x8d, 0x2c, 0x42, 0x6a, 0x8b, 0x06,
+  0xd4, 0x90, 0xc0, 0x82, 0x32, 0x15, 0x48, 0x65, 0xef, 0xc9, 0xc7,
+  0x39, 0xce, 0x46, 0x0f, 0x1c, 0xfd, 0x4f, 0x1e, 0x0f, 0x88, 0x7e,
+  0xab, 0x5f, 0xfb, 0x67, 0x92, 0xfe, 0xd9, 0x5b, 0x96, 0xf6, 0xe5,
+  0xe5, 0xd2, 0xf7, 0xb6, 0xb7, 0xb7, 0x65, 0x6b, 0xf9, 0x1f, 0x47,
+  0xc4, 0x59, 0x85, 0xb2, 0xaf, 0x65, 0xcc, 0x97, 0xbc, 0xba, 0x5e,
+  0xfd, 0x6c, 0xbb, 0x3e, 0xb7, 0xec, 0x9a, 0xea, 0x7a, 0x55, 0x9f,
+  0x86, 0xfe, 0xc1, 0x89, 0x47, 0xef, 0x37, 0x7c, 0xb8, 0x23, 0x1e,
+  0xff, 0x00, 0xd2, 0xb7, 0xac, 0xbc, 0x35, 0xe7, 0x11, 0x79, 0xb7,
+  0x1f, 0xc5, 0xb3, 0x1f, 0xdd, 0xed, 0x9f, 0xc2, 0xbe, 0x7b, 0x10,
+  0xbd, 0x9f, 0xfc, 0x24, 0xf3, 0x7f, 0x0b, 0xf7, 0xbc, 0xdd, 0xed,
+  0xf6, 0x6d, 0xd3, 0x7d, 0xee, 0xfd, 0x0f, 0xc8, 0xb2, 0x7c, 0xce,
+  0xf6, 0x9d, 0xf7, 0xd0, 0xff, 0xd0, 0xf4, 0x0b, 0x3f, 0x0f, 0x0d,
+  0x43, 0xf8, 0x3c, 0xbd, 0x83, 0xeb, 0x9c, 0xff, 0x00, 0xfa, 0xab,
+  0x95, 0xf1, 0x8e, 0x9c, 0x91, 0x6a, 0x26, 0x15, 0x89, 0x5b, 0xcb,
+  0x6d, 0xa4, 0x6e, 0x21, 0xb2, 0x11, 0x39, 0x23, 0x91, 0x82, 0x31,
+  0xc8, 0x03, 0xa1, 0x1c, 0xe3, 0x35, 0xcf, 0x83, 0xe2, 0x27, 0x84,
+  0xaf, 0xfd, 0xb1, 0xcb, 0x7f, 0x6e, 0xad, 0xcb, 0x7f, 0x87, 0x97,
+  0x4b, 0xde, 0xce, 0xf7, 0xb7, 0x65, 0xeb, 0xdf, 0xcf, 0xe2, 0x4c,
+  0x74, 0x5e, 0x55, 0xec, 0xdb, 0xb5, 0xa4, 0xbe, 0x7b, 0xf9, 0xfe,
+  0x77, 0xd3, 0xa5, 0xec, 0xd7, 0x53, 0xe1, 0xd5, 0x53, 0x3e, 0x08,
+  0x18, 0xda, 0x3b, 0x7b, 0x8a, 0xde, 0xb6, 0x55, 0xfe, 0xd2, 0x1c,
+  0x0f, 0xbc, 0xbd, 0xbd, 0x85, 0x7c, 0xe5, 0x46, 0xff, 0x00, 0xb1,
+  0xe8, 0x7f, 0xd7, 0xd5, 0xfa, 0x9f, 0x9c, 0x64, 0xf2, 0x7e, 0xd7,
+  0x7e, 0x87, 0x45, 0x7a, 0x8a, 0x1e, 0x1c, 0x28, 0xe8, 0x7b, 0x7d,
+  0x2b, 0x13, 0xc5, 0x28, 0xa5, 0xa3, 0x25, 0x41, 0x22, 0x42, 0x80,
+  0x91, 0xd1, 0x44, 0x71, 0x1c, 0x7d, 0x32, 0x49, 0xfc, 0x4d, 0x7b,
+  0x79, 0x2b, 0x7f, 0xeb, 0x16, 0x27, 0xfc, 0x31, 0xfc, 0x91, 0xef,
+  0xf1, 0x23, 0x7f, 0xd8, 0xdf, 0xf6, 0xf2, 0x3f, 0xff, 0xd9
+};
+
+// 31x21 RGB, quality 85, 4:2:0, progressive.
+static const u8 Progressive420[] = {
+  0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00,
+  0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb,
+  0x00, 0x43, 0x00, 0x05, 0x03, 0x04, 0x04, 0x04, 0x03, 0x05, 0x04,
+  0x04, 0x04, 0x05, 0x05, 0x05, 0x06, 0x07, 0x0c, 0x08, 0x07, 0x07,
+  0x07, 0x07, 0x0f, 0x0b, 0x0b, 0x09, 0x0c, 0x11, 0x0f, 0x12, 0x12,
+  0x11, 0x0f, 0x11, 0x11, 0x13, 0x16, 0x1c, 0x17, 0x13, 0x14, 0x1a,
+  0x15, 0x11, 0x11, 0x18, 0x21, 0x18, 0x1a, 0x1d, 0x1d, 0x1f, 0x1f,
+  0x1f, 0x13, 0x17, 0x22, 0x24, 0x22, 0x1e, 0x24, 0x1c, 0x1e, 0x1f,
+  0x1e, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x05, 0x05, 0x05, 0x07, 0x06,
+  0x07, 0x0e, 0x08, 0x08, 0x0e, 0x1e, 0x14, 0x11, 0x14, 0x1e, 0x1e,
+  0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+  0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+  0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+  0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+  0x1e, 0x1e, 0x1e, 0x1e, 0xff, 0xc2, 0x00, 0x11, 0x08, 0x00, 0x15,
+  0x00, 0x1f, 0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+  0x01, 0xff, 0xc4, 0x00, 0x18, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x05, 0x00, 0x04, 0x06, 0x03, 0xff, 0xc4, 0x00, 0x17, 0x01, 0x00,
+  0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x04, 0x05, 0x06, 0x07, 0xff, 0xda, 0x00,
+  0x0c, 0x03, 0x01, 0x00, 0x02, 0x10, 0x03, 0x10, 0x00, 0x00, 0x01,
+  0xe1, 0x51, 0x7d, 0x06, 0xe2, 0x81, 0xe1, 0xdb, 0xe6, 0x0e, 0x89,
+  0x44, 0x29, 0x46, 0x52, 0x86, 0x5a, 0x59, 0x47, 0xff, 0xc4, 0x00,
+  0x1b, 0x10, 0x00, 0x02, 0x02, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x00, 0x04,
+  0x01, 0x05, 0x13, 0x11, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00,
+  0x01, 0x05, 0x02, 0x0a, 0xdc, 0xe0, 0x55, 0xf6, 0x2e, 0xbf, 0x59,
+  0x7a, 0xae, 0x09, 0x4b, 0xad, 0xca, 0x05, 0x5f, 0x60, 0x57, 0xeb,
+  0x36, 0x08, 0xc1, 0x2c, 0x13, 0x85, 0x45, 0xa4, 0x73, 0x16, 0xa1,
+  0x6c, 0xd9, 0x24, 0x49, 0x7f, 0xff, 0xc4, 0x00, 0x1f, 0x11, 0x00,
+  0x01, 0x03, 0x04, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x04, 0x11, 0x02, 0x03, 0x05,
+  0x41, 0x14, 0x51, 0x61, 0x91, 0xff, 0xda, 0x00, 0x08, 0x01, 0x03,
+  0x01, 0x01, 0x3f, 0x01, 0x61, 0x94, 0xdc, 0xa7, 0x59, 0x31, 0xc2,
+  0xae, 0x7a, 0xf9, 0xea, 0x61, 0x72, 0xa8, 0x06, 0x53, 0xc3, 0x2c,
+  0x6e, 0x03, 0xa0, 0xbf, 0xff, 0xc4, 0x00, 0x29, 0x11, 0x00, 0x00,
+  0x04, 0x03, 0x05, 0x09, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x11, 0x00, 0x12, 0x51, 0x04,
+  0x21, 0x31, 0x32, 0x61, 0x05, 0x13, 0x22, 0x23, 0x41, 0x42, 0x53,
+  0x62, 0x81, 0x72, 0xff, 0xda, 0x00, 0x08, 0x01, 0x02, 0x01, 0x01,
+  0x3f, 0x01, 0x56, 0xd6, 0xdc, 0xa9, 0x70, 0xbe, 0x47, 0xc3, 0xde,
+  0x6e, 0xbf, 0x98, 0x26, 0xd1, 0x75, 0x00, 0xf3, 0x67, 0xb9, 0xfc,
+  0x9e, 0xad, 0xd9, 0x47, 0xfb, 0x0b, 0x26, 0x50, 0xb4, 0x1a, 0xcc,
+  0x19, 0x0a, 0x59, 0x80, 0x35, 0xad, 0x61, 0x15, 0xd4, 0x36, 0xe1,
+  0x51, 0x1e, 0x25, 0x46, 0x53, 0x6a, 0x0e, 0xdf, 0x2e, 0xa4, 0x7f,
+  0xff, 0xc4, 0x00, 0x1e, 0x10, 0x00, 0x01, 0x04, 0x02, 0x03, 0x01,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x01, 0x11, 0x21, 0x31, 0x02, 0x13, 0x12, 0x51, 0xa1, 0x41, 0xff,
+  0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x06, 0x3f, 0x02, 0x7b, 0x36,
+  0x78, 0x53, 0x30, 0xb2, 0xa8, 0xb1, 0x8d, 0xd8, 0xf6, 0x6c, 0x3a,
+  0x63, 0x5b, 0x2c, 0x7d, 0x68, 0x1e, 0xcd, 0x9e, 0x1d, 0x31, 0x8a,
+  0x4c, 0x2f, 0x13, 0xff, 0xc4, 0x00, 0x1f, 0x10, 0x00, 0x00, 0x06,
+  0x02, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x01, 0x11, 0x21, 0x41, 0x51, 0x31, 0x61, 0x71,
+  0x81, 0xf1, 0xa1, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01,
+  0x3f, 0x21, 0x8f, 0x7b, 0x20, 0x8a, 0x49, 0xe8, 0x3d, 0x40, 0x12,
+  0x6c, 0x88, 0x13, 0x10, 0x6b, 0x89, 0x91, 0x0b, 0x5a, 0x11, 0x49,
+  0x29, 0xc0, 0xac, 0x25, 0x51, 0x72, 0xb6, 0x11, 0xad, 0xee, 0xb4,
+  0x5d, 0x9f, 0x3e, 0xb8, 0x41, 0xc2, 0x5d, 0x94, 0x3d, 0x08, 0x19,
+  0x33, 0xc0, 0x55, 0xaf, 0xc1, 0xff, 0xda, 0x00, 0x0c, 0x03, 0x01,
+  0x00, 0x02, 0x00, 0x03, 0x00, 0x00, 0x00, 0x10, 0xb0, 0x78, 0xe0,
+  0xff, 0xc4, 0x00, 0x1e, 0x11, 0x00, 0x02, 0x02, 0x02, 0x02, 0x03,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+  0x11, 0x00, 0x21, 0x31, 0x41, 0x71, 0x81, 0x91, 0xa1, 0xc1, 0xff,
+  0xda, 0x00, 0x08, 0x01, 0x03, 0x01, 0x01, 0x3f, 0x10, 0xc1, 0xe4,
+  0xf8, 0xa2, 0x38, 0x02, 0x88, 0x80, 0xd6, 0x1b, 0x6c, 0x80, 0xca,
+  0xb7, 0x89, 0xb7, 0x4d, 0x75, 0x08, 0x79, 0x4c, 0x1c, 0x84, 0x47,
+  0xbb, 0xb9, 0xff, 0xc4, 0x00, 0x1e, 0x11, 0x00, 0x02, 0x01, 0x05,
+  0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01, 0x11, 0x31, 0x00, 0x21, 0x41, 0x51, 0x61, 0x81, 0xd1,
+  0xe1, 0xff, 0xda, 0x00, 0x08, 0x01, 0x02, 0x01, 0x01, 0x3f, 0x10,
+  0xd2, 0xfb, 0x9e, 0xa1, 0xe5, 0x98, 0xb5, 0x1c, 0x63, 0xb4, 0x2b,
+  0x4f, 0x83, 0x8b, 0xa8, 0x4f, 0x66, 0x43, 0x61, 0x52, 0x94, 0x9b,
+  0x12, 0x47, 0x28, 0xc4, 0xa1, 0x7c, 0x2a, 0x8c, 0x0c, 0x01, 0xeb,
+  0xaf, 0xff, 0xc4, 0x00, 0x21, 0x10, 0x00, 0x02, 0x01, 0x04, 0x02,
+  0x03, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x01, 0x11, 0x21, 0x00, 0x31, 0x41, 0x51, 0x61, 0x81, 0x71, 0x91,
+  0xa1, 0xb1, 0xf1, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01,
+  0x3f, 0x10, 0x28, 0x81, 0x45, 0xd0, 0x4b, 0x2d, 0xce, 0xaa, 0x31,
+  0x10, 0x6a, 0xfd, 0x75, 0xaa, 0x75, 0x80, 0xf1, 0xb1, 0x7f, 0xca,
+  0x34, 0x97, 0x44, 0x1f, 0x83, 0x59, 0x5d, 0x78, 0x5c, 0x50, 0x65,
+  0x22, 0x22, 0x0b, 0x29, 0x7f, 0x28, 0x29, 0xc4, 0xab, 0xf6, 0xeb,
+  0x59, 0xa1, 0x03, 0x07, 0xa6, 0xed, 0xfa, 0xd7, 0xda, 0x0f, 0x4c,
+  0x56, 0xe0, 0x00, 0x91, 0x10, 0x8e, 0xeb, 0xd8, 0xa0, 0xa5, 0xc5,
+  0xbd, 0x9c, 0xea, 0x80, 0xcd, 0x37, 0x23, 0xcb, 0xad, 0x50, 0xd8,
+  0xc1, 0x89, 0x3f, 0x5a, 0xa0, 0xb0, 0x1c, 0x64, 0x11, 0x24, 0x4d,
+  0x95, 0x17, 0xaf, 0xff, 0xd9
+};
+
+// 26x15 RGB, quality 70, 4:4:4, progressive, restart every MCU row.
+static const u8 ProgressiveRestart[] = {
+  0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00,
+  0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb,
+  0x00, 0x43, 0x00, 0x0a, 0x07, 0x07, 0x08, 0x07, 0x06, 0x0a, 0x08,
+  0x08, 0x08, 0x0b, 0x0a, 0x0a, 0x0b, 0x0e, 0x18, 0x10, 0x0e, 0x0d,
+  0x0d, 0x0e, 0x1d, 0x15, 0x16, 0x11, 0x18, 0x23, 0x1f, 0x25, 0x24,
+  0x22, 0x1f, 0x22, 0x21, 0x26, 0x2b, 0x37, 0x2f, 0x26, 0x29, 0x34,
+  0x29, 0x21, 0x22, 0x30, 0x41, 0x31, 0x34, 0x39, 0x3b, 0x3e, 0x3e,
+  0x3e, 0x25, 0x2e, 0x44, 0x49, 0x43, 0x3c, 0x48, 0x37, 0x3d, 0x3e,
+  0x3b, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x0a, 0x0b, 0x0b, 0x0e, 0x0d,
+  0x0e, 0x1c, 0x10, 0x10, 0x1c, 0x3b, 0x28, 0x22, 0x28, 0x3b, 0x3b,
+  0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b,
+  0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b,
+  0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b,
+  0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b, 0x3b,
+  0x3b, 0x3b, 0x3b, 0x3b, 0xff, 0xc2, 0x00, 0x11, 0x08, 0x00, 0x0f,
+  0x00, 0x1a, 0x03, 0x01, 0x11, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+  0x01, 0xff, 0xc4, 0x00, 0x16, 0x00, 0x01, 0x01, 0x01, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x04, 0x05, 0x03, 0xff, 0xc4, 0x00, 0x18, 0x01, 0x00, 0x03, 0x01,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x03, 0x04, 0x05, 0x02, 0x06, 0xff, 0xdd, 0x00, 0x04,
+  0x00, 0x04, 0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x10,
+  0x03, 0x10, 0x00, 0x00, 0x01, 0x8f, 0x44, 0x4a, 0x15, 0x04, 0x89,
+  0xf9, 0x8d, 0xf3, 0xff, 0x00, 0xff, 0xd0, 0x56, 0x60, 0xa8, 0x54,
+  0x77, 0x1b, 0x93, 0x9a, 0x85, 0xff, 0xc4, 0x00, 0x1a, 0x10, 0x00,
+  0x02, 0x03, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x01, 0x03, 0x12, 0x11, 0x13,
+  0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x05, 0x02, 0x5a,
+  0x32, 0x2d, 0x1d, 0x22, 0x9d, 0x46, 0x14, 0xff, 0xd0, 0x5a, 0x32,
+  0x45, 0x07, 0x8c, 0x3a, 0xf1, 0xd6, 0x7f, 0xff, 0xc4, 0x00, 0x20,
+  0x11, 0x00, 0x01, 0x03, 0x04, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x01, 0x11, 0x02,
+  0x12, 0x13, 0x21, 0x04, 0x31, 0x41, 0x71, 0xe1, 0xff, 0xda, 0x00,
+  0x08, 0x01, 0x03, 0x01, 0x01, 0x3f, 0x01, 0x19, 0xee, 0xd2, 0x19,
+  0xfc, 0x2a, 0x4f, 0x8d, 0xa5, 0x66, 0x1b, 0xee, 0xa9, 0x9f, 0x7f,
+  0x17, 0xff, 0xd0, 0x19, 0xae, 0x43, 0x34, 0x69, 0x65, 0x66, 0x1b,
+  0xdd, 0xd2, 0xab, 0x94, 0x76, 0x78, 0x7a, 0x9d, 0x7f, 0xff, 0xc4,
+  0x00, 0x27, 0x11, 0x00, 0x00, 0x04, 0x04, 0x03, 0x09, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x11,
+  0x23, 0x03, 0x24, 0x31, 0x61, 0x15, 0x41, 0x71, 0x02, 0x04, 0x12,
+  0x13, 0x14, 0x21, 0x22, 0x51, 0xc1, 0xff, 0xda, 0x00, 0x08, 0x01,
+  0x02, 0x01, 0x01, 0x3f, 0x01, 0x39, 0x37, 0x15, 0x72, 0x06, 0xe4,
+  0xca, 0xdd, 0x34, 0x07, 0x13, 0xae, 0xb2, 0x7d, 0x18, 0x89, 0xc2,
+  0x6d, 0x29, 0xd8, 0x7f, 0xff, 0xd0, 0x39, 0x37, 0x2b, 0x90, 0x37,
+  0x26, 0x56, 0xe9, 0xa0, 0xe6, 0x9e, 0xfa, 0x7e, 0x90, 0x62, 0x1b,
+  0x30, 0xfc, 0x38, 0x68, 0x3f, 0xff, 0xc4, 0x00, 0x1c, 0x10, 0x00,
+  0x01, 0x04, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x11, 0x12, 0x21, 0x02, 0x61,
+  0x71, 0x91, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x06, 0x3f,
+  0x02, 0x24, 0x70, 0xbc, 0x57, 0xd3, 0xff, 0xd0, 0x72, 0x42, 0xbd,
+  0x21, 0x17, 0x5a, 0xd9, 0xff, 0xc4, 0x00, 0x1d, 0x10, 0x00, 0x03,
+  0x00, 0x02, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x01, 0x11, 0x21, 0x41, 0x31, 0x51, 0xa1,
+  0xc1, 0xd1, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3f,
+  0x21, 0xe5, 0xca, 0x7c, 0x42, 0xa3, 0x6a, 0x09, 0x61, 0xb7, 0xb7,
+  0xbf, 0x83, 0xff, 0xd0, 0x47, 0x76, 0x85, 0xbf, 0x43, 0xab, 0x07,
+  0x46, 0xc1, 0xa9, 0x80, 0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00,
+  0x02, 0x00, 0x03, 0x00, 0x00, 0x00, 0x10, 0xd0, 0x1f, 0xff, 0xd0,
+  0x60, 0x1f, 0xff, 0xc4, 0x00, 0x1e, 0x11, 0x01, 0x00, 0x02, 0x02,
+  0x02, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01, 0x00, 0x21, 0x11, 0x41, 0x31, 0x91, 0x61, 0x71, 0xd1,
+  0xf0, 0xff, 0xda, 0x00, 0x08, 0x01, 0x03, 0x01, 0x01, 0x3f, 0x10,
+  0x91, 0x83, 0xf7, 0x70, 0xd5, 0x5e, 0xfa, 0xf7, 0x5d, 0xc0, 0xb8,
+  0x92, 0xb5, 0xc3, 0x9d, 0xed, 0x3f, 0xff, 0xd0, 0x5a, 0x45, 0x52,
+  0xe7, 0xab, 0x0e, 0x7c, 0x18, 0xb8, 0x9c, 0x24, 0xe6, 0xdf, 0xb3,
+  0xff, 0xc4, 0x00, 0x21, 0x11, 0x00, 0x01, 0x04, 0x02, 0x01, 0x05,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11,
+  0x00, 0x01, 0x21, 0x31, 0x51, 0x61, 0x41, 0x71, 0x81, 0x91, 0xa1,
+  0xe1, 0xc1, 0xff, 0xda, 0x00, 0x08, 0x01, 0x02, 0x01, 0x01, 0x3f,
+  0x10, 0x7e, 0xe6, 0x95, 0x72, 0x79, 0xc2, 0x7e, 0x30, 0xf8, 0x0e,
+  0xc6, 0x21, 0x14, 0x3f, 0x73, 0xe9, 0x8d, 0xaa, 0xe6, 0xbb, 0x5d,
+  0xd2, 0x17, 0xff, 0xd0, 0x3b, 0xa7, 0x4a, 0xb9, 0x3c, 0xe1, 0x3d,
+  0xf8, 0xc3, 0xe0, 0x3b, 0x18, 0x84, 0x0c, 0x4f, 0xbc, 0x9f, 0x02,
+  0x93, 0x31, 0x16, 0xbd, 0x09, 0x04, 0x41, 0x02, 0x0a, 0xff, 0xc4,
+  0x00, 0x1c, 0x10, 0x00, 0x02, 0x02, 0x03, 0x01, 0x01, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x11, 0x00,
+  0x21, 0x31, 0x41, 0x81, 0xf1, 0x51, 0xff, 0xda, 0x00, 0x08, 0x01,
+  0x01, 0x00, 0x01, 0x3f, 0x10, 0xad, 0x9b, 0x49, 0x29, 0x49, 0x16,
+  0xe8, 0xf1, 0xe4, 0x12, 0x34, 0x24, 0xe8, 0xbe, 0x95, 0xf2, 0x00,
+  0xc0, 0x0e, 0x90, 0x0d, 0xb3, 0x1f, 0xff, 0xd0, 0x49, 0x47, 0xc3,
+  0x10, 0xcd, 0x40, 0xdf, 0x1e, 0x42, 0xf3, 0x43, 0x82, 0xca, 0x22,
+  0xe3, 0xf1, 0xd2, 0x77, 0xc8, 0xa9, 0xff, 0xd9
+};
+
+// 19x11 gray, quality 95, progressive.
+static const u8 GrayProgressive[] = {
+  0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00,
+  0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb,
+  0x00, 0x43, 0x00, 0x02, 0x01, 0x01, 0x01, 0x01, 0x01, 0x02, 0x01,
+  0x01, 0x01, 0x02, 0x02, 0x02, 0x02, 0x02, 0x04, 0x03, 0x02, 0x02,
+  0x02, 0x02, 0x05, 0x04, 0x04, 0x03, 0x04, 0x06, 0x05, 0x06, 0x06,
+  0x06, 0x05, 0x06, 0x06, 0x06, 0x07, 0x09, 0x08, 0x06, 0x07, 0x09,
+  0x07, 0x06, 0x06, 0x08, 0x0b, 0x08, 0x09, 0x0a, 0x0a, 0x0a, 0x0a,
+  0x0a, 0x06, 0x08, 0x0b, 0x0c, 0x0b, 0x0a, 0x0c, 0x09, 0x0a, 0x0a,
+  0x0a, 0xff, 0xc2, 0x00, 0x0b, 0x08, 0x00, 0x0b, 0x00, 0x13, 0x01,
+  0x01, 0x11, 0x00, 0xff, 0xc4, 0x00, 0x16, 0x00, 0x01, 0x01, 0x01,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x07, 0x04, 0x06, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01,
+  0x00, 0x00, 0x00, 0x01, 0xc3, 0x27, 0x13, 0x32, 0x24, 0xdb, 0xff,
+  0xc4, 0x00, 0x1d, 0x10, 0x00, 0x01, 0x04, 0x02, 0x03, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00,
+  0x03, 0x04, 0x06, 0x01, 0x16, 0x02, 0x07, 0x13, 0xff, 0xda, 0x00,
+  0x08, 0x01, 0x01, 0x00, 0x01, 0x05, 0x02, 0x13, 0x48, 0xd2, 0x50,
+  0xaa, 0x46, 0x49, 0xa3, 0x45, 0x3c, 0x8a, 0xf5, 0x7c, 0x66, 0x30,
+  0x67, 0x8b, 0x2d, 0x6f, 0x37, 0x18, 0x91, 0x5b, 0xb2, 0x7f, 0xff,
+  0xc4, 0x00, 0x2a, 0x10, 0x00, 0x01, 0x02, 0x03, 0x06, 0x04, 0x07,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02,
+  0x12, 0x00, 0x03, 0x11, 0x04, 0x21, 0x22, 0x23, 0x41, 0x51, 0x05,
+  0x06, 0x14, 0x33, 0x15, 0x31, 0x34, 0x62, 0x82, 0xb2, 0xc2, 0xff,
+  0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x06, 0x3f, 0x02, 0x1c, 0x55,
+  0xfd, 0x53, 0xf2, 0x98, 0xd6, 0x79, 0xdf, 0x5a, 0xdf, 0xb4, 0x0e,
+  0x73, 0x73, 0x1b, 0x9b, 0xd3, 0x36, 0xbd, 0xbd, 0x1d, 0xf1, 0xdb,
+  0x58, 0x9e, 0x8f, 0x05, 0x2a, 0x2f, 0xc6, 0x4d, 0xa5, 0x2a, 0xc5,
+  0xad, 0xe1, 0x3b, 0xd6, 0x17, 0x96, 0x3b, 0x07, 0xec, 0x98, 0x46,
+  0x01, 0xea, 0xa4, 0xfe, 0x62, 0xd2, 0x99, 0x72, 0x12, 0x05, 0x52,
+  0x68, 0x07, 0xb4, 0x47, 0xff, 0xc4, 0x00, 0x1c, 0x10, 0x01, 0x00,
+  0x02, 0x02, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x01, 0x11, 0x31, 0x00, 0x21, 0x41, 0x61, 0x81,
+  0x51, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3f, 0x21,
+  0x9d, 0xbe, 0xeb, 0xde, 0x83, 0xcf, 0x39, 0x76, 0x3b, 0xae, 0x52,
+  0xce, 0x76, 0x9a, 0x7d, 0x64, 0x42, 0x44, 0xd6, 0x17, 0xbd, 0x50,
+  0x9d, 0x03, 0x16, 0x0c, 0x98, 0xf0, 0x65, 0x0f, 0x9b, 0x2f, 0x4a,
+  0x9c, 0x1e, 0xd7, 0x5f, 0x55, 0x73, 0xff, 0xda, 0x00, 0x08, 0x01,
+  0x01, 0x00, 0x00, 0x00, 0x10, 0xbb, 0xff, 0xc4, 0x00, 0x1c, 0x10,
+  0x01, 0x01, 0x00, 0x02, 0x03, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x11, 0x00, 0x21, 0x31, 0x41,
+  0x51, 0xa1, 0xb1, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01,
+  0x3f, 0x10, 0x54, 0x50, 0x64, 0xed, 0xfa, 0xda, 0xf4, 0x9e, 0x3b,
+  0xd6, 0xd6, 0x88, 0x1d, 0xca, 0xa4, 0x42, 0x7b, 0x0a, 0xe1, 0x18,
+  0x8e, 0x04, 0x16, 0x20, 0xa5, 0x31, 0x8d, 0x68, 0x06, 0x0a, 0x17,
+  0x37, 0xb5, 0xe4, 0xdf, 0x98, 0x24, 0xa8, 0x25, 0x3a, 0x83, 0xf0,
+  0x31, 0x43, 0x27, 0x00, 0x33, 0x31, 0xda, 0x07, 0x95, 0x55, 0xdb,
+  0x9f, 0xff, 0xd9
+};
+
+// The CRC-32 of the texels as RGB or gray bytes. Gray images must be
+// decoded with the same value in the color channels.
+static Opt<u32> getChecksum(const data::Image& image, bool gray)
+{
+  if(image.format != Format::R8G8B8A8_UNORM) return std::nullopt;
+
+  Arr<u8> bytes;
+  for(u64 idx = 0u; idx < image.texels.size(); idx += 4u) {
+    const u8* texel = &image.texels[idx];
+    if(texel[3] != 0xffu) return std::nullopt;
+
+    if(gray) {
+      if(texel[1] != texel[0] || texel[2] != texel[0])
+        return std::nullopt;
+      bytes.push_back(texel[0]);
+    } else
+      bytes.insert(bytes.end(), texel, texel + 3);
+  }
+  return crc32(bytes);
+}
+
+int main()
+{
+  struct Case {
+    const char*    name;
+    Span<u8 const> file;
+    UInt2          size;
+    bool           gray;
+    u32            checksum;
+  };
+
+  const Case cases[] = {
+    {"Baseline444", Baseline444, {23u, 13u}, false, 0xe067e37eu},
+    {"Baseline420", Baseline420, {33u, 17u}, false, 0x2f35672fu},
+    {"Baseline422Restart", Baseline422Restart, {29u, 18u}, false,
+     0xc02b274eu},
+    {"Progressive420", Progressive420, {31u, 21u}, false, 0x1d14ef46u},
+    {"ProgressiveRestart", ProgressiveRestart, {26u, 15u}, false,
+     0xec741bdfu},
+    {"GrayProgressive", GrayProgressive, {19u, 11u}, true, 0xdea412f1u},
+  };
+
+  for(const auto& test: cases) {
+    for(const u32 threadCount: {1u, 4u}) {
+      DataReader::ImageOptions options;
+      options.threadCount = threadCount;
+
+      char what[64];
+      std::snprintf(
+        what, sizeof(what), "%s, %u threads", test.name, threadCount);
+
+      try {
+        DataReader reader;
+        const auto image = reader.ReadImage(test.file, options);
+        check(
+          image.size[0] == test.size[0] &&
+            image.size[1] == test.size[1] &&
+            getChecksum(image, test.gray) == test.checksum,
+          what);
+      } catch(const std::exception& e) {
+        std::printf("%s: %s\n", test.name, e.what());
+        check(false, what);
+      }
+    }
+  }
+
+  // Only 8-bit samples are supported, the precision is the first byte
+  // of the frame header.
+  Arr<u8> twelveBit(std::begin(Baseline444), std::end(Baseline444));
+  for(u64 idx = 0u; idx + 4u < twelveBit.size(); ++idx) {
+    if(twelveBit[idx] == 0xffu && twelveBit[idx + 1u] == 0xc0u) {
+      twelveBit[idx + 4u] = 12u;
+      break;
+    }
+  }
+
+  bool threw = false;
+  try {
+    DataReader reader;
+    (void)reader.ReadImage({twelveBit.data(), twelveBit.size()}, {});
+  } catch(const std::exception&) {
+    threw = true;
+  }
+  check(threw, "12-bit samples throw");
+
+  std::printf("%u/%u checks pass\n", s_checks - s_failures, s_checks);
+  return s_failures == 0u ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+#include "vuldir/core/Core.hpp"
+
+#include <cstdio>
+
+using namespace vd;
+
+// Parses the same documents into Json::Value, Json::Document and
+// Json::LazyDocument and compares the trees. Objects of the first two
+// are sorted by key with the last duplicate kept, the lazy ones are
+// compared through lookups, which also keep the last duplicate.
+
+static u32 s_failures = 0u;
+static u32 s_checks   = 0u;
+
+static void check(bool condition, const char* what)
+{
+  ++s_checks;
+  if(!condition) {
+    ++s_failures;
+    std::printf("%s: failed\n", what);
+  }
+}
+
+static Span<char const> toSpan(Strv src)
+{
+  return Span<char const>(src.data(), src.size());
+}
+
+static bool isSame(const Json::Value& value, const Json::Node& node)
+{
+  if(value.IsInteger())
+    return node.IsInteger() &&
+           node.AsNumber<i64>() == value.AsNumber<i64>();
+  if(value.IsNumber())
+    return node.IsNumber() && !node.IsInteger() &&
+           node.AsNumber() == value.AsNumber();
+  if(value.IsBool())
+    return node.IsBool() && node.AsBool() == value.AsBool();
+  if(value.IsString())
+    return node.IsString() && node.AsString() == value.AsString();
+
+  if(value.IsArray()) {
+    const auto& items = value.AsArray();
+    if(!node.IsArray() || node.GetSize() != items.size()) return false;
+    for(u64 idx = 0u; idx < items.size(); ++idx)
+      if(!isSame(items[idx], node[idx])) return false;
+    return true;
+  }
+
+  if(value.IsObject()) {
+    const auto& members = value.AsObject();
+    if(!node.IsObject() || node.GetSize() != members.size())
+      return false;
+
+    u64 idx = 0u;
+    for(const auto& [key, item]: members) {
+      const auto& member = node.AsObject()[idx++];
+      if(member.key != key || !isSame(item, member.value)) return false;
+    }
+    return true;
+  }
+
+  return !node.HasValue();
+}
+
+static bool
+isSame(const Json::Value& value, const Json::LazyValue& lazy)
+{
+  if(value.IsInteger())
+    return lazy.IsNumber() &&
+           lazy.AsNumber<i64>() == value.AsNumber<i64>();
+  if(value.IsNumber())
+    return lazy.IsNumber() && lazy.AsNumber() == value.AsNumber();
+  if(value.IsBool())
+    return lazy.IsBool() && lazy.AsBool() == value.AsBool();
+  if(value.IsString())
+    return lazy.IsString() && lazy.AsString() == value.AsString();
+
+  if(value.IsArray()) {
+    const auto& items = value.AsArray();
+    if(!lazy.IsArray() || lazy.GetSize() != items.size()) return false;
+
+    u64 idx = 0u;
+    for(const auto& item: lazy.AsArray())
+      if(!isSame(items[idx++], item)) return false;
+    return true;
+  }
+
+  if(value.IsObject()) {
+    if(!lazy.IsObject()) return false;
+    for(const auto& member: lazy.AsObject())
+      if(!value.AsObject().contains(Str(member.key))) return false;
+    for(const auto& [key, item]: value.AsObject())
+      if(!isSame(item, lazy[key])) return false;
+    return true;
+  }
+
+  return !lazy.HasValue();
+}
+
+int main()
+{
+  const Strv documents[] = {
+    "null",
+    "true",
+    "-0",
+    "[]",
+    "{}",
+    R"([1, -2, 3.5, 1e300, -9223372036854775808,
+        18446744073709551616])",
+    R"({"b": [true, false, null], "a": {"c": "x", "d": []}})",
+    R"({"k": 1, "k": 2, "j": 3, "k": 4})",
+    R"(["plain", "esc\"aped\n", "é😀", ""])",
+    R"({"z":0,"y":1,"x":2,"w":3,"v":4,"u":5,"t":6,"s":7,"r":8,"q":9,
+        "p":10,"o":11,"n":12,"m":13,"l":14,"k":15,"j":16,"i":17,"h":18,
+        "g":19,"f":20,"e":21,"d":22,"c":23,"b":24,"a":25,"aa":26,
+        "ab":27,"ac":28,"ad":29,"ae":30,"af":31,"ag":32,"a":33})",
+  };
+
+  for(const auto src: documents) {
+    Json::Value value;
+    value.Read(toSpan(src));
+
+    const Json::Document document(toSpan(src));
+    check(isSame(value, document.GetRoot()), Str(src).c_str());
+
+    const Json::LazyDocument lazy(toSpan(src));
+    check(isSame(value, lazy.GetRoot()), Str(src).c_str());
+  }
+
+  const Strv src = R"({"n": -1, "big": 9007199254740993, "f": 0.5,
+    "s": "view", "e": "a\tb", "m": [1, 2, 3, 4]})";
+  const Json::Document document(toSpan(src));
+
+  check(!document["missing"].HasValue(), "missing key is null");
+  check(!document["m"][4].HasValue(), "index past the end is null");
+  check(
+    document["big"].AsNumber<u64>() == 9007199254740993ull,
+    "integers beyond 2^53 are exact");
+  check(document["f"].AsNumber<f32>() == 0.5f, "float conversion");
+  check(document["n"].AsNumberOpt<i32>(7) == -1, "number with default");
+  check(document["s"].AsNumberOpt<i32>(7) == 7, "default on a string");
+  check(
+    document["s"].AsString().data() >= src.data() &&
+      document["s"].AsString().data() < src.data() + src.size(),
+    "strings without escapes point into the source");
+  check(document["e"].AsString() == "a\tb", "escaped string");
+  const auto vector = document["m"].AsVector<Float3>();
+  check(
+    vector[0] == 1.0f && vector[1] == 2.0f && vector[2] == 3.0f,
+    "vector read");
+
+  const auto throws = [](auto fn) {
+    try {
+      fn();
+    } catch(const std::exception&) {
+      return true;
+    }
+    return false;
+  };
+  check(
+    throws([&]() { (void)document["n"].AsNumber<u32>(); }),
+    "negative to unsigned throws");
+  check(
+    throws([&]() { (void)document["f"].AsNumber<i32>(); }),
+    "fraction to integer throws");
+  check(
+    throws([&]() { (void)document["s"].AsNumber(); }),
+    "string as number throws");
+
+  // Values are only parsed when they are read.
+  const Strv partial = R"({"a": [1, 2], "b": 01x, "c": "ok"})";
+  const Json::LazyDocument lazy(toSpan(partial));
+  check(lazy["c"].AsString() == "ok", "lazy read past a bad value");
+  check(lazy["a"].GetSize() == 2u, "lazy array size");
+  check(
+    throws([&]() { (void)lazy["b"].AsNumber(); }),
+    "lazy bad number throws when read");
+  check(
+    throws([&]() { Json::LazyDocument bad(toSpan(R"({"a": [1})")); }),
+    "lazy unbalanced brackets throw");
+  check(
+    lazy["a"].AsNumberOpt<u8>(9u) == 9u && !lazy["d"].HasValue(),
+    "lazy defaults and missing keys");
+
+  std::printf("%u/%u checks pass\n", s_checks - s_failures, s_checks);
+  return s_failures == 0u ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#include "vuldir/DataReader.hpp"
+
+#include <cstdio>
+
+using namespace vd;
+
+// Walks LazyDocument values in document order and reads past values
+// that are broken but never read. Then probes a glTF with readAssets =
+// false, which goes through the lazy document and must list the same
+// model as the full read while skipping the sections it doesn't list.
+
+static u32 s_failures = 0u;
+static u32 s_checks   = 0u;
+
+static void check(bool condition, const char* what)
+{
+  ++s_checks;
+  if(!condition) {
+    ++s_failures;
+    std::printf("%s: failed\n", what);
+  }
+}
+
+static Span<char const> toSpan(Strv src)
+{
+  return Span<char const>(src.data(), src.size());
+}
+
+template<typename Fn>
+static bool throws(Fn fn)
+{
+  try {
+    fn();
+  } catch(const std::exception&) {
+    return true;
+  }
+  return false;
+}
+
+static void testOrder()
+{
+  const Strv src =
+    R"({"b": 1, "a": {"x": [2, 3]}, "b": "two", "c": [], "a": 4})";
+  const Json::LazyDocument document(toSpan(src));
+
+  Str keys;
+  for(const auto& member: document.GetRoot().AsObject())
+    keys += member.key;
+  check(keys == "babca", "members in document order with duplicates");
+  check(document["b"].AsString() == "two", "last duplicate wins");
+  check(document["a"].AsNumber<u32>() == 4u, "last duplicate object");
+
+  const Strv items = R"([1, {"a": [2, [3]]}, "s", [[4], 5], null, 6])";
+  const Json::LazyDocument array(toSpan(items));
+
+  Str types;
+  for(const auto& item: array.GetRoot().AsArray()) {
+    if(item.IsNumber()) types += 'n';
+    else if(item.IsObject())
+      types += 'o';
+    else if(item.IsString())
+      types += 's';
+    else if(item.IsArray())
+      types += 'a';
+    else if(!item.HasValue())
+      types += '0';
+  }
+  check(types == "nosa0n", "items in document order");
+  check(array.GetRoot()[5].AsNumber<u32>() == 6u, "item past nesting");
+  check(array.GetRoot()[3][0][0].AsNumber<u32>() == 4u, "nested item");
+  check(array.GetRoot().GetSize() == 6u, "item count");
+}
+
+static void testSkipping()
+{
+  // Brackets inside strings are not structural, and the broken
+  // values are only found when read.
+  const Strv src = R"({"s": "[{", "skip": [[tru, 01x], {"k": -}],
+    "t": ["]}", "}"], "next": 7})";
+  const Json::LazyDocument document(toSpan(src));
+
+  check(document["next"].AsNumber<u32>() == 7u, "read past skipped");
+  check(document["t"][1].AsString() == "}", "brackets in strings");
+  check(document["skip"].GetSize() == 2u, "broken items counted");
+  check(document["skip"][1].IsObject(), "broken item type");
+  check(
+    throws([&]() { (void)document["skip"][0][0].AsBool(); }),
+    "broken literal throws when read");
+  check(
+    throws([&]() { (void)document["skip"][0][1].AsNumber(); }),
+    "broken number throws when read");
+  check(
+    throws([&]() { Json::Value().Read(toSpan(src)); }),
+    "the full parse rejects the same document");
+}
+
+static Str makeGltf(Strv animations)
+{
+  Str ret = R"({
+    "asset": {"version": "2.0"},
+    "buffers": [{"byteLength": 6,
+      "uri": "data:application/octet-stream;base64,AAAAAAAA"}],
+    "bufferViews": [{"buffer": 0, "byteLength": 4}],
+    "accessors": [{"bufferView": 0, "componentType": 5126,
+      "count": 1, "type": "SCALAR", "min": [-2], "max": [3]}],
+    "meshes": [
+      {"name": "first", "extras": {"blob": )";
+  ret += animations;
+  ret += R"(},
+        "primitives": [{"attributes": {"POSITION": 0, "NORMAL": 0},
+          "material": 1}]},
+      {"name": "second", "primitives": [{"attributes": {"POSITION": 0},
+        "indices": 0}]}],
+    "materials": [{"name": "a"}, {"name": "b", "doubleSided": true}],
+    "samplers": [{"magFilter": 9728}],
+    "textures": [{"sampler": 0}],
+    "animations": )";
+  ret += animations;
+  ret += "}";
+  return ret;
+}
+
+static data::Model readModel(const Str& gltf, bool readAssets)
+{
+  DataReader::ModelOptions options;
+  options.readAssets = readAssets;
+
+  DataReader reader;
+  return reader.ReadModel(
+    {reinterpret_cast<const u8*>(gltf.data()), gltf.size()}, options);
+}
+
+static bool isSameListing(const data::Model& a, const data::Model& b)
+{
+  if(
+    a.meshes.size() != b.meshes.size() ||
+    a.materials.size() != b.materials.size() ||
+    a.accessors.size() != b.accessors.size() ||
+    a.samplers.size() != b.samplers.size() ||
+    a.textures.size() != b.textures.size() ||
+    a.buffers.size() != b.buffers.size())
+    return false;
+
+  for(u64 idx = 0u; idx < a.meshes.size(); ++idx) {
+    const auto& meshA = a.meshes[idx];
+    const auto& meshB = b.meshes[idx];
+    if(
+      meshA.name != meshB.name ||
+      meshA.primitives.size() != meshB.primitives.size())
+      return false;
+
+    for(u64 prim = 0u; prim < meshA.primitives.size(); ++prim) {
+      const auto& primA = meshA.primitives[prim];
+      const auto& primB = meshB.primitives[prim];
+      if(
+        primA.material != primB.material ||
+        primA.indicesAccessorIndex != primB.indicesAccessorIndex ||
+        primA.attributes.size() != primB.attributes.size())
+        return false;
+      for(u64 attr = 0u; attr < primA.attributes.size(); ++attr)
+        if(
+          primA.attributes[attr].type != primB.attributes[attr].type)
+          return false;
+    }
+  }
+
+  for(u64 idx = 0u; idx < a.materials.size(); ++idx)
+    if(a.materials[idx].name != b.materials[idx].name) return false;
+
+  for(u64 idx = 0u; idx < a.accessors.size(); ++idx) {
+    const auto& accA = a.accessors[idx];
+    const auto& accB = b.accessors[idx];
+    if(
+      accA.min.has_value() != accB.min.has_value() ||
+      accA.max.has_value() != accB.max.has_value() ||
+      (accA.min && (*accA.min)[0] != (*accB.min)[0]) ||
+      (accA.max && (*accA.max)[0] != (*accB.max)[0]))
+      return false;
+  }
+
+  return true;
+}
+
+static void testProbe()
+{
+  const Str  valid = makeGltf(R"([{"samplers": [], "channels": []}])");
+  const auto full  = readModel(valid, true);
+  const auto probe = readModel(valid, false);
+
+  check(isSameListing(full, probe), "probe lists the full model");
+  check(
+    probe.meshes.size() == 2u && probe.meshes[0].name == "first" &&
+      probe.meshes[1].name == "second",
+    "probe meshes in document order");
+  check(
+    probe.meshes[0].primitives[0].attributes.size() == 2u &&
+      probe.meshes[0].primitives[0].attributes[0].type ==
+        VertexAttribute::Position,
+    "probe attributes in document order");
+  check(
+    full.accessors.size() == 1u && full.accessors[0].min &&
+      (*full.accessors[0].min)[0] == -2.0f &&
+      full.accessors[0].max && (*full.accessors[0].max)[0] == 3.0f,
+    "accessor bounds");
+  check(
+    probe.buffers.size() == 1u && probe.buffers[0].data.empty() &&
+      full.buffers[0].data.size() == 6u,
+    "probe reads no buffer data");
+
+  // The probe never parses what it skips.
+  const Str broken = makeGltf(R"([{"samplers": [tru, 01x]}])");
+  check(
+    throws([&]() { (void)readModel(broken, true); }),
+    "full read checks skipped sections");
+  check(
+    !throws([&]() {
+      check(
+        isSameListing(full, readModel(broken, false)),
+        "probe past broken sections");
+    }),
+    "probe skips broken sections");
+
+  // What the probe reads is still checked.
+  check(
+    throws([&]() {
+      (void)readModel(R"({"meshes": [{"name": tru}]})", false);
+    }),
+    "probe checks the values it reads");
+  check(
+    throws([&]() { (void)readModel(R"({"meshes": [{}})", false); }),
+    "probe checks the brackets");
+}
+
+int main()
+{
+  testOrder();
+  testSkipping();
+  testProbe();
+
+  std::printf("%u/%u checks pass\n", s_checks - s_failures, s_checks);
+  return s_failures == 0u ? 0 : 1;
+}
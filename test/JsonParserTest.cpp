@@ -0,0 +1,255 @@
+#include "vuldir/core/Core.hpp"
+
+#include <cstdio>
+#include <random>
+
+using namespace vd;
+
+// Documents the parser must accept and documents it must reject, then
+// the UTF-8 check of every instruction set the CPU has against the
+// scalar one on random, partly broken UTF-8 across block boundaries.
+
+static u32 s_failures = 0u;
+static u32 s_checks   = 0u;
+
+static void check(bool condition, const char* what)
+{
+  ++s_checks;
+  if(!condition) {
+    ++s_failures;
+    std::printf("%s: failed\n", what);
+  }
+}
+
+static bool isAccepted(Strv src)
+{
+  try {
+    Json::Value value;
+    value.Read(Span<char const>(src.data(), src.size()));
+  } catch(const std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+// Printable form of a document for the report.
+static Str toPrintable(Strv src)
+{
+  Str ret;
+  for(const char c: src) {
+    if(toU8(c) >= 0x20u && toU8(c) < 0x7fu) ret.push_back(c);
+    else {
+      char hex[8];
+      std::snprintf(hex, sizeof(hex), "\\x%02x", toU8(c));
+      ret += hex;
+    }
+  }
+  return ret;
+}
+
+static bool isValidUtf8(Json::Utf8Fn fn, const Arr<u8>& src)
+{
+  Json::Utf8State state;
+
+  SArr<char, Json::BlockSize> block;
+  for(u64 offset = 0u; offset < src.size();
+      offset += Json::BlockSize) {
+    const u64 size = std::min(Json::BlockSize, src.size() - offset);
+    block.fill(' ');
+    memcpy(block.data(), src.data() + offset, size);
+    fn(block.data(), state);
+  }
+  return !state.isError && !state.isIncomplete;
+}
+
+static void appendCodePoint(Arr<u8>& dst, u32 code)
+{
+  if(code < 0x80u) dst.push_back(toU8(code));
+  else if(code < 0x800u) {
+    dst.push_back(toU8(0xc0u | (code >> 6)));
+    dst.push_back(toU8(0x80u | (code & 0x3fu)));
+  } else if(code < 0x10000u) {
+    dst.push_back(toU8(0xe0u | (code >> 12)));
+    dst.push_back(toU8(0x80u | ((code >> 6) & 0x3fu)));
+    dst.push_back(toU8(0x80u | (code & 0x3fu)));
+  } else {
+    dst.push_back(toU8(0xf0u | (code >> 18)));
+    dst.push_back(toU8(0x80u | ((code >> 12) & 0x3fu)));
+    dst.push_back(toU8(0x80u | ((code >> 6) & 0x3fu)));
+    dst.push_back(toU8(0x80u | (code & 0x3fu)));
+  }
+}
+
+static void testDocuments()
+{
+  const Strv accepted[] = {
+    "0",
+    "-0.5e-3",
+    "1E+2",
+    "\"\"",
+    " [ ] ",
+    "{\"a\":{\"b\":[null,true,false]}}",
+    "[\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\\ud83d\\ude00\"]",
+    "\t[\r\n1\n]\r\n",
+    "[\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\"]",
+    "[\"\xed\x9f\xbf\xee\x80\x80\xf4\x8f\xbf\xbf\"]",
+    "18446744073709551616",
+    "1e400",
+  };
+
+  const Strv rejected[] = {
+    "",
+    "   ",
+    "[",
+    "]",
+    "[1,]",
+    "{\"a\"}",
+    "{\"a\":1,}",
+    "{1:2}",
+    "[1 2]",
+    "[01]",
+    "[1.]",
+    "[.5]",
+    "[-]",
+    "[1e]",
+    "[+1]",
+    "[tru]",
+    "[nul]",
+    "[truex]",
+    "[\"abc]",
+    "[\"\\x\"]",
+    "[\"\\u12\"]",
+    "[\"\\ud800\"]",
+    "[\"\\udc00\"]",
+    "[1] [2]",
+    // Control characters within strings and between values.
+    Strv("[\"a\x00b\"]", 6),
+    "[\"a\x01\"]",
+    "[\"a\tb\"]",
+    "[\"a\nb\"]",
+    "[\x1f]",
+    "[1,\x02]",
+    // Overlong forms, surrogates, values past U+10FFFF.
+    "[\"\xc0\x80\"]",
+    "[\"\xc1\xbf\"]",
+    "[\"\xe0\x80\x80\"]",
+    "[\"\xe0\x9f\xbf\"]",
+    "[\"\xf0\x80\x80\x80\"]",
+    "[\"\xf0\x8f\xbf\xbf\"]",
+    "[\"\xed\xa0\x80\"]",
+    "[\"\xed\xbf\xbf\"]",
+    "[\"\xf4\x90\x80\x80\"]",
+    "[\"\xf5\x80\x80\x80\"]",
+    "[\"\xff\"]",
+    // Stray continuations and truncated sequences.
+    "[\"\x80\"]",
+    "[\"\xc3\xa9\xa9\"]",
+    "[\"\xc3\"]",
+    "[\"\xe2\x82\"]",
+    "[\"\xf0\x9f\x98\"]",
+    "[\"a\"]\xe2\x82",
+    "[1]\xc3",
+  };
+
+  for(const auto src: accepted)
+    check(isAccepted(src), ("accept " + toPrintable(src)).c_str());
+  for(const auto src: rejected)
+    check(!isAccepted(src), ("reject " + toPrintable(src)).c_str());
+
+  // A sequence cut by the block boundary and a document that ends on
+  // one within a sequence.
+  for(u64 at = 58u; at < 66u; ++at) {
+    Str good = "[\"" + Str(at, 'a') + "\xf0\x9f\x98\x80\"]";
+    check(isAccepted(good), "sequence across blocks");
+
+    Str bad = "[\"" + Str(at, 'a') + "\xf0\x9f\x98\"]";
+    check(!isAccepted(bad), "truncated sequence across blocks");
+  }
+
+  Str end = "[\"" + Str(Json::BlockSize - 5u, 'a') + "\"]\xe2";
+  check(!isAccepted(end), "truncated sequence at the end");
+}
+
+static void testUtf8Kernels()
+{
+  struct Tier {
+    const char*  name;
+    Json::Utf8Fn fn;
+  };
+
+  Arr<Tier> tiers;
+#ifdef VD_ARCH_X64
+  if(getCpuFeatures().avx2)
+    tiers.push_back({"AVX2", &Json::checkUtf8AVX2});
+#endif
+  if(tiers.empty()) {
+    std::printf("No SIMD UTF-8 check on this CPU\n");
+    return;
+  }
+
+  std::mt19937 rng(1234u);
+  const auto   random = [&rng](u32 range) {
+    return toU32(rng() % range);
+  };
+
+  // Code points from every sequence length and the edges of the
+  // ranges.
+  const u32 edges[] = {0x7fu,   0x80u,    0x7ffu,   0x800u,
+                       0xd7ffu, 0xe000u,  0xfffdu,  0xffffu,
+                       0x10000u, 0x10ffffu, 0x1f600u, 0xe9u};
+  const auto randomCodePoint = [&]() {
+    switch(random(5u)) {
+      case 0u: return 0x20u + random(0x5fu);
+      case 1u: return 0x80u + random(0x780u);
+      case 2u: {
+        const u32 code = 0x800u + random(0xf800u);
+        return code >= 0xd800u && code < 0xe000u ? 0xe9u : code;
+      }
+      case 3u: return 0x10000u + random(0x100000u);
+      default: return edges[random(toU32(std::size(edges)))];
+    }
+  };
+
+  for(const auto& tier: tiers) {
+    u32 mismatches = 0u;
+    u32 invalid    = 0u;
+
+    for(u32 run = 0u; run < 20000u; ++run) {
+      Arr<u8>   src;
+      const u32 count = 1u + random(80u);
+      for(u32 idx = 0u; idx < count; ++idx)
+        appendCodePoint(src, randomCodePoint());
+
+      // Valid as generated, then broken a few bytes at a time.
+      const u32 mutations = run % 4u;
+      for(u32 idx = 0u; idx < mutations && !src.empty(); ++idx) {
+        const u64 at   = random(toU32(src.size()));
+        const u8  byte = toU8(rng());
+        switch(random(3u)) {
+          case 0u: src[at] = byte; break;
+          case 1u: src.insert(src.begin() + toI64(at), byte); break;
+          default: src.resize(at); break;
+        }
+      }
+
+      const bool expected = isValidUtf8(&Json::checkUtf8Scalar, src);
+      const bool actual   = isValidUtf8(tier.fn, src);
+      if(!expected) ++invalid;
+      if(mutations == 0u && !expected) ++mismatches;
+      if(actual != expected) ++mismatches;
+    }
+
+    std::printf(
+      "%s: %u invalid of 20000 sequences\n", tier.name, invalid);
+    check(mismatches == 0u, tier.name);
+  }
+}
+
+int main()
+{
+  testDocuments();
+  testUtf8Kernels();
+
+  std::printf("%u/%u checks pass\n", s_checks - s_failures, s_checks);
+  return s_failures == 0u ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+#include "api/PngUnfilter.hpp"
+
+#include <cstdio>
+#include <random>
+
+using namespace vd;
+
+// Compares the SIMD unfilter kernels of every instruction set the CPU
+// has with the scalar ones, byte for byte, on random scanlines. The
+// bytes past the end of the scanline must be left untouched.
+
+static constexpr u32 BytesPerPixel[] = {1u, 2u, 3u, 4u, 6u, 8u};
+static constexpr u32 GuardSize       = 32u;
+static constexpr u8  GuardValue      = 0xcdu;
+
+struct Tier {
+  const char* name;
+  CpuFeatures cpu;
+};
+
+static Arr<Tier> GetTiers()
+{
+  const auto& cpu = getCpuFeatures();
+
+  Arr<Tier> ret;
+  if(!cpu.sse2) return ret;
+
+  CpuFeatures features;
+  features.sse2 = true;
+  ret.push_back({"SSE2", features});
+
+  if(!cpu.ssse3) return ret;
+  features.ssse3 = true;
+  ret.push_back({"SSSE3", features});
+
+  if(!cpu.avx2) return ret;
+  features.avx2 = true;
+  ret.push_back({"AVX2", features});
+
+  return ret;
+}
+
+static Arr<u32> GetWidths()
+{
+  Arr<u32> ret;
+  for(u32 width = 1u; width <= 70u; ++width) ret.push_back(width);
+  for(u32 width: {127u, 128u, 129u, 255u, 1001u, 2048u})
+    ret.push_back(width);
+  return ret;
+}
+
+int main()
+{
+  const PngUnfilterTable scalar(CpuFeatures{});
+
+  auto tiers = GetTiers();
+  if(tiers.empty()) {
+    std::printf("No SIMD kernels on this CPU\n");
+    return 0;
+  }
+
+  std::mt19937 rng(1234u);
+  const auto   random = [&rng](Arr<u8>& bytes) {
+    for(auto& byte: bytes) byte = toU8(rng());
+  };
+
+  u32 failures = 0u;
+  u32 checks   = 0u;
+
+  for(const auto& tier: tiers) {
+    const PngUnfilterTable simd(tier.cpu);
+
+    for(u32 filter = 1u; filter <= 4u; ++filter) {
+      for(u32 bpp: BytesPerPixel) {
+        for(u32 width: GetWidths()) {
+          u32 size = width * bpp;
+
+          Arr<u8> src(size), prev(size);
+          random(src);
+          random(prev);
+
+          // The first row is unfiltered against zeros.
+          for(bool firstRow: {false, true}) {
+            if(firstRow) std::fill(prev.begin(), prev.end(), 0u);
+
+            Arr<u8> expected(size + GuardSize, GuardValue);
+            Arr<u8> actual(size + GuardSize, GuardValue);
+
+            scalar.Get(filter, bpp)(
+              expected.data(), src.data(), prev.data(), size);
+            simd.Get(filter, bpp)(
+              actual.data(), src.data(), prev.data(), size);
+
+            ++checks;
+            if(actual != expected) {
+              ++failures;
+              std::printf(
+                "%s: filter %u, %u bytes per pixel, width %u%s: "
+                "mismatch\n",
+                tier.name, filter, bpp, width,
+                firstRow ? ", first row" : "");
+            }
+          }
+        }
+      }
+    }
+  }
+
+  std::printf("%u/%u scanlines match\n", checks - failures, checks);
+  return failures == 0u ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+#include "vuldir/DataReader.hpp"
+#include "vuldir/DataWriter.hpp"
+
+#include <cstdio>
+#include <random>
+
+using namespace vd;
+
+// Writes images with DataWriter at every compression level and reads
+// them back with DataReader, checksums verified. The texels must come
+// back as they were written, in the format the reader decodes to.
+
+static u32 s_failures = 0u;
+static u32 s_checks   = 0u;
+
+static void check(bool condition, const char* what)
+{
+  ++s_checks;
+  if(!condition) {
+    ++s_failures;
+    std::printf("%s: failed\n", what);
+  }
+}
+
+struct Case {
+  const char* name;
+  Format      format;
+  Format      readFormat;
+  u32         channels;
+  u32         channelSize;
+  bool        bgr;
+};
+
+static constexpr Case Cases[] = {
+  {"R8", Format::R8_UNORM, Format::R8_UNORM, 1u, 1u, false},
+  {"R16", Format::R16_UNORM, Format::R16_UNORM, 1u, 2u, false},
+  {"RGBA8", Format::R8G8B8A8_UNORM, Format::R8G8B8A8_UNORM, 4u, 1u,
+   false},
+  {"BGRA8", Format::B8G8R8A8_UNORM, Format::R8G8B8A8_UNORM, 4u, 1u,
+   true},
+  {"RGBA16", Format::R16G16B16A16_UNORM, Format::R16G16B16A16_UNORM,
+   4u, 2u, false},
+};
+
+// Runs, gradients and noise, so every filter and the match search
+// have something to do.
+static Arr<u8> makeTexels(UInt2 size, u64 rowPitch, std::mt19937& rng)
+{
+  Arr<u8> ret(rowPitch * size[1], 0xcdu);
+  for(u32 y = 0u; y < size[1]; ++y) {
+    u8* row = ret.data() + y * rowPitch;
+    for(u32 x = 0u; x < rowPitch; ++x) {
+      switch((y / 4u) % 3u) {
+        case 0u: row[x] = toU8(x / 16u); break;
+        case 1u: row[x] = toU8(x + y); break;
+        default: row[x] = toU8(rng()); break;
+      }
+    }
+  }
+  return ret;
+}
+
+// The texel as the reader returns it, from the written one.
+static u64 expectedChannel(
+  const Case& test, const u8* texel, u32 channel, bool ignoreAlpha)
+{
+  if(channel == 3u && ignoreAlpha)
+    return test.channelSize == 2u ? 0xffffu : 0xffu;
+
+  u32 from = channel;
+  if(test.bgr && channel != 3u) from = 2u - channel;
+
+  if(test.channelSize == 2u) {
+    u16 value;
+    memcpy(&value, texel + from * 2u, sizeof(value));
+    return value;
+  }
+  return texel[from];
+}
+
+static u64 readChannel(const Case& test, const u8* texel, u32 channel)
+{
+  if(test.channelSize == 2u) {
+    u16 value;
+    memcpy(&value, texel + channel * 2u, sizeof(value));
+    return value;
+  }
+  return texel[channel];
+}
+
+static bool roundTrip(
+  const Case& test, UInt2 size, u64 padding, u32 level,
+  bool ignoreAlpha, std::mt19937& rng)
+{
+  const u64 texelSize = test.channels * test.channelSize;
+  const u64 rowPitch  = size[0] * texelSize + padding;
+  const auto texels   = makeTexels(size, rowPitch, rng);
+
+  DataWriter::ImageSource src;
+  src.format   = test.format;
+  src.size     = size;
+  src.texels   = {texels.data(), texels.size()};
+  src.rowPitch = padding ? rowPitch : 0u;
+
+  DataWriter writer;
+  const auto png = writer.WriteImage(src, {level, ignoreAlpha});
+
+  DataReader::ImageOptions options;
+  options.verifyChecksums = true;
+
+  DataReader reader;
+  const auto image =
+    reader.ReadImage({png.data(), png.size()}, options);
+
+  if(
+    image.format != test.readFormat || image.size[0] != size[0] ||
+    image.size[1] != size[1])
+    return false;
+
+  const u64 readSize = getFormatSize(image.format);
+  for(u32 y = 0u; y < size[1]; ++y) {
+    for(u32 x = 0u; x < size[0]; ++x) {
+      const u8* written = texels.data() + y * rowPitch + x * texelSize;
+      const u8* read =
+        image.texels.data() + (toU64(y) * size[0] + x) * readSize;
+
+      for(u32 channel = 0u; channel < test.channels; ++channel)
+        if(
+          readChannel(test, read, channel) !=
+          expectedChannel(test, written, channel, ignoreAlpha))
+          return false;
+    }
+  }
+  return true;
+}
+
+// Inserts a tRNS chunk right after the header chunk.
+static Arr<u8> addTransparency(const Arr<u8>& png, const Arr<u16>& key)
+{
+  constexpr u64 HeaderEnd = 8u + 12u + 13u;
+
+  const auto appendU32 = [](Arr<u8>& dst, u32 value) {
+    for(u32 shift: {24u, 16u, 8u, 0u})
+      dst.push_back(toU8(value >> shift));
+  };
+
+  Arr<u8> chunk;
+  appendU32(chunk, toU32(key.size() * 2u));
+  appendU32(chunk, fourCC("tRNS"));
+  for(const u16 value: key) {
+    chunk.push_back(toU8(value >> 8u));
+    chunk.push_back(toU8(value));
+  }
+  appendU32(chunk, crc32({chunk.data() + 4u, chunk.size() - 4u}));
+
+  Arr<u8> ret(png.begin(), png.begin() + HeaderEnd);
+  ret.insert(ret.end(), chunk.begin(), chunk.end());
+  ret.insert(ret.end(), png.begin() + HeaderEnd, png.end());
+  return ret;
+}
+
+// Grayscale and color images with a color key decode to RGBA, the
+// texels matching the key being transparent.
+static void testColorKey()
+{
+  DataWriter writer;
+  DataReader reader;
+
+  DataReader::ImageOptions options;
+  options.verifyChecksums = true;
+
+  const auto readKeyed = [&](
+                           const DataWriter::ImageSource& src,
+                           bool ignoreAlpha, const Arr<u16>& key) {
+    const auto png =
+      addTransparency(writer.WriteImage(src, {6u, ignoreAlpha}), key);
+    return reader.ReadImage({png.data(), png.size()}, options);
+  };
+
+  const u8 gray[] = {5u, 9u, 5u};
+  auto     image  = readKeyed(
+    {Format::R8_UNORM, {3u, 1u}, {gray, sizeof(gray)}}, false, {5u});
+  const u8 grayKeyed[] = {
+    5u, 5u, 5u, 0u, 9u, 9u, 9u, 255u, 5u, 5u, 5u, 0u};
+  check(
+    image.format == Format::R8G8B8A8_UNORM &&
+      image.texels.size() == sizeof(grayKeyed) &&
+      memcmp(image.texels.data(), grayKeyed, sizeof(grayKeyed)) == 0,
+    "grayscale color key");
+
+  const u16 gray16[] = {0x1234u, 0x5678u};
+  image              = readKeyed(
+    {Format::R16_UNORM,
+     {2u, 1u},
+     {reinterpret_cast<const u8*>(gray16), sizeof(gray16)}},
+    false, {0x5678u});
+  const u16 gray16Keyed[] = {0x1234u, 0x1234u, 0x1234u, 0xffffu,
+                             0x5678u, 0x5678u, 0x5678u, 0u};
+  check(
+    image.format == Format::R16G16B16A16_UNORM &&
+      image.texels.size() == sizeof(gray16Keyed) &&
+      memcmp(image.texels.data(), gray16Keyed, sizeof(gray16Keyed)) ==
+        0,
+    "16-bit grayscale color key");
+
+  // Color keys match all three channels.
+  const u8 color[] = {1u, 2u, 3u, 7u, 1u, 2u, 4u, 7u};
+  image            = readKeyed(
+    {Format::R8G8B8A8_UNORM, {2u, 1u}, {color, sizeof(color)}}, true,
+    {1u, 2u, 3u});
+  const u8 colorKeyed[] = {1u, 2u, 3u, 0u, 1u, 2u, 4u, 255u};
+  check(
+    image.texels.size() == sizeof(colorKeyed) &&
+      memcmp(image.texels.data(), colorKeyed, sizeof(colorKeyed)) == 0,
+    "color key");
+
+  const u16 color16[] = {1u, 2u, 3u, 7u, 1u, 2u, 4u, 7u};
+  image               = readKeyed(
+    {Format::R16G16B16A16_UNORM,
+     {2u, 1u},
+     {reinterpret_cast<const u8*>(color16), sizeof(color16)}},
+    true, {1u, 2u, 4u});
+  const u16 color16Keyed[] = {1u, 2u, 3u, 0xffffu, 1u, 2u, 4u, 0u};
+  check(
+    image.texels.size() == sizeof(color16Keyed) &&
+      memcmp(image.texels.data(), color16Keyed, sizeof(color16Keyed)) ==
+        0,
+    "16-bit color key");
+
+  // Images with an alpha channel ignore the chunk.
+  image = readKeyed(
+    {Format::R8G8B8A8_UNORM, {2u, 1u}, {color, sizeof(color)}}, false,
+    {1u, 2u, 3u});
+  check(
+    image.format == Format::R8G8B8A8_UNORM &&
+      memcmp(image.texels.data(), color, sizeof(color)) == 0,
+    "color key with alpha ignored");
+}
+
+int main()
+{
+  std::mt19937 rng(1234u);
+
+  const UInt2 sizes[] = {{1u, 1u}, {3u, 2u}, {37u, 29u}, {256u, 64u}};
+
+  for(const auto& test: Cases) {
+    for(u32 level = 0u; level < 10u; ++level) {
+      u32 failed = 0u;
+      for(const auto size: sizes) {
+        for(const u64 padding: {0u, 13u}) {
+          if(!roundTrip(test, size, padding, level, false, rng))
+            ++failed;
+          if(
+            test.channels == 4u &&
+            !roundTrip(test, size, padding, level, true, rng))
+            ++failed;
+        }
+      }
+
+      char what[64];
+      std::snprintf(
+        what, sizeof(what), "%s level %u", test.name, level);
+      check(failed == 0u, what);
+    }
+  }
+
+  // Stored data over 1 MiB is split in several chunks.
+  check(
+    roundTrip(Cases[2], {1024u, 300u}, 0u, 0u, false, rng),
+    "several data chunks");
+  check(
+    roundTrip(Cases[2], {1024u, 300u}, 0u, 6u, false, rng),
+    "large image");
+
+  // Float images are linear, written as 8-bit sRGB.
+  const f32 linear[] = {
+    0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f};
+  DataWriter::ImageSource src;
+  src.format = Format::R32G32B32A32_SFLOAT;
+  src.size   = {2u, 1u};
+  src.texels = {reinterpret_cast<const u8*>(linear), sizeof(linear)};
+
+  DataWriter writer;
+  DataReader reader;
+  const auto png   = writer.WriteImage(src, {});
+  const auto image = reader.ReadImage({png.data(), png.size()}, {});
+  const u8   expected[] = {0u, 255u, 0u, 255u, 255u, 0u, 255u, 0u};
+  check(
+    image.texels.size() == sizeof(expected) &&
+      memcmp(image.texels.data(), expected, sizeof(expected)) == 0,
+    "float to sRGB");
+
+  const auto throws = [&](
+                        const DataWriter::ImageSource& bad, u32 level) {
+    try {
+      (void)writer.WriteImage(bad, {level, false});
+    } catch(const std::exception&) {
+      return true;
+    }
+    return false;
+  };
+
+  auto small = src;
+  small.texels = {small.texels.data(), small.texels.size() - 1u};
+  check(throws(small, 1u), "source too small throws");
+  check(throws(src, 10u), "bad level throws");
+
+  testColorKey();
+
+  std::printf("%u/%u checks pass\n", s_checks - s_failures, s_checks);
+  return s_failures == 0u ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#include "vuldir/DataReader.hpp"
+
+#include <cstdio>
+
+using namespace vd;
+
+// Reads a glTF with embedded and external buffers and an external
+// image through the two kinds of uri filter, and checks what they are
+// asked about and what is skipped.
+
+static u32 s_failures = 0u;
+static u32 s_checks   = 0u;
+
+static void check(bool condition, const char* what)
+{
+  ++s_checks;
+  if(!condition) {
+    ++s_failures;
+    std::printf("%s: failed\n", what);
+  }
+}
+
+static constexpr Strv EmbeddedUri =
+  "data:application/octet-stream;base64,AAAA";
+
+static constexpr Strv Gltf = R"({
+  "asset": {"version": "2.0"},
+  "buffers": [
+    {"byteLength": 3,
+     "uri": "data:application/octet-stream;base64,AAAA"},
+    {"byteLength": 5, "uri": "mesh.bin"},
+    {"byteLength": 7, "uri": "other.bin"}],
+  "images": [{"uri": "color.png"}]})";
+
+struct Asked {
+  Str                   uri;
+  DataReader::AssetKind kind;
+};
+
+static data::Model readModel(const DataReader::Desc& desc)
+{
+  auto readerDesc       = desc;
+  readerDesc.fileReader = [](const fs::path& path, const fs::path*) {
+    return Arr<u8>(path == "mesh.bin" ? 5u : 7u, 0u);
+  };
+
+  DataReader::ModelOptions options;
+  options.basePath = "base";
+
+  DataReader reader(readerDesc);
+  return reader.ReadModel(
+    {reinterpret_cast<const u8*>(Gltf.data()), Gltf.size()}, options);
+}
+
+int main()
+{
+  const Str meshPath  = pathToStr(fs::path("base") / "mesh.bin");
+  const Str otherPath = pathToStr(fs::path("base") / "other.bin");
+  const Str imagePath = pathToStr(fs::path("base") / "color.png");
+
+  // Filters that only take the uri still work.
+  Arr<Str>         plain;
+  DataReader::Desc desc;
+  desc.uriFilter = [&](Strv uri) {
+    plain.emplace_back(uri);
+    return uri != otherPath && uri != imagePath;
+  };
+
+  auto model = readModel(desc);
+  check(
+    plain.size() == 4u && plain[0] == EmbeddedUri &&
+      plain[1] == meshPath && plain[2] == otherPath &&
+      plain[3] == imagePath,
+    "plain filter asked about every asset");
+  check(
+    model.buffers.size() == 3u && model.buffers[0].data.size() == 3u &&
+      model.buffers[1].data.size() == 5u &&
+      model.buffers[2].data.empty() &&
+      model.buffers[2].uri == otherPath,
+    "plain filter skips buffers in place");
+  check(
+    model.images.size() == 1u && model.images[0].texels.empty() &&
+      model.images[0].uri == imagePath,
+    "plain filter skips images");
+
+  // The kind filter is used instead when both are set.
+  Arr<Asked> asked;
+  desc.uriFilterByKind = [&](Strv uri, DataReader::AssetKind kind) {
+    asked.push_back({Str(uri), kind});
+    return kind == DataReader::AssetKind::Buffer;
+  };
+  plain.clear();
+
+  model = readModel(desc);
+  check(plain.empty(), "kind filter replaces the plain one");
+  check(
+    asked.size() == 4u &&
+      asked[0].kind == DataReader::AssetKind::Buffer &&
+      asked[2].uri == otherPath &&
+      asked[3].kind == DataReader::AssetKind::Image &&
+      asked[3].uri == imagePath,
+    "kind filter asked with the kind");
+  check(
+    model.buffers[2].data.size() == 7u &&
+      model.images[0].texels.empty(),
+    "kind filter skips by kind");
+
+  std::printf("%u/%u checks pass\n", s_checks - s_failures, s_checks);
+  return s_failures == 0u ? 0 : 1;
+}
@@ -0,0 +1,593 @@
+#include "vuldir/DataReader.hpp"
+
+#include <cstdio>
+
+using namespace vd;
+
+// Decodes frames made by the reference encoder, zstd 1.5.6, through
+// KTX2 files with Zstandard supercompression. The frames cover raw,
+// RLE and compressed blocks, several blocks per frame, checksums and
+// frames without a content size. The contents are made again here and
+// must match byte for byte.
+
+static u32 s_failures = 0u;
+static u32 s_checks   = 0u;
+
+static void check(bool condition, const char* what)
+{
+  ++s_checks;
+  if(!condition) {
+    ++s_failures;
+    std::printf("%s: failed\n", what);
+  }
+}
+
+// The contents of the frames, written to files and compressed with
+// the zstd command line tool as noted above each frame.
+class Lcg
+{
+public:
+  Lcg(u32 seed): m_state{seed} {}
+
+  u32 Next()
+  {
+    m_state = m_state * 1103515245u + 12345u;
+    return m_state >> 16;
+  }
+
+private:
+  u32 m_state;
+};
+
+static Arr<u8> text(u64 size, u32 seed)
+{
+  static constexpr Strv Words[] = {
+    "the ",  "quick ", "brown ", "fox ", "jumps ", "over ",
+    "lazy ", "dog ",   "and ",   "runs ", "away ", "\n"};
+
+  Lcg     lcg(seed);
+  Arr<u8> ret;
+  while(ret.size() < size) {
+    const auto word = Words[lcg.Next() % std::size(Words)];
+    ret.insert(ret.end(), word.begin(), word.end());
+  }
+  ret.resize(size);
+  return ret;
+}
+
+static Arr<u8> noise(u64 size, u32 seed)
+{
+  Lcg     lcg(seed);
+  Arr<u8> ret(size);
+  for(auto& value: ret) value = toU8(lcg.Next() & 0xffu);
+  return ret;
+}
+
+static Arr<u8> solid(u64 size, u32 seed)
+{
+  return Arr<u8>(size, toU8(seed));
+}
+
+// Copies of a text, each with a byte changed. The value is drawn
+// before the position.
+static Arr<u8> repeats(u64 size, u32 seed)
+{
+  Lcg        lcg(seed);
+  const auto chunk = text(1500u, seed + 1u);
+
+  Arr<u8> ret;
+  while(ret.size() < size) {
+    const u64 offset = ret.size();
+    ret.insert(ret.end(), chunk.begin(), chunk.end());
+    const u8 value                   = toU8(lcg.Next() & 0xffu);
+    ret[offset + lcg.Next() % 1500u] = value;
+  }
+  ret.resize(size);
+  return ret;
+}
+
+// text(2048u, 1u), zstd -1 --check, 583 bytes.
+static const u8 TextFast[] = {
+  0x28, 0xb5, 0x2f, 0xfd, 0x64, 0x00, 0x07, 0xcd, 0x11, 0x00, 0x52,
+  0x89, 0x1a, 0x18, 0xa0, 0xa5, 0xe9, 0xb4, 0xc9, 0xdf, 0x6d, 0xfd,
+  0x49, 0x4a, 0xf2, 0xb6, 0xd9, 0xbd, 0xa5, 0x4c, 0x96, 0xff, 0xff,
+  0x5f, 0xfe, 0xc0, 0x33, 0x04, 0x47, 0x41, 0xa0, 0xa1, 0xca, 0xdd,
+  0x96, 0xbb, 0x4e, 0xa7, 0x39, 0xed, 0xcc, 0x69, 0x5b, 0xe5, 0x76,
+  0x5a, 0x5b, 0xee, 0xa6, 0x63, 0x3a, 0x3a, 0xcf, 0x1c, 0xa7, 0xa5,
+  0xe3, 0x99, 0x53, 0x67, 0x4e, 0xcf, 0x9c, 0x74, 0x4c, 0x47, 0xa7,
+  0x9d, 0x39, 0xe5, 0x3e, 0x0a, 0x02, 0x0d, 0xe9, 0xd8, 0xc4, 0x10,
+  0x6b, 0xb9, 0xcb, 0x38, 0x81, 0x97, 0xd3, 0xea, 0xcc, 0x69, 0x15,
+  0x06, 0x04, 0x14, 0xe0, 0xb4, 0x56, 0xb9, 0xd3, 0xb1, 0x8e, 0x44,
+  0x46, 0x25, 0x03, 0x06, 0x50, 0x89, 0xdc, 0x10, 0x04, 0x81, 0x1b,
+  0xa8, 0x51, 0x8f, 0x4a, 0x0a, 0x7b, 0x8d, 0x01, 0x21, 0x04, 0x08,
+  0x08, 0xf2, 0x34, 0x95, 0x1d, 0x11, 0x20, 0x5c, 0x93, 0x8c, 0x4c,
+  0x92, 0x34, 0x06, 0x48, 0x77, 0xd5, 0x59, 0x2e, 0x42, 0x34, 0x1f,
+  0xf7, 0x1f, 0x2a, 0x0e, 0x8e, 0x64, 0x84, 0x34, 0xc9, 0x08, 0x21,
+  0x4f, 0xa7, 0x10, 0x75, 0xc1, 0x3a, 0xd8, 0x51, 0x95, 0x67, 0x29,
+  0xbc, 0x10, 0x3b, 0xff, 0xde, 0xf8, 0xd2, 0xfa, 0x0d, 0x99, 0x36,
+  0x5a, 0x7a, 0xbd, 0xd0, 0x96, 0x1b, 0x4c, 0x92, 0xf3, 0xdd, 0xc7,
+  0x22, 0x04, 0xaa, 0x4d, 0x13, 0x1a, 0x25, 0x95, 0x30, 0x72, 0x39,
+  0x90, 0xf1, 0x7c, 0x29, 0xff, 0x9b, 0x20, 0x2b, 0x94, 0xe7, 0x88,
+  0xe8, 0x78, 0xc6, 0x65, 0xec, 0x3d, 0x74, 0xc9, 0x2a, 0xee, 0x21,
+  0x80, 0xf0, 0x95, 0x07, 0x1b, 0x7d, 0x16, 0x43, 0x7a, 0xa6, 0x0e,
+  0xf8, 0xb5, 0x84, 0x48, 0xb8, 0xaf, 0xf7, 0x89, 0x01, 0x10, 0xcd,
+  0xaf, 0xb5, 0x78, 0x22, 0x9f, 0x24, 0xac, 0xe7, 0x25, 0xcb, 0x75,
+  0x80, 0xd0, 0xef, 0x76, 0x94, 0x64, 0x52, 0xf3, 0x8a, 0xa1, 0xc2,
+  0xb5, 0xf3, 0xe2, 0x08, 0xb4, 0x7d, 0xb9, 0xd0, 0xc4, 0x44, 0x25,
+  0x0f, 0xd5, 0xbd, 0x5f, 0xfa, 0x4b, 0x15, 0xd4, 0x58, 0x8e, 0x4e,
+  0x94, 0xbe, 0xc9, 0x59, 0xc6, 0x52, 0x83, 0x85, 0xd1, 0xcb, 0x4c,
+  0x33, 0xdf, 0x52, 0x9d, 0xe1, 0x5a, 0x00, 0x10, 0x1b, 0xa9, 0x40,
+  0xb2, 0x35, 0xc3, 0xc9, 0x1e, 0x30, 0xa2, 0xf8, 0x2a, 0xc1, 0x7a,
+  0x07, 0xff, 0xe9, 0xc7, 0xb8, 0x3d, 0xe2, 0x23, 0xb2, 0x10, 0xa5,
+  0x55, 0x83, 0xea, 0x41, 0x4c, 0x63, 0xf6, 0x35, 0xbe, 0xf3, 0x64,
+  0xcc, 0x79, 0xad, 0x44, 0x53, 0x40, 0x03, 0x58, 0xce, 0x27, 0x78,
+  0x80, 0x0b, 0x95, 0x52, 0x2e, 0xd9, 0x2e, 0xf4, 0x5c, 0x13, 0xf9,
+  0x02, 0x8a, 0x0e, 0xe3, 0x83, 0xee, 0xf8, 0xb1, 0xba, 0x65, 0x9e,
+  0xbf, 0xc0, 0x87, 0xf9, 0xce, 0xdc, 0x0e, 0xb2, 0x41, 0x8c, 0xc4,
+  0x6a, 0x07, 0xd3, 0xee, 0x4c, 0x4f, 0xf2, 0x9d, 0x1a, 0x67, 0x94,
+  0xc3, 0x4e, 0x0f, 0x9e, 0x20, 0x19, 0x45, 0x67, 0x5c, 0x06, 0x3d,
+  0x6e, 0xc0, 0x98, 0x46, 0xa0, 0x59, 0xeb, 0x5a, 0x89, 0x42, 0x2a,
+  0x6c, 0xd7, 0x8f, 0xbc, 0xc4, 0x00, 0x7d, 0x5c, 0x02, 0xb7, 0x0c,
+  0xd5, 0xce, 0x32, 0x0c, 0x1a, 0xb9, 0x9e, 0xf7, 0x96, 0x93, 0xfc,
+  0x1a, 0x71, 0x0f, 0x4a, 0x72, 0x65, 0x79, 0x0e, 0x7f, 0x3c, 0x67,
+  0x1c, 0x64, 0x2a, 0xe1, 0xcf, 0x13, 0x48, 0x73, 0x80, 0x91, 0xa0,
+  0x0b, 0xc4, 0x7f, 0xa9, 0xe9, 0xe8, 0x13, 0xb8, 0x29, 0xab, 0xd5,
+  0xe7, 0x4e, 0x0e, 0x62, 0x04, 0xcb, 0xa5, 0x9d, 0x2b, 0x36, 0x19,
+  0xd2, 0xba, 0x1e, 0xcc, 0x55, 0xa5, 0x5a, 0x9a, 0xf6, 0x48, 0xb8,
+  0x96, 0x44, 0xb6, 0xa7, 0x90, 0x78, 0xf5, 0x9d, 0x24, 0x12, 0xbf,
+  0x57, 0xdd, 0x82, 0x91, 0xd9, 0x7e, 0x24, 0xd7, 0x17, 0x40, 0x59,
+  0xc7, 0xc4, 0xb7, 0x0d, 0xdf, 0x18, 0x24, 0x30, 0x4e, 0xcf, 0xaf,
+  0xdc, 0x53, 0x6e, 0xcc, 0x42, 0x35, 0x65, 0x28, 0x19, 0xb1, 0x93,
+  0xc2, 0xf9, 0x03, 0xde, 0x82, 0x7e, 0x98, 0x54, 0xe1, 0x11, 0x42,
+  0x89, 0x9d, 0x9a, 0x94, 0x4f, 0x6a, 0x01, 0xc4, 0x9f, 0xf9, 0x15,
+  0x71, 0xe9, 0x6b, 0xd3, 0xaf, 0xab, 0x1a, 0xf4, 0x4a, 0x63, 0x20
+};
+
+// text(2048u, 2u), zstd -19 --no-check, 465 bytes.
+static const u8 TextBest[] = {
+  0x28, 0xb5, 0x2f, 0xfd, 0x60, 0x00, 0x07, 0x3d, 0x0e, 0x00, 0x02,
+  0xc4, 0x0d, 0x12, 0x90, 0xcf, 0x01, 0x60, 0x83, 0x0d, 0x36, 0xd8,
+  0x60, 0x83, 0xd1, 0xff, 0xff, 0x8f, 0xba, 0xf3, 0x96, 0x0a, 0xff,
+  0xff, 0xff, 0x6f, 0xd6, 0xc5, 0xd0, 0xd7, 0x95, 0x1e, 0x0d, 0xdc,
+  0xb8, 0xd1, 0x38, 0x83, 0xd5, 0x4a, 0x20, 0x0a, 0x9b, 0x9c, 0xf9,
+  0x96, 0x8d, 0xc6, 0xc6, 0xc0, 0x82, 0x77, 0x24, 0xd5, 0xb5, 0x7c,
+  0x8c, 0xa6, 0x80, 0xe9, 0xa8, 0xc1, 0xcf, 0x7e, 0xec, 0x1d, 0x20,
+  0x84, 0x18, 0x84, 0xcc, 0xce, 0x03, 0x11, 0xb0, 0x88, 0x27, 0x20,
+  0x60, 0x92, 0x4b, 0x9b, 0x42, 0x6b, 0xab, 0x28, 0xaa, 0x5d, 0x0a,
+  0x98, 0xe9, 0xbc, 0xfc, 0xef, 0x1d, 0xa7, 0x07, 0x43, 0xa7, 0x93,
+  0x1c, 0x36, 0x93, 0x27, 0xaa, 0xdc, 0x34, 0x0a, 0x1a, 0xea, 0x17,
+  0x29, 0xac, 0xdd, 0x34, 0xdf, 0x96, 0xc0, 0xa7, 0x20, 0x3c, 0x12,
+  0xfa, 0x33, 0xd3, 0x8d, 0xcc, 0x7e, 0x10, 0xf2, 0x30, 0x9a, 0xd8,
+  0x28, 0x54, 0xa2, 0x59, 0x7f, 0x88, 0x34, 0x32, 0xff, 0xa4, 0xff,
+  0x8e, 0xa2, 0xac, 0xa1, 0xa9, 0x75, 0xfa, 0xa9, 0x35, 0x49, 0x21,
+  0xd4, 0x99, 0xf6, 0xfa, 0x64, 0x8d, 0xbe, 0x0b, 0x52, 0x8a, 0x85,
+  0x4a, 0x18, 0x41, 0xd4, 0x2e, 0x68, 0x80, 0x1b, 0x81, 0x64, 0xf3,
+  0x35, 0xfa, 0x28, 0xc3, 0x5c, 0x61, 0xec, 0x95, 0x4f, 0xb0, 0x71,
+  0x66, 0xf1, 0x8d, 0xd4, 0x4f, 0x8b, 0x0e, 0x76, 0x67, 0x91, 0x47,
+  0x4d, 0x88, 0xa5, 0xd4, 0x90, 0x65, 0x47, 0xc1, 0xe6, 0x70, 0xc9,
+  0xfd, 0x02, 0x1a, 0xf9, 0x46, 0xb5, 0x07, 0x51, 0x2b, 0x71, 0x9e,
+  0x05, 0x78, 0xd3, 0xfe, 0x0e, 0xca, 0x52, 0xf4, 0x6e, 0xf4, 0x02,
+  0xa9, 0xcb, 0xd4, 0xff, 0x93, 0x0f, 0x18, 0xa5, 0xb2, 0x04, 0x3e,
+  0x81, 0x12, 0xd4, 0x2c, 0x26, 0x40, 0xc2, 0xb1, 0x2d, 0x1e, 0xfd,
+  0x4a, 0x92, 0x66, 0xce, 0xc3, 0x04, 0x44, 0xf0, 0xae, 0xa4, 0xf4,
+  0x72, 0x26, 0x56, 0x89, 0x38, 0xd2, 0x2c, 0x2c, 0x25, 0x18, 0x06,
+  0x2a, 0xc8, 0xcc, 0x35, 0x16, 0xc2, 0x59, 0xb0, 0xc7, 0x45, 0xbb,
+  0x20, 0x8c, 0xa5, 0xba, 0x09, 0x67, 0xe7, 0x7b, 0x58, 0x41, 0x71,
+  0xfe, 0x19, 0xa7, 0x51, 0xff, 0xc7, 0xcc, 0x35, 0x2b, 0xf8, 0x87,
+  0x16, 0x38, 0xad, 0xc0, 0xa9, 0xe0, 0x4d, 0x02, 0xc3, 0x0e, 0x83,
+  0x4f, 0xfb, 0x37, 0x8b, 0x06, 0xed, 0x7d, 0x6e, 0x74, 0x73, 0x6f,
+  0x6e, 0x04, 0x1a, 0xf7, 0x3e, 0x2a, 0x9f, 0x9c, 0x96, 0x1f, 0x5f,
+  0x08, 0x0a, 0xaa, 0xb4, 0xe5, 0x8b, 0x38, 0x3a, 0x12, 0x89, 0x52,
+  0x50, 0x82, 0x3f, 0x49, 0x7f, 0xd5, 0x46, 0x78, 0xa9, 0x0c, 0x5f,
+  0x3d, 0x96, 0x8e, 0xe8, 0x71, 0xc3, 0x1e, 0x8e, 0x10, 0x05, 0x46,
+  0xca, 0x68, 0xd6, 0xe2, 0x8a, 0xf6, 0xb8, 0x7c, 0x36, 0x98, 0x57,
+  0x6f, 0x3d, 0xa8, 0xe7, 0x3c, 0xa4, 0x7a, 0x40, 0xf0, 0x01, 0x14,
+  0xe4, 0xed, 0x17, 0xaa, 0xfb, 0xb4, 0x6f, 0x1d, 0xb3, 0x23, 0xd1,
+  0xe9, 0xf8, 0x82, 0x44, 0x7f, 0xec, 0xd4, 0x12, 0xc6, 0xde, 0x45,
+  0x75, 0x2b, 0xe6, 0x38, 0x38, 0x0a, 0x0e, 0xf7, 0xa5, 0x54, 0xca,
+  0x7d, 0xf3, 0x5f, 0x11, 0xe1, 0x30, 0x8e, 0x16, 0x6d, 0x31, 0x55,
+  0x24, 0x8a, 0x4c, 0x3b, 0x0d, 0x94, 0xa9, 0x6a, 0x74, 0x4f, 0xe4,
+  0x08, 0x11, 0xaa
+};
+
+// noise(256u, 3u), zstd -3, 270 bytes.
+static const u8 Noise[] = {
+  0x28, 0xb5, 0x2f, 0xfd, 0x64, 0x00, 0x00, 0x01, 0x08, 0x00, 0x53,
+  0xc3, 0x7d, 0x78, 0x8e, 0xb4, 0x4d, 0xb7, 0x48, 0x2f, 0x6d, 0x46,
+  0x3d, 0x19, 0xe5, 0x70, 0x24, 0x4c, 0xbb, 0xa0, 0xe3, 0x58, 0xfc,
+  0x78, 0x74, 0xfa, 0x8c, 0xb1, 0x95, 0x5c, 0xaf, 0xb5, 0x32, 0x12,
+  0x53, 0xfe, 0x93, 0xd1, 0x23, 0x2c, 0x45, 0xed, 0x4c, 0xe9, 0xc9,
+  0x99, 0x0d, 0x7d, 0xff, 0xdc, 0x01, 0x30, 0x51, 0x55, 0x2c, 0x63,
+  0xa0, 0xb0, 0xc7, 0x6d, 0xee, 0xe4, 0xcc, 0x36, 0xd0, 0x32, 0x40,
+  0x96, 0x91, 0xdd, 0x43, 0x6b, 0x26, 0xaa, 0xd8, 0x7c, 0xd6, 0x16,
+  0x75, 0x11, 0xa6, 0x5a, 0x4a, 0x4e, 0x86, 0x1f, 0x51, 0x53, 0x3c,
+  0x01, 0x1a, 0x16, 0x14, 0xc6, 0x54, 0xfb, 0x44, 0x5b, 0x1a, 0x38,
+  0x21, 0x92, 0x03, 0xeb, 0x04, 0x9d, 0xe8, 0xf8, 0xfa, 0x4a, 0x73,
+  0xa4, 0x2f, 0xfc, 0x6d, 0xf3, 0x18, 0x6d, 0xc4, 0xc1, 0x62, 0x25,
+  0x5d, 0xa3, 0x9d, 0xb9, 0x9f, 0x7b, 0xa8, 0xc4, 0xbb, 0xdd, 0xdb,
+  0xa7, 0xbd, 0x25, 0xf7, 0x00, 0x54, 0x54, 0xce, 0xeb, 0x61, 0xaf,
+  0xb2, 0xfb, 0x42, 0x16, 0x9f, 0xf7, 0xdb, 0x25, 0x28, 0x54, 0x68,
+  0x0c, 0x22, 0x76, 0x06, 0x2f, 0x12, 0xa7, 0xfa, 0x7c, 0x57, 0xd3,
+  0xc8, 0x90, 0x17, 0x09, 0xf5, 0x89, 0xea, 0xb2, 0x96, 0xa9, 0x49,
+  0x8f, 0xa1, 0xb0, 0xb5, 0x74, 0xf0, 0xf6, 0xa7, 0xc6, 0x14, 0x4a,
+  0x3a, 0xb6, 0xdf, 0x8d, 0x9a, 0x3a, 0xb0, 0x0e, 0x2c, 0xd0, 0x7c,
+  0xa5, 0x7b, 0xf2, 0xa1, 0x8e, 0xe5, 0x58, 0x6b, 0x0b, 0x0a, 0xf0,
+  0x62, 0xb8, 0xf0, 0x9e, 0x59, 0xac, 0xf6, 0xb3, 0x38, 0x54, 0x7f,
+  0x2f, 0x84, 0x10, 0x5a, 0xb7, 0xb3, 0x8a, 0xf3, 0x54, 0x32, 0xdb,
+  0x3b, 0xf1, 0x32, 0x5c, 0x59, 0x93, 0x36, 0x4c, 0x0d, 0x56, 0x5e,
+  0x26, 0xe8, 0x2b, 0x71, 0xc0, 0x2e, 0x53, 0xab, 0x23, 0x86, 0x9a,
+  0x4c, 0x2e, 0x78, 0x4d, 0x7b, 0x3b
+};
+
+// solid(65536u, 7u), zstd -3, 24 bytes.
+static const u8 Solid[] = {
+  0x28, 0xb5, 0x2f, 0xfd, 0x64, 0x00, 0xff, 0x55, 0x00, 0x00, 0x10,
+  0x07, 0x07, 0x01, 0x00, 0xfb, 0x7f, 0x1d, 0x60, 0x01, 0xf5, 0x20,
+  0xdb, 0x67
+};
+
+// repeats(262144u, 4u), zstd -3 --check, 1464 bytes.
+static const u8 Repeats[] = {
+  0x28, 0xb5, 0x2f, 0xfd, 0xa4, 0x00, 0x00, 0x04, 0x00, 0x6c, 0x1e,
+  0x00, 0x32, 0x8f, 0x3a, 0x37, 0x50, 0x75, 0x3a, 0xc0, 0xbb, 0xbb,
+  0xf0, 0xbd, 0x5a, 0x78, 0xdf, 0x2e, 0x4d, 0x3d, 0x05, 0xad, 0xe5,
+  0x40, 0xf5, 0x6e, 0xcd, 0xbb, 0xf6, 0x26, 0x72, 0x53, 0x53, 0xea,
+  0x9d, 0xe4, 0xf6, 0x8c, 0xcc, 0x26, 0x52, 0xf6, 0x5e, 0x5b, 0xb7,
+  0x8a, 0x39, 0x4b, 0xda, 0xad, 0x33, 0x3e, 0x23, 0x30, 0x71, 0x00,
+  0x00, 0x06, 0x3c, 0xa4, 0x03, 0x04, 0xaf, 0xc0, 0xf5, 0x26, 0x16,
+  0xac, 0x3c, 0x6f, 0x05, 0x53, 0x95, 0x04, 0xae, 0xd9, 0x19, 0x0b,
+  0x6f, 0xa2, 0xf0, 0xb8, 0x43, 0xd7, 0x10, 0x64, 0x25, 0x44, 0x1a,
+  0x41, 0x3d, 0x82, 0xf9, 0xf7, 0x00, 0x34, 0x88, 0xb9, 0x88, 0x69,
+  0xe3, 0xf2, 0x70, 0x46, 0xc4, 0x29, 0x8f, 0xf2, 0x5d, 0xdd, 0x25,
+  0x92, 0x06, 0xc4, 0x2b, 0x4b, 0x64, 0xe7, 0x40, 0x8a, 0x63, 0x24,
+  0x7f, 0x34, 0xa6, 0xa7, 0x02, 0x51, 0x27, 0x68, 0xb6, 0x93, 0xe3,
+  0x8c, 0x83, 0x31, 0x03, 0x3a, 0x4d, 0xe4, 0x21, 0xbd, 0xba, 0xba,
+  0x05, 0xfe, 0xc1, 0x09, 0x7f, 0x15, 0x0c, 0x58, 0x26, 0xe1, 0x24,
+  0x2a, 0x99, 0xd2, 0x18, 0xe1, 0x62, 0xfe, 0x0b, 0x6c, 0xca, 0x7d,
+  0xcb, 0x65, 0x6a, 0x3e, 0x8e, 0x50, 0x03, 0xd4, 0x77, 0xad, 0xaf,
+  0x61, 0xf3, 0x60, 0xd9, 0x32, 0x93, 0x89, 0xec, 0x90, 0x05, 0x9f,
+  0x3e, 0x1e, 0x9c, 0x75, 0x9c, 0xf4, 0xd9, 0xdd, 0xdd, 0xdd, 0xdd,
+  0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xcc, 0xe1, 0x87, 0xea, 0xed,
+  0xe4, 0x24, 0xfe, 0xba, 0xca, 0xea, 0x73, 0x44, 0xe5, 0xcf, 0xb8,
+  0x61, 0x5a, 0xda, 0x71, 0xaf, 0x31, 0x07, 0x56, 0xfa, 0x0e, 0x28,
+  0x9b, 0x67, 0xf4, 0x9c, 0x33, 0x87, 0x01, 0x81, 0x75, 0xa8, 0xe1,
+  0x75, 0x92, 0x14, 0xa6, 0x03, 0xe1, 0x05, 0xc4, 0x28, 0xe6, 0x9c,
+  0x79, 0x12, 0x80, 0xe1, 0x68, 0x08, 0xe3, 0x48, 0x8e, 0x41, 0x10,
+  0x02, 0x82, 0x08, 0x8a, 0x90, 0x08, 0x7f, 0x42, 0x04, 0x45, 0x40,
+  0x88, 0x81, 0x0e, 0xfd, 0x02, 0x41, 0x90, 0x8d, 0x9d, 0x17, 0xe0,
+  0x8f, 0xf5, 0x18, 0xab, 0xae, 0x17, 0xf1, 0x67, 0x32, 0xb5, 0x99,
+  0x03, 0xad, 0xd1, 0x2d, 0x59, 0xda, 0xe8, 0x9e, 0x62, 0xfc, 0x8b,
+  0xcd, 0xcd, 0x2a, 0xa5, 0xbc, 0x0a, 0xdd, 0xca, 0x8b, 0xfc, 0xbf,
+  0xf9, 0x9d, 0xb6, 0x9b, 0x7f, 0xdb, 0xb1, 0xfb, 0x96, 0xf7, 0x93,
+  0xee, 0xd6, 0x25, 0xef, 0xc7, 0xf8, 0xd1, 0x9b, 0x9d, 0x8f, 0x5d,
+  0x5a, 0x4a, 0x25, 0xc5, 0xb6, 0xba, 0x42, 0x28, 0xb9, 0x7e, 0xdb,
+  0x59, 0xf2, 0x83, 0xa9, 0xf8, 0x7c, 0x90, 0x51, 0x6c, 0xd8, 0x7d,
+  0x45, 0xbf, 0x91, 0xd7, 0x51, 0x37, 0xab, 0x1d, 0x14, 0xdd, 0xae,
+  0x92, 0xff, 0x7b, 0xaa, 0x30, 0x7f, 0xa7, 0xed, 0x1d, 0x76, 0x47,
+  0x5d, 0xec, 0xae, 0x15, 0x17, 0xbb, 0x57, 0xd8, 0xc9, 0xd6, 0x51,
+  0xe4, 0x1a, 0x49, 0x89, 0x82, 0x6f, 0x93, 0x5e, 0xfd, 0xfd, 0x1e,
+  0xd7, 0x57, 0x65, 0x54, 0x3f, 0xd1, 0x6a, 0xe4, 0xe7, 0x66, 0x77,
+  0xec, 0x3a, 0x8d, 0x9a, 0x53, 0xb9, 0x99, 0x72, 0x1a, 0x7e, 0x44,
+  0x7b, 0x5e, 0xde, 0x6e, 0x4f, 0x4f, 0xe9, 0xb0, 0x6b, 0x3a, 0xd9,
+  0xb0, 0x68, 0x8e, 0x37, 0xac, 0x97, 0x66, 0x69, 0xa5, 0xaf, 0x9a,
+  0x56, 0x65, 0xe3, 0x63, 0x97, 0x0f, 0x6f, 0x03, 0x67, 0xb4, 0xb4,
+  0xbf, 0x27, 0x70, 0x6f, 0x08, 0x2f, 0x51, 0x4f, 0x51, 0xee, 0xc7,
+  0xee, 0xfd, 0xec, 0xb0, 0x23, 0x89, 0x08, 0xf6, 0x33, 0xdb, 0x66,
+  0xd5, 0x72, 0xdf, 0xac, 0xe8, 0xeb, 0xa6, 0xe5, 0x80, 0xa3, 0xe9,
+  0x4a, 0xf1, 0x57, 0x5f, 0x45, 0x1e, 0x76, 0x1b, 0x5c, 0x46, 0x66,
+  0x8a, 0x61, 0x91, 0xe9, 0x2d, 0xb6, 0xbb, 0xb5, 0x4b, 0xdf, 0x3d,
+  0x0f, 0x27, 0x76, 0x73, 0x5c, 0xb5, 0xc5, 0x99, 0x77, 0x99, 0xc7,
+  0x16, 0x37, 0xa9, 0x9b, 0xb1, 0x32, 0xae, 0xf6, 0xc7, 0x21, 0x4c,
+  0x71, 0x95, 0xe8, 0xdf, 0x36, 0x7b, 0xd5, 0x5b, 0x1f, 0x39, 0x5b,
+  0xfd, 0x89, 0x1e, 0x56, 0xc2, 0xed, 0xd6, 0x8c, 0x5d, 0x3a, 0x59,
+  0xb1, 0x2b, 0xfc, 0x39, 0x14, 0x1a, 0xa3, 0x43, 0x91, 0xe7, 0xb6,
+  0x3b, 0xef, 0x19, 0xea, 0x7e, 0xfd, 0xdc, 0xa1, 0xbb, 0x5d, 0x5c,
+  0xdf, 0xef, 0xba, 0x09, 0x2c, 0x88, 0x7b, 0x60, 0x44, 0x81, 0x7a,
+  0x82, 0xc7, 0x6e, 0x16, 0x69, 0xb5, 0xf7, 0xa6, 0xff, 0x2b, 0xc5,
+  0x68, 0xe8, 0xe2, 0xc2, 0x3d, 0x49, 0x0f, 0xa4, 0x3d, 0x8a, 0xc5,
+  0xde, 0x90, 0xa2, 0x46, 0x06, 0x72, 0x3a, 0xcb, 0xfd, 0x9f, 0xd1,
+  0x94, 0x4b, 0x99, 0x80, 0x7e, 0x08, 0xad, 0xa8, 0x94, 0x89, 0x26,
+  0x30, 0x40, 0x96, 0x3a, 0x1d, 0x34, 0x45, 0x4e, 0x4a, 0x24, 0xbf,
+  0xa9, 0x9c, 0xf2, 0x96, 0xd9, 0xf5, 0x33, 0x9e, 0xd1, 0x7d, 0xbc,
+  0x09, 0x79, 0x39, 0xf7, 0x23, 0x3b, 0x4e, 0x39, 0xd9, 0xa4, 0xa6,
+  0x54, 0x62, 0x57, 0x4f, 0xbc, 0x05, 0xe3, 0xce, 0x0c, 0xf9, 0xd0,
+  0xf4, 0xa8, 0xdf, 0x1f, 0xa0, 0xc2, 0x80, 0x1e, 0x81, 0x39, 0x38,
+  0xac, 0xc3, 0x72, 0x9a, 0x03, 0x26, 0x02, 0x8d, 0xf8, 0x8a, 0xc6,
+  0xfe, 0x28, 0x26, 0x7e, 0x86, 0x0c, 0xf7, 0x8f, 0x03, 0xbc, 0x9f,
+  0x7c, 0x58, 0x99, 0x5d, 0xb7, 0x6a, 0x57, 0x6d, 0xce, 0x21, 0x4f,
+  0x9b, 0xbd, 0xfa, 0xa3, 0x16, 0x32, 0xed, 0xfc, 0x0e, 0x40, 0x81,
+  0x0e, 0x73, 0xcb, 0x2f, 0x6d, 0x76, 0xe0, 0x6c, 0x51, 0xc9, 0xbb,
+  0x98, 0x15, 0x22, 0x36, 0x91, 0xc2, 0xd6, 0xa9, 0xa6, 0xa1, 0x63,
+  0x8e, 0x44, 0x8b, 0x26, 0x73, 0x93, 0xaa, 0xdc, 0xcc, 0x9a, 0xb7,
+  0xef, 0x4f, 0xd2, 0xd7, 0x8e, 0xf2, 0x0d, 0x8c, 0x01, 0x28, 0x4f,
+  0x3b, 0xd7, 0xa8, 0x8c, 0x1c, 0xc9, 0x19, 0x36, 0x6e, 0x22, 0x41,
+  0x70, 0x11, 0x64, 0x5a, 0x81, 0x2e, 0xe3, 0x61, 0xae, 0x1d, 0xb2,
+  0x7f, 0xa1, 0x09, 0x7f, 0xff, 0x61, 0x58, 0x44, 0x41, 0xa5, 0xc4,
+  0x79, 0xa6, 0xd2, 0x13, 0xa2, 0xbd, 0x7e, 0x61, 0x0a, 0x51, 0x16,
+  0xbc, 0xeb, 0x78, 0x24, 0x49, 0x3e, 0x52, 0x70, 0xeb, 0xa7, 0x0c,
+  0x79, 0xbc, 0x18, 0x0f, 0x3a, 0x12, 0x7d, 0xbf, 0xb4, 0xf2, 0x61,
+  0x55, 0x19, 0x2e, 0x24, 0x6e, 0x4b, 0x77, 0xf6, 0x19, 0x7a, 0xb0,
+  0x63, 0xba, 0xc8, 0x03, 0xda, 0x28, 0xf4, 0x4b, 0xa2, 0x56, 0xf2,
+  0x00, 0x27, 0xa0, 0xa3, 0x0a, 0x4a, 0x8d, 0xe3, 0xac, 0x2b, 0x21,
+  0xae, 0x63, 0x6c, 0x28, 0xac, 0xeb, 0xdc, 0x24, 0x9c, 0x7c, 0x25,
+  0x86, 0x00, 0x08, 0x91, 0xf2, 0xe9, 0x40, 0x12, 0x0d, 0x38, 0xa2,
+  0xf2, 0x4c, 0xfa, 0x99, 0x11, 0x84, 0x75, 0x84, 0x32, 0xdb, 0xbf,
+  0xcf, 0xe9, 0x26, 0x79, 0x0c, 0x70, 0x01, 0xc8, 0x40, 0xc6, 0x8b,
+  0x18, 0x74, 0x04, 0x23, 0x80, 0x0c, 0x5a, 0x58, 0x56, 0xc4, 0x53,
+  0x9e, 0x7a, 0x96, 0x41, 0x81, 0x8f, 0xd6, 0xea, 0x5a, 0x54, 0x3e,
+  0x28, 0x28, 0x4b, 0x72, 0x72, 0x5e, 0x78, 0xc4, 0x54, 0x14, 0xfc,
+  0x43, 0x21, 0xc0, 0xac, 0xde, 0xb2, 0xa2, 0xb9, 0xa0, 0x94, 0x9a,
+  0x14, 0x97, 0xa9, 0x6c, 0x28, 0x55, 0xc5, 0x0e, 0x00, 0x04, 0x0b,
+  0x0a, 0x18, 0x6f, 0x99, 0x79, 0x6f, 0x0e, 0xaa, 0x6e, 0x79, 0x37,
+  0x80, 0x76, 0x75, 0x19, 0x20, 0x24, 0x5d, 0x65, 0x98, 0x6c, 0x61,
+  0x6f, 0xd7, 0x6d, 0x72, 0xd8, 0x78, 0x91, 0x5b, 0x6e, 0xa3, 0x78,
+  0x65, 0xd1, 0x58, 0x70, 0x64, 0xc4, 0x62, 0x61, 0x77, 0xce, 0x20,
+  0x96, 0xb0, 0x6e, 0x6b, 0x67, 0x63, 0x31, 0x30, 0x77, 0xbd, 0x61,
+  0x73, 0x10, 0x65, 0xb9, 0x6c, 0xc8, 0xa7, 0x77, 0x22, 0x77, 0xfe,
+  0x6c, 0x20, 0x38, 0xc7, 0x6c, 0x65, 0x6a, 0xf7, 0x79, 0x1c, 0x77,
+  0x8f, 0x20, 0x30, 0x76, 0x67, 0x6b, 0x47, 0x20, 0x11, 0x61, 0xb7,
+  0xa8, 0x67, 0x62, 0x4a, 0x78, 0x61, 0xbc, 0x6d, 0x61, 0x98, 0xf3,
+  0x20, 0x20, 0x8c, 0xfc, 0x79, 0x6d, 0xab, 0xca, 0x75, 0x64, 0x31,
+  0x66, 0xad, 0x23, 0x77, 0x93, 0x76, 0xe6, 0x73, 0x76, 0x02, 0x9e,
+  0x63, 0x6f, 0xd1, 0x77, 0x47, 0xa9, 0x73, 0x96, 0x6c, 0x65, 0x3f,
+  0x8d, 0x6f, 0x71, 0x4f, 0xe0, 0x71, 0x20, 0x57, 0x0b, 0x79, 0x19,
+  0x72, 0x20, 0x30, 0xce, 0x20, 0xb2, 0x6f, 0x2a, 0x78, 0x20, 0x92,
+  0x14, 0x61, 0x6e, 0x8c, 0x22, 0x74, 0x6c, 0xf0, 0x6c, 0xd6, 0x42,
+  0x79, 0x9a, 0x70, 0x75, 0x91, 0x73, 0x7d, 0x65, 0x97, 0xab, 0x75,
+  0x80, 0xb4, 0xa8, 0x20, 0x7e, 0xf1, 0xeb, 0xd7, 0x1c, 0x12, 0x40,
+  0x10, 0x48, 0x10, 0x48, 0x20, 0x10, 0x04, 0x7f, 0x42, 0x80, 0x10,
+  0xbc, 0x42, 0x90, 0x10, 0x20, 0x08, 0x83, 0x30, 0x34, 0x9a, 0xd1,
+  0x1f, 0xc1, 0xfe, 0xa1, 0x88, 0x3a, 0x4d, 0x73, 0x8e, 0x58, 0x81,
+  0x8a, 0xb4, 0x67, 0xe8, 0x12, 0x9e, 0x47, 0x61, 0x1b, 0x4d, 0x1a,
+  0xb1, 0x4e, 0x5e, 0xd1, 0x38, 0x28, 0xde, 0x21, 0x11, 0x9c, 0x31,
+  0x6f, 0xd2, 0xed, 0x00, 0x6f, 0x8c, 0x66, 0x41, 0xa3, 0x94, 0xe1,
+  0x0f, 0xa6, 0xae, 0xa2, 0xa7, 0x39, 0x2a, 0x93, 0xa0, 0x72, 0xb0,
+  0xeb, 0xe4, 0x5a, 0xf0, 0x51, 0xba, 0x91, 0xc1, 0xb0, 0x44, 0x69,
+  0x18, 0x34, 0x1a, 0xd4, 0x03, 0x08, 0x28, 0x07, 0x22, 0xbf, 0x5e,
+  0xec, 0xc8, 0x7e, 0x95, 0x59, 0x6e, 0x04, 0xb1, 0xfb, 0x24, 0x76,
+  0x8c, 0x96, 0x1d, 0x7b, 0xf2, 0x4c, 0x0a, 0xb4, 0x71, 0xed, 0x5f,
+  0x7b, 0x53, 0x39, 0x35, 0xc0, 0xee, 0x19, 0x6e, 0xed, 0x09, 0x5a,
+  0x87, 0x3e, 0x73, 0xb8, 0x98, 0x33, 0x8a, 0x34, 0xba, 0x76, 0x1a,
+  0x31, 0xba, 0xb1, 0x1c, 0x2a, 0x07, 0xd4, 0x84, 0xe4, 0x07, 0x1b,
+  0x47, 0xcb, 0x86, 0xb2, 0xc4, 0x6e, 0x25, 0xb1, 0x53, 0x92, 0x1c,
+  0x8c, 0x2b, 0x07, 0x1c, 0x60, 0x2f, 0x70, 0x6c, 0xa7, 0x49, 0x61,
+  0x6b, 0xff, 0xc6, 0xae, 0x37, 0x91, 0xc0, 0xd9, 0x02, 0x72, 0x96,
+  0xc7, 0x7e, 0xc4, 0x8a, 0x82, 0xa8, 0x13, 0xd9, 0x93, 0x04, 0x11,
+  0x2b, 0xd8, 0xdd, 0x5c, 0xec, 0xa6, 0xd0, 0xac, 0xd3, 0xf1, 0xe2,
+  0x08, 0x42, 0x63, 0x9a, 0xbf, 0x79, 0x7f, 0x41, 0xd2, 0xc3, 0x68,
+  0x1e, 0xec, 0x00, 0x8c, 0x6d, 0x68, 0x66, 0xcb, 0xd5, 0x63, 0x28,
+  0xce, 0x18, 0x95, 0xb5, 0xf7, 0x17, 0xc0, 0xe0, 0x99, 0x43, 0xb1,
+  0x08, 0xb1, 0x43, 0x68, 0x50, 0x35, 0x31, 0xa8, 0xfc, 0x89, 0x6d,
+  0x31, 0x40, 0xb4, 0xf4, 0x14, 0xc1, 0xc0, 0x2e, 0xf9, 0x0c, 0xe6,
+  0x6c, 0x83, 0x09, 0x1f, 0x79, 0x06, 0x82, 0x5c, 0x47, 0xe1, 0x41,
+  0xce, 0x29, 0x98, 0xb9, 0xc6, 0x44, 0xf9, 0x01, 0xc8, 0x16, 0x21,
+  0x5a
+};
+
+// repeats(262144u, 5u), zstd -19 from a pipe, 1238 bytes.
+static const u8 RepeatsPiped[] = {
+  0x28, 0xb5, 0x2f, 0xfd, 0x04, 0x68, 0xbc, 0x0b, 0x00, 0x42, 0x44,
+  0x0f, 0x15, 0xc0, 0x1d, 0x03, 0xff, 0xff, 0xff, 0x36, 0x49, 0x92,
+  0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0xff, 0x7f, 0xbb, 0xb6,
+  0xc0, 0xff, 0xff, 0xff, 0xdf, 0xff, 0xff, 0xdf, 0xdd, 0x27, 0x05,
+  0x20, 0x2e, 0xc8, 0x62, 0xdf, 0x61, 0xab, 0x0a, 0x9c, 0x47, 0xc0,
+  0x1a, 0xa9, 0x46, 0x30, 0x5d, 0x95, 0x20, 0xeb, 0xc0, 0x40, 0x41,
+  0x14, 0xe0, 0x67, 0x40, 0x0e, 0x37, 0x04, 0x80, 0xb5, 0xa8, 0xa0,
+  0x59, 0x32, 0x6d, 0x06, 0x20, 0x84, 0x18, 0xa5, 0xca, 0xce, 0x03,
+  0x20, 0x04, 0x13, 0x91, 0x52, 0xc9, 0x30, 0x06, 0xaf, 0x74, 0x5c,
+  0xe8, 0x31, 0x93, 0x82, 0xfc, 0xb7, 0x2e, 0x3f, 0xaf, 0xc5, 0xbe,
+  0x9c, 0x1e, 0x9d, 0x95, 0xf5, 0x08, 0x25, 0xdd, 0x76, 0x06, 0x05,
+  0xf6, 0x63, 0x09, 0x95, 0xe0, 0x81, 0xbd, 0x98, 0xb5, 0x72, 0x0c,
+  0x50, 0x77, 0xa2, 0x0c, 0x47, 0xea, 0x6e, 0x99, 0x75, 0x8a, 0xda,
+  0x73, 0x82, 0x83, 0xcb, 0x49, 0x13, 0x90, 0x0e, 0x6b, 0x1a, 0x53,
+  0xa1, 0x4e, 0x35, 0xee, 0x35, 0x37, 0x83, 0x5d, 0x96, 0xd4, 0x11,
+  0x44, 0xc4, 0x11, 0x25, 0xaa, 0xe1, 0xe5, 0x8a, 0x27, 0xa8, 0xdf,
+  0xf4, 0x06, 0x36, 0xda, 0x92, 0x64, 0xc7, 0x1c, 0xdb, 0xae, 0x01,
+  0xd8, 0x21, 0x86, 0xf0, 0x5e, 0x9f, 0x7f, 0x5d, 0x18, 0x4d, 0x5b,
+  0xa8, 0xea, 0x42, 0x10, 0x69, 0x04, 0x24, 0xe5, 0x50, 0x6c, 0x6a,
+  0x46, 0x8a, 0x65, 0x18, 0x00, 0xb7, 0x8c, 0x99, 0x88, 0x64, 0xb9,
+  0xb4, 0xe1, 0x99, 0x9c, 0xa0, 0x74, 0x6f, 0x2e, 0x60, 0x69, 0xf4,
+  0x2c, 0x00, 0xe4, 0x84, 0x3d, 0x80, 0xc4, 0x80, 0x77, 0xbe, 0x01,
+  0x94, 0x96, 0x02, 0xbb, 0xcc, 0x89, 0xc0, 0x9d, 0xc5, 0xfd, 0x11,
+  0xc9, 0x39, 0xc0, 0xf8, 0xcd, 0x5c, 0x07, 0x67, 0x3d, 0x1c, 0xde,
+  0x85, 0x59, 0x3e, 0x0c, 0x52, 0x8e, 0xf0, 0x25, 0x21, 0xdd, 0xfa,
+  0x30, 0x57, 0x83, 0x4c, 0xac, 0xec, 0xf7, 0xb6, 0xdf, 0x48, 0xf9,
+  0x33, 0xaf, 0x37, 0xfe, 0xa2, 0x43, 0xd9, 0xf0, 0x10, 0x6b, 0x31,
+  0x8f, 0x3b, 0x48, 0x64, 0xcd, 0xda, 0x35, 0x8e, 0x80, 0x04, 0x24,
+  0xdd, 0xc3, 0x70, 0xa8, 0x76, 0x76, 0x5a, 0xf6, 0x7b, 0x49, 0x66,
+  0x1d, 0xe6, 0x59, 0x27, 0x9c, 0x8f, 0xfe, 0xf3, 0xad, 0x13, 0x9b,
+  0x8c, 0xf9, 0x6f, 0x6e, 0x9b, 0xe0, 0x53, 0xc0, 0xde, 0x02, 0x55,
+  0x5b, 0xfc, 0x52, 0x03, 0x2b, 0xd0, 0x92, 0x61, 0x31, 0xa7, 0xa0,
+  0xd6, 0xd5, 0xdf, 0xdb, 0x87, 0x39, 0x7b, 0x7f, 0x51, 0xa2, 0x64,
+  0x47, 0x6f, 0xbe, 0xcf, 0xe4, 0x58, 0x43, 0xbc, 0x28, 0x20, 0x75,
+  0x79, 0x39, 0x6a, 0xc7, 0x30, 0x26, 0x54, 0x89, 0xae, 0xc8, 0x6c,
+  0x0d, 0x00, 0x84, 0x05, 0x78, 0x75, 0xd1, 0xb8, 0x3c, 0x1d, 0xfd,
+  0xe9, 0x46, 0x44, 0x6f, 0xea, 0x80, 0x92, 0x7f, 0x22, 0x7a, 0x94,
+  0x53, 0xa6, 0x4e, 0x44, 0x5c, 0xb6, 0x25, 0x89, 0xd7, 0x73, 0x3f,
+  0xb1, 0xb6, 0x4e, 0x58, 0xb2, 0x08, 0x16, 0xc7, 0x73, 0x2a, 0xd0,
+  0x7c, 0x4c, 0xb2, 0xeb, 0x13, 0x20, 0xa4, 0x1e, 0x55, 0xdf, 0xec,
+  0xf1, 0xb5, 0x03, 0xe6, 0x33, 0xd4, 0x15, 0xd8, 0x83, 0xff, 0x27,
+  0x75, 0xc9, 0xaf, 0x59, 0x5a, 0xbc, 0x06, 0x57, 0x92, 0x5c, 0x56,
+  0xd7, 0x13, 0x77, 0x9b, 0x1d, 0x40, 0x26, 0xfe, 0x79, 0x68, 0x4f,
+  0x53, 0xc5, 0x44, 0x23, 0x80, 0xb6, 0xa8, 0x10, 0xfd, 0x01, 0x73,
+  0x3e, 0x49, 0x86, 0x03, 0x12, 0x48, 0x10, 0x48, 0x10, 0xf8, 0x7f,
+  0x04, 0x81, 0x13, 0x04, 0x23, 0x08, 0x14, 0x84, 0x41, 0x21, 0x82,
+  0x3f, 0xae, 0x95, 0xa4, 0xbf, 0x47, 0x12, 0x20, 0xf2, 0x44, 0x6c,
+  0x0b, 0xd8, 0x00, 0x88, 0x56, 0x8b, 0x23, 0x11, 0x46, 0xac, 0xc0,
+  0x9e, 0x2d, 0xad, 0xbc, 0x85, 0xbd, 0xd7, 0x3d, 0xd9, 0xcb, 0x30,
+  0x44, 0x63, 0x9c, 0xff, 0x78, 0x2c, 0x65, 0xf7, 0x87, 0x03, 0x76,
+  0x51, 0xff, 0x2f, 0xbd, 0x3a, 0xd3, 0x02, 0x4b, 0x77, 0x0e, 0x9b,
+  0xbe, 0x43, 0x26, 0x5e, 0xdc, 0x17, 0xbf, 0xea, 0x69, 0x38, 0x73,
+  0xd8, 0xd9, 0x8f, 0xb5, 0xa9, 0x17, 0x3b, 0x11, 0x06, 0x15, 0xe5,
+  0x82, 0x03, 0x44, 0x11, 0x24, 0xea, 0x68, 0xb5, 0xf5, 0xc1, 0x5a,
+  0x78, 0x3b, 0xb1, 0x10, 0x49, 0x96, 0x68, 0xe4, 0xc7, 0x11, 0x67,
+  0x61, 0x5d, 0xdb, 0x5a, 0xb7, 0x3b, 0xc1, 0xc3, 0xe3, 0x42, 0x1d,
+  0xcb, 0x9b, 0x8f, 0x43, 0x38, 0x88, 0xb1, 0x33, 0x85, 0x73, 0x00,
+  0x59, 0x2d, 0x3f, 0x63, 0xb6, 0x61, 0x27, 0x9d, 0x91, 0x42, 0x59,
+  0xb3, 0x56, 0x07, 0xb5, 0x9b, 0xd8, 0x19, 0x11, 0xb3, 0x80, 0x93,
+  0x13, 0x9d, 0x0b, 0xc1, 0x4d, 0x52, 0xf9, 0x72, 0x8c, 0xa0, 0x86,
+  0x53, 0x41, 0x4d, 0x39, 0x7f, 0x83, 0x1c, 0xa0, 0x47, 0x39, 0xc3,
+  0x0a, 0xdf, 0x48, 0x1a, 0x2a, 0x96, 0x40, 0xac, 0xc3, 0x64, 0x34,
+  0x64, 0x1a, 0x2c, 0x0e, 0x9f, 0x5b, 0x70, 0x47, 0xab, 0x12, 0x57,
+  0x4c, 0xa0, 0x87, 0x47, 0x3f, 0x36, 0x23, 0x69, 0xa6, 0x0b, 0xc6,
+  0x6e, 0xd4, 0x7e, 0xeb, 0xf7, 0x14, 0x88, 0x40, 0xb9, 0x86, 0x35,
+  0xa2, 0xb3, 0xe3, 0xf8, 0x15, 0x7b, 0x3b, 0xdf, 0x66, 0x84, 0x97,
+  0xd9, 0x68, 0x22, 0xcb, 0xb4, 0x44, 0xff, 0x52, 0x45, 0x3a, 0x01,
+  0x9a, 0x4a, 0xbc, 0x36, 0xb0, 0x88, 0x02, 0x5c, 0x19, 0xdf, 0xd2,
+  0xd3, 0xb2, 0x6a, 0xab, 0x43, 0xb6, 0x91, 0x7f, 0xee, 0x82, 0x65,
+  0x07, 0xb8, 0x83, 0x04, 0xb4, 0x61, 0x17, 0xb3, 0x17, 0xd2, 0x03,
+  0xd2, 0x2a, 0xa9, 0x99, 0x2e, 0x81, 0x1e, 0x0c, 0x93, 0xc0, 0x8e,
+  0x38, 0x6a, 0xbd, 0xbe, 0x92, 0x5f, 0xc3, 0x09, 0x11, 0x71, 0x4c,
+  0x36, 0x6c, 0xec, 0xc4, 0xb3, 0xa3, 0xfa, 0x65, 0xc4, 0x3e, 0x86,
+  0xf4, 0xdd, 0xed, 0x7a, 0x62, 0x71, 0xb1, 0xfb, 0x4e, 0x29, 0xc0,
+  0x52, 0x01, 0xfd, 0x0c, 0x00, 0x04, 0x06, 0x9a, 0xea, 0x7b, 0x9f,
+  0x7f, 0x5a, 0x1f, 0x0d, 0xdc, 0x95, 0x2f, 0x83, 0x33, 0xa7, 0x14,
+  0x60, 0x37, 0xa6, 0x27, 0xd4, 0x43, 0x36, 0x28, 0x57, 0xdf, 0x07,
+  0xc6, 0x2e, 0x40, 0x54, 0x1c, 0xec, 0xc6, 0x63, 0x30, 0xed, 0x7e,
+  0x0a, 0x74, 0xda, 0x20, 0x9f, 0x26, 0x46, 0x2a, 0x10, 0x24, 0x72,
+  0x9d, 0xde, 0x7a, 0xad, 0xc2, 0xc8, 0x2c, 0x1a, 0x70, 0xb6, 0x4a,
+  0xc7, 0x4e, 0x3b, 0x2f, 0x4d, 0x19, 0x42, 0xb7, 0x2b, 0xbb, 0xf6,
+  0x33, 0xf0, 0xba, 0xcc, 0x60, 0x72, 0x5a, 0x8d, 0x6a, 0xd3, 0x0d,
+  0x13, 0x66, 0x00, 0xed, 0xbf, 0xd7, 0x32, 0x79, 0x20, 0x6a, 0x75,
+  0x6d, 0x70, 0x73, 0x20, 0x80, 0xb3, 0xe8, 0x51, 0x77, 0xbf, 0xc6,
+  0x12, 0x48, 0x10, 0xf8, 0x4f, 0x10, 0x58, 0x41, 0x60, 0x05, 0xc1,
+  0x0a, 0x04, 0x41, 0x28, 0x0e, 0x11, 0xfb, 0x03, 0x2b, 0x97, 0x00,
+  0x7d, 0x5a, 0x5d, 0x99, 0x1c, 0x45, 0x96, 0x2e, 0x14, 0xf4, 0xcb,
+  0x7d, 0x79, 0xa7, 0x1c, 0x23, 0x81, 0x28, 0x3a, 0x98, 0xc0, 0x81,
+  0xca, 0x30, 0xa1, 0x8b, 0x8f, 0x23, 0x1c, 0x0a, 0x21, 0x3c, 0x1a,
+  0xeb, 0x57, 0x64, 0x42, 0xe1, 0x3f, 0x21, 0x59, 0x7b, 0x89, 0x2b,
+  0x4e, 0xf2, 0x6d, 0xc4, 0x80, 0x69, 0x74, 0x7e, 0x31, 0x7e, 0xd8,
+  0x48, 0xd6, 0x3d, 0x3a, 0xe2, 0xa2, 0xf5, 0x97, 0xd9, 0xfd, 0xd6,
+  0xd5, 0xb0, 0xe2, 0x5e, 0xd1, 0x8f, 0x93, 0x06, 0xcd, 0xa3, 0xfc,
+  0x8a, 0xc6, 0x11, 0x5e, 0xe9, 0x8f, 0x9c, 0x45, 0x48, 0xef, 0x85,
+  0x56, 0x26, 0xd2, 0xae, 0x49, 0x82, 0xfa, 0x2e, 0xe8, 0x6b, 0x28,
+  0x92, 0x19, 0x1d, 0x22, 0xdd, 0x11, 0x75, 0x44, 0xed, 0x0b, 0x4a,
+  0x37, 0x91, 0xd4, 0x8b, 0x9a, 0xc5, 0x32, 0x29, 0x4f, 0x70, 0x10,
+  0xf8, 0x38, 0xfb, 0x87, 0xec, 0x00, 0x0f, 0x55, 0xc0, 0x49, 0x89,
+  0xcd, 0x63, 0x0c, 0x0b, 0x18, 0xd5, 0x45, 0xc9, 0x39, 0x46, 0xb6,
+  0xf7, 0xa8, 0xa0, 0x6a, 0xe4, 0x8e, 0x38, 0x07, 0x3c, 0x41, 0xed,
+  0xe0, 0x65, 0x6a, 0x1c, 0x16, 0x3c, 0xbe, 0x35, 0x39, 0x15, 0x23,
+  0x02, 0x52, 0x20, 0x5e, 0x95, 0x38, 0x02, 0xd2, 0x2e, 0x78, 0x64,
+  0x3f, 0x89, 0x5e, 0x6f, 0x81, 0xf3, 0x34, 0xcf, 0x6c, 0x4b, 0xc4,
+  0x9b, 0xa5, 0xb5, 0x58, 0xd0, 0x1f, 0x16, 0x4d, 0x76, 0x8e, 0x28,
+  0xdc, 0x44, 0x74, 0xd0, 0x82, 0x9d, 0x3c, 0x7c, 0x5f, 0xf5, 0xe2,
+  0x0c, 0xce, 0x2e, 0x4e, 0xa3, 0xbb, 0x46, 0x8c, 0xc4, 0x57, 0x72,
+  0x39, 0xaf, 0x9a, 0x0b, 0x32, 0x45, 0xba, 0xe9, 0x03, 0xa2, 0xd3,
+  0x21, 0xf5, 0xd0, 0x73, 0xf6, 0x19, 0x2c, 0xdb, 0xd5, 0x82, 0x5d,
+  0xd6, 0x28, 0x9b, 0xec, 0x62, 0x61, 0x8b, 0x8d, 0x78, 0xf0, 0xf9,
+  0x41, 0x82, 0xd3, 0x2b, 0x95, 0xf5, 0xc1, 0x29, 0x14, 0x00, 0x17,
+  0x61, 0xe6, 0x40, 0x8f, 0xf7, 0xc8, 0x83, 0x62, 0x28, 0x08, 0xea,
+  0x4f, 0xd8, 0xc4, 0x07, 0xf4, 0x83, 0x99, 0x14, 0xee, 0x12, 0x56,
+  0x7d, 0x05, 0x4d, 0xfd, 0x28, 0x45
+};
+
+// A single level R8 image, the level is the frames one after the
+// other.
+static Arr<u8> makeKtx2(UInt2 size, const Arr<u8>& level)
+{
+  static constexpr u8 Identifier[] = {
+    0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+
+  const u32 header[] = {
+    9u, // VK_FORMAT_R8_UNORM
+    1u, size[0], size[1], 0u, 0u, 1u, 1u,
+    2u, // Zstandard
+    0u, 0u, 0u, 0u};
+  // Supercompression data, then the level index.
+  const u64 index[] = {
+    0u, 0u, 104u, level.size(), toU64(size[0]) * size[1]};
+
+  Arr<u8> ret(Identifier, Identifier + sizeof(Identifier));
+  ret.insert(
+    ret.end(), reinterpret_cast<const u8*>(header),
+    reinterpret_cast<const u8*>(header) + sizeof(header));
+  ret.insert(
+    ret.end(), reinterpret_cast<const u8*>(index),
+    reinterpret_cast<const u8*>(index) + sizeof(index));
+  ret.insert(ret.end(), level.begin(), level.end());
+  return ret;
+}
+
+static Arr<u8> concat(std::initializer_list<Span<u8 const>> parts)
+{
+  Arr<u8> ret;
+  for(const auto part: parts)
+    ret.insert(ret.end(), part.begin(), part.end());
+  return ret;
+}
+
+// Decodes the level, empty when it throws.
+static Opt<Arr<u8>>
+decode(UInt2 size, const Arr<u8>& level, bool verifyChecksums = true)
+{
+  const auto ktx2 = makeKtx2(size, level);
+
+  DataReader::ImageOptions options;
+  options.verifyChecksums = verifyChecksums;
+
+  try {
+    DataReader reader;
+    return reader.ReadImage({ktx2.data(), ktx2.size()}, options).texels;
+  } catch(const std::exception&) {
+    return std::nullopt;
+  }
+}
+
+int main()
+{
+  struct Case {
+    const char*    name;
+    UInt2          size;
+    Span<u8 const> frame;
+    Arr<u8>        expected;
+  };
+
+  const Case cases[] = {
+    {"level 1, checksum", {64u, 32u}, TextFast, text(2048u, 1u)},
+    {"level 19", {64u, 32u}, TextBest, text(2048u, 2u)},
+    {"raw block", {16u, 16u}, Noise, noise(256u, 3u)},
+    {"RLE block", {256u, 256u}, Solid, solid(65536u, 7u)},
+    {"several blocks", {512u, 512u}, Repeats, repeats(262144u, 4u)},
+    {"no content size", {512u, 512u}, RepeatsPiped,
+     repeats(262144u, 5u)},
+  };
+
+  for(const auto& test: cases) {
+    const auto texels =
+      decode(test.size, Arr<u8>(test.frame.begin(), test.frame.end()));
+    check(texels && *texels == test.expected, test.name);
+  }
+
+  // Frames follow each other, skippable frames are passed over.
+  const u8 skippable[] = {
+    0x5a, 0x2a, 0x4d, 0x18, 0x04, 0x00, 0x00, 0x00, 1u, 2u, 3u, 4u};
+  const auto frames = decode(
+    {256u, 257u}, concat({Solid, skippable, Noise}));
+  check(
+    frames && *frames == concat({solid(65536u, 7u), noise(256u, 3u)}),
+    "several frames");
+
+  // The frame checksum is only read when asked.
+  auto corrupt = Arr<u8>(std::begin(TextFast), std::end(TextFast));
+  corrupt.back() ^= 0x01u;
+  check(!decode({64u, 32u}, corrupt), "bad checksum throws");
+  check(
+    decode({64u, 32u}, corrupt, false) == text(2048u, 1u),
+    "checksum not verified");
+
+  const auto truncated =
+    Arr<u8>(std::begin(TextFast), std::end(TextFast) - 10);
+  check(!decode({64u, 32u}, truncated), "truncated frame throws");
+
+  auto badMagic = Arr<u8>(std::begin(Noise), std::end(Noise));
+  badMagic[0] ^= 0x01u;
+  check(!decode({16u, 16u}, badMagic), "bad magic throws");
+
+  // The frames must fill the level exactly.
+  const auto frame = Arr<u8>(std::begin(Noise), std::end(Noise));
+  check(!decode({16u, 32u}, frame), "short frame throws");
+  check(!decode({16u, 8u}, frame), "long frame throws");
+
+  std::printf("%u/%u checks pass\n", s_checks - s_failures, s_checks);
+  return s_failures == 0u ? 0 : 1;
+}